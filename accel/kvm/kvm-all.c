@@ -34,6 +34,7 @@
 #include "system/accel-blocker.h"
 #include "accel/accel-ops.h"
 #include "qemu/bswap.h"
+#include "qemu/host-utils.h"
 #include "exec/tswap.h"
 #include "system/memory.h"
 #include "system/ram_addr.h"
@@ -53,6 +54,7 @@
 
 #include "hw/boards.h"
 #include "system/stats.h"
+#include "block/thread-pool.h"
 
 /* This check must be after config-host.h is included */
 #ifdef CONFIG_EVENTFD
@@ -541,6 +543,9 @@ static int do_kvm_destroy_vcpu(CPUState *cpu)
         cpu->kvm_dirty_gfns = NULL;
     }
 
+    g_free(cpu->kvm_exit_stats);
+    cpu->kvm_exit_stats = NULL;
+
     kvm_park_vcpu(cpu);
 err:
     return ret;
@@ -557,10 +562,12 @@ void kvm_destroy_vcpu(CPUState *cpu)
 int kvm_init_vcpu(CPUState *cpu, Error **errp)
 {
     KVMState *s = kvm_state;
+    int64_t start_us, arch_us;
     int mmap_size;
     int ret;
 
     trace_kvm_init_vcpu(cpu->cpu_index, kvm_arch_vcpu_id(cpu));
+    start_us = g_get_monotonic_time();
 
     ret = kvm_arch_pre_create_vcpu(cpu, errp);
     if (ret < 0) {
@@ -610,13 +617,17 @@ int kvm_init_vcpu(CPUState *cpu, Error **errp)
         }
     }
 
+    arch_us = g_get_monotonic_time();
     ret = kvm_arch_init_vcpu(cpu);
     if (ret < 0) {
         error_setg_errno(errp, -ret,
                          "kvm_init_vcpu: kvm_arch_init_vcpu failed (%lu)",
                          kvm_arch_vcpu_id(cpu));
     }
+    trace_kvm_init_vcpu_done(cpu->cpu_index, arch_us - start_us,
+                             g_get_monotonic_time() - arch_us);
     cpu->kvm_vcpu_stats_fd = kvm_vcpu_ioctl(cpu, KVM_GET_STATS_FD, NULL);
+    cpu->kvm_exit_stats = g_new0(KVMExitStats, 1);
 
 err:
     return ret;
@@ -820,9 +831,13 @@ static bool kvm_slot_get_dirty_log(KVMState *s, KVMSlot *slot)
     return ret == 0;
 }
 
-/* Should be with all slots_lock held for the address spaces. */
+/*
+ * Should be with all slots_lock held for the address spaces.  @shared is
+ * true if other threads may be marking pages in the same slots concurrently.
+ */
 static void kvm_dirty_ring_mark_page(KVMState *s, uint32_t as_id,
-                                     uint32_t slot_id, uint64_t offset)
+                                     uint32_t slot_id, uint64_t offset,
+                                     bool shared)
 {
     KVMMemoryListener *kml;
     KVMSlot *mem;
@@ -839,7 +854,11 @@ static void kvm_dirty_ring_mark_page(KVMState *s, uint32_t as_id,
         return;
     }
 
-    set_bit(offset, mem->dirty_bmap);
+    if (shared) {
+        set_bit_atomic(offset, mem->dirty_bmap);
+    } else {
+        set_bit(offset, mem->dirty_bmap);
+    }
 }
 
 static bool dirty_gfn_is_dirtied(struct kvm_dirty_gfn *gfn)
@@ -876,7 +895,8 @@ static void dirty_gfn_set_collected(struct kvm_dirty_gfn *gfn)
  * Should be with all slots_lock held for the address spaces.  It returns the
  * dirty page we've collected on this dirty ring.
  */
-static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
+static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu,
+                                        bool shared)
 {
     struct kvm_dirty_gfn *dirty_gfns = cpu->kvm_dirty_gfns, *cur;
     uint32_t ring_size = s->kvm_dirty_ring_size;
@@ -900,7 +920,7 @@ static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
             break;
         }
         kvm_dirty_ring_mark_page(s, cur->slot >> 16, cur->slot & 0xffff,
-                                 cur->offset);
+                                 cur->offset, shared);
         dirty_gfn_set_collected(cur);
         trace_kvm_dirty_ring_page(cpu->cpu_index, fetch, cur->offset);
         fetch++;
@@ -912,6 +932,65 @@ static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
     return count;
 }
 
+/* By default, use one reap task per this many vCPUs... */
+#define KVM_DIRTY_RING_VCPUS_PER_REAPER 32
+/* ...but no more than this */
+#define KVM_DIRTY_RING_DEFAULT_MAX_REAPERS 8
+#define KVM_DIRTY_RING_MAX_REAPERS 64
+
+typedef struct KVMDirtyRingReapTask {
+    KVMState *s;
+    uint32_t index;
+    uint64_t total;
+} KVMDirtyRingReapTask;
+
+static int kvm_dirty_ring_reap_task(void *opaque)
+{
+    KVMDirtyRingReapTask *t = opaque;
+    KVMState *s = t->s;
+    CPUState *cpu;
+
+    t->total = 0;
+    CPU_FOREACH(cpu) {
+        if (cpu->cpu_index % s->reaper.nr_tasks == t->index) {
+            t->total += kvm_dirty_ring_reap_one(s, cpu, true);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Must be with slots_lock held, which keeps the slots stable for the
+ * reaper threads, and with BQL held, which keeps the vCPU list stable.
+ */
+static uint64_t kvm_dirty_ring_reap_all(KVMState *s)
+{
+    struct KVMDirtyRingReaper *r = &s->reaper;
+    uint64_t total = 0;
+    CPUState *cpu;
+    uint32_t i;
+
+    if (!r->pool) {
+        CPU_FOREACH(cpu) {
+            total += kvm_dirty_ring_reap_one(s, cpu, false);
+        }
+        return total;
+    }
+
+    for (i = 1; i < r->nr_tasks; i++) {
+        thread_pool_submit(r->pool, kvm_dirty_ring_reap_task, &r->tasks[i],
+                           NULL);
+    }
+    kvm_dirty_ring_reap_task(&r->tasks[0]);
+    thread_pool_wait(r->pool);
+
+    for (i = 0; i < r->nr_tasks; i++) {
+        total += r->tasks[i].total;
+    }
+    return total;
+}
+
 /* Must be with slots_lock held */
 static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
 {
@@ -922,11 +1001,9 @@ static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
     stamp = get_clock();
 
     if (cpu) {
-        total = kvm_dirty_ring_reap_one(s, cpu);
+        total = kvm_dirty_ring_reap_one(s, cpu, false);
     } else {
-        CPU_FOREACH(cpu) {
-            total += kvm_dirty_ring_reap_one(s, cpu);
-        }
+        total = kvm_dirty_ring_reap_all(s);
     }
 
     if (total) {
@@ -940,6 +1017,13 @@ static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
         trace_kvm_dirty_ring_reap(total, stamp / 1000);
     }
 
+    if (total && !cpu) {
+        uint64_t avg = stat64_get(&s->reaper.reap_latency_ns);
+
+        stat64_set(&s->reaper.reap_latency_ns,
+                   avg ? (avg * 7 + stamp) / 8 : stamp);
+    }
+
     return total;
 }
 
@@ -1657,10 +1741,27 @@ static void *kvm_dirty_ring_reaper_thread(void *data)
     g_assert_not_reached();
 }
 
-static void kvm_dirty_ring_reaper_init(KVMState *s)
+static void kvm_dirty_ring_reaper_init(KVMState *s, MachineState *ms)
 {
     struct KVMDirtyRingReaper *r = &s->reaper;
 
+    r->nr_tasks = s->kvm_dirty_ring_reapers;
+    if (!r->nr_tasks) {
+        r->nr_tasks = MIN(DIV_ROUND_UP(ms->smp.max_cpus,
+                                       KVM_DIRTY_RING_VCPUS_PER_REAPER),
+                          KVM_DIRTY_RING_DEFAULT_MAX_REAPERS);
+    }
+    if (r->nr_tasks > 1) {
+        r->pool = thread_pool_new();
+        thread_pool_set_max_threads(r->pool, r->nr_tasks - 1);
+        r->tasks = g_new0(KVMDirtyRingReapTask, r->nr_tasks);
+        for (uint32_t i = 0; i < r->nr_tasks; i++) {
+            r->tasks[i].s = s;
+            r->tasks[i].index = i;
+        }
+    }
+    trace_kvm_dirty_ring_reaper_init(r->nr_tasks);
+
     qemu_thread_create(&r->reaper_thr, "kvm-reaper",
                        kvm_dirty_ring_reaper_thread,
                        s, QEMU_THREAD_JOINABLE);
@@ -2036,6 +2137,40 @@ static void clear_gsi(KVMState *s, unsigned int gsi)
     clear_bit(gsi, s->used_gsi_bitmap);
 }
 
+static void set_route_slot(KVMState *s, unsigned int gsi, unsigned int n)
+{
+    if (gsi < s->gsi_count) {
+        s->irq_route_slot[gsi] = n;
+    }
+}
+
+/*
+ * Find the routing entry for @gsi.  Use the slot hint first, so that MSI
+ * route updates on guests with many vectors don't scan the whole table.
+ */
+static struct kvm_irq_routing_entry *kvm_find_routing_entry(KVMState *s,
+                                                            unsigned int gsi)
+{
+    struct kvm_irq_routing_entry *entry;
+    int n;
+
+    if (gsi < s->gsi_count) {
+        n = s->irq_route_slot[gsi];
+        if (n < s->irq_routes->nr && s->irq_routes->entries[n].gsi == gsi) {
+            return &s->irq_routes->entries[n];
+        }
+    }
+
+    for (n = 0; n < s->irq_routes->nr; n++) {
+        entry = &s->irq_routes->entries[n];
+        if (entry->gsi == gsi) {
+            set_route_slot(s, gsi, n);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
 void kvm_init_irq_routing(KVMState *s)
 {
     int gsi_count;
@@ -2044,11 +2179,13 @@ void kvm_init_irq_routing(KVMState *s)
     if (gsi_count > 0) {
         /* Round up so we can search ints using ffs */
         s->used_gsi_bitmap = bitmap_new(gsi_count);
+        s->irq_route_slot = g_new0(unsigned int, gsi_count);
         s->gsi_count = gsi_count;
     }
 
     s->irq_routes = g_malloc0(sizeof(*s->irq_routes));
     s->nr_allocated_irq_routes = 0;
+    s->irq_routes_dirty = true;
 
     kvm_arch_init_irq_routing(s);
 }
@@ -2065,10 +2202,19 @@ void kvm_irqchip_commit_routes(KVMState *s)
         return;
     }
 
+    /*
+     * Guests that mask and unmask MSI vectors in their interrupt handlers
+     * rewrite the same routes over and over; skip the ioctl for those.
+     */
+    if (!s->irq_routes_dirty) {
+        return;
+    }
+
     s->irq_routes->flags = 0;
     trace_kvm_irqchip_commit_routes();
     ret = kvm_vm_ioctl(s, KVM_SET_GSI_ROUTING, s->irq_routes);
     assert(ret == 0);
+    s->irq_routes_dirty = false;
 }
 
 void kvm_add_routing_entry(KVMState *s,
@@ -2089,34 +2235,32 @@ void kvm_add_routing_entry(KVMState *s,
     }
     n = s->irq_routes->nr++;
     new = &s->irq_routes->entries[n];
+    s->irq_routes_dirty = true;
 
     *new = *entry;
 
     set_gsi(s, entry->gsi);
+    set_route_slot(s, entry->gsi, n);
 }
 
 static int kvm_update_routing_entry(KVMState *s,
                                     struct kvm_irq_routing_entry *new_entry)
 {
     struct kvm_irq_routing_entry *entry;
-    int n;
-
-    for (n = 0; n < s->irq_routes->nr; n++) {
-        entry = &s->irq_routes->entries[n];
-        if (entry->gsi != new_entry->gsi) {
-            continue;
-        }
 
-        if(!memcmp(entry, new_entry, sizeof *entry)) {
-            return 0;
-        }
-
-        *entry = *new_entry;
+    entry = kvm_find_routing_entry(s, new_entry->gsi);
+    if (!entry) {
+        return -ESRCH;
+    }
 
+    if (!memcmp(entry, new_entry, sizeof *entry)) {
         return 0;
     }
 
-    return -ESRCH;
+    *entry = *new_entry;
+    s->irq_routes_dirty = true;
+
+    return 0;
 }
 
 void kvm_irqchip_add_irq_route(KVMState *s, int irq, int irqchip, int pin)
@@ -2147,6 +2291,8 @@ void kvm_irqchip_release_virq(KVMState *s, int virq)
         if (e->gsi == virq) {
             s->irq_routes->nr--;
             *e = s->irq_routes->entries[s->irq_routes->nr];
+            set_route_slot(s, e->gsi, i);
+            s->irq_routes_dirty = true;
         }
     }
     clear_gsi(s, virq);
@@ -2497,12 +2643,22 @@ bool kvm_dirty_ring_enabled(void)
 static void query_stats_cb(StatsResultList **result, StatsTarget target,
                            strList *names, strList *targets, Error **errp);
 static void query_stats_schemas_cb(StatsSchemaList **result, Error **errp);
+static void query_exit_stats_cb(StatsResultList **result, StatsTarget target,
+                                strList *names, strList *targets,
+                                Error **errp);
+static void query_exit_stats_schemas_cb(StatsSchemaList **result,
+                                        Error **errp);
 
 uint32_t kvm_dirty_ring_size(void)
 {
     return kvm_state->kvm_dirty_ring_size;
 }
 
+uint64_t kvm_dirty_ring_reap_latency(void)
+{
+    return stat64_get(&kvm_state->reaper.reap_latency_ns) / SCALE_US;
+}
+
 static int do_kvm_create_vm(KVMState *s, int type)
 {
     int ret;
@@ -2808,13 +2964,15 @@ static int kvm_init(AccelState *as, MachineState *ms)
     }
 
     if (s->kvm_dirty_ring_size) {
-        kvm_dirty_ring_reaper_init(s);
+        kvm_dirty_ring_reaper_init(s, ms);
     }
 
     if (kvm_check_extension(kvm_state, KVM_CAP_BINARY_STATS_FD)) {
         add_stats_callbacks(STATS_PROVIDER_KVM, query_stats_cb,
                             query_stats_schemas_cb);
     }
+    add_stats_callbacks(STATS_PROVIDER_KVM_EXIT, query_exit_stats_cb,
+                        query_exit_stats_schemas_cb);
 
     return 0;
 
@@ -3010,6 +3168,33 @@ static void kvm_cpu_kick(CPUState *cpu)
     qatomic_set(&cpu->kvm_run->immediate_exit, 1);
 }
 
+static void kvm_exit_stats_record(CPUState *cpu, uint32_t exit_reason,
+                                  int64_t ns)
+{
+    KVMExitStats *stats = cpu->kvm_exit_stats;
+    KVMExitStatsKind kind;
+    int bucket;
+
+    switch (exit_reason) {
+    case KVM_EXIT_IO:
+        kind = KVM_EXIT_STATS_IO;
+        break;
+    case KVM_EXIT_MMIO:
+        kind = KVM_EXIT_STATS_MMIO;
+        break;
+    default:
+        kind = KVM_EXIT_STATS_OTHER;
+        break;
+    }
+
+    ns = MAX(ns, 0);
+    bucket = MIN(64 - clz64(ns), KVM_EXIT_STATS_HIST_BUCKETS - 1);
+
+    stat64_add(&stats->exits[kind], 1);
+    stat64_add(&stats->time_ns[kind], ns);
+    stat64_add(&stats->hist[kind][bucket], 1);
+}
+
 static void kvm_cpu_kick_self(void)
 {
     if (kvm_immediate_exit) {
@@ -3168,6 +3353,7 @@ int kvm_cpu_exec(CPUState *cpu)
 
     do {
         MemTxAttrs attrs;
+        int64_t exit_start;
 
         if (cpu->vcpu_dirty) {
             Error *err = NULL;
@@ -3240,6 +3426,7 @@ int kvm_cpu_exec(CPUState *cpu)
         }
 
         trace_kvm_run_exit(cpu->cpu_index, run->exit_reason);
+        exit_start = get_clock();
         switch (run->exit_reason) {
         case KVM_EXIT_IO:
             /* Called outside BQL */
@@ -3336,6 +3523,7 @@ int kvm_cpu_exec(CPUState *cpu)
             ret = kvm_arch_handle_exit(cpu, run);
             break;
         }
+        kvm_exit_stats_record(cpu, run->exit_reason, get_clock() - exit_start);
     } while (ret == 0);
 
     cpu_exec_end(cpu);
@@ -3951,6 +4139,41 @@ static void kvm_set_dirty_ring_size(Object *obj, Visitor *v,
     s->kvm_dirty_ring_size = value;
 }
 
+static void kvm_get_dirty_ring_reapers(Object *obj, Visitor *v,
+                                       const char *name, void *opaque,
+                                       Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    uint32_t value = s->kvm_dirty_ring_reapers;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void kvm_set_dirty_ring_reapers(Object *obj, Visitor *v,
+                                       const char *name, void *opaque,
+                                       Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    uint32_t value;
+
+    if (s->fd != -1) {
+        error_setg(errp, "Cannot set properties after the accelerator "
+                   "has been initialized");
+        return;
+    }
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value > KVM_DIRTY_RING_MAX_REAPERS) {
+        error_setg(errp, "dirty-ring-reapers must be at most %d.",
+                   KVM_DIRTY_RING_MAX_REAPERS);
+        return;
+    }
+
+    s->kvm_dirty_ring_reapers = value;
+}
+
 static char *kvm_get_device(Object *obj,
                             Error **errp G_GNUC_UNUSED)
 {
@@ -3996,6 +4219,7 @@ static void kvm_accel_instance_init(Object *obj)
     /* KVM dirty ring is by default off */
     s->kvm_dirty_ring_size = 0;
     s->kvm_dirty_ring_with_bitmap = false;
+    s->kvm_dirty_ring_reapers = 0;
     s->kvm_eager_split_size = 0;
     s->notify_vmexit = NOTIFY_VMEXIT_OPTION_RUN;
     s->notify_window = 0;
@@ -4044,6 +4268,13 @@ static void kvm_accel_class_init(ObjectClass *oc, const void *data)
     object_class_property_set_description(oc, "dirty-ring-size",
         "Size of KVM dirty page ring buffer (default: 0, i.e. use bitmap)");
 
+    object_class_property_add(oc, "dirty-ring-reapers", "uint32",
+        kvm_get_dirty_ring_reapers, kvm_set_dirty_ring_reapers,
+        NULL, NULL);
+    object_class_property_set_description(oc, "dirty-ring-reapers",
+        "Number of threads reaping the dirty rings in parallel "
+        "(default: 0, i.e. one per 32 vCPUs, up to 8)");
+
     object_class_property_add_str(oc, "device", kvm_get_device, kvm_set_device);
     object_class_property_set_description(oc, "device",
         "Path to the device node to use (default: /dev/kvm)");
@@ -4478,6 +4709,118 @@ void query_stats_schemas_cb(StatsSchemaList **result, Error **errp)
     }
 }
 
+static const char *const kvm_exit_stats_kind_str[KVM_EXIT_STATS__MAX] = {
+    [KVM_EXIT_STATS_IO] = "io",
+    [KVM_EXIT_STATS_MMIO] = "mmio",
+    [KVM_EXIT_STATS_OTHER] = "other",
+};
+
+static void add_exit_stat(StatsList **list, strList *names,
+                          const char *kind, const char *suffix,
+                          const Stat64 *values, int n)
+{
+    g_autofree char *name = g_strdup_printf("%s_%s", kind, suffix);
+    Stats *stats;
+    int i;
+
+    if (!apply_str_list_filter(name, names)) {
+        return;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_steal_pointer(&name);
+    stats->value = g_new0(StatsValue, 1);
+    if (n == 1) {
+        stats->value->type = QTYPE_QNUM;
+        stats->value->u.scalar = stat64_get(values);
+    } else {
+        uint64List *val_list = NULL;
+
+        for (i = n - 1; i >= 0; i--) {
+            QAPI_LIST_PREPEND(val_list, stat64_get(&values[i]));
+        }
+        stats->value->type = QTYPE_QLIST;
+        stats->value->u.list = val_list;
+    }
+    QAPI_LIST_PREPEND(*list, stats);
+}
+
+static void query_exit_stats_cb(StatsResultList **result, StatsTarget target,
+                                strList *names, strList *targets,
+                                Error **errp)
+{
+    CPUState *cpu;
+    int k;
+
+    if (target != STATS_TARGET_VCPU) {
+        return;
+    }
+
+    CPU_FOREACH(cpu) {
+        KVMExitStats *stats = cpu->kvm_exit_stats;
+        StatsList *stats_list = NULL;
+
+        if (!stats ||
+            !apply_str_list_filter(cpu->parent_obj.canonical_path, targets)) {
+            continue;
+        }
+        for (k = 0; k < KVM_EXIT_STATS__MAX; k++) {
+            const char *kind = kvm_exit_stats_kind_str[k];
+
+            add_exit_stat(&stats_list, names, kind, "exits",
+                          &stats->exits[k], 1);
+            add_exit_stat(&stats_list, names, kind, "exit_ns",
+                          &stats->time_ns[k], 1);
+            add_exit_stat(&stats_list, names, kind, "exit_latency_hist",
+                          stats->hist[k], KVM_EXIT_STATS_HIST_BUCKETS);
+        }
+        if (stats_list) {
+            add_stats_entry(result, STATS_PROVIDER_KVM_EXIT,
+                            cpu->parent_obj.canonical_path, stats_list);
+        }
+    }
+}
+
+static StatsSchemaValueList *add_exit_schema(StatsSchemaValueList *list,
+                                             const char *kind,
+                                             const char *suffix,
+                                             StatsType type, bool time)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup_printf("%s_%s", kind, suffix);
+    value->type = type;
+    if (time) {
+        value->has_unit = true;
+        value->unit = STATS_UNIT_SECONDS;
+        value->has_base = true;
+        value->base = 10;
+        value->exponent = -9;
+    }
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void query_exit_stats_schemas_cb(StatsSchemaList **result,
+                                        Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+    int k;
+
+    for (k = 0; k < KVM_EXIT_STATS__MAX; k++) {
+        const char *kind = kvm_exit_stats_kind_str[k];
+
+        stats_list = add_exit_schema(stats_list, kind, "exits",
+                                     STATS_TYPE_CUMULATIVE, false);
+        stats_list = add_exit_schema(stats_list, kind, "exit_ns",
+                                     STATS_TYPE_CUMULATIVE, true);
+        stats_list = add_exit_schema(stats_list, kind, "exit_latency_hist",
+                                     STATS_TYPE_LOG2_HISTOGRAM, true);
+    }
+    add_stats_schema(result, STATS_PROVIDER_KVM_EXIT, STATS_TARGET_VCPU,
+                     stats_list);
+}
+
 void kvm_mark_guest_state_protected(void)
 {
     kvm_state->guest_state_protected = true;
@@ -116,6 +116,11 @@ uint32_t kvm_dirty_ring_size(void)
     return 0;
 }
 
+uint64_t kvm_dirty_ring_reap_latency(void)
+{
+    return 0;
+}
+
 bool kvm_hwpoisoned_mem(void)
 {
     return false;
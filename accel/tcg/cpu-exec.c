@@ -241,9 +241,11 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, TCGTBCPUState s)
                tb->cs_base == s.cs_base &&
                tb->flags == s.flags &&
                tb_cflags(tb) == s.cflags)) {
+        qatomic_set(&jc->hits, jc->hits + 1);
         goto hit;
     }
 
+    qatomic_set(&jc->misses, jc->misses + 1);
     tb = tb_htable_lookup(cpu, s);
     if (tb == NULL) {
         return NULL;
@@ -552,6 +554,7 @@ void cpu_exec_step_atomic(CPUState *cpu)
 
     if (sigsetjmp(cpu->jmp_env, 0) == 0) {
         start_exclusive();
+        qatomic_inc(&tb_ctx.atomic_step_count);
         g_assert(cpu == current_cpu);
         g_assert(!cpu->running);
         cpu->running = true;
@@ -1027,6 +1030,8 @@ int cpu_exec(CPUState *cpu)
     return ret;
 }
 
+unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS_DEFAULT;
+
 bool tcg_exec_realizefn(CPUState *cpu, Error **errp)
 {
     static bool tcg_target_initialized;
@@ -1047,7 +1052,9 @@ bool tcg_exec_realizefn(CPUState *cpu, Error **errp)
         tcg_target_initialized = true;
     }
 
-    cpu->tb_jmp_cache = g_new0(CPUJumpCache, 1);
+    cpu->tb_jmp_cache = g_malloc0(sizeof(CPUJumpCache) +
+                                  tb_jmp_cache_size() *
+                                  sizeof(cpu->tb_jmp_cache->array[0]));
     tlb_init(cpu);
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_init_notifier_list(cpu);
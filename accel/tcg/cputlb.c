@@ -33,6 +33,8 @@
 #include "exec/mmu-access-type.h"
 #include "exec/tlb-common.h"
 #include "exec/vaddr.h"
+#include "system/cpus.h"
+#include "system/tcg.h"
 #include "tcg/tcg.h"
 #include "qemu/error-report.h"
 #include "exec/log.h"
@@ -158,7 +160,7 @@ static void tb_jmp_cache_clear_page(CPUState *cpu, vaddr page_addr)
     }
 
     i0 = tb_jmp_cache_hash_page(page_addr);
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
+    for (i = 0; i < tb_jmp_page_size(); i++) {
         qatomic_set(&jc->array[i0 + i].tb, NULL);
     }
 }
@@ -283,6 +285,8 @@ static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
     desc->n_used_entries = 0;
     desc->large_page_addr = -1;
     desc->large_page_mask = -1;
+    desc->lp_fill_addr = -1;
+    desc->lp_fill_mask = 0;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
@@ -349,21 +353,125 @@ void tlb_destroy(CPUState *cpu)
     }
 }
 
-/* flush_all_helper: run fn across all cpus
+/*
+ * Synchronising cross-vCPU flushes.
+ *
+ * A *_all_cpus_synced flush must be complete on every vCPU before the
+ * source vCPU executes its next guest instruction.  With a single TCG
+ * thread, the source's part is queued as "safe" work: it runs in an
+ * exclusive section, after which every other vCPU runs its queued part
+ * before executing guest code again.
+ *
+ * With MTTCG that exclusive section stops every vCPU for every flush.
+ * Instead, each destination's part counts down a TLBFlushSync when it
+ * has run, and the source's part, queued last, waits for the count to
+ * drop to zero.  Meanwhile it keeps running work queued on the source,
+ * so two vCPUs flushing each other at the same time cannot deadlock.
+ * The source sleeps on its halt_cond, which is kicked both when work is
+ * queued on it and when the last destination is done.  Work items run
+ * with the BQL held, which orders the countdown against that wait.
  *
- * If the wait flag is set then the src cpu's helper will be queued as
- * "safe" work and the loop exited creating a synchronisation point
- * where all queued work will be finished before execution starts
- * again.
+ * vCPUs whose thread has not been created yet, or is going away, do not
+ * run queued work in a timely manner.  Their part is still queued, but
+ * the source does not wait for it.
  */
-static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
-                             run_on_cpu_data d)
+typedef struct TLBFlushSync {
+    CPUState *src;
+    unsigned int pending;
+} TLBFlushSync;
+
+typedef struct TLBFlushSyncWork {
+    run_on_cpu_func fn;
+    run_on_cpu_data data;
+    TLBFlushSync *sync;
+} TLBFlushSyncWork;
+
+static TLBFlushSync *tlb_flush_sync_new(CPUState *src)
+{
+    TLBFlushSync *sync;
+
+    if (!qemu_tcg_mttcg_enabled()) {
+        return NULL;
+    }
+    sync = g_new0(TLBFlushSync, 1);
+    sync->src = src;
+    return sync;
+}
+
+static TLBFlushSyncWork *tlb_flush_sync_work_new(TLBFlushSync *sync,
+                                                 run_on_cpu_func fn,
+                                                 run_on_cpu_data d)
+{
+    TLBFlushSyncWork *w = g_new(TLBFlushSyncWork, 1);
+
+    w->fn = fn;
+    w->data = d;
+    w->sync = sync;
+    return w;
+}
+
+static void tlb_flush_sync_dst_work(CPUState *cpu, run_on_cpu_data data)
+{
+    TLBFlushSyncWork *w = data.host_ptr;
+    CPUState *src = w->sync->src;
+
+    w->fn(cpu, w->data);
+    if (qatomic_fetch_dec(&w->sync->pending) == 1) {
+        qemu_cpu_kick(src);
+    }
+    g_free(w);
+}
+
+static void tlb_flush_sync_src_work(CPUState *cpu, run_on_cpu_data data)
+{
+    TLBFlushSyncWork *w = data.host_ptr;
+
+    w->fn(cpu, w->data);
+    while (qatomic_read(&w->sync->pending)) {
+        if (!cpu_work_list_empty(cpu)) {
+            process_queued_cpu_work(cpu);
+            continue;
+        }
+        qemu_cond_wait_bql(cpu->halt_cond);
+    }
+    g_free(w->sync);
+    g_free(w);
+}
+
+/* Queue a destination's part of a synced flush. */
+static void tlb_flush_sync_dst(CPUState *dst, TLBFlushSync *sync,
+                               run_on_cpu_func fn, run_on_cpu_data d)
+{
+    if (!sync || !qatomic_read(&dst->created) || dst->unplug) {
+        async_run_on_cpu(dst, fn, d);
+        return;
+    }
+    qatomic_inc(&sync->pending);
+    async_run_on_cpu(dst, tlb_flush_sync_dst_work,
+                     RUN_ON_CPU_HOST_PTR(tlb_flush_sync_work_new(sync, fn, d)));
+}
+
+/* Queue the source's part of a synced flush, after all destinations. */
+static void tlb_flush_sync_src(CPUState *src, TLBFlushSync *sync,
+                               run_on_cpu_func fn, run_on_cpu_data d)
+{
+    if (!sync) {
+        async_safe_run_on_cpu(src, fn, d);
+        return;
+    }
+    async_run_on_cpu(src, tlb_flush_sync_src_work,
+                     RUN_ON_CPU_HOST_PTR(tlb_flush_sync_work_new(sync, fn, d)));
+}
+
+/* flush_all_helper: run fn across all cpus but src, as part of @sync */
+static void flush_all_helper(CPUState *src, TLBFlushSync *sync,
+                             run_on_cpu_func fn, run_on_cpu_data d)
 {
     CPUState *cpu;
 
     CPU_FOREACH(cpu) {
         if (cpu != src) {
-            async_run_on_cpu(cpu, fn, d);
+            tlb_flush_sync_dst(cpu, sync, fn, d);
         }
     }
 }
@@ -425,11 +533,12 @@ void tlb_flush(CPUState *cpu)
 void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *src_cpu, uint16_t idxmap)
 {
     const run_on_cpu_func fn = tlb_flush_by_mmuidx_async_work;
+    TLBFlushSync *sync = tlb_flush_sync_new(src_cpu);
 
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
-    async_safe_run_on_cpu(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    flush_all_helper(src_cpu, sync, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    tlb_flush_sync_src(src_cpu, sync, fn, RUN_ON_CPU_HOST_INT(idxmap));
 }
 
 void tlb_flush_all_cpus_synced(CPUState *src_cpu)
@@ -620,6 +729,8 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                               vaddr addr,
                                               uint16_t idxmap)
 {
+    TLBFlushSync *sync = tlb_flush_sync_new(src_cpu);
+
     tlb_debug("addr: %016" VADDR_PRIx " mmu_idx:%"PRIx16"\n", addr, idxmap);
 
     /* This should already be page aligned */
@@ -630,10 +741,10 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
      * See tlb_flush_page_by_mmuidx for details.
      */
     if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
+        flush_all_helper(src_cpu, sync, tlb_flush_page_by_mmuidx_async_1,
                          RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                              RUN_ON_CPU_TARGET_PTR(addr | idxmap));
+        tlb_flush_sync_src(src_cpu, sync, tlb_flush_page_by_mmuidx_async_1,
+                           RUN_ON_CPU_TARGET_PTR(addr | idxmap));
     } else {
         CPUState *dst_cpu;
         TLBFlushPageByMMUIdxData *d;
@@ -644,16 +755,17 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                 d = g_new(TLBFlushPageByMMUIdxData, 1);
                 d->addr = addr;
                 d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
+                tlb_flush_sync_dst(dst_cpu, sync,
+                                   tlb_flush_page_by_mmuidx_async_2,
+                                   RUN_ON_CPU_HOST_PTR(d));
             }
         }
 
         d = g_new(TLBFlushPageByMMUIdxData, 1);
         d->addr = addr;
         d->idxmap = idxmap;
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_2,
-                              RUN_ON_CPU_HOST_PTR(d));
+        tlb_flush_sync_src(src_cpu, sync, tlb_flush_page_by_mmuidx_async_2,
+                           RUN_ON_CPU_HOST_PTR(d));
     }
 }
 
@@ -741,7 +853,7 @@ static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
      * If the length is larger than the jump cache size, then it will take
      * longer to clear each entry individually than it will to clear it all.
      */
-    if (d.len >= (TARGET_PAGE_SIZE * TB_JMP_CACHE_SIZE)) {
+    if (d.len >= ((vaddr)TARGET_PAGE_SIZE * tb_jmp_cache_size())) {
         tcg_flush_jmp_cache(cpu);
         return;
     }
@@ -809,6 +921,7 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                                unsigned bits)
 {
     TLBFlushRangeData d, *p;
+    TLBFlushSync *sync;
     CPUState *dst_cpu;
 
     /* If no page bits are significant, this devolves to tlb_flush. */
@@ -831,18 +944,21 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
     d.idxmap = idxmap;
     d.bits = bits;
 
+    sync = tlb_flush_sync_new(src_cpu);
+
     /* Allocate a separate data block for each destination cpu.  */
     CPU_FOREACH(dst_cpu) {
         if (dst_cpu != src_cpu) {
             p = g_memdup(&d, sizeof(d));
-            async_run_on_cpu(dst_cpu, tlb_flush_range_by_mmuidx_async_1,
-                             RUN_ON_CPU_HOST_PTR(p));
+            tlb_flush_sync_dst(dst_cpu, sync,
+                               tlb_flush_range_by_mmuidx_async_1,
+                               RUN_ON_CPU_HOST_PTR(p));
         }
     }
 
     p = g_memdup(&d, sizeof(d));
-    async_safe_run_on_cpu(src_cpu, tlb_flush_range_by_mmuidx_async_1,
-                          RUN_ON_CPU_HOST_PTR(p));
+    tlb_flush_sync_src(src_cpu, sync, tlb_flush_range_by_mmuidx_async_1,
+                       RUN_ON_CPU_HOST_PTR(p));
 }
 
 void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
@@ -996,6 +1112,53 @@ static void tlb_add_large_page(CPUState *cpu, int mmu_idx,
     cpu->neg.tlb.d[mmu_idx].large_page_mask = lp_mask;
 }
 
+/*
+ * Remember the complete translation of the large page containing @addr,
+ * so that tlb_fill_large_page can synthesize entries for the other
+ * small pages within it.  Only valid if the target has flagged the
+ * large page as physically contiguous.
+ */
+static void tlb_record_large_page(CPUState *cpu, int mmu_idx, vaddr addr,
+                                  const CPUTLBEntryFull *full, uint64_t size)
+{
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    vaddr lp_mask = ~(size - 1);
+
+    desc->lp_fill = *full;
+    desc->lp_fill.phys_addr = (full->phys_addr & TARGET_PAGE_MASK)
+                            - (addr & TARGET_PAGE_MASK & ~lp_mask);
+    desc->lp_fill_addr = addr & lp_mask;
+    desc->lp_fill_mask = lp_mask;
+}
+
+/*
+ * Refill the tlb for @addr from the recorded large page, if @addr lies
+ * within it and the large page permits the access.  All of the state
+ * that the guest page tables hold for a large page lives in the single
+ * descriptor already walked, so nothing is gained by walking it again
+ * for each small page.  Any flush that touches the large page discards
+ * the whole mmu_idx, and the recorded page with it.
+ */
+static bool tlb_fill_large_page(CPUState *cpu, vaddr addr,
+                                MMUAccessType type, int mmu_idx)
+{
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    CPUTLBEntryFull full;
+
+    if ((addr & desc->lp_fill_mask) != desc->lp_fill_addr ||
+        !(desc->lp_fill.prot & (PAGE_READ << type))) {
+        return false;
+    }
+
+    full = desc->lp_fill;
+    full.phys_addr += addr & TARGET_PAGE_MASK & ~desc->lp_fill_mask;
+    tlb_debug("large page refill: idx %d vaddr=%016" VADDR_PRIx
+              " paddr=0x" HWADDR_FMT_plx "\n",
+              mmu_idx, addr, full.phys_addr);
+    tlb_set_page_full(cpu, mmu_idx, addr, &full);
+    return true;
+}
+
 static inline void tlb_set_compare(CPUTLBEntryFull *full, CPUTLBEntry *ent,
                                    vaddr address, int flags,
                                    MMUAccessType access_type, bool enable)
@@ -1043,6 +1206,9 @@ void tlb_set_page_full(CPUState *cpu, int mmu_idx,
     } else {
         sz = (hwaddr)1 << full->lg_page_size;
         tlb_add_large_page(cpu, mmu_idx, addr, sz);
+        if (full->lg_page_contiguous) {
+            tlb_record_large_page(cpu, mmu_idx, addr, full, sz);
+        }
     }
     addr_page = addr & TARGET_PAGE_MASK;
     paddr_page = full->phys_addr & TARGET_PAGE_MASK;
@@ -1242,6 +1408,15 @@ static bool tlb_fill_align(CPUState *cpu, vaddr addr, MMUAccessType type,
 {
     const TCGCPUOps *ops = cpu->cc->tcg_ops;
     CPUTLBEntryFull full;
+    bool aligned = !(addr & ((1u << memop_alignment_bits(memop)) - 1));
+
+    /*
+     * Alignment faults are raised by the target's hook, so only bypass
+     * it for accesses that cannot fault on alignment.
+     */
+    if (aligned && tlb_fill_large_page(cpu, addr, type, mmu_idx)) {
+        return true;
+    }
 
     if (ops->tlb_fill_align) {
         if (ops->tlb_fill_align(cpu, &full, addr, type, mmu_idx,
@@ -1251,7 +1426,7 @@ static bool tlb_fill_align(CPUState *cpu, vaddr addr, MMUAccessType type,
         }
     } else {
         /* Legacy behaviour is alignment before paging. */
-        if (addr & ((1u << memop_alignment_bits(memop)) - 1)) {
+        if (!aligned) {
             ops->do_unaligned_access(cpu, addr, type, mmu_idx, ra);
         }
         if (ops->tlb_fill(cpu, addr, size, type, mmu_idx, probe, ra)) {
@@ -248,6 +248,28 @@ static void gen_mem_cb(struct qemu_plugin_regular_cb *cb,
     tcg_temp_free_i32(clear_flags);
 }
 
+static void gen_mem_cond_cb(struct qemu_plugin_conditional_cb *cb,
+                            qemu_plugin_meminfo_t meminfo, TCGv_i64 addr)
+{
+    struct qemu_plugin_regular_cb regular = { .f = cb->f,
+                                              .info = cb->info,
+                                              .userp = cb->userp };
+    TCGv_ptr ptr = gen_plugin_u64_ptr(cb->entry);
+    TCGv_i64 val = tcg_temp_ebb_new_i64();
+    TCGLabel *after_cb = gen_new_label();
+
+    /* Condition should be negated, as calling the cb is the "else" path */
+    TCGCond cond = tcg_invert_cond(plugin_cond_to_tcgcond(cb->cond));
+
+    tcg_gen_ld_i64(val, ptr, 0);
+    tcg_gen_brcondi_i64(cond, val, cb->imm, after_cb);
+    gen_mem_cb(&regular, meminfo, addr);
+    gen_set_label(after_cb);
+
+    tcg_temp_free_i64(val);
+    tcg_temp_free_ptr(ptr);
+}
+
 static void inject_cb(struct qemu_plugin_dyn_cb *cb)
 
 {
@@ -279,6 +301,11 @@ static void inject_mem_cb(struct qemu_plugin_dyn_cb *cb,
             gen_mem_cb(&cb->regular, meminfo, addr);
         }
         break;
+    case PLUGIN_CB_MEM_COND:
+        if (rw & cb->cond.rw) {
+            gen_mem_cond_cb(&cb->cond, meminfo, addr);
+        }
+        break;
     case PLUGIN_CB_INLINE_ADD_U64:
     case PLUGIN_CB_INLINE_STORE_U64:
         if (rw & cb->inline_insn.rw) {
@@ -35,6 +35,10 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    /* code page writes that missed every TB by code_lines */
+    unsigned tb_phys_invalidate_skip_count;
+    /* insns run under start_exclusive by cpu_exec_step_atomic */
+    unsigned atomic_step_count;
 };
 
 extern TBContext tb_ctx;
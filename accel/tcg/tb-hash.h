@@ -28,27 +28,38 @@
 
 #ifdef CONFIG_SOFTMMU
 
-/* Only the bottom TB_JMP_PAGE_BITS of the jump cache hash bits vary for
+/* Only the bottom tb_jmp_page_bits() of the jump cache hash bits vary for
    addresses on the same page.  The top bits are the same.  This allows
    TLB invalidation to quickly clear a subset of the hash table.  */
-#define TB_JMP_PAGE_BITS (TB_JMP_CACHE_BITS / 2)
-#define TB_JMP_PAGE_SIZE (1 << TB_JMP_PAGE_BITS)
-#define TB_JMP_ADDR_MASK (TB_JMP_PAGE_SIZE - 1)
-#define TB_JMP_PAGE_MASK (TB_JMP_CACHE_SIZE - TB_JMP_PAGE_SIZE)
+static inline unsigned int tb_jmp_page_bits(void)
+{
+    return tb_jmp_cache_bits / 2;
+}
+
+static inline unsigned int tb_jmp_page_size(void)
+{
+    return 1u << tb_jmp_page_bits();
+}
 
 static inline unsigned int tb_jmp_cache_hash_page(vaddr pc)
 {
+    unsigned int shift = TARGET_PAGE_BITS - tb_jmp_page_bits();
+    unsigned int page_mask = tb_jmp_cache_size() - tb_jmp_page_size();
     vaddr tmp;
-    tmp = pc ^ (pc >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS));
-    return (tmp >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS)) & TB_JMP_PAGE_MASK;
+
+    tmp = pc ^ (pc >> shift);
+    return (tmp >> shift) & page_mask;
 }
 
 static inline unsigned int tb_jmp_cache_hash_func(vaddr pc)
 {
+    unsigned int shift = TARGET_PAGE_BITS - tb_jmp_page_bits();
+    unsigned int page_mask = tb_jmp_cache_size() - tb_jmp_page_size();
+    unsigned int addr_mask = tb_jmp_page_size() - 1;
     vaddr tmp;
-    tmp = pc ^ (pc >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS));
-    return (((tmp >> (TARGET_PAGE_BITS - TB_JMP_PAGE_BITS)) & TB_JMP_PAGE_MASK)
-           | (tmp & TB_JMP_ADDR_MASK));
+
+    tmp = pc ^ (pc >> shift);
+    return ((tmp >> shift) & page_mask) | (tmp & addr_mask);
 }
 
 #else
@@ -56,7 +67,7 @@ static inline unsigned int tb_jmp_cache_hash_func(vaddr pc)
 /* In user-mode we can get better hashing because we do not have a TLB */
 static inline unsigned int tb_jmp_cache_hash_func(vaddr pc)
 {
-    return (pc ^ (pc >> TB_JMP_CACHE_BITS)) & (TB_JMP_CACHE_SIZE - 1);
+    return (pc ^ (pc >> tb_jmp_cache_bits)) & (tb_jmp_cache_size() - 1);
 }
 
 #endif /* CONFIG_SOFTMMU */
@@ -12,8 +12,21 @@
 #include "qemu/rcu.h"
 #include "exec/cpu-common.h"
 
-#define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+/*
+ * The number of entries is 1 << tb_jmp_cache_bits, the same for all
+ * CPUs.  It is set with -accel tcg,jmp-cache-bits= before any CPU is
+ * realized and does not change afterwards.
+ */
+#define TB_JMP_CACHE_BITS_DEFAULT 12
+#define TB_JMP_CACHE_BITS_MIN 8
+#define TB_JMP_CACHE_BITS_MAX 20
+
+extern unsigned int tb_jmp_cache_bits;
+
+static inline unsigned int tb_jmp_cache_size(void)
+{
+    return 1u << tb_jmp_cache_bits;
+}
 
 /*
  * Invalidated in parallel; all accesses to 'tb' must be atomic.
@@ -21,13 +34,17 @@
  * no need for qatomic_rcu_read() and pc is always consistent with a
  * non-NULL value of 'tb'.  Strictly speaking pc is only needed for
  * CF_PCREL, but it's used always for simplicity.
+ *
+ * The hit and miss counters are only written by the owning CPU.
  */
 typedef struct CPUJumpCache {
     struct rcu_head rcu;
+    size_t hits;
+    size_t misses;
     struct {
         TranslationBlock *tb;
         vaddr pc;
-    } array[TB_JMP_CACHE_SIZE];
+    } array[];
 } CPUJumpCache;
 
 #endif /* ACCEL_TCG_TB_JMP_CACHE_H */
@@ -184,8 +184,24 @@ struct PageDesc {
     QemuSpin lock;
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
+    /*
+     * Bitmap of the 1/64th-of-a-page lines covered by any TB in
+     * first_tb.  Bits are only cleared once first_tb becomes empty,
+     * so the bitmap may over-approximate but never misses code.
+     */
+    uint64_t code_lines;
 };
 
+/* Return the code_lines bits covering [start, last] within one page. */
+static uint64_t page_code_line_mask(tb_page_addr_t start, tb_page_addr_t last)
+{
+    unsigned shift = TARGET_PAGE_BITS - 6;
+    unsigned first = (start & ~TARGET_PAGE_MASK) >> shift;
+    unsigned end = (last & ~TARGET_PAGE_MASK) >> shift;
+
+    return MAKE_64BIT_MASK(first, end - first + 1);
+}
+
 void page_table_config_init(void)
 {
     uint32_t v_l1_bits;
@@ -665,6 +681,7 @@ static void tb_remove_all_1(int level, void **lp)
         for (i = 0; i < V_L2_SIZE; ++i) {
             page_lock(&pd[i]);
             pd[i].first_tb = (uintptr_t)NULL;
+            qatomic_set(&pd[i].code_lines, 0);
             page_unlock(&pd[i]);
         }
     } else {
@@ -691,10 +708,23 @@ static void tb_remove_all(void)
  */
 static void tb_page_add(PageDesc *p, TranslationBlock *tb, unsigned int n)
 {
+    tb_page_addr_t start, last;
     bool page_already_protected;
 
     assert_page_locked(p);
 
+    /* The part of the TB within this page, as for PAGE_FOR_EACH_TB. */
+    start = tb_page_addr0(tb);
+    last = start + tb->size - 1;
+    if (n == 0) {
+        last = MIN(last, start | ~TARGET_PAGE_MASK);
+    } else {
+        start = tb_page_addr1(tb);
+        last = start + (last & ~TARGET_PAGE_MASK);
+    }
+    qatomic_set(&p->code_lines,
+                p->code_lines | page_code_line_mask(start, last));
+
     tb->page_next[n] = p->first_tb;
     page_already_protected = p->first_tb != 0;
     p->first_tb = (uintptr_t)tb | n;
@@ -734,6 +764,9 @@ static void tb_page_remove(PageDesc *pd, TranslationBlock *tb)
     PAGE_FOR_EACH_TB(unused, unused, pd, tb1, n1) {
         if (tb1 == tb) {
             *pprev = tb1->page_next[n1];
+            if (!pd->first_tb) {
+                qatomic_set(&pd->code_lines, 0);
+            }
             return;
         }
         pprev = &tb1->page_next[n1];
@@ -1204,7 +1237,20 @@ void tb_invalidate_phys_range_fast(CPUState *cpu, ram_addr_t start,
 
     if (p) {
         ram_addr_t last = start + len - 1;
-        struct page_collection *pages = page_collection_lock(start, last);
+        uint64_t lines = qatomic_read(&p->code_lines);
+        struct page_collection *pages;
+
+        /*
+         * The write lands on a page with code, but not on any line
+         * holding it: skip the page locks and the walk of its TBs.
+         * An empty bitmap takes the slow path, which unprotects the page.
+         */
+        if (lines && !(lines & page_code_line_mask(start, last))) {
+            qatomic_inc(&tb_ctx.tb_phys_invalidate_skip_count);
+            return;
+        }
+
+        pages = page_collection_lock(start, last);
 
         tb_invalidate_phys_page_range__locked(cpu, pages, p,
                                               start, last, ra);
@@ -43,6 +43,7 @@
 #include "accel/accel-cpu-ops.h"
 #include "accel/tcg/cpu-ops.h"
 #include "internal-common.h"
+#include "tb-jmp-cache.h"
 
 
 struct TCGState {
@@ -52,6 +53,7 @@ struct TCGState {
     bool one_insn_per_tb;
     int splitwx_enabled;
     unsigned long tb_size;
+    uint32_t jmp_cache_bits;
 };
 typedef struct TCGState TCGState;
 
@@ -78,6 +80,7 @@ static void tcg_accel_instance_init(Object *obj)
 #else
     s->splitwx_enabled = 0;
 #endif
+    s->jmp_cache_bits = TB_JMP_CACHE_BITS_DEFAULT;
 }
 
 bool one_insn_per_tb;
@@ -127,6 +130,7 @@ static int tcg_init_machine(AccelState *as, MachineState *ms)
 #endif
 
     tcg_allowed = true;
+    tb_jmp_cache_bits = s->jmp_cache_bits;
 
     page_init();
     tb_htable_init();
@@ -195,6 +199,36 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    if (value < TB_JMP_CACHE_BITS_MIN || value > TB_JMP_CACHE_BITS_MAX) {
+        error_setg(errp, "jmp-cache-bits must be between %d and %d",
+                   TB_JMP_CACHE_BITS_MIN, TB_JMP_CACHE_BITS_MAX);
+        return;
+    }
+
+    s->jmp_cache_bits = value;
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -257,6 +291,12 @@ static void tcg_accel_class_init(ObjectClass *oc, const void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "jmp-cache-bits", "int",
+        tcg_get_jmp_cache_bits, tcg_set_jmp_cache_bits,
+        NULL, NULL);
+    object_class_property_set_description(oc, "jmp-cache-bits",
+        "log2 of the number of per-vCPU TB jump cache entries");
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
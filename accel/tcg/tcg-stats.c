@@ -16,6 +16,7 @@
 #include "tcg/tcg.h"
 #include "internal-common.h"
 #include "tb-context.h"
+#include "tb-jmp-cache.h"
 #include <math.h>
 
 static void dump_drift_info(GString *buf)
@@ -147,6 +148,36 @@ static void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+static void tb_jmp_cache_counts(size_t *phits, size_t *pmisses)
+{
+    CPUState *cpu;
+    size_t hits = 0, misses = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+
+        if (jc) {
+            hits += qatomic_read(&jc->hits);
+            misses += qatomic_read(&jc->misses);
+        }
+    }
+    *phits = hits;
+    *pmisses = misses;
+}
+
+static void tcg_dump_jmp_cache_info(GString *buf)
+{
+    size_t hits, misses;
+
+    tb_jmp_cache_counts(&hits, &misses);
+    g_string_append_printf(buf, "TB jump cache       %u entries/vCPU\n",
+                           tb_jmp_cache_size());
+    g_string_append_printf(buf, "TB jump cache hits  %zu (%0.2f%%)\n",
+                           hits, hits + misses ?
+                           (double)hits / (hits + misses) * 100 : 0);
+    g_string_append_printf(buf, "TB jump cache miss  %zu\n", misses);
+}
+
 static void tcg_dump_flush_info(GString *buf)
 {
     size_t flush_full, flush_part, flush_elide;
@@ -155,6 +186,10 @@ static void tcg_dump_flush_info(GString *buf)
                            qatomic_read(&tb_ctx.tb_flush_count));
     g_string_append_printf(buf, "TB invalidate count %u\n",
                            qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    g_string_append_printf(buf, "TB invalidate skips %u\n",
+                           qatomic_read(&tb_ctx.tb_phys_invalidate_skip_count));
+    g_string_append_printf(buf, "exclusive atomics   %u\n",
+                           qatomic_read(&tb_ctx.atomic_step_count));
 
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
@@ -204,6 +239,7 @@ static void dump_exec_info(GString *buf)
 
     g_string_append_printf(buf, "\nStatistics:\n");
     tcg_dump_flush_info(buf);
+    tcg_dump_jmp_cache_info(buf);
 }
 
 void tcg_get_stats(AccelState *accel, GString *buf)
@@ -627,7 +627,7 @@ void tcg_flush_jmp_cache(CPUState *cpu)
         return;
     }
 
-    for (int i = 0; i < TB_JMP_CACHE_SIZE; i++) {
+    for (int i = 0; i < tb_jmp_cache_size(); i++) {
         qatomic_set(&jc->array[i].tb, NULL);
     }
 }
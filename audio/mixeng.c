@@ -315,11 +315,20 @@ static void conv_natural_float_to_stereo(struct st_sample *dst, const void *src,
 {
     const float *in = src;
 
+#ifdef FLOAT_MIXENG
+    /*
+     * Only the float mixing engine (CoreAudio builds) has the layout of
+     * the input; the integer one has to scale every sample.
+     */
+    QEMU_BUILD_BUG_ON(sizeof(struct st_sample) != 2 * sizeof(float));
+    memcpy(dst, in, samples * sizeof(*dst));
+#else
     while (samples--) {
         dst->l = CONV_NATURAL_FLOAT(*in++);
         dst->r = CONV_NATURAL_FLOAT(*in++);
         dst++;
     }
+#endif
 }
 
 static void conv_swap_float_to_stereo(struct st_sample *dst, const void *src,
@@ -372,11 +381,16 @@ static void clip_natural_float_from_stereo(
 {
     float *out = dst;
 
+#ifdef FLOAT_MIXENG
+    /* See conv_natural_float_to_stereo() */
+    memcpy(out, src, samples * sizeof(*src));
+#else
     while (samples--) {
         *out++ = CLIP_NATURAL_FLOAT(src->l);
         *out++ = CLIP_NATURAL_FLOAT(src->r);
         src++;
     }
+#endif
 }
 
 static void clip_swap_float_from_stereo(
@@ -24,7 +24,9 @@
 #include "qemu/osdep.h"
 #include "system/cryptodev.h"
 #include "qemu/error-report.h"
+#include "qemu/thread.h"
 #include "qapi/error.h"
+#include "block/thread-pool.h"
 #include "standard-headers/linux/virtio_crypto.h"
 #include "crypto/cipher.h"
 #include "crypto/akcipher.h"
@@ -45,6 +47,12 @@ typedef struct CryptoDevBackendBuiltinSession {
     uint8_t direction; /* encryption or decryption */
     uint8_t type; /* cipher? hash? aead? */
     QCryptoAkCipher *akcipher;
+    /* Serializes operations, the cipher IV is per-session state */
+    QemuMutex lock;
+    /* Operations still running on the thread pool */
+    unsigned inflight;
+    /* Closed by the guest, freed when the last operation completes */
+    bool closed;
     QTAILQ_ENTRY(CryptoDevBackendBuiltinSession) next;
 } CryptoDevBackendBuiltinSession;
 
@@ -58,8 +66,16 @@ struct CryptoDevBackendBuiltin {
     CryptoDevBackend parent_obj;
 
     CryptoDevBackendBuiltinSession *sessions[MAX_NUM_SESSIONS];
+    bool async;
 };
 
+typedef struct CryptoDevBackendBuiltinJob {
+    CryptoDevBackendBuiltinSession *sess;
+    CryptoDevBackendOpInfo *op_info;
+    int status;
+    Error *err;
+} CryptoDevBackendBuiltinJob;
+
 static void cryptodev_builtin_init_akcipher(CryptoDevBackend *backend)
 {
     QCryptoAkCipherOptions opts;
@@ -299,6 +315,7 @@ static int cryptodev_builtin_create_cipher_session(
     sess->cipher = cipher;
     sess->direction = sess_info->direction;
     sess->type = sess_info->op_type;
+    qemu_mutex_init(&sess->lock);
 
     builtin->sessions[index] = sess;
 
@@ -361,6 +378,7 @@ static int cryptodev_builtin_create_akcipher_session(
 
     sess = g_new0(CryptoDevBackendBuiltinSession, 1);
     sess->akcipher = akcipher;
+    qemu_mutex_init(&sess->lock);
 
     builtin->sessions[index] = sess;
 
@@ -417,6 +435,19 @@ static int cryptodev_builtin_create_session(
     return 0;
 }
 
+static void cryptodev_builtin_free_session(
+                 CryptoDevBackendBuiltinSession *session)
+{
+    if (session->cipher) {
+        qcrypto_cipher_free(session->cipher);
+    } else if (session->akcipher) {
+        qcrypto_akcipher_free(session->akcipher);
+    }
+
+    qemu_mutex_destroy(&session->lock);
+    g_free(session);
+}
+
 static int cryptodev_builtin_close_session(
            CryptoDevBackend *backend,
            uint64_t session_id,
@@ -433,13 +464,12 @@ static int cryptodev_builtin_close_session(
     }
 
     session = builtin->sessions[session_id];
-    if (session->cipher) {
-        qcrypto_cipher_free(session->cipher);
-    } else if (session->akcipher) {
-        qcrypto_akcipher_free(session->akcipher);
+    if (session->inflight) {
+        /* cryptodev_builtin_job_done() frees it */
+        session->closed = true;
+    } else {
+        cryptodev_builtin_free_session(session);
     }
-
-    g_free(session);
     builtin->sessions[session_id] = NULL;
     if (cb) {
         cb(opaque, VIRTIO_CRYPTO_OK);
@@ -540,6 +570,54 @@ static int cryptodev_builtin_asym_operation(
     return VIRTIO_CRYPTO_OK;
 }
 
+static int cryptodev_builtin_do_operation(
+                 CryptoDevBackendBuiltinSession *sess,
+                 CryptoDevBackendOpInfo *op_info, Error **errp)
+{
+    QCryptodevBackendAlgoType algtype = op_info->algtype;
+    int status = -VIRTIO_CRYPTO_ERR;
+
+    qemu_mutex_lock(&sess->lock);
+    if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_SYM) {
+        status = cryptodev_builtin_sym_operation(sess, op_info->u.sym_op_info,
+                                                 errp);
+    } else if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_ASYM) {
+        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
+                                                  op_info->u.asym_op_info,
+                                                  errp);
+    }
+    qemu_mutex_unlock(&sess->lock);
+
+    return status;
+}
+
+/* Runs in a thread pool worker */
+static int cryptodev_builtin_job_run(void *opaque)
+{
+    CryptoDevBackendBuiltinJob *job = opaque;
+
+    job->status = cryptodev_builtin_do_operation(job->sess, job->op_info,
+                                                 &job->err);
+    return 0;
+}
+
+static void cryptodev_builtin_job_done(void *opaque, int ret)
+{
+    CryptoDevBackendBuiltinJob *job = opaque;
+    CryptoDevBackendOpInfo *op_info = job->op_info;
+
+    if (job->err) {
+        error_report_err(job->err);
+    }
+    if (--job->sess->inflight == 0 && job->sess->closed) {
+        cryptodev_builtin_free_session(job->sess);
+    }
+    if (op_info->cb) {
+        op_info->cb(op_info->opaque, job->status);
+    }
+    g_free(job);
+}
+
 static int cryptodev_builtin_operation(
                  CryptoDevBackend *backend,
                  CryptoDevBackendOpInfo *op_info)
@@ -547,10 +625,7 @@ static int cryptodev_builtin_operation(
     CryptoDevBackendBuiltin *builtin =
                       CRYPTODEV_BACKEND_BUILTIN(backend);
     CryptoDevBackendBuiltinSession *sess;
-    CryptoDevBackendSymOpInfo *sym_op_info;
-    CryptoDevBackendAsymOpInfo *asym_op_info;
-    QCryptodevBackendAlgoType algtype = op_info->algtype;
-    int status = -VIRTIO_CRYPTO_ERR;
+    int status;
     Error *local_error = NULL;
 
     if (op_info->session_id >= MAX_NUM_SESSIONS ||
@@ -561,16 +636,19 @@ static int cryptodev_builtin_operation(
     }
 
     sess = builtin->sessions[op_info->session_id];
-    if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_SYM) {
-        sym_op_info = op_info->u.sym_op_info;
-        status = cryptodev_builtin_sym_operation(sess, sym_op_info,
-                                                 &local_error);
-    } else if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_ASYM) {
-        asym_op_info = op_info->u.asym_op_info;
-        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
-                                                  asym_op_info, &local_error);
+    if (builtin->async) {
+        CryptoDevBackendBuiltinJob *job = g_new0(CryptoDevBackendBuiltinJob, 1);
+
+        job->sess = sess;
+        job->op_info = op_info;
+        sess->inflight++;
+        thread_pool_submit_aio(cryptodev_builtin_job_run, job,
+                               cryptodev_builtin_job_done, job);
+        return 0;
     }
 
+    status = cryptodev_builtin_do_operation(sess, op_info, &local_error);
+
     if (local_error) {
         error_report_err(local_error);
     }
@@ -607,6 +685,20 @@ static void cryptodev_builtin_cleanup(
     cryptodev_backend_set_ready(backend, false);
 }
 
+static bool cryptodev_builtin_get_async(Object *obj, Error **errp)
+{
+    CryptoDevBackendBuiltin *builtin = CRYPTODEV_BACKEND_BUILTIN(obj);
+
+    return builtin->async;
+}
+
+static void cryptodev_builtin_set_async(Object *obj, bool value, Error **errp)
+{
+    CryptoDevBackendBuiltin *builtin = CRYPTODEV_BACKEND_BUILTIN(obj);
+
+    builtin->async = value;
+}
+
 static void
 cryptodev_builtin_class_init(ObjectClass *oc, const void *data)
 {
@@ -617,6 +709,12 @@ cryptodev_builtin_class_init(ObjectClass *oc, const void *data)
     bc->create_session = cryptodev_builtin_create_session;
     bc->close_session = cryptodev_builtin_close_session;
     bc->do_op = cryptodev_builtin_operation;
+
+    object_class_property_add_bool(oc, "async",
+                                   cryptodev_builtin_get_async,
+                                   cryptodev_builtin_set_async);
+    object_class_property_set_description(oc, "async",
+        "Run crypto operations in the thread pool");
 }
 
 static const TypeInfo cryptodev_builtin_info = {
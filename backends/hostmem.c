@@ -22,6 +22,7 @@
 #include "qemu/madvise.h"
 #include "qemu/cutils.h"
 #include "hw/qdev-core.h"
+#include "migration/cpr.h"
 
 #ifdef CONFIG_NUMA
 #include <numaif.h>
@@ -81,6 +82,64 @@ host_memory_backend_set_size(Object *obj, Visitor *v, const char *name,
     backend->size = value;
 }
 
+#ifdef CONFIG_NUMA
+static bool
+host_memory_backend_apply_policy(HostMemoryBackend *backend,
+                                 const unsigned long *host_nodes,
+                                 int policy, unsigned flags, Error **errp)
+{
+    void *ptr = memory_region_get_ram_ptr(&backend->mr);
+    uint64_t sz = memory_region_size(&backend->mr);
+    unsigned long lastbit = find_last_bit(host_nodes, MAX_NODES);
+    /* lastbit == MAX_NODES means maxnode = 0 */
+    unsigned long maxnode = (lastbit + 1) % (MAX_NODES + 1);
+    int mode = policy;
+
+    /* check for invalid host-nodes and policies and give more verbose
+     * error messages than mbind(). */
+    if (maxnode && policy == MPOL_DEFAULT) {
+        error_setg(errp, "host-nodes must be empty for policy default,"
+                   " or you should explicitly specify a policy other"
+                   " than default");
+        return false;
+    } else if (maxnode == 0 && policy != MPOL_DEFAULT) {
+        error_setg(errp, "host-nodes must be set for policy %s",
+                   HostMemPolicy_str(policy));
+        return false;
+    }
+
+    /*
+     * We can have up to MAX_NODES nodes, but we need to pass maxnode+1
+     * as argument to mbind() due to an old Linux bug (feature?) which
+     * cuts off the last specified node. This means backend->host_nodes
+     * must have MAX_NODES+1 bits available.
+     */
+    assert(sizeof(backend->host_nodes) >=
+           BITS_TO_LONGS(MAX_NODES + 1) * sizeof(unsigned long));
+    assert(maxnode <= MAX_NODES);
+
+#ifdef HAVE_NUMA_HAS_PREFERRED_MANY
+    if (mode == MPOL_PREFERRED && numa_has_preferred_many() > 0) {
+        /*
+         * Replace with MPOL_PREFERRED_MANY otherwise the mbind() below
+         * silently picks the first node.
+         */
+        mode = MPOL_PREFERRED_MANY;
+    }
+#endif
+
+    if (maxnode &&
+        mbind(ptr, sz, mode, host_nodes, maxnode + 1, flags)) {
+        if (policy != MPOL_DEFAULT || errno != ENOSYS) {
+            error_setg_errno(errp, errno,
+                             "cannot bind memory to host NUMA nodes");
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
 static void
 host_memory_backend_get_host_nodes(Object *obj, Visitor *v, const char *name,
                                    void *opaque, Error **errp)
@@ -128,6 +187,31 @@ host_memory_backend_set_host_nodes(Object *obj, Visitor *v, const char *name,
         }
     }
 
+    if (host_memory_backend_mr_inited(backend)) {
+        /*
+         * Rebind already allocated memory, migrating the pages that are
+         * populated to the new set of nodes.  This is best effort, pages
+         * that cannot be moved stay where they are.  With the default
+         * policy the nodes only take effect once a policy is set.
+         *
+         * mbind() moves the pages synchronously, so this blocks the main
+         * loop, and with it the vCPUs that need the BQL, for as long as
+         * copying the populated part of the backend takes.
+         */
+        DECLARE_BITMAP(nodes, MAX_NODES + 1);
+
+        bitmap_zero(nodes, MAX_NODES + 1);
+        for (l = host_nodes; l; l = l->next) {
+            bitmap_set(nodes, l->value, 1);
+        }
+        if (backend->policy == MPOL_DEFAULT ||
+            host_memory_backend_apply_policy(backend, nodes, backend->policy,
+                                             MPOL_MF_MOVE, errp)) {
+            bitmap_copy(backend->host_nodes, nodes, MAX_NODES + 1);
+        }
+        goto out;
+    }
+
     for (l = host_nodes; l; l = l->next) {
         bitmap_set(backend->host_nodes, l->value, 1);
     }
@@ -150,6 +234,28 @@ static void
 host_memory_backend_set_policy(Object *obj, int policy, Error **errp)
 {
     HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+#ifdef CONFIG_NUMA
+    if (host_memory_backend_mr_inited(backend) && policy != backend->policy) {
+        if (policy == MPOL_DEFAULT) {
+            /* Going back to the default policy drops the node binding */
+            void *ptr = memory_region_get_ram_ptr(&backend->mr);
+            uint64_t sz = memory_region_size(&backend->mr);
+
+            if (mbind(ptr, sz, MPOL_DEFAULT, NULL, 0, 0) && errno != ENOSYS) {
+                error_setg_errno(errp, errno,
+                                 "cannot reset host NUMA node binding");
+                return;
+            }
+            bitmap_zero(backend->host_nodes, MAX_NODES + 1);
+        } else if (!host_memory_backend_apply_policy(backend,
+                                                     backend->host_nodes,
+                                                     policy, MPOL_MF_MOVE,
+                                                     errp)) {
+            return;
+        }
+    }
+#endif
     backend->policy = policy;
 
 #ifndef CONFIG_NUMA
@@ -329,6 +435,17 @@ size_t host_memory_backend_pagesize(HostMemoryBackend *memdev)
     return pagesize;
 }
 
+/*
+ * When QEMU is restarted with CPR, shared guest memory is handed over with
+ * its contents: every page that the old QEMU preallocated and placed is
+ * still there.  Walking terabytes of it again for prealloc or for strict
+ * NUMA placement only lengthens the blackout.
+ */
+static bool host_memory_backend_is_preserved(HostMemoryBackend *backend)
+{
+    return backend->share && cpr_is_incoming();
+}
+
 static void
 host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
 {
@@ -364,59 +481,26 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
         qemu_madvise(ptr, sz, QEMU_MADV_DONTDUMP);
     }
 #ifdef CONFIG_NUMA
-    unsigned long lastbit = find_last_bit(backend->host_nodes, MAX_NODES);
-    /* lastbit == MAX_NODES means maxnode = 0 */
-    unsigned long maxnode = (lastbit + 1) % (MAX_NODES + 1);
     /*
      * Ensure policy won't be ignored in case memory is preallocated
      * before mbind(). note: MPOL_MF_STRICT is ignored on hugepages so
      * this doesn't catch hugepage case.
      */
     unsigned flags = MPOL_MF_STRICT | MPOL_MF_MOVE;
-    int mode = backend->policy;
 
-    /* check for invalid host-nodes and policies and give more verbose
-     * error messages than mbind(). */
-    if (maxnode && backend->policy == MPOL_DEFAULT) {
-        error_setg(errp, "host-nodes must be empty for policy default,"
-                   " or you should explicitly specify a policy other"
-                   " than default");
-        return;
-    } else if (maxnode == 0 && backend->policy != MPOL_DEFAULT) {
-        error_setg(errp, "host-nodes must be set for policy %s",
-                   HostMemPolicy_str(backend->policy));
-        return;
+    if (host_memory_backend_is_preserved(backend)) {
+        /* Only set the policy, the pages were placed by the old QEMU */
+        flags = 0;
     }
 
-    /*
-     * We can have up to MAX_NODES nodes, but we need to pass maxnode+1
-     * as argument to mbind() due to an old Linux bug (feature?) which
-     * cuts off the last specified node. This means backend->host_nodes
-     * must have MAX_NODES+1 bits available.
-     */
-    assert(sizeof(backend->host_nodes) >=
-           BITS_TO_LONGS(MAX_NODES + 1) * sizeof(unsigned long));
-    assert(maxnode <= MAX_NODES);
-
-#ifdef HAVE_NUMA_HAS_PREFERRED_MANY
-    if (mode == MPOL_PREFERRED && numa_has_preferred_many() > 0) {
-        /*
-         * Replace with MPOL_PREFERRED_MANY otherwise the mbind() below
-         * silently picks the first node.
-         */
-        mode = MPOL_PREFERRED_MANY;
+    if (!host_memory_backend_apply_policy(backend, backend->host_nodes,
+                                          backend->policy, flags, errp)) {
+        return;
     }
 #endif
-
-    if (maxnode &&
-        mbind(ptr, sz, mode, backend->host_nodes, maxnode + 1, flags)) {
-        if (backend->policy != MPOL_DEFAULT || errno != ENOSYS) {
-            error_setg_errno(errp, errno,
-                             "cannot bind memory to host NUMA nodes");
-            return;
-        }
+    if (host_memory_backend_is_preserved(backend)) {
+        return;
     }
-#endif
     /*
      * Preallocate memory after the NUMA policy has been instantiated.
      * This is necessary to guarantee memory is allocated with
@@ -68,9 +68,15 @@ void block_acct_setup(BlockAcctStats *stats, enum OnOffAuto account_invalid,
 void block_acct_cleanup(BlockAcctStats *stats)
 {
     BlockAcctTimedStats *s, *next;
+    unsigned i;
+
     QSLIST_FOREACH_SAFE(s, &stats->intervals, entries, next) {
         g_free(s);
     }
+    for (i = 0; i < BLOCK_MAX_IOTYPE; i++) {
+        g_free(stats->latency_percentiles[i]);
+    }
+    g_free(stats->queue_depth_percentiles);
     qemu_mutex_destroy(&stats->lock);
 }
 
@@ -110,6 +116,9 @@ void block_acct_start(BlockAcctStats *stats, BlockAcctCookie *cookie,
     cookie->bytes = bytes;
     cookie->start_time_ns = qemu_clock_get_ns(clock_type);
     cookie->type = type;
+    if (type != BLOCK_ACCT_NONE) {
+        cookie->queue_depth = qatomic_fetch_inc(&stats->in_flight) + 1;
+    }
 }
 
 /* block_latency_histogram_compare_func:
@@ -188,6 +197,44 @@ int block_latency_histogram_set(BlockAcctStats *stats, enum BlockAcctType type,
     return 0;
 }
 
+static void block_acct_record(HdrHistogram **h, uint64_t value)
+{
+    if (!*h) {
+        *h = g_new(HdrHistogram, 1);
+        hdr_histogram_init(*h);
+    }
+    hdr_histogram_record(*h, value);
+}
+
+/*
+ * Copy a snapshot of @src to @dst and return true, or return false if
+ * nothing was recorded yet.  Must be called with stats->lock held.
+ */
+static bool block_acct_snapshot(const HdrHistogram *src, HdrHistogram *dst)
+{
+    if (!src || !src->count) {
+        return false;
+    }
+    *dst = *src;
+    return true;
+}
+
+bool block_acct_latency_percentiles(BlockAcctStats *stats,
+                                    enum BlockAcctType type, HdrHistogram *h)
+{
+    assert(type < BLOCK_MAX_IOTYPE);
+
+    QEMU_LOCK_GUARD(&stats->lock);
+    return block_acct_snapshot(stats->latency_percentiles[type], h);
+}
+
+bool block_acct_queue_depth_percentiles(BlockAcctStats *stats,
+                                        HdrHistogram *h)
+{
+    QEMU_LOCK_GUARD(&stats->lock);
+    return block_acct_snapshot(stats->queue_depth_percentiles, h);
+}
+
 void block_latency_histograms_clear(BlockAcctStats *stats)
 {
     int i;
@@ -217,6 +264,8 @@ static void block_account_one_io(BlockAcctStats *stats, BlockAcctCookie *cookie,
         return;
     }
 
+    qatomic_dec(&stats->in_flight);
+
     WITH_QEMU_LOCK_GUARD(&stats->lock) {
         if (failed) {
             stats->failed_ops[cookie->type]++;
@@ -227,10 +276,13 @@ static void block_account_one_io(BlockAcctStats *stats, BlockAcctCookie *cookie,
 
         block_latency_histogram_account(&stats->latency_histogram[cookie->type],
                                         latency_ns);
+        block_acct_record(&stats->queue_depth_percentiles, cookie->queue_depth);
 
         if (!failed || stats->account_failed) {
             stats->total_time_ns[cookie->type] += latency_ns;
             stats->last_access_time_ns = time_ns;
+            block_acct_record(&stats->latency_percentiles[cookie->type],
+                              latency_ns);
 
             QSLIST_FOREACH(s, &stats->intervals, entries) {
                 timed_average_account(&s->latency[cookie->type], latency_ns);
@@ -251,6 +303,23 @@ void block_acct_failed(BlockAcctStats *stats, BlockAcctCookie *cookie)
     block_account_one_io(stats, cookie, true);
 }
 
+/*
+ * Drop a request started with block_acct_start() without accounting it, for
+ * requests that are cancelled or that will be started again after a
+ * rerror/werror=stop.  Does nothing if the request was already accounted.
+ */
+void block_acct_cancel(BlockAcctStats *stats, BlockAcctCookie *cookie)
+{
+    assert(cookie->type < BLOCK_MAX_IOTYPE);
+
+    if (cookie->type == BLOCK_ACCT_NONE) {
+        return;
+    }
+
+    qatomic_dec(&stats->in_flight);
+    cookie->type = BLOCK_ACCT_NONE;
+}
+
 void block_acct_invalid(BlockAcctStats *stats, enum BlockAcctType type)
 {
     assert(type < BLOCK_MAX_IOTYPE);
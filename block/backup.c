@@ -336,6 +336,22 @@ static bool backup_cancel(Job *job, bool force)
     return true;
 }
 
+static void backup_query(BlockJob *job, BlockJobInfo *info)
+{
+    BackupBlockJob *s = container_of(job, BackupBlockJob, common);
+    int64_t chunk;
+    int workers;
+
+    if (block_copy_get_auto_tune(s->bcs, &chunk, &workers)) {
+        info->u.backup = (BlockJobInfoBackup) {
+            .has_chunk_size = true,
+            .chunk_size = chunk,
+            .has_workers = true,
+            .workers = workers,
+        };
+    }
+}
+
 static const BlockJobDriver backup_job_driver = {
     .job_driver = {
         .instance_size          = sizeof(BackupBlockJob),
@@ -350,6 +366,7 @@ static const BlockJobDriver backup_job_driver = {
         .cancel                 = backup_cancel,
     },
     .set_speed = backup_set_speed,
+    .query = backup_query,
 };
 
 BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
@@ -494,8 +511,12 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
     job->perf = *perf;
 
     block_copy_set_copy_opts(bcs, perf->use_copy_range, compress);
+    if (perf->auto_tune) {
+        block_copy_set_auto_tune(bcs, perf->max_workers, perf->max_chunk);
+    }
     block_copy_set_progress_meter(bcs, &job->common.job.progress);
     block_copy_set_speed(bcs, speed);
+    block_copy_set_shared_ratelimit(bcs, block_job_total_ratelimit());
 
     /* Required permissions are taken by copy-before-write filter target */
     bdrv_graph_wrlock_drained();
@@ -2821,6 +2821,25 @@ int coroutine_fn blk_co_copy_range(BlockBackend *blk_in, int64_t off_in,
                               bytes, read_flags, write_flags);
 }
 
+int coroutine_fn blk_co_copy_range_from_child(BdrvChild *src, int64_t off_in,
+                                              BlockBackend *blk_out,
+                                              int64_t off_out, int64_t bytes,
+                                              BdrvRequestFlags read_flags,
+                                              BdrvRequestFlags write_flags)
+{
+    int r;
+    IO_CODE();
+    GRAPH_RDLOCK_GUARD();
+
+    r = blk_check_byte_request(blk_out, off_out, bytes);
+    if (r) {
+        return r;
+    }
+
+    return bdrv_co_copy_range(src, off_in, blk_out->root, off_out,
+                              bytes, read_flags, write_flags);
+}
+
 const BdrvChild *blk_root(BlockBackend *blk)
 {
     GLOBAL_STATE_CODE();
@@ -36,6 +36,22 @@
 #define BLOCK_COPY_SLICE_TIME 100000000ULL /* ns */
 #define BLOCK_COPY_CLUSTER_SIZE_DEFAULT (1 << 16)
 
+/*
+ * Auto-tuning: statistics are collected over windows of at least
+ * BLOCK_COPY_TUNE_WINDOW and BLOCK_COPY_TUNE_MIN_TASKS tasks.  A larger chunk
+ * is only kept if it improves throughput by BLOCK_COPY_TUNE_GAIN.  The number
+ * of workers is adjusted so that between BLOCK_COPY_TUNE_ALPHA and
+ * BLOCK_COPY_TUNE_BETA tasks are estimated to be queued in the target.
+ */
+#define BLOCK_COPY_TUNE_WINDOW 100000000ULL /* ns */
+#define BLOCK_COPY_TUNE_MIN_TASKS 4
+#define BLOCK_COPY_TUNE_INIT_WORKERS 8
+#define BLOCK_COPY_TUNE_MAX_CHUNK (16 * MiB)
+#define BLOCK_COPY_TUNE_GAIN 1.1
+#define BLOCK_COPY_TUNE_ALPHA 1.0
+#define BLOCK_COPY_TUNE_BETA 3.0
+#define BLOCK_COPY_TUNE_BASE_DECAY 1.02
+
 typedef enum {
     COPY_READ_WRITE_CLUSTER,
     COPY_READ_WRITE,
@@ -44,6 +60,44 @@ typedef enum {
     COPY_RANGE_FULL
 } BlockCopyMethod;
 
+typedef enum {
+    TUNE_CHUNK_UP,
+    TUNE_CHUNK_DOWN,
+    TUNE_WORKERS,
+} BlockCopyTunePhase;
+
+/*
+ * Runtime tuning of chunk size and number of workers, similar to TCP
+ * congestion control.  First the chunk size is probed upwards and then
+ * downwards from its default while throughput improves.  Then the number of
+ * workers is adjusted continuously, Vegas-style: comparing the latency per
+ * byte with the lowest one seen gives an estimate of the number of tasks that
+ * are only waiting in the target's queue.
+ */
+typedef struct BlockCopyTuning {
+    /* Fields initialized in block_copy_set_auto_tune() and never changed. */
+    bool enabled;
+    int max_workers;
+    int64_t max_chunk;
+    int64_t init_chunk;
+
+    /* Current limits.  Atomic, only changed with lock held. */
+    int chunk; /* at most BLOCK_COPY_TUNE_MAX_CHUNK */
+    int workers;
+
+    /* Fields protected by lock in BlockCopyState. */
+    BlockCopyTunePhase phase;
+    bool slow_start;
+    bool skip_window; /* tasks of the previous settings may still complete */
+    int64_t window_start;
+    int window_tasks;
+    int64_t window_bytes;
+    int64_t window_latency;
+    double best_rate; /* bytes per second, with @best_chunk */
+    int64_t best_chunk;
+    double base_lpb; /* lowest latency per byte, in ns */
+} BlockCopyTuning;
+
 static coroutine_fn int block_copy_task_entry(AioTask *task);
 
 typedef struct BlockCopyCallState {
@@ -160,6 +214,8 @@ typedef struct BlockCopyState {
     ProgressMeter *progress;
     SharedResource *mem;
     RateLimit rate_limit;
+    RateLimit *shared_limit; /* charged in addition to rate_limit if set */
+    BlockCopyTuning tune;
 } BlockCopyState;
 
 /* Called with lock held */
@@ -170,6 +226,9 @@ static int64_t block_copy_chunk_size(BlockCopyState *s)
         return s->cluster_size;
     case COPY_READ_WRITE:
     case COPY_RANGE_SMALL:
+        if (s->tune.enabled) {
+            return s->tune.chunk;
+        }
         return MIN(MAX(s->cluster_size, BLOCK_COPY_MAX_BUFFER),
                    s->max_transfer);
     case COPY_RANGE_FULL:
@@ -181,6 +240,149 @@ static int64_t block_copy_chunk_size(BlockCopyState *s)
     }
 }
 
+/* Called with lock held */
+static void block_copy_tune_set(BlockCopyState *s, int64_t chunk, int workers)
+{
+    BlockCopyTuning *t = &s->tune;
+
+    if (chunk != t->chunk || workers != t->workers) {
+        t->skip_window = true;
+    }
+    qatomic_set(&t->chunk, chunk);
+    qatomic_set(&t->workers, workers);
+}
+
+/*
+ * Try the next chunk size in the direction of the current phase, starting
+ * from the best one so far.  Called with lock held.
+ */
+static bool block_copy_tune_step_chunk(BlockCopyState *s)
+{
+    BlockCopyTuning *t = &s->tune;
+    int64_t next;
+
+    if (t->phase == TUNE_CHUNK_UP) {
+        next = t->best_chunk * 2;
+    } else {
+        next = QEMU_ALIGN_DOWN(t->best_chunk / 2, s->cluster_size);
+    }
+    if (next < s->cluster_size || next > t->max_chunk ||
+        next == t->best_chunk) {
+        return false;
+    }
+
+    block_copy_tune_set(s, next, t->workers);
+    return true;
+}
+
+/* Called with lock held */
+static void block_copy_tune_chunk(BlockCopyState *s, double rate)
+{
+    BlockCopyTuning *t = &s->tune;
+
+    if (rate > t->best_rate * BLOCK_COPY_TUNE_GAIN) {
+        t->best_rate = rate;
+        t->best_chunk = t->chunk;
+        if (block_copy_tune_step_chunk(s)) {
+            return;
+        }
+    }
+
+    /* Growing did not help at all, so try smaller chunks */
+    if (t->phase == TUNE_CHUNK_UP && t->best_chunk == t->init_chunk) {
+        t->phase = TUNE_CHUNK_DOWN;
+        if (block_copy_tune_step_chunk(s)) {
+            return;
+        }
+    }
+
+    t->phase = TUNE_WORKERS;
+    block_copy_tune_set(s, t->best_chunk, t->workers);
+}
+
+/* Called with lock held */
+static void block_copy_tune_workers(BlockCopyState *s, double lpb)
+{
+    BlockCopyTuning *t = &s->tune;
+    int workers = t->workers;
+    double queued;
+
+    /* Let the base slowly follow the target if it becomes slower */
+    if (!t->base_lpb || lpb < t->base_lpb) {
+        t->base_lpb = lpb;
+    } else {
+        t->base_lpb = MIN(t->base_lpb * BLOCK_COPY_TUNE_BASE_DECAY, lpb);
+    }
+
+    queued = workers * (1 - t->base_lpb / lpb);
+    if (queued < BLOCK_COPY_TUNE_ALPHA) {
+        workers = t->slow_start ? workers * 2 : workers + 1;
+    } else if (queued > BLOCK_COPY_TUNE_BETA) {
+        t->slow_start = false;
+        workers--;
+    } else {
+        t->slow_start = false;
+    }
+
+    block_copy_tune_set(s, t->chunk, MAX(MIN(workers, t->max_workers), 1));
+}
+
+/*
+ * Account a successfully copied task of @bytes that took @latency ns.
+ * Called with lock held.
+ */
+static void block_copy_tune_update(BlockCopyState *s, int64_t bytes,
+                                   int64_t latency)
+{
+    BlockCopyTuning *t = &s->tune;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    int64_t elapsed;
+    double rate, lpb;
+
+    if (!t->window_start) {
+        /* Don't count the time before the first copy */
+        t->window_start = now - latency;
+    }
+    elapsed = now - t->window_start;
+
+    t->window_tasks++;
+    t->window_bytes += bytes;
+    t->window_latency += latency;
+
+    if (elapsed < BLOCK_COPY_TUNE_WINDOW ||
+        t->window_tasks < BLOCK_COPY_TUNE_MIN_TASKS) {
+        return;
+    }
+
+    rate = (double)t->window_bytes * NANOSECONDS_PER_SECOND / elapsed;
+    lpb = (double)t->window_latency / t->window_bytes;
+
+    if (t->skip_window) {
+        t->skip_window = false;
+    } else if (t->phase == TUNE_WORKERS) {
+        block_copy_tune_workers(s, lpb);
+    } else {
+        block_copy_tune_chunk(s, rate);
+    }
+    trace_block_copy_tune(s, t->phase, rate, lpb * 1000, t->chunk, t->workers);
+
+    t->window_start = now;
+    t->window_tasks = 0;
+    t->window_bytes = 0;
+    t->window_latency = 0;
+}
+
+/* Number of parallel tasks for @call_state */
+static int block_copy_max_workers(BlockCopyCallState *call_state)
+{
+    BlockCopyState *s = call_state->s;
+
+    if (s->tune.enabled) {
+        return MIN(call_state->max_workers, qatomic_read(&s->tune.workers));
+    }
+    return call_state->max_workers;
+}
+
 /*
  * Search for the first dirty area in offset/bytes range and create task at
  * the beginning of it.
@@ -584,6 +786,7 @@ static coroutine_fn int block_copy_task_entry(AioTask *task)
     BlockCopyState *s = t->s;
     bool error_is_read = false;
     BlockCopyMethod method = t->method;
+    int64_t start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     int ret = -1;
 
     WITH_GRAPH_RDLOCK_GUARD() {
@@ -596,6 +799,14 @@ static coroutine_fn int block_copy_task_entry(AioTask *task)
             s->method = method;
         }
 
+        /* Zeroes and copy offloading say little about the data path */
+        if (s->tune.enabled && ret >= 0 &&
+            (method == COPY_READ_WRITE || method == COPY_READ_WRITE_CLUSTER)) {
+            block_copy_tune_update(s, t->req.bytes,
+                                   qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                                   start_ns);
+        }
+
         if (ret < 0) {
             if (!t->call_state->ret) {
                 t->call_state->ret = ret;
@@ -769,6 +980,7 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
            !qatomic_read(&call_state->cancelled)) {
         BlockCopyTask *task;
         int64_t status_bytes;
+        int workers;
 
         task = block_copy_task_create(s, call_state, offset, bytes);
         if (!task) {
@@ -803,6 +1015,9 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
 
         if (!call_state->ignore_ratelimit) {
             uint64_t ns = ratelimit_calculate_delay(&s->rate_limit, 0);
+            if (s->shared_limit) {
+                ns = MAX(ns, ratelimit_calculate_delay(s->shared_limit, 0));
+            }
             if (ns > 0) {
                 block_copy_task_end(task, -EAGAIN);
                 g_free(task);
@@ -813,6 +1028,9 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
         }
 
         ratelimit_calculate_delay(&s->rate_limit, task->req.bytes);
+        if (s->shared_limit && !call_state->ignore_ratelimit) {
+            ratelimit_calculate_delay(s->shared_limit, task->req.bytes);
+        }
 
         trace_block_copy_process(s, task->req.offset);
 
@@ -821,8 +1039,11 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
         offset = task_end(task);
         bytes = end - offset;
 
+        workers = block_copy_max_workers(call_state);
         if (!aio && bytes) {
-            aio = aio_task_pool_new(call_state->max_workers);
+            aio = aio_task_pool_new(workers);
+        } else if (aio) {
+            aio_task_pool_set_max_busy_tasks(aio, workers);
         }
 
         ret = block_copy_task_run(aio, task);
@@ -1057,11 +1278,55 @@ int64_t block_copy_cluster_size(BlockCopyState *s)
     return s->cluster_size;
 }
 
+void block_copy_set_auto_tune(BlockCopyState *s, int max_workers,
+                              int64_t max_chunk)
+{
+    BlockCopyTuning *t = &s->tune;
+    int64_t chunk;
+
+    assert(max_workers > 0);
+
+    max_chunk = MIN_NON_ZERO(max_chunk, BLOCK_COPY_TUNE_MAX_CHUNK);
+    max_chunk = QEMU_ALIGN_DOWN(MIN(max_chunk, s->max_transfer),
+                                s->cluster_size);
+    max_chunk = MAX(max_chunk, s->cluster_size);
+    chunk = MIN(MAX(s->cluster_size, BLOCK_COPY_MAX_BUFFER), max_chunk);
+
+    *t = (BlockCopyTuning) {
+        .enabled = true,
+        .max_workers = max_workers,
+        .max_chunk = max_chunk,
+        .init_chunk = chunk,
+        .chunk = chunk,
+        .workers = MIN(BLOCK_COPY_TUNE_INIT_WORKERS, max_workers),
+        .phase = TUNE_CHUNK_UP,
+        .slow_start = true,
+        .best_chunk = chunk,
+    };
+}
+
+bool block_copy_get_auto_tune(BlockCopyState *s, int64_t *chunk,
+                              int *workers)
+{
+    if (!s->tune.enabled) {
+        return false;
+    }
+
+    *chunk = qatomic_read(&s->tune.chunk);
+    *workers = qatomic_read(&s->tune.workers);
+    return true;
+}
+
 void block_copy_set_skip_unallocated(BlockCopyState *s, bool skip)
 {
     qatomic_set(&s->skip_unallocated, skip);
 }
 
+void block_copy_set_shared_ratelimit(BlockCopyState *s, RateLimit *limit)
+{
+    s->shared_limit = limit;
+}
+
 void block_copy_set_speed(BlockCopyState *s, uint64_t speed)
 {
     ratelimit_set_speed(&s->rate_limit, speed, BLOCK_COPY_SLICE_TIME);
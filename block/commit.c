@@ -15,6 +15,7 @@
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
 #include "trace.h"
+#include "block/aio_task.h"
 #include "block/block-common.h"
 #include "block/coroutines.h"
 #include "block/block_int.h"
@@ -31,8 +32,25 @@ enum {
      * contiguous regions of the image is efficient.
      */
     COMMIT_BUFFER_SIZE = 512 * 1024, /* in bytes */
+
+    /*
+     * Maximum length of an extent queried with a single block status call.
+     * Data extents are split into COMMIT_BUFFER_SIZE requests, zero extents
+     * are written in one go.
+     */
+    COMMIT_MAX_EXTENT = 16 * 1024 * 1024, /* in bytes */
+
+    /* Number of requests that may be in flight at the same time */
+    COMMIT_MAX_WORKERS = 8,
 };
 
+typedef struct CommitRetry {
+    int64_t offset;
+    int64_t bytes;
+    bool zero;
+    QSIMPLEQ_ENTRY(CommitRetry) next;
+} CommitRetry;
+
 typedef struct CommitBlockJob {
     BlockJob common;
     BlockDriverState *commit_top_bs;
@@ -45,6 +63,11 @@ typedef struct CommitBlockJob {
     bool chain_frozen;
     char *backing_file_str;
     bool backing_mask_protocol;
+
+    /* Requests that are in flight, only valid while commit_run() runs */
+    AioTaskPool *pool;
+    /* Failed requests that must be issued again */
+    QSIMPLEQ_HEAD(, CommitRetry) retry_list;
 } CommitBlockJob;
 
 static int commit_prepare(Job *job)
@@ -128,91 +151,99 @@ static void commit_clean(Job *job)
     blk_unref(s->top);
 }
 
-static int commit_iteration(CommitBlockJob *s, int64_t offset,
-                            int64_t *requested_bytes, void *buf)
+typedef struct CommitTask {
+    AioTask task;
+    CommitBlockJob *s;
+    int64_t offset;
+    int64_t bytes;
+    bool zero;
+} CommitTask;
+
+static int coroutine_fn commit_task_entry(AioTask *task)
 {
+    CommitTask *t = container_of(task, CommitTask, task);
+    CommitBlockJob *s = t->s;
     BlockErrorAction action;
-    int64_t bytes = *requested_bytes;
-    int ret = 0;
+    CommitRetry *retry;
     bool error_in_source = true;
+    int ret;
 
-    /* Copy if allocated above the base */
-    WITH_GRAPH_RDLOCK_GUARD() {
-        ret = bdrv_co_common_block_status_above(blk_bs(s->top),
-            s->base_overlay, true, true, offset, COMMIT_BUFFER_SIZE,
-            &bytes, NULL, NULL, NULL);
-    }
-
-    trace_commit_one_iteration(s, offset, bytes, ret);
-
-    if (ret < 0) {
-        goto fail;
-    }
-
-    if (ret & BDRV_BLOCK_ALLOCATED) {
-        if (ret & BDRV_BLOCK_ZERO) {
-            /*
-             * If the top (sub)clusters are smaller than the base
-             * (sub)clusters, this will not unmap unless the underlying device
-             * does some tracking of these requests. Ideally, we would find
-             * the maximal extent of the zero clusters.
-             */
-            ret = blk_co_pwrite_zeroes(s->base, offset, bytes,
-                                       BDRV_REQ_MAY_UNMAP);
-            if (ret < 0) {
-                error_in_source = false;
-                goto fail;
-            }
-        } else {
-            assert(bytes < SIZE_MAX);
-
-            ret = blk_co_pread(s->top, offset, bytes, buf, 0);
-            if (ret < 0) {
-                goto fail;
-            }
-
-            ret = blk_co_pwrite(s->base, offset, bytes, buf, 0);
-            if (ret < 0) {
-                error_in_source = false;
-                goto fail;
-            }
-        }
-
+    if (t->zero) {
         /*
-         * Whether zeroes actually end up on disk depends on the details of
-         * the underlying driver. Therefore, this might rate limit more than
-         * is necessary.
+         * If the top (sub)clusters are smaller than the base (sub)clusters,
+         * this will not unmap unless the underlying device does some tracking
+         * of these requests. Ideally, we would find the maximal extent of the
+         * zero clusters.
          */
-        block_job_ratelimit_processed_bytes(&s->common, bytes);
+        ret = blk_co_pwrite_zeroes(s->base, t->offset, t->bytes,
+                                   BDRV_REQ_MAY_UNMAP);
+        error_in_source = false;
+    } else {
+        QEMU_AUTO_VFREE void *buf = blk_blockalign(s->top, t->bytes);
+
+        assert(t->bytes < SIZE_MAX);
+
+        ret = blk_co_pread(s->top, t->offset, t->bytes, buf, 0);
+        if (ret >= 0) {
+            ret = blk_co_pwrite(s->base, t->offset, t->bytes, buf, 0);
+            error_in_source = false;
+        }
     }
 
-    /* Publish progress */
-
-    job_progress_update(&s->common.job, bytes);
-
-    *requested_bytes = bytes;
-
-    return 0;
+    if (ret >= 0) {
+        /* Publish progress */
+        job_progress_update(&s->common.job, t->bytes);
+        return 0;
+    }
 
-fail:
     action = block_job_error_action(&s->common, s->on_error,
                                     error_in_source, -ret);
     if (action == BLOCK_ERROR_ACTION_REPORT) {
         return ret;
     }
 
-    *requested_bytes = 0;
+    /* Let commit_run() issue the request again once the job is resumed */
+    retry = g_new(CommitRetry, 1);
+    *retry = (CommitRetry) {
+        .offset = t->offset,
+        .bytes  = t->bytes,
+        .zero   = t->zero,
+    };
+    QSIMPLEQ_INSERT_TAIL(&s->retry_list, retry, next);
 
     return 0;
 }
 
+static void coroutine_fn commit_start_task(CommitBlockJob *s, int64_t offset,
+                                           int64_t bytes, bool zero)
+{
+    CommitTask *t = g_new(CommitTask, 1);
+
+    *t = (CommitTask) {
+        .task.func = commit_task_entry,
+        .s         = s,
+        .offset    = offset,
+        .bytes     = bytes,
+        .zero      = zero,
+    };
+
+    /*
+     * Whether zeroes actually end up on disk depends on the details of
+     * the underlying driver. Therefore, this might rate limit more than
+     * is necessary.
+     */
+    block_job_ratelimit_processed_bytes(&s->common, bytes);
+
+    aio_task_pool_start_task(s->pool, &t->task);
+}
+
 static int coroutine_fn commit_run(Job *job, Error **errp)
 {
     CommitBlockJob *s = container_of(job, CommitBlockJob, common.job);
-    int64_t offset;
+    int64_t offset = 0;
     int ret = 0;
-    int64_t n = 0; /* bytes */
-    QEMU_AUTO_VFREE void *buf = NULL;
+    int64_t extent_bytes = 0;
+    int extent_status = 0;
     int64_t len, base_len;
 
     len = blk_co_getlength(s->top);
@@ -233,25 +264,111 @@ static int coroutine_fn commit_run(Job *job, Error **errp)
         }
     }
 
-    buf = blk_blockalign(s->top, COMMIT_BUFFER_SIZE);
+    QSIMPLEQ_INIT(&s->retry_list);
+    s->pool = aio_task_pool_new(COMMIT_MAX_WORKERS);
+
+    for (;;) {
+        CommitRetry *retry;
+        int64_t n;
 
-    for (offset = 0; offset < len; offset += n) {
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
+         * commit_pause() takes care of the requests that are in flight.
          */
         block_job_ratelimit_sleep(&s->common);
         if (job_is_cancelled(&s->common.job)) {
             break;
         }
 
-        ret = commit_iteration(s, offset, &n, buf);
-
+        ret = aio_task_pool_status(s->pool);
         if (ret < 0) {
-            return ret;
+            break;
         }
+
+        retry = QSIMPLEQ_FIRST(&s->retry_list);
+        if (retry) {
+            QSIMPLEQ_REMOVE_HEAD(&s->retry_list, next);
+            commit_start_task(s, retry->offset, retry->bytes, retry->zero);
+            g_free(retry);
+            continue;
+        }
+
+        if (extent_bytes == 0) {
+            if (offset >= len) {
+                /* Failed requests may still be queued for another attempt */
+                aio_task_pool_wait_all(s->pool);
+                if (QSIMPLEQ_EMPTY(&s->retry_list)) {
+                    break;
+                }
+                continue;
+            }
+
+            /* Copy if allocated above the base */
+            WITH_GRAPH_RDLOCK_GUARD() {
+                extent_status = bdrv_co_common_block_status_above(
+                    blk_bs(s->top), s->base_overlay, true, true, offset,
+                    MIN(len - offset, COMMIT_MAX_EXTENT), &extent_bytes,
+                    NULL, NULL, NULL);
+            }
+
+            trace_commit_one_iteration(s, offset, extent_bytes, extent_status);
+
+            if (extent_status < 0) {
+                BlockErrorAction action =
+                    block_job_error_action(&s->common, s->on_error, true,
+                                           -extent_status);
+                extent_bytes = 0;
+                if (action == BLOCK_ERROR_ACTION_REPORT) {
+                    ret = extent_status;
+                    break;
+                }
+                continue;
+            }
+
+            if (!(extent_status & BDRV_BLOCK_ALLOCATED)) {
+                /* Nothing to copy, but publish progress */
+                job_progress_update(&s->common.job, extent_bytes);
+                offset += extent_bytes;
+                extent_bytes = 0;
+                continue;
+            }
+        }
+
+        if (extent_status & BDRV_BLOCK_ZERO) {
+            n = extent_bytes;
+            commit_start_task(s, offset, n, true);
+        } else {
+            n = MIN(extent_bytes, COMMIT_BUFFER_SIZE);
+            commit_start_task(s, offset, n, false);
+        }
+
+        offset += n;
+        extent_bytes -= n;
     }
 
-    return 0;
+    aio_task_pool_wait_all(s->pool);
+    if (ret == 0) {
+        ret = aio_task_pool_status(s->pool);
+    }
+    aio_task_pool_free(s->pool);
+    s->pool = NULL;
+
+    while (!QSIMPLEQ_EMPTY(&s->retry_list)) {
+        CommitRetry *retry = QSIMPLEQ_FIRST(&s->retry_list);
+        QSIMPLEQ_REMOVE_HEAD(&s->retry_list, next);
+        g_free(retry);
+    }
+
+    return ret;
+}
+
+static void coroutine_fn commit_pause(Job *job)
+{
+    CommitBlockJob *s = container_of(job, CommitBlockJob, common.job);
+
+    if (s->pool) {
+        aio_task_pool_wait_all(s->pool);
+    }
 }
 
 static const BlockJobDriver commit_job_driver = {
@@ -261,6 +378,7 @@ static const BlockJobDriver commit_job_driver = {
         .free          = block_job_free,
         .user_resume   = block_job_user_resume,
         .run           = commit_run,
+        .pause         = commit_pause,
         .prepare       = commit_prepare,
         .abort         = commit_abort,
         .clean         = commit_clean
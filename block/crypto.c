@@ -22,6 +22,7 @@
 
 #include "block/block_int.h"
 #include "block/qdict.h"
+#include "block/thread-pool.h"
 #include "system/block-backend.h"
 #include "crypto/block.h"
 #include "qapi/opts-visitor.h"
@@ -466,6 +467,56 @@ static int block_crypto_reopen_prepare(BDRVReopenState *state,
  */
 #define BLOCK_CRYPTO_MAX_IO_SIZE (1024 * 1024)
 
+/*
+ * Chunks at least this large are encrypted and decrypted in the thread
+ * pool, so that they neither block the AioContext nor serialize with
+ * the other requests on the same node.  Smaller ones are cheaper to
+ * process inline than to hand off.
+ */
+#define BLOCK_CRYPTO_THREAD_MIN_SIZE (64 * 1024)
+
+/*
+ * BlockCryptoEncDecFunc: common prototype of qcrypto_block_encrypt() and
+ * qcrypto_block_decrypt() functions.
+ */
+typedef int (*BlockCryptoEncDecFunc)(QCryptoBlock *block, uint64_t offset,
+                                     uint8_t *buf, size_t len, Error **errp);
+
+typedef struct BlockCryptoEncDecData {
+    QCryptoBlock *block;
+    uint64_t offset;
+    uint8_t *buf;
+    size_t len;
+
+    BlockCryptoEncDecFunc func;
+} BlockCryptoEncDecData;
+
+static int block_crypto_encdec_pool_func(void *opaque)
+{
+    BlockCryptoEncDecData *data = opaque;
+
+    return data->func(data->block, data->offset, data->buf, data->len, NULL);
+}
+
+static int coroutine_fn
+block_crypto_co_encdec(BlockCrypto *crypto, uint64_t offset,
+                       uint8_t *buf, size_t len, BlockCryptoEncDecFunc func)
+{
+    BlockCryptoEncDecData arg = {
+        .block = crypto->block,
+        .offset = offset,
+        .buf = buf,
+        .len = len,
+        .func = func,
+    };
+
+    if (len < BLOCK_CRYPTO_THREAD_MIN_SIZE) {
+        return block_crypto_encdec_pool_func(&arg);
+    }
+
+    return thread_pool_submit_co(block_crypto_encdec_pool_func, &arg);
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 block_crypto_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
                        QEMUIOVector *qiov, BdrvRequestFlags flags)
@@ -508,8 +559,9 @@ block_crypto_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
             goto cleanup;
         }
 
-        if (qcrypto_block_decrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
+        if (block_crypto_co_encdec(crypto, offset + bytes_done,
+                                   cipher_data, cur_bytes,
+                                   qcrypto_block_decrypt) < 0) {
             ret = -EIO;
             goto cleanup;
         }
@@ -565,8 +617,9 @@ block_crypto_co_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
 
         qemu_iovec_to_buf(qiov, bytes_done, cipher_data, cur_bytes);
 
-        if (qcrypto_block_encrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
+        if (block_crypto_co_encdec(crypto, offset + bytes_done,
+                                   cipher_data, cur_bytes,
+                                   qcrypto_block_encrypt) < 0) {
             ret = -EIO;
             goto cleanup;
         }
@@ -54,6 +54,7 @@
 
 #define CURL_BLOCK_OPT_URL       "url"
 #define CURL_BLOCK_OPT_READAHEAD "readahead"
+#define CURL_BLOCK_OPT_READAHEAD_MAX "readahead-max"
 #define CURL_BLOCK_OPT_SSLVERIFY "sslverify"
 #define CURL_BLOCK_OPT_TIMEOUT "timeout"
 #define CURL_BLOCK_OPT_COOKIE    "cookie"
@@ -64,6 +65,7 @@
 #define CURL_BLOCK_OPT_PROXY_PASSWORD_SECRET "proxy-password-secret"
 
 #define CURL_BLOCK_OPT_READAHEAD_DEFAULT (256 * 1024)
+#define CURL_BLOCK_OPT_READAHEAD_MAX_DEFAULT (4 * 1024 * 1024)
 #define CURL_BLOCK_OPT_SSLVERIFY_DEFAULT true
 #define CURL_BLOCK_OPT_TIMEOUT_DEFAULT 5
 
@@ -101,6 +103,7 @@ typedef struct CURLState
     char range[128];
     char errmsg[CURL_ERROR_SIZE];
     char in_use;
+    uint64_t last_used; /* value of BDRVCURLState.use_clock at last use */
 } CURLState;
 
 typedef struct BDRVCURLState {
@@ -111,6 +114,14 @@ typedef struct BDRVCURLState {
     GHashTable *sockets; /* GINT_TO_POINTER(fd) -> socket */
     char *url;
     size_t readahead_size;
+    size_t readahead_max;
+    /*
+     * Current readahead window.  It starts at readahead_size and doubles up
+     * to readahead_max for every request that continues a sequential stream.
+     */
+    size_t readahead_window;
+    uint64_t seq_offset; /* end of the last request */
+    uint64_t use_clock;
     bool sslverify;
     uint64_t timeout;
     char *cookie;
@@ -284,6 +295,7 @@ static bool curl_find_buf(BDRVCURLState *s, uint64_t start, uint64_t len,
         {
             char *buf = state->orig_buf + (start - state->buf_start);
 
+            state->last_used = ++s->use_clock;
             qemu_iovec_from_buf(acb->qiov, 0, buf, clamped_len);
             if (clamped_len < len) {
                 qemu_iovec_memset(acb->qiov, clamped_len, 0, len - clamped_len);
@@ -307,6 +319,7 @@ static bool curl_find_buf(BDRVCURLState *s, uint64_t start, uint64_t len,
             for (j=0; j<CURL_NUM_ACB; j++) {
                 if (!state->acb[j]) {
                     state->acb[j] = acb;
+                    state->last_used = ++s->use_clock;
                     return true;
                 }
             }
@@ -431,22 +444,48 @@ static void curl_multi_timeout_do(void *arg)
     qemu_mutex_unlock(&s->mutex);
 }
 
-/* Called with s->mutex held.  */
-static CURLState *curl_find_state(BDRVCURLState *s)
+/*
+ * Return a free state, preferring the one whose buffer was used least
+ * recently so that readahead data that was not consumed yet is kept as long
+ * as possible.  Leave at least @reserve states free.
+ *
+ * Called with s->mutex held.
+ */
+static CURLState *curl_find_state_reserve(BDRVCURLState *s, int reserve)
 {
     CURLState *state = NULL;
+    int nfree = 0;
     int i;
 
     for (i = 0; i < CURL_NUM_STATES; i++) {
-        if (!s->states[i].in_use) {
-            state = &s->states[i];
-            state->in_use = 1;
-            break;
+        CURLState *candidate = &s->states[i];
+
+        if (candidate->in_use) {
+            continue;
+        }
+        nfree++;
+        if (!state) {
+            state = candidate;
+        } else if (state->orig_buf &&
+                   (!candidate->orig_buf ||
+                    candidate->last_used < state->last_used)) {
+            state = candidate;
         }
     }
+
+    if (!state || nfree <= reserve) {
+        return NULL;
+    }
+    state->in_use = 1;
     return state;
 }
 
+/* Called with s->mutex held.  */
+static CURLState *curl_find_state(BDRVCURLState *s)
+{
+    return curl_find_state_reserve(s, 0);
+}
+
 static int curl_init_state(BDRVCURLState *s, CURLState *state)
 {
     if (!state->curl) {
@@ -478,6 +517,15 @@ static int curl_init_state(BDRVCURLState *s, CURLState *state)
             curl_easy_setopt(state->curl, CURLOPT_FAILONERROR, 1)) {
             goto err;
         }
+#if LIBCURL_VERSION_NUM >= 0x072b00
+        /*
+         * Prefer waiting for an HTTP/2 connection that can be multiplexed
+         * over opening a new connection for each parallel range request.
+         */
+        if (curl_easy_setopt(state->curl, CURLOPT_PIPEWAIT, 1L)) {
+            goto err;
+        }
+#endif
         if (s->username) {
             if (curl_easy_setopt(state->curl, CURLOPT_USERNAME, s->username)) {
                 goto err;
@@ -605,6 +653,9 @@ static void curl_attach_aio_context(BlockDriverState *bs,
     curl_multi_setopt(s->multi, CURLMOPT_SOCKETFUNCTION, curl_sock_cb);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERDATA, s);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERFUNCTION, curl_timer_cb);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    curl_multi_setopt(s->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 }
 
 static QemuOptsList runtime_opts = {
@@ -621,6 +672,11 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_SIZE,
             .help = "Readahead size",
         },
+        {
+            .name = CURL_BLOCK_OPT_READAHEAD_MAX,
+            .type = QEMU_OPT_SIZE,
+            .help = "Maximum readahead size for sequential reads",
+        },
         {
             .name = CURL_BLOCK_OPT_SSLVERIFY,
             .type = QEMU_OPT_BOOL,
@@ -716,6 +772,21 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
         goto out_noclean;
     }
 
+    s->readahead_max = qemu_opt_get_size(opts, CURL_BLOCK_OPT_READAHEAD_MAX,
+                                         MAX(s->readahead_size,
+                                         CURL_BLOCK_OPT_READAHEAD_MAX_DEFAULT));
+    if ((s->readahead_max & 0x1ff) != 0) {
+        error_setg(errp, "readahead-max %zd is not a multiple of 512",
+                   s->readahead_max);
+        goto out_noclean;
+    }
+    if (s->readahead_max < s->readahead_size) {
+        error_setg(errp, "readahead-max %zd is smaller than readahead %zd",
+                   s->readahead_max, s->readahead_size);
+        goto out_noclean;
+    }
+    s->readahead_window = s->readahead_size;
+
     s->timeout = qemu_opt_get_number(opts, CURL_BLOCK_OPT_TIMEOUT,
                                      CURL_BLOCK_OPT_TIMEOUT_DEFAULT);
     if (s->timeout > CURL_TIMEOUT_MAX) {
@@ -868,22 +939,136 @@ out_noclean:
     return -EINVAL;
 }
 
+/*
+ * Grow the readahead window for requests that continue a sequential stream,
+ * and shrink it back to the configured readahead size otherwise.
+ *
+ * Called with s->mutex held.
+ */
+static void curl_update_readahead(BDRVCURLState *s, uint64_t start,
+                                  uint64_t bytes)
+{
+    if (start == s->seq_offset) {
+        s->readahead_window = MIN(s->readahead_window * 2, s->readahead_max);
+    } else {
+        s->readahead_window = s->readahead_size;
+    }
+    s->seq_offset = start + bytes;
+}
+
+/*
+ * Return the state whose buffer holds, or is being filled with, the data at
+ * @offset, or NULL if there is none.
+ *
+ * Called with s->mutex held.
+ */
+static CURLState *curl_find_buf_state(BDRVCURLState *s, uint64_t offset)
+{
+    int i;
+
+    for (i = 0; i < CURL_NUM_STATES; i++) {
+        CURLState *state = &s->states[i];
+        size_t len = state->in_use ? state->buf_len : state->buf_off;
+
+        if (state->orig_buf &&
+            offset >= state->buf_start && offset - state->buf_start < len) {
+            return state;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Start fetching @len bytes at @start into the buffer of @state, which must
+ * have been initialized with curl_init_state().
+ *
+ * Called with s->mutex held.
+ */
+static int curl_start_transfer(BDRVCURLState *s, CURLState *state,
+                               uint64_t start, uint64_t len)
+{
+    uint64_t end = start + len - 1;
+
+    state->buf_off = 0;
+    g_free(state->orig_buf);
+    state->buf_start = start;
+    state->buf_len = len;
+    state->orig_buf = g_try_malloc(state->buf_len);
+    if (state->buf_len && state->orig_buf == NULL) {
+        return -ENOMEM;
+    }
+    state->last_used = ++s->use_clock;
+
+    snprintf(state->range, 127, "%" PRIu64 "-%" PRIu64, start, end);
+    if (curl_easy_setopt(state->curl, CURLOPT_RANGE, state->range) ||
+        curl_multi_add_handle(s->multi, state->curl) != CURLM_OK) {
+        return -EIO;
+    }
+    return 0;
+}
+
+/*
+ * Once a sequential stream has been detected, keep the next readahead window
+ * in flight in parallel with the one that serves the current request, so that
+ * the stream does not stall waiting for a round trip at each buffer boundary.
+ * With HTTP/2 both transfers share a single multiplexed connection.
+ *
+ * @offset is the first byte after the current request.
+ *
+ * Called with s->mutex held.
+ */
+static void curl_readahead(BDRVCURLState *s, uint64_t offset)
+{
+    CURLState *state;
+    uint64_t start;
+
+    if (s->readahead_window <= s->readahead_size) {
+        return;
+    }
+
+    state = curl_find_buf_state(s, offset);
+    if (!state) {
+        return;
+    }
+    start = state->buf_start + state->buf_len;
+    if (start >= s->len || curl_find_buf_state(s, start)) {
+        return;
+    }
+
+    /* Never take the last free state away from guest requests */
+    state = curl_find_state_reserve(s, 1);
+    if (!state) {
+        return;
+    }
+
+    if (curl_init_state(s, state) < 0 ||
+        curl_start_transfer(s, state, start,
+                            MIN(s->readahead_window, s->len - start)) < 0) {
+        curl_clean_state(state);
+        return;
+    }
+    trace_curl_readahead(start, state->range);
+}
+
 static void coroutine_fn curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
 {
     CURLState *state;
     int running;
+    int ret;
 
     BDRVCURLState *s = bs->opaque;
 
     uint64_t start = acb->offset;
-    uint64_t end;
 
     qemu_mutex_lock(&s->mutex);
 
+    curl_update_readahead(s, start, acb->bytes);
+
     // In case we have the requested data already (e.g. read-ahead),
     // we can just call the callback and be done.
     if (curl_find_buf(s, start, acb->bytes, acb)) {
-        goto out;
+        curl_readahead(s, start + acb->bytes);
+        goto kick;
     }
 
     // No cache found, so let's start a new request
@@ -904,30 +1089,22 @@ static void coroutine_fn curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
     acb->start = 0;
     acb->end = MIN(acb->bytes, s->len - start);
 
-    state->buf_off = 0;
-    g_free(state->orig_buf);
-    state->buf_start = start;
-    state->buf_len = MIN(acb->end + s->readahead_size, s->len - start);
-    end = start + state->buf_len - 1;
-    state->orig_buf = g_try_malloc(state->buf_len);
-    if (state->buf_len && state->orig_buf == NULL) {
-        curl_clean_state(state);
-        acb->ret = -ENOMEM;
-        goto out;
-    }
     state->acb[0] = acb;
-
-    snprintf(state->range, 127, "%" PRIu64 "-%" PRIu64, start, end);
-    trace_curl_setup_preadv(acb->bytes, start, state->range);
-    if (curl_easy_setopt(state->curl, CURLOPT_RANGE, state->range) ||
-        curl_multi_add_handle(s->multi, state->curl) != CURLM_OK) {
+    ret = curl_start_transfer(s, state, start,
+                              MIN(acb->end + s->readahead_window,
+                                  s->len - start));
+    if (ret < 0) {
         state->acb[0] = NULL;
-        acb->ret = -EIO;
+        acb->ret = ret;
 
         curl_clean_state(state);
         goto out;
     }
+    trace_curl_setup_preadv(acb->bytes, start, state->range);
+
+    curl_readahead(s, start + acb->bytes);
 
+kick:
     /* Tell curl it needs to kick things off */
     curl_multi_socket_action(s->multi, CURL_SOCKET_TIMEOUT, 0, &running);
 
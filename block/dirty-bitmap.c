@@ -33,6 +33,7 @@
 struct BdrvDirtyBitmap {
     BlockDriverState *bs;
     HBitmap *bitmap;            /* Dirty bitmap implementation */
+    HBitmap *meta;              /* Tracks changes to bitmap, if any */
     bool busy;                  /* Bitmap is busy, it can't be used via QMP */
     BdrvDirtyBitmap *successor; /* Anonymous child, if any. */
     char *name;                 /* Optional non-empty unique ID */
@@ -95,11 +96,19 @@ BdrvDirtyBitmap *bdrv_find_dirty_bitmap(BlockDriverState *bs, const char *name)
     return NULL;
 }
 
+static HBitmap *bdrv_dirty_bitmap_alloc_hbitmap(uint64_t size, int granularity,
+                                                bool compressed)
+{
+    return compressed ? hbitmap_alloc_compressed(size, granularity)
+                      : hbitmap_alloc(size, granularity);
+}
+
 /* Called with BQL taken.  */
-BdrvDirtyBitmap *bdrv_create_dirty_bitmap(BlockDriverState *bs,
-                                          uint32_t granularity,
-                                          const char *name,
-                                          Error **errp)
+static BdrvDirtyBitmap *bdrv_do_create_dirty_bitmap(BlockDriverState *bs,
+                                                    uint32_t granularity,
+                                                    const char *name,
+                                                    bool compressed,
+                                                    Error **errp)
 {
     int64_t bitmap_size;
     BdrvDirtyBitmap *bitmap;
@@ -124,7 +133,9 @@ BdrvDirtyBitmap *bdrv_create_dirty_bitmap(BlockDriverState *bs,
     }
     bitmap = g_new0(BdrvDirtyBitmap, 1);
     bitmap->bs = bs;
-    bitmap->bitmap = hbitmap_alloc(bitmap_size, ctz32(granularity));
+    bitmap->bitmap = bdrv_dirty_bitmap_alloc_hbitmap(bitmap_size,
+                                                     ctz32(granularity),
+                                                     compressed);
     bitmap->size = bitmap_size;
     bitmap->name = g_strdup(name);
     bitmap->disabled = false;
@@ -134,6 +145,28 @@ BdrvDirtyBitmap *bdrv_create_dirty_bitmap(BlockDriverState *bs,
     return bitmap;
 }
 
+/* Called with BQL taken.  */
+BdrvDirtyBitmap *bdrv_create_dirty_bitmap(BlockDriverState *bs,
+                                          uint32_t granularity,
+                                          const char *name,
+                                          Error **errp)
+{
+    return bdrv_do_create_dirty_bitmap(bs, granularity, name, false, errp);
+}
+
+/*
+ * Like bdrv_create_dirty_bitmap(), but store the bitmap in the compressed
+ * representation of hbitmap_alloc_compressed().
+ * Called with BQL taken.
+ */
+BdrvDirtyBitmap *bdrv_create_compressed_dirty_bitmap(BlockDriverState *bs,
+                                                     uint32_t granularity,
+                                                     const char *name,
+                                                     Error **errp)
+{
+    return bdrv_do_create_dirty_bitmap(bs, granularity, name, true, errp);
+}
+
 int64_t bdrv_dirty_bitmap_size(const BdrvDirtyBitmap *bitmap)
 {
     return bitmap->size;
@@ -224,7 +257,9 @@ int bdrv_dirty_bitmap_create_successor(BdrvDirtyBitmap *bitmap, Error **errp)
 
     /* Create an anonymous successor */
     granularity = bdrv_dirty_bitmap_granularity(bitmap);
-    child = bdrv_create_dirty_bitmap(bitmap->bs, granularity, NULL, errp);
+    child = bdrv_do_create_dirty_bitmap(bitmap->bs, granularity, NULL,
+                                        hbitmap_is_compressed(bitmap->bitmap),
+                                        errp);
     if (!child) {
         return -1;
     }
@@ -260,6 +295,9 @@ static void bdrv_release_dirty_bitmap_locked(BdrvDirtyBitmap *bitmap)
     assert(!bdrv_dirty_bitmap_busy(bitmap));
     assert(!bdrv_dirty_bitmap_has_successor(bitmap));
     QLIST_REMOVE(bitmap, list);
+    if (bitmap->meta) {
+        hbitmap_free_meta(bitmap->bitmap);
+    }
     hbitmap_free(bitmap->bitmap);
     g_free(bitmap->name);
     g_free(bitmap);
@@ -467,6 +505,8 @@ BlockDirtyInfoList *bdrv_query_dirty_bitmaps(BlockDriverState *bs)
         info->persistent = bm->persistent;
         info->has_inconsistent = bm->inconsistent;
         info->inconsistent = bm->inconsistent;
+        info->has_compressed = bdrv_dirty_bitmap_compressed(bm);
+        info->compressed = info->has_compressed;
         QAPI_LIST_APPEND(tail, info);
     }
     bdrv_dirty_bitmaps_unlock(bs);
@@ -571,6 +611,26 @@ void bdrv_reset_dirty_bitmap(BdrvDirtyBitmap *bitmap,
     bdrv_dirty_bitmaps_unlock(bitmap->bs);
 }
 
+/*
+ * Move the meta bitmap of @bitmap, if any, from @from to @to, which is
+ * about to replace @from as the underlying HBitmap.  The contents may be
+ * arbitrarily different, so everything is marked as changed.
+ */
+static void bdrv_dirty_bitmap_move_meta(BdrvDirtyBitmap *bitmap,
+                                        HBitmap *from, HBitmap *to)
+{
+    int chunk_bits;
+
+    if (!bitmap->meta) {
+        return;
+    }
+
+    chunk_bits = hbitmap_granularity(bitmap->meta) - hbitmap_granularity(from);
+    hbitmap_free_meta(from);
+    bitmap->meta = hbitmap_create_meta(to, 1 << chunk_bits);
+    hbitmap_set(bitmap->meta, 0, bitmap->size);
+}
+
 void bdrv_clear_dirty_bitmap(BdrvDirtyBitmap *bitmap, HBitmap **out)
 {
     IO_CODE();
@@ -580,8 +640,11 @@ void bdrv_clear_dirty_bitmap(BdrvDirtyBitmap *bitmap, HBitmap **out)
         hbitmap_reset_all(bitmap->bitmap);
     } else {
         HBitmap *backup = bitmap->bitmap;
-        bitmap->bitmap = hbitmap_alloc(bitmap->size,
-                                       hbitmap_granularity(backup));
+        bitmap->bitmap =
+            bdrv_dirty_bitmap_alloc_hbitmap(bitmap->size,
+                                            hbitmap_granularity(backup),
+                                            hbitmap_is_compressed(backup));
+        bdrv_dirty_bitmap_move_meta(bitmap, backup, bitmap->bitmap);
         *out = backup;
     }
     bdrv_dirty_bitmaps_unlock(bitmap->bs);
@@ -593,6 +656,7 @@ void bdrv_restore_dirty_bitmap(BdrvDirtyBitmap *bitmap, HBitmap *backup)
     assert(!bdrv_dirty_bitmap_readonly(bitmap));
     GLOBAL_STATE_CODE();
     bitmap->bitmap = backup;
+    bdrv_dirty_bitmap_move_meta(bitmap, tmp, backup);
     hbitmap_free(tmp);
 }
 
@@ -732,6 +796,80 @@ void bdrv_dirty_bitmap_set_persistence(BdrvDirtyBitmap *bitmap, bool persistent)
     bdrv_dirty_bitmaps_unlock(bitmap->bs);
 }
 
+/*
+ * Start tracking which parts of @bitmap change.  Each bit of the meta bitmap
+ * covers @chunk_size bytes, which must be a power of two and a multiple of
+ * the granularity.  Tracking starts from a clean state.
+ * Called with BQL taken.
+ */
+void bdrv_dirty_bitmap_create_meta(BdrvDirtyBitmap *bitmap,
+                                   uint64_t chunk_size)
+{
+    uint32_t granularity = bdrv_dirty_bitmap_granularity(bitmap);
+
+    assert(is_power_of_2(chunk_size) && chunk_size >= granularity);
+    assert(chunk_size / granularity <= INT_MAX);
+
+    bdrv_dirty_bitmaps_lock(bitmap->bs);
+    if (bitmap->meta) {
+        hbitmap_free_meta(bitmap->bitmap);
+    }
+    bitmap->meta = hbitmap_create_meta(bitmap->bitmap,
+                                       chunk_size / granularity);
+    bdrv_dirty_bitmaps_unlock(bitmap->bs);
+}
+
+/* Called with BQL taken. */
+void bdrv_dirty_bitmap_release_meta(BdrvDirtyBitmap *bitmap)
+{
+    bdrv_dirty_bitmaps_lock(bitmap->bs);
+    if (bitmap->meta) {
+        hbitmap_free_meta(bitmap->bitmap);
+        bitmap->meta = NULL;
+    }
+    bdrv_dirty_bitmaps_unlock(bitmap->bs);
+}
+
+bool bdrv_dirty_bitmap_has_meta(BdrvDirtyBitmap *bitmap)
+{
+    return bitmap->meta != NULL;
+}
+
+/*
+ * Return the offset of the first chunk at or after @offset that changed
+ * since the meta bitmap was created or last reset, or -1 if there is none.
+ */
+int64_t bdrv_dirty_bitmap_meta_next_dirty(BdrvDirtyBitmap *bitmap,
+                                          int64_t offset)
+{
+    int64_t ret;
+
+    assert(bitmap->meta);
+    if (offset >= bitmap->size) {
+        return -1;
+    }
+
+    bdrv_dirty_bitmaps_lock(bitmap->bs);
+    ret = hbitmap_next_dirty(bitmap->meta, offset, bitmap->size - offset);
+    bdrv_dirty_bitmaps_unlock(bitmap->bs);
+
+    return ret;
+}
+
+/* Called with BQL taken. */
+void bdrv_dirty_bitmap_reset_meta(BdrvDirtyBitmap *bitmap)
+{
+    assert(bitmap->meta);
+    bdrv_dirty_bitmaps_lock(bitmap->bs);
+    hbitmap_reset_all(bitmap->meta);
+    bdrv_dirty_bitmaps_unlock(bitmap->bs);
+}
+
+bool bdrv_dirty_bitmap_compressed(BdrvDirtyBitmap *bitmap)
+{
+    return hbitmap_is_compressed(bitmap->bitmap);
+}
+
 /* Called with BQL taken. */
 void bdrv_dirty_bitmap_set_inconsistent(BdrvDirtyBitmap *bitmap)
 {
@@ -875,7 +1013,11 @@ void bdrv_dirty_bitmap_merge_internal(BdrvDirtyBitmap *dest,
 
     if (backup) {
         *backup = dest->bitmap;
-        dest->bitmap = hbitmap_alloc(dest->size, hbitmap_granularity(*backup));
+        dest->bitmap =
+            bdrv_dirty_bitmap_alloc_hbitmap(dest->size,
+                                            hbitmap_granularity(*backup),
+                                            hbitmap_is_compressed(*backup));
+        bdrv_dirty_bitmap_move_meta(dest, *backup, dest->bitmap);
         hbitmap_merge(*backup, src->bitmap, dest->bitmap);
     } else {
         hbitmap_merge(dest->bitmap, src->bitmap, dest->bitmap);
@@ -29,6 +29,7 @@
 #include "qapi/qapi-commands-block.h"
 #include "qemu/main-loop.h"
 #include "system/block-backend.h"
+#include "system/iothread.h"
 
 #include <fuse.h>
 #include <fuse_lowlevel.h>
@@ -45,24 +46,57 @@
 #define FUSE_MAX_BOUNCE_BYTES (MIN(BDRV_REQUEST_MAX_BYTES, 64 * 1024 * 1024))
 
 
-typedef struct FuseExport {
+typedef struct FuseExport FuseExport;
+
+/*
+ * One AioContext in which requests are read from the FUSE session FD.  The
+ * kernel hands each request to only one reader, so with several queues in
+ * different IOThreads, requests are processed in parallel.
+ */
+typedef struct FuseQueue {
+    FuseExport *exp;
+    AioContext *ctx;
+    /* NULL if this queue follows the export's AioContext */
+    IOThread *iothread;
+    struct fuse_buf fuse_buf;
+    bool fd_handler_set_up;
+} FuseQueue;
+
+struct FuseExport {
     BlockExport common;
 
     struct fuse_session *fuse_session;
-    struct fuse_buf fuse_buf;
+    FuseQueue *queues;
+    size_t num_queues;
     unsigned int in_flight; /* atomic */
-    bool mounted, fd_handler_set_up;
+    bool mounted;
 
     char *mountpoint;
     bool writable;
     bool growable;
+    /* Serializes requests that grow the image, see fuse_co_grow() */
+    CoMutex grow_lock;
     /* Whether allow_other was used as a mount option or not */
     bool allow_other;
 
     mode_t st_mode;
     uid_t st_uid;
     gid_t st_gid;
-} FuseExport;
+};
+
+/*
+ * Data path request that is processed in a coroutine, so the FUSE session FD
+ * can be read again while it waits for I/O.
+ */
+typedef struct FuseIORequest {
+    FuseExport *exp;
+    fuse_req_t req;
+    int mode;
+    int64_t offset;
+    int64_t length;
+    /* Bounce buffer; freed when the request completes */
+    void *buf;
+} FuseIORequest;
 
 static GHashTable *exports;
 static const struct fuse_lowlevel_ops fuse_ops;
@@ -79,14 +113,31 @@ static void read_from_fuse_export(void *opaque);
 static bool is_regular_file(const char *path, Error **errp);
 
 
+/**
+ * Start or stop reading from the FUSE session FD in all queues.
+ */
+static void fuse_export_set_fd_handlers(FuseExport *exp, bool enable)
+{
+    int fd = fuse_session_fd(exp->fuse_session);
+
+    for (size_t i = 0; i < exp->num_queues; i++) {
+        FuseQueue *q = &exp->queues[i];
+
+        if (enable) {
+            aio_set_fd_handler(q->ctx, fd, read_from_fuse_export,
+                               NULL, NULL, NULL, q);
+        } else if (q->fd_handler_set_up) {
+            aio_set_fd_handler(q->ctx, fd, NULL, NULL, NULL, NULL, NULL);
+        }
+        q->fd_handler_set_up = enable;
+    }
+}
+
 static void fuse_export_drained_begin(void *opaque)
 {
     FuseExport *exp = opaque;
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       NULL, NULL, NULL, NULL, NULL);
-    exp->fd_handler_set_up = false;
+    fuse_export_set_fd_handlers(exp, false);
 }
 
 static void fuse_export_drained_end(void *opaque)
@@ -95,11 +146,11 @@ static void fuse_export_drained_end(void *opaque)
 
     /* Refresh AioContext in case it changed */
     exp->common.ctx = blk_get_aio_context(exp->common.blk);
+    if (!exp->queues[0].iothread) {
+        exp->queues[0].ctx = exp->common.ctx;
+    }
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
+    fuse_export_set_fd_handlers(exp, true);
 }
 
 static bool fuse_export_drained_poll(void *opaque)
@@ -115,6 +166,55 @@ static const BlockDevOps fuse_export_blk_dev_ops = {
     .drained_poll  = fuse_export_drained_poll,
 };
 
+/**
+ * Set up one queue per IOThread in @iothreads, or a single queue in the
+ * export's AioContext if @iothreads is NULL.
+ */
+static bool fuse_export_init_queues(FuseExport *exp, strList *iothreads,
+                                    Error **errp)
+{
+    strList *e;
+
+    if (!iothreads) {
+        exp->queues = g_new0(FuseQueue, 1);
+        exp->queues[0] = (FuseQueue) {
+            .exp = exp,
+            .ctx = exp->common.ctx,
+        };
+        exp->num_queues = 1;
+        return true;
+    }
+
+    exp->queues = g_new0(FuseQueue, QAPI_LIST_LENGTH(iothreads));
+    for (e = iothreads; e; e = e->next) {
+        IOThread *iothread = iothread_by_id(e->value);
+
+        if (!iothread) {
+            error_setg(errp, "IOThread \"%s\" object does not exist",
+                       e->value);
+            return false;
+        }
+
+        for (size_t i = 0; i < exp->num_queues; i++) {
+            if (exp->queues[i].iothread == iothread) {
+                error_setg(errp, "duplicate IOThread name \"%s\" in iothreads",
+                           e->value);
+                return false;
+            }
+        }
+
+        /* Released in fuse_export_delete() */
+        object_ref(OBJECT(iothread));
+        exp->queues[exp->num_queues++] = (FuseQueue) {
+            .exp = exp,
+            .ctx = iothread_get_aio_context(iothread),
+            .iothread = iothread,
+        };
+    }
+
+    return true;
+}
+
 static int fuse_export_create(BlockExport *blk_exp,
                               BlockExportOptions *blk_exp_args,
                               Error **errp)
@@ -178,12 +278,18 @@ static int fuse_export_create(BlockExport *blk_exp,
     exp->mountpoint = g_strdup(args->mountpoint);
     exp->writable = blk_exp_args->writable;
     exp->growable = args->growable;
+    qemu_co_mutex_init(&exp->grow_lock);
 
     /* set default */
     if (!args->has_allow_other) {
         args->allow_other = FUSE_EXPORT_ALLOW_OTHER_AUTO;
     }
 
+    if (!fuse_export_init_queues(exp, args->iothreads, errp)) {
+        ret = -EINVAL;
+        goto fail;
+    }
+
     exp->st_mode = S_IFREG | S_IRUSR;
     if (exp->writable) {
         exp->st_mode |= S_IWUSR;
@@ -269,10 +375,20 @@ static int setup_fuse_export(FuseExport *exp, const char *mountpoint,
 
     g_hash_table_insert(exports, g_strdup(mountpoint), NULL);
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
+    /*
+     * All queues are woken up when a request arrives, but only one of them
+     * gets to read it.  The others must not block.
+     */
+    if (exp->num_queues > 1 &&
+        !g_unix_set_fd_nonblocking(fuse_session_fd(exp->fuse_session), true,
+                                   NULL)) {
+        ret = -errno;
+        error_setg_errno(errp, -ret, "Failed to make FUSE session FD "
+                         "non-blocking");
+        goto fail;
+    }
+
+    fuse_export_set_fd_handlers(exp, true);
 
     return 0;
 
@@ -281,13 +397,21 @@ fail:
     return ret;
 }
 
+static void fuse_export_dec_in_flight(FuseExport *exp)
+{
+    if (qatomic_fetch_dec(&exp->in_flight) == 1) {
+        aio_wait_kick(); /* wake AIO_WAIT_WHILE() */
+    }
+}
+
 /**
  * Callback to be invoked when the FUSE session FD can be read from.
  * (This is basically the FUSE event loop.)
  */
 static void read_from_fuse_export(void *opaque)
 {
-    FuseExport *exp = opaque;
+    FuseQueue *q = opaque;
+    FuseExport *exp = q->exp;
     int ret;
 
     blk_exp_ref(&exp->common);
@@ -295,35 +419,51 @@ static void read_from_fuse_export(void *opaque)
     qatomic_inc(&exp->in_flight);
 
     do {
-        ret = fuse_session_receive_buf(exp->fuse_session, &exp->fuse_buf);
+        ret = fuse_session_receive_buf(exp->fuse_session, &q->fuse_buf);
     } while (ret == -EINTR);
     if (ret < 0) {
         goto out;
     }
 
-    fuse_session_process_buf(exp->fuse_session, &exp->fuse_buf);
+    fuse_session_process_buf(exp->fuse_session, &q->fuse_buf);
 
 out:
-    if (qatomic_fetch_dec(&exp->in_flight) == 1) {
-        aio_wait_kick(); /* wake AIO_WAIT_WHILE() */
-    }
+    fuse_export_dec_in_flight(exp);
 
     blk_exp_unref(&exp->common);
 }
 
+/**
+ * Process @r in a coroutine in the current AioContext.  Takes ownership of
+ * @r.
+ */
+static void fuse_io_request_submit(FuseIORequest *r, CoroutineEntry *entry)
+{
+    Coroutine *co = qemu_coroutine_create(entry, r);
+
+    blk_exp_ref(&r->exp->common);
+    qatomic_inc(&r->exp->in_flight);
+    qemu_coroutine_enter(co);
+}
+
+static void fuse_io_request_complete(FuseIORequest *r)
+{
+    FuseExport *exp = r->exp;
+
+    qemu_vfree(r->buf);
+    g_free(r);
+
+    fuse_export_dec_in_flight(exp);
+    blk_exp_unref(&exp->common);
+}
+
 static void fuse_export_shutdown(BlockExport *blk_exp)
 {
     FuseExport *exp = container_of(blk_exp, FuseExport, common);
 
     if (exp->fuse_session) {
         fuse_session_exit(exp->fuse_session);
-
-        if (exp->fd_handler_set_up) {
-            aio_set_fd_handler(exp->common.ctx,
-                               fuse_session_fd(exp->fuse_session),
-                               NULL, NULL, NULL, NULL, NULL);
-            exp->fd_handler_set_up = false;
-        }
+        fuse_export_set_fd_handlers(exp, false);
     }
 
     if (exp->mountpoint) {
@@ -347,7 +487,13 @@ static void fuse_export_delete(BlockExport *blk_exp)
         fuse_session_destroy(exp->fuse_session);
     }
 
-    free(exp->fuse_buf.mem);
+    for (size_t i = 0; i < exp->num_queues; i++) {
+        free(exp->queues[i].fuse_buf.mem);
+        if (exp->queues[i].iothread) {
+            object_unref(OBJECT(exp->queues[i].iothread));
+        }
+    }
+    g_free(exp->queues);
     g_free(exp->mountpoint);
 }
 
@@ -570,125 +716,194 @@ static void fuse_open(fuse_req_t req, fuse_ino_t inode,
     fuse_reply_open(req, fi);
 }
 
-/**
- * Handle client reads from the exported image.
- */
-static void fuse_read(fuse_req_t req, fuse_ino_t inode,
-                      size_t size, off_t offset, struct fuse_file_info *fi)
+static void coroutine_fn fuse_co_read(void *opaque)
 {
-    FuseExport *exp = fuse_req_userdata(req);
+    FuseIORequest *r = opaque;
+    FuseExport *exp = r->exp;
+    size_t size = r->length;
     int64_t length;
-    void *buf;
     int ret;
 
-    /* Limited by max_read, should not happen */
-    if (size > FUSE_MAX_BOUNCE_BYTES) {
-        fuse_reply_err(req, EINVAL);
-        return;
-    }
-
     /**
      * Clients will expect short reads at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
-        fuse_reply_err(req, -length);
-        return;
+        fuse_reply_err(r->req, -length);
+        goto out;
     }
 
-    if (offset + size > length) {
-        size = length - offset;
+    if (r->offset + size > length) {
+        size = length - r->offset;
     }
 
-    buf = qemu_try_blockalign(blk_bs(exp->common.blk), size);
-    if (!buf) {
-        fuse_reply_err(req, ENOMEM);
-        return;
+    r->buf = qemu_try_blockalign(blk_bs(exp->common.blk), size);
+    if (!r->buf) {
+        fuse_reply_err(r->req, ENOMEM);
+        goto out;
     }
 
-    ret = blk_pread(exp->common.blk, offset, size, buf, 0);
+    ret = blk_co_pread(exp->common.blk, r->offset, size, r->buf, 0);
     if (ret >= 0) {
-        fuse_reply_buf(req, buf, size);
+        fuse_reply_buf(r->req, r->buf, size);
     } else {
-        fuse_reply_err(req, -ret);
+        fuse_reply_err(r->req, -ret);
     }
 
-    qemu_vfree(buf);
+out:
+    fuse_io_request_complete(r);
 }
 
 /**
- * Handle client writes to the exported image.
+ * Handle client reads from the exported image.
  */
-static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
-                       size_t size, off_t offset, struct fuse_file_info *fi)
+static void fuse_read(fuse_req_t req, fuse_ino_t inode,
+                      size_t size, off_t offset, struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
-    int64_t length;
-    int ret;
+    FuseIORequest *r;
 
-    /* Limited by max_write, should not happen */
-    if (size > BDRV_REQUEST_MAX_BYTES) {
+    /* Limited by max_read, should not happen */
+    if (size > FUSE_MAX_BOUNCE_BYTES) {
         fuse_reply_err(req, EINVAL);
         return;
     }
 
-    if (!exp->writable) {
-        fuse_reply_err(req, EACCES);
-        return;
+    r = g_new(FuseIORequest, 1);
+    *r = (FuseIORequest) {
+        .exp = exp,
+        .req = req,
+        .offset = offset,
+        .length = size,
+    };
+    fuse_io_request_submit(r, fuse_co_read);
+}
+
+/**
+ * Grow the image to at least @size bytes.  Requests in other coroutines may
+ * grow it concurrently, so the length is checked again under
+ * exp->grow_lock, and the image is never shrunk.
+ */
+static int coroutine_fn fuse_co_grow(FuseExport *exp, int64_t size,
+                                     bool req_zero_write,
+                                     PreallocMode prealloc)
+{
+    int64_t length;
+    int ret = 0;
+
+    qemu_co_mutex_lock(&exp->grow_lock);
+    length = blk_co_getlength(exp->common.blk);
+    if (length < 0) {
+        ret = length;
+    } else if (size > length) {
+        ret = fuse_do_truncate(exp, size, req_zero_write, prealloc);
     }
+    qemu_co_mutex_unlock(&exp->grow_lock);
+
+    return ret;
+}
+
+static void coroutine_fn fuse_co_write(void *opaque)
+{
+    FuseIORequest *r = opaque;
+    FuseExport *exp = r->exp;
+    size_t size = r->length;
+    int64_t length;
+    int ret;
 
     /**
      * Clients will expect short writes at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
-        fuse_reply_err(req, -length);
-        return;
+        fuse_reply_err(r->req, -length);
+        goto out;
     }
 
-    if (offset + size > length) {
+    if (r->offset + size > length) {
         if (exp->growable) {
-            ret = fuse_do_truncate(exp, offset + size, true, PREALLOC_MODE_OFF);
+            ret = fuse_co_grow(exp, r->offset + size, true,
+                               PREALLOC_MODE_OFF);
             if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+                fuse_reply_err(r->req, -ret);
+                goto out;
             }
         } else {
-            size = length - offset;
+            size = length - r->offset;
         }
     }
 
-    ret = blk_pwrite(exp->common.blk, offset, size, buf, 0);
+    ret = blk_co_pwrite(exp->common.blk, r->offset, size, r->buf, 0);
     if (ret >= 0) {
-        fuse_reply_write(req, size);
+        fuse_reply_write(r->req, size);
     } else {
-        fuse_reply_err(req, -ret);
+        fuse_reply_err(r->req, -ret);
     }
+
+out:
+    fuse_io_request_complete(r);
 }
 
 /**
- * Let clients perform various fallocate() operations.
+ * Handle client writes to the exported image.
  */
-static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
-                           off_t offset, off_t length,
-                           struct fuse_file_info *fi)
+static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
+                       size_t size, off_t offset, struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
-    int64_t blk_len;
-    int ret;
+    FuseIORequest *r;
+    void *bounce;
+
+    /* Limited by max_write, should not happen */
+    if (size > BDRV_REQUEST_MAX_BYTES) {
+        fuse_reply_err(req, EINVAL);
+        return;
+    }
 
     if (!exp->writable) {
         fuse_reply_err(req, EACCES);
         return;
     }
 
-    blk_len = blk_getlength(exp->common.blk);
-    if (blk_len < 0) {
-        fuse_reply_err(req, -blk_len);
+    /*
+     * @buf points into the queue's receive buffer, which is reused for the
+     * next request once we return.
+     */
+    bounce = qemu_try_blockalign(blk_bs(exp->common.blk), size);
+    if (!bounce) {
+        fuse_reply_err(req, ENOMEM);
         return;
     }
+    memcpy(bounce, buf, size);
+
+    r = g_new(FuseIORequest, 1);
+    *r = (FuseIORequest) {
+        .exp = exp,
+        .req = req,
+        .offset = offset,
+        .length = size,
+        .buf = bounce,
+    };
+    fuse_io_request_submit(r, fuse_co_write);
+}
+
+static void coroutine_fn fuse_co_fallocate(void *opaque)
+{
+    FuseIORequest *r = opaque;
+    FuseExport *exp = r->exp;
+    int mode = r->mode;
+    int64_t offset = r->offset;
+    int64_t length = r->length;
+    int64_t blk_len;
+    int ret;
+
+    blk_len = blk_co_getlength(exp->common.blk);
+    if (blk_len < 0) {
+        fuse_reply_err(r->req, -blk_len);
+        goto out;
+    }
 
 #ifdef CONFIG_FALLOCATE_PUNCH_HOLE
     if (mode & FALLOC_FL_KEEP_SIZE) {
@@ -697,36 +912,40 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
 #endif /* CONFIG_FALLOCATE_PUNCH_HOLE */
 
     if (!mode) {
-        /* We can only fallocate at the EOF with a truncate */
-        if (offset < blk_len) {
-            fuse_reply_err(req, EOPNOTSUPP);
-            return;
-        }
-
-        if (offset > blk_len) {
-            /* No preallocation needed here */
-            ret = fuse_do_truncate(exp, offset, true, PREALLOC_MODE_OFF);
-            if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+        /* Another request may have grown the image since, check again */
+        qemu_co_mutex_lock(&exp->grow_lock);
+        blk_len = blk_co_getlength(exp->common.blk);
+        if (blk_len < 0) {
+            ret = blk_len;
+        } else if (offset < blk_len) {
+            /* We can only fallocate at the EOF with a truncate */
+            ret = -EOPNOTSUPP;
+        } else {
+            ret = 0;
+            if (offset > blk_len) {
+                /* No preallocation needed here */
+                ret = fuse_do_truncate(exp, offset, true, PREALLOC_MODE_OFF);
+            }
+            if (ret >= 0) {
+                ret = fuse_do_truncate(exp, offset + length, true,
+                                       PREALLOC_MODE_FALLOC);
             }
         }
-
-        ret = fuse_do_truncate(exp, offset + length, true,
-                               PREALLOC_MODE_FALLOC);
+        qemu_co_mutex_unlock(&exp->grow_lock);
     }
 #ifdef CONFIG_FALLOCATE_PUNCH_HOLE
     else if (mode & FALLOC_FL_PUNCH_HOLE) {
         if (!(mode & FALLOC_FL_KEEP_SIZE)) {
-            fuse_reply_err(req, EINVAL);
-            return;
+            fuse_reply_err(r->req, EINVAL);
+            goto out;
         }
 
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk, offset, size,
-                                    BDRV_REQ_MAY_UNMAP | BDRV_REQ_NO_FALLBACK);
+            ret = blk_co_pwrite_zeroes(exp->common.blk, offset, size,
+                                       BDRV_REQ_MAY_UNMAP |
+                                       BDRV_REQ_NO_FALLBACK);
             if (ret == -ENOTSUP) {
                 /*
                  * fallocate() specifies to return EOPNOTSUPP for unsupported
@@ -744,19 +963,19 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
     else if (mode & FALLOC_FL_ZERO_RANGE) {
         if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + length > blk_len) {
             /* No need for zeroes, we are going to write them ourselves */
-            ret = fuse_do_truncate(exp, offset + length, false,
-                                   PREALLOC_MODE_OFF);
+            ret = fuse_co_grow(exp, offset + length, false,
+                               PREALLOC_MODE_OFF);
             if (ret < 0) {
-                fuse_reply_err(req, -ret);
-                return;
+                fuse_reply_err(r->req, -ret);
+                goto out;
             }
         }
 
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk,
-                                    offset, size, 0);
+            ret = blk_co_pwrite_zeroes(exp->common.blk,
+                                       offset, size, 0);
             offset += size;
             length -= size;
         } while (ret == 0 && length > 0);
@@ -766,7 +985,47 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
         ret = -EOPNOTSUPP;
     }
 
-    fuse_reply_err(req, ret < 0 ? -ret : 0);
+    fuse_reply_err(r->req, ret < 0 ? -ret : 0);
+
+out:
+    fuse_io_request_complete(r);
+}
+
+/**
+ * Let clients perform various fallocate() operations.
+ */
+static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
+                           off_t offset, off_t length,
+                           struct fuse_file_info *fi)
+{
+    FuseExport *exp = fuse_req_userdata(req);
+    FuseIORequest *r;
+
+    if (!exp->writable) {
+        fuse_reply_err(req, EACCES);
+        return;
+    }
+
+    r = g_new(FuseIORequest, 1);
+    *r = (FuseIORequest) {
+        .exp = exp,
+        .req = req,
+        .mode = mode,
+        .offset = offset,
+        .length = length,
+    };
+    fuse_io_request_submit(r, fuse_co_fallocate);
+}
+
+static void coroutine_fn fuse_co_fsync(void *opaque)
+{
+    FuseIORequest *r = opaque;
+    int ret;
+
+    ret = blk_co_flush(r->exp->common.blk);
+    fuse_reply_err(r->req, ret < 0 ? -ret : 0);
+
+    fuse_io_request_complete(r);
 }
 
 /**
@@ -775,11 +1034,13 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
 static void fuse_fsync(fuse_req_t req, fuse_ino_t inode, int datasync,
                        struct fuse_file_info *fi)
 {
-    FuseExport *exp = fuse_req_userdata(req);
-    int ret;
+    FuseIORequest *r = g_new(FuseIORequest, 1);
 
-    ret = blk_flush(exp->common.blk);
-    fuse_reply_err(req, ret < 0 ? -ret : 0);
+    *r = (FuseIORequest) {
+        .exp = fuse_req_userdata(req),
+        .req = req,
+    };
+    fuse_io_request_submit(r, fuse_co_fsync);
 }
 
 /**
@@ -15,7 +15,9 @@
 
 #include "qapi/error.h"
 #include "block/export.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
+#include "qemu/timer.h"
 #include "util/block-helpers.h"
 #include "subprojects/libvduse/libvduse.h"
 #include "virtio-blk-handler.h"
@@ -25,19 +27,37 @@
 #define VDUSE_DEFAULT_NUM_QUEUE 1
 #define VDUSE_DEFAULT_QUEUE_SIZE 256
 
-typedef struct VduseBlkExport {
+typedef struct VduseBlkExport VduseBlkExport;
+
+/* Per-virtqueue interrupt coalescing state */
+typedef struct VduseBlkVirtq {
+    VduseBlkExport *vblk_exp;
+    VduseVirtq *vq;
+    unsigned int inflight;
+    /* Completions that have been pushed but not notified yet */
+    unsigned int pending;
+    /* Only with irq-coalesce-count > 1, lives in export.ctx */
+    QEMUTimer *coalesce_timer;
+} VduseBlkVirtq;
+
+struct VduseBlkExport {
     BlockExport export;
     VirtioBlkHandler handler;
     VduseDev *dev;
     uint16_t num_queues;
+    VduseBlkVirtq *vqs;
     char *recon_file;
     unsigned int inflight; /* atomic */
     bool vqs_started;
-} VduseBlkExport;
+
+    uint16_t irq_coalesce_count;
+    uint32_t irq_coalesce_time; /* microseconds */
+    bool irq_coalesce_adaptive;
+};
 
 typedef struct VduseBlkReq {
     VduseVirtqElement elem;
-    VduseVirtq *vq;
+    VduseBlkVirtq *bvq;
 } VduseBlkReq;
 
 static void vduse_blk_inflight_inc(VduseBlkExport *vblk_exp)
@@ -59,20 +79,50 @@ static void vduse_blk_inflight_dec(VduseBlkExport *vblk_exp)
     }
 }
 
+/*
+ * Called by defer_call_end() or by the coalescing timer. Sends one interrupt
+ * for all completions pushed since the last one.
+ */
+static void vduse_blk_vq_notify(void *opaque)
+{
+    VduseBlkVirtq *bvq = opaque;
+
+    if (!bvq->pending) {
+        return;
+    }
+
+    bvq->pending = 0;
+    if (bvq->coalesce_timer) {
+        timer_del(bvq->coalesce_timer);
+    }
+    vduse_queue_notify(bvq->vq);
+}
+
 static void vduse_blk_req_complete(VduseBlkReq *req, size_t in_len)
 {
-    vduse_queue_push(req->vq, &req->elem, in_len);
-    vduse_queue_notify(req->vq);
+    VduseBlkVirtq *bvq = req->bvq;
+    VduseBlkExport *vblk_exp = bvq->vblk_exp;
 
+    vduse_queue_push(bvq->vq, &req->elem, in_len);
     free(req);
+
+    bvq->pending++;
+    if (bvq->pending >= vblk_exp->irq_coalesce_count ||
+        (vblk_exp->irq_coalesce_adaptive && bvq->inflight == 0)) {
+        /* Completions from the same batch of I/O share one interrupt */
+        defer_call(vduse_blk_vq_notify, bvq);
+    } else if (!timer_pending(bvq->coalesce_timer)) {
+        timer_mod(bvq->coalesce_timer,
+                  qemu_clock_get_us(QEMU_CLOCK_REALTIME) +
+                  vblk_exp->irq_coalesce_time);
+    }
 }
 
 static void coroutine_fn vduse_blk_virtio_process_req(void *opaque)
 {
     VduseBlkReq *req = opaque;
-    VduseVirtq *vq = req->vq;
-    VduseDev *dev = vduse_queue_get_dev(vq);
-    VduseBlkExport *vblk_exp = vduse_dev_get_priv(dev);
+    VduseBlkVirtq *bvq = req->bvq;
+    VduseBlkExport *vblk_exp = bvq->vblk_exp;
     VirtioBlkHandler *handler = &vblk_exp->handler;
     VduseVirtqElement *elem = &req->elem;
     struct iovec *in_iov = elem->in_sg;
@@ -83,8 +133,10 @@ static void coroutine_fn vduse_blk_virtio_process_req(void *opaque)
 
     in_len = virtio_blk_process_req(handler, in_iov,
                                     out_iov, in_num, out_num);
+    bvq->inflight--;
     if (in_len < 0) {
         free(req);
+        vduse_blk_inflight_dec(vblk_exp);
         return;
     }
 
@@ -92,22 +144,23 @@ static void coroutine_fn vduse_blk_virtio_process_req(void *opaque)
     vduse_blk_inflight_dec(vblk_exp);
 }
 
-static void vduse_blk_vq_handler(VduseDev *dev, VduseVirtq *vq)
+static void vduse_blk_vq_handler(VduseBlkVirtq *bvq)
 {
-    VduseBlkExport *vblk_exp = vduse_dev_get_priv(dev);
+    VduseBlkExport *vblk_exp = bvq->vblk_exp;
 
     while (1) {
         VduseBlkReq *req;
 
-        req = vduse_queue_pop(vq, sizeof(VduseBlkReq));
+        req = vduse_queue_pop(bvq->vq, sizeof(VduseBlkReq));
         if (!req) {
             break;
         }
-        req->vq = vq;
+        req->bvq = bvq;
 
         Coroutine *co =
             qemu_coroutine_create(vduse_blk_virtio_process_req, req);
 
+        bvq->inflight++;
         vduse_blk_inflight_inc(vblk_exp);
         qemu_coroutine_enter(co);
     }
@@ -115,9 +168,8 @@ static void vduse_blk_vq_handler(VduseDev *dev, VduseVirtq *vq)
 
 static void on_vduse_vq_kick(void *opaque)
 {
-    VduseVirtq *vq = opaque;
-    VduseDev *dev = vduse_queue_get_dev(vq);
-    int fd = vduse_queue_get_fd(vq);
+    VduseBlkVirtq *bvq = opaque;
+    int fd = vduse_queue_get_fd(bvq->vq);
     eventfd_t kick_data;
 
     if (eventfd_read(fd, &kick_data) == -1) {
@@ -125,7 +177,18 @@ static void on_vduse_vq_kick(void *opaque)
         return;
     }
 
-    vduse_blk_vq_handler(dev, vq);
+    vduse_blk_vq_handler(bvq);
+}
+
+static VduseBlkVirtq *vduse_blk_get_vq(VduseBlkExport *vblk_exp,
+                                       VduseVirtq *vq)
+{
+    for (uint16_t i = 0; i < vblk_exp->num_queues; i++) {
+        if (vblk_exp->vqs[i].vq == vq) {
+            return &vblk_exp->vqs[i];
+        }
+    }
+    g_assert_not_reached();
 }
 
 static void vduse_blk_enable_queue(VduseDev *dev, VduseVirtq *vq)
@@ -137,7 +200,8 @@ static void vduse_blk_enable_queue(VduseDev *dev, VduseVirtq *vq)
     }
 
     aio_set_fd_handler(vblk_exp->export.ctx, vduse_queue_get_fd(vq),
-                       on_vduse_vq_kick, NULL, NULL, NULL, vq);
+                       on_vduse_vq_kick, NULL, NULL, NULL,
+                       vduse_blk_get_vq(vblk_exp, vq));
     /* Make sure we don't miss any kick after reconnecting */
     eventfd_write(vduse_queue_get_fd(vq), 1);
 }
@@ -167,11 +231,42 @@ static void on_vduse_dev_kick(void *opaque)
     vduse_dev_handler(dev);
 }
 
+static void vduse_blk_attach_timers(VduseBlkExport *vblk_exp, AioContext *ctx)
+{
+    if (vblk_exp->irq_coalesce_count <= 1) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < vblk_exp->num_queues; i++) {
+        VduseBlkVirtq *bvq = &vblk_exp->vqs[i];
+
+        bvq->coalesce_timer = aio_timer_new(ctx, QEMU_CLOCK_REALTIME,
+                                            SCALE_US, vduse_blk_vq_notify,
+                                            bvq);
+    }
+}
+
+static void vduse_blk_detach_timers(VduseBlkExport *vblk_exp)
+{
+    for (uint16_t i = 0; i < vblk_exp->num_queues; i++) {
+        VduseBlkVirtq *bvq = &vblk_exp->vqs[i];
+
+        /* Don't leave completions unnotified across the switch */
+        vduse_blk_vq_notify(bvq);
+
+        if (bvq->coalesce_timer) {
+            timer_free(bvq->coalesce_timer);
+            bvq->coalesce_timer = NULL;
+        }
+    }
+}
+
 static void vduse_blk_attach_ctx(VduseBlkExport *vblk_exp, AioContext *ctx)
 {
     aio_set_fd_handler(vblk_exp->export.ctx, vduse_dev_get_fd(vblk_exp->dev),
                        on_vduse_dev_kick, NULL, NULL, NULL,
                        vblk_exp->dev);
+    vduse_blk_attach_timers(vblk_exp, ctx);
 
     /* Virtqueues are handled by vduse_blk_drained_end() */
 }
@@ -180,6 +275,7 @@ static void vduse_blk_detach_ctx(VduseBlkExport *vblk_exp)
 {
     aio_set_fd_handler(vblk_exp->export.ctx, vduse_dev_get_fd(vblk_exp->dev),
                        NULL, NULL, NULL, NULL, NULL);
+    vduse_blk_detach_timers(vblk_exp);
 
     /* Virtqueues are handled by vduse_blk_drained_begin() */
 }
@@ -301,6 +397,24 @@ static int vduse_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
             return -EINVAL;
         }
     }
+
+    vblk_exp->irq_coalesce_count = 1;
+    if (vblk_opts->has_irq_coalesce_count) {
+        if (vblk_opts->irq_coalesce_count == 0) {
+            error_setg(errp, "irq-coalesce-count must be greater than 0");
+            return -EINVAL;
+        }
+        vblk_exp->irq_coalesce_count = vblk_opts->irq_coalesce_count;
+    }
+    vblk_exp->irq_coalesce_time = vblk_opts->has_irq_coalesce_time ?
+                                  vblk_opts->irq_coalesce_time : 0;
+    if (vblk_exp->irq_coalesce_count > 1 && !vblk_exp->irq_coalesce_time) {
+        error_setg(errp, "irq-coalesce-count requires irq-coalesce-time");
+        return -EINVAL;
+    }
+    vblk_exp->irq_coalesce_adaptive = !vblk_opts->has_irq_coalesce_adaptive ||
+                                      vblk_opts->irq_coalesce_adaptive;
+
     vblk_exp->num_queues = num_queues;
     vblk_exp->handler.blk = exp->blk;
     vblk_exp->handler.serial = g_strdup(vblk_opts->serial ?: "");
@@ -357,12 +471,18 @@ static int vduse_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
         goto err;
     }
 
+    vblk_exp->vqs = g_new0(VduseBlkVirtq, num_queues);
     for (i = 0; i < num_queues; i++) {
         vduse_dev_setup_queue(vblk_exp->dev, i, queue_size);
+        vblk_exp->vqs[i] = (VduseBlkVirtq) {
+            .vblk_exp = vblk_exp,
+            .vq = vduse_dev_get_queue(vblk_exp->dev, i),
+        };
     }
 
     aio_set_fd_handler(exp->ctx, vduse_dev_get_fd(vblk_exp->dev),
                        on_vduse_dev_kick, NULL, NULL, NULL, vblk_exp->dev);
+    vduse_blk_attach_timers(vblk_exp, exp->ctx);
 
     blk_add_aio_context_notifier(exp->blk, blk_aio_attached, blk_aio_detach,
                                  vblk_exp);
@@ -400,6 +520,7 @@ static void vduse_blk_exp_delete(BlockExport *exp)
     }
     g_free(vblk_exp->recon_file);
     g_free(vblk_exp->handler.serial);
+    g_free(vblk_exp->vqs);
 }
 
 /* Called with exp->ctx acquired */
@@ -17,7 +17,10 @@
 #include "qemu/vhost-user-server.h"
 #include "vhost-user-blk-server.h"
 #include "qapi/error.h"
+#include "qapi/clone-visitor.h"
+#include "qapi/qapi-visit-block-core.h"
 #include "qom/object_interfaces.h"
+#include "system/iothread-vq-mapping.h"
 #include "util/block-helpers.h"
 #include "virtio-blk-handler.h"
 
@@ -38,6 +41,10 @@ typedef struct {
     VirtioBlkHandler handler;
     QIOChannelSocket *sioc;
     struct virtio_blk_config blkcfg;
+
+    /* Only set with iothread-vq-mapping */
+    IOThreadVirtQueueMappingList *iothread_vq_mapping_list;
+    AioContext **vq_aio_context;
 } VuBlkExport;
 
 static void vu_blk_req_complete(VuBlkReq *req, size_t in_len)
@@ -254,6 +261,18 @@ vu_blk_initialize_config(BlockDriverState *bs,
     config->max_write_zeroes_seg = cpu_to_le32(1);
 }
 
+static void vu_blk_vq_aio_context_cleanup(VuBlkExport *vexp)
+{
+    if (vexp->iothread_vq_mapping_list) {
+        iothread_vq_mapping_cleanup(vexp->iothread_vq_mapping_list);
+        qapi_free_IOThreadVirtQueueMappingList(vexp->iothread_vq_mapping_list);
+        vexp->iothread_vq_mapping_list = NULL;
+    }
+
+    g_free(vexp->vq_aio_context);
+    vexp->vq_aio_context = NULL;
+}
+
 static void vu_blk_exp_request_shutdown(BlockExport *exp)
 {
     VuBlkExport *vexp = container_of(exp, VuBlkExport, export);
@@ -340,6 +359,21 @@ static int vu_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
         error_setg(errp, "num-queues must be greater than 0");
         return -EINVAL;
     }
+
+    if (vu_opts->iothread_vq_mapping) {
+        vexp->vq_aio_context = g_new(AioContext *, num_queues);
+        if (!iothread_vq_mapping_apply(vu_opts->iothread_vq_mapping,
+                                       vexp->vq_aio_context, num_queues,
+                                       errp)) {
+            g_free(vexp->vq_aio_context);
+            vexp->vq_aio_context = NULL;
+            return -EINVAL;
+        }
+        vexp->iothread_vq_mapping_list =
+            QAPI_CLONE(IOThreadVirtQueueMappingList,
+                       vu_opts->iothread_vq_mapping);
+    }
+
     vexp->handler.blk = exp->blk;
     vexp->handler.serial = g_strdup("vhost_user_blk");
     vexp->handler.logical_block_size = logical_block_size;
@@ -354,10 +388,12 @@ static int vu_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
     blk_set_dev_ops(exp->blk, &vu_blk_dev_ops, vexp);
 
     if (!vhost_user_server_start(&vexp->vu_server, vu_opts->addr, exp->ctx,
-                                 num_queues, &vu_blk_iface, errp)) {
+                                 vexp->vq_aio_context, num_queues,
+                                 &vu_blk_iface, errp)) {
         blk_remove_aio_context_notifier(exp->blk, blk_aio_attached,
                                         blk_aio_detach, vexp);
         g_free(vexp->handler.serial);
+        vu_blk_vq_aio_context_cleanup(vexp);
         return -EADDRNOTAVAIL;
     }
 
@@ -371,6 +407,7 @@ static void vu_blk_exp_delete(BlockExport *exp)
     blk_remove_aio_context_notifier(exp->blk, blk_aio_attached, blk_aio_detach,
                                     vexp);
     g_free(vexp->handler.serial);
+    vu_blk_vq_aio_context_cleanup(vexp);
 }
 
 const BlockExportDriver blk_exp_vhost_user_blk = {
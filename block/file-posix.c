@@ -79,6 +79,10 @@
 #include <linux/hdreg.h>
 #include <linux/magic.h>
 #include <scsi/sg.h>
+#ifdef HAVE_IO_URING_CMD
+#include <linux/nvme_ioctl.h>
+#include "block/nvme.h"
+#endif
 #ifdef __s390__
 #include <asm/dasd.h>
 #endif
@@ -183,7 +187,9 @@ typedef struct BDRVRawState {
     bool use_linux_aio:1;
     bool has_laio_fdsync:1;
     bool use_linux_io_uring:1;
+    bool aio_fixed:1;
     bool use_mpath:1;
+    bool read_nowait:1;
     int page_cache_inconsistent; /* errno from fdatasync failure */
     bool has_fallocate;
     bool needs_alignment;
@@ -194,8 +200,18 @@ typedef struct BDRVRawState {
         uint64_t discard_nb_ok;
         uint64_t discard_nb_failed;
         uint64_t discard_bytes_ok;
+        uint64_t read_nowait_hits;
+        uint64_t read_nowait_misses;
     } stats;
 
+#ifdef HAVE_IO_URING_CMD
+    /* NVMe passthrough to a generic character device (nvme-passthrough=on) */
+    bool nvme_passthrough;
+    uint32_t nvme_nsid;
+    unsigned int nvme_lba_shift;
+    int64_t nvme_size;
+#endif
+
     PRManager *pr_mgr;
 } BDRVRawState;
 
@@ -585,6 +601,29 @@ static QemuOptsList raw_runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "AIO max batch size (0 = auto handled by AIO backend, default: 0)",
         },
+#ifdef CONFIG_LINUX_IO_URING
+        {
+            .name = "aio-fixed",
+            .type = QEMU_OPT_BOOL,
+            .help = "use io_uring registered buffers and files (default: off)",
+        },
+#endif
+#ifdef HAVE_IO_URING_CMD
+        {
+            .name = "nvme-passthrough",
+            .type = QEMU_OPT_BOOL,
+            .help = "submit NVMe commands to an NVMe generic character device "
+                    "with io_uring (default: off)",
+        },
+#endif
+#ifdef CONFIG_PREADV2_NOWAIT
+        {
+            .name = "read-nowait",
+            .type = QEMU_OPT_BOOL,
+            .help = "try reads from the page cache without blocking before "
+                    "using the thread pool (default: off)",
+        },
+#endif
         {
             .name = "locking",
             .type = QEMU_OPT_STRING,
@@ -613,6 +652,53 @@ static QemuOptsList raw_runtime_opts = {
 
 static const char *const mutable_opts[] = { "x-check-cache-dropped", NULL };
 
+#ifdef HAVE_IO_URING_CMD
+/*
+ * Read the namespace ID, LBA size and capacity of the NVMe generic character
+ * device @s->fd for nvme-passthrough=on.
+ */
+static int raw_nvme_passthrough_probe(BDRVRawState *s, Error **errp)
+{
+    g_autofree NvmeIdNs *id_ns = g_new0(NvmeIdNs, 1);
+    struct nvme_passthru_cmd cmd = {
+        .opcode = NVME_ADM_CMD_IDENTIFY,
+        .addr = (uintptr_t)id_ns,
+        .data_len = sizeof(*id_ns),
+        .cdw10 = NVME_ID_CNS_NS,
+    };
+    NvmeLBAF *lbaf;
+    int nsid;
+
+    nsid = ioctl(s->fd, NVME_IOCTL_ID);
+    if (nsid < 0) {
+        error_setg_errno(errp, errno, "Could not get NVMe namespace ID");
+        return -errno;
+    }
+
+    cmd.nsid = nsid;
+    if (ioctl(s->fd, NVME_IOCTL_ADMIN_CMD, &cmd) < 0) {
+        error_setg_errno(errp, errno, "Could not identify NVMe namespace");
+        return -errno;
+    }
+
+    lbaf = &id_ns->lbaf[NVME_ID_NS_FLBAS_INDEX(id_ns->flbas)];
+    if (lbaf->ms) {
+        error_setg(errp, "NVMe namespaces with metadata are not supported");
+        return -ENOTSUP;
+    }
+    if (lbaf->ds < BDRV_SECTOR_BITS || lbaf->ds > 16) {
+        error_setg(errp, "Unsupported NVMe LBA size %" PRIu64,
+                   UINT64_C(1) << lbaf->ds);
+        return -ENOTSUP;
+    }
+
+    s->nvme_nsid = nsid;
+    s->nvme_lba_shift = lbaf->ds;
+    s->nvme_size = le64_to_cpu(id_ns->nsze) << lbaf->ds;
+    return 0;
+}
+#endif
+
 static int raw_open_common(BlockDriverState *bs, QDict *options,
                            int bdrv_flags, int open_flags,
                            bool device, Error **errp)
@@ -662,9 +748,18 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
     s->use_linux_aio = (aio == BLOCKDEV_AIO_OPTIONS_NATIVE);
 #ifdef CONFIG_LINUX_IO_URING
     s->use_linux_io_uring = (aio == BLOCKDEV_AIO_OPTIONS_IO_URING);
+    s->aio_fixed = qemu_opt_get_bool(opts, "aio-fixed", false);
+    if (s->aio_fixed && !s->use_linux_io_uring) {
+        error_setg(errp, "aio-fixed=on requires aio=io_uring");
+        ret = -EINVAL;
+        goto fail;
+    }
 #endif
 
     s->aio_max_batch = qemu_opt_get_number(opts, "aio-max-batch", 0);
+#ifdef CONFIG_PREADV2_NOWAIT
+    s->read_nowait = qemu_opt_get_bool(opts, "read-nowait", false);
+#endif
 
     locking = qapi_enum_parse(&OnOffAuto_lookup,
                               qemu_opt_get(opts, "locking"),
@@ -791,6 +886,37 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
             goto fail;
         }
     }
+
+#ifdef HAVE_IO_URING_CMD
+    if (qemu_opt_get_bool(opts, "nvme-passthrough", false)) {
+        if (!device || !S_ISCHR(st.st_mode)) {
+            error_setg(errp, "nvme-passthrough=on requires an NVMe generic "
+                       "character device");
+            ret = -EINVAL;
+            goto fail;
+        }
+        if (!s->use_linux_io_uring) {
+            error_setg(errp, "nvme-passthrough=on requires aio=io_uring");
+            ret = -EINVAL;
+            goto fail;
+        }
+        if (!aio_setup_linux_io_uring_cmd(qemu_get_current_aio_context(),
+                                          errp)) {
+            ret = -ENOTSUP;
+            goto fail;
+        }
+
+        ret = raw_nvme_passthrough_probe(s, errp);
+        if (ret < 0) {
+            goto fail;
+        }
+        s->nvme_passthrough = true;
+
+        /* Let the block layer emulate these with normal writes */
+        s->has_discard = false;
+        s->has_write_zeroes = false;
+    }
+#endif
 #ifdef CONFIG_BLKZONED
     /*
      * The kernel page cache does not reliably work for writes to SWR zones
@@ -1543,6 +1669,24 @@ static void raw_refresh_limits(BlockDriverState *bs, Error **errp)
     BDRVRawState *s = bs->opaque;
     struct stat st;
 
+#ifdef HAVE_IO_URING_CMD
+    if (s->nvme_passthrough) {
+        /*
+         * The generic character device has no read()/write() to probe, and
+         * no queue limits in sysfs.  128 KiB stays below the MDTS of any
+         * controller one would reasonably pass through.
+         */
+        s->needs_alignment = true;
+        s->buf_align = 4;
+        bs->bl.request_alignment = 1 << s->nvme_lba_shift;
+        bs->bl.min_mem_alignment = s->buf_align;
+        bs->bl.opt_mem_alignment = qemu_real_host_page_size();
+        bs->bl.max_hw_transfer = 128 * KiB;
+        bs->bl.max_transfer = bs->bl.max_hw_transfer;
+        return;
+    }
+#endif
+
     s->needs_alignment = raw_needs_alignment(bs);
     raw_probe_alignment(bs, s->fd, errp);
 
@@ -2543,6 +2687,26 @@ static inline bool raw_check_linux_io_uring(BDRVRawState *s)
 }
 #endif
 
+#ifdef HAVE_IO_URING_CMD
+/*
+ * Passthrough commands use a ring of their own in each AioContext, which
+ * is set up on first use.  There is no fallback if that fails, since NVMe
+ * generic character devices only accept passthrough commands.
+ */
+static inline bool raw_check_nvme_passthrough(void)
+{
+    Error *local_err = NULL;
+    AioContext *ctx;
+
+    ctx = qemu_get_current_aio_context();
+    if (unlikely(!aio_setup_linux_io_uring_cmd(ctx, &local_err))) {
+        error_report_err(local_err);
+        return false;
+    }
+    return true;
+}
+#endif
+
 #ifdef CONFIG_LINUX_AIO
 static inline bool raw_check_linux_aio(BDRVRawState *s)
 {
@@ -2564,6 +2728,36 @@ static inline bool raw_check_linux_aio(BDRVRawState *s)
 }
 #endif
 
+#ifdef CONFIG_PREADV2_NOWAIT
+/*
+ * Try to complete a read directly from the host page cache, without blocking
+ * and without the round trip through the thread pool.  Returns true if the
+ * whole request was satisfied.  Anything else, including short reads that
+ * may be caused by partially cached data, is left to the thread pool.
+ */
+static bool raw_preadv_nowait(BDRVRawState *s, uint64_t offset,
+                              QEMUIOVector *qiov)
+{
+    ssize_t len;
+
+    len = RETRY_ON_EINTR(preadv2(s->fd, qiov->iov, qiov->niov, offset,
+                                 RWF_NOWAIT));
+    if (len >= 0 && len == qiov->size) {
+        s->stats.read_nowait_hits++;
+        return true;
+    }
+
+    if (len < 0 && errno == EOPNOTSUPP) {
+        /* The file system does not support RWF_NOWAIT, don't try again */
+        s->read_nowait = false;
+        return false;
+    }
+
+    s->stats.read_nowait_misses++;
+    return false;
+}
+#endif
+
 static int coroutine_fn GRAPH_RDLOCK
 raw_co_prw(BlockDriverState *bs, int64_t *offset_ptr, uint64_t bytes,
            QEMUIOVector *qiov, int type, int flags)
@@ -2586,6 +2780,19 @@ raw_co_prw(BlockDriverState *bs, int64_t *offset_ptr, uint64_t bytes,
     }
 #endif
 
+#ifdef HAVE_IO_URING_CMD
+    if (s->nvme_passthrough) {
+        assert(qiov->size == bytes);
+        if (!raw_check_nvme_passthrough()) {
+            ret = -EIO;
+            goto out;
+        }
+        ret = luring_co_submit_nvme(bs, s->fd, s->nvme_nsid, s->nvme_lba_shift,
+                                    offset, qiov, type, flags);
+        goto out;
+    }
+#endif
+
     /*
      * When using O_DIRECT, the request must be aligned to be able to use
      * either libaio or io_uring interface. If not fail back to regular thread
@@ -2595,9 +2802,12 @@ raw_co_prw(BlockDriverState *bs, int64_t *offset_ptr, uint64_t bytes,
     if (s->needs_alignment && !bdrv_qiov_is_aligned(bs, qiov)) {
         type |= QEMU_AIO_MISALIGNED;
 #ifdef CONFIG_LINUX_IO_URING
-    } else if (raw_check_linux_io_uring(s)) {
+    } else if (raw_check_linux_io_uring(s) &&
+               (!luring_has_iopoll() || (s->open_flags & O_DIRECT))) {
+        /* IOPOLL rings can't complete buffered I/O */
         assert(qiov->size == bytes);
-        ret = luring_co_submit(bs, s->fd, offset, qiov, type, flags);
+        ret = luring_co_submit(bs, s->fd, offset, qiov, type, flags,
+                               s->aio_fixed);
         goto out;
 #endif
 #ifdef CONFIG_LINUX_AIO
@@ -2609,6 +2819,17 @@ raw_co_prw(BlockDriverState *bs, int64_t *offset_ptr, uint64_t bytes,
 #endif
     }
 
+#ifdef CONFIG_PREADV2_NOWAIT
+    if (s->read_nowait && type == QEMU_AIO_READ &&
+        !(s->open_flags & O_DIRECT)) {
+        assert(qiov->size == bytes);
+        if (raw_preadv_nowait(s, offset, qiov)) {
+            ret = 0;
+            goto out;
+        }
+    }
+#endif
+
     acb = (RawPosixAIOData) {
         .bs             = bs,
         .aio_fildes     = s->fd,
@@ -2691,9 +2912,20 @@ static int coroutine_fn raw_co_flush_to_disk(BlockDriverState *bs)
         .aio_type       = QEMU_AIO_FLUSH,
     };
 
+#ifdef HAVE_IO_URING_CMD
+    if (s->nvme_passthrough) {
+        if (!raw_check_nvme_passthrough()) {
+            return -EIO;
+        }
+        return luring_co_submit_nvme(bs, s->fd, s->nvme_nsid,
+                                     s->nvme_lba_shift, 0, NULL,
+                                     QEMU_AIO_FLUSH, 0);
+    }
+#endif
 #ifdef CONFIG_LINUX_IO_URING
-    if (raw_check_linux_io_uring(s)) {
-        return luring_co_submit(bs, s->fd, 0, NULL, QEMU_AIO_FLUSH, 0);
+    if (raw_check_linux_io_uring(s) && !luring_has_iopoll()) {
+        return luring_co_submit(bs, s->fd, 0, NULL, QEMU_AIO_FLUSH, 0,
+                                s->aio_fixed);
     }
 #endif
 #ifdef CONFIG_LINUX_AIO
@@ -2711,6 +2943,11 @@ static void raw_close(BlockDriverState *bs)
     if (s->fd >= 0) {
 #if defined(CONFIG_BLKZONED)
         g_free(bs->wps);
+#endif
+#ifdef CONFIG_LINUX_IO_URING
+        if (s->aio_fixed) {
+            luring_unregister_fd(s->fd);
+        }
 #endif
         qemu_close(s->fd);
         s->fd = -1;
@@ -2955,6 +3192,13 @@ static int64_t raw_getlength(BlockDriverState *bs)
 
 static int64_t coroutine_fn raw_co_getlength(BlockDriverState *bs)
 {
+#ifdef HAVE_IO_URING_CMD
+    BDRVRawState *s = bs->opaque;
+
+    if (s->nvme_passthrough) {
+        return s->nvme_size;
+    }
+#endif
     return raw_getlength(bs);
 }
 
@@ -3785,9 +4029,33 @@ static BlockStatsSpecificFile get_blockstats_specific_file(BlockDriverState *bs)
         .discard_nb_ok = s->stats.discard_nb_ok,
         .discard_nb_failed = s->stats.discard_nb_failed,
         .discard_bytes_ok = s->stats.discard_bytes_ok,
+        .read_nowait_hits = s->stats.read_nowait_hits,
+        .read_nowait_misses = s->stats.read_nowait_misses,
     };
 }
 
+#ifdef CONFIG_LINUX_IO_URING
+static bool raw_register_buf(BlockDriverState *bs, void *host, size_t size,
+                             Error **errp)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (s->aio_fixed) {
+        luring_register_buf(host, size);
+    }
+    return true;
+}
+
+static void raw_unregister_buf(BlockDriverState *bs, void *host, size_t size)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (s->aio_fixed) {
+        luring_unregister_buf(host, size);
+    }
+}
+#endif
+
 static BlockStatsSpecific *raw_get_specific_stats(BlockDriverState *bs)
 {
     BlockStatsSpecific *stats = g_new(BlockStatsSpecific, 1);
@@ -3904,6 +4172,11 @@ static void raw_set_perm(BlockDriverState *bs, uint64_t perm, uint64_t shared)
     /* For reopen, we have already switched to the new fd (.bdrv_set_perm is
      * called after .bdrv_reopen_commit) */
     if (s->perm_change_fd && s->fd != s->perm_change_fd) {
+#ifdef CONFIG_LINUX_IO_URING
+        if (s->aio_fixed) {
+            luring_unregister_fd(s->fd);
+        }
+#endif
         qemu_close(s->fd);
         s->fd = s->perm_change_fd;
         s->open_flags = s->perm_change_flags;
@@ -4008,6 +4281,10 @@ BlockDriver bdrv_file = {
     .bdrv_get_specific_info             = raw_get_specific_info,
     .bdrv_co_get_allocated_file_size    = raw_co_get_allocated_file_size,
     .bdrv_get_specific_stats = raw_get_specific_stats,
+#ifdef CONFIG_LINUX_IO_URING
+    .bdrv_register_buf = raw_register_buf,
+    .bdrv_unregister_buf = raw_unregister_buf,
+#endif
     .bdrv_check_perm = raw_check_perm,
     .bdrv_set_perm   = raw_set_perm,
     .bdrv_abort_perm_update = raw_abort_perm_update,
@@ -4466,6 +4743,10 @@ static BlockDriver bdrv_host_device = {
     .bdrv_get_specific_info             = raw_get_specific_info,
     .bdrv_co_get_allocated_file_size    = raw_co_get_allocated_file_size,
     .bdrv_get_specific_stats = hdev_get_specific_stats,
+#ifdef CONFIG_LINUX_IO_URING
+    .bdrv_register_buf = raw_register_buf,
+    .bdrv_unregister_buf = raw_unregister_buf,
+#endif
     .bdrv_check_perm = raw_check_perm,
     .bdrv_set_perm   = raw_set_perm,
     .bdrv_abort_perm_update = raw_abort_perm_update,
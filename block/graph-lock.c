@@ -20,6 +20,8 @@
 
 #include "qemu/osdep.h"
 #include "qemu/main-loop.h"
+#include "qemu/memalign.h"
+#include "qemu/sys_membarrier.h"
 #include "block/graph-lock.h"
 #include "block/block.h"
 #include "block/block_int.h"
@@ -30,8 +32,17 @@ BdrvGraphLock graph_lock;
 /* Protects the list of aiocontext and orphaned_reader_count */
 static QemuMutex aio_context_list_lock;
 
+/*
+ * The per-AioContext reader counts and has_writer are accessed on every
+ * rdlock/rdunlock, so keep each of them on its own cache line to avoid false
+ * sharing between threads.
+ */
+#define BDRV_GRAPH_LOCK_ALIGN 64
+
 /* Written and read with atomic operations. */
-static int has_writer;
+static struct {
+    int has_writer;
+} QEMU_ALIGNED(BDRV_GRAPH_LOCK_ALIGN) writer_state;
 
 /*
  * Many write-locked sections are also drained sections. There is a convenience
@@ -67,7 +78,7 @@ struct BdrvGraphRWlock {
      * Protected by aio_context_list_lock
      */
     QTAILQ_ENTRY(BdrvGraphRWlock) next_aio;
-};
+} QEMU_ALIGNED(BDRV_GRAPH_LOCK_ALIGN);
 
 /*
  * List of BdrvGraphRWlock. This list ensures that each BdrvGraphRWlock
@@ -85,7 +96,9 @@ static void __attribute__((__constructor__)) bdrv_init_graph_lock(void)
 
 void register_aiocontext(AioContext *ctx)
 {
-    ctx->bdrv_graph = g_new0(BdrvGraphRWlock, 1);
+    ctx->bdrv_graph = qemu_memalign(BDRV_GRAPH_LOCK_ALIGN,
+                                    sizeof(BdrvGraphRWlock));
+    memset(ctx->bdrv_graph, 0, sizeof(BdrvGraphRWlock));
     QEMU_LOCK_GUARD(&aio_context_list_lock);
     assert(ctx->bdrv_graph->reader_count == 0);
     QTAILQ_INSERT_TAIL(&aio_context_list, ctx->bdrv_graph, next_aio);
@@ -96,7 +109,7 @@ void unregister_aiocontext(AioContext *ctx)
     QEMU_LOCK_GUARD(&aio_context_list_lock);
     orphaned_reader_count += ctx->bdrv_graph->reader_count;
     QTAILQ_REMOVE(&aio_context_list, ctx->bdrv_graph, next_aio);
-    g_free(ctx->bdrv_graph);
+    qemu_vfree(ctx->bdrv_graph);
 }
 
 static uint32_t reader_count(void)
@@ -120,7 +133,7 @@ static uint32_t reader_count(void)
 void no_coroutine_fn bdrv_graph_wrlock(void)
 {
     GLOBAL_STATE_CODE();
-    assert(!qatomic_read(&has_writer));
+    assert(!qatomic_read(&writer_state.has_writer));
     assert(!qemu_in_coroutine());
 
     bool need_drain = wrlock_quiesced_counter == 0;
@@ -144,16 +157,20 @@ void no_coroutine_fn bdrv_graph_wrlock(void)
          * any callback involved during AIO_WAIT_WHILE() tries to acquire the
          * reader lock.
          */
-        qatomic_set(&has_writer, 0);
+        qatomic_set(&writer_state.has_writer, 0);
         AIO_WAIT_WHILE_UNLOCKED(NULL, reader_count() >= 1);
-        qatomic_set(&has_writer, 1);
+        qatomic_set(&writer_state.has_writer, 1);
 
         /*
          * We want to only check reader_count() after has_writer = 1 is visible
          * to other threads. That way no more readers can sneak in after we've
          * determined reader_count() == 0.
+         *
+         * This pairs with smp_mb_placeholder() in the reader fast path: the
+         * writer pays for a process-wide barrier so that readers only need a
+         * compiler barrier when membarrier is available.
          */
-        smp_mb();
+        smp_mb_global();
     } while (reader_count() >= 1);
 
     if (need_drain) {
@@ -173,14 +190,14 @@ void no_coroutine_fn bdrv_graph_wrlock_drained(void)
 void no_coroutine_fn bdrv_graph_wrunlock(void)
 {
     GLOBAL_STATE_CODE();
-    assert(qatomic_read(&has_writer));
+    assert(qatomic_read(&writer_state.has_writer));
 
     WITH_QEMU_LOCK_GUARD(&aio_context_list_lock) {
         /*
          * No need for memory barriers, this works in pair with
          * the slow path of rdlock() and both take the lock.
          */
-        qatomic_store_release(&has_writer, 0);
+        qatomic_store_release(&writer_state.has_writer, 0);
 
         /* Wake up all coroutines that are waiting to read the graph */
         qemu_co_enter_all(&reader_queue, &aio_context_list_lock);
@@ -212,8 +229,11 @@ void coroutine_fn bdrv_graph_co_rdlock(void)
     for (;;) {
         qatomic_set(&bdrv_graph->reader_count,
                     bdrv_graph->reader_count + 1);
-        /* make sure writer sees reader_count before we check has_writer */
-        smp_mb();
+        /*
+         * make sure writer sees reader_count before we check has_writer,
+         * pairs with smp_mb_global() in bdrv_graph_wrlock()
+         */
+        smp_mb_placeholder();
 
         /*
          * has_writer == 0: this means writer will read reader_count as >= 1
@@ -221,7 +241,7 @@ void coroutine_fn bdrv_graph_co_rdlock(void)
          *                  or > 0, but we need to wait anyways because
          *                  it will write.
          */
-        if (!qatomic_read(&has_writer)) {
+        if (!qatomic_read(&writer_state.has_writer)) {
             break;
         }
 
@@ -255,7 +275,7 @@ void coroutine_fn bdrv_graph_co_rdlock(void)
              * again for has_writer, otherwise we sleep without any writer
              * actually running.
              */
-            if (!qatomic_read(&has_writer)) {
+            if (!qatomic_read(&writer_state.has_writer)) {
                 return;
             }
 
@@ -274,8 +294,11 @@ void coroutine_fn bdrv_graph_co_rdunlock(void)
 
     qatomic_store_release(&bdrv_graph->reader_count,
                           bdrv_graph->reader_count - 1);
-    /* make sure writer sees reader_count before we check has_writer */
-    smp_mb();
+    /*
+     * make sure writer sees reader_count before we check has_writer,
+     * pairs with smp_mb_global() in bdrv_graph_wrlock()
+     */
+    smp_mb_placeholder();
 
     /*
      * has_writer == 0: this means reader will read reader_count decreased
@@ -283,7 +306,7 @@ void coroutine_fn bdrv_graph_co_rdunlock(void)
      *                  new. Therefore, kick again so on next iteration
      *                  writer will for sure read the updated value.
      */
-    if (qatomic_read(&has_writer)) {
+    if (qatomic_read(&writer_state.has_writer)) {
         aio_wait_kick();
     }
 }
@@ -311,5 +334,5 @@ void assert_bdrv_graph_readable(void)
 void assert_bdrv_graph_writable(void)
 {
     assert(qemu_in_main_thread());
-    assert(qatomic_read(&has_writer));
+    assert(qatomic_read(&writer_state.has_writer));
 }
@@ -977,7 +977,7 @@ bdrv_driver_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
     BlockDriver *drv = bs->drv;
     int64_t sector_num;
     unsigned int nb_sectors;
-    QEMUIOVector local_qiov;
+    QEMUIOVectorInline local_qiov;
     int ret;
     assert_bdrv_graph_readable();
 
@@ -994,8 +994,8 @@ bdrv_driver_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
     }
 
     if (qiov_offset > 0 || bytes != qiov->size) {
-        qemu_iovec_init_slice(&local_qiov, qiov, qiov_offset, bytes);
-        qiov = &local_qiov;
+        qemu_iovec_init_slice_inline(&local_qiov, qiov, qiov_offset, bytes);
+        qiov = &local_qiov.qiov;
     }
 
     if (drv->bdrv_co_preadv) {
@@ -1032,8 +1032,8 @@ bdrv_driver_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
     ret = drv->bdrv_co_readv(bs, sector_num, nb_sectors, qiov);
 
 out:
-    if (qiov == &local_qiov) {
-        qemu_iovec_destroy(&local_qiov);
+    if (qiov == &local_qiov.qiov) {
+        qemu_iovec_destroy(&local_qiov.qiov);
     }
 
     return ret;
@@ -1048,7 +1048,7 @@ bdrv_driver_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
     bool emulate_fua = false;
     int64_t sector_num;
     unsigned int nb_sectors;
-    QEMUIOVector local_qiov;
+    QEMUIOVectorInline local_qiov;
     int ret;
     assert_bdrv_graph_readable();
 
@@ -1077,8 +1077,8 @@ bdrv_driver_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
     }
 
     if (qiov_offset > 0 || bytes != qiov->size) {
-        qemu_iovec_init_slice(&local_qiov, qiov, qiov_offset, bytes);
-        qiov = &local_qiov;
+        qemu_iovec_init_slice_inline(&local_qiov, qiov, qiov_offset, bytes);
+        qiov = &local_qiov.qiov;
     }
 
     if (drv->bdrv_co_pwritev) {
@@ -1118,8 +1118,8 @@ emulate_flags:
         ret = bdrv_co_flush(bs);
     }
 
-    if (qiov == &local_qiov) {
-        qemu_iovec_destroy(&local_qiov);
+    if (qiov == &local_qiov.qiov) {
+        qemu_iovec_destroy(&local_qiov.qiov);
     }
 
     return ret;
@@ -1427,6 +1427,12 @@ out:
     return ret < 0 ? ret : 0;
 }
 
+/*
+ * Padded vectors with up to this many elements are built in
+ * BdrvRequestPadding.inline_iov rather than in a heap-allocated array
+ */
+#define BDRV_PADDING_INLINE_IOV 16
+
 /*
  * Request padding
  *
@@ -1470,6 +1476,9 @@ typedef struct BdrvRequestPadding {
     uint8_t *collapse_bounce_buf;
     size_t collapse_len;
     QEMUIOVector pre_collapse_qiov;
+
+    /* Must be last, it is not cleared by bdrv_init_padding() */
+    struct iovec inline_iov[BDRV_PADDING_INLINE_IOV];
 } BdrvRequestPadding;
 
 static bool bdrv_init_padding(BlockDriverState *bs,
@@ -1484,7 +1493,7 @@ static bool bdrv_init_padding(BlockDriverState *bs,
     assert(align <= INT_MAX); /* documented in block/block_int.h */
     assert(align <= SIZE_MAX / 2); /* so we can allocate the buffer */
 
-    memset(pad, 0, sizeof(*pad));
+    memset(pad, 0, offsetof(BdrvRequestPadding, inline_iov));
 
     pad->head = offset & (align - 1);
     pad->tail = ((offset + bytes) & (align - 1));
@@ -1593,7 +1602,7 @@ static void bdrv_padding_finalize(BdrvRequestPadding *pad)
         qemu_vfree(pad->buf);
         qemu_iovec_destroy(&pad->local_qiov);
     }
-    memset(pad, 0, sizeof(*pad));
+    memset(pad, 0, offsetof(BdrvRequestPadding, inline_iov));
 }
 
 /*
@@ -1631,6 +1640,36 @@ static int bdrv_create_padded_qiov(BlockDriverState *bs,
     /* Length of the resulting IOV if we just concatenated everything */
     padded_niov = !!pad->head + niov + !!pad->tail;
 
+    /*
+     * Small vectors are the common case, build them in place so that padding
+     * a request does not need to allocate an iovec array.  qemu_iovec_destroy()
+     * leaves such external vectors alone.
+     */
+    if (padded_niov <= BDRV_PADDING_INLINE_IOV) {
+        struct iovec *dst = pad->inline_iov;
+        int n = 0;
+
+        if (pad->head) {
+            dst[n++] = (struct iovec) {
+                .iov_base = pad->buf,
+                .iov_len = pad->head,
+            };
+        }
+        n += iov_copy(dst + n, BDRV_PADDING_INLINE_IOV - n,
+                      iov, niov, iov_offset, bytes);
+        if (pad->tail) {
+            dst[n++] = (struct iovec) {
+                .iov_base = pad->buf + pad->buf_len - pad->tail,
+                .iov_len = pad->tail,
+            };
+        }
+
+        qemu_iovec_init_external(&pad->local_qiov, dst, n);
+        assert(pad->local_qiov.niov == padded_niov);
+        return 0;
+    }
+
+    trace_bdrv_create_padded_qiov_alloc(bs, padded_niov);
     qemu_iovec_init(&pad->local_qiov, MIN(padded_niov, IOV_MAX));
 
     if (pad->head) {
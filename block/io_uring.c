@@ -10,12 +10,18 @@
  */
 #include "qemu/osdep.h"
 #include <liburing.h>
+#ifdef HAVE_IO_URING_CMD
+#include <linux/nvme_ioctl.h>
+#endif
 #include "block/aio.h"
+#include "block/nvme.h"
 #include "qemu/queue.h"
 #include "block/block.h"
 #include "block/raw-aio.h"
 #include "qemu/coroutine.h"
 #include "qemu/defer-call.h"
+#include "qemu/lockable.h"
+#include "qemu/units.h"
 #include "qapi/error.h"
 #include "system/block-backend.h"
 #include "trace.h"
@@ -23,15 +29,26 @@
 /* Only used for assertions.  */
 #include "qemu/coroutine_int.h"
 
-/* io_uring ring size */
-#define MAX_ENTRIES 128
+/* Default io_uring ring size, see AioIoUringParams.queue_depth */
+#define DEFAULT_ENTRIES 128
+
+/* Number of slots in the registered file table of each ring */
+#define MAX_FIXED_FILES 64
+
+/* The kernel limits each registered buffer to 1 GiB */
+#define MAX_FIXED_BUF_SIZE (1 * GiB)
 
 typedef struct LuringAIOCB {
     Coroutine *co;
-    struct io_uring_sqe sqeq;
+    union {
+        struct io_uring_sqe sqeq;
+        /* IORING_OP_URING_CMD needs a big SQE, see luring_init() */
+        uint8_t sqe128[128];
+    };
     ssize_t ret;
     QEMUIOVector *qiov;
     bool is_read;
+    bool is_cmd;
     QSIMPLEQ_ENTRY(LuringAIOCB) next;
 
     /*
@@ -58,8 +75,63 @@ struct LuringState {
     LuringQueue io_q;
 
     QEMUBH *completion_bh;
+
+    /* Number of sqes in the ring */
+    unsigned int queue_depth;
+
+    /* The ring was set up with IORING_SETUP_IOPOLL */
+    bool iopoll;
+
+    /*
+     * The ring was set up with big SQEs/CQEs for IORING_OP_URING_CMD.  Such
+     * a ring only carries NVMe passthrough commands, see
+     * aio_setup_linux_io_uring_cmd().
+     */
+    bool has_uring_cmd;
+
+    /*
+     * Buffers registered with the ring, a copy of luring_bufs sorted by
+     * address, with regions larger than MAX_FIXED_BUF_SIZE split up.  Only
+     * accessed from the AioContext home thread.
+     */
+    struct iovec *fixed_bufs;
+    unsigned int nr_fixed_bufs;
+    unsigned int fixed_bufs_gen;
+
+    /*
+     * fd in each slot of the registered file table, -1 for free slots.
+     * Slots are filled by the home thread and cleared by
+     * luring_unregister_fd() from any thread, both under luring_lock.
+     */
+    int fixed_fds[MAX_FIXED_FILES];
+    bool has_fixed_files;
+
+    QLIST_ENTRY(LuringState) next;
 };
 
+typedef struct LuringBuf {
+    void *host;
+    size_t size;
+    unsigned int refcnt;
+} LuringBuf;
+
+/*
+ * Memory registered with luring_register_buf().  Rings pick up changes the
+ * next time they submit a request with BDRV_REQ_REGISTERED_BUF and are idle,
+ * see luring_sync_fixed_bufs().  Protected by luring_lock.
+ */
+static QemuMutex luring_lock;
+static GArray *luring_bufs;
+static unsigned int luring_bufs_gen;
+static QLIST_HEAD(, LuringState) luring_states =
+    QLIST_HEAD_INITIALIZER(luring_states);
+
+static void __attribute__((constructor)) luring_init_globals(void)
+{
+    qemu_mutex_init(&luring_lock);
+    luring_bufs = g_array_new(false, false, sizeof(LuringBuf));
+}
+
 /**
  * luring_resubmit:
  *
@@ -100,6 +172,12 @@ static void luring_resubmit_short_read(LuringState *s, LuringAIOCB *luringcb,
     qemu_iovec_concat(resubmit_qiov, luringcb->qiov, luringcb->total_read,
                       remaining);
 
+    /* Fixed buffer reads continue as vectored reads into the same memory */
+    if (luringcb->sqeq.opcode == IORING_OP_READ_FIXED) {
+        luringcb->sqeq.opcode = IORING_OP_READV;
+        luringcb->sqeq.buf_index = 0;
+    }
+
     /* Update sqe */
     luringcb->sqeq.off += nread;
     luringcb->sqeq.addr = (uintptr_t)luringcb->resubmit_qiov.iov;
@@ -165,6 +243,18 @@ static void luring_process_completions(LuringState *s)
         /* total_read is non-zero only for resubmitted read requests */
         total_bytes = ret + luringcb->total_read;
 
+        if (luringcb->is_cmd) {
+            /* NVMe passthrough: res is -errno, 0 or a positive NVMe status */
+            if (ret == -EINTR || ret == -EAGAIN) {
+                luring_resubmit(s, luringcb);
+                continue;
+            }
+            if (ret > 0) {
+                ret = -EIO;
+            }
+            goto end;
+        }
+
         if (ret < 0) {
             /*
              * Only writev/readv/fsync requests on regular files or host block
@@ -221,7 +311,14 @@ end:
         }
     }
 
-    qemu_bh_cancel(s->completion_bh);
+    /*
+     * IOPOLL rings only post cqes when polled, which io_uring_peek_cqe()
+     * does.  Keep the BH scheduled so the event loop spins until all
+     * requests have completed instead of blocking on the ring fd.
+     */
+    if (!s->iopoll || !s->io_q.in_flight) {
+        qemu_bh_cancel(s->completion_bh);
+    }
 
     defer_call_end();
 }
@@ -243,7 +340,11 @@ static int ioq_submit(LuringState *s)
                 break;
             }
             /* Prep sqe for submission */
-            *sqes = luringcb->sqeq;
+            if (luringcb->is_cmd) {
+                memcpy(sqes, luringcb->sqe128, sizeof(luringcb->sqe128));
+            } else {
+                *sqes = luringcb->sqeq;
+            }
             QSIMPLEQ_REMOVE_HEAD(&s->io_q.submit_queue, next);
         }
         ret = io_uring_submit(&s->ring);
@@ -323,6 +424,8 @@ static void luring_deferred_fn(void *opaque)
     }
 }
 
+static int luring_queue(LuringState *s, LuringAIOCB *luringcb);
+
 /**
  * luring_do_submit:
  * @fd: file descriptor for I/O
@@ -335,13 +438,24 @@ static void luring_deferred_fn(void *opaque)
  *
  */
 static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
-                            uint64_t offset, int type, BdrvRequestFlags flags)
+                            uint64_t offset, int type, BdrvRequestFlags flags,
+                            int buf_index, int file_index)
 {
-    int ret;
     struct io_uring_sqe *sqes = &luringcb->sqeq;
 
     switch (type) {
     case QEMU_AIO_WRITE:
+        if (buf_index >= 0) {
+            io_uring_prep_write_fixed(sqes, fd, luringcb->qiov->iov[0].iov_base,
+                                      luringcb->qiov->iov[0].iov_len, offset,
+                                      buf_index);
+#ifdef HAVE_IO_URING_PREP_WRITEV2
+            sqes->rw_flags = (flags & BDRV_REQ_FUA) ? RWF_DSYNC : 0;
+#else
+            assert(flags == 0);
+#endif
+            break;
+        }
 #ifdef HAVE_IO_URING_PREP_WRITEV2
     {
         int luring_flags = (flags & BDRV_REQ_FUA) ? RWF_DSYNC : 0;
@@ -359,6 +473,12 @@ static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
                              luringcb->qiov->niov, offset);
         break;
     case QEMU_AIO_READ:
+        if (buf_index >= 0) {
+            io_uring_prep_read_fixed(sqes, fd, luringcb->qiov->iov[0].iov_base,
+                                     luringcb->qiov->iov[0].iov_len, offset,
+                                     buf_index);
+            break;
+        }
         io_uring_prep_readv(sqes, fd, luringcb->qiov->iov,
                             luringcb->qiov->niov, offset);
         break;
@@ -370,14 +490,32 @@ static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
                         __func__, type);
         abort();
     }
+    if (file_index >= 0) {
+        sqes->fd = file_index;
+        sqes->flags |= IOSQE_FIXED_FILE;
+    }
     io_uring_sqe_set_data(sqes, luringcb);
 
+    return luring_queue(s, luringcb);
+}
+
+/*
+ * luring_queue:
+ * @s: AIO state
+ * @luringcb: AIO control block with a prepared sqe
+ *
+ * Adds the request to the pending queue and submits it when appropriate.
+ */
+static int luring_queue(LuringState *s, LuringAIOCB *luringcb)
+{
+    int ret;
+
     QSIMPLEQ_INSERT_TAIL(&s->io_q.submit_queue, luringcb, next);
     s->io_q.in_queue++;
     trace_luring_do_submit(s, s->io_q.blocked, s->io_q.in_queue,
                            s->io_q.in_flight);
     if (!s->io_q.blocked) {
-        if (s->io_q.in_flight + s->io_q.in_queue >= MAX_ENTRIES) {
+        if (s->io_q.in_flight + s->io_q.in_queue >= s->queue_depth) {
             ret = ioq_submit(s);
             trace_luring_do_submit_done(s, ret);
             return ret;
@@ -388,13 +526,204 @@ static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
     return 0;
 }
 
+static int luring_cmp_fixed_buf(const void *a, const void *b)
+{
+    const struct iovec *x = a, *y = b;
+
+    if (x->iov_base == y->iov_base) {
+        return 0;
+    }
+    return (uintptr_t)x->iov_base < (uintptr_t)y->iov_base ? -1 : 1;
+}
+
+/*
+ * Bring the buffers registered with the ring of @s up to date with
+ * luring_bufs.  The table can only be replaced safely while the ring is idle,
+ * so this may have to be retried later.
+ *
+ * Returns: true if the registered buffers of @s can be used
+ */
+static bool luring_sync_fixed_bufs(LuringState *s)
+{
+    struct iovec *iov;
+    unsigned int nr = 0, gen, i;
+    int ret;
+
+    if (s->fixed_bufs_gen == qatomic_read(&luring_bufs_gen)) {
+        return true;
+    }
+    if (s->io_q.in_flight || s->io_q.in_queue) {
+        return false;
+    }
+
+    qemu_mutex_lock(&luring_lock);
+    gen = luring_bufs_gen;
+    iov = NULL;
+    for (i = 0; i < luring_bufs->len; i++) {
+        LuringBuf *b = &g_array_index(luring_bufs, LuringBuf, i);
+        size_t done;
+
+        for (done = 0; done < b->size; done += MAX_FIXED_BUF_SIZE) {
+            iov = g_renew(struct iovec, iov, nr + 1);
+            iov[nr].iov_base = (uint8_t *)b->host + done;
+            iov[nr].iov_len = MIN(b->size - done, MAX_FIXED_BUF_SIZE);
+            nr++;
+        }
+    }
+    qemu_mutex_unlock(&luring_lock);
+
+    if (s->nr_fixed_bufs) {
+        io_uring_unregister_buffers(&s->ring);
+    }
+    g_free(s->fixed_bufs);
+    s->fixed_bufs = NULL;
+    s->nr_fixed_bufs = 0;
+
+    if (nr) {
+        qsort(iov, nr, sizeof(*iov), luring_cmp_fixed_buf);
+        ret = io_uring_register_buffers(&s->ring, iov, nr);
+        trace_luring_register_buffers(s, nr, ret);
+        if (ret < 0) {
+            /* Typically RLIMIT_MEMLOCK; keep going without fixed buffers */
+            g_free(iov);
+        } else {
+            s->fixed_bufs = iov;
+            s->nr_fixed_bufs = nr;
+        }
+    }
+
+    s->fixed_bufs_gen = gen;
+    return true;
+}
+
+/* Returns the index of the registered buffer that contains @iov or -1 */
+static int luring_fixed_buf_index(LuringState *s, const struct iovec *iov)
+{
+    uintptr_t start = (uintptr_t)iov->iov_base;
+    int lo = 0, hi = (int)s->nr_fixed_bufs - 1;
+
+    if (!luring_sync_fixed_bufs(s)) {
+        return -1;
+    }
+
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        uintptr_t base = (uintptr_t)s->fixed_bufs[mid].iov_base;
+
+        if (start < base) {
+            hi = mid - 1;
+        } else if (start - base >= s->fixed_bufs[mid].iov_len) {
+            lo = mid + 1;
+        } else {
+            if (iov->iov_len <= s->fixed_bufs[mid].iov_len - (start - base)) {
+                return mid;
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/* Returns the registered file table slot for @fd, registering it if needed */
+static int luring_fixed_file_index(LuringState *s, int fd)
+{
+    int i, slot = -1;
+
+    if (!s->has_fixed_files) {
+        return -1;
+    }
+
+    for (i = 0; i < MAX_FIXED_FILES; i++) {
+        if (qatomic_read(&s->fixed_fds[i]) == fd) {
+            return i;
+        }
+    }
+
+    qemu_mutex_lock(&luring_lock);
+    for (i = 0; i < MAX_FIXED_FILES; i++) {
+        if (s->fixed_fds[i] == -1) {
+            int ret = io_uring_register_files_update(&s->ring, i, &fd, 1);
+
+            trace_luring_register_file(s, fd, i, ret);
+            if (ret == 1) {
+                qatomic_set(&s->fixed_fds[i], fd);
+                slot = i;
+            }
+            break;
+        }
+    }
+    qemu_mutex_unlock(&luring_lock);
+
+    return slot;
+}
+
+void luring_register_buf(void *host, size_t size)
+{
+    LuringBuf *b, new_buf = {
+        .host = host,
+        .size = size,
+        .refcnt = 1,
+    };
+    unsigned int i;
+
+    QEMU_LOCK_GUARD(&luring_lock);
+    for (i = 0; i < luring_bufs->len; i++) {
+        b = &g_array_index(luring_bufs, LuringBuf, i);
+        if (b->host == host && b->size == size) {
+            b->refcnt++;
+            return;
+        }
+    }
+
+    g_array_append_val(luring_bufs, new_buf);
+    qatomic_inc(&luring_bufs_gen);
+}
+
+void luring_unregister_buf(void *host, size_t size)
+{
+    unsigned int i;
+
+    QEMU_LOCK_GUARD(&luring_lock);
+    for (i = 0; i < luring_bufs->len; i++) {
+        LuringBuf *b = &g_array_index(luring_bufs, LuringBuf, i);
+
+        if (b->host == host && b->size == size) {
+            if (--b->refcnt == 0) {
+                g_array_remove_index_fast(luring_bufs, i);
+                qatomic_inc(&luring_bufs_gen);
+            }
+            return;
+        }
+    }
+}
+
+void luring_unregister_fd(int fd)
+{
+    LuringState *s;
+    int i;
+
+    QEMU_LOCK_GUARD(&luring_lock);
+    QLIST_FOREACH(s, &luring_states, next) {
+        for (i = 0; i < MAX_FIXED_FILES; i++) {
+            if (s->fixed_fds[i] == fd) {
+                int unused = -1;
+
+                io_uring_register_files_update(&s->ring, i, &unused, 1);
+                qatomic_set(&s->fixed_fds[i], -1);
+            }
+        }
+    }
+}
+
 int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, uint64_t offset,
                                   QEMUIOVector *qiov, int type,
-                                  BdrvRequestFlags flags)
+                                  BdrvRequestFlags flags, bool fixed_file)
 {
     int ret;
     AioContext *ctx = qemu_get_current_aio_context();
     LuringState *s = aio_get_linux_io_uring(ctx);
+    int buf_index = -1;
+    int file_index = -1;
     LuringAIOCB luringcb = {
         .co         = qemu_coroutine_self(),
         .ret        = -EINPROGRESS,
@@ -403,7 +732,20 @@ int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, uint64_t offset,
     };
     trace_luring_co_submit(bs, s, &luringcb, fd, offset, qiov ? qiov->size : 0,
                            type);
-    ret = luring_do_submit(fd, &luringcb, s, offset, type, flags);
+
+    if ((flags & BDRV_REQ_REGISTERED_BUF) &&
+        (type == QEMU_AIO_READ || type == QEMU_AIO_WRITE) &&
+        qiov->niov == 1) {
+        buf_index = luring_fixed_buf_index(s, &qiov->iov[0]);
+    }
+    flags &= ~BDRV_REQ_REGISTERED_BUF;
+
+    if (fixed_file) {
+        file_index = luring_fixed_file_index(s, fd);
+    }
+
+    ret = luring_do_submit(fd, &luringcb, s, offset, type, flags,
+                           buf_index, file_index);
 
     if (ret < 0) {
         return ret;
@@ -415,6 +757,84 @@ int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, uint64_t offset,
     return luringcb.ret;
 }
 
+#ifdef HAVE_IO_URING_CMD
+int coroutine_fn luring_co_submit_nvme(BlockDriverState *bs, int fd,
+                                       uint32_t nsid, unsigned int lba_shift,
+                                       uint64_t offset, QEMUIOVector *qiov,
+                                       int type, BdrvRequestFlags flags)
+{
+    int ret;
+    AioContext *ctx = qemu_get_current_aio_context();
+    LuringState *s = aio_get_linux_io_uring_cmd(ctx);
+    struct io_uring_sqe *sqe;
+    struct nvme_uring_cmd cmd = {
+        .nsid = nsid,
+    };
+    LuringAIOCB luringcb = {
+        .co         = qemu_coroutine_self(),
+        .ret        = -EINPROGRESS,
+        .qiov       = qiov,
+        .is_read    = (type == QEMU_AIO_READ),
+        .is_cmd     = true,
+    };
+
+    assert(s->has_uring_cmd);
+
+    switch (type) {
+    case QEMU_AIO_READ:
+    case QEMU_AIO_WRITE: {
+        uint64_t slba = offset >> lba_shift;
+        uint32_t nlb = (qiov->size >> lba_shift) - 1;
+
+        assert(!(offset & ((1ULL << lba_shift) - 1)));
+        assert(!(qiov->size & ((1ULL << lba_shift) - 1)));
+        if (nlb > UINT16_MAX) {
+            /* Larger than NLB can describe, not split by the caller */
+            return -EINVAL;
+        }
+
+        cmd.opcode = type == QEMU_AIO_READ ? NVME_CMD_READ : NVME_CMD_WRITE;
+        cmd.addr = (uintptr_t)qiov->iov;
+        cmd.data_len = qiov->niov;
+        cmd.cdw10 = slba & 0xffffffff;
+        cmd.cdw11 = slba >> 32;
+        cmd.cdw12 = nlb;
+        if (flags & BDRV_REQ_FUA) {
+            cmd.cdw12 |= NVME_RW_FUA << 16;
+        }
+        break;
+    }
+    case QEMU_AIO_FLUSH:
+        cmd.opcode = NVME_CMD_FLUSH;
+        break;
+    default:
+        return -ENOTSUP;
+    }
+
+    trace_luring_co_submit(bs, s, &luringcb, fd, offset, qiov ? qiov->size : 0,
+                           type);
+
+    sqe = &luringcb.sqeq;
+    memset(luringcb.sqe128, 0, sizeof(luringcb.sqe128));
+    sqe->opcode = IORING_OP_URING_CMD;
+    sqe->fd = fd;
+    sqe->cmd_op = type == QEMU_AIO_FLUSH ? NVME_URING_CMD_IO :
+                                           NVME_URING_CMD_IO_VEC;
+    memcpy(sqe->cmd, &cmd, sizeof(cmd));
+    io_uring_sqe_set_data(sqe, &luringcb);
+
+    ret = luring_queue(s, &luringcb);
+    if (ret < 0) {
+        return ret;
+    }
+
+    if (luringcb.ret == -EINPROGRESS) {
+        qemu_coroutine_yield();
+    }
+    return luringcb.ret;
+}
+#endif
+
 void luring_detach_aio_context(LuringState *s, AioContext *old_context)
 {
     aio_set_fd_handler(old_context, s->ring.ring_fd,
@@ -432,21 +852,67 @@ void luring_attach_aio_context(LuringState *s, AioContext *new_context)
                        qemu_luring_poll_cb, qemu_luring_poll_ready, s);
 }
 
-LuringState *luring_init(Error **errp)
+LuringState *luring_init(const AioIoUringParams *params, bool uring_cmd,
+                         Error **errp)
 {
-    int rc;
+    int rc, i;
     LuringState *s = g_new0(LuringState, 1);
     struct io_uring *ring = &s->ring;
+    struct io_uring_params p = {};
 
     trace_luring_init_state(s, sizeof(*s));
 
-    rc = io_uring_queue_init(MAX_ENTRIES, ring, 0);
+    s->queue_depth = params->queue_depth ?: DEFAULT_ENTRIES;
+    s->iopoll = params->iopoll;
+
+    if (params->sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = params->sqpoll_idle;
+        if (params->sqpoll_cpu >= 0) {
+            p.flags |= IORING_SETUP_SQ_AFF;
+            p.sq_thread_cpu = params->sqpoll_cpu;
+        }
+    }
+    if (params->iopoll) {
+        p.flags |= IORING_SETUP_IOPOLL;
+    }
+
+#ifdef HAVE_IO_URING_CMD
+    /*
+     * NVMe passthrough commands need 128 byte SQEs and 32 byte CQEs.  They
+     * double the size of the ring, so they are only used by the separate
+     * ring for passthrough commands.
+     */
+    if (uring_cmd) {
+        p.flags |= IORING_SETUP_SQE128 | IORING_SETUP_CQE32;
+    }
+#else
+    assert(!uring_cmd);
+#endif
+    s->has_uring_cmd = uring_cmd;
+
+    rc = io_uring_queue_init_params(s->queue_depth, ring, &p);
     if (rc < 0) {
-        error_setg_errno(errp, -rc, "failed to init linux io_uring ring");
+        error_setg_errno(errp, -rc, uring_cmd ?
+                         "failed to init linux io_uring ring for NVMe "
+                         "passthrough" :
+                         "failed to init linux io_uring ring");
         g_free(s);
         return NULL;
     }
 
+    /* Start with an empty registered file table, slots are filled on use */
+    for (i = 0; i < MAX_FIXED_FILES; i++) {
+        s->fixed_fds[i] = -1;
+    }
+    s->has_fixed_files =
+        io_uring_register_files(ring, s->fixed_fds, MAX_FIXED_FILES) == 0;
+    s->fixed_bufs_gen = 0;
+
+    qemu_mutex_lock(&luring_lock);
+    QLIST_INSERT_HEAD(&luring_states, s, next);
+    qemu_mutex_unlock(&luring_lock);
+
     ioq_init(&s->io_q);
     return s;
 
@@ -454,11 +920,23 @@ LuringState *luring_init(Error **errp)
 
 void luring_cleanup(LuringState *s)
 {
+    qemu_mutex_lock(&luring_lock);
+    QLIST_REMOVE(s, next);
+    qemu_mutex_unlock(&luring_lock);
+
+    g_free(s->fixed_bufs);
     io_uring_queue_exit(&s->ring);
     trace_luring_cleanup_state(s);
     g_free(s);
 }
 
+bool luring_has_iopoll(void)
+{
+    LuringState *s = aio_get_linux_io_uring(qemu_get_current_aio_context());
+
+    return s->iopoll;
+}
+
 bool luring_has_fua(void)
 {
 #ifdef HAVE_IO_URING_PREP_WRITEV2
@@ -24,6 +24,7 @@
 #include "qemu/ratelimit.h"
 #include "qemu/bitmap.h"
 #include "qemu/memalign.h"
+#include "qemu/stats64.h"
 
 #define MAX_IN_FLIGHT 16
 #define MAX_IO_BYTES (1 << 20) /* 1 Mb */
@@ -68,6 +69,13 @@ typedef struct MirrorBlockJob {
      * and the job is running in active mode.
      */
     bool actively_synced;
+    /*
+     * Try bdrv_co_copy_range() before copying through the buffers.  Cleared
+     * on the first failure, such as source and target living on different
+     * file systems.
+     */
+    bool copy_range;
+    Stat64 offloaded_bytes;
     bool should_complete;
     int64_t granularity;
     size_t buf_size;
@@ -402,6 +410,19 @@ static void coroutine_fn mirror_co_read(void *opaque)
     op->is_in_flight = true;
     trace_mirror_one_iteration(s, op->offset, op->bytes);
 
+    if (s->copy_range) {
+        ret = blk_co_copy_range_from_child(s->mirror_top_bs->backing,
+                                           op->offset, s->target, op->offset,
+                                           op->bytes, 0, 0);
+        if (ret >= 0) {
+            stat64_add(&s->offloaded_bytes, op->bytes);
+            mirror_write_complete(op, 0);
+            return;
+        }
+        trace_mirror_copy_range_fail(s, op->offset, ret);
+        s->copy_range = false;
+    }
+
     WITH_GRAPH_RDLOCK_GUARD() {
         ret = bdrv_co_preadv(s->mirror_top_bs->backing, op->offset, op->bytes,
                              &op->qiov, 0);
@@ -1388,6 +1409,7 @@ static void mirror_query(BlockJob *job, BlockJobInfo *info)
 
     info->u.mirror = (BlockJobInfoMirror) {
         .actively_synced = qatomic_read(&s->actively_synced),
+        .offloaded_bytes = stat64_get(&s->offloaded_bytes),
     };
 }
 
@@ -2003,6 +2025,7 @@ static BlockJob *mirror_start_job(
     s->granularity = granularity;
     s->buf_size = ROUND_UP(buf_size, granularity);
     s->unmap = unmap;
+    s->copy_range = true;
     if (auto_complete) {
         s->should_complete = true;
     }
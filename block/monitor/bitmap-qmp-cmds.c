@@ -91,6 +91,7 @@ void qmp_block_dirty_bitmap_add(const char *node, const char *name,
                                 bool has_granularity, uint32_t granularity,
                                 bool has_persistent, bool persistent,
                                 bool has_disabled, bool disabled,
+                                bool has_compressed, bool compressed,
                                 Error **errp)
 {
     BlockDriverState *bs;
@@ -131,7 +132,12 @@ void qmp_block_dirty_bitmap_add(const char *node, const char *name,
         return;
     }
 
-    bitmap = bdrv_create_dirty_bitmap(bs, granularity, name, errp);
+    if (has_compressed && compressed) {
+        bitmap = bdrv_create_compressed_dirty_bitmap(bs, granularity, name,
+                                                     errp);
+    } else {
+        bitmap = bdrv_create_dirty_bitmap(bs, granularity, name, errp);
+    }
     if (bitmap == NULL) {
         return;
     }
@@ -766,7 +766,7 @@ void hmp_info_block(Monitor *mon, const QDict *qdict)
     }
 
     /* Print node information */
-    blockdev_list = qmp_query_named_block_nodes(false, false, NULL);
+    blockdev_list = qmp_query_named_block_nodes(false, false, NULL, NULL);
     for (blockdev = blockdev_list; blockdev; blockdev = blockdev->next) {
         assert(blockdev->value->node_name);
         if (device && strcmp(device, blockdev->value->node_name)) {
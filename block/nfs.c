@@ -51,11 +51,25 @@
 #define QEMU_NFS_MAX_READAHEAD_SIZE 1048576
 #define QEMU_NFS_MAX_PAGECACHE_SIZE (8388608 / NFS_BLKSIZE)
 #define QEMU_NFS_MAX_DEBUG_LEVEL 2
+#define QEMU_NFS_MAX_NCONNECT 16
 
-typedef struct NFSClient {
+typedef struct NFSClient NFSClient;
+
+/* Additional connection used for reads and writes with nconnect > 1 */
+typedef struct NFSDataConn {
+    NFSClient *client;
+    struct nfs_context *context;
+    struct nfsfh *fh;
+    int events;
+} NFSDataConn;
+
+struct NFSClient {
     struct nfs_context *context;
     struct nfsfh *fh;
     int events;
+    NFSDataConn *data_conns;
+    int nr_data_conns;
+    unsigned next_conn;         /* round-robin index, 0 is the main context */
     bool has_zero_init;
     AioContext *aio_context;
     QemuMutex mutex;
@@ -64,7 +78,7 @@ typedef struct NFSClient {
     NFSServer *server;
     char *path;
     int64_t uid, gid, tcp_syncnt, readahead, pagecache, debug;
-} NFSClient;
+};
 
 typedef struct NFSRPC {
     BlockDriverState *bs;
@@ -140,6 +154,8 @@ static int nfs_parse_uri(const char *filename, QDict *options, Error **errp)
                 qdict_put_str(options, "page-cache-size", qp_value);
             } else if (g_str_equal(qp_name, "debug")) {
                 qdict_put_str(options, "debug", qp_value);
+            } else if (g_str_equal(qp_name, "nconnect")) {
+                qdict_put_str(options, "nconnect", qp_value);
             } else {
                 error_setg(errp, "Unknown NFS parameter name: %s", qp_name);
                 return -EINVAL;
@@ -163,6 +179,7 @@ static bool nfs_has_filename_options_conflict(QDict *options, Error **errp)
             !strcmp(qe->key, "readahead-size") ||
             !strcmp(qe->key, "page-cache-size") ||
             !strcmp(qe->key, "debug") ||
+            !strcmp(qe->key, "nconnect") ||
             strstart(qe->key, "server.", NULL))
         {
             error_setg(errp, "Option %s cannot be used with a filename",
@@ -186,6 +203,8 @@ static void nfs_parse_filename(const char *filename, QDict *options,
 
 static void nfs_process_read(void *arg);
 static void nfs_process_write(void *arg);
+static void nfs_data_conn_process_read(void *arg);
+static void nfs_data_conn_process_write(void *arg);
 
 /* Called with QemuMutex held.  */
 static void nfs_set_events(NFSClient *client)
@@ -201,6 +220,20 @@ static void nfs_set_events(NFSClient *client)
     client->events = ev;
 }
 
+/* Called with QemuMutex held.  */
+static void nfs_data_conn_set_events(NFSDataConn *conn)
+{
+    int ev = nfs_which_events(conn->context);
+    if (ev != conn->events) {
+        aio_set_fd_handler(conn->client->aio_context,
+                           nfs_get_fd(conn->context),
+                           (ev & POLLIN) ? nfs_data_conn_process_read : NULL,
+                           (ev & POLLOUT) ? nfs_data_conn_process_write : NULL,
+                           NULL, NULL, conn);
+    }
+    conn->events = ev;
+}
+
 static void nfs_process_read(void *arg)
 {
     NFSClient *client = arg;
@@ -221,6 +254,53 @@ static void nfs_process_write(void *arg)
     qemu_mutex_unlock(&client->mutex);
 }
 
+static void nfs_data_conn_process_read(void *arg)
+{
+    NFSDataConn *conn = arg;
+
+    qemu_mutex_lock(&conn->client->mutex);
+    nfs_service(conn->context, POLLIN);
+    nfs_data_conn_set_events(conn);
+    qemu_mutex_unlock(&conn->client->mutex);
+}
+
+static void nfs_data_conn_process_write(void *arg)
+{
+    NFSDataConn *conn = arg;
+
+    qemu_mutex_lock(&conn->client->mutex);
+    nfs_service(conn->context, POLLOUT);
+    nfs_data_conn_set_events(conn);
+    qemu_mutex_unlock(&conn->client->mutex);
+}
+
+/*
+ * Pick the connection for the next read or write, round-robin over the
+ * main context and the additional data connections.  Returns NULL for the
+ * main context.  Called with QemuMutex held.
+ */
+static NFSDataConn *nfs_next_data_conn(NFSClient *client)
+{
+    unsigned idx;
+
+    if (!client->nr_data_conns) {
+        return NULL;
+    }
+
+    idx = client->next_conn++ % (client->nr_data_conns + 1);
+    return idx ? &client->data_conns[idx - 1] : NULL;
+}
+
+/* Called with QemuMutex held.  */
+static void nfs_data_conn_kick(NFSClient *client, NFSDataConn *conn)
+{
+    if (conn) {
+        nfs_data_conn_set_events(conn);
+    } else {
+        nfs_set_events(client);
+    }
+}
+
 static void coroutine_fn nfs_co_init_task(BlockDriverState *bs, NFSRPC *task)
 {
     *task = (NFSRPC) {
@@ -265,18 +345,21 @@ static int coroutine_fn nfs_co_preadv(BlockDriverState *bs, int64_t offset,
                                       BdrvRequestFlags flags)
 {
     NFSClient *client = bs->opaque;
+    NFSDataConn *conn;
     NFSRPC task;
 
     nfs_co_init_task(bs, &task);
     task.iov = iov;
 
     WITH_QEMU_LOCK_GUARD(&client->mutex) {
-        if (nfs_pread_async(client->context, client->fh,
+        conn = nfs_next_data_conn(client);
+        if (nfs_pread_async(conn ? conn->context : client->context,
+                            conn ? conn->fh : client->fh,
                             offset, bytes, nfs_co_generic_cb, &task) != 0) {
             return -ENOMEM;
         }
 
-        nfs_set_events(client);
+        nfs_data_conn_kick(client, conn);
     }
     while (!task.complete) {
         qemu_coroutine_yield();
@@ -299,6 +382,7 @@ static int coroutine_fn nfs_co_pwritev(BlockDriverState *bs, int64_t offset,
                                        BdrvRequestFlags flags)
 {
     NFSClient *client = bs->opaque;
+    NFSDataConn *conn;
     NFSRPC task;
     char *buf = NULL;
     bool my_buffer = false;
@@ -317,7 +401,9 @@ static int coroutine_fn nfs_co_pwritev(BlockDriverState *bs, int64_t offset,
     }
 
     WITH_QEMU_LOCK_GUARD(&client->mutex) {
-        if (nfs_pwrite_async(client->context, client->fh,
+        conn = nfs_next_data_conn(client);
+        if (nfs_pwrite_async(conn ? conn->context : client->context,
+                             conn ? conn->fh : client->fh,
                              offset, bytes, buf,
                              nfs_co_generic_cb, &task) != 0) {
             if (my_buffer) {
@@ -326,7 +412,7 @@ static int coroutine_fn nfs_co_pwritev(BlockDriverState *bs, int64_t offset,
             return -ENOMEM;
         }
 
-        nfs_set_events(client);
+        nfs_data_conn_kick(client, conn);
     }
     while (!task.complete) {
         qemu_coroutine_yield();
@@ -368,23 +454,117 @@ static int coroutine_fn nfs_co_flush(BlockDriverState *bs)
 static void nfs_detach_aio_context(BlockDriverState *bs)
 {
     NFSClient *client = bs->opaque;
+    int i;
 
     aio_set_fd_handler(client->aio_context, nfs_get_fd(client->context),
                        NULL, NULL, NULL, NULL, NULL);
     client->events = 0;
+
+    for (i = 0; i < client->nr_data_conns; i++) {
+        NFSDataConn *conn = &client->data_conns[i];
+
+        aio_set_fd_handler(client->aio_context, nfs_get_fd(conn->context),
+                           NULL, NULL, NULL, NULL, NULL);
+        conn->events = 0;
+    }
 }
 
 static void nfs_attach_aio_context(BlockDriverState *bs,
                                    AioContext *new_context)
 {
     NFSClient *client = bs->opaque;
+    int i;
 
     client->aio_context = new_context;
     nfs_set_events(client);
+
+    for (i = 0; i < client->nr_data_conns; i++) {
+        nfs_data_conn_set_events(&client->data_conns[i]);
+    }
+}
+
+static void nfs_data_conns_close(NFSClient *client)
+{
+    int i;
+
+    for (i = 0; i < client->nr_data_conns; i++) {
+        NFSDataConn *conn = &client->data_conns[i];
+
+        qemu_mutex_lock(&client->mutex);
+        aio_set_fd_handler(client->aio_context, nfs_get_fd(conn->context),
+                           NULL, NULL, NULL, NULL, NULL);
+        qemu_mutex_unlock(&client->mutex);
+        if (conn->fh) {
+            nfs_close(conn->context, conn->fh);
+        }
+#ifdef LIBNFS_FEATURE_UMOUNT
+        nfs_umount(conn->context);
+#endif
+        nfs_destroy_context(conn->context);
+    }
+    g_free(client->data_conns);
+    client->data_conns = NULL;
+    client->nr_data_conns = 0;
+}
+
+/*
+ * Open @nconnect - 1 additional connections to the file @file that the main
+ * context has already opened, with the same credentials.
+ */
+static int nfs_data_conns_open(NFSClient *client, const char *file,
+                               int flags, int64_t nconnect, Error **errp)
+{
+    int i, ret;
+
+    client->data_conns = g_new0(NFSDataConn, nconnect - 1);
+
+    for (i = 0; i < nconnect - 1; i++) {
+        NFSDataConn *conn = &client->data_conns[i];
+
+        conn->client = client;
+        conn->context = nfs_init_context();
+        if (conn->context == NULL) {
+            error_setg(errp, "Failed to init NFS context");
+            return -ENOMEM;
+        }
+        client->nr_data_conns++;
+
+        if (client->uid) {
+            nfs_set_uid(conn->context, client->uid);
+        }
+        if (client->gid) {
+            nfs_set_gid(conn->context, client->gid);
+        }
+        if (client->tcp_syncnt) {
+            nfs_set_tcp_syncnt(conn->context, client->tcp_syncnt);
+        }
+#ifdef LIBNFS_FEATURE_DEBUG
+        if (client->debug) {
+            nfs_set_debug(conn->context, client->debug);
+        }
+#endif
+
+        ret = nfs_mount(conn->context, client->server->host, client->path);
+        if (ret < 0) {
+            error_setg(errp, "Failed to mount nfs share: %s",
+                       nfs_get_error(conn->context));
+            return ret;
+        }
+
+        ret = nfs_open(conn->context, file, flags, &conn->fh);
+        if (ret < 0) {
+            error_setg(errp, "Failed to open file : %s",
+                       nfs_get_error(conn->context));
+            return ret;
+        }
+    }
+
+    return 0;
 }
 
 static void nfs_client_close(NFSClient *client)
 {
+    nfs_data_conns_close(client);
     if (client->context) {
         qemu_mutex_lock(&client->mutex);
         aio_set_fd_handler(client->aio_context, nfs_get_fd(client->context),
@@ -515,6 +695,19 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
     }
 #endif
 
+    if (opts->has_nconnect) {
+        if (opts->nconnect < 1 || opts->nconnect > QEMU_NFS_MAX_NCONNECT) {
+            error_setg(errp, "nconnect must be between 1 and %d",
+                       QEMU_NFS_MAX_NCONNECT);
+            goto fail;
+        }
+        if (opts->nconnect > 1 && client->cache_used) {
+            error_setg(errp, "nconnect cannot be combined with NFS readahead "
+                             "or pagecache");
+            goto fail;
+        }
+    }
+
     ret = nfs_mount(client->context, client->server->host, client->path);
     if (ret < 0) {
         error_setg(errp, "Failed to mount nfs share: %s",
@@ -545,6 +738,13 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
         goto fail;
     }
 
+    if (opts->has_nconnect && opts->nconnect > 1 && !(flags & O_CREAT)) {
+        ret = nfs_data_conns_open(client, file, flags, opts->nconnect, errp);
+        if (ret < 0) {
+            goto fail;
+        }
+    }
+
     ret = DIV_ROUND_UP(st.st_size, BDRV_SECTOR_SIZE);
 #if !defined(_WIN32)
     client->st_blocks = st.st_blocks;
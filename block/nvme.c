@@ -50,12 +50,25 @@ typedef struct BDRVNVMeState BDRVNVMeState;
 #define INDEX_ADMIN     0
 #define INDEX_IO(n)     (1 + n)
 
-/* This driver shares a single MSIX IRQ for the admin and I/O queues */
+/*
+ * The admin queue and the first I/O queue share MSIX vector 0.  Every
+ * further I/O queue gets a vector of its own so that its completions can be
+ * processed by the thread that submitted the requests.
+ */
 enum {
     MSIX_SHARED_IRQ_IDX = 0,
-    MSIX_IRQ_COUNT = 1
 };
 
+/* Upper limit for the num-queues option */
+#define NVME_MAX_IO_QUEUES 64
+
+/* One MSIX vector and its event notifier */
+typedef struct {
+    EventNotifier notifier;
+    BDRVNVMeState *s;
+    unsigned vector;
+} NVMeIrq;
+
 typedef struct {
     int32_t  head, tail;
     uint8_t  *queue;
@@ -94,6 +107,12 @@ typedef struct {
 
     /* Thread-safe, no lock necessary */
     QEMUBH      *completion_bh;
+
+    /*
+     * AioContext that processes completions, or NULL if the queue is not in
+     * use.  Accessed with atomics.
+     */
+    AioContext  *aio_context;
 } NVMeQueuePair;
 
 struct BDRVNVMeState {
@@ -115,7 +134,9 @@ struct BDRVNVMeState {
     /* How many uint32_t elements does each doorbell entry take. */
     size_t doorbell_scale;
     bool write_cache_supported;
-    EventNotifier irq_notifier[MSIX_IRQ_COUNT];
+    /* One MSIX vector per I/O queue, see nvme_queue_vector() */
+    NVMeIrq *irqs;
+    unsigned irq_count;
 
     uint64_t nsze; /* Namespace size reported by identify command */
     int nsid;      /* The namespace id to read/write data. */
@@ -144,6 +165,7 @@ struct BDRVNVMeState {
 
 #define NVME_BLOCK_OPT_DEVICE "device"
 #define NVME_BLOCK_OPT_NAMESPACE "namespace"
+#define NVME_BLOCK_OPT_NUM_QUEUES "num-queues"
 
 static void nvme_process_completion_bh(void *opaque);
 
@@ -161,6 +183,11 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "NVMe namespace",
         },
+        {
+            .name = NVME_BLOCK_OPT_NUM_QUEUES,
+            .type = QEMU_OPT_NUMBER,
+            .help = "Number of I/O queue pairs (default: 1)",
+        },
         { /* end of list */ }
     },
 };
@@ -218,8 +245,19 @@ static void nvme_free_req_queue_cb(void *opaque)
     qemu_mutex_unlock(&q->lock);
 }
 
+/* MSIX vector that signals completions of queue @idx */
+static unsigned nvme_queue_vector(unsigned idx)
+{
+    return idx <= INDEX_IO(0) ? MSIX_SHARED_IRQ_IDX : idx - INDEX_IO(0);
+}
+
+/* Whether queue @idx is the one that registers the handler for its vector */
+static bool nvme_queue_owns_irq(unsigned idx)
+{
+    return idx != INDEX_IO(0);
+}
+
 static NVMeQueuePair *nvme_create_queue_pair(BDRVNVMeState *s,
-                                             AioContext *aio_context,
                                              unsigned idx, size_t size,
                                              Error **errp)
 {
@@ -234,8 +272,7 @@ static NVMeQueuePair *nvme_create_queue_pair(BDRVNVMeState *s,
         error_setg(errp, "Cannot allocate queue pair");
         return NULL;
     }
-    trace_nvme_create_queue_pair(idx, q, size, aio_context,
-                                 event_notifier_get_fd(s->irq_notifier));
+    trace_nvme_create_queue_pair(idx, q, size, nvme_queue_vector(idx));
     bytes = QEMU_ALIGN_UP(s->page_size * NVME_NUM_REQS,
                           qemu_real_host_page_size());
     q->prp_list_pages = qemu_try_memalign(qemu_real_host_page_size(), bytes);
@@ -248,7 +285,6 @@ static NVMeQueuePair *nvme_create_queue_pair(BDRVNVMeState *s,
     q->s = s;
     q->index = idx;
     qemu_co_queue_init(&q->free_req_queue);
-    q->completion_bh = aio_bh_new(aio_context, nvme_process_completion_bh, q);
     r = qemu_vfio_dma_map(s->vfio, q->prp_list_pages, bytes,
                           false, &prp_list_iova, errp);
     if (r) {
@@ -345,7 +381,7 @@ static void nvme_put_free_req_locked(NVMeQueuePair *q, NVMeRequest *req)
 static void nvme_wake_free_req_locked(NVMeQueuePair *q)
 {
     if (!qemu_co_queue_empty(&q->free_req_queue)) {
-        replay_bh_schedule_oneshot_event(q->s->aio_context,
+        replay_bh_schedule_oneshot_event(qatomic_read(&q->aio_context),
                 nvme_free_req_queue_cb, q);
     }
 }
@@ -648,25 +684,6 @@ static void nvme_poll_queue(NVMeQueuePair *q)
     qemu_mutex_unlock(&q->lock);
 }
 
-static void nvme_poll_queues(BDRVNVMeState *s)
-{
-    int i;
-
-    for (i = 0; i < s->queue_count; i++) {
-        nvme_poll_queue(s->queues[i]);
-    }
-}
-
-static void nvme_handle_event(EventNotifier *n)
-{
-    BDRVNVMeState *s = container_of(n, BDRVNVMeState,
-                                    irq_notifier[MSIX_SHARED_IRQ_IDX]);
-
-    trace_nvme_handle_event(s);
-    event_notifier_test_and_clear(n);
-    nvme_poll_queues(s);
-}
-
 static bool nvme_add_io_queue(BlockDriverState *bs, Error **errp)
 {
     BDRVNVMeState *s = bs->opaque;
@@ -676,8 +693,7 @@ static bool nvme_add_io_queue(BlockDriverState *bs, Error **errp)
     unsigned queue_size = NVME_QUEUE_SIZE;
 
     assert(n <= UINT16_MAX);
-    q = nvme_create_queue_pair(s, bdrv_get_aio_context(bs),
-                               n, queue_size, errp);
+    q = nvme_create_queue_pair(s, n, queue_size, errp);
     if (!q) {
         return false;
     }
@@ -685,7 +701,8 @@ static bool nvme_add_io_queue(BlockDriverState *bs, Error **errp)
         .opcode = NVME_ADM_CMD_CREATE_CQ,
         .dptr.prp1 = cpu_to_le64(q->cq.iova),
         .cdw10 = cpu_to_le32(((queue_size - 1) << 16) | n),
-        .cdw11 = cpu_to_le32(NVME_CQ_IEN | NVME_CQ_PC),
+        .cdw11 = cpu_to_le32((nvme_queue_vector(n) << 16) |
+                             NVME_CQ_IEN | NVME_CQ_PC),
     };
     if (nvme_admin_cmd_sync(bs, &cmd)) {
         error_setg(errp, "Failed to create CQ io queue [%u]", n);
@@ -710,11 +727,33 @@ out_error:
     return false;
 }
 
+/* Poll all queues that are signalled through @irq */
+static void nvme_poll_queues(NVMeIrq *irq)
+{
+    BDRVNVMeState *s = irq->s;
+    int i;
+
+    for (i = 0; i < s->queue_count; i++) {
+        if (nvme_queue_vector(i) == irq->vector) {
+            nvme_poll_queue(s->queues[i]);
+        }
+    }
+}
+
+static void nvme_handle_event(EventNotifier *n)
+{
+    NVMeIrq *irq = container_of(n, NVMeIrq, notifier);
+
+    trace_nvme_handle_event(irq->s, irq->vector);
+    event_notifier_test_and_clear(n);
+    nvme_poll_queues(irq);
+}
+
 static bool nvme_poll_cb(void *opaque)
 {
     EventNotifier *e = opaque;
-    BDRVNVMeState *s = container_of(e, BDRVNVMeState,
-                                    irq_notifier[MSIX_SHARED_IRQ_IDX]);
+    NVMeIrq *irq = container_of(e, NVMeIrq, notifier);
+    BDRVNVMeState *s = irq->s;
     int i;
 
     for (i = 0; i < s->queue_count; i++) {
@@ -722,6 +761,10 @@ static bool nvme_poll_cb(void *opaque)
         const size_t cqe_offset = q->cq.head * NVME_CQ_ENTRY_BYTES;
         NvmeCqe *cqe = (NvmeCqe *)&q->cq.queue[cqe_offset];
 
+        if (nvme_queue_vector(i) != irq->vector) {
+            continue;
+        }
+
         /*
          * q->lock isn't needed because nvme_process_completion() only runs in
          * the event loop thread and cannot race with itself.
@@ -735,18 +778,88 @@ static bool nvme_poll_cb(void *opaque)
 
 static void nvme_poll_ready(EventNotifier *e)
 {
-    BDRVNVMeState *s = container_of(e, BDRVNVMeState,
-                                    irq_notifier[MSIX_SHARED_IRQ_IDX]);
+    NVMeIrq *irq = container_of(e, NVMeIrq, notifier);
+
+    nvme_poll_queues(irq);
+}
+
+/*
+ * Let @aio_context process the completions of @q.  The queue pair's vector
+ * is registered there too, unless it is shared with the admin queue.
+ */
+static void nvme_bind_queue_pair(NVMeQueuePair *q, AioContext *aio_context)
+{
+    BDRVNVMeState *s = q->s;
+
+    trace_nvme_bind_queue_pair(s, q->index, aio_context);
+    q->completion_bh = aio_bh_new(aio_context, nvme_process_completion_bh, q);
+    if (nvme_queue_owns_irq(q->index)) {
+        aio_set_event_notifier(aio_context,
+                               &s->irqs[nvme_queue_vector(q->index)].notifier,
+                               nvme_handle_event, nvme_poll_cb,
+                               nvme_poll_ready);
+    }
+    qatomic_set(&q->aio_context, aio_context);
+}
+
+/* Must be called without in-flight requests on @q */
+static void nvme_unbind_queue_pair(NVMeQueuePair *q)
+{
+    BDRVNVMeState *s = q->s;
+    AioContext *aio_context = qatomic_read(&q->aio_context);
+
+    if (!aio_context) {
+        return;
+    }
+    assert(!q->inflight);
+    if (nvme_queue_owns_irq(q->index)) {
+        aio_set_event_notifier(aio_context,
+                               &s->irqs[nvme_queue_vector(q->index)].notifier,
+                               NULL, NULL, NULL);
+    }
+    qemu_bh_delete(q->completion_bh);
+    q->completion_bh = NULL;
+    qatomic_set(&q->aio_context, NULL);
+}
+
+/*
+ * Return the I/O queue pair for requests submitted from the current
+ * AioContext.  Each AioContext claims a queue pair of its own the first time
+ * it submits a request, so that submission and completion stay in the same
+ * thread.  Once all queue pairs are taken, the remaining AioContexts share
+ * the first one, which is serviced by the BDS AioContext.
+ */
+static NVMeQueuePair *nvme_get_io_queue(BDRVNVMeState *s)
+{
+    AioContext *ctx = qemu_get_current_aio_context();
+    unsigned i;
+
+    for (i = INDEX_IO(0); i < s->queue_count; i++) {
+        if (qatomic_read(&s->queues[i]->aio_context) == ctx) {
+            return s->queues[i];
+        }
+    }
+    for (i = INDEX_IO(1); i < s->queue_count; i++) {
+        NVMeQueuePair *q = s->queues[i];
 
-    nvme_poll_queues(s);
+        if (!qatomic_read(&q->aio_context) &&
+            qatomic_cmpxchg(&q->aio_context, NULL, ctx) == NULL) {
+            nvme_bind_queue_pair(q, ctx);
+            return q;
+        }
+    }
+    return s->queues[INDEX_IO(0)];
 }
 
 static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
-                     Error **errp)
+                     unsigned num_queues, Error **errp)
 {
     BDRVNVMeState *s = bs->opaque;
     NVMeQueuePair *q;
     AioContext *aio_context = bdrv_get_aio_context(bs);
+    g_autofree EventNotifier **notifiers = NULL;
+    NvmeCmd cmd;
+    unsigned irq_count;
     int ret;
     uint64_t cap;
     uint32_t ver;
@@ -760,11 +873,6 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
     s->device = g_strdup(device);
     s->nsid = namespace;
     s->aio_context = bdrv_get_aio_context(bs);
-    ret = event_notifier_init(&s->irq_notifier[MSIX_SHARED_IRQ_IDX], 0);
-    if (ret) {
-        error_setg(errp, "Failed to init event notifier");
-        return ret;
-    }
 
     s->vfio = qemu_vfio_open_pci(device, errp);
     if (!s->vfio) {
@@ -772,6 +880,26 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
         goto out;
     }
 
+    /* Each I/O queue needs its own vector, see nvme_queue_vector() */
+    ret = qemu_vfio_pci_get_irq_count(s->vfio, VFIO_PCI_MSIX_IRQ_INDEX, errp);
+    if (ret < 0) {
+        goto out;
+    }
+    irq_count = MAX(MIN(num_queues, ret), 1);
+    s->irqs = g_new0(NVMeIrq, irq_count);
+    notifiers = g_new(EventNotifier *, irq_count);
+    for (unsigned i = 0; i < irq_count; i++) {
+        ret = event_notifier_init(&s->irqs[i].notifier, 0);
+        if (ret) {
+            error_setg(errp, "Failed to init event notifier");
+            goto out;
+        }
+        s->irqs[i].s = s;
+        s->irqs[i].vector = i;
+        notifiers[i] = &s->irqs[i].notifier;
+        s->irq_count++;
+    }
+
     regs = qemu_vfio_pci_map_bar(s->vfio, 0, 0, sizeof(NvmeBar),
                                  PROT_READ | PROT_WRITE, errp);
     if (!regs) {
@@ -838,13 +966,14 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
 
     /* Set up admin queue. */
     s->queues = g_new(NVMeQueuePair *, 1);
-    q = nvme_create_queue_pair(s, aio_context, 0, NVME_QUEUE_SIZE, errp);
+    q = nvme_create_queue_pair(s, 0, NVME_QUEUE_SIZE, errp);
     if (!q) {
         ret = -EINVAL;
         goto out;
     }
     s->queues[INDEX_ADMIN] = q;
     s->queue_count = 1;
+    nvme_bind_queue_pair(q, aio_context);
     QEMU_BUILD_BUG_ON((NVME_QUEUE_SIZE - 1) & 0xF000);
     host_pci_stl_le_p(&regs->aqa,
                         ((NVME_QUEUE_SIZE - 1) << AQA_ACQS_SHIFT) |
@@ -870,24 +999,48 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
         }
     }
 
-    ret = qemu_vfio_pci_init_irq(s->vfio, s->irq_notifier,
-                                 VFIO_PCI_MSIX_IRQ_INDEX, errp);
+    ret = qemu_vfio_pci_init_irqs(s->vfio, notifiers, s->irq_count,
+                                  VFIO_PCI_MSIX_IRQ_INDEX, errp);
     if (ret) {
         goto out;
     }
-    aio_set_event_notifier(bdrv_get_aio_context(bs),
-                           &s->irq_notifier[MSIX_SHARED_IRQ_IDX],
-                           nvme_handle_event, nvme_poll_cb,
-                           nvme_poll_ready);
 
     if (!nvme_identify(bs, namespace, errp)) {
         ret = -EIO;
         goto out;
     }
 
+    if (s->irq_count > 1) {
+        /*
+         * Ask for as many I/O queues as we have vectors.  If the controller
+         * grants fewer, creating the excess queues below fails and we make
+         * do with what we got.
+         */
+        cmd = (NvmeCmd) {
+            .opcode = NVME_ADM_CMD_SET_FEATURES,
+            .cdw10 = cpu_to_le32(NVME_NUMBER_OF_QUEUES),
+            .cdw11 = cpu_to_le32(((s->irq_count - 1) << 16) |
+                                 (s->irq_count - 1)),
+        };
+        nvme_admin_cmd_sync(bs, &cmd);
+    }
+
     /* Set up command queues. */
     if (!nvme_add_io_queue(bs, errp)) {
         ret = -EIO;
+        goto out;
+    }
+    nvme_bind_queue_pair(s->queues[INDEX_IO(0)], aio_context);
+
+    /* Additional queues are bound to an AioContext on first use */
+    for (unsigned i = 1; i < s->irq_count; i++) {
+        Error *local_err = NULL;
+
+        if (!nvme_add_io_queue(bs, &local_err)) {
+            warn_reportf_err(local_err, "Using %u I/O queues instead of %u: ",
+                             i, s->irq_count);
+            break;
+        }
     }
 out:
     if (regs) {
@@ -958,13 +1111,14 @@ static void nvme_close(BlockDriverState *bs)
     BDRVNVMeState *s = bs->opaque;
 
     for (unsigned i = 0; i < s->queue_count; ++i) {
+        nvme_unbind_queue_pair(s->queues[i]);
         nvme_free_queue_pair(s->queues[i]);
     }
     g_free(s->queues);
-    aio_set_event_notifier(bdrv_get_aio_context(bs),
-                           &s->irq_notifier[MSIX_SHARED_IRQ_IDX],
-                           NULL, NULL, NULL);
-    event_notifier_cleanup(&s->irq_notifier[MSIX_SHARED_IRQ_IDX]);
+    for (unsigned i = 0; i < s->irq_count; i++) {
+        event_notifier_cleanup(&s->irqs[i].notifier);
+    }
+    g_free(s->irqs);
     qemu_vfio_pci_unmap_bar(s->vfio, 0, s->bar0_wo_map,
                             0, sizeof(NvmeBar) + NVME_DOORBELL_SIZE);
     qemu_vfio_close(s->vfio);
@@ -978,6 +1132,7 @@ static int nvme_open(BlockDriverState *bs, QDict *options, int flags,
     const char *device;
     QemuOpts *opts;
     int namespace;
+    uint64_t num_queues;
     int ret;
     BDRVNVMeState *s = bs->opaque;
 
@@ -993,7 +1148,14 @@ static int nvme_open(BlockDriverState *bs, QDict *options, int flags,
     }
 
     namespace = qemu_opt_get_number(opts, NVME_BLOCK_OPT_NAMESPACE, 1);
-    ret = nvme_init(bs, device, namespace, errp);
+    num_queues = qemu_opt_get_number(opts, NVME_BLOCK_OPT_NUM_QUEUES, 1);
+    if (num_queues < 1 || num_queues > NVME_MAX_IO_QUEUES) {
+        error_setg(errp, "'" NVME_BLOCK_OPT_NUM_QUEUES "' must be between 1 "
+                   "and %d", NVME_MAX_IO_QUEUES);
+        qemu_opts_del(opts);
+        return -EINVAL;
+    }
+    ret = nvme_init(bs, device, namespace, num_queues, errp);
     qemu_opts_del(opts);
     if (ret) {
         goto fail;
@@ -1193,7 +1355,7 @@ static coroutine_fn int nvme_co_prw_aligned(BlockDriverState *bs,
 {
     int r;
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
 
     uint32_t cdw12 = (((bytes >> s->blkshift) - 1) & 0xFFFF) |
@@ -1206,7 +1368,7 @@ static coroutine_fn int nvme_co_prw_aligned(BlockDriverState *bs,
         .cdw12 = cpu_to_le32(cdw12),
     };
     NVMeCoData data = {
-        .ctx = bdrv_get_aio_context(bs),
+        .ctx = qemu_get_current_aio_context(),
         .ret = -EINPROGRESS,
     };
 
@@ -1314,14 +1476,14 @@ static coroutine_fn int nvme_co_pwritev(BlockDriverState *bs,
 static coroutine_fn int nvme_co_flush(BlockDriverState *bs)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     NvmeCmd cmd = {
         .opcode = NVME_CMD_FLUSH,
         .nsid = cpu_to_le32(s->nsid),
     };
     NVMeCoData data = {
-        .ctx = bdrv_get_aio_context(bs),
+        .ctx = qemu_get_current_aio_context(),
         .ret = -EINPROGRESS,
     };
 
@@ -1345,7 +1507,7 @@ static coroutine_fn int nvme_co_pwrite_zeroes(BlockDriverState *bs,
                                               BdrvRequestFlags flags)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     uint32_t cdw12;
 
@@ -1372,7 +1534,7 @@ static coroutine_fn int nvme_co_pwrite_zeroes(BlockDriverState *bs,
     };
 
     NVMeCoData data = {
-        .ctx = bdrv_get_aio_context(bs),
+        .ctx = qemu_get_current_aio_context(),
         .ret = -EINPROGRESS,
     };
 
@@ -1408,7 +1570,7 @@ static int coroutine_fn nvme_co_pdiscard(BlockDriverState *bs,
                                          int64_t bytes)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     QEMU_AUTO_VFREE NvmeDsmRange *buf = NULL;
     QEMUIOVector local_qiov;
@@ -1422,7 +1584,7 @@ static int coroutine_fn nvme_co_pdiscard(BlockDriverState *bs,
     };
 
     NVMeCoData data = {
-        .ctx = bdrv_get_aio_context(bs),
+        .ctx = qemu_get_current_aio_context(),
         .ret = -EINPROGRESS,
     };
 
@@ -1553,15 +1715,8 @@ static void nvme_detach_aio_context(BlockDriverState *bs)
     BDRVNVMeState *s = bs->opaque;
 
     for (unsigned i = 0; i < s->queue_count; i++) {
-        NVMeQueuePair *q = s->queues[i];
-
-        qemu_bh_delete(q->completion_bh);
-        q->completion_bh = NULL;
+        nvme_unbind_queue_pair(s->queues[i]);
     }
-
-    aio_set_event_notifier(bdrv_get_aio_context(bs),
-                           &s->irq_notifier[MSIX_SHARED_IRQ_IDX],
-                           NULL, NULL, NULL);
 }
 
 static void nvme_attach_aio_context(BlockDriverState *bs,
@@ -1570,15 +1725,32 @@ static void nvme_attach_aio_context(BlockDriverState *bs,
     BDRVNVMeState *s = bs->opaque;
 
     s->aio_context = new_context;
-    aio_set_event_notifier(new_context, &s->irq_notifier[MSIX_SHARED_IRQ_IDX],
-                           nvme_handle_event, nvme_poll_cb,
-                           nvme_poll_ready);
 
-    for (unsigned i = 0; i < s->queue_count; i++) {
+    /* The remaining I/O queues are bound again on first use */
+    for (unsigned i = 0; i <= INDEX_IO(0) && i < s->queue_count; i++) {
+        nvme_bind_queue_pair(s->queues[i], new_context);
+    }
+}
+
+static void nvme_drain_end(BlockDriverState *bs)
+{
+    BDRVNVMeState *s = bs->opaque;
+
+    /*
+     * Release the idle I/O queues that were claimed by other AioContexts.
+     * Those may have gone away during the drained section; the ones still
+     * submitting requests will claim a queue again.
+     */
+    for (unsigned i = INDEX_IO(1); i < s->queue_count; i++) {
         NVMeQueuePair *q = s->queues[i];
+        bool idle;
 
-        q->completion_bh =
-            aio_bh_new(new_context, nvme_process_completion_bh, q);
+        qemu_mutex_lock(&q->lock);
+        idle = !q->inflight && !q->need_kick;
+        qemu_mutex_unlock(&q->lock);
+        if (idle) {
+            nvme_unbind_queue_pair(q);
+        }
     }
 }
 
@@ -1657,6 +1829,7 @@ static BlockDriver bdrv_nvme = {
 
     .bdrv_detach_aio_context  = nvme_detach_aio_context,
     .bdrv_attach_aio_context  = nvme_attach_aio_context,
+    .bdrv_drain_end           = nvme_drain_end,
 
     .bdrv_register_buf        = nvme_register_buf,
     .bdrv_unregister_buf      = nvme_unregister_buf,
@@ -500,8 +500,33 @@ bdrv_latency_histogram_stats(BlockLatencyHistogram *hist)
     return info;
 }
 
+static BlockPercentilesInfo *bdrv_percentiles_info(const HdrHistogram *h)
+{
+    BlockPercentilesInfo *info = g_new0(BlockPercentilesInfo, 1);
+
+    info->count = h->count;
+    info->min = h->min;
+    info->max = h->max;
+    info->p50 = hdr_histogram_quantile(h, 0.5);
+    info->p90 = hdr_histogram_quantile(h, 0.9);
+    info->p99 = hdr_histogram_quantile(h, 0.99);
+    info->p999 = hdr_histogram_quantile(h, 0.999);
+    return info;
+}
+
+static BlockPercentilesInfo *
+bdrv_latency_percentiles(BlockAcctStats *stats, enum BlockAcctType type,
+                         HdrHistogram *h)
+{
+    if (!block_acct_latency_percentiles(stats, type, h)) {
+        return NULL;
+    }
+    return bdrv_percentiles_info(h);
+}
+
 static void bdrv_query_blk_stats(BlockDeviceStats *ds, BlockBackend *blk)
 {
+    g_autofree HdrHistogram *h = g_new(HdrHistogram, 1);
     BlockAcctStats *stats = blk_get_stats(blk);
     BlockAcctTimedStats *ts = NULL;
     BlockLatencyHistogram *hgram;
@@ -595,6 +620,20 @@ static void bdrv_query_blk_stats(BlockDeviceStats *ds, BlockBackend *blk)
         = bdrv_latency_histogram_stats(&hgram[BLOCK_ACCT_ZONE_APPEND]);
     ds->flush_latency_histogram
         = bdrv_latency_histogram_stats(&hgram[BLOCK_ACCT_FLUSH]);
+
+    ds->rd_latency_percentiles =
+        bdrv_latency_percentiles(stats, BLOCK_ACCT_READ, h);
+    ds->wr_latency_percentiles =
+        bdrv_latency_percentiles(stats, BLOCK_ACCT_WRITE, h);
+    ds->zone_append_latency_percentiles =
+        bdrv_latency_percentiles(stats, BLOCK_ACCT_ZONE_APPEND, h);
+    ds->flush_latency_percentiles =
+        bdrv_latency_percentiles(stats, BLOCK_ACCT_FLUSH, h);
+    ds->unmap_latency_percentiles =
+        bdrv_latency_percentiles(stats, BLOCK_ACCT_UNMAP, h);
+    if (block_acct_queue_depth_percentiles(stats, h)) {
+        ds->queue_depth_percentiles = bdrv_percentiles_info(h);
+    }
 }
 
 static BlockStats * GRAPH_RDLOCK
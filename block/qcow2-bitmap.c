@@ -91,6 +91,7 @@ typedef struct Qcow2Bitmap {
     char *name;
 
     BdrvDirtyBitmap *dirty_bitmap;
+    bool in_place; /* table is the one in the image, only changes are stored */
 
     QSIMPLEQ_ENTRY(Qcow2Bitmap) entry;
 } Qcow2Bitmap;
@@ -282,6 +283,18 @@ free_bitmap_clusters(BlockDriverState *bs, Qcow2BitmapTable *tb)
     return 0;
 }
 
+/*
+ * Start tracking which clusters of @bitmap change, so that the next store
+ * only has to write those.  @bitmap must match what is stored in the image.
+ */
+static void track_bitmap_changes(BlockDriverState *bs, BdrvDirtyBitmap *bitmap)
+{
+    BDRVQcow2State *s = bs->opaque;
+
+    bdrv_dirty_bitmap_create_meta(bitmap,
+        bdrv_dirty_bitmap_serialization_coverage(s->cluster_size, bitmap));
+}
+
 /* load_bitmap_data
  * @bitmap_table entries must satisfy specification constraints.
  * @bitmap must be cleared */
@@ -1017,6 +1030,7 @@ qcow2_load_dirty_bitmaps(BlockDriverState *bs,
         if (bm->flags & BME_FLAG_IN_USE) {
             bdrv_dirty_bitmap_set_inconsistent(bitmap);
         } else {
+            track_bitmap_changes(bs, bitmap);
             /* NB: updated flags only get written if can_write(bs) is true. */
             bm->flags |= BME_FLAG_IN_USE;
             needs_update = true;
@@ -1440,6 +1454,169 @@ fail:
     return ret;
 }
 
+/*
+ * Whether bm->dirty_bitmap can be stored by only rewriting the clusters that
+ * changed since it was loaded or last stored.  This needs the bitmap table
+ * in the image to still have the right size and granularity.
+ */
+static bool GRAPH_RDLOCK
+can_store_bitmap_changes(BlockDriverState *bs, Qcow2Bitmap *bm)
+{
+    BDRVQcow2State *s = bs->opaque;
+    BdrvDirtyBitmap *bitmap = bm->dirty_bitmap;
+    uint64_t bm_size = bdrv_dirty_bitmap_size(bitmap);
+
+    return bdrv_dirty_bitmap_has_meta(bitmap) &&
+           bm->table.offset != 0 &&
+           bm->granularity_bits ==
+               ctz32(bdrv_dirty_bitmap_granularity(bitmap)) &&
+           bm->table.size ==
+               size_to_clusters(s, bdrv_dirty_bitmap_serialization_size(
+                                       bitmap, 0, bm_size));
+}
+
+/* store_bitmap_changes()
+ * Store the changed parts of bm->dirty_bitmap to qcow2, updating the bitmap
+ * table in place.  This is safe because the bitmap is marked IN_USE in the
+ * image until the bitmap directory is updated, so its data is not trusted
+ * until then.
+ */
+static int GRAPH_RDLOCK
+store_bitmap_changes(BlockDriverState *bs, Qcow2Bitmap *bm, Error **errp)
+{
+    int ret;
+    BDRVQcow2State *s = bs->opaque;
+    BdrvDirtyBitmap *bitmap = bm->dirty_bitmap;
+    const char *bm_name = bdrv_dirty_bitmap_name(bitmap);
+    uint64_t bm_size = bdrv_dirty_bitmap_size(bitmap);
+    size_t tb_bytes = bm->table.size * BME_TABLE_ENTRY_SIZE;
+    uint64_t *tb, *new_tb;
+    uint8_t *buf;
+    uint64_t limit;
+    int64_t offset;
+    uint32_t i;
+
+    ret = bitmap_table_load(bs, &bm->table, &tb);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret,
+                         "Could not read bitmap_table table from image for "
+                         "bitmap '%s'", bm_name);
+        return ret;
+    }
+
+    new_tb = g_memdup2(tb, tb_bytes);
+    buf = g_malloc(s->cluster_size);
+    limit = bdrv_dirty_bitmap_serialization_coverage(s->cluster_size, bitmap);
+
+    offset = 0;
+    while ((offset = bdrv_dirty_bitmap_meta_next_dirty(bitmap, offset)) >= 0) {
+        uint64_t cluster, end, write_size;
+        int64_t off;
+
+        offset = QEMU_ALIGN_DOWN(offset, limit);
+        cluster = offset / limit;
+        end = MIN(bm_size, offset + limit);
+        assert(cluster < bm->table.size);
+
+        if (bdrv_dirty_bitmap_next_dirty(bitmap, offset, end - offset) < 0) {
+            /* No dirty bits left, the data cluster is not needed anymore */
+            new_tb[cluster] = 0;
+            offset = end;
+            continue;
+        }
+
+        off = tb[cluster] & BME_TABLE_ENTRY_OFFSET_MASK;
+        if (!off) {
+            off = qcow2_alloc_clusters(bs, s->cluster_size);
+            if (off < 0) {
+                error_setg_errno(errp, -off,
+                                 "Failed to allocate clusters for bitmap '%s'",
+                                 bm_name);
+                ret = off;
+                goto fail;
+            }
+            new_tb[cluster] = off;
+        }
+
+        write_size = bdrv_dirty_bitmap_serialization_size(bitmap, offset,
+                                                          end - offset);
+        assert(write_size <= s->cluster_size);
+
+        bdrv_dirty_bitmap_serialize_part(bitmap, buf, offset, end - offset);
+        if (write_size < s->cluster_size) {
+            memset(buf + write_size, 0, s->cluster_size - write_size);
+        }
+
+        ret = qcow2_pre_write_overlap_check(bs, 0, off, s->cluster_size, false);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Qcow2 overlap check failed");
+            goto fail;
+        }
+
+        ret = bdrv_pwrite(bs->file, off, s->cluster_size, buf, 0);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Failed to write bitmap '%s' to file",
+                             bm_name);
+            goto fail;
+        }
+
+        offset = end;
+    }
+
+    if (memcmp(tb, new_tb, tb_bytes) != 0) {
+        ret = qcow2_pre_write_overlap_check(bs, 0, bm->table.offset, tb_bytes,
+                                            false);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Qcow2 overlap check failed");
+            goto fail;
+        }
+
+        bitmap_table_bswap_be(new_tb, bm->table.size);
+        ret = bdrv_pwrite(bs->file, bm->table.offset, tb_bytes, new_tb, 0);
+        bitmap_table_bswap_be(new_tb, bm->table.size);
+        if (ret < 0) {
+            /*
+             * The table may be partially written, so just leak the new
+             * clusters instead of risking to free referenced ones.
+             */
+            error_setg_errno(errp, -ret, "Failed to write bitmap '%s' to file",
+                             bm_name);
+            goto out;
+        }
+
+        /* Data clusters that were dropped from the table can be freed now */
+        for (i = 0; i < bm->table.size; i++) {
+            uint64_t old = tb[i] & BME_TABLE_ENTRY_OFFSET_MASK;
+
+            if (old && (new_tb[i] & BME_TABLE_ENTRY_OFFSET_MASK) != old) {
+                qcow2_free_clusters(bs, old, s->cluster_size,
+                                    QCOW2_DISCARD_ALWAYS);
+            }
+        }
+    }
+
+    ret = 0;
+    goto out;
+
+fail:
+    /* Free the new clusters, which the table in the image does not know */
+    for (i = 0; i < bm->table.size; i++) {
+        uint64_t new = new_tb[i] & BME_TABLE_ENTRY_OFFSET_MASK;
+
+        if (new && new != (tb[i] & BME_TABLE_ENTRY_OFFSET_MASK)) {
+            qcow2_free_clusters(bs, new, s->cluster_size,
+                                QCOW2_DISCARD_ALWAYS);
+        }
+    }
+
+out:
+    g_free(buf);
+    g_free(new_tb);
+    g_free(tb);
+
+    return ret;
+}
+
 static Qcow2Bitmap *find_bitmap_by_name(Qcow2BitmapList *bm_list,
                                         const char *name)
 {
@@ -1609,10 +1786,14 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
                            name);
                 goto fail;
             }
-            tb = g_memdup2(&bm->table, sizeof(bm->table));
-            bm->table.offset = 0;
-            bm->table.size = 0;
-            QSIMPLEQ_INSERT_TAIL(&drop_tables, tb, entry);
+            bm->dirty_bitmap = bitmap;
+            bm->in_place = can_store_bitmap_changes(bs, bm);
+            if (!bm->in_place) {
+                tb = g_memdup2(&bm->table, sizeof(bm->table));
+                bm->table.offset = 0;
+                bm->table.size = 0;
+                QSIMPLEQ_INSERT_TAIL(&drop_tables, tb, entry);
+            }
         }
         bm->flags = bdrv_dirty_bitmap_enabled(bitmap) ? BME_FLAG_AUTO : 0;
         bm->granularity_bits = ctz32(bdrv_dirty_bitmap_granularity(bitmap));
@@ -1636,7 +1817,11 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
             continue;
         }
 
-        ret = store_bitmap(bs, bm, errp);
+        if (bm->in_place) {
+            ret = store_bitmap_changes(bs, bm, errp);
+        } else {
+            ret = store_bitmap(bs, bm, errp);
+        }
         if (ret < 0) {
             goto fail;
         }
@@ -1655,6 +1840,16 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
         g_free(tb);
     }
 
+    /* The image is in sync now, so only later changes need to be stored */
+    if (!release_stored) {
+        QSIMPLEQ_FOREACH(bm, bm_list, entry) {
+            bitmap = bm->dirty_bitmap;
+            if (bitmap && !bdrv_dirty_bitmap_readonly(bitmap)) {
+                track_bitmap_changes(bs, bitmap);
+            }
+        }
+    }
+
 success:
     if (release_stored) {
         QSIMPLEQ_FOREACH(bm, bm_list, entry) {
@@ -1672,7 +1867,7 @@ success:
 fail:
     QSIMPLEQ_FOREACH(bm, bm_list, entry) {
         if (bm->dirty_bitmap == NULL || bm->table.offset == 0 ||
-            bdrv_dirty_bitmap_readonly(bm->dirty_bitmap))
+            bm->in_place || bdrv_dirty_bitmap_readonly(bm->dirty_bitmap))
         {
             continue;
         }
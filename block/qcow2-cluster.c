@@ -742,6 +742,135 @@ fail:
     return ret;
 }
 
+/*
+ * Returns the offset in the image file of the L2 slice that maps guest
+ * offset @offset, or 0 if there is no such L2 table.
+ */
+static uint64_t GRAPH_RDLOCK
+l2_slice_offset(BlockDriverState *bs, uint64_t offset)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t l1_index = offset_to_l1_index(s, offset);
+    uint64_t l2_offset;
+
+    if (l1_index >= s->l1_size) {
+        return 0;
+    }
+
+    l2_offset = s->l1_table[l1_index] & L1E_OFFSET_MASK;
+    if (!l2_offset || offset_into_cluster(s, l2_offset)) {
+        return 0;
+    }
+
+    return l2_offset + l2_entry_size(s) *
+        (offset_to_l2_index(s, offset) - offset_to_l2_slice_index(s, offset));
+}
+
+typedef struct Qcow2L2PrefetchCo {
+    BlockDriverState *bs;
+    uint64_t offset; /* guest offset mapped by the slice */
+} Qcow2L2PrefetchCo;
+
+static void coroutine_fn qcow2_l2_prefetch_entry(void *opaque)
+{
+    Qcow2L2PrefetchCo *p = opaque;
+    BlockDriverState *bs = p->bs;
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t slice_offset;
+    void *l2_slice;
+    int ret;
+
+    GRAPH_RDLOCK_GUARD();
+
+    qemu_co_mutex_lock(&s->lock);
+    /*
+     * The L1 table may have changed since the prefetch was issued, so look
+     * up the slice again rather than loading a possibly freed cluster.
+     */
+    slice_offset = l2_slice_offset(bs, p->offset);
+    if (slice_offset &&
+        !qcow2_cache_is_table_offset(s->l2_table_cache, slice_offset)) {
+        trace_qcow2_l2_prefetch_load(qemu_coroutine_self(), p->offset,
+                                     slice_offset);
+        ret = qcow2_cache_get(bs, s->l2_table_cache, slice_offset, &l2_slice);
+        if (ret < 0) {
+            s->l2_prefetch_failed++;
+        } else {
+            s->l2_prefetch_loaded++;
+            qcow2_cache_put(s->l2_table_cache, &l2_slice);
+        }
+    }
+    s->l2_prefetch_in_flight--;
+    qemu_co_mutex_unlock(&s->lock);
+
+    bdrv_dec_in_flight(bs);
+    g_free(p);
+}
+
+/*
+ * Readahead detector for L2 slices.  Called with s->lock held for every
+ * guest read of [@offset, @offset + @bytes).  If the read continues a
+ * sequential or constant-stride stream, the L2 slices that the next
+ * s->l2_prefetch reads will need are loaded into the cache in background
+ * coroutines, so that the metadata reads overlap with the data I/O.
+ */
+void coroutine_fn qcow2_l2_prefetch(BlockDriverState *bs, uint64_t offset,
+                                    uint64_t bytes)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t coverage = (uint64_t) s->l2_slice_size << s->cluster_bits;
+    uint64_t disk_size = bs->total_sectors * BDRV_SECTOR_SIZE;
+    int64_t stride = offset - s->l2_prefetch_last;
+    bool sequential = offset == s->l2_prefetch_end;
+    bool strided = stride > 0 && stride == s->l2_prefetch_stride;
+    uint64_t step;
+    unsigned n;
+
+    s->l2_prefetch_last = offset;
+    s->l2_prefetch_end = offset + bytes;
+    s->l2_prefetch_stride = stride;
+
+    if (!sequential && !strided) {
+        s->l2_prefetch_next = 0;
+        return;
+    }
+
+    step = MAX(sequential ? bytes : stride, coverage);
+    for (n = 1; n <= s->l2_prefetch; n++) {
+        uint64_t target = QEMU_ALIGN_DOWN(offset + n * step, coverage);
+        uint64_t slice_offset;
+        Qcow2L2PrefetchCo *p;
+        Coroutine *co;
+
+        if (target >= disk_size ||
+            s->l2_prefetch_in_flight >= s->l2_prefetch) {
+            break;
+        }
+        if (target < s->l2_prefetch_next) {
+            continue;
+        }
+        s->l2_prefetch_next = target + coverage;
+
+        slice_offset = l2_slice_offset(bs, target);
+        if (!slice_offset ||
+            qcow2_cache_is_table_offset(s->l2_table_cache, slice_offset)) {
+            continue;
+        }
+
+        p = g_new(Qcow2L2PrefetchCo, 1);
+        *p = (Qcow2L2PrefetchCo) {
+            .bs = bs,
+            .offset = target,
+        };
+
+        s->l2_prefetch_in_flight++;
+        s->l2_prefetch_issued++;
+        bdrv_inc_in_flight(bs);
+        co = qemu_coroutine_create(qcow2_l2_prefetch_entry, p);
+        aio_co_enter(bdrv_get_aio_context(bs), co);
+    }
+}
+
 /*
  * get_cluster_table
  *
@@ -26,6 +26,7 @@
 #include "block/block-io.h"
 #include "qapi/error.h"
 #include "qcow2.h"
+#include "block/aio_task.h"
 #include "qemu/range.h"
 #include "qemu/bswap.h"
 #include "qemu/cutils.h"
@@ -733,11 +734,79 @@ fail:
     return ret;
 }
 
-void qcow2_process_discards(BlockDriverState *bs, int ret)
+typedef struct Qcow2DiscardTask {
+    AioTask task;
+    BlockDriverState *bs;
+    uint64_t offset;
+    uint64_t bytes;
+} Qcow2DiscardTask;
+
+static int coroutine_fn GRAPH_RDLOCK qcow2_discard_task_entry(AioTask *task)
+{
+    Qcow2DiscardTask *t = container_of(task, Qcow2DiscardTask, task);
+    int ret;
+
+    ret = bdrv_co_pdiscard(t->bs->file, t->offset, t->bytes);
+    if (ret < 0) {
+        trace_qcow2_process_discards_failed_region(t->offset, t->bytes, ret);
+    }
+
+    /* Discard is optional, ignore the return value */
+    return 0;
+}
+
+/*
+ * Submit all queued discards concurrently, up to QCOW2_MAX_WORKERS at a
+ * time, and wait for them.  They must have completed before the clusters
+ * can be reused, so this cannot be left running in the background.
+ */
+static void coroutine_fn GRAPH_RDLOCK
+qcow2_co_process_discards(BlockDriverState *bs)
+{
+    BDRVQcow2State *s = bs->opaque;
+    AioTaskPool *aio = aio_task_pool_new(QCOW2_MAX_WORKERS);
+    Qcow2DiscardRegion *d, *next;
+
+    QTAILQ_FOREACH_SAFE(d, &s->discards, next, next) {
+        Qcow2DiscardTask *task = g_new(Qcow2DiscardTask, 1);
+
+        QTAILQ_REMOVE(&s->discards, d, next);
+        *task = (Qcow2DiscardTask) {
+            .task.func = qcow2_discard_task_entry,
+            .bs = bs,
+            .offset = d->offset,
+            .bytes = d->bytes,
+        };
+        g_free(d);
+        aio_task_pool_start_task(aio, &task->task);
+    }
+
+    aio_task_pool_wait_all(aio);
+    g_free(aio);
+}
+
+void coroutine_mixed_fn qcow2_process_discards(BlockDriverState *bs, int ret)
 {
     BDRVQcow2State *s = bs->opaque;
     Qcow2DiscardRegion *d, *next;
 
+    if (trace_event_get_state_backends(TRACE_QCOW2_PROCESS_DISCARDS)) {
+        uint64_t bytes = 0;
+        int nr = 0;
+
+        QTAILQ_FOREACH(d, &s->discards, next) {
+            bytes += d->bytes;
+            nr++;
+        }
+        trace_qcow2_process_discards(bs, nr, bytes, ret);
+    }
+
+    if (ret >= 0 && qemu_in_coroutine() &&
+        QTAILQ_FIRST(&s->discards) != QTAILQ_LAST(&s->discards)) {
+        qcow2_co_process_discards(bs);
+        return;
+    }
+
     QTAILQ_FOREACH_SAFE(d, &s->discards, next, next) {
         QTAILQ_REMOVE(&s->discards, d, next);
 
@@ -1241,6 +1310,26 @@ int qcow2_flush_caches(BlockDriverState *bs)
 
 
 /* update the refcounts of snapshots and the copied flag */
+/*
+ * Apply @addend to the refcounts of the *@run_bytes long run of clusters at
+ * @run_start, if any, and reset the run.  Must be called with the same
+ * locks held as qcow2_update_snapshot_refcount().
+ */
+static int GRAPH_RDLOCK
+update_snapshot_refcount_run(BlockDriverState *bs, uint64_t run_start,
+                             uint64_t *run_bytes, int addend)
+{
+    uint64_t bytes = *run_bytes;
+
+    if (!bytes || addend == 0) {
+        return 0;
+    }
+
+    *run_bytes = 0;
+    return update_refcount(bs, run_start, bytes, abs(addend), addend < 0,
+                           QCOW2_DISCARD_SNAPSHOT);
+}
+
 int qcow2_update_snapshot_refcount(BlockDriverState *bs,
     int64_t l1_table_offset, int l1_size, int addend)
 {
@@ -1249,6 +1338,7 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
     bool l1_allocated = false;
     int64_t old_entry, old_l2_offset;
     unsigned slice, slice_size2, n_slices;
+    uint64_t run_start, run_bytes;
     int i, j, l1_modified = 0;
     int ret;
 
@@ -1309,13 +1399,17 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
                     goto fail;
                 }
 
+                /*
+                 * First update the refcounts of all clusters in the slice.
+                 * Data clusters are usually allocated sequentially, so
+                 * contiguous runs of them are updated with one
+                 * update_refcount() call instead of one per cluster.
+                 */
+                run_start = run_bytes = 0;
                 for (j = 0; j < s->l2_slice_size; j++) {
-                    uint64_t cluster_index;
                     uint64_t offset;
 
-                    entry = get_l2_entry(s, l2_slice, j);
-                    old_entry = entry;
-                    entry &= ~QCOW_OFLAG_COPIED;
+                    entry = get_l2_entry(s, l2_slice, j) & ~QCOW_OFLAG_COPIED;
                     offset = entry & L2E_OFFSET_MASK;
 
                     switch (qcow2_get_cluster_type(bs, entry)) {
@@ -1324,6 +1418,12 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
                             uint64_t coffset;
                             int csize;
 
+                            ret = update_snapshot_refcount_run(
+                                bs, run_start, &run_bytes, addend);
+                            if (ret < 0) {
+                                goto fail;
+                            }
+
                             qcow2_parse_compressed_l2_entry(bs, entry,
                                                             &coffset, &csize);
                             ret = update_refcount(
@@ -1334,8 +1434,6 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
                                 goto fail;
                             }
                         }
-                        /* compressed clusters are never modified */
-                        refcount = 2;
                         break;
 
                     case QCOW2_CLUSTER_NORMAL:
@@ -1353,31 +1451,62 @@ int qcow2_update_snapshot_refcount(BlockDriverState *bs,
                             goto fail;
                         }
 
-                        cluster_index = offset >> s->cluster_bits;
-                        assert(cluster_index);
+                        assert(offset >> s->cluster_bits);
                         if (addend != 0) {
-                            ret = qcow2_update_cluster_refcount(
-                                bs, cluster_index, abs(addend), addend < 0,
-                                QCOW2_DISCARD_SNAPSHOT);
+                            if (run_bytes && run_start + run_bytes == offset) {
+                                run_bytes += s->cluster_size;
+                                break;
+                            }
+                            ret = update_snapshot_refcount_run(
+                                bs, run_start, &run_bytes, addend);
                             if (ret < 0) {
                                 goto fail;
                             }
-                        }
-
-                        ret = qcow2_get_refcount(bs, cluster_index, &refcount);
-                        if (ret < 0) {
-                            goto fail;
+                            run_start = offset;
+                            run_bytes = s->cluster_size;
                         }
                         break;
 
                     case QCOW2_CLUSTER_ZERO_PLAIN:
                     case QCOW2_CLUSTER_UNALLOCATED:
-                        refcount = 0;
                         break;
 
                     default:
                         abort();
                     }
+                }
+                ret = update_snapshot_refcount_run(bs, run_start, &run_bytes,
+                                                   addend);
+                if (ret < 0) {
+                    goto fail;
+                }
+
+                /* Then fix up the COPIED flags for the new refcounts */
+                for (j = 0; j < s->l2_slice_size; j++) {
+                    entry = get_l2_entry(s, l2_slice, j);
+                    old_entry = entry;
+                    entry &= ~QCOW_OFLAG_COPIED;
+
+                    switch (qcow2_get_cluster_type(bs, entry)) {
+                    case QCOW2_CLUSTER_COMPRESSED:
+                        /* compressed clusters are never modified */
+                        refcount = 2;
+                        break;
+
+                    case QCOW2_CLUSTER_NORMAL:
+                    case QCOW2_CLUSTER_ZERO_ALLOC:
+                        ret = qcow2_get_refcount(bs, (entry & L2E_OFFSET_MASK)
+                                                 >> s->cluster_bits,
+                                                 &refcount);
+                        if (ret < 0) {
+                            goto fail;
+                        }
+                        break;
+
+                    default:
+                        refcount = 0;
+                        break;
+                    }
 
                     if (refcount == 1) {
                         entry |= QCOW_OFLAG_COPIED;
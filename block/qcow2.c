@@ -701,6 +701,8 @@ static const char *const mutable_opts[] = {
     QCOW2_OPT_L2_CACHE_ENTRY_SIZE,
     QCOW2_OPT_REFCOUNT_CACHE_SIZE,
     QCOW2_OPT_CACHE_CLEAN_INTERVAL,
+    QCOW2_OPT_L2_PREFETCH,
+    QCOW2_OPT_WORKER_THREADS,
     NULL
 };
 
@@ -817,6 +819,18 @@ static QemuOptsList qcow2_runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "Clean unused cache entries after this time (in seconds)",
         },
+        {
+            .name = QCOW2_OPT_L2_PREFETCH,
+            .type = QEMU_OPT_NUMBER,
+            .help = "Number of L2 slices to read ahead for sequential and "
+                    "strided reads (0 = disabled)",
+        },
+        {
+            .name = QCOW2_OPT_WORKER_THREADS,
+            .type = QEMU_OPT_NUMBER,
+            .help = "Maximum number of concurrent compression and encryption "
+                    "jobs in the thread pool",
+        },
         BLOCK_CRYPTO_OPT_DEF_KEY_SECRET("encrypt.",
             "ID of secret providing qcow2 AES key or LUKS passphrase"),
         { /* end of list */ }
@@ -979,6 +993,8 @@ typedef struct Qcow2ReopenState {
     bool discard_passthrough[QCOW2_DISCARD_MAX];
     bool discard_no_unref;
     uint64_t cache_clean_interval;
+    uint64_t l2_prefetch;
+    uint64_t max_threads;
     QCryptoBlockOpenOptions *crypto_opts; /* Disk encryption runtime options */
 } Qcow2ReopenState;
 
@@ -1079,6 +1095,28 @@ qcow2_update_options_prepare(BlockDriverState *bs, Qcow2ReopenState *r,
         goto fail;
     }
 
+    /*
+     * Prefetched slices must not push the slices of in-flight requests out
+     * of the cache, so allow at most half of the L2 cache to be read ahead.
+     */
+    r->l2_prefetch = qemu_opt_get_number(opts, QCOW2_OPT_L2_PREFETCH, 0);
+    if (r->l2_prefetch > l2_cache_size / 2) {
+        error_setg(errp, QCOW2_OPT_L2_PREFETCH " may not exceed half the "
+                   "number of L2 cache entries (%" PRIu64 ")",
+                   l2_cache_size / 2);
+        ret = -EINVAL;
+        goto fail;
+    }
+
+    r->max_threads = qemu_opt_get_number(opts, QCOW2_OPT_WORKER_THREADS,
+                                         QCOW2_DEFAULT_THREADS);
+    if (r->max_threads < 1 || r->max_threads > INT_MAX) {
+        error_setg(errp, QCOW2_OPT_WORKER_THREADS " must be between 1 and %d",
+                   INT_MAX);
+        ret = -EINVAL;
+        goto fail;
+    }
+
     /* lazy-refcounts; flush if going from enabled to disabled */
     r->use_lazy_refcounts = qemu_opt_get_bool(opts, QCOW2_OPT_LAZY_REFCOUNTS,
         (s->compatible_features & QCOW2_COMPAT_LAZY_REFCOUNTS));
@@ -1239,6 +1277,10 @@ static void qcow2_update_options_commit(BlockDriverState *bs,
 
     s->discard_no_unref = r->discard_no_unref;
 
+    s->l2_prefetch = r->l2_prefetch;
+    s->l2_prefetch_next = 0;
+    s->max_threads = r->max_threads;
+
     if (s->cache_clean_interval != r->cache_clean_interval) {
         cache_clean_timer_del(bs);
         s->cache_clean_interval = r->cache_clean_interval;
@@ -2408,6 +2450,9 @@ qcow2_co_preadv_part(BlockDriverState *bs, int64_t offset, int64_t bytes,
         qemu_co_mutex_lock(&s->lock);
         ret = qcow2_get_host_offset(bs, offset, &cur_bytes,
                                     &host_offset, &type);
+        if (ret == 0 && s->l2_prefetch) {
+            qcow2_l2_prefetch(bs, offset, cur_bytes);
+        }
         qemu_co_mutex_unlock(&s->lock);
         if (ret < 0) {
             goto out;
@@ -4673,63 +4718,157 @@ fail:
     return ret;
 }
 
+typedef struct Qcow2CompressTask {
+    AioTask task;
+
+    BlockDriverState *bs;
+    const void *src;
+    void *dest;
+    ssize_t *out_len;
+} Qcow2CompressTask;
+
+static int coroutine_fn qcow2_compress_task_entry(AioTask *task)
+{
+    Qcow2CompressTask *t = container_of(task, Qcow2CompressTask, task);
+    BDRVQcow2State *s = t->bs->opaque;
+
+    *t->out_len = qcow2_co_compress(t->bs, t->dest, s->cluster_size - 1,
+                                    t->src, s->cluster_size);
+
+    /* -ENOMEM means the cluster is incompressible, which is not an error */
+    if (*t->out_len < 0 && *t->out_len != -ENOMEM) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/*
+ * Compress and write a batch of clusters starting at the cluster aligned
+ * @offset.  All clusters are compressed concurrently in the thread pool, then
+ * host space for all of them is allocated at once and runs of contiguous
+ * compressed clusters are written with a single request.  Clusters that do
+ * not compress are written as normal clusters.
+ */
 static int coroutine_fn GRAPH_RDLOCK
 qcow2_co_pwritev_compressed_task(BlockDriverState *bs,
                                  uint64_t offset, uint64_t bytes,
                                  QEMUIOVector *qiov, size_t qiov_offset)
 {
     BDRVQcow2State *s = bs->opaque;
-    int ret;
-    ssize_t out_len;
+    int nb_clusters = size_to_clusters(s, bytes);
+    size_t buf_size = (size_t) nb_clusters * s->cluster_size;
+    g_autofree ssize_t *out_len = g_new(ssize_t, nb_clusters);
+    g_autofree uint64_t *host_offset = g_new(uint64_t, nb_clusters);
     uint8_t *buf, *out_buf;
-    uint64_t cluster_offset;
+    int i, ret;
 
-    assert(bytes == s->cluster_size || (bytes < s->cluster_size &&
-           (offset + bytes == bs->total_sectors << BDRV_SECTOR_BITS)));
+    assert(!offset_into_cluster(s, offset));
+    assert(!offset_into_cluster(s, bytes) ||
+           (offset + bytes == bs->total_sectors << BDRV_SECTOR_BITS));
 
-    buf = qemu_blockalign(bs, s->cluster_size);
-    if (bytes < s->cluster_size) {
+    buf = qemu_blockalign(bs, buf_size);
+    if (bytes < buf_size) {
         /* Zero-pad last write if image size is not cluster aligned */
-        memset(buf + bytes, 0, s->cluster_size - bytes);
+        memset(buf + bytes, 0, buf_size - bytes);
     }
     qemu_iovec_to_buf(qiov, qiov_offset, buf, bytes);
 
-    out_buf = g_malloc(s->cluster_size);
+    out_buf = g_malloc(buf_size);
 
-    out_len = qcow2_co_compress(bs, out_buf, s->cluster_size - 1,
-                                buf, s->cluster_size);
-    if (out_len == -ENOMEM) {
-        /* could not compress: write normal cluster */
-        ret = qcow2_co_pwritev_part(bs, offset, bytes, qiov, qiov_offset, 0);
-        if (ret < 0) {
-            goto fail;
+    if (nb_clusters == 1) {
+        out_len[0] = qcow2_co_compress(bs, out_buf, s->cluster_size - 1,
+                                       buf, s->cluster_size);
+        ret = out_len[0] < 0 && out_len[0] != -ENOMEM ? -EINVAL : 0;
+    } else {
+        AioTaskPool *aio = aio_task_pool_new(nb_clusters);
+
+        for (i = 0; i < nb_clusters; i++) {
+            Qcow2CompressTask *task = g_new(Qcow2CompressTask, 1);
+
+            *task = (Qcow2CompressTask) {
+                .task.func = qcow2_compress_task_entry,
+                .bs = bs,
+                .src = buf + (size_t) i * s->cluster_size,
+                .dest = out_buf + (size_t) i * s->cluster_size,
+                .out_len = &out_len[i],
+            };
+            aio_task_pool_start_task(aio, &task->task);
         }
-        goto success;
-    } else if (out_len < 0) {
-        ret = -EINVAL;
-        goto fail;
+        aio_task_pool_wait_all(aio);
+        ret = aio_task_pool_status(aio);
+        g_free(aio);
     }
-
-    qemu_co_mutex_lock(&s->lock);
-    ret = qcow2_alloc_compressed_cluster_offset(bs, offset, out_len,
-                                                &cluster_offset);
     if (ret < 0) {
-        qemu_co_mutex_unlock(&s->lock);
         goto fail;
     }
 
-    ret = qcow2_pre_write_overlap_check(bs, 0, cluster_offset, out_len, true);
+    /*
+     * Allocate everything under a single lock section so that the
+     * compressed clusters of the batch end up next to each other.
+     */
+    qemu_co_mutex_lock(&s->lock);
+    for (i = 0; i < nb_clusters; i++) {
+        if (out_len[i] == -ENOMEM) {
+            continue;
+        }
+
+        ret = qcow2_alloc_compressed_cluster_offset(
+            bs, offset + (uint64_t) i * s->cluster_size, out_len[i],
+            &host_offset[i]);
+        if (ret < 0) {
+            break;
+        }
+
+        ret = qcow2_pre_write_overlap_check(bs, 0, host_offset[i], out_len[i],
+                                            true);
+        if (ret < 0) {
+            break;
+        }
+    }
     qemu_co_mutex_unlock(&s->lock);
     if (ret < 0) {
         goto fail;
     }
 
-    BLKDBG_CO_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
-    ret = bdrv_co_pwrite(s->data_file, cluster_offset, out_len, out_buf, 0);
-    if (ret < 0) {
-        goto fail;
+    i = 0;
+    while (i < nb_clusters) {
+        uint64_t cluster_offset = (uint64_t) i * s->cluster_size;
+        QEMUIOVector write_qiov;
+        uint64_t start, len;
+        int j;
+
+        if (out_len[i] == -ENOMEM) {
+            /* could not compress: write normal cluster */
+            ret = qcow2_co_pwritev_part(bs, offset + cluster_offset,
+                                        MIN(s->cluster_size,
+                                            bytes - cluster_offset),
+                                        qiov, qiov_offset + cluster_offset, 0);
+            if (ret < 0) {
+                goto fail;
+            }
+            i++;
+            continue;
+        }
+
+        start = host_offset[i];
+        len = 0;
+        qemu_iovec_init(&write_qiov, nb_clusters - i);
+        for (j = i; j < nb_clusters && out_len[j] != -ENOMEM &&
+                    host_offset[j] == start + len; j++) {
+            qemu_iovec_add(&write_qiov,
+                           out_buf + (size_t) j * s->cluster_size, out_len[j]);
+            len += out_len[j];
+        }
+
+        BLKDBG_CO_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
+        ret = bdrv_co_pwritev(s->data_file, start, len, &write_qiov, 0);
+        qemu_iovec_destroy(&write_qiov);
+        if (ret < 0) {
+            goto fail;
+        }
+        i = j;
     }
-success:
+
     ret = 0;
 fail:
     qemu_vfree(buf);
@@ -4793,7 +4932,8 @@ qcow2_co_pwritev_compressed_part(BlockDriverState *bs,
     }
 
     while (bytes && aio_task_pool_status(aio) == 0) {
-        uint64_t chunk_size = MIN(bytes, s->cluster_size);
+        uint64_t chunk_size = MIN(bytes, MAX(QCOW2_COMPRESS_BATCH_SIZE,
+                                             s->cluster_size));
 
         if (!aio && chunk_size != bytes) {
             aio = aio_task_pool_new(QCOW2_MAX_WORKERS);
@@ -5329,6 +5469,27 @@ qcow2_get_specific_info(BlockDriverState *bs, Error **errp)
     return spec_info;
 }
 
+static BlockStatsSpecific *qcow2_get_specific_stats(BlockDriverState *bs)
+{
+    BlockStatsSpecific *stats;
+    BDRVQcow2State *s = bs->opaque;
+
+    /* All counters are about prefetching; leave them out if it is unused */
+    if (!s->l2_prefetch && !s->l2_prefetch_issued) {
+        return NULL;
+    }
+
+    stats = g_new(BlockStatsSpecific, 1);
+    stats->driver = BLOCKDEV_DRIVER_QCOW2;
+    stats->u.qcow2 = (BlockStatsSpecificQcow2) {
+        .l2_prefetch_issued = s->l2_prefetch_issued,
+        .l2_prefetch_loaded = s->l2_prefetch_loaded,
+        .l2_prefetch_failed = s->l2_prefetch_failed,
+    };
+
+    return stats;
+}
+
 static int coroutine_mixed_fn GRAPH_RDLOCK
 qcow2_has_zero_init(BlockDriverState *bs)
 {
@@ -6178,6 +6339,7 @@ BlockDriver bdrv_qcow2 = {
     .bdrv_measure                       = qcow2_measure,
     .bdrv_co_get_info                   = qcow2_co_get_info,
     .bdrv_get_specific_info             = qcow2_get_specific_info,
+    .bdrv_get_specific_stats            = qcow2_get_specific_stats,
 
     .bdrv_co_save_vmstate               = qcow2_co_save_vmstate,
     .bdrv_co_load_vmstate               = qcow2_co_load_vmstate,
@@ -71,6 +71,13 @@
 /* Maximum of parallel sub-request per guest request */
 #define QCOW2_MAX_WORKERS 8
 
+/*
+ * Compressed writes are processed in batches of clusters that are compressed
+ * concurrently and written to contiguous host space.  This is the size of the
+ * uncompressed data in one batch (at least one cluster).
+ */
+#define QCOW2_COMPRESS_BATCH_SIZE (1 * MiB)
+
 /* indicate that the refcount of the referenced cluster is exactly one. */
 #define QCOW_OFLAG_COPIED     (1ULL << 63)
 /* indicate that the cluster is compressed (they never have the copied flag) */
@@ -150,6 +157,8 @@
 #define QCOW2_OPT_L2_CACHE_ENTRY_SIZE "l2-cache-entry-size"
 #define QCOW2_OPT_REFCOUNT_CACHE_SIZE "refcount-cache-size"
 #define QCOW2_OPT_CACHE_CLEAN_INTERVAL "cache-clean-interval"
+#define QCOW2_OPT_L2_PREFETCH "l2-prefetch"
+#define QCOW2_OPT_WORKER_THREADS "worker-threads"
 
 typedef struct QCowHeader {
     uint32_t magic;
@@ -322,7 +331,7 @@ typedef struct Qcow2BitmapHeaderExt {
     uint64_t bitmap_directory_offset;
 } QEMU_PACKED Qcow2BitmapHeaderExt;
 
-#define QCOW2_MAX_THREADS 4
+#define QCOW2_DEFAULT_THREADS 4
 
 typedef struct BDRVQcow2State {
     int cluster_bits;
@@ -348,6 +357,21 @@ typedef struct BDRVQcow2State {
     QEMUTimer *cache_clean_timer;
     unsigned cache_clean_interval;
 
+    /*
+     * L2 slice readahead for sequential and strided reads.  l2_prefetch is
+     * the number of slices to load ahead of the reader (0 disables it), the
+     * other fields hold the detector state and are protected by s->lock.
+     */
+    unsigned l2_prefetch;
+    uint64_t l2_prefetch_last;
+    uint64_t l2_prefetch_end;
+    int64_t l2_prefetch_stride;
+    uint64_t l2_prefetch_next;
+    unsigned l2_prefetch_in_flight;
+    uint64_t l2_prefetch_issued;
+    uint64_t l2_prefetch_loaded;
+    uint64_t l2_prefetch_failed;
+
     QLIST_HEAD(, QCowL2Meta) cluster_allocs;
 
     uint64_t *refcount_table;
@@ -410,6 +434,7 @@ typedef struct BDRVQcow2State {
 
     CoQueue thread_task_queue;
     int nb_threads;
+    int max_threads; /* Limit for nb_threads (worker-threads option) */
 
     BdrvChild *data_file;
 
@@ -890,7 +915,8 @@ int GRAPH_RDLOCK qcow2_write_caches(BlockDriverState *bs);
 int coroutine_fn qcow2_check_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
                                        BdrvCheckMode fix);
 
-void GRAPH_RDLOCK qcow2_process_discards(BlockDriverState *bs, int ret);
+void coroutine_mixed_fn GRAPH_RDLOCK
+qcow2_process_discards(BlockDriverState *bs, int ret);
 
 int GRAPH_RDLOCK
 qcow2_check_metadata_overlap(BlockDriverState *bs, int ign, int64_t offset,
@@ -932,6 +958,9 @@ qcow2_get_host_offset(BlockDriverState *bs, uint64_t offset,
                       unsigned int *bytes, uint64_t *host_offset,
                       QCow2SubclusterType *subcluster_type);
 
+void coroutine_fn GRAPH_RDLOCK
+qcow2_l2_prefetch(BlockDriverState *bs, uint64_t offset, uint64_t bytes);
+
 int coroutine_fn GRAPH_RDLOCK
 qcow2_alloc_host_offset(BlockDriverState *bs, uint64_t offset,
                         unsigned int *bytes, uint64_t *host_offset,
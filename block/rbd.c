@@ -23,6 +23,7 @@
 #include "block/qdict.h"
 #include "crypto/secret.h"
 #include "qemu/cutils.h"
+#include "qemu/event_notifier.h"
 #include "system/replay.h"
 #include "qobject/qstring.h"
 #include "qobject/qdict.h"
@@ -107,6 +108,15 @@ typedef struct BDRVRBDState {
      * probing didn't find any known encryption header either.
      */
     RbdImageEncryptionFormat encryption_format;
+
+    /*
+     * If librbd accepted it as image notification fd, completions are queued
+     * by librbd and signalled through this notifier, which is polled in the
+     * AioContext of the node.  Otherwise each completion callback schedules
+     * a BH.
+     */
+    EventNotifier completion_notifier;
+    bool completion_notify;
 } BDRVRBDState;
 
 typedef struct RBDTask {
@@ -116,6 +126,9 @@ typedef struct RBDTask {
     int64_t ret;
 } RBDTask;
 
+/* Maximum number of completions fetched with a single rbd_poll_io_events() */
+#define RBD_POLL_BATCH 32
+
 typedef struct RBDDiffIterateReq {
     uint64_t offs;
     uint64_t bytes;
@@ -1115,6 +1128,85 @@ static int qemu_rbd_attempt_legacy_options(QDict *options,
     return r;
 }
 
+/*
+ * Completion handler used when librbd signals completions through
+ * s->completion_notifier.  All completions that are ready are reaped in one
+ * go, so that a poll iteration handles a whole batch of requests instead of
+ * running one BH per request.
+ */
+static void qemu_rbd_completion_notify_cb(EventNotifier *e)
+{
+    BDRVRBDState *s = container_of(e, BDRVRBDState, completion_notifier);
+    rbd_completion_t comps[RBD_POLL_BATCH];
+    int n;
+
+    event_notifier_test_and_clear(e);
+
+    do {
+        n = rbd_poll_io_events(s->image, comps, RBD_POLL_BATCH);
+        for (int i = 0; i < n; i++) {
+            RBDTask *task = rbd_aio_get_arg(comps[i]);
+
+            task->ret = rbd_aio_get_return_value(comps[i]);
+            rbd_aio_release(comps[i]);
+            task->complete = true;
+            aio_co_wake(task->co);
+        }
+    } while (n == RBD_POLL_BATCH);
+}
+
+static void qemu_rbd_detach_aio_context(BlockDriverState *bs)
+{
+    BDRVRBDState *s = bs->opaque;
+
+    if (!s->completion_notify) {
+        return;
+    }
+    aio_set_event_notifier(bdrv_get_aio_context(bs), &s->completion_notifier,
+                           NULL, NULL, NULL);
+}
+
+static void qemu_rbd_attach_aio_context(BlockDriverState *bs,
+                                        AioContext *new_context)
+{
+    BDRVRBDState *s = bs->opaque;
+
+    if (!s->completion_notify) {
+        return;
+    }
+    aio_set_event_notifier(new_context, &s->completion_notifier,
+                           qemu_rbd_completion_notify_cb, NULL, NULL);
+}
+
+/*
+ * Try to have librbd signal completions through an event notifier instead of
+ * calling qemu_rbd_completion_cb() from its own threads.  If that is not
+ * possible, keep using the completion callback.
+ */
+static void qemu_rbd_setup_completion_notify(BlockDriverState *bs)
+{
+    BDRVRBDState *s = bs->opaque;
+#ifdef CONFIG_EVENTFD
+    int type = EVENT_TYPE_EVENTFD;
+#else
+    int type = EVENT_TYPE_PIPE;
+#endif
+    int fd;
+
+    if (event_notifier_init(&s->completion_notifier, 0) < 0) {
+        return;
+    }
+
+    fd = event_notifier_get_wfd(&s->completion_notifier);
+    if (rbd_set_image_notification(s->image, fd, type) < 0) {
+        event_notifier_cleanup(&s->completion_notifier);
+        return;
+    }
+
+    s->completion_notify = true;
+    qemu_rbd_attach_aio_context(bs, bdrv_get_aio_context(bs));
+}
+
 static int qemu_rbd_open(BlockDriverState *bs, QDict *options, int flags,
                          Error **errp)
 {
@@ -1240,6 +1332,8 @@ static int qemu_rbd_open(BlockDriverState *bs, QDict *options, int flags,
     /* When extending regular files, we get zeros from the OS */
     bs->supported_truncate_flags = BDRV_REQ_ZERO_WRITE;
 
+    qemu_rbd_setup_completion_notify(bs);
+
     r = 0;
     goto out;
 
@@ -1283,7 +1377,11 @@ static void qemu_rbd_close(BlockDriverState *bs)
 {
     BDRVRBDState *s = bs->opaque;
 
+    qemu_rbd_detach_aio_context(bs);
     rbd_close(s->image);
+    if (s->completion_notify) {
+        event_notifier_cleanup(&s->completion_notifier);
+    }
     rados_ioctx_destroy(s->io_ctx);
     g_free(s->snap);
     g_free(s->image_name);
@@ -1358,8 +1456,14 @@ static int coroutine_fn qemu_rbd_start_co(BlockDriverState *bs,
         }
     }
 
-    r = rbd_aio_create_completion(&task,
-                                  (rbd_callback_t) qemu_rbd_completion_cb, &c);
+    if (s->completion_notify) {
+        /* Completions are reaped by qemu_rbd_completion_notify_cb() */
+        r = rbd_aio_create_completion(&task, NULL, &c);
+    } else {
+        r = rbd_aio_create_completion(&task,
+                                      (rbd_callback_t) qemu_rbd_completion_cb,
+                                      &c);
+    }
     if (r < 0) {
         return r;
     }
@@ -1850,6 +1954,8 @@ static BlockDriver bdrv_rbd = {
     .bdrv_parse_filename    = qemu_rbd_parse_filename,
     .bdrv_open              = qemu_rbd_open,
     .bdrv_close             = qemu_rbd_close,
+    .bdrv_attach_aio_context = qemu_rbd_attach_aio_context,
+    .bdrv_detach_aio_context = qemu_rbd_detach_aio_context,
     .bdrv_reopen_prepare    = qemu_rbd_reopen_prepare,
     .bdrv_co_create         = qemu_rbd_co_create,
     .bdrv_co_create_opts    = qemu_rbd_co_create_opts,
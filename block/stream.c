@@ -13,6 +13,7 @@
 
 #include "qemu/osdep.h"
 #include "trace.h"
+#include "block/aio_task.h"
 #include "block/block_int.h"
 #include "block/blockjob_int.h"
 #include "qapi/error.h"
@@ -28,8 +29,23 @@ enum {
      * that populating contiguous regions of the image is efficient.
      */
     STREAM_CHUNK = 512 * 1024, /* in bytes */
+
+    /*
+     * Maximum length of an extent queried with a single block status call.
+     * Extents that need copying are split into STREAM_CHUNK requests.
+     */
+    STREAM_MAX_EXTENT = 16 * 1024 * 1024, /* in bytes */
+
+    /* Number of copy-on-read requests that may be in flight at the same time */
+    STREAM_MAX_WORKERS = 8,
 };
 
+typedef struct StreamRetry {
+    int64_t offset;
+    int64_t bytes;
+    QSIMPLEQ_ENTRY(StreamRetry) next;
+} StreamRetry;
+
 typedef struct StreamBlockJob {
     BlockJob common;
     BlockBackend *blk;
@@ -41,8 +57,22 @@ typedef struct StreamBlockJob {
     char *backing_file_str;
     bool backing_mask_protocol;
     bool bs_read_only;
+
+    /* Requests that are in flight, only valid while stream_run() runs */
+    AioTaskPool *pool;
+    /* Requests that failed and must be issued again after a stop */
+    QSIMPLEQ_HEAD(, StreamRetry) retry_list;
+    /* First error, even if it was ignored */
+    int error;
 } StreamBlockJob;
 
+typedef struct StreamTask {
+    AioTask task;
+    StreamBlockJob *s;
+    int64_t offset;
+    int64_t bytes;
+} StreamTask;
+
 static int coroutine_fn stream_populate(BlockBackend *blk,
                                         int64_t offset, uint64_t bytes)
 {
@@ -149,14 +179,85 @@ static void stream_clean(Job *job)
     g_free(s->backing_file_str);
 }
 
+/*
+ * Record the error @ret for the request at @offset, and return whether the
+ * request must be issued again.  Returns a negative value if the job must
+ * fail.
+ */
+static int coroutine_fn stream_handle_error(StreamBlockJob *s, int64_t offset,
+                                            int64_t bytes, int ret)
+{
+    BlockErrorAction action =
+        block_job_error_action(&s->common, s->on_error, true, -ret);
+
+    if (action == BLOCK_ERROR_ACTION_STOP) {
+        return 1;
+    }
+    if (s->error == 0) {
+        s->error = ret;
+    }
+    if (action == BLOCK_ERROR_ACTION_REPORT) {
+        return ret;
+    }
+
+    /* Ignored, skip the range */
+    job_progress_update(&s->common.job, bytes);
+    return 0;
+}
+
+static int coroutine_fn stream_task_entry(AioTask *task)
+{
+    StreamTask *t = container_of(task, StreamTask, task);
+    StreamBlockJob *s = t->s;
+    int ret;
+
+    ret = stream_populate(s->blk, t->offset, t->bytes);
+    if (ret >= 0) {
+        /* Publish progress */
+        job_progress_update(&s->common.job, t->bytes);
+        return 0;
+    }
+
+    ret = stream_handle_error(s, t->offset, t->bytes, ret);
+    if (ret > 0) {
+        /* Let stream_run() issue the request again once the job is resumed */
+        StreamRetry *retry = g_new(StreamRetry, 1);
+
+        *retry = (StreamRetry) {
+            .offset = t->offset,
+            .bytes  = t->bytes,
+        };
+        QSIMPLEQ_INSERT_TAIL(&s->retry_list, retry, next);
+        ret = 0;
+    }
+
+    return ret;
+}
+
+static void coroutine_fn stream_start_task(StreamBlockJob *s, int64_t offset,
+                                           int64_t bytes)
+{
+    StreamTask *t = g_new(StreamTask, 1);
+
+    *t = (StreamTask) {
+        .task.func = stream_task_entry,
+        .s         = s,
+        .offset    = offset,
+        .bytes     = bytes,
+    };
+
+    block_job_ratelimit_processed_bytes(&s->common, bytes);
+    aio_task_pool_start_task(s->pool, &t->task);
+}
+
 static int coroutine_fn stream_run(Job *job, Error **errp)
 {
     StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
     BlockDriverState *unfiltered_bs = NULL;
     int64_t len = -1;
     int64_t offset = 0;
-    int error = 0;
-    int64_t n = 0; /* bytes */
+    int64_t extent_bytes = 0; /* remaining bytes to copy at @offset */
+    int ret = 0;
 
     WITH_GRAPH_RDLOCK_GUARD() {
         unfiltered_bs = bdrv_skip_filters(s->target_bs);
@@ -172,22 +273,59 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
     }
     job_progress_set_remaining(&s->common.job, len);
 
-    for ( ; offset < len; offset += n) {
+    QSIMPLEQ_INIT(&s->retry_list);
+    s->pool = aio_task_pool_new(STREAM_MAX_WORKERS);
+
+    for (;;) {
+        StreamRetry *retry;
+        int64_t n = 0; /* bytes */
         bool copy;
-        int ret = -1;
 
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
+         * stream_pause() takes care of the requests that are in flight.
          */
         block_job_ratelimit_sleep(&s->common);
         if (job_is_cancelled(&s->common.job)) {
             break;
         }
 
+        ret = aio_task_pool_status(s->pool);
+        if (ret < 0) {
+            break;
+        }
+
+        retry = QSIMPLEQ_FIRST(&s->retry_list);
+        if (retry) {
+            QSIMPLEQ_REMOVE_HEAD(&s->retry_list, next);
+            stream_start_task(s, retry->offset, retry->bytes);
+            g_free(retry);
+            continue;
+        }
+
+        if (extent_bytes > 0) {
+            n = MIN(extent_bytes, STREAM_CHUNK);
+            stream_start_task(s, offset, n);
+            offset += n;
+            extent_bytes -= n;
+            continue;
+        }
+
+        if (offset >= len) {
+            /* Failed requests may still be queued for another attempt */
+            aio_task_pool_wait_all(s->pool);
+            if (QSIMPLEQ_EMPTY(&s->retry_list)) {
+                break;
+            }
+            continue;
+        }
+
         copy = false;
 
         WITH_GRAPH_RDLOCK_GUARD() {
-            ret = bdrv_co_is_allocated(unfiltered_bs, offset, STREAM_CHUNK, &n);
+            ret = bdrv_co_is_allocated(unfiltered_bs, offset,
+                                       MIN(len - offset, STREAM_MAX_EXTENT),
+                                       &n);
             if (ret == 1) {
                 /* Allocated in the top, no need to copy.  */
             } else if (ret >= 0) {
@@ -207,33 +345,49 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
             }
         }
         trace_stream_one_iteration(s, offset, n, ret);
-        if (copy) {
-            ret = stream_populate(s->blk, offset, n);
-        }
         if (ret < 0) {
-            BlockErrorAction action =
-                block_job_error_action(&s->common, s->on_error, true, -ret);
-            if (action == BLOCK_ERROR_ACTION_STOP) {
-                n = 0;
-                continue;
-            }
-            if (error == 0) {
-                error = ret;
-            }
-            if (action == BLOCK_ERROR_ACTION_REPORT) {
+            ret = stream_handle_error(s, offset, n, ret);
+            if (ret < 0) {
                 break;
             }
+            if (ret == 0) {
+                offset += n;
+            }
+            ret = 0;
+            continue;
         }
 
-        /* Publish progress */
-        job_progress_update(&s->common.job, n);
         if (copy) {
-            block_job_ratelimit_processed_bytes(&s->common, n);
+            /* Issued from the top of the loop, one chunk at a time */
+            extent_bytes = n;
+        } else {
+            /* Publish progress */
+            job_progress_update(&s->common.job, n);
+            offset += n;
         }
     }
 
+    aio_task_pool_wait_all(s->pool);
+    aio_task_pool_free(s->pool);
+    s->pool = NULL;
+
+    while (!QSIMPLEQ_EMPTY(&s->retry_list)) {
+        StreamRetry *retry = QSIMPLEQ_FIRST(&s->retry_list);
+        QSIMPLEQ_REMOVE_HEAD(&s->retry_list, next);
+        g_free(retry);
+    }
+
     /* Do not remove the backing file if an error was there but ignored. */
-    return error;
+    return s->error;
+}
+
+static void coroutine_fn stream_pause(Job *job)
+{
+    StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
+
+    if (s->pool) {
+        aio_task_pool_wait_all(s->pool);
+    }
 }
 
 static const BlockJobDriver stream_job_driver = {
@@ -242,6 +396,7 @@ static const BlockJobDriver stream_job_driver = {
         .job_type      = JOB_TYPE_STREAM,
         .free          = block_job_free,
         .run           = stream_run,
+        .pause         = stream_pause,
         .prepare       = stream_prepare,
         .clean         = stream_clean,
         .user_resume   = block_job_user_resume,
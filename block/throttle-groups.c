@@ -70,11 +70,12 @@ struct ThrottleGroup {
     bool is_initialized;
     char *name; /* This is constant during the lifetime of the group */
 
-    QemuMutex lock; /* This lock protects the following four fields */
+    QemuMutex lock; /* This lock protects the following five fields */
     ThrottleState ts;
     QLIST_HEAD(, ThrottleGroupMember) head;
     ThrottleGroupMember *tokens[THROTTLE_MAX];
     bool any_timer_armed[THROTTLE_MAX];
+    unsigned budgets_granted; /* members with a budget, see below */
     QEMUClockType clock_type;
 
     /* This field is protected by the global QEMU mutex */
@@ -85,6 +86,27 @@ struct ThrottleGroup {
 static QTAILQ_HEAD(, ThrottleGroup) throttle_groups =
     QTAILQ_HEAD_INITIALIZER(throttle_groups);
 
+/* Most requests in a group go through without waiting, and for those
+ * taking tg->lock is pure overhead. So whenever a request goes through
+ * the locked path and nothing is queued, the member gets a budget: part
+ * of the I/O that the group could still do without throttling. The
+ * budget is accounted in the ThrottleState right away, and later requests
+ * in the same direction consume it with a single atomic operation. All
+ * of them would have been let through by throttle_schedule_timer() too.
+ *
+ * Requests that don't fit in the budget take the lock, give back the
+ * unused part and go through the usual algorithm. Before a request is
+ * throttled, all budgets in the group are given back, so reserved but
+ * unused I/O never makes a request wait.
+ *
+ * The number of operations and of bytes are packed in a single 64-bit
+ * word so that both can be consumed at once.  Without 64-bit atomics
+ * every request takes the lock.
+ */
+#define TG_BUDGET_BYTES_BITS 40
+#define TG_BUDGET_BYTES_MAX  ((1ULL << TG_BUDGET_BYTES_BITS) - 1)
+#define TG_BUDGET_UNITS_MAX  ((1ULL << (64 - TG_BUDGET_BYTES_BITS)) - 1)
+
 
 /* This function reads throttle_groups and must be called under the global
  * mutex.
@@ -254,6 +276,144 @@ static ThrottleGroupMember *next_throttle_token(ThrottleGroupMember *tgm,
     return token;
 }
 
+#ifdef CONFIG_ATOMIC64
+/* Consume @bytes and one operation from the budget of a ThrottleGroupMember.
+ * This does not need tg->lock.
+ *
+ * @tgm:       the ThrottleGroupMember
+ * @bytes:     the number of bytes for this I/O
+ * @direction: the ThrottleDirection
+ * @ret:       whether the budget was large enough
+ */
+static bool throttle_group_take_budget(ThrottleGroupMember *tgm,
+                                       int64_t bytes,
+                                       ThrottleDirection direction)
+{
+    uint64_t old, cur;
+
+    if (bytes > TG_BUDGET_BYTES_MAX) {
+        return false;
+    }
+
+    old = qatomic_read(&tgm->budget[direction]);
+    for (;;) {
+        if (!(old >> TG_BUDGET_BYTES_BITS) ||
+            (old & TG_BUDGET_BYTES_MAX) < bytes) {
+            return false;
+        }
+        cur = qatomic_cmpxchg(&tgm->budget[direction], old,
+                              old - (1ULL << TG_BUDGET_BYTES_BITS) - bytes);
+        if (cur == old) {
+            return true;
+        }
+        old = cur;
+    }
+}
+
+/* Give back the unused budget of a ThrottleGroupMember.
+ *
+ * This assumes that tg->lock is held.
+ *
+ * @tgm:       the ThrottleGroupMember
+ * @direction: the ThrottleDirection
+ */
+static void throttle_group_release_budget(ThrottleGroupMember *tgm,
+                                          ThrottleDirection direction)
+{
+    ThrottleState *ts = tgm->throttle_state;
+    ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
+    uint64_t left;
+
+    if (!tgm->budget_granted[direction]) {
+        return;
+    }
+
+    left = qatomic_xchg(&tgm->budget[direction], 0);
+    throttle_release_budget(ts, direction, left & TG_BUDGET_BYTES_MAX,
+                            left >> TG_BUDGET_BYTES_BITS);
+    tgm->budget_granted[direction] = false;
+    tg->budgets_granted--;
+}
+
+/* Give a budget to a ThrottleGroupMember if no request in the group is
+ * waiting.
+ *
+ * This assumes that tg->lock is held.
+ *
+ * @tgm:       the ThrottleGroupMember
+ * @direction: the ThrottleDirection
+ */
+static void throttle_group_grant_budget(ThrottleGroupMember *tgm,
+                                        ThrottleDirection direction)
+{
+    ThrottleState *ts = tgm->throttle_state;
+    ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
+    uint64_t bytes, units;
+
+    /* With iops-size a request can count as more than one operation, and
+     * a budget in whole operations could not account for that exactly. */
+    if (tgm->budget_granted[direction] || ts->cfg.op_size ||
+        tg->any_timer_armed[direction] ||
+        tgm_has_pending_reqs(next_throttle_token(tgm, direction), direction)) {
+        return;
+    }
+
+    if (!throttle_compute_budget(ts, tg->clock_type, direction,
+                                 &bytes, &units)) {
+        return;
+    }
+
+    /* Leave the other half to the other members of the group */
+    bytes = MIN(bytes / 2, TG_BUDGET_BYTES_MAX);
+    units = MIN(units / 2, TG_BUDGET_UNITS_MAX);
+    if (!bytes || !units) {
+        return;
+    }
+
+    throttle_reserve_budget(ts, direction, bytes, units);
+    qatomic_set(&tgm->budget[direction],
+                (units << TG_BUDGET_BYTES_BITS) | bytes);
+    tgm->budget_granted[direction] = true;
+    tg->budgets_granted++;
+}
+#else
+static bool throttle_group_take_budget(ThrottleGroupMember *tgm,
+                                       int64_t bytes,
+                                       ThrottleDirection direction)
+{
+    return false;
+}
+
+static void throttle_group_release_budget(ThrottleGroupMember *tgm,
+                                          ThrottleDirection direction)
+{
+}
+
+static void throttle_group_grant_budget(ThrottleGroupMember *tgm,
+                                        ThrottleDirection direction)
+{
+}
+#endif
+
+/* Give back the budgets of all members of a ThrottleGroup.
+ *
+ * This assumes that tg->lock is held.
+ *
+ * @tg: the ThrottleGroup
+ */
+static void throttle_group_release_all_budgets(ThrottleGroup *tg)
+{
+    ThrottleGroupMember *tgm;
+    ThrottleDirection dir;
+
+    QLIST_FOREACH(tgm, &tg->head, round_robin) {
+        for (dir = THROTTLE_READ; dir < THROTTLE_MAX; dir++) {
+            throttle_group_release_budget(tgm, dir);
+        }
+    }
+    assert(!tg->budgets_granted);
+}
+
 /* Check if the next I/O request for a ThrottleGroupMember needs to be
  * throttled or not. If there's no timer set in this group, set one and update
  * the token accordingly.
@@ -281,6 +441,12 @@ static bool throttle_group_schedule_timer(ThrottleGroupMember *tgm,
         return true;
     }
 
+    /* Budgets count as used I/O, give them back before throttling */
+    if (tg->budgets_granted &&
+        !throttle_compute_budget(ts, tg->clock_type, direction, NULL, NULL)) {
+        throttle_group_release_all_budgets(tg);
+    }
+
     must_wait = throttle_schedule_timer(ts, tt, direction);
 
     /* If a timer just got armed, set tgm as the current token */
@@ -369,8 +535,16 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
     assert(bytes >= 0);
     assert(direction < THROTTLE_MAX);
 
+    /* Fast path: the request fits in the budget, no need to check. */
+    if (throttle_group_take_budget(tgm, bytes, direction)) {
+        return;
+    }
+
     qemu_mutex_lock(&tg->lock);
 
+    /* The budget was too small for this request, give back what is left */
+    throttle_group_release_budget(tgm, direction);
+
     /* First we check if this I/O has to be throttled. */
     token = next_throttle_token(tgm, direction);
     must_wait = throttle_group_schedule_timer(token, direction);
@@ -393,6 +567,9 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
     /* Schedule the next request */
     schedule_next_request(tgm, direction);
 
+    /* Let the following requests skip the lock if possible */
+    throttle_group_grant_budget(tgm, direction);
+
     qemu_mutex_unlock(&tg->lock);
 }
 
@@ -477,6 +654,7 @@ void throttle_group_config(ThrottleGroupMember *tgm, ThrottleConfig *cfg)
     ThrottleState *ts = tgm->throttle_state;
     ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
     qemu_mutex_lock(&tg->lock);
+    throttle_group_release_all_budgets(tg);
     throttle_config(ts, tg->clock_type, cfg);
     qemu_mutex_unlock(&tg->lock);
 
@@ -559,6 +737,8 @@ void throttle_group_register_tgm(ThrottleGroupMember *tgm,
             tg->tokens[dir] = tgm;
         }
         qemu_co_queue_init(&tgm->throttled_reqs[dir]);
+        tgm->budget[dir] = 0;
+        tgm->budget_granted[dir] = false;
     }
 
     QLIST_INSERT_HEAD(&tg->head, tgm, round_robin);
@@ -599,6 +779,7 @@ void throttle_group_unregister_tgm(ThrottleGroupMember *tgm)
 
     WITH_QEMU_LOCK_GUARD(&tg->lock) {
         for (dir = THROTTLE_READ; dir < THROTTLE_MAX; dir++) {
+            throttle_group_release_budget(tgm, dir);
             assert(tgm->pending_reqs[dir] == 0);
             assert(qemu_co_queue_empty(&tgm->throttled_reqs[dir]));
             assert(!timer_pending(tgm->throttle_timers.timers[dir]));
@@ -2017,8 +2017,10 @@ vmdk_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
 
                 /* qcow2 emits this on bs->file instead of bs->backing */
                 BLKDBG_CO_EVENT(bs->file, BLKDBG_READ_BACKING_AIO);
+                qemu_co_mutex_unlock(&s->lock);
                 ret = bdrv_co_preadv(bs->backing, offset, n_bytes,
                                      &local_qiov, 0);
+                qemu_co_mutex_lock(&s->lock);
                 if (ret < 0) {
                     goto fail;
                 }
@@ -2029,8 +2031,15 @@ vmdk_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
             qemu_iovec_reset(&local_qiov);
             qemu_iovec_concat(&local_qiov, qiov, bytes_done, n_bytes);
 
+            /*
+             * Allocated grains never move, and the L2 table cache is only
+             * updated once the data of a new grain has been written, so the
+             * lock is only needed for the lookup, not for the data read.
+             */
+            qemu_co_mutex_unlock(&s->lock);
             ret = vmdk_read_extent(extent, cluster_offset, offset_in_cluster,
                                    &local_qiov, n_bytes);
+            qemu_co_mutex_lock(&s->lock);
             if (ret) {
                 goto fail;
             }
@@ -36,6 +36,7 @@
 #include "hw/block/block.h"
 #include "block/blockjob.h"
 #include "block/dirty-bitmap.h"
+#include "block/qapi.h"
 #include "block/qdict.h"
 #include "block/throttle-groups.h"
 #include "monitor/monitor.h"
@@ -1934,6 +1935,7 @@ static void block_dirty_bitmap_add_action(BlockDirtyBitmapAdd *action,
                                action->has_granularity, action->granularity,
                                action->has_persistent, action->persistent,
                                action->has_disabled, action->disabled,
+                               action->has_compressed, action->compressed,
                                &local_err);
 
     if (!local_err) {
@@ -2729,6 +2731,9 @@ static BlockJob *do_backup_common(BackupCommon *backup,
         if (backup->x_perf->has_min_cluster_size) {
             perf.min_cluster_size = backup->x_perf->min_cluster_size;
         }
+        if (backup->x_perf->has_auto_tune) {
+            perf.auto_tune = backup->x_perf->auto_tune;
+        }
     }
 
     if ((backup->sync == MIRROR_SYNC_MODE_BITMAP) ||
@@ -2827,11 +2832,32 @@ void qmp_drive_backup(DriveBackup *backup, Error **errp)
 
 BlockDeviceInfoList *qmp_query_named_block_nodes(bool has_flat,
                                                  bool flat,
+                                                 const char *node_name,
                                                  Error **errp)
 {
     bool return_flat = has_flat && flat;
+    BlockDeviceInfoList *list = NULL;
+    BlockDeviceInfo *info;
+    BlockDriverState *bs;
+
+    if (!node_name) {
+        return bdrv_named_nodes_list(return_flat, errp);
+    }
 
-    return bdrv_named_nodes_list(return_flat, errp);
+    GRAPH_RDLOCK_GUARD_MAINLOOP();
+
+    bs = bdrv_find_node(node_name);
+    if (!bs) {
+        error_setg(errp, "Node '%s' not found", node_name);
+        return NULL;
+    }
+
+    info = bdrv_block_device_info(NULL, bs, return_flat, errp);
+    if (!info) {
+        return NULL;
+    }
+    QAPI_LIST_PREPEND(list, info);
+    return list;
 }
 
 XDbgBlockGraph *qmp_x_debug_query_block_graph(Error **errp)
@@ -3214,6 +3240,11 @@ void qmp_block_job_set_speed(const char *device, int64_t speed, Error **errp)
     block_job_set_speed_locked(job, speed, errp);
 }
 
+void qmp_block_job_set_total_speed(int64_t speed, Error **errp)
+{
+    block_job_set_total_speed(speed, errp);
+}
+
 void qmp_block_job_cancel(const char *device,
                           bool has_force, bool force, Error **errp)
 {
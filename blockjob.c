@@ -306,6 +306,42 @@ bool block_job_set_speed_locked(BlockJob *job, int64_t speed, Error **errp)
     return true;
 }
 
+/* Limit shared by all block jobs, see block-job-set-total-speed */
+static RateLimit total_limit;
+
+static void __attribute__((constructor)) block_job_total_limit_init(void)
+{
+    ratelimit_init(&total_limit);
+}
+
+RateLimit *block_job_total_ratelimit(void)
+{
+    return &total_limit;
+}
+
+bool block_job_set_total_speed(int64_t speed, Error **errp)
+{
+    BlockJob *job;
+
+    GLOBAL_STATE_CODE();
+
+    if (speed < 0) {
+        error_setg(errp, QERR_INVALID_PARAMETER_VALUE, "speed",
+                   "a non-negative value");
+        return false;
+    }
+
+    ratelimit_set_speed(&total_limit, speed, BLOCK_JOB_SLICE_TIME);
+
+    /* Let throttled jobs recompute their delay with the new limit */
+    JOB_LOCK_GUARD();
+    for (job = block_job_next_locked(NULL); job;
+         job = block_job_next_locked(job)) {
+        job_enter_cond_locked(&job->job, job_timer_pending);
+    }
+    return true;
+}
+
 static bool block_job_set_speed(BlockJob *job, int64_t speed, Error **errp)
 {
     JOB_LOCK_GUARD();
@@ -336,6 +372,7 @@ void block_job_ratelimit_processed_bytes(BlockJob *job, uint64_t n)
 {
     IO_CODE();
     ratelimit_calculate_delay(&job->limit, n);
+    ratelimit_calculate_delay(&total_limit, n);
 }
 
 void block_job_ratelimit_sleep(BlockJob *job)
@@ -351,7 +388,8 @@ void block_job_ratelimit_sleep(BlockJob *job)
      * sleep because the speed can change while the job has yielded.
      */
     do {
-        delay_ns = ratelimit_calculate_delay(&job->limit, 0);
+        delay_ns = MAX(ratelimit_calculate_delay(&job->limit, 0),
+                       ratelimit_calculate_delay(&total_limit, 0));
         job_sleep_ns(&job->job, delay_ns);
     } while (delay_ns && !job_is_cancelled(&job->job));
 }
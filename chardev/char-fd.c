@@ -23,6 +23,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/main-loop.h"
 #include "qemu/module.h"
 #include "qemu/sockets.h"
 #include "qapi/error.h"
@@ -33,6 +34,28 @@
 #include "chardev/char-fd.h"
 #include "chardev/char-io.h"
 
+/* Upper bound for output held back by a buffered chardev */
+#define FD_CHR_OUT_BUF_MAX (64 * 1024)
+
+/* Called with chr_write_lock held.  */
+static void fd_chr_flush_out_buf(FDChardev *s)
+{
+    if (s->out_buf->len) {
+        /* Like unbuffered writes, errors drop the data */
+        io_channel_send(s->ioc_out, s->out_buf->data, s->out_buf->len);
+        g_byte_array_set_size(s->out_buf, 0);
+    }
+}
+
+static void fd_chr_flush_bh(void *opaque)
+{
+    Chardev *chr = opaque;
+
+    qemu_mutex_lock(&chr->chr_write_lock);
+    fd_chr_flush_out_buf(FD_CHARDEV(chr));
+    qemu_mutex_unlock(&chr->chr_write_lock);
+}
+
 /* Called with chr_write_lock held.  */
 static int fd_chr_write(Chardev *chr, const uint8_t *buf, int len)
 {
@@ -42,6 +65,17 @@ static int fd_chr_write(Chardev *chr, const uint8_t *buf, int len)
         return -1;
     }
 
+    if (s->out_buf) {
+        if (s->out_buf->len + len > FD_CHR_OUT_BUF_MAX) {
+            fd_chr_flush_out_buf(s);
+        }
+        if (len <= FD_CHR_OUT_BUF_MAX) {
+            g_byte_array_append(s->out_buf, buf, len);
+            qemu_bh_schedule(s->flush_bh);
+            return len;
+        }
+    }
+
     return io_channel_send(s->ioc_out, buf, len);
 }
 
@@ -187,6 +221,13 @@ static void char_fd_finalize(Object *obj)
     if (s->ioc_in) {
         object_unref(OBJECT(s->ioc_in));
     }
+    if (s->out_buf) {
+        qemu_bh_delete(s->flush_bh);
+        s->flush_bh = NULL;
+        fd_chr_flush_out_buf(s);
+        g_byte_array_free(s->out_buf, true);
+        s->out_buf = NULL;
+    }
     if (s->ioc_out) {
         object_unref(OBJECT(s->ioc_out));
     }
@@ -194,6 +235,20 @@ static void char_fd_finalize(Object *obj)
     qemu_chr_be_event(chr, CHR_EVENT_CLOSED);
 }
 
+/*
+ * Hold back output and write it from a bottom half in the main loop, so
+ * that frontends writing one byte at a time from a vCPU thread do not
+ * pay for a system call per byte.
+ */
+void qemu_chr_fd_set_buffered(Chardev *chr)
+{
+    FDChardev *s = FD_CHARDEV(chr);
+
+    assert(!s->out_buf);
+    s->out_buf = g_byte_array_new();
+    s->flush_bh = qemu_bh_new(fd_chr_flush_bh, chr);
+}
+
 int qmp_chardev_open_file_source(char *src, int flags, Error **errp)
 {
     int fd = -1;
@@ -49,6 +49,10 @@ static void qmp_chardev_open_file(Chardev *chr,
         error_setg(errp, "input file not supported");
         return;
     }
+    if (file->has_buffered && file->buffered) {
+        error_setg(errp, "buffered output not supported");
+        return;
+    }
 
     if (file->has_append && file->append) {
         /* Append to file if it already exists. */
@@ -93,6 +97,9 @@ static void qmp_chardev_open_file(Chardev *chr,
     }
 
     qemu_chr_open_fd(chr, in, out);
+    if (file->has_buffered && file->buffered) {
+        qemu_chr_fd_set_buffered(chr);
+    }
 #endif
 }
 
@@ -121,6 +128,8 @@ static void qemu_chr_parse_file_out(QemuOpts *opts, ChardevBackend *backend,
 
     file->has_append = true;
     file->append = qemu_opt_get_bool(opts, "append", false);
+    file->has_buffered = true;
+    file->buffered = qemu_opt_get_bool(opts, "buffered", false);
 }
 
 static void char_file_class_init(ObjectClass *oc, const void *data)
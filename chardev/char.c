@@ -965,6 +965,9 @@ QemuOptsList qemu_chardev_opts = {
         {
             .name = "append",
             .type = QEMU_OPT_BOOL,
+        },{
+            .name = "buffered",
+            .type = QEMU_OPT_BOOL,
         },{
             .name = "logfile",
             .type = QEMU_OPT_STRING,
@@ -113,6 +113,33 @@ static uint64_t l1_dmisses;
 static uint64_t l2_mem_accesses;
 static uint64_t l2_misses;
 
+/*
+ * Sampling: only one interval of sample_interval instructions out of
+ * every sample_period is simulated.  Outside of those intervals the
+ * callbacks are skipped by an inline condition on "skip".
+ */
+typedef struct {
+    uint64_t insns;
+    uint64_t intervals;
+    uint64_t skip;
+} VcpuSample;
+
+static struct qemu_plugin_scoreboard *vcpu_samples;
+static int sample_period = 1;
+static int sample_interval = 10000;
+
+static qemu_plugin_u64 sample_insns_u64(void)
+{
+    return qemu_plugin_scoreboard_u64_in_struct(vcpu_samples, VcpuSample,
+                                                insns);
+}
+
+static qemu_plugin_u64 sample_skip_u64(void)
+{
+    return qemu_plugin_scoreboard_u64_in_struct(vcpu_samples, VcpuSample,
+                                                skip);
+}
+
 static int pow_of_two(int num)
 {
     g_assert((num & (num - 1)) == 0);
@@ -462,6 +489,15 @@ static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
     g_mutex_unlock(&l2_ucache_locks[cache_idx]);
 }
 
+static void vcpu_interval_exec(unsigned int vcpu_index, void *udata)
+{
+    VcpuSample *sample = qemu_plugin_scoreboard_find(vcpu_samples, vcpu_index);
+
+    sample->insns = 0;
+    sample->intervals++;
+    sample->skip = sample->intervals % sample_period != 0;
+}
+
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     size_t n_insns;
@@ -490,6 +526,20 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
         }
         g_mutex_unlock(&hashtable_lock);
 
+        if (sample_period > 1) {
+            qemu_plugin_register_vcpu_mem_cond_cb(insn, vcpu_mem_access,
+                                                  QEMU_PLUGIN_CB_NO_REGS, rw,
+                                                  QEMU_PLUGIN_COND_EQ,
+                                                  sample_skip_u64(), 0,
+                                                  data);
+            qemu_plugin_register_vcpu_insn_exec_cond_cb(insn, vcpu_insn_exec,
+                                                        QEMU_PLUGIN_CB_NO_REGS,
+                                                        QEMU_PLUGIN_COND_EQ,
+                                                        sample_skip_u64(),
+                                                        0, data);
+            continue;
+        }
+
         qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem_access,
                                          QEMU_PLUGIN_CB_NO_REGS,
                                          rw, data);
@@ -497,6 +547,14 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
         qemu_plugin_register_vcpu_insn_exec_cb(insn, vcpu_insn_exec,
                                                QEMU_PLUGIN_CB_NO_REGS, data);
     }
+
+    if (sample_period > 1) {
+        qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+            tb, QEMU_PLUGIN_INLINE_ADD_U64, sample_insns_u64(), n_insns);
+        qemu_plugin_register_vcpu_tb_exec_cond_cb(
+            tb, vcpu_interval_exec, QEMU_PLUGIN_CB_NO_REGS,
+            QEMU_PLUGIN_COND_GE, sample_insns_u64(), sample_interval, NULL);
+    }
 }
 
 static void insn_free(gpointer data)
@@ -711,6 +769,9 @@ static void plugin_exit(qemu_plugin_id_t id, void *p)
     }
 
     g_hash_table_destroy(miss_ht);
+    if (vcpu_samples) {
+        qemu_plugin_scoreboard_free(vcpu_samples);
+    }
 }
 
 static void policy_init(void)
@@ -797,6 +858,18 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
                 fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
                 return -1;
             }
+        } else if (g_strcmp0(tokens[0], "sample") == 0) {
+            sample_period = STRTOLL(tokens[1]);
+            if (sample_period < 1) {
+                fprintf(stderr, "invalid sample period: %s\n", opt);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "interval") == 0) {
+            sample_interval = STRTOLL(tokens[1]);
+            if (sample_interval < 1) {
+                fprintf(stderr, "invalid sample interval: %s\n", opt);
+                return -1;
+            }
         } else if (g_strcmp0(tokens[0], "evict") == 0) {
             if (g_strcmp0(tokens[1], "rand") == 0) {
                 policy = RAND;
@@ -844,6 +917,10 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
     l1_icache_locks = g_new0(GMutex, cores);
     l2_ucache_locks = use_l2 ? g_new0(GMutex, cores) : NULL;
 
+    if (sample_period > 1) {
+        vcpu_samples = qemu_plugin_scoreboard_new(sizeof(VcpuSample));
+    }
+
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
 
@@ -18,6 +18,7 @@
 QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
 
 static bool do_inline;
+static bool do_folded;
 
 /* Plugins need to take care of their own locking */
 static GMutex lock;
@@ -37,6 +38,7 @@ typedef struct {
     struct qemu_plugin_scoreboard *exec_count;
     int trans_count;
     unsigned long insns;
+    const char *symbol;
 } ExecCount;
 
 static gint cmp_exec_count(gconstpointer a, gconstpointer b, gpointer d)
@@ -70,12 +72,73 @@ static void exec_count_free(gpointer key, gpointer value, gpointer user_data)
     qemu_plugin_scoreboard_free(cnt->exec_count);
 }
 
+static uint64_t exec_count_sum(ExecCount *cnt)
+{
+    return qemu_plugin_u64_sum(qemu_plugin_scoreboard_u64(cnt->exec_count));
+}
+
+static gint cmp_symbol_count(gconstpointer a, gconstpointer b, gpointer d)
+{
+    GHashTable *symbols = d;
+    uint64_t count_a = *(uint64_t *)g_hash_table_lookup(symbols, a);
+    uint64_t count_b = *(uint64_t *)g_hash_table_lookup(symbols, b);
+    return count_a > count_b ? -1 : 1;
+}
+
+/*
+ * Sum the executed instructions of all blocks by the symbol of their
+ * first instruction, and print them in the "folded" format understood
+ * by flamegraph.pl (one frame per line, as there is no call stack).
+ */
+static void report_folded(GString *report)
+{
+    g_autoptr(GHashTable) symbols =
+        g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    GHashTableIter iter;
+    GList *names, *it;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, hotblocks);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        ExecCount *rec = value;
+        const char *name = rec->symbol ? rec->symbol : "[unknown]";
+        uint64_t *sum = g_hash_table_lookup(symbols, name);
+
+        if (!sum) {
+            sum = g_new0(uint64_t, 1);
+            g_hash_table_insert(symbols, (gpointer)name, sum);
+        }
+        *sum += exec_count_sum(rec) * rec->insns;
+    }
+
+    names = g_list_sort_with_data(g_hash_table_get_keys(symbols),
+                                  cmp_symbol_count, symbols);
+    for (it = names; it; it = it->next) {
+        uint64_t *sum = g_hash_table_lookup(symbols, it->data);
+
+        if (*sum) {
+            g_string_append_printf(report, "%s %"PRIu64"\n",
+                                   (const char *)it->data, *sum);
+        }
+    }
+    g_list_free(names);
+}
+
 static void plugin_exit(qemu_plugin_id_t id, void *p)
 {
     g_autoptr(GString) report = g_string_new("collected ");
     GList *counts, *it;
     int i;
 
+    if (do_folded) {
+        g_string_truncate(report, 0);
+        report_folded(report);
+        qemu_plugin_outs(report->str);
+        g_hash_table_foreach(hotblocks, exec_count_free, NULL);
+        g_hash_table_destroy(hotblocks);
+        return;
+    }
+
     g_string_append_printf(report, "%d entries in the hash table\n",
                            g_hash_table_size(hotblocks));
     counts = g_hash_table_get_values(hotblocks);
@@ -141,6 +204,7 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
         cnt->start_addr = pc;
         cnt->trans_count = 1;
         cnt->insns = insns;
+        cnt->symbol = qemu_plugin_insn_symbol(qemu_plugin_tb_get_insn(tb, 0));
         cnt->exec_count = qemu_plugin_scoreboard_new(sizeof(uint64_t));
         g_hash_table_insert(hotblocks, cnt, cnt);
     }
@@ -170,6 +234,11 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
                 fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
                 return -1;
             }
+        } else if (g_strcmp0(tokens[0], "folded") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &do_folded)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
         } else {
             fprintf(stderr, "option parsing failed: %s\n", opt);
             return -1;
@@ -1440,6 +1440,60 @@ int AES_set_decrypt_key(const unsigned char *userKey, const int bits,
 }
 
 #ifndef AES_ASM
+/*
+ * Host accelerated single block operations.  The round keys in AES_KEY
+ * are stored as host words loaded big-endian from the key bytes, and the
+ * decryption schedule is already in the form of the equivalent inverse
+ * cipher, which is what the host aesdec style instructions expect.
+ */
+static inline void aes_accel_load_rk(AESState *ret, const u32 *rk)
+{
+    ret->w[0] = cpu_to_be32(rk[0]);
+    ret->w[1] = cpu_to_be32(rk[1]);
+    ret->w[2] = cpu_to_be32(rk[2]);
+    ret->w[3] = cpu_to_be32(rk[3]);
+}
+
+static inline void ATTR_AES_ACCEL
+aes_encrypt_accel(const unsigned char *in, unsigned char *out,
+                  const AES_KEY *key)
+{
+    const u32 *rk = key->rd_key;
+    AESState st, k;
+    int r;
+
+    memcpy(&st, in, AES_BLOCK_SIZE);
+    aes_accel_load_rk(&k, rk);
+    st.v ^= k.v;
+    for (r = 1; r < key->rounds; r++) {
+        aes_accel_load_rk(&k, rk + 4 * r);
+        aesenc_SB_SR_MC_AK_accel(&st, &st, &k, false);
+    }
+    aes_accel_load_rk(&k, rk + 4 * r);
+    aesenc_SB_SR_AK_accel(&st, &st, &k, false);
+    memcpy(out, &st, AES_BLOCK_SIZE);
+}
+
+static inline void ATTR_AES_ACCEL
+aes_decrypt_accel(const unsigned char *in, unsigned char *out,
+                  const AES_KEY *key)
+{
+    const u32 *rk = key->rd_key;
+    AESState st, k;
+    int r;
+
+    memcpy(&st, in, AES_BLOCK_SIZE);
+    aes_accel_load_rk(&k, rk);
+    st.v ^= k.v;
+    for (r = 1; r < key->rounds; r++) {
+        aes_accel_load_rk(&k, rk + 4 * r);
+        aesdec_ISB_ISR_IMC_AK_accel(&st, &st, &k, false);
+    }
+    aes_accel_load_rk(&k, rk + 4 * r);
+    aesdec_ISB_ISR_AK_accel(&st, &st, &k, false);
+    memcpy(out, &st, AES_BLOCK_SIZE);
+}
+
 /*
  * Encrypt a single block
  * in and out can overlap
@@ -1456,6 +1510,11 @@ void AES_encrypt(const unsigned char *in, unsigned char *out,
         assert(in && out && key);
         rk = key->rd_key;
 
+        if (HAVE_AES_ACCEL) {
+                aes_encrypt_accel(in, out, key);
+                return;
+        }
+
         /*
          * map byte array block to cipher state
          * and add initial round key:
@@ -1647,6 +1706,11 @@ void AES_decrypt(const unsigned char *in, unsigned char *out,
         assert(in && out && key);
         rk = key->rd_key;
 
+        if (HAVE_AES_ACCEL) {
+                aes_decrypt_accel(in, out, key);
+                return;
+        }
+
         /*
          * map byte array block to cipher state
          * and add initial round key:
@@ -365,9 +365,17 @@ void qcrypto_block_free(QCryptoBlock *block)
 }
 
 
+/*
+ * Number of sectors whose IVs are generated with one acquisition of the
+ * ivgen mutex and then handed to the cipher in a single call.
+ */
+#define QCRYPTO_BLOCK_SECTOR_BATCH 64
+
 typedef int (*QCryptoCipherEncDecFunc)(QCryptoCipher *cipher,
-                                        const void *in,
-                                        void *out,
+                                        const uint8_t *ivs,
+                                        size_t niv,
+                                        size_t sectorsize,
+                                        void *buf,
                                         size_t len,
                                         Error **errp);
 
@@ -382,41 +390,48 @@ static int do_qcrypto_block_cipher_encdec(QCryptoCipher *cipher,
                                           QCryptoCipherEncDecFunc func,
                                           Error **errp)
 {
-    g_autofree uint8_t *iv = niv ? g_new0(uint8_t, niv) : NULL;
+    g_autofree uint8_t *ivs = NULL;
     int ret = -1;
     uint64_t startsector = offset / sectorsize;
 
     assert(QEMU_IS_ALIGNED(offset, sectorsize));
     assert(QEMU_IS_ALIGNED(len, sectorsize));
 
+    if (!niv) {
+        return func(cipher, NULL, 0, sectorsize, buf, len, errp);
+    }
+
+    ivs = g_new0(uint8_t, niv * MIN(len / sectorsize,
+                                    QCRYPTO_BLOCK_SECTOR_BATCH));
+
     while (len > 0) {
-        size_t nbytes;
-        if (niv) {
-            if (ivgen_mutex) {
-                qemu_mutex_lock(ivgen_mutex);
-            }
-            ret = qcrypto_ivgen_calculate(ivgen, startsector, iv, niv, errp);
-            if (ivgen_mutex) {
-                qemu_mutex_unlock(ivgen_mutex);
-            }
+        size_t nsectors = MIN(len / sectorsize, QCRYPTO_BLOCK_SECTOR_BATCH);
+        size_t nbytes = nsectors * sectorsize;
+        size_t i;
 
+        if (ivgen_mutex) {
+            qemu_mutex_lock(ivgen_mutex);
+        }
+        for (i = 0; i < nsectors; i++) {
+            ret = qcrypto_ivgen_calculate(ivgen, startsector + i,
+                                          ivs + i * niv, niv, errp);
             if (ret < 0) {
-                return -1;
+                break;
             }
+        }
+        if (ivgen_mutex) {
+            qemu_mutex_unlock(ivgen_mutex);
+        }
 
-            if (qcrypto_cipher_setiv(cipher,
-                                     iv, niv,
-                                     errp) < 0) {
-                return -1;
-            }
+        if (ret < 0) {
+            return -1;
         }
 
-        nbytes = len > sectorsize ? sectorsize : len;
-        if (func(cipher, buf, buf, nbytes, errp) < 0) {
+        if (func(cipher, ivs, niv, sectorsize, buf, nbytes, errp) < 0) {
             return -1;
         }
 
-        startsector++;
+        startsector += nsectors;
         buf += nbytes;
         len -= nbytes;
     }
@@ -436,7 +451,8 @@ int qcrypto_block_cipher_decrypt_helper(QCryptoCipher *cipher,
 {
     return do_qcrypto_block_cipher_encdec(cipher, niv, ivgen, NULL, sectorsize,
                                           offset, buf, len,
-                                          qcrypto_cipher_decrypt, errp);
+                                          qcrypto_cipher_decrypt_sectors,
+                                          errp);
 }
 
 
@@ -451,7 +467,8 @@ int qcrypto_block_cipher_encrypt_helper(QCryptoCipher *cipher,
 {
     return do_qcrypto_block_cipher_encdec(cipher, niv, ivgen, NULL, sectorsize,
                                           offset, buf, len,
-                                          qcrypto_cipher_encrypt, errp);
+                                          qcrypto_cipher_encrypt_sectors,
+                                          errp);
 }
 
 int qcrypto_block_decrypt_helper(QCryptoBlock *block,
@@ -469,7 +486,8 @@ int qcrypto_block_decrypt_helper(QCryptoBlock *block,
 
     ret = do_qcrypto_block_cipher_encdec(cipher, block->niv, block->ivgen,
                                          &block->mutex, sectorsize, offset, buf,
-                                         len, qcrypto_cipher_decrypt, errp);
+                                         len, qcrypto_cipher_decrypt_sectors,
+                                         errp);
 
     qcrypto_block_push_cipher(block, cipher);
 
@@ -491,7 +509,8 @@ int qcrypto_block_encrypt_helper(QCryptoBlock *block,
 
     ret = do_qcrypto_block_cipher_encdec(cipher, block->niv, block->ivgen,
                                          &block->mutex, sectorsize, offset, buf,
-                                         len, qcrypto_cipher_encrypt, errp);
+                                         len, qcrypto_cipher_encrypt_sectors,
+                                         errp);
 
     qcrypto_block_push_cipher(block, cipher);
 
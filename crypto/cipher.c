@@ -204,6 +204,78 @@ int qcrypto_cipher_setiv(QCryptoCipher *cipher,
 }
 
 
+typedef int (*QCryptoCipherFunc)(QCryptoCipher *cipher,
+                                 const void *in,
+                                 void *out,
+                                 size_t len,
+                                 Error **errp);
+
+static int qcrypto_cipher_do_sectors(QCryptoCipher *cipher,
+                                     QCryptoCipherFunc func,
+                                     const uint8_t *ivs, size_t niv,
+                                     size_t sectorsize,
+                                     uint8_t *buf, size_t len,
+                                     Error **errp)
+{
+    if (!niv) {
+        return func(cipher, buf, buf, len, errp);
+    }
+
+    while (len > 0) {
+        if (qcrypto_cipher_setiv(cipher, ivs, niv, errp) < 0) {
+            return -1;
+        }
+        if (func(cipher, buf, buf, sectorsize, errp) < 0) {
+            return -1;
+        }
+
+        ivs += niv;
+        buf += sectorsize;
+        len -= sectorsize;
+    }
+
+    return 0;
+}
+
+
+int qcrypto_cipher_encrypt_sectors(QCryptoCipher *cipher,
+                                   const uint8_t *ivs, size_t niv,
+                                   size_t sectorsize,
+                                   void *buf, size_t len,
+                                   Error **errp)
+{
+    const QCryptoCipherDriver *drv = cipher->driver;
+
+    assert(sectorsize > 0 && len % sectorsize == 0);
+
+    if (niv && drv->cipher_encrypt_sectors) {
+        return drv->cipher_encrypt_sectors(cipher, ivs, niv, sectorsize,
+                                           buf, len, errp);
+    }
+    return qcrypto_cipher_do_sectors(cipher, drv->cipher_encrypt, ivs, niv,
+                                     sectorsize, buf, len, errp);
+}
+
+
+int qcrypto_cipher_decrypt_sectors(QCryptoCipher *cipher,
+                                   const uint8_t *ivs, size_t niv,
+                                   size_t sectorsize,
+                                   void *buf, size_t len,
+                                   Error **errp)
+{
+    const QCryptoCipherDriver *drv = cipher->driver;
+
+    assert(sectorsize > 0 && len % sectorsize == 0);
+
+    if (niv && drv->cipher_decrypt_sectors) {
+        return drv->cipher_decrypt_sectors(cipher, ivs, niv, sectorsize,
+                                           buf, len, errp);
+    }
+    return qcrypto_cipher_do_sectors(cipher, drv->cipher_decrypt, ivs, niv,
+                                     sectorsize, buf, len, errp);
+}
+
+
 void qcrypto_cipher_free(QCryptoCipher *cipher)
 {
     if (cipher) {
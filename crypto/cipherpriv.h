@@ -35,6 +35,23 @@ struct QCryptoCipherDriver {
                         Error **errp);
 
     void (*cipher_free)(QCryptoCipher *cipher);
+
+    /*
+     * Optional, process consecutive sectors with one IV for each sector.
+     * If missing, cipher_setiv and cipher_encrypt/cipher_decrypt are
+     * called for every sector.
+     */
+    int (*cipher_encrypt_sectors)(QCryptoCipher *cipher,
+                                  const uint8_t *ivs, size_t niv,
+                                  size_t sectorsize,
+                                  void *buf, size_t len,
+                                  Error **errp);
+
+    int (*cipher_decrypt_sectors)(QCryptoCipher *cipher,
+                                  const uint8_t *ivs, size_t niv,
+                                  size_t sectorsize,
+                                  void *buf, size_t len,
+                                  Error **errp);
 };
 
 #ifdef CONFIG_AF_ALG
@@ -39,6 +39,9 @@
 #ifdef CONFIG_SNAPPY
 #include <snappy-c.h>
 #endif
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
 #ifndef ELF_MACHINE_UNAME
 #define ELF_MACHINE_UNAME "Unknown"
 #endif
@@ -1003,6 +1006,11 @@ static void create_header32(DumpState *s, Error **errp)
     if (s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) {
         status |= DUMP_DH_COMPRESSED_SNAPPY;
     }
+#endif
+#ifdef CONFIG_ZSTD
+    if (s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) {
+        status |= DUMP_DH_COMPRESSED_ZSTD;
+    }
 #endif
     dh->status = cpu_to_dump32(s, status);
 
@@ -1114,6 +1122,11 @@ static void create_header64(DumpState *s, Error **errp)
     if (s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) {
         status |= DUMP_DH_COMPRESSED_SNAPPY;
     }
+#endif
+#ifdef CONFIG_ZSTD
+    if (s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) {
+        status |= DUMP_DH_COMPRESSED_ZSTD;
+    }
 #endif
     dh->status = cpu_to_dump32(s, status);
 
@@ -1466,25 +1479,183 @@ static size_t get_len_buf_out(size_t page_size, uint32_t flag_compress)
     case DUMP_DH_COMPRESSED_SNAPPY:
         return snappy_max_compressed_length(page_size);
 #endif
+
+#ifdef CONFIG_ZSTD
+    case DUMP_DH_COMPRESSED_ZSTD:
+        return ZSTD_compressBound(page_size);
+#endif
     }
     return 0;
 }
 
+/*
+ * Pages are compressed in rounds of up to DUMP_COMPRESS_BATCH pages per
+ * worker.  The dump thread acts as the first worker, and writes out the
+ * results of each round in pfn order once all workers are done with it.
+ */
+#define DUMP_COMPRESS_MAX_WORKERS   8
+#define DUMP_COMPRESS_BATCH         256
+
+typedef struct DumpPage {
+    uint8_t *buf;               /* page content, guest RAM or @copy */
+    uint8_t *copy;              /* for pages that are not contiguous */
+    uint8_t *out;               /* compressed content */
+    size_t size_out;
+    uint32_t flags;             /* DUMP_DH_COMPRESSED_*, 0 if plaintext */
+    bool zero;
+} DumpPage;
+
+typedef struct DumpCompressWorker {
+    DumpState *s;
+    QemuThread thread;
+    QemuSemaphore sem;
+    QemuSemaphore *done;
+    bool quit;
+    DumpPage *pages;
+    size_t nr_pages;
+    size_t len_buf_out;
+#ifdef CONFIG_LZO
+    lzo_bytep wrkmem;
+#endif
+#ifdef CONFIG_ZSTD
+    ZSTD_CCtx *zstd;
+#endif
+} DumpCompressWorker;
+
+#ifdef CONFIG_ZSTD
+static bool dump_compress_zstd(DumpCompressWorker *w, DumpPage *p,
+                               size_t page_size)
+{
+    size_t ret;
+
+    if (!w->zstd) {
+        return false;
+    }
+    ret = ZSTD_compressCCtx(w->zstd, p->out, w->len_buf_out,
+                            p->buf, page_size, 1);
+    if (ZSTD_isError(ret)) {
+        return false;
+    }
+    p->size_out = ret;
+    return true;
+}
+#endif
+
+/*
+ * Compress one page.  Only one compression format will be used here, as
+ * s->flag_compress is set.  But when compression fails to work, or does
+ * not save anything, we fall back to save in plaintext.
+ */
+static void dump_compress_page(DumpCompressWorker *w, DumpPage *p)
+{
+    DumpState *s = w->s;
+    size_t page_size = s->dump_info.page_size;
+
+    p->zero = buffer_is_zero(p->buf, page_size);
+    if (p->zero) {
+        return;
+    }
+
+    p->size_out = w->len_buf_out;
+    if ((s->flag_compress & DUMP_DH_COMPRESSED_ZLIB) &&
+        (compress2(p->out, (uLongf *)&p->size_out, p->buf,
+                   page_size, Z_BEST_SPEED) == Z_OK) &&
+        (p->size_out < page_size)) {
+        p->flags = DUMP_DH_COMPRESSED_ZLIB;
+#ifdef CONFIG_LZO
+    } else if ((s->flag_compress & DUMP_DH_COMPRESSED_LZO) &&
+               (lzo1x_1_compress(p->buf, page_size, p->out,
+                                 (lzo_uint *)&p->size_out,
+                                 w->wrkmem) == LZO_E_OK) &&
+               (p->size_out < page_size)) {
+        p->flags = DUMP_DH_COMPRESSED_LZO;
+#endif
+#ifdef CONFIG_SNAPPY
+    } else if ((s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) &&
+               (snappy_compress((char *)p->buf, page_size,
+                                (char *)p->out, &p->size_out) == SNAPPY_OK) &&
+               (p->size_out < page_size)) {
+        p->flags = DUMP_DH_COMPRESSED_SNAPPY;
+#endif
+#ifdef CONFIG_ZSTD
+    } else if ((s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) &&
+               dump_compress_zstd(w, p, page_size) &&
+               (p->size_out < page_size)) {
+        p->flags = DUMP_DH_COMPRESSED_ZSTD;
+#endif
+    } else {
+        /*
+         * fall back to save in plaintext, size_out should be
+         * assigned the target's page size
+         */
+        p->flags = 0;
+        p->size_out = page_size;
+    }
+}
+
+static void dump_compress_pages(DumpCompressWorker *w)
+{
+    for (size_t i = 0; i < w->nr_pages; i++) {
+        dump_compress_page(w, &w->pages[i]);
+    }
+}
+
+static void *dump_compress_thread(void *opaque)
+{
+    DumpCompressWorker *w = opaque;
+
+    while (true) {
+        qemu_sem_wait(&w->sem);
+        if (w->quit) {
+            break;
+        }
+        dump_compress_pages(w);
+        qemu_sem_post(w->done);
+    }
+    return NULL;
+}
+
+static void dump_compress_worker_init(DumpCompressWorker *w, DumpState *s,
+                                      size_t len_buf_out, QemuSemaphore *done)
+{
+    w->s = s;
+    w->done = done;
+    w->len_buf_out = len_buf_out;
+#ifdef CONFIG_LZO
+    w->wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+#endif
+#ifdef CONFIG_ZSTD
+    if (s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) {
+        w->zstd = ZSTD_createCCtx();
+    }
+#endif
+}
+
+static void dump_compress_worker_cleanup(DumpCompressWorker *w)
+{
+#ifdef CONFIG_LZO
+    g_free(w->wrkmem);
+#endif
+#ifdef CONFIG_ZSTD
+    ZSTD_freeCCtx(w->zstd);
+#endif
+}
+
 static void write_dump_pages(DumpState *s, Error **errp)
 {
     int ret = 0;
     DataCache page_desc, page_data;
-    size_t len_buf_out, size_out;
-#ifdef CONFIG_LZO
-    lzo_bytep wrkmem = NULL;
-#endif
-    uint8_t *buf_out = NULL;
+    size_t len_buf_out;
     off_t offset_desc, offset_data;
     PageDescriptor pd, pd_zero;
     uint8_t *buf;
     GuestPhysBlock *block_iter = NULL;
     uint64_t pfn_iter;
-    g_autofree uint8_t *page = NULL;
+    g_autofree DumpCompressWorker *workers = NULL;
+    g_autofree DumpPage *pages = NULL;
+    QemuSemaphore done;
+    size_t nr_workers, nr_slots, nr_pages, i;
+    bool more = true;
 
     /* get offset of page_desc and page_data in dump file */
     offset_desc = s->offset_page;
@@ -1497,11 +1668,25 @@ static void write_dump_pages(DumpState *s, Error **errp)
     len_buf_out = get_len_buf_out(s->dump_info.page_size, s->flag_compress);
     assert(len_buf_out != 0);
 
-#ifdef CONFIG_LZO
-    wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
-#endif
-
-    buf_out = g_malloc(len_buf_out);
+    nr_workers = MIN(g_get_num_processors(), DUMP_COMPRESS_MAX_WORKERS);
+    nr_slots = nr_workers * DUMP_COMPRESS_BATCH;
+    pages = g_new0(DumpPage, nr_slots);
+    for (i = 0; i < nr_slots; i++) {
+        pages[i].copy = g_malloc(s->dump_info.page_size);
+        pages[i].out = g_malloc(len_buf_out);
+    }
+
+    qemu_sem_init(&done, 0);
+    workers = g_new0(DumpCompressWorker, nr_workers);
+    for (i = 0; i < nr_workers; i++) {
+        dump_compress_worker_init(&workers[i], s, len_buf_out, &done);
+        if (i) {
+            qemu_sem_init(&workers[i].sem, 0);
+            qemu_thread_create(&workers[i].thread, "dump_compress",
+                               dump_compress_thread, &workers[i],
+                               QEMU_THREAD_JOINABLE);
+        }
+    }
 
     /*
      * init zero page's page_desc and page_data, because every zero page
@@ -1520,103 +1705,75 @@ static void write_dump_pages(DumpState *s, Error **errp)
     }
 
     offset_data += s->dump_info.page_size;
-    page = g_malloc(s->dump_info.page_size);
 
     /*
      * dump memory to vmcore page by page. zero page will all be resided in the
      * first page of page section
      */
-    for (buf = page; get_next_page(&block_iter, &pfn_iter, &buf, s); buf = page) {
-        /* check zero page */
-        if (buffer_is_zero(buf, s->dump_info.page_size)) {
-            ret = write_cache(&page_desc, &pd_zero, sizeof(PageDescriptor),
-                              false);
-            if (ret < 0) {
-                error_setg(errp, "dump: failed to write page desc");
-                goto out;
+    while (more) {
+        for (nr_pages = 0; nr_pages < nr_slots; nr_pages++) {
+            DumpPage *p = &pages[nr_pages];
+
+            p->buf = p->copy;
+            if (!get_next_page(&block_iter, &pfn_iter, &p->buf, s)) {
+                more = false;
+                break;
             }
-        } else {
-            /*
-             * not zero page, then:
-             * 1. compress the page
-             * 2. write the compressed page into the cache of page_data
-             * 3. get page desc of the compressed page and write it into the
-             *    cache of page_desc
-             *
-             * only one compression format will be used here, for
-             * s->flag_compress is set. But when compression fails to work,
-             * we fall back to save in plaintext.
-             */
-             size_out = len_buf_out;
-             if ((s->flag_compress & DUMP_DH_COMPRESSED_ZLIB) &&
-                    (compress2(buf_out, (uLongf *)&size_out, buf,
-                               s->dump_info.page_size, Z_BEST_SPEED) == Z_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_ZLIB);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#ifdef CONFIG_LZO
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_LZO) &&
-                    (lzo1x_1_compress(buf, s->dump_info.page_size, buf_out,
-                    (lzo_uint *)&size_out, wrkmem) == LZO_E_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_LZO);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#endif
-#ifdef CONFIG_SNAPPY
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) &&
-                    (snappy_compress((char *)buf, s->dump_info.page_size,
-                    (char *)buf_out, &size_out) == SNAPPY_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_SNAPPY);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#endif
-            } else {
-                /*
-                 * fall back to save in plaintext, size_out should be
-                 * assigned the target's page size
-                 */
-                pd.flags = cpu_to_dump32(s, 0);
-                size_out = s->dump_info.page_size;
-                pd.size = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf,
-                                  s->dump_info.page_size, false);
+        }
+        if (!nr_pages) {
+            break;
+        }
+
+        /* split the round evenly, the dump thread takes the first share */
+        for (i = 0; i < nr_workers; i++) {
+            size_t start = nr_pages * i / nr_workers;
+
+            workers[i].pages = &pages[start];
+            workers[i].nr_pages = nr_pages * (i + 1) / nr_workers - start;
+            if (i) {
+                qemu_sem_post(&workers[i].sem);
+            }
+        }
+        dump_compress_pages(&workers[0]);
+        for (i = 1; i < nr_workers; i++) {
+            qemu_sem_wait(&done);
+        }
+
+        for (i = 0; i < nr_pages; i++) {
+            DumpPage *p = &pages[i];
+
+            if (p->zero) {
+                ret = write_cache(&page_desc, &pd_zero, sizeof(PageDescriptor),
+                                  false);
                 if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
+                    error_setg(errp, "dump: failed to write page desc");
                     goto out;
                 }
+                s->written_size += s->dump_info.page_size;
+                continue;
+            }
+
+            ret = write_cache(&page_data, p->flags ? p->out : p->buf,
+                              p->size_out, false);
+            if (ret < 0) {
+                error_setg(errp, "dump: failed to write page data");
+                goto out;
             }
 
             /* get and write page desc here */
+            pd.flags = cpu_to_dump32(s, p->flags);
+            pd.size = cpu_to_dump32(s, p->size_out);
             pd.page_flags = cpu_to_dump64(s, 0);
             pd.offset = cpu_to_dump64(s, offset_data);
-            offset_data += size_out;
+            offset_data += p->size_out;
 
             ret = write_cache(&page_desc, &pd, sizeof(PageDescriptor), false);
             if (ret < 0) {
                 error_setg(errp, "dump: failed to write page desc");
                 goto out;
             }
+            s->written_size += s->dump_info.page_size;
         }
-        s->written_size += s->dump_info.page_size;
     }
 
     ret = write_cache(&page_desc, NULL, 0, true);
@@ -1634,11 +1791,21 @@ out:
     free_data_cache(&page_desc);
     free_data_cache(&page_data);
 
-#ifdef CONFIG_LZO
-    g_free(wrkmem);
-#endif
+    for (i = 0; i < nr_workers; i++) {
+        if (i) {
+            workers[i].quit = true;
+            qemu_sem_post(&workers[i].sem);
+            qemu_thread_join(&workers[i].thread);
+            qemu_sem_destroy(&workers[i].sem);
+        }
+        dump_compress_worker_cleanup(&workers[i]);
+    }
+    qemu_sem_destroy(&done);
 
-    g_free(buf_out);
+    for (i = 0; i < nr_slots; i++) {
+        g_free(pages[i].copy);
+        g_free(pages[i].out);
+    }
 }
 
 static void create_kdump_vmcore(DumpState *s, Error **errp)
@@ -1946,6 +2113,10 @@ static void dump_init(DumpState *s, int fd, bool has_format,
             s->flag_compress = DUMP_DH_COMPRESSED_SNAPPY;
             break;
 
+        case DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD:
+            s->flag_compress = DUMP_DH_COMPRESSED_ZSTD;
+            break;
+
         default:
             s->flag_compress = 0;
         }
@@ -2105,6 +2276,10 @@ void qmp_dump_guest_memory(bool paging, const char *protocol,
             format = DUMP_GUEST_MEMORY_FORMAT_KDUMP_SNAPPY;
             kdump_raw = true;
             break;
+        case DUMP_GUEST_MEMORY_FORMAT_KDUMP_RAW_ZSTD:
+            format = DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD;
+            kdump_raw = true;
+            break;
         default:
             break;
         }
@@ -2132,7 +2307,7 @@ void qmp_dump_guest_memory(bool paging, const char *protocol,
         detach_p = detach;
     }
 
-    /* check whether lzo/snappy is supported */
+    /* check whether lzo/snappy/zstd is supported */
 #ifndef CONFIG_LZO
     if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_KDUMP_LZO) {
         error_setg(errp, "kdump-lzo is not available now");
@@ -2147,6 +2322,13 @@ void qmp_dump_guest_memory(bool paging, const char *protocol,
     }
 #endif
 
+#ifndef CONFIG_ZSTD
+    if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD) {
+        error_setg(errp, "kdump-zstd is not available now");
+        return;
+    }
+#endif
+
     if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_WIN_DMP
         && !win_dump_available(errp)) {
         return;
@@ -2234,6 +2416,12 @@ DumpGuestMemoryCapability *qmp_query_dump_guest_memory_capability(Error **errp)
     QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_KDUMP_RAW_SNAPPY);
 #endif
 
+    /* add new item if kdump-zstd is available */
+#ifdef CONFIG_ZSTD
+    QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD);
+    QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_KDUMP_RAW_ZSTD);
+#endif
+
     if (win_dump_available(NULL)) {
         QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_WIN_DMP);
     }
@@ -46,3 +46,14 @@ void ebpf_rss_unload(struct EBPFRSSContext *ctx)
 {
 
 }
+
+bool ebpf_rss_has_counters(struct EBPFRSSContext *ctx)
+{
+    return false;
+}
+
+bool ebpf_rss_get_counters(struct EBPFRSSContext *ctx, uint16_t queue,
+                           struct EBPFRSSQueueCounters *counters)
+{
+    return false;
+}
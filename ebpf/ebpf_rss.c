@@ -35,6 +35,7 @@ void ebpf_rss_init(struct EBPFRSSContext *ctx)
         ctx->map_configuration = -1;
         ctx->map_toeplitz_key = -1;
         ctx->map_indirections_table = -1;
+        ctx->map_counters = -1;
 
         ctx->mmap_configuration = NULL;
         ctx->mmap_toeplitz_key = NULL;
@@ -105,6 +106,7 @@ static void ebpf_rss_munmap(struct EBPFRSSContext *ctx)
 bool ebpf_rss_load(struct EBPFRSSContext *ctx, Error **errp)
 {
     struct rss_bpf *rss_bpf_ctx;
+    struct bpf_map *map_counters;
 
     if (ebpf_rss_is_loaded(ctx)) {
         return false;
@@ -135,6 +137,11 @@ bool ebpf_rss_load(struct EBPFRSSContext *ctx, Error **errp)
     ctx->map_toeplitz_key = bpf_map__fd(
             rss_bpf_ctx->maps.tap_rss_map_toeplitz_key);
 
+    /* Older builds of the program do not have the counters */
+    map_counters = bpf_object__find_map_by_name(rss_bpf_ctx->obj,
+                                                "tap_rss_map_counters");
+    ctx->map_counters = map_counters ? bpf_map__fd(map_counters) : -1;
+
     trace_ebpf_rss_load(ctx,
                         ctx->program_fd,
                         ctx->map_configuration,
@@ -152,6 +159,7 @@ error:
     ctx->map_configuration = -1;
     ctx->map_toeplitz_key = -1;
     ctx->map_indirections_table = -1;
+    ctx->map_counters = -1;
 
     return false;
 }
@@ -303,6 +311,41 @@ void ebpf_rss_unload(struct EBPFRSSContext *ctx)
     ctx->map_configuration = -1;
     ctx->map_toeplitz_key = -1;
     ctx->map_indirections_table = -1;
+    ctx->map_counters = -1;
+}
+
+bool ebpf_rss_has_counters(struct EBPFRSSContext *ctx)
+{
+    return ebpf_rss_is_loaded(ctx) && ctx->map_counters != -1;
+}
+
+bool ebpf_rss_get_counters(struct EBPFRSSContext *ctx, uint16_t queue,
+                           struct EBPFRSSQueueCounters *counters)
+{
+    g_autofree struct EBPFRSSQueueCounters *values = NULL;
+    uint32_t key = queue;
+    int ncpus;
+
+    if (!ebpf_rss_has_counters(ctx)) {
+        return false;
+    }
+
+    /* The map has one value per possible CPU */
+    ncpus = libbpf_num_possible_cpus();
+    if (ncpus <= 0) {
+        return false;
+    }
+    values = g_new(struct EBPFRSSQueueCounters, ncpus);
+    if (bpf_map_lookup_elem(ctx->map_counters, &key, values)) {
+        return false;
+    }
+
+    *counters = (struct EBPFRSSQueueCounters) {};
+    for (int i = 0; i < ncpus; i++) {
+        counters->packets += values[i].packets;
+        counters->bytes += values[i].bytes;
+    }
+    return true;
 }
 
 ebpf_binary_init(EBPF_PROGRAM_ID_RSS, rss_bpf__elf_bytes)
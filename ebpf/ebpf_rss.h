@@ -25,6 +25,12 @@ struct EBPFRSSContext {
     int map_toeplitz_key;
     int map_indirections_table;
 
+    /*
+     * Per-queue counters, -1 if the program does not keep them.  Only
+     * available when the program is loaded from the embedded object.
+     */
+    int map_counters;
+
     /* mapped eBPF maps for direct access to omit bpf_map_update_elem() */
     void *mmap_configuration;
     void *mmap_toeplitz_key;
@@ -39,6 +45,12 @@ struct EBPFRSSConfig {
     uint16_t default_queue;
 } __attribute__((packed));
 
+/* Packets steered to one queue, see tap_rss_map_counters */
+struct EBPFRSSQueueCounters {
+    uint64_t packets;
+    uint64_t bytes;
+};
+
 void ebpf_rss_init(struct EBPFRSSContext *ctx);
 
 bool ebpf_rss_is_loaded(struct EBPFRSSContext *ctx);
@@ -55,4 +67,9 @@ bool ebpf_rss_set_all(struct EBPFRSSContext *ctx, struct EBPFRSSConfig *config,
 
 void ebpf_rss_unload(struct EBPFRSSContext *ctx);
 
+bool ebpf_rss_has_counters(struct EBPFRSSContext *ctx);
+
+bool ebpf_rss_get_counters(struct EBPFRSSContext *ctx, uint16_t queue,
+                           struct EBPFRSSQueueCounters *counters);
+
 #endif /* QEMU_EBPF_RSS_H */
@@ -4357,10 +4357,49 @@ static bfloat16 bfloat16_minmax(bfloat16 a, bfloat16 b,
     return bfloat16_round_pack_canonical(pr, s);
 }
 
+/*
+ * Map the sign-magnitude encoding @x, with sign bit @sign, onto an
+ * unsigned integer ordered the same way as the values, -0 below +0.
+ */
+static inline uint64_t minmax_order_key(uint64_t x, uint64_t sign)
+{
+    return x & sign ? ~x & (sign * 2 - 1) : x | sign;
+}
+
+/*
+ * Return true if parts_minmax would select @a over @b, given two inputs
+ * that are neither NaN nor denormal.  Such inputs raise no exceptions
+ * and are returned unchanged, so the choice can be made on the raw
+ * encodings, independent of the rounding mode and accrued flags.
+ */
+static inline bool minmax_fast_pick_a(uint64_t a, uint64_t b,
+                                      uint64_t sign, int flags)
+{
+    uint64_t ka, kb;
+
+    if (flags & minmax_ismag) {
+        ka = a & ~sign;
+        kb = b & ~sign;
+        if (ka != kb) {
+            goto done;
+        }
+    }
+    ka = minmax_order_key(a, sign);
+    kb = minmax_order_key(b, sign);
+ done:
+    return flags & minmax_ismin ? ka <= kb : ka >= kb;
+}
+
 static float32 float32_minmax(float32 a, float32 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    if (likely(!float32_is_any_nan(a) && !float32_is_any_nan(b) &&
+               !float32_is_denormal(a) && !float32_is_denormal(b))) {
+        return minmax_fast_pick_a(float32_val(a), float32_val(b),
+                                  1ull << 31, flags) ? a : b;
+    }
+
     float32_unpack_canonical(&pa, a, s);
     float32_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
@@ -4372,6 +4411,12 @@ static float64 float64_minmax(float64 a, float64 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    if (likely(!float64_is_any_nan(a) && !float64_is_any_nan(b) &&
+               !float64_is_denormal(a) && !float64_is_denormal(b))) {
+        return minmax_fast_pick_a(float64_val(a), float64_val(b),
+                                  1ull << 63, flags) ? a : b;
+    }
+
     float64_unpack_canonical(&pa, a, s);
     float64_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
@@ -1307,6 +1307,39 @@ static void handle_read_mem(GArray *params, void *user_ctx)
     gdb_put_strbuf();
 }
 
+static void handle_read_mem_binary(GArray *params, void *user_ctx)
+{
+    uint64_t len;
+
+    if (params->len != 2) {
+        gdb_put_packet("E22");
+        return;
+    }
+
+    /*
+     * The reply may be shorter than requested, gdb asks for the rest.
+     * Every byte may need escaping, keep room for that and the prefix.
+     */
+    len = MIN(gdb_get_cmd_param(params, 1)->val_ull,
+              (MAX_PACKET_LENGTH - 5) / 2);
+    g_byte_array_set_size(gdbserver_state.mem_buf, len);
+
+    if (gdb_target_memory_rw_debug(gdbserver_state.g_cpu,
+                                   gdb_get_cmd_param(params, 0)->val_ull,
+                                   gdbserver_state.mem_buf->data,
+                                   gdbserver_state.mem_buf->len, false)) {
+        gdb_put_packet("E14");
+        return;
+    }
+
+    g_string_assign(gdbserver_state.str_buf, "b");
+    gdb_memtox(gdbserver_state.str_buf,
+               (const char *)gdbserver_state.mem_buf->data,
+               gdbserver_state.mem_buf->len);
+    gdb_put_packet_binary(gdbserver_state.str_buf->str,
+                          gdbserver_state.str_buf->len, true);
+}
+
 static void handle_write_all_regs(GArray *params, void *user_ctx)
 {
     int reg_id;
@@ -1672,6 +1705,7 @@ void gdb_extend_qsupported_features(char *qflags)
 static void handle_query_supported(GArray *params, void *user_ctx)
 {
     g_string_printf(gdbserver_state.str_buf, "PacketSize=%x", MAX_PACKET_LENGTH);
+    g_string_append(gdbserver_state.str_buf, ";binary-upload+");
     if (gdb_get_core_xml_file(first_cpu)) {
         g_string_append(gdbserver_state.str_buf, ";qXfer:features:read+");
     }
@@ -2206,6 +2240,17 @@ static int gdb_handle_packet(const char *line_buf)
             cmd_parser = &write_mem_cmd_desc;
         }
         break;
+    case 'x':
+        {
+            static const GdbCmdParseEntry read_mem_binary_cmd_desc = {
+                .handler = handle_read_mem_binary,
+                .cmd = "x",
+                .cmd_startswith = true,
+                .schema = "L,L0"
+            };
+            cmd_parser = &read_mem_binary_cmd_desc;
+        }
+        break;
     case 'p':
         {
             static const GdbCmdParseEntry get_reg_cmd_desc = {
@@ -576,6 +576,19 @@ SRST
     Show roms.
 ERST
 
+    {
+        .name       = "startup",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show time taken by each startup phase",
+        .cmd_info_hrt = qmp_x_query_startup_timing,
+    },
+
+SRST
+  ``info startup``
+    Show how long QEMU took to reach each machine initialization phase.
+ERST
+
     {
         .name       = "trace-events",
         .args_type  = "name:s?,vcpu:i?",
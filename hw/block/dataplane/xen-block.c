@@ -120,19 +120,26 @@ out:
     return request;
 }
 
+/* Batch notifications while inside a defer_call_begin()/defer_call_end() */
+static void xen_block_notify_deferred_fn(void *opaque)
+{
+    XenBlockDataPlane *dataplane = opaque;
+    Error *local_err = NULL;
+
+    xen_device_notify_event_channel(dataplane->xendev,
+                                    dataplane->event_channel,
+                                    &local_err);
+    if (local_err) {
+        error_report_err(local_err);
+    }
+}
+
 static void xen_block_complete_request(XenBlockRequest *request)
 {
     XenBlockDataPlane *dataplane = request->dataplane;
 
     if (xen_block_send_response(request)) {
-        Error *local_err = NULL;
-
-        xen_device_notify_event_channel(dataplane->xendev,
-                                        dataplane->event_channel,
-                                        &local_err);
-        if (local_err) {
-            error_report_err(local_err);
-        }
+        defer_call(xen_block_notify_deferred_fn, dataplane);
     }
 
     QLIST_REMOVE(request, list);
@@ -33,7 +33,7 @@
 #endif
 #include "hw/virtio/virtio-bus.h"
 #include "migration/qemu-file-types.h"
-#include "hw/virtio/iothread-vq-mapping.h"
+#include "system/iothread-vq-mapping.h"
 #include "hw/virtio/virtio-access.h"
 #include "hw/virtio/virtio-blk-common.h"
 #include "qemu/coroutine.h"
@@ -80,6 +80,11 @@ static int virtio_blk_handle_rw_error(VirtIOBlockReq *req, int error,
          * ring again. Otherwise we may end up doing a double completion! */
         req->mr_next = NULL;
 
+        /* The request is accounted again when it is restarted */
+        if (acct_failed) {
+            block_acct_cancel(blk_get_stats(s->blk), &req->acct);
+        }
+
         WITH_QEMU_LOCK_GUARD(&s->rq_lock) {
             req->next = s->rq;
             s->rq = req;
@@ -168,14 +173,20 @@ static void virtio_blk_discard_write_zeroes_complete(void *opaque, int ret)
     g_free(req);
 }
 
-static VirtIOBlockReq *virtio_blk_get_request(VirtIOBlock *s, VirtQueue *vq)
+/* Number of requests popped from the virtqueue at a time */
+#define VIRTIO_BLK_POP_BATCH 32
+
+static unsigned int virtio_blk_get_requests(VirtIOBlock *s, VirtQueue *vq,
+                                            VirtIOBlockReq **reqs,
+                                            unsigned int max)
 {
-    VirtIOBlockReq *req = virtqueue_pop(vq, sizeof(VirtIOBlockReq));
+    unsigned int i, n;
 
-    if (req) {
-        virtio_blk_init_request(s, vq, req);
+    n = virtqueue_pop_batch(vq, sizeof(VirtIOBlockReq), (void **)reqs, max);
+    for (i = 0; i < n; i++) {
+        virtio_blk_init_request(s, vq, reqs[i]);
     }
-    return req;
+    return n;
 }
 
 static void virtio_blk_handle_scsi(VirtIOBlockReq *req)
@@ -980,22 +991,34 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
 
 void virtio_blk_handle_vq(VirtIOBlock *s, VirtQueue *vq)
 {
-    VirtIOBlockReq *req;
+    VirtIOBlockReq *reqs[VIRTIO_BLK_POP_BATCH];
+    unsigned int i, n;
     MultiReqBuffer mrb = {};
     bool suppress_notifications = virtio_queue_get_notification(vq);
 
     defer_call_begin();
 
     do {
+        bool failed = false;
+
         if (suppress_notifications) {
             virtio_queue_set_notification(vq, 0);
         }
 
-        while ((req = virtio_blk_get_request(s, vq))) {
-            if (virtio_blk_handle_request(req, &mrb)) {
-                virtqueue_detach_element(req->vq, &req->elem, 0);
-                g_free(req);
-                break;
+        while (!failed &&
+               (n = virtio_blk_get_requests(s, vq, reqs, ARRAY_SIZE(reqs)))) {
+            for (i = 0; i < n; i++) {
+                if (virtio_blk_handle_request(reqs[i], &mrb)) {
+                    virtqueue_detach_element(vq, &reqs[i]->elem, 0);
+                    g_free(reqs[i]);
+                    /* Put back what was popped after the failing request */
+                    while (--n > i) {
+                        virtqueue_unpop(vq, &reqs[n]->elem, 0);
+                        g_free(reqs[n]);
+                    }
+                    failed = true;
+                    break;
+                }
             }
         }
 
@@ -321,6 +321,30 @@ HumanReadableText *qmp_x_query_ramblock(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+HumanReadableText *qmp_x_query_startup_timing(Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+    MachineInitPhase phase;
+    int64_t prev = 0;
+
+    for (phase = PHASE_MACHINE_CREATED; phase <= PHASE_MACHINE_READY;
+         phase++) {
+        int64_t elapsed = phase_get_elapsed_us(phase);
+
+        if (elapsed < 0) {
+            g_string_append_printf(buf, "%-22s not reached\n",
+                                   phase_get_name(phase));
+            break;
+        }
+        g_string_append_printf(buf, "%-22s %10" PRId64 " us (+%" PRId64
+                               " us)\n", phase_get_name(phase), elapsed,
+                               elapsed - prev);
+        prev = elapsed;
+    }
+
+    return human_readable_text_from_str(buf);
+}
+
 static int qmp_x_query_irq_foreach(Object *obj, void *opaque)
 {
     InterruptStatsProvider *intc;
@@ -853,10 +853,43 @@ bool phase_check(MachineInitPhase phase)
     return machine_phase >= phase;
 }
 
+static const char *const machine_phase_names[] = {
+    [PHASE_NO_MACHINE] = "start",
+    [PHASE_MACHINE_CREATED] = "machine-created",
+    [PHASE_ACCEL_CREATED] = "accel-created",
+    [PHASE_LATE_BACKENDS_CREATED] = "late-backends-created",
+    [PHASE_MACHINE_INITIALIZED] = "machine-initialized",
+    [PHASE_MACHINE_READY] = "machine-ready",
+};
+
+/* g_get_monotonic_time() when each phase was reached */
+static int64_t machine_phase_time[PHASE_MACHINE_READY + 1];
+
+static void __attribute__((constructor)) machine_phase_init_time(void)
+{
+    machine_phase_time[PHASE_NO_MACHINE] = g_get_monotonic_time();
+}
+
 void phase_advance(MachineInitPhase phase)
 {
     assert(machine_phase == phase - 1);
     machine_phase = phase;
+    machine_phase_time[phase] = g_get_monotonic_time();
+    trace_machine_phase_advance(machine_phase_names[phase],
+                                phase_get_elapsed_us(phase));
+}
+
+const char *phase_get_name(MachineInitPhase phase)
+{
+    return machine_phase_names[phase];
+}
+
+int64_t phase_get_elapsed_us(MachineInitPhase phase)
+{
+    if (!phase_check(phase)) {
+        return -1;
+    }
+    return machine_phase_time[phase] - machine_phase_time[PHASE_NO_MACHINE];
 }
 
 static const TypeInfo device_type_info = {
@@ -2114,6 +2114,7 @@ static const MemoryRegionOps cirrus_vga_mem_ops = {
     .read = cirrus_vga_mem_read,
     .write = cirrus_vga_mem_write,
     .endianness = DEVICE_LITTLE_ENDIAN,
+    .coalesce_writes = true,
     .impl = {
         .min_access_size = 1,
         .max_access_size = 1,
@@ -2897,7 +2898,6 @@ void cirrus_init_common(CirrusVGAState *s, Object *owner,
                                         0x000a0000,
                                         &s->low_mem_container,
                                         1);
-    memory_region_set_coalescing(&s->low_mem);
 
     /* I/O handler for LFB */
     memory_region_init_io(&s->cirrus_linear_io, owner, &cirrus_linear_io_ops, s,
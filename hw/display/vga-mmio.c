@@ -98,7 +98,6 @@ static void vga_mmio_realizefn(DeviceState *dev, Error **errp)
     /* XXX: endianness? */
     memory_region_init_io(&s->lowmem, OBJECT(dev), &vga_mem_ops, &s->vga,
                           "vga-lowmem", 0x20000);
-    memory_region_set_coalescing(&s->lowmem);
     sysbus_init_mmio(sbd, &s->lowmem);
 
     s->vga.bank_offset = 0;
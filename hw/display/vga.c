@@ -2090,6 +2090,7 @@ const MemoryRegionOps vga_mem_ops = {
     .read = vga_mem_read,
     .write = vga_mem_write,
     .endianness = DEVICE_LITTLE_ENDIAN,
+    .coalesce_writes = true,
     .impl = {
         .min_access_size = 1,
         .max_access_size = 1,
@@ -2177,6 +2178,7 @@ static const GraphicHwOps vga_ops = {
     .invalidate  = vga_invalidate_display,
     .gfx_update  = vga_update_display,
     .text_update = vga_update_text,
+    .filter_updates = true,
 };
 
 static inline uint32_t uint_clamp(uint32_t val, uint32_t vmin, uint32_t vmax)
@@ -2317,7 +2319,6 @@ MemoryRegion *vga_init_io(VGACommonState *s, Object *obj,
     vga_mem = g_malloc(sizeof(*vga_mem));
     memory_region_init_io(vga_mem, obj, &vga_mem_ops, s,
                           "vga-lowmem", 0x20000);
-    memory_region_set_flush_coalesced(vga_mem);
 
     return vga_mem;
 }
@@ -2339,7 +2340,6 @@ void vga_init(VGACommonState *s, Object *obj, MemoryRegion *address_space,
                                         0x000a0000,
                                         vga_io_memory,
                                         1);
-    memory_region_set_coalescing(vga_io_memory);
     if (init_vga_ports) {
         portio_list_init(&s->vga_port_list, obj, vga_ports, s, "vga");
         portio_list_set_flush_coalesced(&s->vga_port_list);
@@ -507,6 +507,8 @@ static void virtio_gpu_resource_flush(VirtIOGPU *g,
         return;
     }
 
+    qemu_rect_init(&flush_rect, rf.r.x, rf.r.y, rf.r.width, rf.r.height);
+
     if (res->blob) {
         for (i = 0; i < g->parent_obj.conf.max_outputs; i++) {
             scanout = &g->parent_obj.scanout[i];
@@ -518,8 +520,16 @@ static void virtio_gpu_resource_flush(VirtIOGPU *g,
                 within_bounds = true;
 
                 if (console_has_gl(scanout->con)) {
-                    dpy_gl_update(scanout->con, 0, 0, scanout->width,
-                                  scanout->height);
+                    QemuRect rect;
+
+                    /* only pass the damaged part on to the display */
+                    qemu_rect_init(&rect, scanout->x, scanout->y,
+                                   scanout->width, scanout->height);
+                    if (qemu_rect_intersect(&flush_rect, &rect, &rect)) {
+                        qemu_rect_translate(&rect, -scanout->x, -scanout->y);
+                        dpy_gl_update(scanout->con, rect.x, rect.y,
+                                      rect.width, rect.height);
+                    }
                     update_submitted = true;
                 }
             }
@@ -553,7 +563,6 @@ static void virtio_gpu_resource_flush(VirtIOGPU *g,
         return;
     }
 
-    qemu_rect_init(&flush_rect, rf.r.x, rf.r.y, rf.r.width, rf.r.height);
     for (i = 0; i < g->parent_obj.conf.max_outputs; i++) {
         QemuRect rect;
 
@@ -242,6 +242,14 @@ static guint vtd_iotlb_hash(gconstpointer v)
     return (guint)((hash64 >> 32) ^ (hash64 & 0xffffffffU));
 }
 
+static void vtd_iotlb_entry_free(gpointer v)
+{
+    VTDIOTLBEntry *entry = v;
+
+    QTAILQ_REMOVE(&entry->iommu->iotlb_lru, entry, lru);
+    g_free(entry);
+}
+
 static gboolean vtd_as_equal(gconstpointer v1, gconstpointer v2)
 {
     const struct vtd_as_key *key1 = v1;
@@ -412,8 +420,15 @@ static VTDIOTLBEntry *vtd_lookup_iotlb(IntelIOMMUState *s, uint16_t source_id,
             goto out;
         }
     }
+    s->iotlb_misses++;
+    return NULL;
 
 out:
+    s->iotlb_hits++;
+    if (entry != QTAILQ_FIRST(&s->iotlb_lru)) {
+        QTAILQ_REMOVE(&s->iotlb_lru, entry, lru);
+        QTAILQ_INSERT_HEAD(&s->iotlb_lru, entry, lru);
+    }
     return entry;
 }
 
@@ -428,9 +443,13 @@ static void vtd_update_iotlb(IntelIOMMUState *s, uint16_t source_id,
     uint64_t gfn = vtd_get_iotlb_gfn(addr, level);
 
     trace_vtd_iotlb_page_update(source_id, addr, pte, domain_id);
-    if (g_hash_table_size(s->iotlb) >= VTD_IOTLB_MAX_SIZE) {
-        trace_vtd_iotlb_reset("iotlb exceeds size limit");
-        vtd_reset_iotlb_locked(s);
+    if (g_hash_table_size(s->iotlb) >= s->iotlb_size) {
+        /* Evict the least recently used entry */
+        VTDIOTLBEntry *victim = QTAILQ_LAST(&s->iotlb_lru);
+
+        trace_vtd_iotlb_evict(victim->gfn, victim->domain_id);
+        g_hash_table_remove(s->iotlb, victim->key);
+        s->iotlb_evictions++;
     }
 
     entry->gfn = gfn;
@@ -440,13 +459,17 @@ static void vtd_update_iotlb(IntelIOMMUState *s, uint16_t source_id,
     entry->mask = vtd_pt_level_page_mask(level);
     entry->pasid = pasid;
     entry->pgtt = pgtt;
+    entry->iommu = s;
+    entry->key = key;
 
     key->gfn = gfn;
     key->sid = source_id;
     key->level = level;
     key->pasid = pasid;
 
+    /* Replacing an existing entry unlinks it from the LRU list */
     g_hash_table_replace(s->iotlb, key, entry);
+    QTAILQ_INSERT_HEAD(&s->iotlb_lru, entry, lru);
 }
 
 /* Given the reg addr of both the message data and address, generate an
@@ -3838,6 +3861,8 @@ static const Property vtd_properties[] = {
     DEFINE_PROP_BOOL("dma-translation", IntelIOMMUState, dma_translation, true),
     DEFINE_PROP_BOOL("stale-tm", IntelIOMMUState, stale_tm, false),
     DEFINE_PROP_BOOL("fs1gp", IntelIOMMUState, fs1gp, true),
+    DEFINE_PROP_UINT32("x-iotlb-size", IntelIOMMUState, iotlb_size,
+                       VTD_IOTLB_MAX_SIZE),
 };
 
 /* Read IRTE entry with specific index */
@@ -4859,6 +4884,11 @@ static bool vtd_decide_config(IntelIOMMUState *s, Error **errp)
 {
     X86IOMMUState *x86_iommu = X86_IOMMU_DEVICE(s);
 
+    if (!s->iotlb_size) {
+        error_setg(errp, "x-iotlb-size must be at least 1");
+        return false;
+    }
+
     if (s->intr_eim == ON_OFF_AUTO_ON && !x86_iommu_ir_supported(x86_iommu)) {
         error_setg(errp, "eim=on cannot be selected without intremap=on");
         return false;
@@ -4980,8 +5010,15 @@ static void vtd_realize(DeviceState *dev, Error **errp)
                                         VTD_INTERRUPT_ADDR_FIRST,
                                         &s->mr_ir, 1);
     /* No corresponding destroy */
+    QTAILQ_INIT(&s->iotlb_lru);
     s->iotlb = g_hash_table_new_full(vtd_iotlb_hash, vtd_iotlb_equal,
-                                     g_free, g_free);
+                                     g_free, vtd_iotlb_entry_free);
+    object_property_add_uint64_ptr(OBJECT(s), "x-iotlb-hits",
+                                   &s->iotlb_hits, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(OBJECT(s), "x-iotlb-misses",
+                                   &s->iotlb_misses, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(OBJECT(s), "x-iotlb-evictions",
+                                   &s->iotlb_evictions, OBJ_PROP_FLAG_READ);
     s->vtd_address_spaces = g_hash_table_new_full(vtd_as_hash, vtd_as_equal,
                                       g_free, g_free);
     s->vtd_host_iommu_dev = g_hash_table_new_full(vtd_hiod_hash, vtd_hiod_equal,
@@ -25,6 +25,7 @@
 #include "hw/irq.h"
 #include "migration/vmstate.h"
 
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "qemu/log.h"
 #include "qemu/main-loop.h"
@@ -565,11 +566,17 @@ static void check_cmd(AHCIState *s, int port)
     uint8_t slot;
 
     if ((pr->cmd & PORT_CMD_START) && pr->cmd_issue) {
+        /*
+         * A single PxCI write often issues a whole batch of NCQ commands;
+         * let the block layer submit their I/O together.
+         */
+        defer_call_begin();
         for (slot = 0; (slot < 32) && pr->cmd_issue; slot++) {
             if (pr->cmd_issue & (1U << slot)) {
                 handle_cmd(s, port, slot);
             }
         }
+        defer_call_end();
     }
 }
 
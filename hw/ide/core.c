@@ -862,6 +862,8 @@ int ide_handle_rw_error(IDEState *s, int error, int op)
     if (action == BLOCK_ERROR_ACTION_STOP) {
         assert(s->bus->retry_unit == s->unit);
         s->bus->error_status = op;
+        /* The request is accounted again when it is restarted */
+        block_acct_cancel(blk_get_stats(s->blk), &s->acct);
     } else if (action == BLOCK_ERROR_ACTION_REPORT) {
         block_acct_failed(blk_get_stats(s->blk), &s->acct);
         if (IS_IDE_RETRY_DMA(op)) {
@@ -172,6 +172,8 @@ static bool gicv3_get_priority(GICv3CPUState *cs, bool is_redist, int irq,
     return false;
 }
 
+static void gicv3_cpu_full_update_noirqset(GICv3CPUState *cs);
+
 /* Update the interrupt status after state in a redistributor
  * or CPU interface has changed, but don't tell the CPU i/f.
  */
@@ -191,18 +193,14 @@ static void gicv3_redist_update_noirqset(GICv3CPUState *cs)
      */
     pend = gicr_int_pending(cs);
 
-    if (pend) {
-        for (i = 0; i < GIC_INTERNAL; i++) {
-            if (!(pend & (1 << i))) {
-                continue;
-            }
-            nmi = gicv3_get_priority(cs, true, i, &prio);
-            if (irqbetter(cs, i, prio, nmi)) {
-                cs->hppi.irq = i;
-                cs->hppi.prio = prio;
-                cs->hppi.nmi = nmi;
-                seenbetter = true;
-            }
+    for (; pend; pend &= pend - 1) {
+        i = ctz32(pend);
+        nmi = gicv3_get_priority(cs, true, i, &prio);
+        if (irqbetter(cs, i, prio, nmi)) {
+            cs->hppi.irq = i;
+            cs->hppi.prio = prio;
+            cs->hppi.nmi = nmi;
+            seenbetter = true;
         }
     }
 
@@ -236,7 +234,7 @@ static void gicv3_redist_update_noirqset(GICv3CPUState *cs)
     if (!seenbetter && cs->hppi.prio != 0xff &&
         (cs->hppi.irq < GIC_INTERNAL ||
          cs->hppi.irq >= GICV3_LPI_INTID_START)) {
-        gicv3_full_update_noirqset(cs->gic);
+        gicv3_cpu_full_update_noirqset(cs);
     }
 }
 
@@ -356,6 +354,52 @@ void gicv3_full_update_noirqset(GICv3State *s)
     }
 }
 
+/*
+ * Recalculate the highest priority pending interrupt of a single CPU
+ * from scratch, but don't update its outbound IRQ lines.  A change in
+ * redistributor state only affects the CPU it belongs to, so there is no
+ * need for a gicv3_full_update_noirqset() over every CPU.
+ */
+static void gicv3_cpu_full_update_noirqset(GICv3CPUState *cs)
+{
+    GICv3State *s = cs->gic;
+    bool seenbetter = false;
+    uint32_t pend;
+    uint8_t prio;
+    bool nmi;
+    int i;
+
+    cs->hppi.prio = 0xff;
+    cs->hppi.nmi = false;
+
+    for (i = GIC_INTERNAL; i < s->num_irq; i += 32) {
+        for (pend = gicd_int_pending(s, i); pend; pend &= pend - 1) {
+            int irq = i + ctz32(pend);
+
+            if (s->gicd_irouter_target[irq] != cs) {
+                continue;
+            }
+            nmi = gicv3_get_priority(cs, false, irq, &prio);
+            if (irqbetter(cs, irq, prio, nmi)) {
+                cs->hppi.irq = irq;
+                cs->hppi.prio = prio;
+                cs->hppi.nmi = nmi;
+                seenbetter = true;
+            }
+        }
+    }
+
+    if (seenbetter) {
+        cs->hppi.grp = gicv3_irq_group(s, cs, cs->hppi.irq);
+    }
+
+    /*
+     * As in gicv3_full_update_noirqset(), the previous best is now
+     * either nothing or a distributor interrupt, so this cannot recurse.
+     */
+    gicv3_redist_update_noirqset(cs);
+}
+
 void gicv3_full_update(GICv3State *s)
 {
     /* Completely recalculate the GIC status from scratch, including
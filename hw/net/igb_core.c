@@ -730,6 +730,25 @@ igb_ring_advance(IGBCore *core, const E1000ERingInfo *r, uint32_t count)
     }
 }
 
+/*
+ * Number of descriptors that can be fetched starting at the head without
+ * crossing the tail or the end of the ring.  The ring must not be empty.
+ */
+static inline uint32_t
+igb_ring_contig_descr_num(IGBCore *core, const E1000ERingInfo *r)
+{
+    uint32_t ring_num = core->mac[r->dlen] / E1000_RING_DESC_LEN;
+    uint32_t dh = core->mac[r->dh];
+    uint32_t dt = core->mac[r->dt];
+
+    if (dh >= ring_num) {
+        /* Bogus head, let advance wrap it after a single descriptor */
+        return 1;
+    }
+
+    return dt > dh ? dt - dh : ring_num - dh;
+}
+
 static inline uint32_t
 igb_ring_free_descr_num(IGBCore *core, const E1000ERingInfo *r)
 {
@@ -871,14 +890,18 @@ igb_tx_enabled(IGBCore *core, const E1000ERingInfo *txi)
         (core->mac[TXDCTL0 + (qn * 16)] & E1000_TXDCTL_QUEUE_ENABLE);
 }
 
+/* Maximum number of TX descriptors fetched with a single DMA read */
+#define IGB_TX_DESC_BATCH 16
+
 static void
 igb_start_xmit(IGBCore *core, const IGB_TxRing *txr)
 {
     PCIDevice *d;
     dma_addr_t base;
-    union e1000_adv_tx_desc desc;
+    union e1000_adv_tx_desc descs[IGB_TX_DESC_BATCH];
     const E1000ERingInfo *txi = txr->i;
     uint32_t eic = 0;
+    uint32_t i, n;
 
     if (!igb_tx_enabled(core, txi)) {
         trace_e1000e_tx_disabled();
@@ -892,15 +915,21 @@ igb_start_xmit(IGBCore *core, const IGB_TxRing *txr)
 
     while (!igb_ring_empty(core, txi)) {
         base = igb_ring_head_descr(core, txi);
+        n = MIN(igb_ring_contig_descr_num(core, txi), IGB_TX_DESC_BATCH);
+
+        pci_dma_read(d, base, descs, n * sizeof(descs[0]));
 
-        pci_dma_read(d, base, &desc, sizeof(desc));
+        for (i = 0; i < n; i++) {
+            union e1000_adv_tx_desc *desc = &descs[i];
 
-        trace_e1000e_tx_descr((void *)(intptr_t)desc.read.buffer_addr,
-                              desc.read.cmd_type_len, desc.wb.status);
+            trace_e1000e_tx_descr((void *)(intptr_t)desc->read.buffer_addr,
+                                  desc->read.cmd_type_len, desc->wb.status);
 
-        igb_process_tx_desc(core, d, txr->tx, &desc, txi->idx);
-        igb_ring_advance(core, txi, 1);
-        eic |= igb_txdesc_writeback(core, base, &desc, txi);
+            igb_process_tx_desc(core, d, txr->tx, desc, txi->idx);
+            igb_ring_advance(core, txi, 1);
+            eic |= igb_txdesc_writeback(core, base + i * E1000_RING_DESC_LEN,
+                                        desc, txi);
+        }
     }
 
     if (eic) {
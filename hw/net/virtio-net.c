@@ -48,6 +48,7 @@
 #include "net_rx_pkt.h"
 #include "hw/virtio/vhost.h"
 #include "system/qtest.h"
+#include "system/stats.h"
 
 #define VIRTIO_NET_VM_VERSION    11
 
@@ -1316,6 +1317,114 @@ static void virtio_net_unload_ebpf(VirtIONet *n)
     ebpf_rss_unload(&n->ebpf_rss);
 }
 
+#define EBPF_RSS_PACKETS_STR "packets"
+#define EBPF_RSS_BYTES_STR "bytes"
+
+typedef struct VirtIONetStatsArgs {
+    StatsResultList **result;
+    strList *names;
+} VirtIONetStatsArgs;
+
+static StatsList *virtio_net_ebpf_rss_stats_add(const char *name,
+                                                uint64List *values,
+                                                strList *names,
+                                                StatsList *stats_list)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        qapi_free_uint64List(values);
+        return stats_list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QLIST;
+    stats->value->u.list = values;
+
+    QAPI_LIST_PREPEND(stats_list, stats);
+    return stats_list;
+}
+
+static int virtio_net_ebpf_rss_stats_query(Object *obj, void *opaque)
+{
+    VirtIONetStatsArgs *args = opaque;
+    g_autofree char *path = NULL;
+    uint64List *packets = NULL, *bytes = NULL;
+    StatsList *stats_list = NULL;
+    VirtIONet *n;
+    int i;
+
+    if (!object_dynamic_cast(obj, TYPE_VIRTIO_NET)) {
+        return 0;
+    }
+
+    n = VIRTIO_NET(obj);
+    if (!ebpf_rss_has_counters(&n->ebpf_rss)) {
+        return 0;
+    }
+
+    for (i = n->max_queue_pairs - 1; i >= 0; i--) {
+        struct EBPFRSSQueueCounters counters = { 0 };
+
+        ebpf_rss_get_counters(&n->ebpf_rss, i, &counters);
+        QAPI_LIST_PREPEND(packets, counters.packets);
+        QAPI_LIST_PREPEND(bytes, counters.bytes);
+    }
+
+    stats_list = virtio_net_ebpf_rss_stats_add(EBPF_RSS_BYTES_STR, bytes,
+                                               args->names, stats_list);
+    stats_list = virtio_net_ebpf_rss_stats_add(EBPF_RSS_PACKETS_STR, packets,
+                                               args->names, stats_list);
+    if (stats_list) {
+        path = object_get_canonical_path(obj);
+        add_stats_entry(args->result, STATS_PROVIDER_EBPF_RSS, path, stats_list);
+    }
+
+    return 0;
+}
+
+static void virtio_net_ebpf_rss_stats_cb(StatsResultList **result,
+                                         StatsTarget target,
+                                         strList *names, strList *targets,
+                                         Error **errp)
+{
+    VirtIONetStatsArgs args = {
+        .result = result,
+        .names = names,
+    };
+
+    if (target != STATS_TARGET_VIRTIO_NET) {
+        return;
+    }
+
+    object_child_foreach_recursive(object_get_root(),
+                                   virtio_net_ebpf_rss_stats_query, &args);
+}
+
+static void virtio_net_ebpf_rss_schemas_cb(StatsSchemaList **result,
+                                           Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+    StatsSchemaValue *value;
+
+    value = g_new0(StatsSchemaValue, 1);
+    value->type = STATS_TYPE_CUMULATIVE;
+    value->name = g_strdup(EBPF_RSS_PACKETS_STR);
+    QAPI_LIST_PREPEND(stats_list, value);
+
+    value = g_new0(StatsSchemaValue, 1);
+    value->type = STATS_TYPE_CUMULATIVE;
+    value->has_unit = true;
+    value->unit = STATS_UNIT_BYTES;
+    value->name = g_strdup(EBPF_RSS_BYTES_STR);
+    QAPI_LIST_PREPEND(stats_list, value);
+
+    add_stats_schema(result, STATS_PROVIDER_EBPF_RSS, STATS_TARGET_VIRTIO_NET,
+                     stats_list);
+}
+
 static uint16_t virtio_net_handle_rss(VirtIONet *n,
                                       struct iovec *iov,
                                       unsigned int iov_cnt,
@@ -1979,7 +2088,7 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
     }
 
     virtqueue_flush(q->rx_vq, i);
-    virtio_notify(vdev, q->rx_vq);
+    virtio_notify_deferred(vdev, q->rx_vq);
 
     return size;
 
@@ -2653,12 +2762,34 @@ static void virtio_net_tx_complete(NetClientState *nc, ssize_t len)
     }
 }
 
+/* Sent TX elements returned to the guest with a single used index update */
+#define TX_PUSH_BATCH 64
+
+static void virtio_net_tx_push_done(VirtIONetQueue *q,
+                                    VirtQueueElement **elems,
+                                    unsigned int count)
+{
+    unsigned int i;
+
+    if (!count) {
+        return;
+    }
+
+    virtqueue_push_batch(q->tx_vq, elems, NULL, count);
+    virtio_notify(VIRTIO_DEVICE(q->n), q->tx_vq);
+    for (i = 0; i < count; i++) {
+        g_free(elems[i]);
+    }
+}
+
 /* TX */
 static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
 {
     VirtIONet *n = q->n;
     VirtIODevice *vdev = VIRTIO_DEVICE(n);
     VirtQueueElement *elem;
+    VirtQueueElement *done[TX_PUSH_BATCH];
+    unsigned int num_done = 0;
     int32_t num_packets = 0;
     int queue_index = vq2q(virtio_get_queue_index(q->tx_vq));
     if (!(vdev->status & VIRTIO_CONFIG_S_DRIVER_OK)) {
@@ -2734,23 +2865,28 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
         ret = qemu_sendv_packet_async(qemu_get_subqueue(n->nic, queue_index),
                                       out_sg, out_num, virtio_net_tx_complete);
         if (ret == 0) {
+            virtio_net_tx_push_done(q, done, num_done);
             virtio_queue_set_notification(q->tx_vq, 0);
             q->async_tx.elem = elem;
             return -EBUSY;
         }
 
 drop:
-        virtqueue_push(q->tx_vq, elem, 0);
-        virtio_notify(vdev, q->tx_vq);
-        g_free(elem);
+        done[num_done++] = elem;
+        if (num_done == ARRAY_SIZE(done)) {
+            virtio_net_tx_push_done(q, done, num_done);
+            num_done = 0;
+        }
 
         if (++num_packets >= n->tx_burst) {
             break;
         }
     }
+    virtio_net_tx_push_done(q, done, num_done);
     return num_packets;
 
 detach:
+    virtio_net_tx_push_done(q, done, num_done);
     virtqueue_detach_element(q->tx_vq, elem, 0);
     g_free(elem);
     return -EINVAL;
@@ -4251,6 +4387,9 @@ static void virtio_net_class_init(ObjectClass *klass, const void *data)
     vdc->primary_unplug_pending = primary_unplug_pending;
     vdc->get_vhost = virtio_net_get_vhost;
     vdc->toggle_device_iotlb = vhost_toggle_device_iotlb;
+
+    add_stats_callbacks(STATS_PROVIDER_EBPF_RSS, virtio_net_ebpf_rss_stats_cb,
+                        virtio_net_ebpf_rss_schemas_cb);
 }
 
 static const TypeInfo virtio_net_info = {
@@ -73,7 +73,6 @@ static void net_tx_response(struct XenNetDev *netdev, netif_tx_request_t *txp, i
 {
     RING_IDX i = netdev->tx_ring.rsp_prod_pvt;
     netif_tx_response_t *resp;
-    int notify;
 
     resp = RING_GET_RESPONSE(&netdev->tx_ring, i);
     resp->id     = txp->id;
@@ -86,13 +85,20 @@ static void net_tx_response(struct XenNetDev *netdev, netif_tx_request_t *txp, i
 #endif
 
     netdev->tx_ring.rsp_prod_pvt = ++i;
+}
+
+/* Publish the responses queued by net_tx_response() with one notification */
+static void net_tx_push_responses(struct XenNetDev *netdev)
+{
+    int notify;
+
     RING_PUSH_RESPONSES_AND_CHECK_NOTIFY(&netdev->tx_ring, notify);
     if (notify) {
         xen_device_notify_event_channel(XEN_DEVICE(netdev),
                                         netdev->event_channel, NULL);
     }
 
-    if (i == netdev->tx_ring.req_cons) {
+    if (netdev->tx_ring.rsp_prod_pvt == netdev->tx_ring.req_cons) {
         int more_to_do;
         RING_FINAL_CHECK_FOR_REQUESTS(&netdev->tx_ring, more_to_do);
         if (more_to_do) {
@@ -212,6 +218,7 @@ static bool net_tx_packets(struct XenNetDev *netdev)
                                         NULL);
             net_tx_response(netdev, &txreq, NETIF_RSP_OKAY);
         }
+        net_tx_push_responses(netdev);
         if (!netdev->tx_work) {
             break;
         }
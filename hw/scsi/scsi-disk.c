@@ -319,6 +319,8 @@ static bool scsi_handle_rw_error(SCSIDiskReq *r, int ret, bool acct_failed)
         return false;
 
     case BLOCK_ERROR_ACTION_STOP:
+        /* The request is accounted again when it is restarted */
+        block_acct_cancel(blk_get_stats(s->qdev.conf.blk), &r->acct);
         scsi_req_retry(&r->req);
         return true;
 
@@ -330,6 +332,9 @@ static bool scsi_handle_rw_error(SCSIDiskReq *r, int ret, bool acct_failed)
 static bool scsi_disk_req_check_error(SCSIDiskReq *r, int ret, bool acct_failed)
 {
     if (r->req.io_canceled) {
+        SCSIDiskState *s = DO_UPCAST(SCSIDiskState, qdev, r->req.dev);
+
+        block_acct_cancel(blk_get_stats(s->qdev.conf.blk), &r->acct);
         scsi_req_cancel_complete(&r->req);
         return true;
     }
@@ -27,7 +27,7 @@
 #include "hw/qdev-properties.h"
 #include "hw/scsi/scsi.h"
 #include "scsi/constants.h"
-#include "hw/virtio/iothread-vq-mapping.h"
+#include "system/iothread-vq-mapping.h"
 #include "hw/virtio/virtio-bus.h"
 #include "hw/virtio/virtio-access.h"
 #include "trace.h"
@@ -116,10 +116,15 @@ static void virtio_scsi_complete_req(VirtIOSCSIReq *req, QemuMutex *vq_lock)
     }
 
     virtqueue_push(vq, &req->elem, req->qsgl.size + req->resp_iov.size);
+    /*
+     * Both variants defer the notification while inside a
+     * defer_call_begin()/defer_call_end() section, so a burst of
+     * completions raises one interrupt per virtqueue.
+     */
     if (s->dataplane_started && !s->dataplane_fenced) {
         virtio_notify_irqfd(vdev, vq);
     } else {
-        virtio_notify(vdev, vq);
+        virtio_notify_deferred(vdev, vq);
     }
 
     if (vq_lock) {
@@ -136,6 +136,20 @@ typedef struct XHCITRB {
     bool ccs;
 } XHCITRB;
 
+/*
+ * Window of raw TRBs read with one DMA access, so that sizing a TD with
+ * xhci_ring_chain_length() and then fetching its TRBs doesn't cost two
+ * accesses per TRB.  It is only valid for the TD being set up.
+ */
+#define TRB_CACHE_COUNT 16
+#define TRB_CACHE_BOUNDARY 4096
+
+typedef struct XHCITRBCache {
+    dma_addr_t base;
+    unsigned int count;
+    uint8_t trbs[TRB_CACHE_COUNT][TRB_SIZE];
+} XHCITRBCache;
+
 enum {
     PLS_U0              =  0,
     PLS_U1              =  1,
@@ -688,15 +702,50 @@ static void xhci_ring_init(XHCIState *xhci, XHCIRing *ring,
     ring->ccs = 1;
 }
 
+/*
+ * Read the TRB at @addr, through @cache if not NULL.  A cache miss reads
+ * as many TRBs as fit before the next page boundary, falling back to the
+ * single TRB if that fails.
+ */
+static MemTxResult xhci_trb_read(XHCIState *xhci, XHCITRBCache *cache,
+                                 dma_addr_t addr, XHCITRB *trb)
+{
+    unsigned int count;
+
+    if (!cache) {
+        return dma_memory_read(xhci->as, addr, trb, TRB_SIZE,
+                               MEMTXATTRS_UNSPECIFIED);
+    }
+
+    if (cache->count == 0 || addr < cache->base ||
+        addr >= cache->base + cache->count * TRB_SIZE ||
+        (addr - cache->base) % TRB_SIZE) {
+        count = MIN(TRB_CACHE_COUNT,
+                    (TRB_CACHE_BOUNDARY - (addr & (TRB_CACHE_BOUNDARY - 1))) /
+                    TRB_SIZE);
+        cache->count = 0;
+        if (count <= 1 ||
+            dma_memory_read(xhci->as, addr, cache->trbs, count * TRB_SIZE,
+                            MEMTXATTRS_UNSPECIFIED) != MEMTX_OK) {
+            return dma_memory_read(xhci->as, addr, trb, TRB_SIZE,
+                                   MEMTXATTRS_UNSPECIFIED);
+        }
+        cache->base = addr;
+        cache->count = count;
+    }
+
+    memcpy(trb, cache->trbs[(addr - cache->base) / TRB_SIZE], TRB_SIZE);
+    return MEMTX_OK;
+}
+
 static TRBType xhci_ring_fetch(XHCIState *xhci, XHCIRing *ring, XHCITRB *trb,
-                               dma_addr_t *addr)
+                               dma_addr_t *addr, XHCITRBCache *cache)
 {
     uint32_t link_cnt = 0;
 
     while (1) {
         TRBType type;
-        if (dma_memory_read(xhci->as, ring->dequeue, trb, TRB_SIZE,
-                            MEMTXATTRS_UNSPECIFIED) != MEMTX_OK) {
+        if (xhci_trb_read(xhci, cache, ring->dequeue, trb) != MEMTX_OK) {
             qemu_log_mask(LOG_GUEST_ERROR, "%s: DMA memory access failed!\n",
                           __func__);
             return 0;
@@ -735,7 +784,8 @@ static TRBType xhci_ring_fetch(XHCIState *xhci, XHCIRing *ring, XHCITRB *trb,
     }
 }
 
-static int xhci_ring_chain_length(XHCIState *xhci, const XHCIRing *ring)
+static int xhci_ring_chain_length(XHCIState *xhci, const XHCIRing *ring,
+                                  XHCITRBCache *cache)
 {
     XHCITRB trb;
     int length = 0;
@@ -747,8 +797,7 @@ static int xhci_ring_chain_length(XHCIState *xhci, const XHCIRing *ring)
 
     do {
         TRBType type;
-        if (dma_memory_read(xhci->as, dequeue, &trb, TRB_SIZE,
-                        MEMTXATTRS_UNSPECIFIED) != MEMTX_OK) {
+        if (xhci_trb_read(xhci, cache, dequeue, &trb) != MEMTX_OK) {
             qemu_log_mask(LOG_GUEST_ERROR, "%s: DMA memory access failed!\n",
                           __func__);
             return -1;
@@ -1879,6 +1928,7 @@ static void xhci_kick_epctx(XHCIEPContext *epctx, unsigned int streamid)
     USBEndpoint *ep = NULL;
     uint64_t mfindex;
     unsigned int count = 0;
+    XHCITRBCache trb_cache;
     int length;
     int i;
 
@@ -1960,7 +2010,9 @@ static void xhci_kick_epctx(XHCIEPContext *epctx, unsigned int streamid)
 
     epctx->kick_active++;
     while (1) {
-        length = xhci_ring_chain_length(xhci, ring);
+        /* fresh TRBs for every TD, the guest may have added more */
+        trb_cache.count = 0;
+        length = xhci_ring_chain_length(xhci, ring, &trb_cache);
         if (length <= 0) {
             if (epctx->type == ET_ISO_OUT || epctx->type == ET_ISO_IN) {
                 /* 4.10.3.1 */
@@ -1981,7 +2033,8 @@ static void xhci_kick_epctx(XHCIEPContext *epctx, unsigned int streamid)
 
         for (i = 0; i < length; i++) {
             TRBType type;
-            type = xhci_ring_fetch(xhci, ring, &xfer->trbs[i], NULL);
+            type = xhci_ring_fetch(xhci, ring, &xfer->trbs[i], NULL,
+                                   &trb_cache);
             if (!type) {
                 xhci_die(xhci);
                 xhci_ep_free_xfer(xfer);
@@ -2483,7 +2536,8 @@ static void xhci_process_commands(XHCIState *xhci)
 
     xhci->crcr_low |= CRCR_CRR;
 
-    while ((type = xhci_ring_fetch(xhci, &xhci->cmd_ring, &trb, &addr))) {
+    while ((type = xhci_ring_fetch(xhci, &xhci->cmd_ring, &trb, &addr,
+                                   NULL))) {
         event.ptr = addr;
         switch (type) {
         case CR_ENABLE_SLOT:
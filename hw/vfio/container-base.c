@@ -18,6 +18,9 @@
 #include "system/ram_addr.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
 #include "hw/vfio/vfio-container-base.h"
 #include "hw/vfio/vfio-device.h" /* vfio_device_reset_handler */
 #include "system/reset.h"
@@ -73,9 +76,28 @@ void vfio_address_space_insert(VFIOAddressSpace *space,
     bcontainer->space = space;
 }
 
-int vfio_container_dma_map(VFIOContainerBase *bcontainer,
-                           hwaddr iova, ram_addr_t size,
-                           void *vaddr, bool readonly, MemoryRegion *mr)
+/*
+ * Ranges at least this large are split into chunks that are pinned and
+ * mapped by several threads at once, on backends that allow it.
+ */
+#define VFIO_DMA_MAP_PARALLEL_MIN   (16 * GiB)
+#define VFIO_DMA_MAP_CHUNK_ALIGN    (1 * GiB)
+#define VFIO_DMA_MAP_MAX_THREADS    16
+
+typedef struct VFIODMAMapChunk {
+    VFIOContainerBase *bcontainer;
+    hwaddr iova;
+    ram_addr_t size;
+    void *vaddr;
+    bool readonly;
+    MemoryRegion *mr;
+    int ret;
+} VFIODMAMapChunk;
+
+static int vfio_container_dma_map_one(VFIOContainerBase *bcontainer,
+                                      hwaddr iova, ram_addr_t size,
+                                      void *vaddr, bool readonly,
+                                      MemoryRegion *mr)
 {
     VFIOIOMMUClass *vioc = VFIO_IOMMU_GET_CLASS(bcontainer);
     RAMBlock *rb = mr->ram_block;
@@ -92,6 +114,88 @@ int vfio_container_dma_map(VFIOContainerBase *bcontainer,
     return vioc->dma_map(bcontainer, iova, size, vaddr, readonly, mr);
 }
 
+static void *vfio_container_dma_map_thread(void *opaque)
+{
+    VFIODMAMapChunk *c = opaque;
+
+    c->ret = vfio_container_dma_map_one(c->bcontainer, c->iova, c->size,
+                                        c->vaddr, c->readonly, c->mr);
+    return NULL;
+}
+
+static int vfio_container_dma_map_parallel(VFIOContainerBase *bcontainer,
+                                           hwaddr iova, ram_addr_t size,
+                                           void *vaddr, bool readonly,
+                                           MemoryRegion *mr, int nthreads)
+{
+    g_autofree VFIODMAMapChunk *chunks = g_new0(VFIODMAMapChunk, nthreads);
+    g_autofree QemuThread *threads = g_new0(QemuThread, nthreads);
+    ram_addr_t chunk_size = ROUND_UP(size / nthreads,
+                                     VFIO_DMA_MAP_CHUNK_ALIGN);
+    ram_addr_t offset = 0;
+    int64_t start = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    int i, n, ret = 0;
+
+    for (n = 0; n < nthreads && offset < size; n++) {
+        VFIODMAMapChunk *c = &chunks[n];
+
+        c->bcontainer = bcontainer;
+        c->iova = iova + offset;
+        c->size = MIN(chunk_size, size - offset);
+        c->vaddr = vaddr + offset;
+        c->readonly = readonly;
+        c->mr = mr;
+        offset += c->size;
+
+        qemu_thread_create(&threads[n], "vfio-dma-map",
+                           vfio_container_dma_map_thread, c,
+                           QEMU_THREAD_JOINABLE);
+    }
+
+    for (i = 0; i < n; i++) {
+        qemu_thread_join(&threads[i]);
+        if (chunks[i].ret && !ret) {
+            ret = chunks[i].ret;
+        }
+    }
+
+    trace_vfio_container_dma_map_parallel(iova, size, n,
+        qemu_clock_get_ms(QEMU_CLOCK_REALTIME) - start, ret);
+
+    if (ret) {
+        /* Do not leave the chunks that did succeed behind */
+        for (i = 0; i < n; i++) {
+            if (!chunks[i].ret) {
+                vfio_container_dma_unmap(bcontainer, chunks[i].iova,
+                                         chunks[i].size, NULL, false);
+            }
+        }
+    }
+    return ret;
+}
+
+int vfio_container_dma_map(VFIOContainerBase *bcontainer,
+                           hwaddr iova, ram_addr_t size,
+                           void *vaddr, bool readonly, MemoryRegion *mr)
+{
+    VFIOIOMMUClass *vioc = VFIO_IOMMU_GET_CLASS(bcontainer);
+
+    if (vioc->dma_map_parallel && size >= VFIO_DMA_MAP_PARALLEL_MIN &&
+        QEMU_IS_ALIGNED(iova | size, VFIO_DMA_MAP_CHUNK_ALIGN)) {
+        long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+        int nthreads = MIN(MIN(nprocs, VFIO_DMA_MAP_MAX_THREADS),
+                           size / VFIO_DMA_MAP_CHUNK_ALIGN);
+
+        if (nthreads > 1) {
+            return vfio_container_dma_map_parallel(bcontainer, iova, size,
+                                                   vaddr, readonly, mr,
+                                                   nthreads);
+        }
+    }
+    return vfio_container_dma_map_one(bcontainer, iova, size, vaddr,
+                                      readonly, mr);
+}
+
 int vfio_container_dma_unmap(VFIOContainerBase *bcontainer,
                              hwaddr iova, ram_addr_t size,
                              IOMMUTLBEntry *iotlb, bool unmap_all)
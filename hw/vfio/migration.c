@@ -12,6 +12,7 @@
 #include "qemu/cutils.h"
 #include "qemu/units.h"
 #include "qemu/error-report.h"
+#include "qemu/timer.h"
 #include <linux/vfio.h>
 #include <sys/ioctl.h>
 
@@ -324,25 +325,73 @@ static int vfio_query_stop_copy_size(VFIODevice *vbasedev,
     return 0;
 }
 
+/*
+ * Whatever the device reports as dirty on top of what is left from the
+ * previous query was dirtied in between.  Keep a running average of that
+ * rate, so that estimates made between queries account for it.
+ */
+static void vfio_update_precopy_dirty_rate(VFIOMigration *migration,
+                                           uint64_t dirty_bytes, int64_t now)
+{
+    int64_t elapsed = now - migration->precopy_query_time;
+    uint64_t dirtied, rate;
+
+    if (!migration->precopy_query_time || elapsed <= 0) {
+        return;
+    }
+
+    dirtied = dirty_bytes - MIN(dirty_bytes, migration->precopy_dirty_size);
+    rate = dirtied * 1000 / elapsed;
+    if (migration->precopy_dirty_rate) {
+        rate = (migration->precopy_dirty_rate + rate) / 2;
+    }
+    migration->precopy_dirty_rate = rate;
+
+    trace_vfio_update_precopy_dirty_rate(migration->vbasedev->name, dirtied,
+                                         elapsed, rate);
+}
+
 static int vfio_query_precopy_size(VFIOMigration *migration)
 {
     struct vfio_precopy_info precopy = {
         .argsz = sizeof(precopy),
     };
-
-    migration->precopy_init_size = 0;
-    migration->precopy_dirty_size = 0;
+    int64_t now = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 
     if (ioctl(migration->data_fd, VFIO_MIG_GET_PRECOPY_INFO, &precopy)) {
+        migration->precopy_init_size = 0;
+        migration->precopy_dirty_size = 0;
+        migration->precopy_query_time = 0;
         return -errno;
     }
 
+    vfio_update_precopy_dirty_rate(migration, precopy.dirty_bytes, now);
+
     migration->precopy_init_size = precopy.initial_bytes;
     migration->precopy_dirty_size = precopy.dirty_bytes;
+    migration->precopy_query_time = now;
 
     return 0;
 }
 
+/*
+ * The device keeps dirtying its state after precopy_dirty_size was
+ * queried; project what it added since at the measured rate.
+ */
+static uint64_t vfio_precopy_dirty_projection(VFIOMigration *migration)
+{
+    int64_t elapsed;
+
+    if (!migration->precopy_query_time) {
+        return 0;
+    }
+
+    elapsed = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) -
+              migration->precopy_query_time;
+
+    return elapsed > 0 ? migration->precopy_dirty_rate * elapsed / 1000 : 0;
+}
+
 /* Returns the size of saved data on success and -errno on error */
 static ssize_t vfio_save_block(QEMUFile *f, VFIOMigration *migration)
 {
@@ -392,6 +441,7 @@ static void vfio_update_estimated_pending_data(VFIOMigration *migration,
          */
         migration->precopy_init_size = 0;
         migration->precopy_dirty_size = 0;
+        migration->precopy_query_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 
         return;
     }
@@ -533,6 +583,8 @@ static void vfio_save_cleanup(void *opaque)
     migration->data_buffer = NULL;
     migration->precopy_init_size = 0;
     migration->precopy_dirty_size = 0;
+    migration->precopy_dirty_rate = 0;
+    migration->precopy_query_time = 0;
     migration->initial_data_sent = false;
     vfio_migration_cleanup(vbasedev);
     trace_vfio_save_cleanup(vbasedev->name);
@@ -543,18 +595,21 @@ static void vfio_state_pending_estimate(void *opaque, uint64_t *must_precopy,
 {
     VFIODevice *vbasedev = opaque;
     VFIOMigration *migration = vbasedev->migration;
+    uint64_t projected;
 
     if (!vfio_device_state_is_precopy(vbasedev)) {
         return;
     }
 
-    *must_precopy +=
-        migration->precopy_init_size + migration->precopy_dirty_size;
+    projected = vfio_precopy_dirty_projection(migration);
+    *must_precopy += migration->precopy_init_size +
+                     migration->precopy_dirty_size + projected;
 
     trace_vfio_state_pending_estimate(vbasedev->name, *must_precopy,
                                       *can_postcopy,
                                       migration->precopy_init_size,
-                                      migration->precopy_dirty_size);
+                                      migration->precopy_dirty_size,
+                                      projected);
 }
 
 /*
@@ -47,6 +47,10 @@ typedef struct VFIOMigration {
     uint64_t mig_flags;
     uint64_t precopy_init_size;
     uint64_t precopy_dirty_size;
+    /* Rate at which the device dirties precopy data, in bytes per second */
+    uint64_t precopy_dirty_rate;
+    /* When precopy_init_size and precopy_dirty_size were last queried */
+    int64_t precopy_query_time;
     bool multifd_transfer;
     VFIOMultifd *multifd;
     bool initial_data_sent;
@@ -236,7 +236,11 @@ static bool vhost_svq_add_split(VhostShadowVirtqueue *svq,
     return true;
 }
 
-static void vhost_svq_kick(VhostShadowVirtqueue *svq)
+/*
+ * Kick the device if it asked to be notified for any of the avail entries
+ * exposed since @old_avail_idx.
+ */
+static void vhost_svq_kick(VhostShadowVirtqueue *svq, uint16_t old_avail_idx)
 {
     bool needs_kick;
 
@@ -249,7 +253,8 @@ static void vhost_svq_kick(VhostShadowVirtqueue *svq)
     if (virtio_vdev_has_feature(svq->vdev, VIRTIO_RING_F_EVENT_IDX)) {
         uint16_t avail_event = le16_to_cpu(
                 *(uint16_t *)(&svq->vring.used->ring[svq->vring.num]));
-        needs_kick = vring_need_event(avail_event, svq->shadow_avail_idx, svq->shadow_avail_idx - 1);
+        needs_kick = vring_need_event(avail_event, svq->shadow_avail_idx,
+                                      old_avail_idx);
     } else {
         needs_kick =
                 !(svq->vring.used->flags & cpu_to_le16(VRING_USED_F_NO_NOTIFY));
@@ -289,10 +294,26 @@ int vhost_svq_add(VhostShadowVirtqueue *svq, const struct iovec *out_sg,
     svq->num_free -= ndescs;
     svq->desc_state[qemu_head].elem = elem;
     svq->desc_state[qemu_head].ndescs = ndescs;
-    vhost_svq_kick(svq);
+    if (!svq->kick_deferred) {
+        vhost_svq_kick(svq, svq->shadow_avail_idx - 1);
+    }
     return 0;
 }
 
+static void vhost_svq_kick_begin(VhostShadowVirtqueue *svq)
+{
+    svq->kick_deferred = true;
+    svq->kick_avail_idx = svq->shadow_avail_idx;
+}
+
+static void vhost_svq_kick_end(VhostShadowVirtqueue *svq)
+{
+    svq->kick_deferred = false;
+    if (svq->shadow_avail_idx != svq->kick_avail_idx) {
+        vhost_svq_kick(svq, svq->kick_avail_idx);
+    }
+}
+
 /* Convenience wrapper to add a guest's element to SVQ */
 static int vhost_svq_add_element(VhostShadowVirtqueue *svq,
                                  VirtQueueElement *elem)
@@ -319,7 +340,14 @@ static void vhost_handle_guest_kick(VhostShadowVirtqueue *svq)
     /* Clear event notifier */
     event_notifier_test_and_clear(&svq->svq_kick);
 
-    /* Forward to the device as many available buffers as possible */
+    /*
+     * Forward to the device as many available buffers as possible.  Unless
+     * the caller's avail_handler needs to see its buffers used right away,
+     * kick the device once per burst instead of once per buffer.
+     */
+    if (!svq->ops) {
+        vhost_svq_kick_begin(svq);
+    }
     do {
         virtio_queue_set_notification(svq->vq, false);
 
@@ -359,7 +387,7 @@ static void vhost_handle_guest_kick(VhostShadowVirtqueue *svq)
                 }
 
                 /* VQ is full or broken, just return and ignore kicks */
-                return;
+                goto out;
             }
             /* elem belongs to SVQ or external caller now */
             elem = NULL;
@@ -367,6 +395,11 @@ static void vhost_handle_guest_kick(VhostShadowVirtqueue *svq)
 
         virtio_queue_set_notification(svq->vq, true);
     } while (!virtio_queue_empty(svq->vq));
+
+out:
+    if (!svq->ops) {
+        vhost_svq_kick_end(svq);
+    }
 }
 
 /**
@@ -525,7 +558,9 @@ static void vhost_svq_flush(VhostShadowVirtqueue *svq,
         }
 
         virtqueue_flush(vq, i);
-        event_notifier_set(&svq->svq_call);
+        if (i) {
+            event_notifier_set(&svq->svq_call);
+        }
 
         if (check_for_avail_queue && svq->next_guest_avail_elem) {
             /*
@@ -687,6 +722,7 @@ void vhost_svq_start(VhostShadowVirtqueue *svq, VirtIODevice *vdev,
     event_notifier_set_handler(&svq->hdev_call, vhost_svq_handle_call);
     svq->next_guest_avail_elem = NULL;
     svq->shadow_avail_idx = 0;
+    svq->kick_deferred = false;
     svq->shadow_used_idx = 0;
     svq->last_used_idx = 0;
     svq->vdev = vdev;
@@ -99,6 +99,13 @@ typedef struct VhostShadowVirtqueue {
     /* Next head to expose to the device */
     uint16_t shadow_avail_idx;
 
+    /*
+     * While forwarding a burst of guest buffers, shadow_avail_idx at the
+     * start of the burst; the device is kicked once when it ends.
+     */
+    bool kick_deferred;
+    uint16_t kick_avail_idx;
+
     /* Next free descriptor */
     uint16_t free_head;
 
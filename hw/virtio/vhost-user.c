@@ -360,6 +360,31 @@ static int process_message_reply(struct vhost_dev *dev,
     return msg_reply.payload.u64 ? -EIO : 0;
 }
 
+/*
+ * Collect the acks for @count pipelined @request messages.  All replies
+ * are read even after a failure so that the channel stays in sync.
+ */
+static int process_message_replies(struct vhost_dev *dev,
+                                   VhostUserRequest request, int count)
+{
+    VhostUserMsg msg = {
+        .hdr.request = request,
+        .hdr.flags = VHOST_USER_NEED_REPLY_MASK,
+    };
+    int i, ret, first_err = 0;
+
+    for (i = 0; i < count; i++) {
+        ret = process_message_reply(dev, &msg);
+        if (ret == -EIO) {
+            first_err = first_err ?: ret;
+        } else if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return first_err;
+}
+
 static bool vhost_user_per_device_request(VhostUserRequest request)
 {
     switch (request) {
@@ -659,7 +684,7 @@ static void scrub_shadow_regions(struct vhost_dev *dev,
 static int send_remove_regions(struct vhost_dev *dev,
                                struct scrub_regions *remove_reg,
                                int nr_rem_reg, VhostUserMsg *msg,
-                               bool reply_supported)
+                               bool reply_supported, int *pending)
 {
     struct vhost_user *u = dev->opaque;
     struct vhost_memory_region *shadow_reg;
@@ -688,7 +713,9 @@ static int send_remove_regions(struct vhost_dev *dev,
                 return ret;
             }
 
-            if (reply_supported) {
+            if (pending) {
+                (*pending)++;
+            } else if (reply_supported) {
                 ret = process_message_reply(dev, msg);
                 if (ret) {
                     return ret;
@@ -697,8 +724,9 @@ static int send_remove_regions(struct vhost_dev *dev,
         }
 
         /*
-         * At this point we know the backend has unmapped the region. It is now
-         * safe to remove it from the shadow table.
+         * At this point we know the backend has unmapped the region (or, when
+         * pipelining, will have once the pending acks are collected). It is
+         * now safe to remove it from the shadow table.
          */
         memmove(&u->shadow_regions[shadow_reg_idx],
                 &u->shadow_regions[shadow_reg_idx + 1],
@@ -713,7 +741,8 @@ static int send_remove_regions(struct vhost_dev *dev,
 static int send_add_regions(struct vhost_dev *dev,
                             struct scrub_regions *add_reg, int nr_add_reg,
                             VhostUserMsg *msg, uint64_t *shadow_pcb,
-                            bool reply_supported, bool track_ramblocks)
+                            bool reply_supported, bool track_ramblocks,
+                            int *pending)
 {
     struct vhost_user *u = dev->opaque;
     int i, fd, ret, reg_idx, reg_fd_idx;
@@ -793,6 +822,8 @@ static int send_add_regions(struct vhost_dev *dev,
                                  dev->mem->regions[reg_idx].guest_phys_addr);
                     return -EPROTO;
                 }
+            } else if (pending) {
+                (*pending)++;
             } else if (reply_supported) {
                 ret = process_message_reply(dev, msg);
                 if (ret) {
@@ -832,6 +863,14 @@ static int vhost_user_add_remove_regions(struct vhost_dev *dev,
     struct scrub_regions rem_reg[VHOST_USER_MAX_RAM_SLOTS];
     uint64_t shadow_pcb[VHOST_USER_MAX_RAM_SLOTS] = {};
     int nr_add_reg, nr_rem_reg;
+    int rem_pending = 0, add_pending = 0;
+    /*
+     * The backend handles messages in order, so outside of postcopy (where
+     * each ADD_MEM_REG reply carries data we need) the acks can be
+     * collected after the whole batch has been sent instead of paying a
+     * round trip per region.
+     */
+    bool pipeline = reply_supported && !track_ramblocks;
     int ret;
 
     msg->hdr.size = sizeof(msg->payload.mem_reg);
@@ -840,9 +879,12 @@ static int vhost_user_add_remove_regions(struct vhost_dev *dev,
     scrub_shadow_regions(dev, add_reg, &nr_add_reg, rem_reg, &nr_rem_reg,
                          shadow_pcb, track_ramblocks);
 
+    trace_vhost_user_add_remove_regions(dev, nr_rem_reg, nr_add_reg, pipeline);
+
     if (nr_rem_reg) {
         ret = send_remove_regions(dev, rem_reg, nr_rem_reg, msg,
-                                  reply_supported);
+                                  reply_supported,
+                                  pipeline ? &rem_pending : NULL);
         if (ret < 0) {
             goto err;
         }
@@ -850,7 +892,21 @@ static int vhost_user_add_remove_regions(struct vhost_dev *dev,
 
     if (nr_add_reg) {
         ret = send_add_regions(dev, add_reg, nr_add_reg, msg, shadow_pcb,
-                               reply_supported, track_ramblocks);
+                               reply_supported, track_ramblocks,
+                               pipeline ? &add_pending : NULL);
+        if (ret < 0) {
+            goto err;
+        }
+    }
+
+    if (pipeline) {
+        ret = process_message_replies(dev, VHOST_USER_REM_MEM_REG,
+                                      rem_pending);
+        if (ret == 0 || ret == -EIO) {
+            int add_ret = process_message_replies(dev, VHOST_USER_ADD_MEM_REG,
+                                                  add_pending);
+            ret = ret ?: add_ret;
+        }
         if (ret < 0) {
             goto err;
         }
@@ -17,6 +17,7 @@
 #include "qapi/error.h"
 #include "hw/virtio/vhost.h"
 #include "qemu/atomic.h"
+#include "qemu/cutils.h"
 #include "qemu/range.h"
 #include "qemu/error-report.h"
 #include "qemu/memfd.h"
@@ -81,6 +82,21 @@ unsigned int vhost_get_free_memslots(void)
     return free;
 }
 
+/*
+ * Number of log chunks checked at once with buffer_is_zero() to skip
+ * clean stretches of the log; most of it is expected to be clean.
+ */
+#define VHOST_LOG_ZERO_SCAN_CHUNKS 64
+
+static void vhost_dev_set_dirty_run(MemoryRegionSection *section,
+                                    hwaddr page_addr, uint64_t npages)
+{
+    hwaddr section_offset = page_addr - section->offset_within_address_space;
+    hwaddr mr_offset = section_offset + section->offset_within_region;
+
+    memory_region_set_dirty(section->mr, mr_offset, npages * VHOST_LOG_PAGE);
+}
+
 static void vhost_dev_sync_region(struct vhost_dev *dev,
                                   MemoryRegionSection *section,
                                   uint64_t mfirst, uint64_t mlast,
@@ -93,6 +109,9 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
     vhost_log_chunk_t *from = dev_log + start / VHOST_LOG_CHUNK;
     vhost_log_chunk_t *to = dev_log + end / VHOST_LOG_CHUNK + 1;
     uint64_t addr = QEMU_ALIGN_DOWN(start, VHOST_LOG_CHUNK);
+    /* Dirty pages are reported in runs, which may span several chunks */
+    hwaddr run_addr = 0;
+    uint64_t run_pages = 0;
 
     if (end < start) {
         return;
@@ -100,11 +119,20 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
     assert(end / VHOST_LOG_CHUNK < dev->log_size);
     assert(start / VHOST_LOG_CHUNK < dev->log_size);
 
-    for (;from < to; ++from) {
+    while (from < to) {
         vhost_log_chunk_t log;
+
         /* We first check with non-atomic: much cheaper,
          * and we expect non-dirty to be the common case. */
+        if (to - from >= VHOST_LOG_ZERO_SCAN_CHUNKS &&
+            buffer_is_zero(from, VHOST_LOG_ZERO_SCAN_CHUNKS *
+                                 sizeof(vhost_log_chunk_t))) {
+            from += VHOST_LOG_ZERO_SCAN_CHUNKS;
+            addr += VHOST_LOG_ZERO_SCAN_CHUNKS * VHOST_LOG_CHUNK;
+            continue;
+        }
         if (!*from) {
+            from++;
             addr += VHOST_LOG_CHUNK;
             continue;
         }
@@ -113,17 +141,31 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
         log = qatomic_xchg(from, 0);
         while (log) {
             int bit = ctzl(log);
-            hwaddr page_addr;
-            hwaddr section_offset;
-            hwaddr mr_offset;
-            page_addr = addr + bit * VHOST_LOG_PAGE;
-            section_offset = page_addr - section->offset_within_address_space;
-            mr_offset = section_offset + section->offset_within_region;
-            memory_region_set_dirty(section->mr, mr_offset, VHOST_LOG_PAGE);
-            log &= ~(0x1ull << bit);
+            int nbits = ctol(log >> bit);
+            hwaddr page_addr = addr + bit * VHOST_LOG_PAGE;
+
+            if (run_pages &&
+                run_addr + run_pages * VHOST_LOG_PAGE == page_addr) {
+                run_pages += nbits;
+            } else {
+                if (run_pages) {
+                    vhost_dev_set_dirty_run(section, run_addr, run_pages);
+                }
+                run_addr = page_addr;
+                run_pages = nbits;
+            }
+            if (bit + nbits >= VHOST_LOG_BITS) {
+                break;
+            }
+            log &= ~(vhost_log_chunk_t)0 << (bit + nbits);
         }
+        from++;
         addr += VHOST_LOG_CHUNK;
     }
+
+    if (run_pages) {
+        vhost_dev_set_dirty_run(section, run_addr, run_pages);
+    }
 }
 
 bool vhost_dev_has_iommu(struct vhost_dev *dev)
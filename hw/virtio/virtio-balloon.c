@@ -509,11 +509,16 @@ static void virtio_balloon_handle_free_page_vq(VirtIODevice *vdev,
     qemu_bh_schedule(s->free_page_bh);
 }
 
+/* Maximum number of free page hint elements handled per batch */
+#define FREE_PAGE_HINT_BATCH 64
+
 static bool get_free_page_hints(VirtIOBalloon *dev)
 {
-    VirtQueueElement *elem;
+    VirtQueueElement *elems[FREE_PAGE_HINT_BATCH];
     VirtIODevice *vdev = VIRTIO_DEVICE(dev);
     VirtQueue *vq = dev->free_page_vq;
+    g_autoptr(GArray) hints = NULL;
+    unsigned int n, j;
     bool ret = true;
     int i;
 
@@ -521,44 +526,55 @@ static bool get_free_page_hints(VirtIOBalloon *dev)
         qemu_cond_wait(&dev->free_page_cond, &dev->free_page_lock);
     }
 
-    elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
-    if (!elem) {
+    n = virtqueue_pop_batch(vq, sizeof(VirtQueueElement), (void **)elems,
+                            FREE_PAGE_HINT_BATCH);
+    if (!n) {
         return false;
     }
 
-    if (elem->out_num) {
-        uint32_t id;
-        size_t size = iov_to_buf(elem->out_sg, elem->out_num, 0,
-                                 &id, sizeof(id));
+    hints = g_array_new(false, false, sizeof(struct iovec));
 
-        virtio_tswap32s(vdev, &id);
-        if (unlikely(size != sizeof(id))) {
-            virtio_error(vdev, "received an incorrect cmd id");
-            ret = false;
-            goto out;
-        }
-        if (dev->free_page_hint_status == FREE_PAGE_HINT_S_REQUESTED &&
-            id == dev->free_page_hint_cmd_id) {
-            dev->free_page_hint_status = FREE_PAGE_HINT_S_START;
-        } else if (dev->free_page_hint_status == FREE_PAGE_HINT_S_START) {
-            /*
-             * Stop the optimization only when it has started. This
-             * avoids a stale stop sign for the previous command.
-             */
-            dev->free_page_hint_status = FREE_PAGE_HINT_S_STOP;
+    for (j = 0; j < n; j++) {
+        VirtQueueElement *elem = elems[j];
+
+        if (elem->out_num) {
+            uint32_t id;
+            size_t size = iov_to_buf(elem->out_sg, elem->out_num, 0,
+                                     &id, sizeof(id));
+
+            virtio_tswap32s(vdev, &id);
+            if (unlikely(size != sizeof(id))) {
+                virtio_error(vdev, "received an incorrect cmd id");
+                ret = false;
+                break;
+            }
+            if (dev->free_page_hint_status == FREE_PAGE_HINT_S_REQUESTED &&
+                id == dev->free_page_hint_cmd_id) {
+                dev->free_page_hint_status = FREE_PAGE_HINT_S_START;
+            } else if (dev->free_page_hint_status == FREE_PAGE_HINT_S_START) {
+                /*
+                 * Stop the optimization only when it has started. This
+                 * avoids a stale stop sign for the previous command.
+                 */
+                dev->free_page_hint_status = FREE_PAGE_HINT_S_STOP;
+            }
         }
-    }
 
-    if (elem->in_num && dev->free_page_hint_status == FREE_PAGE_HINT_S_START) {
-        for (i = 0; i < elem->in_num; i++) {
-            qemu_guest_free_page_hint(elem->in_sg[i].iov_base,
-                                      elem->in_sg[i].iov_len);
+        if (elem->in_num &&
+            dev->free_page_hint_status == FREE_PAGE_HINT_S_START) {
+            for (i = 0; i < elem->in_num; i++) {
+                g_array_append_val(hints, elem->in_sg[i]);
+            }
         }
     }
 
-out:
-    virtqueue_push(vq, elem, 0);
-    g_free(elem);
+    /* The hinted buffers stay valid until the elements are pushed back */
+    qemu_guest_free_page_hints((struct iovec *)hints->data, hints->len);
+
+    virtqueue_push_batch(vq, elems, NULL, n);
+    for (j = 0; j < n; j++) {
+        g_free(elems[j]);
+    }
     return ret;
 }
 
@@ -662,7 +678,7 @@ virtio_balloon_free_page_hint_notify(NotifierWithReturn *n, void *data,
     }
 
     /*
-     * Pages hinted via qemu_guest_free_page_hint() are cleared from the dirty
+     * Pages hinted via qemu_guest_free_page_hints() are cleared from the dirty
      * bitmap and will not get migrated, especially also not when the postcopy
      * destination starts using them and requests migration from the source; the
      * faulting thread will stall until postcopy migration finishes and
@@ -249,6 +249,10 @@ void hmp_virtio_queue_status(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "  shadow_avail_idx:     %d\n",
                        s->shadow_avail_idx);
     }
+    monitor_printf(mon, "  map_cache_hits:       %"PRIu64"\n",
+                   s->map_cache_hits);
+    monitor_printf(mon, "  map_cache_misses:     %"PRIu64"\n",
+                   s->map_cache_misses);
     monitor_printf(mon, "  VRing:\n");
     monitor_printf(mon, "    num:          %"PRId32"\n", s->vring_num);
     monitor_printf(mon, "    num_default:  %"PRId32"\n",
@@ -69,6 +69,15 @@ typedef struct VirtIOIOMMUMapping {
     uint32_t flags;
 } VirtIOIOMMUMapping;
 
+typedef struct VirtIOIOMMUPendingNotif {
+    IOMMUMemoryRegion *mr;
+    IOMMUNotifierFlag type;
+    hwaddr virt_start;
+    hwaddr virt_end;
+    hwaddr paddr;
+    uint32_t flags;
+} VirtIOIOMMUPendingNotif;
+
 struct hiod_key {
     PCIBus *bus;
     uint8_t devfn;
@@ -276,6 +285,68 @@ static void virtio_iommu_notify_unmap(IOMMUMemoryRegion *mr, hwaddr virt_start,
     virtio_iommu_notify_map_unmap(mr, &event, virt_start, virt_end);
 }
 
+/*
+ * MAP and UNMAP requests from one virtqueue kick are not notified right
+ * away.  Instead they are queued, and unmapped ranges adjacent to the last
+ * one queued for the same memory region are merged, so that a guest
+ * unmapping page by page results in few notifications and thus few VFIO
+ * DMA unmap calls.  Maps are never merged: each one stays a separate
+ * mapping in domain->mappings, and a later unmap of only one of them
+ * could not be applied to a merged VFIO mapping.  The queue must be
+ * flushed before the guest can see the requests complete.
+ */
+static void virtio_iommu_queue_notify(VirtIOIOMMU *s, IOMMUMemoryRegion *mr,
+                                      IOMMUNotifierFlag type,
+                                      hwaddr virt_start, hwaddr virt_end,
+                                      hwaddr paddr, uint32_t flags)
+{
+    VirtIOIOMMUPendingNotif notif = {
+        .mr = mr,
+        .type = type,
+        .virt_start = virt_start,
+        .virt_end = virt_end,
+        .paddr = paddr,
+        .flags = flags,
+    };
+    guint i;
+
+    for (i = s->pending_notifs->len; i-- > 0;) {
+        VirtIOIOMMUPendingNotif *p =
+            &g_array_index(s->pending_notifs, VirtIOIOMMUPendingNotif, i);
+
+        if (p->mr != mr) {
+            continue;
+        }
+        if (type == IOMMU_NOTIFIER_UNMAP && p->type == type &&
+            p->virt_end + 1 == virt_start) {
+            p->virt_end = virt_end;
+            return;
+        }
+        break;
+    }
+
+    g_array_append_val(s->pending_notifs, notif);
+}
+
+/* Must be called with s->mutex held */
+static void virtio_iommu_flush_notifs(VirtIOIOMMU *s)
+{
+    guint i;
+
+    for (i = 0; i < s->pending_notifs->len; i++) {
+        VirtIOIOMMUPendingNotif *p =
+            &g_array_index(s->pending_notifs, VirtIOIOMMUPendingNotif, i);
+
+        if (p->type == IOMMU_NOTIFIER_MAP) {
+            virtio_iommu_notify_map(p->mr, p->virt_start, p->virt_end,
+                                    p->paddr, p->flags);
+        } else {
+            virtio_iommu_notify_unmap(p->mr, p->virt_start, p->virt_end);
+        }
+    }
+    g_array_set_size(s->pending_notifs, 0);
+}
+
 static gboolean virtio_iommu_notify_unmap_cb(gpointer key, gpointer value,
                                              gpointer data)
 {
@@ -837,8 +908,8 @@ static int virtio_iommu_map(VirtIOIOMMU *s,
     g_tree_insert(domain->mappings, interval, mapping);
 
     QLIST_FOREACH(ep, &domain->endpoint_list, next) {
-        virtio_iommu_notify_map(ep->iommu_mr, virt_start, virt_end, phys_start,
-                                flags);
+        virtio_iommu_queue_notify(s, ep->iommu_mr, IOMMU_NOTIFIER_MAP,
+                                  virt_start, virt_end, phys_start, flags);
     }
 
     return VIRTIO_IOMMU_S_OK;
@@ -877,8 +948,9 @@ static int virtio_iommu_unmap(VirtIOIOMMU *s,
 
         if (interval.low <= current_low && interval.high >= current_high) {
             QLIST_FOREACH(ep, &domain->endpoint_list, next) {
-                virtio_iommu_notify_unmap(ep->iommu_mr, current_low,
-                                          current_high);
+                virtio_iommu_queue_notify(s, ep->iommu_mr,
+                                          IOMMU_NOTIFIER_UNMAP,
+                                          current_low, current_high, 0, 0);
             }
             g_tree_remove(domain->mappings, iter_key);
             trace_virtio_iommu_unmap_done(domain_id, current_low, current_high);
@@ -1004,13 +1076,14 @@ static void virtio_iommu_handle_command(VirtIODevice *vdev, VirtQueue *vq)
     struct iovec *iov;
     void *buf = NULL;
     size_t sz;
+    unsigned int nr_done = 0;
 
     for (;;) {
         size_t output_size = sizeof(tail);
 
         elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
         if (!elem) {
-            return;
+            break;
         }
 
         if (iov_size(elem->in_sg, elem->in_num) < sizeof(tail) ||
@@ -1032,6 +1105,11 @@ static void virtio_iommu_handle_command(VirtIODevice *vdev, VirtQueue *vq)
             goto out;
         }
         qemu_rec_mutex_lock(&s->mutex);
+        if (head.type != VIRTIO_IOMMU_T_MAP &&
+            head.type != VIRTIO_IOMMU_T_UNMAP) {
+            /* Other requests may notify on their own; keep the order */
+            virtio_iommu_flush_notifs(s);
+        }
         switch (head.type) {
         case VIRTIO_IOMMU_T_ATTACH:
             tail.status = virtio_iommu_handle_attach(s, iov, iov_cnt);
@@ -1085,12 +1163,21 @@ out:
         }
         assert(sz == output_size);
 
-        virtqueue_push(vq, elem, sz);
-        virtio_notify(vdev, vq);
+        /* Completions become visible only once notifications are flushed */
+        virtqueue_fill(vq, elem, sz, nr_done++);
         g_free(elem);
         g_free(buf);
         buf = NULL;
     }
+
+    qemu_rec_mutex_lock(&s->mutex);
+    virtio_iommu_flush_notifs(s);
+    qemu_rec_mutex_unlock(&s->mutex);
+
+    if (nr_done) {
+        virtqueue_flush(vq, nr_done);
+        virtio_notify(vdev, vq);
+    }
 }
 
 static void virtio_iommu_report_fault(VirtIOIOMMU *viommu, uint8_t reason,
@@ -1464,6 +1551,8 @@ static void virtio_iommu_device_realize(DeviceState *dev, Error **errp)
 
     qemu_rec_mutex_init(&s->mutex);
 
+    s->pending_notifs = g_array_new(false, false,
+                                    sizeof(VirtIOIOMMUPendingNotif));
     s->as_by_busptr = g_hash_table_new_full(NULL, NULL, NULL, g_free);
 
     s->host_iommu_devices = g_hash_table_new_full(hiod_hash, hiod_equal,
@@ -1489,6 +1578,7 @@ static void virtio_iommu_device_unrealize(DeviceState *dev)
     qemu_unregister_reset(virtio_iommu_system_reset, s);
     qemu_remove_machine_init_done_notifier(&s->machine_done);
 
+    g_array_free(s->pending_notifs, true);
     g_hash_table_destroy(s->as_by_busptr);
     if (s->domains) {
         g_tree_destroy(s->domains);
@@ -563,6 +563,33 @@ static void virtio_mem_deactivate_unplugged_memslots(VirtIOMEM *vmem,
     memory_region_transaction_commit();
 }
 
+/*
+ * Below this size the cost of spawning preallocation threads outweighs the
+ * gain, so smaller ranges are preallocated from the calling thread.
+ */
+#define VIRTIO_MEM_PREALLOC_MT_MIN_SIZE (64 * MiB)
+
+/*
+ * Preallocate a range of the memory backend, using the preallocation threads
+ * and thread context configured on the memory backend for large ranges.
+ */
+static bool virtio_mem_prealloc_range(VirtIOMEM *vmem, uint64_t offset,
+                                      uint64_t size, Error **errp)
+{
+    HostMemoryBackend *backend = vmem->memdev;
+    void *area = memory_region_get_ram_ptr(&backend->mr) + offset;
+    int fd = memory_region_get_fd(&backend->mr);
+    int threads = 1;
+    ThreadContext *tc = NULL;
+
+    if (size >= VIRTIO_MEM_PREALLOC_MT_MIN_SIZE) {
+        threads = backend->prealloc_threads;
+        tc = backend->prealloc_context;
+    }
+
+    return qemu_prealloc_mem(fd, area, size, threads, tc, false, errp);
+}
+
 static int virtio_mem_set_block_state(VirtIOMEM *vmem, uint64_t start_gpa,
                                       uint64_t size, bool plug)
 {
@@ -588,11 +615,9 @@ static int virtio_mem_set_block_state(VirtIOMEM *vmem, uint64_t start_gpa,
     }
 
     if (vmem->prealloc) {
-        void *area = memory_region_get_ram_ptr(&vmem->memdev->mr) + offset;
-        int fd = memory_region_get_fd(&vmem->memdev->mr);
         Error *local_err = NULL;
 
-        if (!qemu_prealloc_mem(fd, area, size, 1, NULL, false, &local_err)) {
+        if (!virtio_mem_prealloc_range(vmem, offset, size, &local_err)) {
             static bool warned;
 
             /*
@@ -1249,11 +1274,9 @@ static int virtio_mem_post_load(void *opaque, int version_id)
 static int virtio_mem_prealloc_range_cb(VirtIOMEM *vmem, void *arg,
                                         uint64_t offset, uint64_t size)
 {
-    void *area = memory_region_get_ram_ptr(&vmem->memdev->mr) + offset;
-    int fd = memory_region_get_fd(&vmem->memdev->mr);
     Error *local_err = NULL;
 
-    if (!qemu_prealloc_mem(fd, area, size, 1, NULL, false, &local_err)) {
+    if (!virtio_mem_prealloc_range(vmem, offset, size, &local_err)) {
         error_report_err(local_err);
         return -ENOMEM;
     }
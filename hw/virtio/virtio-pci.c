@@ -831,6 +831,8 @@ static int kvm_virtio_pci_vq_vector_use(VirtIOPCIProxy *proxy,
         }
         kvm_irqchip_commit_route_changes(&c);
         irqfd->virq = ret;
+        /* The route was built from the vector's current message */
+        irqfd->msg = pci_get_msi_message(&proxy->pci_dev, vector);
     }
     irqfd->users++;
     return 0;
@@ -1001,6 +1003,7 @@ static int virtio_pci_one_vector_unmask(VirtIOPCIProxy *proxy,
                 return ret;
             }
             kvm_irqchip_commit_routes(kvm_state);
+            irqfd->msg = msg;
         }
     }
 
@@ -32,6 +32,7 @@
 #include "hw/virtio/virtio-access.h"
 #include "system/dma.h"
 #include "system/runstate.h"
+#include "system/xen.h"
 #include "virtio-qmp.h"
 
 #include "standard-headers/linux/virtio_ids.h"
@@ -117,6 +118,20 @@ typedef struct VRingPackedDescEvent {
     uint16_t flags;
 } VRingPackedDescEvent ;
 
+/*
+ * Last guest RAM section a descriptor was mapped from, so that the next
+ * descriptor landing in the same section skips the flatview walk.  Only
+ * used by the thread that pops from the queue; @gen is compared against
+ * VirtQueue::map_cache_gen, which memory topology changes bump.
+ */
+typedef struct VirtQueueMapCache {
+    unsigned int gen;
+    hwaddr gpa;
+    hwaddr size;
+    uint8_t *host;
+    MemoryRegion *mr;
+} VirtQueueMapCache;
+
 struct VirtQueue
 {
     VRing vring;
@@ -152,6 +167,12 @@ struct VirtQueue
     EventNotifier guest_notifier;
     EventNotifier host_notifier;
     bool host_notifier_enabled;
+
+    VirtQueueMapCache map_cache;
+    unsigned int map_cache_gen;
+    uint64_t map_cache_hits;
+    uint64_t map_cache_misses;
+
     QLIST_ENTRY(VirtQueue) node;
 };
 
@@ -1187,6 +1208,22 @@ void virtqueue_push(VirtQueue *vq, const VirtQueueElement *elem,
     virtqueue_flush(vq, 1);
 }
 
+void virtqueue_push_batch(VirtQueue *vq, VirtQueueElement *const *elems,
+                          const unsigned int *lens, unsigned int count)
+{
+    unsigned int i;
+
+    if (!count) {
+        return;
+    }
+
+    RCU_READ_LOCK_GUARD();
+    for (i = 0; i < count; i++) {
+        virtqueue_fill(vq, elems[i], lens ? lens[i] : 0, i);
+    }
+    virtqueue_flush(vq, count);
+}
+
 /* Called within rcu_read_lock().  */
 static int virtqueue_num_heads(VirtQueue *vq, unsigned int idx)
 {
@@ -1571,7 +1608,62 @@ int virtqueue_avail_bytes(VirtQueue *vq, unsigned int in_bytes,
     return in_bytes <= in_total && out_bytes <= out_total;
 }
 
-static bool virtqueue_map_desc(VirtIODevice *vdev, unsigned int *p_num_sg,
+/*
+ * Remember the part of the guest RAM section from @pa to its end, if it
+ * can be accessed directly in both directions.  A later miss lower in the
+ * same section simply refills the cache from there.
+ */
+static void virtqueue_map_cache_fill(VirtQueue *vq, hwaddr pa)
+{
+    VirtQueueMapCache *cache = &vq->map_cache;
+    MemoryRegionSection section;
+    MemoryRegion *mr;
+
+    cache->gen = qatomic_read(&vq->map_cache_gen);
+    cache->size = 0;
+
+    if (xen_enabled()) {
+        return;
+    }
+
+    section = memory_region_find(vq->vdev->dma_as->root, pa, UINT64_MAX - pa);
+    mr = section.mr;
+    if (!mr) {
+        return;
+    }
+    if (section.offset_within_address_space == pa && !section.readonly &&
+        memory_access_is_direct(mr, true, MEMTXATTRS_UNSPECIFIED)) {
+        cache->gpa = section.offset_within_address_space;
+        cache->size = int128_get64(section.size);
+        cache->host = (uint8_t *)memory_region_get_ram_ptr(mr) +
+                      section.offset_within_region;
+        cache->mr = mr;
+    }
+    memory_region_unref(mr);
+}
+
+/*
+ * Map @pa through the per-queue cache.  Returns NULL on a miss, in which
+ * case the caller falls back to dma_memory_map().
+ */
+static void *virtqueue_map_cached(VirtQueue *vq, hwaddr pa, hwaddr *plen)
+{
+    VirtQueueMapCache *cache = &vq->map_cache;
+    hwaddr offset = pa - cache->gpa;
+
+    if (cache->gen != qatomic_read(&vq->map_cache_gen) ||
+        offset >= cache->size) {
+        return NULL;
+    }
+
+    *plen = MIN(*plen, cache->size - offset);
+    memory_region_ref(cache->mr);
+    fuzz_dma_read_cb(pa, *plen, cache->mr);
+    return cache->host + offset;
+}
+
+static bool virtqueue_map_desc(VirtIODevice *vdev, VirtQueue *vq,
+                               unsigned int *p_num_sg,
                                hwaddr *addr, struct iovec *iov,
                                unsigned int max_num_sg, bool is_write,
                                hwaddr pa, size_t sz)
@@ -1594,14 +1686,22 @@ static bool virtqueue_map_desc(VirtIODevice *vdev, unsigned int *p_num_sg,
             goto out;
         }
 
-        iov[num_sg].iov_base = dma_memory_map(vdev->dma_as, pa, &len,
-                                              is_write ?
-                                              DMA_DIRECTION_FROM_DEVICE :
-                                              DMA_DIRECTION_TO_DEVICE,
-                                              MEMTXATTRS_UNSPECIFIED);
-        if (!iov[num_sg].iov_base) {
-            virtio_error(vdev, "virtio: bogus descriptor or out of resources");
-            goto out;
+        iov[num_sg].iov_base = virtqueue_map_cached(vq, pa, &len);
+        if (iov[num_sg].iov_base) {
+            vq->map_cache_hits++;
+        } else {
+            vq->map_cache_misses++;
+            iov[num_sg].iov_base = dma_memory_map(vdev->dma_as, pa, &len,
+                                                  is_write ?
+                                                  DMA_DIRECTION_FROM_DEVICE :
+                                                  DMA_DIRECTION_TO_DEVICE,
+                                                  MEMTXATTRS_UNSPECIFIED);
+            if (!iov[num_sg].iov_base) {
+                virtio_error(vdev,
+                             "virtio: bogus descriptor or out of resources");
+                goto out;
+            }
+            virtqueue_map_cache_fill(vq, pa);
         }
 
         iov[num_sg].iov_len = len;
@@ -1773,7 +1873,7 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
         bool map_ok;
 
         if (desc.flags & VRING_DESC_F_WRITE) {
-            map_ok = virtqueue_map_desc(vdev, &in_num, addr + out_num,
+            map_ok = virtqueue_map_desc(vdev, vq, &in_num, addr + out_num,
                                         iov + out_num,
                                         VIRTQUEUE_MAX_SIZE - out_num, true,
                                         desc.addr, desc.len);
@@ -1782,7 +1882,7 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
                 virtio_error(vdev, "Incorrect order for descriptors");
                 goto err_undo_map;
             }
-            map_ok = virtqueue_map_desc(vdev, &out_num, addr, iov,
+            map_ok = virtqueue_map_desc(vdev, vq, &out_num, addr, iov,
                                         VIRTQUEUE_MAX_SIZE, false,
                                         desc.addr, desc.len);
         }
@@ -1911,7 +2011,7 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
         bool map_ok;
 
         if (desc.flags & VRING_DESC_F_WRITE) {
-            map_ok = virtqueue_map_desc(vdev, &in_num, addr + out_num,
+            map_ok = virtqueue_map_desc(vdev, vq, &in_num, addr + out_num,
                                         iov + out_num,
                                         VIRTQUEUE_MAX_SIZE - out_num, true,
                                         desc.addr, desc.len);
@@ -1920,7 +2020,7 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
                 virtio_error(vdev, "Incorrect order for descriptors");
                 goto err_undo_map;
             }
-            map_ok = virtqueue_map_desc(vdev, &out_num, addr, iov,
+            map_ok = virtqueue_map_desc(vdev, vq, &out_num, addr, iov,
                                         VIRTQUEUE_MAX_SIZE, false,
                                         desc.addr, desc.len);
         }
@@ -1999,6 +2099,31 @@ void *virtqueue_pop(VirtQueue *vq, size_t sz)
     }
 }
 
+unsigned int virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems,
+                                 unsigned int max)
+{
+    unsigned int n = 0;
+    bool packed;
+
+    if (virtio_device_disabled(vq->vdev)) {
+        return 0;
+    }
+
+    packed = virtio_vdev_has_feature(vq->vdev, VIRTIO_F_RING_PACKED);
+
+    /* One outer read section so the nested ones in *_pop stay cheap */
+    RCU_READ_LOCK_GUARD();
+    while (n < max) {
+        void *elem = packed ? virtqueue_packed_pop(vq, sz)
+                            : virtqueue_split_pop(vq, sz);
+        if (!elem) {
+            break;
+        }
+        elems[n++] = elem;
+    }
+    return n;
+}
+
 static unsigned int virtqueue_packed_drop_all(VirtQueue *vq)
 {
     VRingMemoryRegionCaches *caches;
@@ -2544,6 +2669,7 @@ void virtio_delete_queue(VirtQueue *vq)
     g_free(vq->used_elems);
     vq->used_elems = NULL;
     virtio_virtqueue_reset_region_cache(vq);
+    vq->map_cache.size = 0;
 }
 
 void virtio_del_queue(VirtIODevice *vdev, int n)
@@ -2701,6 +2827,20 @@ void virtio_notify(VirtIODevice *vdev, VirtQueue *vq)
     virtio_irq(vq);
 }
 
+static void virtio_notify_deferred_fn(void *opaque)
+{
+    VirtQueue *vq = opaque;
+
+    trace_virtio_notify_deferred_fn(vq->vdev, vq);
+    virtio_notify(vq->vdev, vq);
+}
+
+void virtio_notify_deferred(VirtIODevice *vdev, VirtQueue *vq)
+{
+    assert(vq->vdev == vdev);
+    defer_call(virtio_notify_deferred_fn, vq);
+}
+
 void virtio_notify_config(VirtIODevice *vdev)
 {
     if (!(vdev->status & VIRTIO_CONFIG_S_DRIVER_OK))
@@ -3957,6 +4097,7 @@ static void virtio_memory_listener_commit(MemoryListener *listener)
             break;
         }
         virtio_init_region_cache(vdev, i);
+        qatomic_inc(&vdev->vq[i].map_cache_gen);
     }
 }
 
@@ -4222,6 +4363,8 @@ VirtQueueStatus *qmp_x_query_virtio_queue_status(const char *path,
     status->used_idx = vdev->vq[queue].used_idx;
     status->signalled_used = vdev->vq[queue].signalled_used;
     status->signalled_used_valid = vdev->vq[queue].signalled_used_valid;
+    status->map_cache_hits = vdev->vq[queue].map_cache_hits;
+    status->map_cache_misses = vdev->vq[queue].map_cache_misses;
 
     if (vdev->vhost_started) {
         VirtioDeviceClass *vdc = VIRTIO_DEVICE_GET_CLASS(vdev);
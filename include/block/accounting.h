@@ -25,6 +25,7 @@
 #ifndef BLOCK_ACCOUNTING_H
 #define BLOCK_ACCOUNTING_H
 
+#include "qemu/hdr-histogram.h"
 #include "qemu/timed-average.h"
 #include "qemu/thread.h"
 #include "qapi/qapi-types-common.h"
@@ -92,11 +93,20 @@ struct BlockAcctStats {
     bool account_invalid;
     bool account_failed;
     BlockLatencyHistogram latency_histogram[BLOCK_MAX_IOTYPE];
+
+    /*
+     * Always enabled, unlike latency_histogram.  Allocated on the first
+     * request of each type, so that unused BlockBackends stay small.
+     */
+    HdrHistogram *latency_percentiles[BLOCK_MAX_IOTYPE];
+    HdrHistogram *queue_depth_percentiles;
+    unsigned in_flight; /* accessed with atomic ops */
 };
 
 typedef struct BlockAcctCookie {
     int64_t bytes;
     int64_t start_time_ns;
+    unsigned queue_depth; /* requests in flight at submission, incl. this */
     enum BlockAcctType type;
 } BlockAcctCookie;
 
@@ -111,6 +121,7 @@ void block_acct_start(BlockAcctStats *stats, BlockAcctCookie *cookie,
                       int64_t bytes, enum BlockAcctType type);
 void block_acct_done(BlockAcctStats *stats, BlockAcctCookie *cookie);
 void block_acct_failed(BlockAcctStats *stats, BlockAcctCookie *cookie);
+void block_acct_cancel(BlockAcctStats *stats, BlockAcctCookie *cookie);
 void block_acct_invalid(BlockAcctStats *stats, enum BlockAcctType type);
 void block_acct_merge_done(BlockAcctStats *stats, enum BlockAcctType type,
                            int num_requests);
@@ -120,5 +131,9 @@ double block_acct_queue_depth(BlockAcctTimedStats *stats,
 int block_latency_histogram_set(BlockAcctStats *stats, enum BlockAcctType type,
                                 uint64List *boundaries);
 void block_latency_histograms_clear(BlockAcctStats *stats);
+bool block_acct_latency_percentiles(BlockAcctStats *stats,
+                                    enum BlockAcctType type, HdrHistogram *h);
+bool block_acct_queue_depth_percentiles(BlockAcctStats *stats,
+                                        HdrHistogram *h);
 
 #endif
@@ -21,6 +21,7 @@
 #include "qemu/queue.h"
 #include "qemu/event_notifier.h"
 #include "qemu/lockcnt.h"
+#include "qemu/stats64.h"
 #include "qemu/thread.h"
 #include "qemu/timer.h"
 #include "block/graph-lock.h"
@@ -127,6 +128,26 @@ typedef struct AioPolledEvent {
     int64_t ns;        /* current polling time in nanoseconds */
 } AioPolledEvent;
 
+/*
+ * Parameters for the io_uring instances of an AioContext, used by the
+ * fd monitoring ring and by the block I/O ring.
+ */
+typedef struct AioIoUringParams {
+    unsigned int queue_depth;   /* block I/O ring size, 0 for the default */
+    bool sqpoll;                /* submit from a kernel thread */
+    int sqpoll_cpu;             /* CPU of the kernel thread, -1 for any */
+    unsigned int sqpoll_idle;   /* kernel thread idle ms, 0 for default */
+    bool iopoll;                /* busy-poll block I/O completions */
+} AioIoUringParams;
+
+typedef struct AioContextStats {
+    Stat64 poll_ns;     /* busy-polling in userspace */
+    Stat64 wait_ns;     /* blocked in fdmon_ops->wait() */
+    Stat64 bh_ns;       /* running bottom halves */
+    Stat64 handler_ns;  /* dispatching fd handlers */
+    Stat64 timer_ns;    /* running timers */
+} AioContextStats;
+
 struct AioContext {
     GSource source;
 
@@ -219,6 +240,9 @@ struct AioContext {
 #ifdef CONFIG_LINUX_IO_URING
     LuringState *linux_io_uring;
 
+    /* Ring with big SQEs for NVMe passthrough, only set up when used */
+    LuringState *linux_io_uring_cmd;
+
     /* State for file descriptor monitoring using Linux io_uring */
     struct io_uring fdmon_io_uring;
     AioHandlerSList submit_list;
@@ -240,6 +264,16 @@ struct AioContext {
     /* AIO engine parameters */
     int64_t aio_max_batch;  /* maximum number of requests in a batch */
 
+    /*
+     * Time spent in each phase of aio_poll(), in nanoseconds.  Only
+     * collected while stats_enabled is set.
+     */
+    bool stats_enabled;
+    AioContextStats stats;
+
+    /* Applied when the io_uring instances are created */
+    AioIoUringParams io_uring_params;
+
     /*
      * List of handlers participating in userspace polling.  Protected by
      * ctx->list_lock.  Iterated and modified mostly by the event loop thread
@@ -517,6 +551,12 @@ LuringState *aio_setup_linux_io_uring(AioContext *ctx, Error **errp);
 
 /* Return the LuringState bound to this AioContext */
 LuringState *aio_get_linux_io_uring(AioContext *ctx);
+
+/* Setup the LuringState for NVMe passthrough bound to this AioContext */
+LuringState *aio_setup_linux_io_uring_cmd(AioContext *ctx, Error **errp);
+
+/* Return the LuringState for NVMe passthrough bound to this AioContext */
+LuringState *aio_get_linux_io_uring_cmd(AioContext *ctx);
 /**
  * aio_timer_new_with_attrs:
  * @ctx: the aio context
@@ -716,6 +756,19 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
  */
 void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch);
 
+/**
+ * aio_context_set_io_uring_params:
+ * @ctx: the aio context
+ * @params: new io_uring parameters
+ *
+ * The fd monitoring ring is recreated with the new parameters, so this must
+ * be called before the AioContext is used by its home thread.  Fails if the
+ * block I/O ring has already been created.
+ */
+void aio_context_set_io_uring_params(AioContext *ctx,
+                                     const AioIoUringParams *params,
+                                     Error **errp);
+
 /**
  * aio_context_set_thread_pool_params:
  * @ctx: the aio context
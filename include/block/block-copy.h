@@ -17,6 +17,7 @@
 
 #include "block/block-common.h"
 #include "qemu/progress_meter.h"
+#include "qemu/ratelimit.h"
 
 /* All APIs are thread-safe */
 
@@ -83,6 +84,7 @@ bool block_copy_call_cancelled(BlockCopyCallState *call_state);
 int block_copy_call_status(BlockCopyCallState *call_state, bool *error_is_read);
 
 void block_copy_set_speed(BlockCopyState *s, uint64_t speed);
+void block_copy_set_shared_ratelimit(BlockCopyState *s, RateLimit *limit);
 void block_copy_kick(BlockCopyCallState *call_state);
 
 /*
@@ -101,4 +103,20 @@ BdrvDirtyBitmap *block_copy_dirty_bitmap(BlockCopyState *s);
 int64_t block_copy_cluster_size(BlockCopyState *s);
 void block_copy_set_skip_unallocated(BlockCopyState *s, bool skip);
 
+/*
+ * Let block-copy adapt the chunk size and the number of parallel tasks to
+ * the measured throughput and latency, within @max_workers and @max_chunk
+ * (zero means unlimited).  The limits passed to block_copy_async() still
+ * apply.  Function should be called prior any actual copy request.
+ */
+void block_copy_set_auto_tune(BlockCopyState *s, int max_workers,
+                              int64_t max_chunk);
+
+/*
+ * Return the chunk size and number of workers currently chosen by
+ * auto-tuning, or false if it is disabled.
+ */
+bool block_copy_get_auto_tune(BlockCopyState *s, int64_t *chunk,
+                              int *workers);
+
 #endif /* BLOCK_COPY_H */
@@ -175,6 +175,24 @@ bool block_job_has_bdrv(BlockJob *job, BlockDriverState *bs);
  */
 bool block_job_set_speed_locked(BlockJob *job, int64_t speed, Error **errp);
 
+/**
+ * block_job_set_total_speed:
+ * @speed: The new value, 0 for unlimited
+ * @errp: Error object.
+ *
+ * Set a rate limit that applies to the sum of all block jobs, on top
+ * of their own speed.
+ */
+bool block_job_set_total_speed(int64_t speed, Error **errp);
+
+/**
+ * block_job_total_ratelimit:
+ *
+ * Return the rate limit shared by all block jobs, for jobs that do
+ * their own rate limiting.
+ */
+RateLimit *block_job_total_ratelimit(void);
+
 /**
  * block_job_change_locked:
  * @job: The job to change.
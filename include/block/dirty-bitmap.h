@@ -22,6 +22,10 @@ BdrvDirtyBitmap *bdrv_create_dirty_bitmap(BlockDriverState *bs,
                                           uint32_t granularity,
                                           const char *name,
                                           Error **errp);
+BdrvDirtyBitmap *bdrv_create_compressed_dirty_bitmap(BlockDriverState *bs,
+                                                     uint32_t granularity,
+                                                     const char *name,
+                                                     Error **errp);
 int bdrv_dirty_bitmap_create_successor(BdrvDirtyBitmap *bitmap,
                                        Error **errp);
 BdrvDirtyBitmap *bdrv_dirty_bitmap_abdicate(BdrvDirtyBitmap *bitmap,
@@ -82,6 +86,10 @@ void bdrv_dirty_bitmap_deserialize_finish(BdrvDirtyBitmap *bitmap);
 void bdrv_dirty_bitmap_set_readonly(BdrvDirtyBitmap *bitmap, bool value);
 void bdrv_dirty_bitmap_set_persistence(BdrvDirtyBitmap *bitmap,
                                        bool persistent);
+void bdrv_dirty_bitmap_create_meta(BdrvDirtyBitmap *bitmap,
+                                   uint64_t chunk_size);
+void bdrv_dirty_bitmap_release_meta(BdrvDirtyBitmap *bitmap);
+void bdrv_dirty_bitmap_reset_meta(BdrvDirtyBitmap *bitmap);
 void bdrv_dirty_bitmap_set_inconsistent(BdrvDirtyBitmap *bitmap);
 void bdrv_dirty_bitmap_set_busy(BdrvDirtyBitmap *bitmap, bool busy);
 bool bdrv_merge_dirty_bitmap(BdrvDirtyBitmap *dest, const BdrvDirtyBitmap *src,
@@ -106,6 +114,10 @@ bool bdrv_has_readonly_bitmaps(BlockDriverState *bs);
 bool bdrv_has_named_bitmaps(BlockDriverState *bs);
 bool bdrv_dirty_bitmap_get_autoload(const BdrvDirtyBitmap *bitmap);
 bool bdrv_dirty_bitmap_get_persistence(BdrvDirtyBitmap *bitmap);
+bool bdrv_dirty_bitmap_compressed(BdrvDirtyBitmap *bitmap);
+bool bdrv_dirty_bitmap_has_meta(BdrvDirtyBitmap *bitmap);
+int64_t bdrv_dirty_bitmap_meta_next_dirty(BdrvDirtyBitmap *bitmap,
+                                          int64_t offset);
 bool bdrv_dirty_bitmap_inconsistent(const BdrvDirtyBitmap *bitmap);
 
 BdrvDirtyBitmap *bdrv_dirty_bitmap_first(BlockDriverState *bs);
@@ -74,16 +74,53 @@ static inline bool laio_has_fua(void)
 #endif
 /* io_uring.c - Linux io_uring implementation */
 #ifdef CONFIG_LINUX_IO_URING
-LuringState *luring_init(Error **errp);
+/*
+ * luring_init: create a ring for block I/O.  With @uring_cmd, the ring uses
+ * big SQEs and CQEs and only carries NVMe passthrough commands.
+ */
+LuringState *luring_init(const AioIoUringParams *params, bool uring_cmd,
+                         Error **errp);
 void luring_cleanup(LuringState *s);
 
-/* luring_co_submit: submit I/O requests in the thread's current AioContext. */
+/*
+ * luring_co_submit: submit I/O requests in the thread's current AioContext.
+ * @fixed_file: use the io_uring registered file table for @fd.  Callers must
+ * call luring_unregister_fd() before closing @fd.
+ */
 int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, uint64_t offset,
                                   QEMUIOVector *qiov, int type,
-                                  BdrvRequestFlags flags);
+                                  BdrvRequestFlags flags, bool fixed_file);
 void luring_detach_aio_context(LuringState *s, AioContext *old_context);
 void luring_attach_aio_context(LuringState *s, AioContext *new_context);
 bool luring_has_fua(void);
+
+/*
+ * luring_has_iopoll: whether the current AioContext's ring only completes
+ * O_DIRECT reads and writes, see AioIoUringParams.iopoll.
+ */
+bool luring_has_iopoll(void);
+
+/*
+ * Make memory available as io_uring registered buffers for requests with
+ * BDRV_REQ_REGISTERED_BUF.  Registrations are reference counted.
+ */
+void luring_register_buf(void *host, size_t size);
+void luring_unregister_buf(void *host, size_t size);
+void luring_unregister_fd(int fd);
+
+#ifdef HAVE_IO_URING_CMD
+/*
+ * luring_co_submit_nvme: submit a read, write or flush as an NVMe command to
+ * the NVMe generic character device @fd, namespace @nsid.  Requests must be
+ * aligned to the LBA size (1 << @lba_shift).  The caller must have set up
+ * the current AioContext's passthrough ring with
+ * aio_setup_linux_io_uring_cmd().
+ */
+int coroutine_fn luring_co_submit_nvme(BlockDriverState *bs, int fd,
+                                       uint32_t nsid, unsigned int lba_shift,
+                                       uint64_t offset, QEMUIOVector *qiov,
+                                       int type, BdrvRequestFlags flags);
+#endif
 #else
 static inline bool luring_has_fua(void)
 {
@@ -49,12 +49,19 @@ typedef struct ThrottleGroupMember {
      */
     unsigned int restart_pending;
 
+    /* Budget for requests that can skip the ThrottleGroup lock, one for
+     * each direction.  The upper bits hold the number of operations, the
+     * lower bits the number of bytes.  Accessed with atomic operations.
+     */
+    uint64_t budget[THROTTLE_MAX];
+
     /* The following fields are protected by the ThrottleGroup lock.
      * See the ThrottleGroup documentation for details.
      * throttle_state tells us if I/O limits are configured. */
     ThrottleState *throttle_state;
     ThrottleTimers throttle_timers;
     unsigned       pending_reqs[THROTTLE_MAX];
+    bool           budget_granted[THROTTLE_MAX];
     QLIST_ENTRY(ThrottleGroupMember) round_robin;
 
 } ThrottleGroupMember;
@@ -33,6 +33,10 @@ struct FDChardev {
 
     QIOChannel *ioc_in, *ioc_out;
     int max_size;
+
+    /* Pending output, flushed by flush_bh; only set if buffered */
+    GByteArray *out_buf;
+    QEMUBH *flush_bh;
 };
 typedef struct FDChardev FDChardev;
 
@@ -42,6 +46,7 @@ DECLARE_INSTANCE_CHECKER(FDChardev, FD_CHARDEV,
                          TYPE_CHARDEV_FD)
 
 void qemu_chr_open_fd(Chardev *chr, int fd_in, int fd_out);
+void qemu_chr_fd_set_buffered(Chardev *chr);
 int qmp_chardev_open_file_source(char *src, int flags, Error **errp);
 
 #endif /* CHAR_FD_H */
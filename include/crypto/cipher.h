@@ -235,4 +235,52 @@ int qcrypto_cipher_setiv(QCryptoCipher *cipher,
                          const uint8_t *iv, size_t niv,
                          Error **errp);
 
+/**
+ * qcrypto_cipher_encrypt_sectors:
+ * @cipher: the cipher object
+ * @ivs: the initialization vectors, @niv bytes for each sector
+ * @niv: the length of each initialization vector
+ * @sectorsize: the size of each sector in bytes
+ * @buf: buffer holding the plain text, overwritten with the cipher text
+ * @len: the length of @buf, a multiple of @sectorsize
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Encrypts @buf in place as a sequence of sectors of @sectorsize bytes,
+ * each one being encrypted with its own initialization vector taken
+ * from @ivs.  This is equivalent to calling qcrypto_cipher_setiv()
+ * and qcrypto_cipher_encrypt() for every sector, but lets the backend
+ * process the whole buffer in one call.  If @niv is zero, @ivs is
+ * ignored and @buf is encrypted as a whole.
+ *
+ * The IV last set with qcrypto_cipher_setiv() is undefined after this
+ * call.
+ *
+ * Returns: 0 on success, or -1 on error
+ */
+int qcrypto_cipher_encrypt_sectors(QCryptoCipher *cipher,
+                                   const uint8_t *ivs, size_t niv,
+                                   size_t sectorsize,
+                                   void *buf, size_t len,
+                                   Error **errp);
+
+/**
+ * qcrypto_cipher_decrypt_sectors:
+ * @cipher: the cipher object
+ * @ivs: the initialization vectors, @niv bytes for each sector
+ * @niv: the length of each initialization vector
+ * @sectorsize: the size of each sector in bytes
+ * @buf: buffer holding the cipher text, overwritten with the plain text
+ * @len: the length of @buf, a multiple of @sectorsize
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * The counterpart of qcrypto_cipher_encrypt_sectors() for decryption.
+ *
+ * Returns: 0 on success, or -1 on error
+ */
+int qcrypto_cipher_decrypt_sectors(QCryptoCipher *cipher,
+                                   const uint8_t *ivs, size_t niv,
+                                   size_t sectorsize,
+                                   void *buf, size_t len,
+                                   Error **errp);
+
 #endif /* QCRYPTO_CIPHER_H */
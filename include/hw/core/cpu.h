@@ -238,6 +238,15 @@ struct CPUTLBEntryFull {
     /* @lg_page_size contains the log2 of the page size. */
     uint8_t lg_page_size;
 
+    /*
+     * @lg_page_contiguous is set by tlb_fill when the whole
+     * @lg_page_size region maps to contiguous physical addresses.
+     * This is not the case e.g. under nested translation, where
+     * @lg_page_size may describe stage 1 while stage 2 maps smaller
+     * pages.
+     */
+    bool lg_page_contiguous;
+
     /* Additional tlb flags requested by tlb_fill. */
     uint8_t tlb_fill_flags;
 
@@ -282,6 +291,16 @@ typedef struct CPUTLBDesc {
      */
     vaddr large_page_addr;
     vaddr large_page_mask;
+    /*
+     * The most recent physically contiguous large page entered into the
+     * tlb, kept in full so that other small pages within it can be
+     * refilled without another walk of the guest page tables.  The entry is valid when
+     * (addr & lp_fill_mask) == lp_fill_addr.  It always lies within the
+     * large page region above, and so is discarded along with it.
+     */
+    vaddr lp_fill_addr;
+    vaddr lp_fill_mask;
+    CPUTLBEntryFull lp_fill;
     /* host time (in ns) at the beginning of the time window */
     int64_t window_begin_ns;
     /* maximum number of entries observed in the window */
@@ -375,6 +394,7 @@ typedef struct CPUNegativeOffsetState {
 } CPUNegativeOffsetState;
 
 struct KVMState;
+struct KVMExitStats;
 struct kvm_run;
 
 /* work queue */
@@ -455,6 +475,8 @@ struct qemu_work_item;
  *    ring is enabled.
  * @kvm_fetch_index: Keeps the index that we last fetched from the per-vCPU
  *    dirty ring structure.
+ * @kvm_exit_stats: Userspace exit handling counters for this CPU, reported
+ *    by the "kvm-exit" stats provider.
  *
  * @neg_align: The CPUState is the common part of a concrete ArchCPU
  * which is allocated when an individual CPU instance is created. As
@@ -540,6 +562,7 @@ struct CPUState {
     uint32_t kvm_fetch_index;
     uint64_t dirty_pages;
     int kvm_vcpu_stats_fd;
+    struct KVMExitStats *kvm_exit_stats;
 
     /* Use by accel-block: CPU is executing an ioctl() */
     QemuLockCnt in_ioctl_lock;
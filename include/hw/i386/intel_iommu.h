@@ -157,6 +157,9 @@ struct VTDIOTLBEntry {
     uint64_t mask;
     uint8_t access_flags;
     uint8_t pgtt;
+    IntelIOMMUState *iommu;
+    struct vtd_iotlb_key *key;
+    QTAILQ_ENTRY(VTDIOTLBEntry) lru;
 };
 
 /* VT-d Source-ID Qualifier types */
@@ -289,6 +292,12 @@ struct IntelIOMMUState {
 
     uint32_t context_cache_gen;     /* Should be in [1,MAX] */
     GHashTable *iotlb;              /* IOTLB */
+    /* IOTLB entries, most recently used first */
+    QTAILQ_HEAD(, VTDIOTLBEntry) iotlb_lru;
+    uint32_t iotlb_size;            /* Max number of IOTLB entries */
+    uint64_t iotlb_hits;
+    uint64_t iotlb_misses;
+    uint64_t iotlb_evictions;
 
     GHashTable *vtd_address_spaces;             /* VTD address spaces */
     VTDAddressSpace *vtd_as_cache[VTD_PCI_BUS_MAX]; /* VTD address space cache */
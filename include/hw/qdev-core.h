@@ -1159,4 +1159,18 @@ typedef enum MachineInitPhase {
 bool phase_check(MachineInitPhase phase);
 void phase_advance(MachineInitPhase phase);
 
+/**
+ * phase_get_name: Return a human readable name for @phase.
+ */
+const char *phase_get_name(MachineInitPhase phase);
+
+/**
+ * phase_get_elapsed_us:
+ * @phase: the machine init phase
+ *
+ * Return: microseconds from process startup until @phase was reached,
+ * or -1 if it has not been reached yet.
+ */
+int64_t phase_get_elapsed_us(MachineInitPhase phase);
+
 #endif
@@ -150,6 +150,16 @@ struct VFIOIOMMUClass {
      */
     void (*listener_commit)(VFIOContainerBase *bcontainer);
 
+    /**
+     * @dma_map_parallel
+     *
+     * True if @dma_map and @dma_map_file may be called concurrently from
+     * several threads, and if a range mapped in pieces can be unmapped with
+     * a single @dma_unmap call.  Large RAM sections are then pinned and
+     * mapped in parallel.
+     */
+    bool dma_map_parallel;
+
     /**
      * @dma_map
      *
@@ -65,6 +65,7 @@ struct VirtIOIOMMU {
     GTree *domains;
     QemuRecMutex mutex;
     GTree *endpoints;
+    GArray *pending_notifs;     /* map/unmap notifications not yet sent */
     bool boot_bypass;
     Notifier machine_done;
     bool granule_frozen;
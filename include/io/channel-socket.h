@@ -275,4 +275,22 @@ int qio_channel_socket_set_send_buffer(QIOChannelSocket *ioc,
                                        size_t size,
                                        Error **errp);
 
+/**
+ * qio_channel_socket_zero_copy_poll:
+ * @sioc: the socket channel object
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Collect the completion notifications that are already available
+ * for writes issued with QIO_CHANNEL_WRITE_FLAG_ZERO_COPY, without
+ * blocking.  Upon return, all buffers of the first
+ * @sioc->zero_copy_sent zero-copy writes may be reused.
+ *
+ * Unlike qio_channel_flush(), this never waits for outstanding
+ * writes and may therefore be called from coroutine context.
+ *
+ * Returns: 0 on success, or -1 on error.
+ */
+int qio_channel_socket_zero_copy_poll(QIOChannelSocket *sioc,
+                                      Error **errp);
+
 #endif /* QIO_CHANNEL_SOCKET_H */
@@ -39,7 +39,7 @@ void precopy_add_notifier(NotifierWithReturn *n);
 void precopy_remove_notifier(NotifierWithReturn *n);
 int precopy_notify(PrecopyNotifyReason reason, Error **errp);
 
-void qemu_guest_free_page_hint(void *addr, size_t len);
+void qemu_guest_free_page_hints(struct iovec *iov, unsigned int iovcnt);
 bool migrate_ram_is_ignored(RAMBlock *block);
 
 /* migration/block.c */
@@ -25,6 +25,7 @@ typedef enum QmpCommandOptions
     QCO_ALLOW_OOB             =  (1U << 1),
     QCO_ALLOW_PRECONFIG       =  (1U << 2),
     QCO_COROUTINE             =  (1U << 3),
+    QCO_ALLOW_NO_BQL          =  (1U << 4),
 } QmpCommandOptions;
 
 typedef struct QmpCommand
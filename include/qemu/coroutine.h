@@ -284,6 +284,12 @@ void qemu_coroutine_inc_pool_size(unsigned int additional_pool_size);
  */
 void qemu_coroutine_dec_pool_size(unsigned int additional_pool_size);
 
+/**
+ * Return the highest number of coroutines that were allocated at the same
+ * time, including the ones kept in the pool for reuse
+ */
+unsigned int qemu_coroutine_get_peak_count(void);
+
 /**
  * Sends a (part of) iovec down a socket, yielding when the socket is full, or
  * Receives data into a (part of) iovec from a socket,
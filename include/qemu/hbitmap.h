@@ -61,6 +61,36 @@ struct HBitmapIter {
  */
 HBitmap *hbitmap_alloc(uint64_t size, int granularity);
 
+/**
+ * hbitmap_alloc_compressed:
+ * @size: Number of bits in the bitmap.
+ * @granularity: Granularity of the bitmap.
+ *
+ * Allocate a new HBitmap like hbitmap_alloc, but store the bottom level
+ * in chunks that are only allocated when they are neither entirely clear
+ * nor entirely set.  This saves memory for mostly clear or mostly set
+ * bitmaps, at the cost of slightly slower updates.
+ */
+HBitmap *hbitmap_alloc_compressed(uint64_t size, int granularity);
+
+/**
+ * hbitmap_is_compressed:
+ * @hb: HBitmap to operate on.
+ *
+ * Return whether the bitmap uses the compressed representation.
+ */
+bool hbitmap_is_compressed(const HBitmap *hb);
+
+/**
+ * hbitmap_set_compressed:
+ * @hb: HBitmap to operate on.
+ * @compressed: Whether the bitmap should use the compressed representation.
+ *
+ * Convert the bitmap to or from the compressed representation.  The
+ * contents of the bitmap are not changed.
+ */
+void hbitmap_set_compressed(HBitmap *hb, bool compressed);
+
 /**
  * hbitmap_truncate:
  * @hb: The bitmap to change the size of.
@@ -261,6 +291,26 @@ void hbitmap_deserialize_finish(HBitmap *hb);
  */
 char *hbitmap_sha256(const HBitmap *bitmap, Error **errp);
 
+/**
+ * hbitmap_create_meta:
+ * @hb: The HBitmap to operate on.
+ * @chunk_size: How many bits in @hb does one bit in the meta track.
+ *
+ * Create a "meta" hbitmap to track dirtiness of the bits in this HBitmap.
+ * The meta bitmap is set whenever bits in @hb change; bulk operations
+ * such as merging or deserializing mark the whole meta bitmap.
+ *
+ * The meta bitmap is owned by @hb and must be freed with
+ * hbitmap_free_meta() before @hb is freed.
+ */
+HBitmap *hbitmap_create_meta(HBitmap *hb, int chunk_size);
+
+/**
+ * hbitmap_free_meta:
+ * @hb: The HBitmap whose meta bitmap should be released.
+ */
+void hbitmap_free_meta(HBitmap *hb);
+
 /**
  * hbitmap_free:
  * @hb: HBitmap to operate on.
@@ -0,0 +1,47 @@
+/*
+ * Log-linear histograms for latency percentiles
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_HDR_HISTOGRAM_H
+#define QEMU_HDR_HISTOGRAM_H
+
+/*
+ * Like an HDR histogram, every power of two range of values is split into
+ * HDR_HISTOGRAM_SUB_BUCKETS equal buckets.  Values below
+ * HDR_HISTOGRAM_SUB_BUCKETS are counted exactly, larger values with a
+ * relative error of at most 1 / HDR_HISTOGRAM_SUB_BUCKETS.  The whole
+ * uint64_t range is covered with a fixed number of buckets, so recording a
+ * value never allocates and histograms can be merged by adding up buckets.
+ *
+ * There is no locking, users that record from several threads keep one
+ * histogram per thread and merge them when reading.
+ */
+#define HDR_HISTOGRAM_SUB_BITS      5
+#define HDR_HISTOGRAM_SUB_BUCKETS   (1 << HDR_HISTOGRAM_SUB_BITS)
+#define HDR_HISTOGRAM_BUCKETS \
+    ((64 - HDR_HISTOGRAM_SUB_BITS + 1) * HDR_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct HdrHistogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[HDR_HISTOGRAM_BUCKETS];
+} HdrHistogram;
+
+void hdr_histogram_init(HdrHistogram *h);
+void hdr_histogram_record(HdrHistogram *h, uint64_t value);
+
+/* Add the values recorded in @src to @dst */
+void hdr_histogram_merge(HdrHistogram *dst, const HdrHistogram *src);
+
+/*
+ * Returns a value such that a fraction @q (0.0 to 1.0) of the recorded
+ * values is smaller than or equal to it, or 0 if nothing was recorded.
+ */
+uint64_t hdr_histogram_quantile(const HdrHistogram *h, double q);
+
+#endif /* QEMU_HDR_HISTOGRAM_H */
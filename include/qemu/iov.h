@@ -196,8 +196,10 @@ typedef struct QEMUIOVector {
      * static assertion below.
      *
      * @nalloc is always valid and is -1 both for embedded and external
-     * cases. It is included in the union only to ensure the padding prior
-     * to the @size field will not result in a 0-length array.
+     * cases, and QEMU_IOVEC_NALLOC_INLINE while an inline vector
+     * (qemu_iovec_init_inline()) still uses its inline storage. It is
+     * included in the union only to ensure the padding prior to the @size
+     * field will not result in a 0-length array.
      */
     union {
         struct {
@@ -248,10 +250,30 @@ static inline void *qemu_iovec_buf(QEMUIOVector *qiov)
     return qiov->local_iov.iov_base;
 }
 
+/*
+ * QEMUIOVector with room for a few iovec entries of its own, for
+ * short-lived vectors that are built per request. qemu_iovec_add() only
+ * moves the entries to the heap once more than QEMU_IOVEC_INLINE_NIOV are
+ * added. Use @qiov with the usual qemu_iovec_* functions and release it
+ * with qemu_iovec_destroy(). The structure must not be copied or moved
+ * while it is in use.
+ */
+#define QEMU_IOVEC_INLINE_NIOV 8
+#define QEMU_IOVEC_NALLOC_INLINE (-2)
+
+typedef struct QEMUIOVectorInline {
+    QEMUIOVector qiov;
+    struct iovec inline_iov[QEMU_IOVEC_INLINE_NIOV];
+} QEMUIOVectorInline;
+
 void qemu_iovec_init(QEMUIOVector *qiov, int alloc_hint);
+void qemu_iovec_init_inline(QEMUIOVectorInline *qiov);
 void qemu_iovec_init_external(QEMUIOVector *qiov, struct iovec *iov, int niov);
 void qemu_iovec_init_slice(QEMUIOVector *qiov, QEMUIOVector *source,
                            size_t offset, size_t len);
+void qemu_iovec_init_slice_inline(QEMUIOVectorInline *qiov,
+                                  QEMUIOVector *source,
+                                  size_t offset, size_t len);
 struct iovec *qemu_iovec_slice(QEMUIOVector *qiov,
                                size_t offset, size_t len,
                                size_t *head, size_t *tail, int *niov);
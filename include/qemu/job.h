@@ -103,6 +103,7 @@ typedef struct Job {
     /**
      * Counter for pause request. If non-zero, the block job is either paused,
      * or if busy == true will pause itself as soon as possible.
+     * Written under job_mutex, job_pause_point() reads it without it.
      */
     int pause_count;
 
@@ -70,6 +70,7 @@ enum plugin_dyn_cb_type {
     PLUGIN_CB_REGULAR,
     PLUGIN_CB_COND,
     PLUGIN_CB_MEM_REGULAR,
+    PLUGIN_CB_MEM_COND,
     PLUGIN_CB_INLINE_ADD_U64,
     PLUGIN_CB_INLINE_STORE_U64,
 };
@@ -94,6 +95,7 @@ struct qemu_plugin_conditional_cb {
     qemu_plugin_u64 entry;
     enum qemu_plugin_cond cond;
     uint64_t imm;
+    enum qemu_plugin_mem_rw rw;
 };
 
 /*
@@ -72,11 +72,14 @@ typedef uint64_t qemu_plugin_id_t;
  * - added qemu_plugin_write_memory_hwaddr
  * - added qemu_plugin_write_register
  * - added qemu_plugin_translate_vaddr
+ *
+ * version 6:
+ * - added qemu_plugin_register_vcpu_mem_cond_cb
  */
 
 extern QEMU_PLUGIN_EXPORT int qemu_plugin_version;
 
-#define QEMU_PLUGIN_VERSION 5
+#define QEMU_PLUGIN_VERSION 6
 
 /**
  * struct qemu_info_t - system information for plugins
@@ -686,6 +689,37 @@ void qemu_plugin_register_vcpu_mem_cb(struct qemu_plugin_insn *insn,
                                       enum qemu_plugin_mem_rw rw,
                                       void *userdata);
 
+/**
+ * qemu_plugin_register_vcpu_mem_cond_cb() - conditional memory access cb
+ * @insn: handle for instruction to instrument
+ * @cb: callback of type qemu_plugin_vcpu_mem_cb_t
+ * @flags: does the plugin read or write the CPU's registers?
+ * @rw: monitor reads, writes or both
+ * @cond: condition to enable callback
+ * @entry: first operand for condition
+ * @imm: second operand for condition
+ * @userdata: opaque pointer for userdata
+ *
+ * The @cb function is called for a memory access generated by the
+ * instruction if entry @cond imm is true.  The condition is evaluated
+ * inline, so combined with qemu_plugin_register_vcpu_mem_inline_per_vcpu
+ * on the same entry this allows sampling every Nth access without
+ * paying for a full callback on the others.
+ * If condition is QEMU_PLUGIN_COND_ALWAYS, condition is never interpreted and
+ * this function is equivalent to qemu_plugin_register_vcpu_mem_cb.
+ * If condition QEMU_PLUGIN_COND_NEVER, condition is never interpreted and
+ * callback is never installed.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_mem_cond_cb(struct qemu_plugin_insn *insn,
+                                           qemu_plugin_vcpu_mem_cb_t cb,
+                                           enum qemu_plugin_cb_flags flags,
+                                           enum qemu_plugin_mem_rw rw,
+                                           enum qemu_plugin_cond cond,
+                                           qemu_plugin_u64 entry,
+                                           uint64_t imm,
+                                           void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_mem_inline_per_vcpu() - inline op for mem access
  * @insn: handle for instruction to instrument
@@ -20,7 +20,10 @@ void qsp_report(size_t max, enum QSPSortBy sort_by,
                 bool callsite_coalesce);
 
 bool qsp_is_enabled(void);
+bool qsp_is_contended_only(void);
 void qsp_enable(void);
+/* Only profile acquisitions that have to wait for another thread */
+void qsp_enable_contended(void);
 void qsp_disable(void);
 void qsp_reset(void);
 
@@ -158,6 +158,14 @@ bool throttle_schedule_timer(ThrottleState *ts,
 
 void throttle_account(ThrottleState *ts, ThrottleDirection direction,
                       uint64_t size);
+
+bool throttle_compute_budget(ThrottleState *ts, QEMUClockType clock_type,
+                             ThrottleDirection direction,
+                             uint64_t *size, uint64_t *units);
+void throttle_reserve_budget(ThrottleState *ts, ThrottleDirection direction,
+                             uint64_t size, uint64_t units);
+void throttle_release_budget(ThrottleState *ts, ThrottleDirection direction,
+                             uint64_t size, uint64_t units);
 void throttle_limits_to_config(ThrottleLimits *arg, ThrottleConfig *cfg,
                                Error **errp);
 void throttle_config_to_limits(ThrottleConfig *cfg, ThrottleLimits *var);
@@ -86,7 +86,8 @@ struct QEMUTimer {
     QEMUTimerList *timer_list;
     QEMUTimerCB *cb;
     void *opaque;
-    QEMUTimer *next;
+    size_t heap_index;          /* position in the timer list while pending */
+    uint64_t seq;               /* orders timers with equal expire_time */
     int attributes;
     int scale;
 };
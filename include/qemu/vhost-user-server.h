@@ -22,6 +22,7 @@
 typedef struct VuFdWatch {
     VuDev *vu_dev;
     int fd; /*kick fd*/
+    int vq_index; /* virtqueue index of the kick fd, or -1 */
     void *pvt;
     vu_watch_cb cb;
     QTAILQ_ENTRY(VuFdWatch) next;
@@ -31,20 +32,22 @@ typedef struct VuFdWatch {
  * VuServer:
  * A vhost-user server instance with user-defined VuDevIface callbacks.
  * Vhost-user device backends can be implemented using VuServer. VuDevIface
- * callbacks and virtqueue kicks run in the given AioContext.
+ * callbacks and virtqueue kicks run in the given AioContext, unless a
+ * separate AioContext was given for a virtqueue in vq_ctx.
  */
 typedef struct {
     QIONetListener *listener;
     QEMUBH *restart_listener_bh;
     AioContext *ctx;
+    AioContext **vq_ctx; /* per-virtqueue AioContext, or NULL */
     int max_queues;
     const VuDevIface *vu_iface;
 
     unsigned int in_flight; /* atomic */
+    bool wait_idle; /* atomic */
 
     /* Protected by ctx lock */
     bool in_qio_channel_yield;
-    bool wait_idle;
     bool quiescing;
     VuDev vu_dev;
     QIOChannel *ioc; /* The I/O channel with the client */
@@ -57,6 +60,7 @@ typedef struct {
 bool vhost_user_server_start(VuServer *server,
                              SocketAddress *unix_socket,
                              AioContext *ctx,
+                             AioContext **vq_ctx,
                              uint16_t max_queues,
                              const VuDevIface *vu_iface,
                              Error **errp);
@@ -117,7 +117,7 @@ typedef void (ObjectUnparent)(Object *obj);
  */
 typedef void (ObjectFree)(void *obj);
 
-#define OBJECT_CLASS_CAST_CACHE 4
+#define OBJECT_CLASS_CAST_CACHE 8
 
 /**
  * struct ObjectClass:
@@ -137,6 +137,9 @@ struct ObjectClass
     ObjectUnparent *unparent;
 
     GHashTable *properties;
+    /* All properties including inherited ones, for lookups */
+    GHashTable *flat_properties;
+    unsigned flat_properties_gen;
 };
 
 /**
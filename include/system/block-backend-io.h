@@ -124,6 +124,16 @@ int coroutine_fn blk_co_copy_range(BlockBackend *blk_in, int64_t off_in,
                                    int64_t bytes, BdrvRequestFlags read_flags,
                                    BdrvRequestFlags write_flags);
 
+/*
+ * Like blk_co_copy_range(), but copying from a child of the caller's own
+ * node, such as the filter node of a block job.
+ */
+int coroutine_fn blk_co_copy_range_from_child(BdrvChild *src, int64_t off_in,
+                                              BlockBackend *blk_out,
+                                              int64_t off_out, int64_t bytes,
+                                              BdrvRequestFlags read_flags,
+                                              BdrvRequestFlags write_flags);
+
 int coroutine_fn blk_co_block_status_above(BlockBackend *blk,
                                            BlockDriverState *base,
                                            int64_t offset, int64_t bytes,
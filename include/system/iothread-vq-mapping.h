@@ -6,11 +6,11 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 
-#ifndef HW_VIRTIO_IOTHREAD_VQ_MAPPING_H
-#define HW_VIRTIO_IOTHREAD_VQ_MAPPING_H
+#ifndef SYSTEM_IOTHREAD_VQ_MAPPING_H
+#define SYSTEM_IOTHREAD_VQ_MAPPING_H
 
 #include "qapi/error.h"
-#include "qapi/qapi-types-virtio.h"
+#include "qapi/qapi-types-block-core.h"
 
 /**
  * iothread_vq_mapping_apply:
@@ -42,4 +42,4 @@ bool iothread_vq_mapping_apply(
  */
 void iothread_vq_mapping_cleanup(IOThreadVirtQueueMappingList *list);
 
-#endif /* HW_VIRTIO_IOTHREAD_VQ_MAPPING_H */
+#endif /* SYSTEM_IOTHREAD_VQ_MAPPING_H */
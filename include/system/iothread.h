@@ -38,6 +38,16 @@ struct IOThread {
     int64_t poll_max_ns;
     int64_t poll_grow;
     int64_t poll_shrink;
+
+    /* AioContext io_uring parameters, fixed once the thread is running */
+    int64_t io_uring_queue_depth;
+    bool io_uring_sqpoll;
+    int64_t io_uring_sqpoll_cpu;
+    int64_t io_uring_sqpoll_idle;
+    bool io_uring_iopoll;
+
+    /* Collect aio_poll() time accounting */
+    bool stats;
 };
 typedef struct IOThread IOThread;
 
@@ -547,6 +547,9 @@ bool kvm_dirty_ring_enabled(void);
 
 uint32_t kvm_dirty_ring_size(void);
 
+/* Average time to reap all dirty rings recently, in microseconds */
+uint64_t kvm_dirty_ring_reap_latency(void);
+
 void kvm_mark_guest_state_protected(void);
 
 /**
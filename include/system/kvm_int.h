@@ -18,6 +18,7 @@
 #include "hw/boards.h"
 #include "hw/i386/topology.h"
 #include "io/channel-socket.h"
+#include "qemu/stats64.h"
 
 typedef struct KVMSlot
 {
@@ -53,6 +54,26 @@ typedef struct KVMMemoryListener {
     QSIMPLEQ_HEAD(, KVMMemoryUpdate) transaction_del;
 } KVMMemoryListener;
 
+/*
+ * Userspace exit handling statistics, kept per vCPU.  Updated only by
+ * the vCPU thread in kvm_cpu_exec() and read through query-stats.
+ */
+typedef enum KVMExitStatsKind {
+    KVM_EXIT_STATS_IO,
+    KVM_EXIT_STATS_MMIO,
+    KVM_EXIT_STATS_OTHER,
+    KVM_EXIT_STATS__MAX,
+} KVMExitStatsKind;
+
+/* Bucket n counts latencies in [2^(n-1), 2^n) ns; bucket 0 counts 0 ns */
+#define KVM_EXIT_STATS_HIST_BUCKETS 32
+
+typedef struct KVMExitStats {
+    Stat64 exits[KVM_EXIT_STATS__MAX];
+    Stat64 time_ns[KVM_EXIT_STATS__MAX];
+    Stat64 hist[KVM_EXIT_STATS__MAX][KVM_EXIT_STATS_HIST_BUCKETS];
+} KVMExitStats;
+
 #define KVM_MSI_HASHTAB_SIZE    256
 
 typedef struct KVMHostTopoInfo {
@@ -100,6 +121,16 @@ struct KVMDirtyRingReaper {
     QemuThread reaper_thr;
     volatile uint64_t reaper_iteration; /* iteration number of reaper thr */
     volatile enum KVMDirtyRingReaperState reaper_state; /* reap thr state */
+    /*
+     * Threads that help reaping all rings at once, NULL if there is only
+     * one task.  Each task reaps the vCPUs whose index modulo nr_tasks is
+     * the task's index.
+     */
+    struct ThreadPool *pool;
+    struct KVMDirtyRingReapTask *tasks;
+    uint32_t nr_tasks;
+    /* Moving average of the time taken to reap all rings, in ns */
+    Stat64 reap_latency_ns;
 };
 struct KVMState
 {
@@ -142,7 +173,11 @@ struct KVMState
 #ifdef KVM_CAP_IRQ_ROUTING
     struct kvm_irq_routing *irq_routes;
     int nr_allocated_irq_routes;
+    /* irq_routes changed since the last KVM_SET_GSI_ROUTING */
+    bool irq_routes_dirty;
     unsigned long *used_gsi_bitmap;
+    /* gsi -> index into irq_routes->entries, a hint that may be stale */
+    unsigned int *irq_route_slot;
     unsigned int gsi_count;
 #endif
     KVMMemoryListener memory_listener;
@@ -157,6 +192,7 @@ struct KVMState
     uint64_t kvm_dirty_ring_bytes;  /* Size of the per-vcpu dirty ring */
     uint32_t kvm_dirty_ring_size;   /* Number of dirty GFNs per ring */
     bool kvm_dirty_ring_with_bitmap;
+    uint32_t kvm_dirty_ring_reapers; /* Parallel reap tasks, 0 for auto */
     uint64_t kvm_eager_split_size;  /* Eager Page Splitting chunk size */
     struct KVMDirtyRingReaper reaper;
     struct KVMMsrEnergy msr_energy;
@@ -315,6 +315,14 @@ struct MemoryRegionOps {
                                     MemTxAttrs attrs);
 
     enum device_endian endianness;
+    /*
+     * If true, every region initialized with these ops is registered for
+     * coalescing on creation: the accelerator may buffer writes and replay
+     * them later, and any access to the region flushes the buffer first.
+     * Only use it for registers whose side effects need not be visible to
+     * the guest until it next reads the region.
+     */
+    bool coalesce_writes;
     /* Guest-visible constraints: */
     struct {
         /* If nonzero, specify bounds on access sizes beyond which a machine
@@ -27,6 +27,7 @@
 #include "system/memory.h"
 #include "exec/target_page.h"
 #include "qemu/rcu.h"
+#include "qemu/cutils.h"
 
 #include "exec/hwaddr.h"
 #include "exec/cpu-common.h"
@@ -482,6 +483,13 @@ static inline void cpu_physical_memory_clear_dirty_range(ram_addr_t start,
 }
 
 
+/*
+ * Number of migration dirty bitmap words that are checked for being all
+ * clear in one go, so that sync can skip over the clean parts of a sparse
+ * bitmap with the vectorized buffer_is_zero() instead of word by word.
+ */
+#define DIRTY_SYNC_CHUNK_LONGS 32
+
 /* Called with RCU critical section */
 static inline
 uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
@@ -497,8 +505,8 @@ uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
     if (((word * BITS_PER_LONG) << TARGET_PAGE_BITS) ==
          (start + rb->offset) &&
         !(length & ((BITS_PER_LONG << TARGET_PAGE_BITS) - 1))) {
-        int k;
-        int nr = BITS_TO_LONGS(length >> TARGET_PAGE_BITS);
+        unsigned long k;
+        unsigned long nr = BITS_TO_LONGS(length >> TARGET_PAGE_BITS);
         unsigned long * const *src;
         unsigned long idx = (word * BITS_PER_LONG) / DIRTY_MEMORY_BLOCK_SIZE;
         unsigned long offset = BIT_WORD((word * BITS_PER_LONG) %
@@ -508,20 +516,38 @@ uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
         src = qatomic_rcu_read(
                 &ram_list.dirty_memory[DIRTY_MEMORY_MIGRATION])->blocks;
 
-        for (k = page; k < page + nr; k++) {
-            if (src[idx][offset]) {
-                unsigned long bits = qatomic_xchg(&src[idx][offset], 0);
-                unsigned long new_dirty;
-                new_dirty = ~dest[k];
-                dest[k] |= bits;
-                new_dirty &= bits;
-                num_dirty += ctpopl(new_dirty);
+        for (k = page; k < page + nr; ) {
+            unsigned long *block = src[idx] + offset;
+            unsigned long n = MIN(page + nr - k,
+                                  BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE) -
+                                  offset);
+            unsigned long i, j, chunk;
+
+            for (i = 0; i < n; i += chunk) {
+                chunk = MIN(n - i, DIRTY_SYNC_CHUNK_LONGS);
+                /*
+                 * A racing writer that is missed here leaves its bit set
+                 * for the next sync, exactly as with the per-word check.
+                 */
+                if (chunk == DIRTY_SYNC_CHUNK_LONGS &&
+                    buffer_is_zero(block + i, chunk * sizeof(long))) {
+                    continue;
+                }
+                for (j = i; j < i + chunk; j++) {
+                    if (block[j]) {
+                        unsigned long bits = qatomic_xchg(&block[j], 0);
+                        unsigned long new_dirty;
+                        new_dirty = ~dest[k + j];
+                        dest[k + j] |= bits;
+                        new_dirty &= bits;
+                        num_dirty += ctpopl(new_dirty);
+                    }
+                }
             }
 
-            if (++offset >= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE)) {
-                offset = 0;
-                idx++;
-            }
+            k += n;
+            offset = 0;
+            idx++;
         }
         if (num_dirty) {
             cpu_physical_memory_dirty_bits_cleared(start, length);
@@ -9,6 +9,8 @@
 #define STATS_H
 
 #include "qapi/qapi-types-stats.h"
+#include "qemu/queue.h"
+#include "qemu/stats64.h"
 
 typedef void StatRetrieveFunc(StatsResultList **result, StatsTarget target,
                               strList *names, strList *targets, Error **errp);
@@ -42,4 +44,28 @@ void add_stats_schema(StatsSchemaList **, StatsProvider, StatsTarget,
  */
 bool apply_str_list_filter(const char *string, strList *list);
 
+/*
+ * Process-wide statistics exported through the "qemu" provider of
+ * query-stats.  Subsystems keep their counters in Stat64s as usual and
+ * describe them once with a QemuStat; query-stats then reads the values
+ * without any cooperation from the code that updates them.
+ */
+typedef struct QemuStat {
+    const char *name;
+    StatsType type;
+    bool has_unit;
+    StatsUnit unit;
+    int8_t exponent;        /* base 10 exponent of @unit */
+    const Stat64 *values;
+    int n_values;           /* number of buckets for histograms, else 1 */
+    QTAILQ_ENTRY(QemuStat) next;
+} QemuStat;
+
+/*
+ * Add @stat to, or remove it from, the "qemu" provider.  Called with the
+ * BQL held; @stat must stay valid until it is unregistered.
+ */
+void qemu_stats_register(QemuStat *stat);
+void qemu_stats_unregister(QemuStat *stat);
+
 #endif /* STATS_H */
@@ -371,6 +371,11 @@ typedef struct GraphicHwOps {
     void (*text_update)(void *opaque, console_ch_t *text);
     void (*ui_info)(void *opaque, uint32_t head, QemuUIInfo *info);
     void (*gl_block)(void *opaque, bool block);
+    /*
+     * if true, dpy_gfx_update() drops the parts of an update whose content
+     * did not change, for devices that report updates very coarsely
+     */
+    bool filter_updates;
 } GraphicHwOps;
 
 QemuConsole *graphic_console_init(DeviceState *dev, uint32_t head,
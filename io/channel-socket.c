@@ -35,6 +35,11 @@
 #endif
 #endif
 
+#ifdef QEMU_MSG_ZEROCOPY
+static int qio_channel_socket_reap_zero_copy(QIOChannelSocket *sioc,
+                                             bool wait, Error **errp);
+#endif
+
 #define SOCKET_MAX_FDS 16
 
 SocketAddress *
@@ -90,6 +95,19 @@ int qio_channel_socket_set_send_buffer(QIOChannelSocket *ioc,
     return 0;
 }
 
+static void qio_channel_socket_probe_zero_copy(QIOChannelSocket *sioc)
+{
+#ifdef QEMU_MSG_ZEROCOPY
+    int ret, v = 1;
+    ret = setsockopt(sioc->fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v));
+    if (ret == 0) {
+        /* Zero copy available on host */
+        qio_channel_set_feature(QIO_CHANNEL(sioc),
+                                QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
+    }
+#endif
+}
+
 static int
 qio_channel_socket_set_fd(QIOChannelSocket *sioc,
                           int fd,
@@ -175,15 +193,7 @@ int qio_channel_socket_connect_sync(QIOChannelSocket *ioc,
         return -1;
     }
 
-#ifdef QEMU_MSG_ZEROCOPY
-    int ret, v = 1;
-    ret = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v));
-    if (ret == 0) {
-        /* Zero copy available on host */
-        qio_channel_set_feature(QIO_CHANNEL(ioc),
-                                QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
-    }
-#endif
+    qio_channel_socket_probe_zero_copy(ioc);
 
     qio_channel_set_feature(QIO_CHANNEL(ioc),
                             QIO_CHANNEL_FEATURE_READ_MSG_PEEK);
@@ -421,6 +431,8 @@ qio_channel_socket_accept(QIOChannelSocket *ioc,
     }
 #endif /* WIN32 */
 
+    qio_channel_socket_probe_zero_copy(cioc);
+
     qio_channel_set_feature(QIO_CHANNEL(cioc),
                             QIO_CHANNEL_FEATURE_READ_MSG_PEEK);
 
@@ -577,6 +589,9 @@ static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
     size_t fdsize = sizeof(int) * nfds;
     struct cmsghdr *cmsg;
     int sflags = 0;
+#ifdef QEMU_MSG_ZEROCOPY
+    bool reaped = false;
+#endif
 
     memset(control, 0, CMSG_SPACE(sizeof(int) * SOCKET_MAX_FDS));
 
@@ -623,6 +638,24 @@ static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
             goto retry;
         case ENOBUFS:
             if (flags & QIO_CHANNEL_WRITE_FLAG_ZERO_COPY) {
+#ifdef QEMU_MSG_ZEROCOPY
+                /*
+                 * Completion notifications that were not reaped yet are
+                 * charged to the socket's option memory.  Wait for the
+                 * pending ones and try again, instead of failing the
+                 * whole migration just because the sender is ahead.
+                 */
+                if (!reaped && sioc->zero_copy_queued > sioc->zero_copy_sent) {
+                    trace_qio_channel_socket_zero_copy_enobufs(
+                        sioc, sioc->zero_copy_queued - sioc->zero_copy_sent);
+                    if (qio_channel_socket_reap_zero_copy(sioc, true,
+                                                          errp) < 0) {
+                        return -1;
+                    }
+                    reaped = true;
+                    goto retry;
+                }
+#endif
                 error_setg_errno(errp, errno,
                                  "Process can't lock enough memory for using MSG_ZEROCOPY");
                 return -1;
@@ -736,10 +769,10 @@ static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
 
 
 #ifdef QEMU_MSG_ZEROCOPY
-static int qio_channel_socket_flush(QIOChannel *ioc,
-                                    Error **errp)
+static int qio_channel_socket_reap_zero_copy(QIOChannelSocket *sioc,
+                                             bool wait, Error **errp)
 {
-    QIOChannelSocket *sioc = QIO_CHANNEL_SOCKET(ioc);
+    QIOChannel *ioc = QIO_CHANNEL(sioc);
     struct msghdr msg = {};
     struct sock_extended_err *serr;
     struct cmsghdr *cm;
@@ -762,6 +795,9 @@ static int qio_channel_socket_flush(QIOChannel *ioc,
         if (received < 0) {
             switch (errno) {
             case EAGAIN:
+                if (!wait) {
+                    return ret;
+                }
                 /* Nothing on errqueue, wait until something is available */
                 qio_channel_wait(ioc, G_IO_ERR);
                 continue;
@@ -811,6 +847,28 @@ static int qio_channel_socket_flush(QIOChannel *ioc,
     return ret;
 }
 
+static int qio_channel_socket_flush(QIOChannel *ioc,
+                                    Error **errp)
+{
+    return qio_channel_socket_reap_zero_copy(QIO_CHANNEL_SOCKET(ioc),
+                                             true, errp);
+}
+
+int qio_channel_socket_zero_copy_poll(QIOChannelSocket *sioc, Error **errp)
+{
+    if (qio_channel_socket_reap_zero_copy(sioc, false, errp) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+#else /* QEMU_MSG_ZEROCOPY */
+
+int qio_channel_socket_zero_copy_poll(QIOChannelSocket *sioc, Error **errp)
+{
+    return 0;
+}
+
 #endif /* QEMU_MSG_ZEROCOPY */
 
 static int
@@ -8,7 +8,7 @@
 
 #include "qemu/osdep.h"
 #include "system/iothread.h"
-#include "hw/virtio/iothread-vq-mapping.h"
+#include "system/iothread-vq-mapping.h"
 
 static bool
 iothread_vq_mapping_validate(IOThreadVirtQueueMappingList *list, uint16_t
@@ -94,7 +94,7 @@ bool iothread_vq_mapping_apply(
         IOThread *iothread = iothread_by_id(node->value->iothread);
         AioContext *ctx = iothread_get_aio_context(iothread);
 
-        /* Released in virtio_blk_vq_aio_context_cleanup() */
+        /* Released in iothread_vq_mapping_cleanup() */
         object_ref(OBJECT(iothread));
 
         if (node->value->vqs) {
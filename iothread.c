@@ -36,6 +36,9 @@
 #define IOTHREAD_POLL_MAX_NS_DEFAULT 0ULL
 #endif
 
+/* The kernel's IORING_MAX_ENTRIES */
+#define IOTHREAD_IO_URING_MAX_QUEUE_DEPTH 32768
+
 static void *iothread_run(void *opaque)
 {
     IOThread *iothread = opaque;
@@ -103,6 +106,7 @@ static void iothread_instance_init(Object *obj)
     IOThread *iothread = IOTHREAD(obj);
 
     iothread->poll_max_ns = IOTHREAD_POLL_MAX_NS_DEFAULT;
+    iothread->io_uring_sqpoll_cpu = -1;
     iothread->thread_id = -1;
     qemu_sem_init(&iothread->init_done_sem, 0);
     /* By default, we don't run gcontext */
@@ -155,6 +159,13 @@ static void iothread_set_aio_context_params(EventLoopBase *base, Error **errp)
 {
     ERRP_GUARD();
     IOThread *iothread = IOTHREAD(base);
+    AioIoUringParams io_uring_params = {
+        .queue_depth = iothread->io_uring_queue_depth,
+        .sqpoll = iothread->io_uring_sqpoll,
+        .sqpoll_cpu = iothread->io_uring_sqpoll_cpu,
+        .sqpoll_idle = iothread->io_uring_sqpoll_idle,
+        .iopoll = iothread->io_uring_iopoll,
+    };
 
     if (!iothread->ctx) {
         return;
@@ -172,6 +183,13 @@ static void iothread_set_aio_context_params(EventLoopBase *base, Error **errp)
     aio_context_set_aio_params(iothread->ctx,
                                iothread->parent_obj.aio_max_batch);
 
+    qatomic_set(&iothread->ctx->stats_enabled, iothread->stats);
+
+    aio_context_set_io_uring_params(iothread->ctx, &io_uring_params, errp);
+    if (*errp) {
+        return;
+    }
+
     aio_context_set_thread_pool_params(iothread->ctx, base->thread_pool_min,
                                        base->thread_pool_max, errp);
 }
@@ -292,6 +310,121 @@ static void iothread_set_poll_param(Object *obj, Visitor *v,
     }
 }
 
+typedef struct {
+    const char *name;
+    ptrdiff_t offset; /* field's byte offset in IOThread struct */
+    int64_t min;
+    int64_t max;
+} IOThreadIoUringParamInfo;
+
+static IOThreadIoUringParamInfo io_uring_queue_depth_info = {
+    "io-uring-queue-depth", offsetof(IOThread, io_uring_queue_depth),
+    0, IOTHREAD_IO_URING_MAX_QUEUE_DEPTH,
+};
+/* -1 leaves the polling thread unbound */
+static IOThreadIoUringParamInfo io_uring_sqpoll_cpu_info = {
+    "io-uring-sqpoll-cpu", offsetof(IOThread, io_uring_sqpoll_cpu),
+    -1, INT_MAX,
+};
+static IOThreadIoUringParamInfo io_uring_sqpoll_idle_info = {
+    "io-uring-sqpoll-idle", offsetof(IOThread, io_uring_sqpoll_idle),
+    0, UINT32_MAX,
+};
+
+/*
+ * The io_uring instances are created along with the AioContext, so their
+ * parameters can't be changed once the iothread is running.
+ */
+static bool iothread_check_io_uring_param(IOThread *iothread,
+                                          const char *name, Error **errp)
+{
+    if (iothread->ctx) {
+        error_setg(errp, "%s cannot be changed while the iothread is running",
+                   name);
+        return false;
+    }
+    return true;
+}
+
+static void iothread_get_io_uring_param(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    IOThreadIoUringParamInfo *info = opaque;
+    int64_t *field = (void *)iothread + info->offset;
+
+    visit_type_int64(v, name, field, errp);
+}
+
+static void iothread_set_io_uring_param(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    IOThreadIoUringParamInfo *info = opaque;
+    int64_t *field = (void *)iothread + info->offset;
+    int64_t value;
+
+    if (!iothread_check_io_uring_param(iothread, info->name, errp)) {
+        return;
+    }
+
+    if (!visit_type_int64(v, name, &value, errp)) {
+        return;
+    }
+
+    if (value < info->min || value > info->max) {
+        error_setg(errp, "%s value must be in range [%" PRId64 ", %" PRId64 "]",
+                   info->name, info->min, info->max);
+        return;
+    }
+
+    *field = value;
+}
+
+static bool iothread_get_io_uring_sqpoll(Object *obj, Error **errp)
+{
+    return IOTHREAD(obj)->io_uring_sqpoll;
+}
+
+static void iothread_set_io_uring_sqpoll(Object *obj, bool value, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+
+    if (iothread_check_io_uring_param(iothread, "io-uring-sqpoll", errp)) {
+        iothread->io_uring_sqpoll = value;
+    }
+}
+
+static bool iothread_get_io_uring_iopoll(Object *obj, Error **errp)
+{
+    return IOTHREAD(obj)->io_uring_iopoll;
+}
+
+static void iothread_set_io_uring_iopoll(Object *obj, bool value, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+
+    if (iothread_check_io_uring_param(iothread, "io-uring-iopoll", errp)) {
+        iothread->io_uring_iopoll = value;
+    }
+}
+
+static bool iothread_get_stats(Object *obj, Error **errp)
+{
+    return IOTHREAD(obj)->stats;
+}
+
+static void iothread_set_stats(Object *obj, bool value, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+
+    iothread->stats = value;
+    if (iothread->ctx) {
+        /* Picked up by the next aio_poll() */
+        qatomic_set(&iothread->ctx->stats_enabled, value);
+    }
+}
+
 static void iothread_class_init(ObjectClass *klass, const void *class_data)
 {
     EventLoopBaseClass *bc = EVENT_LOOP_BASE_CLASS(klass);
@@ -311,6 +444,27 @@ static void iothread_class_init(ObjectClass *klass, const void *class_data)
                               iothread_get_poll_param,
                               iothread_set_poll_param,
                               NULL, &poll_shrink_info);
+    object_class_property_add(klass, "io-uring-queue-depth", "int",
+                              iothread_get_io_uring_param,
+                              iothread_set_io_uring_param,
+                              NULL, &io_uring_queue_depth_info);
+    object_class_property_add_bool(klass, "io-uring-sqpoll",
+                                   iothread_get_io_uring_sqpoll,
+                                   iothread_set_io_uring_sqpoll);
+    object_class_property_add(klass, "io-uring-sqpoll-cpu", "int",
+                              iothread_get_io_uring_param,
+                              iothread_set_io_uring_param,
+                              NULL, &io_uring_sqpoll_cpu_info);
+    object_class_property_add(klass, "io-uring-sqpoll-idle", "int",
+                              iothread_get_io_uring_param,
+                              iothread_set_io_uring_param,
+                              NULL, &io_uring_sqpoll_idle_info);
+    object_class_property_add_bool(klass, "io-uring-iopoll",
+                                   iothread_get_io_uring_iopoll,
+                                   iothread_set_io_uring_iopoll);
+    object_class_property_add_bool(klass, "stats",
+                                   iothread_get_stats,
+                                   iothread_set_stats);
 }
 
 static const TypeInfo iothread_info = {
@@ -357,6 +511,24 @@ static int query_one_iothread(Object *object, void *opaque)
     info->poll_grow = iothread->poll_grow;
     info->poll_shrink = iothread->poll_shrink;
     info->aio_max_batch = iothread->parent_obj.aio_max_batch;
+    if (!iothread->stopping &&
+        qemu_thread_get_cpu_time(&iothread->thread, &info->cpu_time_ns) == 0) {
+        info->has_cpu_time_ns = true;
+    }
+    if (iothread->stats && iothread->ctx) {
+        AioContextStats *stats = &iothread->ctx->stats;
+
+        info->has_poll_time_ns = true;
+        info->poll_time_ns = stat64_get(&stats->poll_ns);
+        info->has_wait_time_ns = true;
+        info->wait_time_ns = stat64_get(&stats->wait_ns);
+        info->has_bh_time_ns = true;
+        info->bh_time_ns = stat64_get(&stats->bh_ns);
+        info->has_handler_time_ns = true;
+        info->handler_time_ns = stat64_get(&stats->handler_ns);
+        info->has_timer_time_ns = true;
+        info->timer_time_ns = stat64_get(&stats->timer_ns);
+    }
 
     QAPI_LIST_APPEND(*tail, info);
     return 0;
@@ -643,6 +643,15 @@ static void coroutine_fn job_pause_point_locked(Job *job)
 
 void coroutine_fn job_pause_point(Job *job)
 {
+    /*
+     * Jobs call this for every chunk of work, do not take job_mutex when
+     * there is nothing to do.  A pause request that races with the check
+     * is seen at the next pause point, as it would be with the lock held.
+     */
+    if (!qatomic_read(&job->pause_count)) {
+        return;
+    }
+
     JOB_LOCK_GUARD();
     job_pause_point_locked(job);
 }
@@ -689,7 +698,7 @@ static bool job_timer_not_pending_locked(Job *job)
 
 void job_pause_locked(Job *job)
 {
-    job->pause_count++;
+    qatomic_set(&job->pause_count, job->pause_count + 1);
     if (!job->paused) {
         job_enter_cond_locked(job, NULL);
     }
@@ -704,7 +713,7 @@ void job_pause(Job *job)
 void job_resume_locked(Job *job)
 {
     assert(job->pause_count > 0);
-    job->pause_count--;
+    qatomic_set(&job->pause_count, job->pause_count - 1);
     if (job->pause_count) {
         return;
     }
@@ -906,7 +915,7 @@ static void job_cancel_async_locked(Job *job, bool force)
         }
         job->user_paused = false;
         assert(job->pause_count > 0);
-        job->pause_count--;
+        qatomic_set(&job->pause_count, job->pause_count - 1);
     }
 
     /*
@@ -1126,7 +1135,7 @@ void job_start(Job *job)
         assert(job && !job_started_locked(job) && job->paused &&
             job->driver && job->driver->run);
         job->co = qemu_coroutine_create(job_co_entry, job);
-        job->pause_count--;
+        qatomic_set(&job->pause_count, job->pause_count - 1);
         job->busy = true;
         job->paused = false;
         job_state_transition_locked(job, JOB_STATUS_RUNNING);
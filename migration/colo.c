@@ -34,6 +34,8 @@
 #include "system/runstate.h"
 #include "net/filter.h"
 #include "options.h"
+#include "qemu/stats64.h"
+#include "qemu/timer.h"
 
 static bool vmstate_loading;
 static Notifier packets_compare_notifier;
@@ -41,6 +43,14 @@ static Notifier packets_compare_notifier;
 /* User need to know colo mode after COLO failover */
 static COLOMode last_colo_mode;
 
+/* Time the VM spent stopped for checkpoints, in this COLO mode */
+static struct {
+    Stat64 checkpoints;
+    Stat64 last_pause;
+    Stat64 max_pause;
+    Stat64 total_pause;
+} colo_stats;
+
 #define COLO_BUFFER_BASE_SIZE (4 * 1024 * 1024)
 
 bool migration_in_colo_state(void)
@@ -62,6 +72,26 @@ static bool colo_runstate_is_stopped(void)
     return runstate_check(RUN_STATE_COLO) || !runstate_is_running();
 }
 
+static void colo_stats_reset(void)
+{
+    stat64_set(&colo_stats.checkpoints, 0);
+    stat64_set(&colo_stats.last_pause, 0);
+    stat64_set(&colo_stats.max_pause, 0);
+    stat64_set(&colo_stats.total_pause, 0);
+}
+
+/* Account a checkpoint that kept the VM stopped since @stop_time (ms) */
+static void colo_stats_checkpoint_done(int64_t stop_time)
+{
+    int64_t pause = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) - stop_time;
+
+    stat64_add(&colo_stats.checkpoints, 1);
+    stat64_set(&colo_stats.last_pause, pause);
+    stat64_max(&colo_stats.max_pause, pause);
+    stat64_add(&colo_stats.total_pause, pause);
+    trace_colo_checkpoint_pause(pause);
+}
+
 static void colo_checkpoint_notify(void)
 {
     MigrationState *s = migrate_get_current();
@@ -289,6 +319,10 @@ COLOStatus *qmp_query_colo_status(Error **errp)
 
     s->mode = get_colo_mode();
     s->last_mode = last_colo_mode;
+    s->checkpoints = stat64_get(&colo_stats.checkpoints);
+    s->last_checkpoint_pause = stat64_get(&colo_stats.last_pause);
+    s->max_checkpoint_pause = stat64_get(&colo_stats.max_pause);
+    s->total_checkpoint_pause = stat64_get(&colo_stats.total_pause);
 
     switch (failover_get_state()) {
     case FAILOVER_STATUS_NONE:
@@ -407,6 +441,7 @@ static int colo_do_checkpoint_transaction(MigrationState *s,
                                           QEMUFile *fb)
 {
     Error *local_err = NULL;
+    int64_t stop_time;
     int ret = -1;
 
     colo_send_message(s->to_dst_file, COLO_MESSAGE_CHECKPOINT_REQUEST,
@@ -431,6 +466,7 @@ static int colo_do_checkpoint_transaction(MigrationState *s,
     }
     vm_stop_force_state(RUN_STATE_COLO);
     bql_unlock();
+    stop_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
     trace_colo_vm_state_change("run", "stop");
     /*
      * Failover request bh could be called after vm_stop_force_state(),
@@ -515,6 +551,7 @@ static int colo_do_checkpoint_transaction(MigrationState *s,
     vm_start();
     bql_unlock();
     trace_colo_vm_state_change("stop", "run");
+    colo_stats_checkpoint_done(stop_time);
 
 out:
     if (local_err) {
@@ -541,6 +578,7 @@ static void colo_process_checkpoint(MigrationState *s)
     }
 
     failover_init_state();
+    colo_stats_reset();
 
     s->rp_state.from_dst_file = qemu_file_get_return_path(s->to_dst_file);
     if (!s->rp_state.from_dst_file) {
@@ -662,11 +700,13 @@ static void colo_incoming_process_checkpoint(MigrationIncomingState *mis,
     uint64_t total_size;
     uint64_t value;
     Error *local_err = NULL;
+    int64_t stop_time;
     int ret;
 
     bql_lock();
     vm_stop_force_state(RUN_STATE_COLO);
     bql_unlock();
+    stop_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
     trace_colo_vm_state_change("run", "stop");
 
     /* FIXME: This is unnecessary for periodic checkpoint mode */
@@ -767,6 +807,7 @@ static void colo_incoming_process_checkpoint(MigrationIncomingState *mis,
     vm_start();
     bql_unlock();
     trace_colo_vm_state_change("stop", "run");
+    colo_stats_checkpoint_done(stop_time);
 
     if (failover_get_state() == FAILOVER_STATUS_RELAUNCH) {
         return;
@@ -837,6 +878,8 @@ static void *colo_process_incoming_thread(void *opaque)
         return NULL;
     }
 
+    colo_stats_reset();
+
     /* Make sure all file formats throw away their mutable metadata */
     bql_lock();
     migration_block_activate(&local_err);
@@ -0,0 +1,164 @@
+/*
+ * Migration downtime breakdown
+ *
+ * Records the switchover checkpoints and the time each handler takes to
+ * save or load its state, for query-migrate and for Chrome trace files.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/lockable.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/clone-visitor.h"
+#include "qapi/qapi-commands-migration.h"
+#include "qapi/qapi-visit-migration.h"
+#include "qobject/json-writer.h"
+#include "downtime-trace.h"
+#include "trace.h"
+
+static struct {
+    QemuMutex lock;
+    /* MigrationDowntimeEvent, in the order they ended */
+    GPtrArray *events;
+    /* Time the timing started, events start relative to it */
+    int64_t base_us;
+    /* Time of the last checkpoint, where the next phase starts */
+    int64_t checkpoint_us;
+} downtime_trace;
+
+static void __attribute__((constructor)) migration_downtime_trace_init(void)
+{
+    qemu_mutex_init(&downtime_trace.lock);
+    downtime_trace.events =
+        g_ptr_array_new_with_free_func((GDestroyNotify)
+                                       qapi_free_MigrationDowntimeEvent);
+}
+
+void migration_downtime_trace_reset(void)
+{
+    int64_t now = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
+    QEMU_LOCK_GUARD(&downtime_trace.lock);
+    g_ptr_array_set_size(downtime_trace.events, 0);
+    downtime_trace.base_us = now;
+    downtime_trace.checkpoint_us = now;
+}
+
+static void migration_downtime_add(MigrationDowntimeEventType type,
+                                   const char *name, bool has_instance_id,
+                                   uint32_t instance_id, int64_t start_us,
+                                   int64_t end_us)
+{
+    MigrationDowntimeEvent *event = g_new0(MigrationDowntimeEvent, 1);
+
+    event->type = type;
+    event->name = g_strdup(name);
+    event->has_instance_id = has_instance_id;
+    event->instance_id = instance_id;
+    event->start = start_us - downtime_trace.base_us;
+    event->duration = end_us - start_us;
+
+    g_ptr_array_add(downtime_trace.events, event);
+}
+
+void migration_downtime_checkpoint(const char *checkpoint)
+{
+    int64_t now = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
+    trace_vmstate_downtime_checkpoint(checkpoint);
+
+    QEMU_LOCK_GUARD(&downtime_trace.lock);
+    migration_downtime_add(MIGRATION_DOWNTIME_EVENT_TYPE_PHASE, checkpoint,
+                           false, 0, downtime_trace.checkpoint_us, now);
+    downtime_trace.checkpoint_us = now;
+}
+
+void migration_downtime_save(const char *type, const char *idstr,
+                             uint32_t instance_id, int64_t start_us,
+                             int64_t end_us)
+{
+    trace_vmstate_downtime_save(type, idstr, instance_id, end_us - start_us);
+
+    QEMU_LOCK_GUARD(&downtime_trace.lock);
+    migration_downtime_add(MIGRATION_DOWNTIME_EVENT_TYPE_SAVE, idstr,
+                           true, instance_id, start_us, end_us);
+}
+
+void migration_downtime_load(const char *type, const char *idstr,
+                             uint32_t instance_id, int64_t start_us,
+                             int64_t end_us)
+{
+    trace_vmstate_downtime_load(type, idstr, instance_id, end_us - start_us);
+
+    QEMU_LOCK_GUARD(&downtime_trace.lock);
+    migration_downtime_add(MIGRATION_DOWNTIME_EVENT_TYPE_LOAD, idstr,
+                           true, instance_id, start_us, end_us);
+}
+
+MigrationDowntimeEventList *migration_downtime_events(void)
+{
+    MigrationDowntimeEventList *head = NULL;
+    MigrationDowntimeEventList **tail = &head;
+
+    QEMU_LOCK_GUARD(&downtime_trace.lock);
+    for (guint i = 0; i < downtime_trace.events->len; i++) {
+        MigrationDowntimeEvent *event =
+            g_ptr_array_index(downtime_trace.events, i);
+
+        QAPI_LIST_APPEND(tail, QAPI_CLONE(MigrationDowntimeEvent, event));
+    }
+
+    return head;
+}
+
+/*
+ * Phases go on one track and handlers on another, as handlers run within
+ * the phases.
+ */
+void qmp_migrate_save_downtime_trace(const char *filename, Error **errp)
+{
+    g_autoptr(GError) err = NULL;
+    JSONWriter *writer = json_writer_new(false);
+    GString *contents;
+
+    json_writer_start_object(writer, NULL);
+    json_writer_start_array(writer, "traceEvents");
+
+    WITH_QEMU_LOCK_GUARD(&downtime_trace.lock) {
+        for (guint i = 0; i < downtime_trace.events->len; i++) {
+            MigrationDowntimeEvent *event =
+                g_ptr_array_index(downtime_trace.events, i);
+            bool phase = event->type == MIGRATION_DOWNTIME_EVENT_TYPE_PHASE;
+
+            json_writer_start_object(writer, NULL);
+            json_writer_str(writer, "name", event->name);
+            json_writer_str(writer, "cat",
+                            MigrationDowntimeEventType_str(event->type));
+            json_writer_str(writer, "ph", "X");
+            json_writer_int64(writer, "ts", event->start);
+            json_writer_int64(writer, "dur", event->duration);
+            json_writer_int64(writer, "pid", 1);
+            json_writer_int64(writer, "tid", phase ? 0 : 1);
+            if (event->has_instance_id) {
+                json_writer_start_object(writer, "args");
+                json_writer_int64(writer, "instance_id", event->instance_id);
+                json_writer_end_object(writer);
+            }
+            json_writer_end_object(writer);
+        }
+    }
+
+    json_writer_end_array(writer);
+    json_writer_str(writer, "displayTimeUnit", "ms");
+    json_writer_end_object(writer);
+
+    contents = json_writer_get_and_free(writer);
+    if (!g_file_set_contents(filename, contents->str, contents->len, &err)) {
+        error_setg(errp, "Failed to write downtime trace to '%s': %s",
+                   filename, err->message);
+    }
+    g_string_free(contents, true);
+}
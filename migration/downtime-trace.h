@@ -0,0 +1,25 @@
+/*
+ * Migration downtime breakdown
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_MIGRATION_DOWNTIME_TRACE_H
+#define QEMU_MIGRATION_DOWNTIME_TRACE_H
+
+#include "qapi/qapi-types-migration.h"
+
+/* Forget the events of the previous migration and start timing again */
+void migration_downtime_trace_reset(void);
+/* Record the phase that ends at @checkpoint */
+void migration_downtime_checkpoint(const char *checkpoint);
+void migration_downtime_save(const char *type, const char *idstr,
+                             uint32_t instance_id, int64_t start_us,
+                             int64_t end_us);
+void migration_downtime_load(const char *type, const char *idstr,
+                             uint32_t instance_id, int64_t start_us,
+                             int64_t end_us);
+MigrationDowntimeEventList *migration_downtime_events(void);
+
+#endif
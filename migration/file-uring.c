@@ -0,0 +1,135 @@
+/*
+ * io_uring reads for mapped-ram file migration
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <liburing.h>
+#include "qemu/notify.h"
+#include "qemu/thread.h"
+#include "qemu/units.h"
+#include "qapi/error.h"
+#include "file.h"
+#include "trace.h"
+
+/* Size of the individual reads that a request is split into */
+#define FILE_URING_CHUNK_SIZE (256 * KiB)
+
+/* Number of reads that each recv thread keeps in flight */
+#define FILE_URING_QUEUE_DEPTH 32
+
+typedef struct FileUring {
+    struct io_uring ring;
+    bool initialized;
+    bool failed;
+    Notifier exit_notifier;
+} FileUring;
+
+/* One ring for each multifd recv thread */
+static __thread FileUring file_uring;
+
+static void file_uring_cleanup(Notifier *n, void *unused)
+{
+    FileUring *u = container_of(n, FileUring, exit_notifier);
+
+    io_uring_queue_exit(&u->ring);
+    u->initialized = false;
+}
+
+static struct io_uring *file_uring_get(void)
+{
+    FileUring *u = &file_uring;
+    int ret;
+
+    if (u->initialized) {
+        return &u->ring;
+    }
+    if (u->failed) {
+        return NULL;
+    }
+
+    ret = io_uring_queue_init(FILE_URING_QUEUE_DEPTH, &u->ring, 0);
+    if (ret < 0) {
+        trace_migration_file_uring_init_failed(-ret);
+        u->failed = true;
+        return NULL;
+    }
+
+    u->initialized = true;
+    u->exit_notifier.notify = file_uring_cleanup;
+    qemu_thread_atexit_add(&u->exit_notifier);
+    return &u->ring;
+}
+
+/* Give up on io_uring for this thread after an unexpected failure */
+static void file_uring_disable(void)
+{
+    qemu_thread_atexit_remove(&file_uring.exit_notifier);
+    file_uring_cleanup(&file_uring.exit_notifier, NULL);
+    file_uring.failed = true;
+}
+
+int file_uring_pread(int fd, void *buf, size_t len, off_t offset,
+                     Error **errp)
+{
+    struct io_uring *ring = file_uring_get();
+    size_t queued = 0;
+    unsigned int inflight = 0;
+    int err = 0;
+    int ret;
+
+    if (!ring) {
+        return 1;
+    }
+
+    while ((!err && queued < len) || inflight > 0) {
+        struct io_uring_cqe *cqe;
+
+        while (!err && queued < len && inflight < FILE_URING_QUEUE_DEPTH) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+            size_t n = MIN(len - queued, FILE_URING_CHUNK_SIZE);
+
+            if (!sqe) {
+                break;
+            }
+            io_uring_prep_read(sqe, fd, buf + queued, n, offset + queued);
+            io_uring_sqe_set_data(sqe, (void *)(uintptr_t)queued);
+            queued += n;
+            inflight++;
+        }
+
+        ret = io_uring_submit_and_wait(ring, 1);
+        if (ret < 0 && ret != -EINTR) {
+            /* The ring state is unknown, drop it and its pending reads */
+            file_uring_disable();
+            error_setg_errno(errp, -ret, "io_uring submission failed");
+            return -1;
+        }
+
+        while (io_uring_peek_cqe(ring, &cqe) == 0) {
+            size_t pos = (uintptr_t)io_uring_cqe_get_data(cqe);
+            size_t expected = MIN(len - pos, FILE_URING_CHUNK_SIZE);
+            int res = cqe->res;
+
+            io_uring_cqe_seen(ring, cqe);
+            inflight--;
+
+            if (res < 0) {
+                err = err ?: res;
+            } else if (res != expected) {
+                /* Short reads only happen at EOF */
+                err = err ?: -EIO;
+            }
+        }
+    }
+
+    if (err) {
+        error_setg_errno(errp, -err, "failed to read 0x%zx bytes at 0x%jx",
+                         len, (uintmax_t)offset);
+        return -1;
+    }
+
+    return 0;
+}
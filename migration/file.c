@@ -255,6 +255,22 @@ int multifd_file_recv_data(MultiFDRecvParams *p, Error **errp)
     MultiFDRecvData *data = p->data;
     size_t ret;
 
+#ifdef CONFIG_LINUX_IO_URING
+    QIOChannelFile *fioc = (QIOChannelFile *)
+        object_dynamic_cast(OBJECT(p->c), TYPE_QIO_CHANNEL_FILE);
+
+    if (fioc) {
+        int r = file_uring_pread(fioc->fd, data->opaque, data->size,
+                                 data->file_offset, errp);
+        if (r <= 0) {
+            if (r < 0) {
+                error_prepend(errp, "multifd recv (%u): ", p->id);
+            }
+            return r;
+        }
+    }
+#endif
+
     ret = qio_channel_pread(p->c, (char *) data->opaque,
                             data->size, data->file_offset, errp);
     if (ret != data->size) {
@@ -23,4 +23,14 @@ bool file_send_channel_create(gpointer opaque, Error **errp);
 int file_write_ramblock_iov(QIOChannel *ioc, const struct iovec *iov,
                             int niov, MultiFDPages_t *pages, Error **errp);
 int multifd_file_recv_data(MultiFDRecvParams *p, Error **errp);
+
+#ifdef CONFIG_LINUX_IO_URING
+/*
+ * Read @len bytes at @offset of @fd into @buf, split into several reads
+ * that are in flight at the same time.  Returns 0 on success, -1 on error
+ * and 1 if io_uring is not available in this thread.
+ */
+int file_uring_pread(int fd, void *buf, size_t len, off_t offset,
+                     Error **errp);
+#endif
 #endif
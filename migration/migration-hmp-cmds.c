@@ -221,6 +221,12 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "    Page Types: \tnormal=%" PRIu64
                        ", zero=%" PRIu64 "\n",
                        info->ram->normal, info->ram->duplicate);
+        if (info->ram->has_multifd_compressed_pages) {
+            monitor_printf(mon, "    Multifd Auto: \tcompressed=%" PRIu64
+                           ", uncompressed=%" PRIu64 "\n",
+                           info->ram->multifd_compressed_pages,
+                           info->ram->multifd_uncompressed_pages);
+        }
         monitor_printf(mon, "  Page Rates (pps): \ttransfer=%" PRIu64,
                        info->ram->pages_per_second);
         if (info->ram->dirty_pages_rate) {
@@ -243,6 +249,10 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
             monitor_printf(mon, ", zerocopy_fallbacks=%" PRIu64,
                            info->ram->dirty_sync_missed_zero_copy);
         }
+        if (info->ram->free_page_hint_pages) {
+            monitor_printf(mon, ", free_page_hints=%" PRIu64,
+                           info->ram->free_page_hint_pages);
+        }
         monitor_printf(mon, "\n");
     }
 
@@ -284,6 +294,29 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
                        info->dirty_limit_ring_full_time);
     }
 
+    if (info->has_dirty_ring_reap_latency) {
+        monitor_printf(mon, "Dirty-ring Reap (us): %" PRIu64 "\n",
+                       info->dirty_ring_reap_latency);
+    }
+
+    if (info->has_downtime_events) {
+        MigrationDowntimeEventList *ev;
+
+        monitor_printf(mon, "Downtime events (us):\n");
+        for (ev = info->downtime_events; ev; ev = ev->next) {
+            monitor_printf(mon, "  %-6s start=%-8" PRId64
+                           " duration=%-8" PRId64 " %s",
+                           MigrationDowntimeEventType_str(ev->value->type),
+                           ev->value->start, ev->value->duration,
+                           ev->value->name);
+            if (ev->value->has_instance_id) {
+                monitor_printf(mon, " (%" PRIu32 ")",
+                               ev->value->instance_id);
+            }
+            monitor_printf(mon, "\n");
+        }
+    }
+
     migration_dump_blocktime(mon, info);
 out:
     qapi_free_MigrationInfo(info);
@@ -435,6 +468,17 @@ void hmp_info_migrate_parameters(Monitor *mon, const QDict *qdict)
                                MIGRATION_PARAMETER_DIRECT_IO),
                            params->direct_io ? "on" : "off");
         }
+
+        assert(params->has_postcopy_fault_around);
+        monitor_printf(mon, "%s: %u\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_POSTCOPY_FAULT_AROUND),
+            params->postcopy_fault_around);
+
+        assert(params->has_dirty_limit_convergence_time);
+        monitor_printf(mon, "%s: %" PRIu64 " ms\n",
+            MigrationParameter_str(
+                MIGRATION_PARAMETER_DIRTY_LIMIT_CONVERGENCE_TIME),
+            params->dirty_limit_convergence_time);
     }
 
     qapi_free_MigrationParameters(params);
@@ -716,6 +760,14 @@ void hmp_migrate_set_parameter(Monitor *mon, const QDict *qdict)
         p->has_direct_io = true;
         visit_type_bool(v, param, &p->direct_io, &err);
         break;
+    case MIGRATION_PARAMETER_POSTCOPY_FAULT_AROUND:
+        p->has_postcopy_fault_around = true;
+        visit_type_uint8(v, param, &p->postcopy_fault_around, &err);
+        break;
+    case MIGRATION_PARAMETER_DIRTY_LIMIT_CONVERGENCE_TIME:
+        p->has_dirty_limit_convergence_time = true;
+        visit_type_size(v, param, &p->dirty_limit_convergence_time, &err);
+        break;
     default:
         g_assert_not_reached();
     }
@@ -64,6 +64,17 @@ typedef struct {
      * Number of bytes sent through multifd channels.
      */
     Stat64 multifd_bytes;
+    /*
+     * Number of pages sent compressed, resp. uncompressed, by the
+     * auto multifd compression method.
+     */
+    Stat64 multifd_compressed_pages;
+    Stat64 multifd_uncompressed_pages;
+    /*
+     * Number of dirty pages skipped because the guest reported them as
+     * free.
+     */
+    Stat64 free_page_hint_pages;
     /*
      * Number of pages transferred that were not full of zeros.
      */
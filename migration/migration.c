@@ -65,9 +65,11 @@
 #include "yank_functions.h"
 #include "system/qtest.h"
 #include "options.h"
+#include "downtime-trace.h"
 #include "system/dirtylimit.h"
 #include "qemu/sockets.h"
 #include "system/kvm.h"
+#include "system/stats.h"
 
 #define NOTIFIER_ELEM_INIT(array, elem)    \
     [elem] = NOTIFIER_WITH_RETURN_LIST_INITIALIZER((array)[elem])
@@ -115,7 +117,8 @@ static void migrate_hup_delete(MigrationState *s);
 
 static void migration_downtime_start(MigrationState *s)
 {
-    trace_vmstate_downtime_checkpoint("src-downtime-start");
+    migration_downtime_trace_reset();
+    migration_downtime_checkpoint("src-downtime-start");
     s->downtime_start = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 }
 
@@ -150,7 +153,7 @@ static void migration_downtime_end(MigrationState *s)
      */
     if (!s->downtime) {
         s->downtime = now - s->downtime_start;
-        trace_vmstate_downtime_checkpoint("src-downtime-end");
+        migration_downtime_checkpoint("src-downtime-end");
     }
 }
 
@@ -298,18 +301,57 @@ static int migration_stop_vm(MigrationState *s, RunState state)
 
     ret = vm_stop_force_state(state);
 
-    trace_vmstate_downtime_checkpoint("src-vm-stopped");
+    migration_downtime_checkpoint("src-vm-stopped");
     trace_migration_completion_vm_stop(ret);
 
     return ret;
 }
 
+#define MIGRATION_STAT(field, stat_type)                \
+    {                                                   \
+        .name = "migration_" #field,                    \
+        .type = STATS_TYPE_##stat_type,                 \
+        .values = &mig_stats.field,                     \
+        .n_values = 1,                                  \
+    }
+
+#define MIGRATION_STAT_BYTES(field)                     \
+    {                                                   \
+        .name = "migration_" #field,                    \
+        .type = STATS_TYPE_CUMULATIVE,                  \
+        .has_unit = true,                               \
+        .unit = STATS_UNIT_BYTES,                       \
+        .values = &mig_stats.field,                     \
+        .n_values = 1,                                  \
+    }
+
+/* Counters from mig_stats that are exported through query-stats */
+static QemuStat migration_qemu_stats[] = {
+    MIGRATION_STAT(dirty_sync_count, CUMULATIVE),
+    MIGRATION_STAT(dirty_pages_rate, INSTANT),
+    MIGRATION_STAT(normal_pages, CUMULATIVE),
+    MIGRATION_STAT(zero_pages, CUMULATIVE),
+    MIGRATION_STAT(free_page_hint_pages, CUMULATIVE),
+    MIGRATION_STAT(postcopy_requests, CUMULATIVE),
+    MIGRATION_STAT_BYTES(precopy_bytes),
+    MIGRATION_STAT_BYTES(downtime_bytes),
+    MIGRATION_STAT_BYTES(postcopy_bytes),
+    MIGRATION_STAT_BYTES(multifd_bytes),
+    MIGRATION_STAT_BYTES(qemu_file_transferred),
+};
+
 void migration_object_init(void)
 {
+    int i;
+
     /* This can only be called once. */
     assert(!current_migration);
     current_migration = MIGRATION_OBJ(object_new(TYPE_MIGRATION));
 
+    for (i = 0; i < ARRAY_SIZE(migration_qemu_stats); i++) {
+        qemu_stats_register(&migration_qemu_stats[i]);
+    }
+
     /*
      * Init the migrate incoming object as well no matter whether
      * we'll use it or not.
@@ -813,7 +855,7 @@ static void process_incoming_migration_bh(void *opaque)
 {
     MigrationIncomingState *mis = opaque;
 
-    trace_vmstate_downtime_checkpoint("dst-precopy-bh-enter");
+    migration_downtime_checkpoint("dst-precopy-bh-enter");
 
     /*
      * This must happen after all error conditions are dealt with and
@@ -821,7 +863,7 @@ static void process_incoming_migration_bh(void *opaque)
      */
     qemu_announce_self(&mis->announce_timer, migrate_announce_params());
 
-    trace_vmstate_downtime_checkpoint("dst-precopy-bh-announced");
+    migration_downtime_checkpoint("dst-precopy-bh-announced");
 
     multifd_recv_shutdown();
 
@@ -853,7 +895,7 @@ static void process_incoming_migration_bh(void *opaque)
     } else {
         runstate_set(global_state_get_runstate());
     }
-    trace_vmstate_downtime_checkpoint("dst-precopy-bh-vm-started");
+    migration_downtime_checkpoint("dst-precopy-bh-vm-started");
     /*
      * This must happen after any state changes since as soon as an external
      * observer sees this event they might start to prod at the VM assuming
@@ -876,6 +918,7 @@ process_incoming_migration_co(void *opaque)
     assert(mis->from_src_file);
 
     mis->largest_page_size = qemu_ram_pagesize_largest();
+    migration_downtime_trace_reset();
     postcopy_state_set(POSTCOPY_INCOMING_NONE);
     migrate_set_state(&mis->state, MIGRATION_STATUS_SETUP,
                       MIGRATION_STATUS_ACTIVE);
@@ -884,7 +927,7 @@ process_incoming_migration_co(void *opaque)
     ret = qemu_loadvm_state(mis->from_src_file);
     mis->loadvm_co = NULL;
 
-    trace_vmstate_downtime_checkpoint("dst-precopy-loadvm-completed");
+    migration_downtime_checkpoint("dst-precopy-loadvm-completed");
 
     ps = postcopy_state_get();
     trace_process_incoming_migration_co_end(ret, ps);
@@ -1291,6 +1334,18 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
     info->ram->precopy_bytes = stat64_get(&mig_stats.precopy_bytes);
     info->ram->downtime_bytes = stat64_get(&mig_stats.downtime_bytes);
     info->ram->postcopy_bytes = stat64_get(&mig_stats.postcopy_bytes);
+    info->ram->free_page_hint_pages =
+        stat64_get(&mig_stats.free_page_hint_pages);
+
+    if (migrate_multifd() &&
+        migrate_multifd_compression() == MULTIFD_COMPRESSION_AUTO) {
+        info->ram->has_multifd_compressed_pages = true;
+        info->ram->multifd_compressed_pages =
+            stat64_get(&mig_stats.multifd_compressed_pages);
+        info->ram->has_multifd_uncompressed_pages = true;
+        info->ram->multifd_uncompressed_pages =
+            stat64_get(&mig_stats.multifd_uncompressed_pages);
+    }
 
     if (migrate_xbzrle()) {
         info->xbzrle_cache = g_malloc0(sizeof(*info->xbzrle_cache));
@@ -1322,6 +1377,11 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
         info->has_dirty_limit_ring_full_time = true;
         info->dirty_limit_ring_full_time = dirtylimit_ring_full_time();
     }
+
+    if (kvm_dirty_ring_enabled()) {
+        info->has_dirty_ring_reap_latency = true;
+        info->dirty_ring_reap_latency = kvm_dirty_ring_reap_latency();
+    }
 }
 
 static void fill_source_migration_info(MigrationInfo *info)
@@ -1444,6 +1504,9 @@ MigrationInfo *qmp_query_migrate(Error **errp)
     fill_destination_migration_info(info);
     fill_source_migration_info(info);
 
+    info->downtime_events = migration_downtime_events();
+    info->has_downtime_events = info->downtime_events != NULL;
+
     return info;
 }
 
@@ -1786,6 +1849,7 @@ int migrate_init(MigrationState *s, Error **errp)
     s->pages_per_second = 0.0;
     s->downtime = 0;
     s->expected_downtime = 0;
+    migration_downtime_trace_reset();
     s->setup_time = 0;
     s->start_postcopy = false;
     s->migration_thread_running = false;
@@ -2960,6 +3024,7 @@ static bool migration_switchover_start(MigrationState *s, Error **errp)
             error_setg(errp, "Block inactivate failed during switchover");
             return false;
         }
+        migration_downtime_checkpoint("src-block-inactivated");
     }
 
     migration_rate_set(RATE_LIMIT_DISABLED);
@@ -219,6 +219,13 @@ struct MigrationIncomingState {
      * still haven't been resolved.
      */
     int page_requested_count;
+    /*
+     * Pages requested ahead of vCPU faults because of postcopy-fault-around,
+     * and how many of them the vCPUs then accessed.  Only updated by the
+     * fault thread.
+     */
+    uint64_t postcopy_prefetch_pages;
+    uint64_t postcopy_prefetch_hits;
     /*
      * The mutex helps to maintain the requested pages that we sent to the
      * source, IOW, to guarantee coherent between the page_requests tree and
@@ -19,6 +19,7 @@
 #include "options.h"
 #include "migration.h"
 #include "qapi/error.h"
+#include "qemu/bitmap.h"
 #include "qemu/cutils.h"
 #include "qemu/error-report.h"
 #include "trace.h"
@@ -29,11 +30,13 @@ static MultiFDSendData *multifd_ram_send;
 void multifd_ram_payload_alloc(MultiFDPages_t *pages)
 {
     pages->offset = g_new0(ram_addr_t, multifd_ram_page_count());
+    pages->zero_bmap = bitmap_new(multifd_ram_page_count());
 }
 
 void multifd_ram_payload_free(MultiFDPages_t *pages)
 {
     g_clear_pointer(&pages->offset, g_free);
+    g_clear_pointer(&pages->zero_bmap, g_free);
 }
 
 void multifd_ram_save_setup(void)
@@ -92,7 +95,7 @@ static void multifd_ram_prepare_header(MultiFDSendParams *p)
     p->iovs_num++;
 }
 
-static void multifd_send_prepare_iovs(MultiFDSendParams *p)
+void multifd_send_prepare_iovs(MultiFDSendParams *p)
 {
     MultiFDPages_t *pages = &p->data->u.ram;
     uint32_t page_size = multifd_ram_page_size();
@@ -177,6 +180,15 @@ static int multifd_nocomp_recv(MultiFDRecvParams *p, Error **errp)
 
     multifd_recv_zero_page_process(p);
 
+    return multifd_recv_normal_pages(p, errp);
+}
+
+/*
+ * Read the non-zero pages of an uncompressed packet straight into guest
+ * memory.  p->iov must have room for multifd_ram_page_count() entries.
+ */
+int multifd_recv_normal_pages(MultiFDRecvParams *p, Error **errp)
+{
     if (!p->normal_num) {
         return 0;
     }
@@ -352,6 +364,41 @@ retry:
     return true;
 }
 
+/*
+ * Queue @npages consecutive pages starting at @offset.  This is the same as
+ * calling multifd_queue_page() for each of them, but only checks for the
+ * need to flush once per packet.
+ *
+ * Returns true if enqueue successful, false otherwise.
+ */
+bool multifd_queue_pages(RAMBlock *block, ram_addr_t offset,
+                         unsigned long npages)
+{
+    uint32_t page_size = multifd_ram_page_size();
+
+    while (npages) {
+        MultiFDPages_t *pages;
+        unsigned long n;
+
+        /* Takes care of flushing and of switching to @block */
+        if (!multifd_queue_page(block, offset)) {
+            return false;
+        }
+        offset += page_size;
+        npages--;
+
+        pages = &multifd_ram_send->u.ram;
+        n = MIN(npages, multifd_ram_page_count() - pages->num);
+        npages -= n;
+        while (n--) {
+            multifd_enqueue(pages, offset);
+            offset += page_size;
+        }
+    }
+
+    return true;
+}
+
 /*
  * We have two modes for multifd flushes:
  *
@@ -11,6 +11,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/bitmap.h"
 #include "qemu/cutils.h"
 #include "system/ramblock.h"
 #include "migration.h"
@@ -24,17 +25,25 @@ static bool multifd_zero_page_enabled(void)
     return migrate_zero_page_detection() == ZERO_PAGE_DETECTION_MULTIFD;
 }
 
-static void swap_page_offset(ram_addr_t *pages_offset, int a, int b)
+/*
+ * Set the bits of pages->zero_bmap for the zero pages of @pages, checking
+ * them BITS_PER_LONG at a time.
+ */
+static void multifd_zero_page_scan(MultiFDPages_t *pages)
 {
-    ram_addr_t temp;
+    RAMBlock *rb = pages->block;
+    uint32_t page_size = multifd_ram_page_size();
 
-    if (a == b) {
-        return;
-    }
+    for (uint32_t i = 0; i < pages->num; i += BITS_PER_LONG) {
+        const void *bufs[BITS_PER_LONG];
+        unsigned n = MIN(BITS_PER_LONG, pages->num - i);
 
-    temp = pages_offset[a];
-    pages_offset[a] = pages_offset[b];
-    pages_offset[b] = temp;
+        for (unsigned k = 0; k < n; k++) {
+            bufs[k] = rb->host + pages->offset[i + k];
+        }
+        pages->zero_bmap[BIT_WORD(i)] = buffer_is_zero_batch(bufs, n,
+                                                             page_size);
+    }
 }
 
 /**
@@ -49,33 +58,40 @@ void multifd_send_zero_page_detect(MultiFDSendParams *p)
 {
     MultiFDPages_t *pages = &p->data->u.ram;
     RAMBlock *rb = pages->block;
-    int i = 0;
-    int j = pages->num - 1;
+    unsigned long *zero = pages->zero_bmap;
+    uint32_t i, j;
 
     if (!multifd_zero_page_enabled()) {
         pages->normal_num = pages->num;
         goto out;
     }
 
+    multifd_zero_page_scan(pages);
+    pages->normal_num = pages->num - bitmap_count_one(zero, pages->num);
+
+    for (i = find_first_bit(zero, pages->num); i < pages->num;
+         i = find_next_bit(zero, pages->num, i + 1)) {
+        ram_release_page(rb->idstr, pages->offset[i]);
+    }
+
     /*
-     * Sort the page offset array by moving all normal pages to
-     * the left and all zero pages to the right of the array.
+     * Move all normal pages to the left and all zero pages to the right
+     * of the offset array, by swapping the zero pages found left of
+     * normal_num with the normal pages found right of it.
      */
-    while (i <= j) {
-        uint64_t offset = pages->offset[i];
+    i = find_first_bit(zero, pages->normal_num);
+    j = find_next_zero_bit(zero, pages->num, pages->normal_num);
+    while (i < pages->normal_num) {
+        ram_addr_t temp = pages->offset[i];
 
-        if (!buffer_is_zero(rb->host + offset, multifd_ram_page_size())) {
-            i++;
-            continue;
-        }
+        assert(j < pages->num);
+        pages->offset[i] = pages->offset[j];
+        pages->offset[j] = temp;
 
-        swap_page_offset(pages->offset, i, j);
-        ram_release_page(rb->idstr, offset);
-        j--;
+        i = find_next_bit(zero, pages->normal_num, i + 1);
+        j = find_next_zero_bit(zero, pages->num, j + 1);
     }
 
-    pages->normal_num = i;
-
 out:
     stat64_add(&mig_stats.normal_pages, pages->normal_num);
     stat64_add(&mig_stats.zero_pages, pages->num - pages->normal_num);
@@ -13,10 +13,12 @@
 #include "qemu/osdep.h"
 #include <zlib.h>
 #include "qemu/rcu.h"
+#include "qemu/timer.h"
 #include "system/ramblock.h"
 #include "exec/target_page.h"
 #include "qapi/error.h"
 #include "migration.h"
+#include "migration-stats.h"
 #include "trace.h"
 #include "options.h"
 #include "multifd.h"
@@ -30,8 +32,23 @@ struct zlib_data {
     uint32_t zbuff_len;
     /* uncompressed buffer of size qemu_target_page_size() */
     uint8_t *buf;
+    /* auto: compressed bytes per 1024 input bytes, moving average */
+    uint32_t auto_ratio;
+    /* auto: deflate() throughput in input bytes per second, moving average */
+    uint64_t auto_deflate_bps;
+    /* auto: packets sent uncompressed since the last compressed one */
+    uint32_t auto_skipped;
 };
 
+/*
+ * auto: compress at least one packet out of this many, so that the
+ * estimates follow changes in the guest memory contents.
+ */
+#define MULTIFD_AUTO_SAMPLE_INTERVAL 16
+
+/* auto: never compress if this doesn't save at least 1/8 of the data */
+#define MULTIFD_AUTO_MAX_RATIO (1024 - 128)
+
 /* Multifd zlib compression */
 
 static int multifd_zlib_send_setup(MultiFDSendParams *p, Error **errp)
@@ -92,7 +109,11 @@ static void multifd_zlib_send_cleanup(MultiFDSendParams *p, Error **errp)
     p->iov = NULL;
 }
 
-static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
+/*
+ * Compress the normal pages of the packet into z->zbuff and add them to
+ * p->iov.  The header must already have been prepared.
+ */
+static int multifd_zlib_compress(MultiFDSendParams *p, Error **errp)
 {
     MultiFDPages_t *pages = &p->data->u.ram;
     struct zlib_data *z = p->compress_data;
@@ -102,10 +123,6 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
     int ret;
     uint32_t i;
 
-    if (!multifd_send_prepare_common(p)) {
-        goto out;
-    }
-
     for (i = 0; i < pages->normal_num; i++) {
         uint32_t available = z->zbuff_len - out_size;
         int flush = Z_NO_FLUSH;
@@ -154,7 +171,17 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
     p->iovs_num++;
     p->next_packet_size = out_size;
 
-out:
+    return 0;
+}
+
+static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
+{
+    if (multifd_send_prepare_common(p)) {
+        if (multifd_zlib_compress(p, errp) < 0) {
+            return -1;
+        }
+    }
+
     p->flags |= MULTIFD_FLAG_ZLIB;
     multifd_send_fill_packet(p);
     return 0;
@@ -197,7 +224,7 @@ static void multifd_zlib_recv_cleanup(MultiFDRecvParams *p)
     p->compress_data = NULL;
 }
 
-static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
+static int multifd_zlib_decompress(MultiFDRecvParams *p, Error **errp)
 {
     struct zlib_data *z = p->compress_data;
     z_stream *zs = &z->zs;
@@ -206,18 +233,9 @@ static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
     uint32_t out_size = zs->total_out;
     uint32_t page_size = multifd_ram_page_size();
     uint32_t expected_size = p->normal_num * page_size;
-    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
     int ret;
     int i;
 
-    if (flags != MULTIFD_FLAG_ZLIB) {
-        error_setg(errp, "multifd %u: flags received %x flags expected %x",
-                   p->id, flags, MULTIFD_FLAG_ZLIB);
-        return -1;
-    }
-
-    multifd_recv_zero_page_process(p);
-
     if (!p->normal_num) {
         assert(in_size == 0);
         return 0;
@@ -277,6 +295,21 @@ static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
     return 0;
 }
 
+static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
+{
+    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
+
+    if (flags != MULTIFD_FLAG_ZLIB) {
+        error_setg(errp, "multifd %u: flags received %x flags expected %x",
+                   p->id, flags, MULTIFD_FLAG_ZLIB);
+        return -1;
+    }
+
+    multifd_recv_zero_page_process(p);
+
+    return multifd_zlib_decompress(p, errp);
+}
+
 static const MultiFDMethods multifd_zlib_ops = {
     .send_setup = multifd_zlib_send_setup,
     .send_cleanup = multifd_zlib_send_cleanup,
@@ -286,9 +319,157 @@ static const MultiFDMethods multifd_zlib_ops = {
     .recv = multifd_zlib_recv
 };
 
+/* Multifd auto compression: zlib or nothing, decided per packet */
+
+static int multifd_auto_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    if (multifd_zlib_send_setup(p, errp) < 0) {
+        return -1;
+    }
+
+    /* Uncompressed packets need one IOV per page plus the header */
+    g_free(p->iov);
+    p->iov = g_new0(struct iovec, multifd_ram_page_count() + 1);
+
+    return 0;
+}
+
+static uint64_t multifd_auto_average(uint64_t avg, uint64_t sample)
+{
+    return avg ? (avg * 7 + sample) / 8 : sample;
+}
+
+/*
+ * Compressing a packet of n bytes costs n / deflate_bps seconds of CPU
+ * time and then n * ratio / link_bps of transfer time, against n / link_bps
+ * for sending it as is.  So it pays off only when deflate() produces
+ * savings faster than the link can move the data.
+ */
+static bool multifd_auto_should_compress(struct zlib_data *z)
+{
+    double mbps;
+    uint64_t link_bps;
+
+    if (!z->auto_deflate_bps ||
+        z->auto_skipped >= MULTIFD_AUTO_SAMPLE_INTERVAL) {
+        return true;
+    }
+
+    if (z->auto_ratio > MULTIFD_AUTO_MAX_RATIO) {
+        return false;
+    }
+
+    /*
+     * The migration thread updates the throughput once per iteration;
+     * a slightly stale value is good enough here.
+     */
+    mbps = migrate_get_current()->mbps;
+    if (mbps <= 0) {
+        return true;
+    }
+    link_bps = mbps * 1000 * 1000 / 8 / migrate_multifd_channels();
+
+    return z->auto_deflate_bps * (1024 - z->auto_ratio) / 1024 > link_bps;
+}
+
+static int multifd_auto_send_prepare(MultiFDSendParams *p, Error **errp)
+{
+    MultiFDPages_t *pages = &p->data->u.ram;
+    struct zlib_data *z = p->compress_data;
+    uint64_t in_size;
+    int64_t start, ns;
+    bool compress;
+
+    if (!multifd_send_prepare_common(p)) {
+        p->flags |= MULTIFD_FLAG_NOCOMP;
+        goto out;
+    }
+
+    in_size = (uint64_t)pages->normal_num * multifd_ram_page_size();
+    compress = multifd_auto_should_compress(z);
+    if (compress) {
+        start = get_clock();
+        if (multifd_zlib_compress(p, errp) < 0) {
+            return -1;
+        }
+        ns = MAX(get_clock() - start, 1);
+
+        z->auto_ratio = multifd_auto_average(z->auto_ratio,
+                                             p->next_packet_size * 1024 /
+                                             in_size);
+        z->auto_deflate_bps =
+            multifd_auto_average(z->auto_deflate_bps,
+                                 in_size * NANOSECONDS_PER_SECOND / ns);
+        z->auto_skipped = 0;
+        p->flags |= MULTIFD_FLAG_ZLIB;
+        stat64_add(&mig_stats.multifd_compressed_pages, pages->normal_num);
+    } else {
+        multifd_send_prepare_iovs(p);
+        z->auto_skipped++;
+        p->flags |= MULTIFD_FLAG_NOCOMP;
+        stat64_add(&mig_stats.multifd_uncompressed_pages, pages->normal_num);
+    }
+    trace_multifd_auto_send(p->id, compress, z->auto_ratio,
+                            z->auto_deflate_bps);
+
+out:
+    multifd_send_fill_packet(p);
+    return 0;
+}
+
+static int multifd_auto_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    if (multifd_zlib_recv_setup(p, errp) < 0) {
+        return -1;
+    }
+
+    p->iov = g_new0(struct iovec, multifd_ram_page_count());
+    return 0;
+}
+
+static void multifd_auto_recv_cleanup(MultiFDRecvParams *p)
+{
+    multifd_zlib_recv_cleanup(p);
+    g_free(p->iov);
+    p->iov = NULL;
+}
+
+static int multifd_auto_recv(MultiFDRecvParams *p, Error **errp)
+{
+    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
+
+    if (flags != MULTIFD_FLAG_ZLIB && flags != MULTIFD_FLAG_NOCOMP) {
+        error_setg(errp, "multifd %u: flags received %x flags expected "
+                   "%x or %x", p->id, flags, MULTIFD_FLAG_ZLIB,
+                   MULTIFD_FLAG_NOCOMP);
+        return -1;
+    }
+
+    multifd_recv_zero_page_process(p);
+
+    /*
+     * Uncompressed packets don't touch the inflate stream, which stays
+     * in sync with the sender's deflate stream across them.
+     */
+    if (flags == MULTIFD_FLAG_ZLIB) {
+        return multifd_zlib_decompress(p, errp);
+    }
+    return multifd_recv_normal_pages(p, errp);
+}
+
+static const MultiFDMethods multifd_auto_ops = {
+    .send_setup = multifd_auto_send_setup,
+    .send_cleanup = multifd_zlib_send_cleanup,
+    .send_prepare = multifd_auto_send_prepare,
+    .recv_setup = multifd_auto_recv_setup,
+    .recv_cleanup = multifd_auto_recv_cleanup,
+    .recv = multifd_auto_recv
+};
+
 static void multifd_zlib_register(void)
 {
     multifd_register_ops(MULTIFD_COMPRESSION_ZLIB, &multifd_zlib_ops);
+    multifd_register_ops(MULTIFD_COMPRESSION_AUTO, &multifd_auto_ops);
 }
 
 migration_init(multifd_zlib_register);
@@ -27,6 +27,7 @@
 #include "socket.h"
 #include "tls.h"
 #include "qemu-file.h"
+#include "rdma.h"
 #include "trace.h"
 #include "multifd.h"
 #include "threadinfo.h"
@@ -914,6 +915,10 @@ static bool multifd_new_send_channel_create(gpointer opaque, Error **errp)
         return file_send_channel_create(opaque, errp);
     }
 
+    if (migrate_rdma()) {
+        return rdma_send_channel_create(opaque, errp);
+    }
+
     socket_send_channel_create(multifd_new_send_channel_async, opaque);
     return true;
 }
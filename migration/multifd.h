@@ -46,6 +46,8 @@ void multifd_recv_new_channel(QIOChannel *ioc, Error **errp);
 void multifd_recv_sync_main(void);
 int multifd_send_sync_main(MultiFDSyncReq req);
 bool multifd_queue_page(RAMBlock *block, ram_addr_t offset);
+bool multifd_queue_pages(RAMBlock *block, ram_addr_t offset,
+                         unsigned long npages);
 bool multifd_recv(void);
 MultiFDRecvData *multifd_get_recv_data(void);
 
@@ -127,6 +129,8 @@ typedef struct {
     RAMBlock *block;
     /* offset array of each page, managed by multifd */
     ram_addr_t *offset;
+    /* scratch bitmap for zero page detection, one bit per offset[] entry */
+    unsigned long *zero_bmap;
 } MultiFDPages_t;
 
 struct MultiFDRecvData {
@@ -379,8 +383,10 @@ typedef struct {
 void multifd_register_ops(int method, const MultiFDMethods *ops);
 void multifd_send_fill_packet(MultiFDSendParams *p);
 bool multifd_send_prepare_common(MultiFDSendParams *p);
+void multifd_send_prepare_iovs(MultiFDSendParams *p);
 void multifd_send_zero_page_detect(MultiFDSendParams *p);
 void multifd_recv_zero_page_process(MultiFDRecvParams *p);
+int multifd_recv_normal_pages(MultiFDRecvParams *p, Error **errp);
 
 void multifd_channel_connect(MultiFDSendParams *p, QIOChannel *ioc);
 bool multifd_send(MultiFDSendData **send_data);
@@ -85,6 +85,9 @@
 
 #define DEFAULT_MIGRATE_VCPU_DIRTY_LIMIT_PERIOD     1000    /* milliseconds */
 #define DEFAULT_MIGRATE_VCPU_DIRTY_LIMIT            1       /* MB/s */
+#define DEFAULT_MIGRATE_POSTCOPY_FAULT_AROUND       0
+#define MAX_MIGRATE_POSTCOPY_FAULT_AROUND           64  /* host pages */
+#define DEFAULT_MIGRATE_DIRTY_LIMIT_CONVERGENCE_TIME 0      /* ms */
 
 const Property migration_properties[] = {
     DEFINE_PROP_BOOL("store-global-state", MigrationState,
@@ -177,6 +180,12 @@ const Property migration_properties[] = {
     DEFINE_PROP_ZERO_PAGE_DETECTION("zero-page-detection", MigrationState,
                        parameters.zero_page_detection,
                        ZERO_PAGE_DETECTION_MULTIFD),
+    DEFINE_PROP_UINT8("postcopy-fault-around", MigrationState,
+                      parameters.postcopy_fault_around,
+                      DEFAULT_MIGRATE_POSTCOPY_FAULT_AROUND),
+    DEFINE_PROP_UINT64("dirty-limit-convergence-time", MigrationState,
+                       parameters.dirty_limit_convergence_time,
+                       DEFAULT_MIGRATE_DIRTY_LIMIT_CONVERGENCE_TIME),
 
     /* Migration capabilities */
     DEFINE_PROP_MIG_CAP("x-xbzrle", MIGRATION_CAPABILITY_XBZRLE),
@@ -456,10 +465,6 @@ bool migrate_rdma_caps_check(bool *caps, Error **errp)
         error_setg(errp, "RDMA and XBZRLE can't be used together");
         return false;
     }
-    if (caps[MIGRATION_CAPABILITY_MULTIFD]) {
-        error_setg(errp, "RDMA and multifd can't be used together");
-        return false;
-    }
     if (caps[MIGRATION_CAPABILITY_POSTCOPY_RAM]) {
         error_setg(errp, "RDMA and postcopy-ram can't be used together");
         return false;
@@ -874,6 +879,20 @@ ZeroPageDetection migrate_zero_page_detection(void)
     return s->parameters.zero_page_detection;
 }
 
+uint8_t migrate_postcopy_fault_around(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.postcopy_fault_around;
+}
+
+uint64_t migrate_dirty_limit_convergence_time(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.dirty_limit_convergence_time;
+}
+
 /* parameters helpers */
 
 AnnounceParameters *migrate_announce_params(void)
@@ -959,6 +978,11 @@ MigrationParameters *qmp_query_migrate_parameters(Error **errp)
     params->zero_page_detection = s->parameters.zero_page_detection;
     params->has_direct_io = true;
     params->direct_io = s->parameters.direct_io;
+    params->has_postcopy_fault_around = true;
+    params->postcopy_fault_around = s->parameters.postcopy_fault_around;
+    params->has_dirty_limit_convergence_time = true;
+    params->dirty_limit_convergence_time =
+        s->parameters.dirty_limit_convergence_time;
 
     return params;
 }
@@ -993,6 +1017,8 @@ void migrate_params_init(MigrationParameters *params)
     params->has_mode = true;
     params->has_zero_page_detection = true;
     params->has_direct_io = true;
+    params->has_postcopy_fault_around = true;
+    params->has_dirty_limit_convergence_time = true;
 }
 
 /*
@@ -1179,6 +1205,13 @@ bool migrate_params_check(MigrationParameters *params, Error **errp)
         return false;
     }
 
+    if (params->has_postcopy_fault_around &&
+        params->postcopy_fault_around > MAX_MIGRATE_POSTCOPY_FAULT_AROUND) {
+        error_setg(errp, QERR_INVALID_PARAMETER_VALUE,
+                   "postcopy_fault_around", "a value between 0 and 64");
+        return false;
+    }
+
     return true;
 }
 
@@ -1297,6 +1330,15 @@ static void migrate_params_test_apply(MigrateSetParameters *params,
     if (params->has_direct_io) {
         dest->direct_io = params->direct_io;
     }
+
+    if (params->has_postcopy_fault_around) {
+        dest->postcopy_fault_around = params->postcopy_fault_around;
+    }
+
+    if (params->has_dirty_limit_convergence_time) {
+        dest->dirty_limit_convergence_time =
+            params->dirty_limit_convergence_time;
+    }
 }
 
 static void migrate_params_apply(MigrateSetParameters *params, Error **errp)
@@ -1429,6 +1471,15 @@ static void migrate_params_apply(MigrateSetParameters *params, Error **errp)
     if (params->has_direct_io) {
         s->parameters.direct_io = params->direct_io;
     }
+
+    if (params->has_postcopy_fault_around) {
+        s->parameters.postcopy_fault_around = params->postcopy_fault_around;
+    }
+
+    if (params->has_dirty_limit_convergence_time) {
+        s->parameters.dirty_limit_convergence_time =
+            params->dirty_limit_convergence_time;
+    }
 }
 
 void qmp_migrate_set_parameters(MigrateSetParameters *params, Error **errp)
@@ -86,6 +86,8 @@ const char *migrate_tls_creds(void);
 const char *migrate_tls_hostname(void);
 uint64_t migrate_xbzrle_cache_size(void);
 ZeroPageDetection migrate_zero_page_detection(void);
+uint8_t migrate_postcopy_fault_around(void);
+uint64_t migrate_dirty_limit_convergence_time(void);
 
 /* parameters helpers */
 
@@ -22,6 +22,14 @@
 
 /* the page in cache will not be replaced in two cycles */
 #define CACHED_PAGE_LIFETIME 2
+/* number of pages an address can be cached in */
+#define CACHE_WAYS 4
+/*
+ * CLOCK replacement: a hit gives a page a reference, up to CACHE_REF_MAX,
+ * and the clock hand takes one back each time it passes the page, so a
+ * page dirtied repeatedly survives that many sweeps of its set.
+ */
+#define CACHE_REF_MAX 3
 
 typedef struct CacheItem CacheItem;
 
@@ -29,13 +37,18 @@ struct CacheItem {
     uint64_t it_addr;
     uint64_t it_age;
     uint8_t *it_data;
+    uint8_t it_ref;
 };
 
 struct PageCache {
     CacheItem *page_cache;
+    /* clock hand of each set */
+    uint8_t *hands;
     size_t page_size;
     size_t max_num_items;
     size_t num_items;
+    size_t num_ways;
+    size_t num_sets;
 };
 
 PageCache *cache_init(uint64_t new_size, size_t page_size, Error **errp)
@@ -66,14 +79,19 @@ PageCache *cache_init(uint64_t new_size, size_t page_size, Error **errp)
     cache->page_size = page_size;
     cache->num_items = 0;
     cache->max_num_items = num_pages;
+    cache->num_ways = MIN(CACHE_WAYS, num_pages);
+    cache->num_sets = num_pages / cache->num_ways;
 
     trace_migration_pagecache_init(cache->max_num_items);
 
     /* We prefer not to abort if there is no memory */
     cache->page_cache = g_try_malloc((cache->max_num_items) *
                                      sizeof(*cache->page_cache));
-    if (!cache->page_cache) {
+    cache->hands = g_try_malloc0(cache->num_sets);
+    if (!cache->page_cache || !cache->hands) {
         error_setg(errp, "Failed to allocate page cache");
+        g_free(cache->page_cache);
+        g_free(cache->hands);
         g_free(cache);
         return NULL;
     }
@@ -82,6 +100,7 @@ PageCache *cache_init(uint64_t new_size, size_t page_size, Error **errp)
         cache->page_cache[i].it_data = NULL;
         cache->page_cache[i].it_age = 0;
         cache->page_cache[i].it_addr = -1;
+        cache->page_cache[i].it_ref = 0;
     }
 
     return cache;
@@ -100,31 +119,81 @@ void cache_fini(PageCache *cache)
 
     g_free(cache->page_cache);
     cache->page_cache = NULL;
+    g_free(cache->hands);
     g_free(cache);
 }
 
-static size_t cache_get_cache_pos(const PageCache *cache,
-                                  uint64_t address)
+static size_t cache_get_set_pos(const PageCache *cache, uint64_t address)
 {
-    g_assert(cache->max_num_items);
-    return (address / cache->page_size) & (cache->max_num_items - 1);
+    g_assert(cache->num_sets);
+    return (address / cache->page_size) & (cache->num_sets - 1);
+}
+
+static CacheItem *cache_get_set(const PageCache *cache, size_t set_pos)
+{
+    return &cache->page_cache[set_pos * cache->num_ways];
 }
 
 static CacheItem *cache_get_by_addr(const PageCache *cache, uint64_t addr)
 {
-    size_t pos;
+    CacheItem *set;
+    size_t i;
 
     g_assert(cache);
     g_assert(cache->page_cache);
 
-    pos = cache_get_cache_pos(cache, addr);
+    set = cache_get_set(cache, cache_get_set_pos(cache, addr));
+    for (i = 0; i < cache->num_ways; i++) {
+        if (set[i].it_addr == addr) {
+            return &set[i];
+        }
+    }
 
-    return &cache->page_cache[pos];
+    return NULL;
+}
+
+/*
+ * Pick the item of @addr's set to replace: a free one if any, else the
+ * first one the clock hand finds without references and old enough.
+ * Returns NULL if every page of the set is still fresh.
+ */
+static CacheItem *cache_get_victim(PageCache *cache, uint64_t addr,
+                                   uint64_t current_age)
+{
+    size_t set_pos = cache_get_set_pos(cache, addr);
+    CacheItem *set = cache_get_set(cache, set_pos);
+    size_t i;
+
+    for (i = 0; i < cache->num_ways; i++) {
+        if (!set[i].it_data) {
+            return &set[i];
+        }
+    }
+
+    for (i = 0; i < cache->num_ways * (CACHE_REF_MAX + 1); i++) {
+        CacheItem *it = &set[cache->hands[set_pos]];
+
+        cache->hands[set_pos] = (cache->hands[set_pos] + 1) %
+                                cache->num_ways;
+        if (it->it_ref) {
+            it->it_ref--;
+            continue;
+        }
+        if (it->it_age + CACHED_PAGE_LIFETIME > current_age) {
+            /* the cache page is fresh, don't replace it */
+            continue;
+        }
+        return it;
+    }
+
+    return NULL;
 }
 
 uint8_t *get_cached_data(const PageCache *cache, uint64_t addr)
 {
-    return cache_get_by_addr(cache, addr)->it_data;
+    CacheItem *it = cache_get_by_addr(cache, addr);
+
+    return it ? it->it_data : NULL;
 }
 
 bool cache_is_cached(const PageCache *cache, uint64_t addr,
@@ -134,9 +203,12 @@ bool cache_is_cached(const PageCache *cache, uint64_t addr,
 
     it = cache_get_by_addr(cache, addr);
 
-    if (it->it_addr == addr) {
-        /* update the it_age when the cache hit */
+    if (it) {
+        /* update the it_age when the cache hit, and favor repeated hits */
         it->it_age = current_age;
+        if (it->it_ref < CACHE_REF_MAX) {
+            it->it_ref++;
+        }
         return true;
     }
     return false;
@@ -150,12 +222,14 @@ int cache_insert(PageCache *cache, uint64_t addr, const uint8_t *pdata,
 
     /* actual update of entry */
     it = cache_get_by_addr(cache, addr);
-
-    if (it->it_data && it->it_addr != addr &&
-        it->it_age + CACHED_PAGE_LIFETIME > current_age) {
-        /* the cache page is fresh, don't replace it */
-        return -1;
+    if (!it) {
+        it = cache_get_victim(cache, addr, current_age);
+        if (!it) {
+            return -1;
+        }
+        it->it_ref = 0;
     }
+
     /* allocate page */
     if (!it->it_data) {
         it->it_data = g_try_malloc(cache->page_size);
@@ -18,6 +18,8 @@
 
 #include "qemu/osdep.h"
 #include "qemu/madvise.h"
+#include "qemu/bitops.h"
+#include "qemu/host-utils.h"
 #include "exec/target_page.h"
 #include "migration.h"
 #include "qemu-file.h"
@@ -340,6 +342,13 @@ void fill_destination_postcopy_migration_info(MigrationInfo *info)
     uint64List *latency_buckets = NULL;
     int i;
 
+    if (migrate_postcopy_fault_around()) {
+        info->has_postcopy_prefetch_pages = true;
+        info->postcopy_prefetch_pages = mis->postcopy_prefetch_pages;
+        info->has_postcopy_prefetch_hits = true;
+        info->postcopy_prefetch_hits = mis->postcopy_prefetch_hits;
+    }
+
     if (!bc) {
         return;
     }
@@ -1266,6 +1275,129 @@ static void postcopy_pause_fault_thread(MigrationIncomingState *mis)
     trace_postcopy_pause_fault_thread_continued();
 }
 
+/*
+ * Per faulting thread state of the stride detector, keyed by the thread ID
+ * reported by userfaultfd (0 for all threads if the kernel doesn't have
+ * UFFD_FEATURE_THREAD_ID).
+ */
+typedef struct PostcopyFaultStride {
+    RAMBlock *rb;
+    ram_addr_t last_offset;
+    /* Distance between the last two faults in bytes, 0 if none */
+    int64_t stride;
+    /* Bit i set if the page at last_offset + (i + 1) * stride was requested */
+    uint64_t prefetched;
+    /* Number of pages along the stride covered by @prefetched */
+    unsigned window;
+} PostcopyFaultStride;
+
+/*
+ * Request a page nobody has faulted on yet.  Returns true if a request was
+ * sent, false if the page is already there or on its way.
+ */
+static bool postcopy_prefetch_page(MigrationIncomingState *mis, RAMBlock *rb,
+                                   ram_addr_t offset)
+{
+    void *aligned = rb->host + offset;
+
+    if (ramblock_page_is_discarded(rb, offset)) {
+        return false;
+    }
+
+    WITH_QEMU_LOCK_GUARD(&mis->page_request_mutex) {
+        if (ramblock_recv_bitmap_test_byte_offset(rb, offset) ||
+            g_tree_lookup(mis->page_requested, aligned)) {
+            return false;
+        }
+        g_tree_insert(mis->page_requested, aligned, (gpointer)1);
+        qatomic_inc(&mis->page_requested_count);
+        trace_postcopy_page_req_add(aligned, mis->page_requested_count);
+    }
+
+    /*
+     * If sending fails, the request stays in page_requested, and will be
+     * sent again when postcopy recovers.
+     */
+    migrate_send_rp_message_req_pages(mis, rb, offset);
+    return true;
+}
+
+/*
+ * Called after requesting the page at @offset that thread @ptid faulted on.
+ * If the thread's last faults were a constant stride apart, which includes
+ * the case where it walked through the pages we prefetched for the previous
+ * fault, request the next postcopy-fault-around pages along that stride too.
+ * They go through the same queue on the source as faulting pages, and thus
+ * on the preempt channel if postcopy-preempt is enabled.
+ */
+static void postcopy_fault_around(MigrationIncomingState *mis,
+                                  GHashTable *strides, RAMBlock *rb,
+                                  ram_addr_t offset, uint32_t ptid)
+{
+    unsigned window = migrate_postcopy_fault_around();
+    size_t pagesize = qemu_ram_pagesize(rb);
+    PostcopyFaultStride *fs;
+    bool confirmed = false;
+    int64_t delta;
+
+    if (!window) {
+        return;
+    }
+
+    fs = g_hash_table_lookup(strides, GUINT_TO_POINTER(ptid));
+    if (!fs) {
+        fs = g_new0(PostcopyFaultStride, 1);
+        g_hash_table_insert(strides, GUINT_TO_POINTER(ptid), fs);
+    }
+
+    delta = (int64_t)offset - (int64_t)fs->last_offset;
+    if (fs->rb == rb && fs->stride && delta % fs->stride == 0) {
+        int64_t k = delta / fs->stride;
+
+        if (k >= 1 && k <= fs->window + 1) {
+            /*
+             * The thread went through the first k - 1 pages along the
+             * stride without faulting, and the k-th one is either the page
+             * after the window or a prefetched page that is still in flight.
+             */
+            mis->postcopy_prefetch_hits +=
+                ctpop64(fs->prefetched & MAKE_64BIT_MASK(0, MIN(k, 64)));
+            confirmed = true;
+        }
+    }
+
+    if (!confirmed) {
+        fs->stride = 0;
+        if (fs->rb == rb && delta &&
+            llabs(delta) <= (int64_t)window * pagesize) {
+            fs->stride = delta;
+        }
+    }
+    fs->rb = rb;
+    fs->last_offset = offset;
+    fs->prefetched = 0;
+    fs->window = 0;
+
+    if (!confirmed) {
+        return;
+    }
+
+    for (unsigned i = 0; i < window; i++) {
+        int64_t next = (int64_t)offset + (int64_t)(i + 1) * fs->stride;
+
+        if (next < 0 || next + pagesize > rb->used_length) {
+            break;
+        }
+        if (postcopy_prefetch_page(mis, rb, next)) {
+            fs->prefetched |= 1ULL << i;
+            mis->postcopy_prefetch_pages++;
+        }
+        fs->window++;
+    }
+    trace_postcopy_fault_around(qemu_ram_get_idstr(rb), offset, fs->stride,
+                                ptid, ctpop64(fs->prefetched));
+}
+
 /*
  * Handle faults detected by the USERFAULT markings
  */
@@ -1284,6 +1416,8 @@ static void *postcopy_ram_fault_thread(void *opaque)
 
     struct pollfd *pfd;
     size_t pfd_len = 2 + mis->postcopy_remote_fds->len;
+    g_autoptr(GHashTable) strides = g_hash_table_new_full(NULL, NULL, NULL,
+                                                          g_free);
 
     pfd = g_new0(struct pollfd, pfd_len);
 
@@ -1397,6 +1531,9 @@ retry:
                 postcopy_pause_fault_thread(mis);
                 goto retry;
             }
+
+            postcopy_fault_around(mis, strides, rb, rb_offset,
+                                  msg.arg.pagefault.feat.ptid);
         }
 
         /* Now handle any requests from external processes on shared memory */
@@ -1539,6 +1676,9 @@ int postcopy_ram_incoming_setup(MigrationIncomingState *mis)
         mis->blocktime_ctx = blocktime_context_new();
     }
 
+    mis->postcopy_prefetch_pages = 0;
+    mis->postcopy_prefetch_hits = 0;
+
     /* Now an eventfd we use to tell the fault-thread to quit */
     mis->userfault_event_fd = eventfd(0, EFD_CLOEXEC);
     if (mis->userfault_event_fd == -1) {
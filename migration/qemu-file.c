@@ -507,6 +507,63 @@ void qemu_put_buffer_async(QEMUFile *f, const uint8_t *buf, size_t size,
     add_to_iovec(f, buf, size, may_free);
 }
 
+/*
+ * Buffers from this size on are written straight from the caller's memory
+ * instead of being copied into f->buf first.
+ */
+#define QEMU_FILE_DIRECT_MIN IO_BUF_SIZE
+
+static bool qemu_file_can_zero_copy(QEMUFile *f)
+{
+    return migrate_zero_copy_send() &&
+           qio_channel_has_feature(f->ioc, QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
+}
+
+/*
+ * Write a large buffer without copying it, e.g. device state blobs saved
+ * from a VMSTATE_BUFFER field.  The caller only guarantees @buf for the
+ * duration of the call, so everything queued is flushed before returning;
+ * with zero copy, wait for the kernel to be done with the pages too.
+ */
+static void qemu_put_buffer_direct(QEMUFile *f, const uint8_t *buf,
+                                   size_t size)
+{
+    struct iovec iov = { .iov_base = (uint8_t *)buf, .iov_len = size };
+    Error *local_error = NULL;
+    int ret;
+
+    trace_qemu_file_put_buffer_direct(size, qemu_file_can_zero_copy(f));
+
+    if (!qemu_file_can_zero_copy(f)) {
+        if (!add_to_iovec(f, buf, size, false)) {
+            qemu_fflush(f);
+        }
+        return;
+    }
+
+    if (qemu_fflush(f)) {
+        return;
+    }
+
+    if (qio_channel_writev_full_all(f->ioc, &iov, 1, NULL, 0,
+                                    QIO_CHANNEL_WRITE_FLAG_ZERO_COPY,
+                                    &local_error) < 0) {
+        qemu_file_set_error_obj(f, -EIO, local_error);
+        return;
+    }
+
+    ret = qio_channel_flush(f->ioc, &local_error);
+    if (ret < 0) {
+        qemu_file_set_error_obj(f, -EIO, local_error);
+        return;
+    }
+    if (ret == 1) {
+        stat64_add(&mig_stats.dirty_sync_missed_zero_copy, 1);
+    }
+
+    stat64_add(&mig_stats.qemu_file_transferred, size);
+}
+
 void qemu_put_buffer(QEMUFile *f, const uint8_t *buf, size_t size)
 {
     size_t l;
@@ -515,6 +572,11 @@ void qemu_put_buffer(QEMUFile *f, const uint8_t *buf, size_t size)
         return;
     }
 
+    if (size >= QEMU_FILE_DIRECT_MIN) {
+        qemu_put_buffer_direct(f, buf, size);
+        return;
+    }
+
     while (size > 0) {
         l = IO_BUF_SIZE - f->buf_index;
         if (l > size) {
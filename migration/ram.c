@@ -32,6 +32,7 @@
 #include "qemu/bitmap.h"
 #include "qemu/madvise.h"
 #include "qemu/main-loop.h"
+#include "qemu/units.h"
 #include "xbzrle.h"
 #include "ram.h"
 #include "migration.h"
@@ -59,6 +60,7 @@
 #include "system/runstate.h"
 #include "rdma.h"
 #include "options.h"
+#include "block/thread-pool.h"
 #include "system/dirtylimit.h"
 #include "system/kvm.h"
 
@@ -85,9 +87,11 @@
 
 /*
  * When doing mapped-ram migration, this is the amount we read from
- * the pages region in the migration file at a time.
+ * the pages region in the migration file at a time.  With multifd, each
+ * of these is handed to one recv thread, which may split it further into
+ * concurrent reads.
  */
-#define MAPPED_RAM_LOAD_BUF_SIZE 0x100000
+#define MAPPED_RAM_LOAD_BUF_SIZE 0x800000
 
 XBZRLECacheStats xbzrle_counters;
 
@@ -1004,6 +1008,21 @@ static void migration_update_rates(RAMState *rs, int64_t end_time)
     }
 }
 
+/*
+ * Total guest dirty page rate that lets the remaining dirty memory drain
+ * within the 'dirty-limit-convergence-time' at the current bandwidth.
+ * Like the dirty page rates it is compared with, it is in MiB/s.
+ */
+static uint64_t migration_dirty_limit_budget(uint64_t target_ms)
+{
+    MigrationState *s = migrate_get_current();
+    /* s->mbps is in 10^6 bits/s, and negative until first measured */
+    uint64_t bandwidth = MAX(s->mbps, 0) * 1000 * 1000 / 8 / MiB;
+    uint64_t drain = ram_bytes_remaining() / MiB * 1000 / target_ms;
+
+    return bandwidth > drain + 1 ? bandwidth - drain : 1;
+}
+
 /*
  * Enable dirty-limit to throttle down the guest
  */
@@ -1015,6 +1034,23 @@ static void migration_dirty_limit_guest(void)
      */
     static int64_t quota_dirtyrate;
     MigrationState *s = migrate_get_current();
+    uint64_t target_ms = migrate_dirty_limit_convergence_time();
+
+    if (target_ms) {
+        /*
+         * The budget follows the bandwidth and the remaining memory, so
+         * recompute it on every trigger; the per-vCPU quota is unused.
+         */
+        uint64_t budget = migration_dirty_limit_budget(target_ms);
+
+        quota_dirtyrate = 0;
+        qmp_set_vcpu_dirty_limit(false, -1, budget, NULL);
+        dirtylimit_set_budget(budget);
+        trace_migration_dirty_limit_budget(budget, target_ms);
+        return;
+    }
+
+    dirtylimit_set_budget(0);
 
     /*
      * If dirty limit already enabled and migration parameter
@@ -1986,8 +2022,8 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss)
     ram_addr_t offset = ((ram_addr_t)pss->page) << TARGET_PAGE_BITS;
     int res;
 
-    /* Hand over to RDMA first */
-    if (migrate_rdma()) {
+    /* Hand over to RDMA first, unless the pages go over multifd */
+    if (migrate_rdma() && !migrate_multifd()) {
         res = rdma_control_save_page(pss->pss_channel, pss->block->offset,
                                      offset, TARGET_PAGE_SIZE);
 
@@ -2131,6 +2167,62 @@ out:
     return ret;
 }
 
+/*
+ * Whether ram_save_host_page() may hand whole runs of dirty pages to
+ * multifd.  This is the case whenever each dirty page would end up in
+ * ram_save_multifd_page() anyway, and nothing needs to happen at host page
+ * granularity.
+ */
+static bool ram_save_multifd_run_possible(RAMState *rs)
+{
+    return migrate_multifd() &&
+        migrate_zero_page_detection() != ZERO_PAGE_DETECTION_LEGACY &&
+        !migration_in_postcopy() && !migrate_background_snapshot();
+}
+
+/*
+ * ram_save_multifd_run: queue a run of dirty pages to multifd
+ *
+ * Starting at pss->page, clears and queues the dirty pages up to the next
+ * clean one, or up to one multifd packet worth of pages.  This avoids
+ * going through the whole per-page search and save path, which otherwise
+ * dominates the migration thread for large guests.
+ *
+ * Returns the number of pages queued, or negative on error.
+ */
+static int ram_save_multifd_run(RAMState *rs, PageSearchStatus *pss)
+{
+    RAMBlock *block = pss->block;
+    unsigned long size = block->used_length >> TARGET_PAGE_BITS;
+    unsigned long start = pss->page;
+    unsigned long end, npages;
+
+    end = find_next_zero_bit(block->bmap,
+                             MIN(size, start + multifd_ram_page_count()),
+                             start);
+    npages = end - start;
+    if (!npages) {
+        pss_find_next_dirty(pss);
+        return 0;
+    }
+
+    /* See migration_bitmap_clear_dirty() */
+    if (!rs->last_stage) {
+        migration_clear_memory_region_dirty_bitmap_range(block, start,
+                                                         npages);
+    }
+    bitmap_clear(block->bmap, start, npages);
+    rs->migration_dirty_pages -= npages;
+
+    if (!multifd_queue_pages(block, (ram_addr_t)start << TARGET_PAGE_BITS,
+                             npages)) {
+        return -1;
+    }
+
+    pss->page = end;
+    return npages;
+}
+
 /**
  * ram_save_host_page: save a whole host page
  *
@@ -2166,6 +2258,10 @@ static int ram_save_host_page(RAMState *rs, PageSearchStatus *pss)
         return 0;
     }
 
+    if (ram_save_multifd_run_possible(rs)) {
+        return ram_save_multifd_run(rs, pss);
+    }
+
     /* Update host page boundary information */
     pss_host_page_prepare(pss);
 
@@ -2882,21 +2978,16 @@ static void ram_state_resume_prepare(RAMState *rs, QEMUFile *out)
 }
 
 /*
- * This function clears bits of the free pages reported by the caller from the
- * migration dirty bitmap. @addr is the host address corresponding to the
- * start of the continuous guest free pages, and @len is the total bytes of
- * those pages.
+ * Clear the bits of one range of free pages from the migration dirty bitmap.
+ * @addr is the host address of the start of the range and @len its length
+ * in bytes.  Returns false if the range is not backed by guest RAM.
+ * Called with the bitmap mutex held.
  */
-void qemu_guest_free_page_hint(void *addr, size_t len)
+static bool guest_free_page_hint_locked(void *addr, size_t len)
 {
     RAMBlock *block;
     ram_addr_t offset;
-    size_t used_len, start, npages;
-
-    /* This function is currently expected to be used during live migration */
-    if (!migration_is_running()) {
-        return;
-    }
+    size_t used_len, start, npages, cleared;
 
     for (; len > 0; len -= used_len, addr += used_len) {
         block = qemu_ram_block_from_host(addr, false, &offset);
@@ -2907,7 +2998,7 @@ void qemu_guest_free_page_hint(void *addr, size_t len)
              * updates. So we add a check here to capture that case.
              */
             error_report_once("%s unexpected error", __func__);
-            return;
+            return false;
         }
 
         if (len <= block->used_length - offset) {
@@ -2919,7 +3010,6 @@ void qemu_guest_free_page_hint(void *addr, size_t len)
         start = offset >> TARGET_PAGE_BITS;
         npages = used_len >> TARGET_PAGE_BITS;
 
-        qemu_mutex_lock(&ram_state->bitmap_mutex);
         /*
          * The skipped free pages are equavalent to be sent from clear_bmap's
          * perspective, so clear the bits from the memory region bitmap which
@@ -2927,10 +3017,56 @@ void qemu_guest_free_page_hint(void *addr, size_t len)
          * the next round after syncing from the memory region bitmap.
          */
         migration_clear_memory_region_dirty_bitmap_range(block, start, npages);
-        ram_state->migration_dirty_pages -=
-                      bitmap_count_one_with_offset(block->bmap, start, npages);
+        cleared = bitmap_count_one_with_offset(block->bmap, start, npages);
+        ram_state->migration_dirty_pages -= cleared;
+        stat64_add(&mig_stats.free_page_hint_pages, cleared);
         bitmap_clear(block->bmap, start, npages);
-        qemu_mutex_unlock(&ram_state->bitmap_mutex);
+    }
+
+    return true;
+}
+
+static int guest_free_page_hint_cmp(const void *a, const void *b)
+{
+    const struct iovec *ia = a, *ib = b;
+
+    if (ia->iov_base == ib->iov_base) {
+        return 0;
+    }
+    return ia->iov_base < ib->iov_base ? -1 : 1;
+}
+
+/*
+ * This function clears bits of the free pages reported by the caller from the
+ * migration dirty bitmap.  Each element of @iov holds the host address and
+ * length in bytes of a range of continuous guest free pages.  The array is
+ * sorted in place so that ranges adjacent in host memory are handled as one,
+ * and the whole batch is processed with a single acquisition of the bitmap
+ * mutex.
+ */
+void qemu_guest_free_page_hints(struct iovec *iov, unsigned int iovcnt)
+{
+    unsigned int i, j;
+
+    /* This function is currently expected to be used during live migration */
+    if (!migration_is_running() || !iovcnt) {
+        return;
+    }
+
+    qsort(iov, iovcnt, sizeof(*iov), guest_free_page_hint_cmp);
+
+    QEMU_LOCK_GUARD(&ram_state->bitmap_mutex);
+    for (i = 0; i < iovcnt; i = j) {
+        void *addr = iov[i].iov_base;
+        size_t len = iov[i].iov_len;
+
+        for (j = i + 1; j < iovcnt && iov[j].iov_base == addr + len; j++) {
+            len += iov[j].iov_len;
+        }
+
+        if (!guest_free_page_hint_locked(addr, len)) {
+            return;
+        }
     }
 }
 
@@ -3185,7 +3321,7 @@ static int ram_save_iterate(QEMUFile *f, void *opaque)
     /*
      * We'll take this lock a little bit long, but it's okay for two reasons.
      * Firstly, the only possible other thread to take it is who calls
-     * qemu_guest_free_page_hint(), which should be rare; secondly, see
+     * qemu_guest_free_page_hints(), which should be rare; secondly, see
      * MAX_WAIT (if curious, further see commit 4508bd9ed8053ce) below, which
      * guarantees that we'll at least released it in a regular basis.
      */
@@ -3571,6 +3707,10 @@ static void colo_init_ram_state(void)
     }
 }
 
+/* Used by colo_flush_ram_cache(), kept across checkpoints */
+static ThreadPool *colo_flush_pool;
+static GArray *colo_flush_ranges;
+
 /*
  * colo cache: this is for secondary VM, we cache the whole
  * memory of the secondary VM, it is need to hold the global lock
@@ -3666,6 +3806,12 @@ void colo_release_ram_cache(void)
         }
     }
     ram_state_cleanup(&ram_state);
+
+    g_clear_pointer(&colo_flush_pool, thread_pool_free);
+    if (colo_flush_ranges) {
+        g_array_free(colo_flush_ranges, true);
+        colo_flush_ranges = NULL;
+    }
 }
 
 /**
@@ -3892,6 +4038,86 @@ static bool postcopy_is_running(void)
     return ps >= POSTCOPY_INCOMING_LISTENING && ps < POSTCOPY_INCOMING_END;
 }
 
+/*
+ * The COLO cache is flushed by up to COLO_FLUSH_THREADS workers, one for
+ * every COLO_FLUSH_PARALLEL_MIN bytes of dirty memory.  Dirty ranges are
+ * split into COLO_FLUSH_CHUNK pieces so that the work spreads evenly.
+ */
+#define COLO_FLUSH_THREADS          8
+#define COLO_FLUSH_PARALLEL_MIN     (64 * MiB)
+#define COLO_FLUSH_CHUNK            (2 * MiB)
+
+typedef struct {
+    void *dst;
+    void *src;
+    size_t len;
+} ColoFlushRange;
+
+typedef struct {
+    ColoFlushRange *ranges;
+    guint num;
+} ColoFlushTask;
+
+static void colo_flush_ranges_copy(void *opaque)
+{
+    ColoFlushTask *task = opaque;
+
+    for (guint i = 0; i < task->num; i++) {
+        memcpy(task->ranges[i].dst, task->ranges[i].src, task->ranges[i].len);
+    }
+}
+
+static void colo_flush_range_add(void *dst, void *src, size_t len,
+                                 size_t *total)
+{
+    *total += len;
+
+    while (len) {
+        ColoFlushRange range = {
+            .dst = dst,
+            .src = src,
+            .len = MIN(len, COLO_FLUSH_CHUNK),
+        };
+
+        g_array_append_val(colo_flush_ranges, range);
+        dst += range.len;
+        src += range.len;
+        len -= range.len;
+    }
+}
+
+static void colo_flush_ranges_run(size_t total)
+{
+    ColoFlushRange *ranges = (ColoFlushRange *)colo_flush_ranges->data;
+    guint num = colo_flush_ranges->len;
+    guint nr_tasks, per_task;
+
+    nr_tasks = MIN(COLO_FLUSH_THREADS,
+                   DIV_ROUND_UP(total, COLO_FLUSH_PARALLEL_MIN));
+    if (nr_tasks <= 1) {
+        ColoFlushTask task = { .ranges = ranges, .num = num };
+
+        colo_flush_ranges_copy(&task);
+        return;
+    }
+
+    if (!colo_flush_pool) {
+        colo_flush_pool = thread_pool_new();
+    }
+    thread_pool_set_max_threads(colo_flush_pool, nr_tasks);
+
+    per_task = DIV_ROUND_UP(num, nr_tasks);
+    for (guint i = 0; i < num; i += per_task) {
+        ColoFlushTask *task = g_new(ColoFlushTask, 1);
+
+        task->ranges = ranges + i;
+        task->num = MIN(per_task, num - i);
+        thread_pool_submit(colo_flush_pool, colo_flush_ranges_copy,
+                           task, g_free);
+    }
+    thread_pool_wait(colo_flush_pool);
+}
+
 /*
  * Flush content of RAM cache into SVM's memory.
  * Only flush the pages that be dirtied by PVM or SVM or both.
@@ -3902,6 +4128,7 @@ void colo_flush_ram_cache(void)
     void *dst_host;
     void *src_host;
     unsigned long offset = 0;
+    size_t total = 0;
 
     memory_global_dirty_log_sync(false);
     qemu_mutex_lock(&ram_state->bitmap_mutex);
@@ -3912,6 +4139,11 @@ void colo_flush_ram_cache(void)
     }
 
     trace_colo_flush_ram_cache_begin(ram_state->migration_dirty_pages);
+    if (!colo_flush_ranges) {
+        colo_flush_ranges = g_array_new(false, false, sizeof(ColoFlushRange));
+    }
+    g_array_set_size(colo_flush_ranges, 0);
+
     WITH_RCU_READ_LOCK_GUARD() {
         block = QLIST_FIRST_RCU(&ram_list.blocks);
 
@@ -3934,13 +4166,16 @@ void colo_flush_ram_cache(void)
                          + (((ram_addr_t)offset) << TARGET_PAGE_BITS);
                 src_host = block->colo_cache
                          + (((ram_addr_t)offset) << TARGET_PAGE_BITS);
-                memcpy(dst_host, src_host, TARGET_PAGE_SIZE * num);
+                colo_flush_range_add(dst_host, src_host,
+                                     TARGET_PAGE_SIZE * num, &total);
                 offset += num;
             }
         }
+        qemu_mutex_unlock(&ram_state->bitmap_mutex);
+
+        colo_flush_ranges_run(total);
     }
-    qemu_mutex_unlock(&ram_state->bitmap_mutex);
-    trace_colo_flush_ram_cache_end();
+    trace_colo_flush_ram_cache_end(total, colo_flush_ranges->len);
 }
 
 static size_t ram_load_multifd_pages(void *host_addr, size_t size,
@@ -38,6 +38,9 @@
 #include "trace.h"
 #include "qom/object.h"
 #include "options.h"
+#include "multifd.h"
+#include "qapi/clone-visitor.h"
+#include "qapi/qapi-visit-sockets.h"
 #include <poll.h>
 
 #define RDMA_RESOLVE_TIMEOUT_MS 10000
@@ -2986,7 +2989,7 @@ qio_channel_rdma_shutdown(QIOChannel *ioc,
     RCU_READ_LOCK_GUARD();
 
     rdmain = qatomic_rcu_read(&rioc->rdmain);
-    rdmaout = qatomic_rcu_read(&rioc->rdmain);
+    rdmaout = qatomic_rcu_read(&rioc->rdmaout);
 
     switch (how) {
     case QIO_CHANNEL_SHUTDOWN_READ:
@@ -3126,6 +3129,9 @@ int rdma_control_save_page(QEMUFile *f, ram_addr_t block_offset,
 
 static void rdma_accept_incoming_migration(void *opaque);
 
+static void rdma_accept_multifd_channel(RDMAContext *listener,
+                                        struct rdma_cm_event *cm_event);
+
 static void rdma_cm_poll_handler(void *opaque)
 {
     RDMAContext *rdma = opaque;
@@ -3137,6 +3143,13 @@ static void rdma_cm_poll_handler(void *opaque)
         return;
     }
 
+    /* The multifd channels connect once the main channel is up */
+    if (cm_event->event == RDMA_CM_EVENT_CONNECT_REQUEST &&
+        migrate_multifd()) {
+        rdma_accept_multifd_channel(rdma, cm_event);
+        return;
+    }
+
     if (cm_event->event == RDMA_CM_EVENT_DISCONNECTED ||
         cm_event->event == RDMA_CM_EVENT_DEVICE_REMOVAL) {
         if (!rdma->errored &&
@@ -3654,7 +3667,7 @@ int rdma_block_notification_handle(QEMUFile *f, const char *name)
 
 int rdma_registration_start(QEMUFile *f, uint64_t flags)
 {
-    if (!migrate_rdma()) {
+    if (!migrate_rdma() || migrate_multifd()) {
         return 0;
     }
 
@@ -3686,7 +3699,7 @@ int rdma_registration_stop(QEMUFile *f, uint64_t flags)
     RDMAControlHeader head = { .len = 0, .repeat = 1 };
     int ret;
 
-    if (!migrate_rdma()) {
+    if (!migrate_rdma() || migrate_multifd()) {
         return 0;
     }
 
@@ -3838,28 +3851,189 @@ static void qio_channel_rdma_register_types(void)
 
 type_init(qio_channel_rdma_register_types);
 
-static QEMUFile *rdma_new_input(RDMAContext *rdma)
+static QIOChannelRDMA *rdma_new_ioc(RDMAContext *rdmain,
+                                    RDMAContext *rdmaout)
 {
     QIOChannelRDMA *rioc = QIO_CHANNEL_RDMA(object_new(TYPE_QIO_CHANNEL_RDMA));
 
+    rioc->rdmain = rdmain;
+    rioc->rdmaout = rdmaout;
+
+    return rioc;
+}
+
+static QEMUFile *rdma_new_input(RDMAContext *rdma)
+{
+    QIOChannelRDMA *rioc = rdma_new_ioc(rdma, rdma->return_path);
+
     rioc->file = qemu_file_new_input(QIO_CHANNEL(rioc));
-    rioc->rdmain = rdma;
-    rioc->rdmaout = rdma->return_path;
 
     return rioc->file;
 }
 
 static QEMUFile *rdma_new_output(RDMAContext *rdma)
 {
-    QIOChannelRDMA *rioc = QIO_CHANNEL_RDMA(object_new(TYPE_QIO_CHANNEL_RDMA));
+    QIOChannelRDMA *rioc = rdma_new_ioc(rdma->return_path, rdma);
 
     rioc->file = qemu_file_new_output(QIO_CHANNEL(rioc));
-    rioc->rdmaout = rdma;
-    rioc->rdmain = rdma->return_path;
 
     return rioc->file;
 }
 
+/*
+ * Accept a multifd channel connecting to the migration listener.  The
+ * channel gets its own queue pair and, so that its thread can wait on
+ * it without stealing the listener's connection requests, its own CM
+ * event channel.  Multifd packets go over it as a byte stream, like the
+ * main channel's QEMUFile data.
+ */
+static void rdma_accept_multifd_channel(RDMAContext *listener,
+                                        struct rdma_cm_event *cm_event)
+{
+    RDMACapabilities cap;
+    struct rdma_conn_param conn_param = {
+                                            .responder_resources = 2,
+                                            .private_data = &cap,
+                                            .private_data_len = sizeof(cap),
+                                         };
+    g_autoptr(InetSocketAddress) isock = g_new0(InetSocketAddress, 1);
+    struct rdma_cm_id *cm_id = cm_event->id;
+    QIOChannelRDMA *rioc;
+    RDMAContext *rdma;
+    Error *err = NULL;
+    int ret;
+
+    memcpy(&cap, cm_event->param.conn.private_data, sizeof(cap));
+    rdma_ack_cm_event(cm_event);
+
+    network_to_caps(&cap);
+    if (cap.version < 1 || cap.version > RDMA_CONTROL_VERSION_CURRENT) {
+        error_report("Unknown source RDMA version: %d, bailing...",
+                     cap.version);
+        rdma_destroy_id(cm_id);
+        return;
+    }
+
+    isock->host = g_strdup(listener->host);
+    isock->port = g_strdup_printf("%d", listener->port);
+    rdma = qemu_rdma_data_init(isock, NULL);
+
+    rdma->channel = rdma_create_event_channel();
+    if (!rdma->channel) {
+        error_report("rdma multifd: could not create CM channel");
+        rdma_destroy_id(cm_id);
+        goto err;
+    }
+
+    rdma->cm_id = cm_id;
+    if (rdma_migrate_id(cm_id, rdma->channel) < 0) {
+        error_report("rdma multifd: could not move CM id to its channel");
+        goto err;
+    }
+    rdma->verbs = cm_id->verbs;
+
+    ret = qemu_rdma_alloc_pd_cq(rdma, &err);
+    if (ret < 0) {
+        error_report_err(err);
+        goto err;
+    }
+
+    ret = qemu_rdma_alloc_qp(rdma);
+    if (ret < 0) {
+        error_report("rdma multifd: error allocating qp!");
+        goto err;
+    }
+
+    qemu_rdma_init_ram_blocks(rdma);
+
+    for (int i = 0; i < RDMA_WRID_MAX; i++) {
+        ret = qemu_rdma_reg_control(rdma, i);
+        if (ret < 0) {
+            error_report("rdma multifd: error registering %d control", i);
+            goto err;
+        }
+    }
+
+    /* multifd pages are not RDMA written, there is nothing to pin */
+    cap.flags = 0;
+    caps_to_network(&cap);
+
+    ret = rdma_accept(rdma->cm_id, &conn_param);
+    if (ret < 0) {
+        error_report("rdma multifd: rdma_accept failed");
+        goto err;
+    }
+
+    ret = rdma_get_cm_event(rdma->channel, &cm_event);
+    if (ret < 0) {
+        error_report("rdma multifd: rdma_accept get_cm_event failed");
+        goto err;
+    }
+
+    if (cm_event->event != RDMA_CM_EVENT_ESTABLISHED) {
+        error_report("rdma multifd: rdma_accept not event established");
+        rdma_ack_cm_event(cm_event);
+        goto err;
+    }
+
+    rdma_ack_cm_event(cm_event);
+    rdma->connected = true;
+
+    ret = qemu_rdma_post_recv_control(rdma, RDMA_WRID_READY, &err);
+    if (ret < 0) {
+        error_report_err(err);
+        goto err;
+    }
+
+    trace_rdma_accept_multifd_channel();
+
+    rioc = rdma_new_ioc(rdma, NULL);
+    migration_ioc_process_incoming(QIO_CHANNEL(rioc), &err);
+    object_unref(OBJECT(rioc));
+    if (err) {
+        error_report_err(err);
+    }
+    return;
+
+err:
+    rdma->errored = true;
+    qemu_rdma_cleanup(rdma);
+    g_free(rdma);
+}
+
+/* Where rdma_send_channel_create() connects the multifd channels to */
+static InetSocketAddress *rdma_outgoing_addr;
+
+bool rdma_send_channel_create(gpointer opaque, Error **errp)
+{
+    RDMAContext *rdma;
+    bool ret = false;
+
+    rdma = qemu_rdma_data_init(rdma_outgoing_addr, errp);
+
+    if (qemu_rdma_source_init(rdma, false, errp) < 0) {
+        goto out;
+    }
+
+    if (qemu_rdma_connect(rdma, false, errp) < 0) {
+        goto out;
+    }
+
+    trace_rdma_send_channel_create();
+
+    multifd_channel_connect(opaque, QIO_CHANNEL(rdma_new_ioc(NULL, rdma)));
+    ret = true;
+
+out:
+    if (!ret) {
+        g_free(rdma);
+    }
+    /* Like with files, creation is synchronous */
+    multifd_send_channel_created();
+
+    return ret;
+}
+
 static void rdma_accept_incoming_migration(void *opaque)
 {
     RDMAContext *rdma = opaque;
@@ -3877,6 +4051,23 @@ static void rdma_accept_incoming_migration(void *opaque)
         return;
     }
 
+    if (migrate_multifd()) {
+        QIOChannelRDMA *rioc = rdma_new_ioc(rdma, rdma->return_path);
+        Error *err = NULL;
+
+        rdma->migration_started_on_destination = 1;
+        /*
+         * The guest RAM comes over the multifd channels, so the load can
+         * only start once they are all connected.
+         */
+        migration_ioc_process_incoming(QIO_CHANNEL(rioc), &err);
+        object_unref(OBJECT(rioc));
+        if (err) {
+            error_report_err(err);
+        }
+        return;
+    }
+
     f = rdma_new_input(rdma);
     if (f == NULL) {
         error_report("RDMA ERROR: could not open RDMA for input");
@@ -3997,6 +4188,9 @@ void rdma_start_outgoing_migration(void *opaque,
 
     trace_rdma_start_outgoing_migration_after_rdma_connect();
 
+    qapi_free_InetSocketAddress(rdma_outgoing_addr);
+    rdma_outgoing_addr = QAPI_CLONE(InetSocketAddress, host_port);
+
     s->to_dst_file = rdma_new_output(rdma);
     s->rdma_migration = true;
     migration_connect(s, NULL);
@@ -42,6 +42,7 @@ int rdma_registration_stop(QEMUFile *f, uint64_t flags);
 int rdma_block_notification_handle(QEMUFile *f, const char *name);
 int rdma_control_save_page(QEMUFile *f, ram_addr_t block_offset,
                            ram_addr_t offset, size_t size);
+bool rdma_send_channel_create(gpointer opaque, Error **errp);
 #else
 static inline
 int rdma_registration_handle(QEMUFile *f) { return 0; }
@@ -57,5 +58,10 @@ int rdma_control_save_page(QEMUFile *f, ram_addr_t block_offset,
 {
     g_assert_not_reached();
 }
+static inline
+bool rdma_send_channel_create(gpointer opaque, Error **errp)
+{
+    g_assert_not_reached();
+}
 #endif
 #endif
@@ -71,6 +71,7 @@
 #include "yank_functions.h"
 #include "system/qtest.h"
 #include "options.h"
+#include "downtime-trace.h"
 
 const unsigned int postcopy_ram_discard_version;
 
@@ -1616,8 +1617,8 @@ int qemu_savevm_state_complete_precopy_iterable(QEMUFile *f, bool in_postcopy)
         }
         end_ts_each = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
 
-        trace_vmstate_downtime_save("iterable", se->idstr, se->instance_id,
-                                    end_ts_each - start_ts_each);
+        migration_downtime_save("iterable", se->idstr, se->instance_id,
+                                start_ts_each, end_ts_each);
     }
 
     if (multifd_device_state) {
@@ -1631,7 +1632,7 @@ int qemu_savevm_state_complete_precopy_iterable(QEMUFile *f, bool in_postcopy)
         }
     }
 
-    trace_vmstate_downtime_checkpoint("src-iterable-saved");
+    migration_downtime_checkpoint("src-iterable-saved");
 
     return 0;
 
@@ -1675,8 +1676,8 @@ int qemu_savevm_state_complete_precopy_non_iterable(QEMUFile *f,
         }
 
         end_ts_each = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
-        trace_vmstate_downtime_save("non-iterable", se->idstr, se->instance_id,
-                                    end_ts_each - start_ts_each);
+        migration_downtime_save("non-iterable", se->idstr, se->instance_id,
+                                start_ts_each, end_ts_each);
     }
 
     if (!in_postcopy) {
@@ -1694,7 +1695,7 @@ int qemu_savevm_state_complete_precopy_non_iterable(QEMUFile *f,
         }
     }
 
-    trace_vmstate_downtime_checkpoint("src-non-iterable-saved");
+    migration_downtime_checkpoint("src-non-iterable-saved");
 
     return 0;
 }
@@ -2227,18 +2228,18 @@ static void loadvm_postcopy_handle_run_bh(void *opaque)
 {
     MigrationIncomingState *mis = opaque;
 
-    trace_vmstate_downtime_checkpoint("dst-postcopy-bh-enter");
+    migration_downtime_checkpoint("dst-postcopy-bh-enter");
 
     /* TODO we should move all of this lot into postcopy_ram.c or a shared code
      * in migration.c
      */
     cpu_synchronize_all_post_init();
 
-    trace_vmstate_downtime_checkpoint("dst-postcopy-bh-cpu-synced");
+    migration_downtime_checkpoint("dst-postcopy-bh-cpu-synced");
 
     qemu_announce_self(&mis->announce_timer, migrate_announce_params());
 
-    trace_vmstate_downtime_checkpoint("dst-postcopy-bh-announced");
+    migration_downtime_checkpoint("dst-postcopy-bh-announced");
 
     dirty_bitmap_mig_before_vm_start();
 
@@ -2249,7 +2250,7 @@ static void loadvm_postcopy_handle_run_bh(void *opaque)
          */
         bool success = migration_block_activate(NULL);
 
-        trace_vmstate_downtime_checkpoint("dst-postcopy-bh-cache-invalidated");
+        migration_downtime_checkpoint("dst-postcopy-bh-cache-invalidated");
 
         if (success) {
             vm_start();
@@ -2259,7 +2260,7 @@ static void loadvm_postcopy_handle_run_bh(void *opaque)
         runstate_set(RUN_STATE_PAUSED);
     }
 
-    trace_vmstate_downtime_checkpoint("dst-postcopy-bh-vm-started");
+    migration_downtime_checkpoint("dst-postcopy-bh-vm-started");
 }
 
 /* After all discards we can start running and asking for pages */
@@ -2749,8 +2750,8 @@ qemu_loadvm_section_start_full(QEMUFile *f, uint8_t type)
 
     if (trace_downtime) {
         end_ts = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
-        trace_vmstate_downtime_load("non-iterable", se->idstr,
-                                    se->instance_id, end_ts - start_ts);
+        migration_downtime_load("non-iterable", se->idstr,
+                                se->instance_id, start_ts, end_ts);
     }
 
     if (!check_section_footer(f, se)) {
@@ -2802,8 +2803,8 @@ qemu_loadvm_section_part_end(QEMUFile *f, uint8_t type)
 
     if (trace_downtime) {
         end_ts = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
-        trace_vmstate_downtime_load("iterable", se->idstr,
-                                    se->instance_id, end_ts - start_ts);
+        migration_downtime_load("iterable", se->idstr,
+                                se->instance_id, start_ts, end_ts);
     }
 
     if (!check_section_footer(f, se)) {
@@ -131,6 +131,111 @@ static void vmstate_handle_alloc(void *ptr, const VMStateField *field,
     }
 }
 
+/*
+ * Width in bytes of an element of a plain array of fixed-width integers,
+ * or 0 if the field has to go through the per-element VMStateInfo hooks.
+ * Such arrays are sent as one big-endian blob, which is byte for byte what
+ * the put/get hooks would produce, without a call per element.
+ */
+static int vmstate_bulk_width(const VMStateField *field, int size)
+{
+    int width;
+
+    if (field->flags & (VMS_STRUCT | VMS_VSTRUCT | VMS_ARRAY_OF_POINTER)) {
+        return 0;
+    }
+
+    if (field->info == &vmstate_info_uint8 ||
+        field->info == &vmstate_info_int8) {
+        width = 1;
+    } else if (field->info == &vmstate_info_uint16 ||
+               field->info == &vmstate_info_int16) {
+        width = 2;
+    } else if (field->info == &vmstate_info_uint32 ||
+               field->info == &vmstate_info_int32) {
+        width = 4;
+    } else if (field->info == &vmstate_info_uint64 ||
+               field->info == &vmstate_info_int64) {
+        width = 8;
+    } else {
+        return 0;
+    }
+
+    return width == size ? width : 0;
+}
+
+#define VMSTATE_BULK_CHUNK 256
+
+static void vmstate_put_bulk(QEMUFile *f, const void *elems, int n_elems,
+                             int width)
+{
+    uint8_t buf[VMSTATE_BULK_CHUNK * sizeof(uint64_t)];
+    const uint8_t *p = elems;
+
+    if (width == 1) {
+        qemu_put_buffer(f, p, n_elems);
+        return;
+    }
+
+    while (n_elems) {
+        int i, n = MIN(n_elems, VMSTATE_BULK_CHUNK);
+
+        switch (width) {
+        case 2:
+            for (i = 0; i < n; i++) {
+                stw_be_p(buf + i * 2, lduw_he_p(p + i * 2));
+            }
+            break;
+        case 4:
+            for (i = 0; i < n; i++) {
+                stl_be_p(buf + i * 4, ldl_he_p(p + i * 4));
+            }
+            break;
+        case 8:
+            for (i = 0; i < n; i++) {
+                stq_be_p(buf + i * 8, ldq_he_p(p + i * 8));
+            }
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        qemu_put_buffer(f, buf, n * width);
+        p += n * width;
+        n_elems -= n;
+    }
+}
+
+static void vmstate_get_bulk(QEMUFile *f, void *elems, int n_elems, int width)
+{
+    uint8_t *p = elems;
+    int i;
+
+    qemu_get_buffer(f, p, n_elems * width);
+
+    /* Swap in place; a short read is caught by qemu_file_get_error() */
+    switch (width) {
+    case 1:
+        break;
+    case 2:
+        for (i = 0; i < n_elems; i++) {
+            stw_he_p(p + i * 2, lduw_be_p(p + i * 2));
+        }
+        break;
+    case 4:
+        for (i = 0; i < n_elems; i++) {
+            stl_he_p(p + i * 4, ldl_be_p(p + i * 4));
+        }
+        break;
+    case 8:
+        for (i = 0; i < n_elems; i++) {
+            stq_he_p(p + i * 8, ldq_be_p(p + i * 8));
+        }
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
 int vmstate_load_state(QEMUFile *f, const VMStateDescription *vmsd,
                        void *opaque, int version_id)
 {
@@ -165,12 +270,25 @@ int vmstate_load_state(QEMUFile *f, const VMStateDescription *vmsd,
             void *first_elem = opaque + field->offset;
             int i, n_elems = vmstate_n_elems(opaque, field);
             int size = vmstate_size(opaque, field);
+            int width;
 
             vmstate_handle_alloc(first_elem, field, opaque);
             if (field->flags & VMS_POINTER) {
                 first_elem = *(void **)first_elem;
                 assert(first_elem || !n_elems || !size);
             }
+            width = vmstate_bulk_width(field, size);
+            if (width && n_elems > 1) {
+                vmstate_get_bulk(f, first_elem, n_elems, width);
+                ret = qemu_file_get_error(f);
+                if (ret < 0) {
+                    error_report("Failed to load %s:%s", vmsd->name,
+                                 field->name);
+                    trace_vmstate_load_field_error(field->name, ret);
+                    return ret;
+                }
+                n_elems = 0;
+            }
             for (i = 0; i < n_elems; i++) {
                 void *curr_elem = first_elem + size * i;
                 const VMStateField *inner_field;
@@ -423,6 +541,7 @@ int vmstate_save_state_v(QEMUFile *f, const VMStateDescription *vmsd,
             void *first_elem = opaque + field->offset;
             int i, n_elems = vmstate_n_elems(opaque, field);
             int size = vmstate_size(opaque, field);
+            int width;
             uint64_t old_offset, written_bytes;
             JSONWriter *vmdesc_loop = vmdesc;
             bool is_prev_null = false;
@@ -433,6 +552,16 @@ int vmstate_save_state_v(QEMUFile *f, const VMStateDescription *vmsd,
                 assert(first_elem || !n_elems || !size);
             }
 
+            width = vmstate_bulk_width(field, size);
+            if (width && n_elems > 1 &&
+                (!vmdesc || vmsd_can_compress(field))) {
+                /* Describe it like a compressed array of single elements */
+                vmsd_desc_field_start(vmsd, vmdesc, field, 0, n_elems);
+                vmstate_put_bulk(f, first_elem, n_elems, width);
+                vmsd_desc_field_end(vmsd, vmdesc, field, width);
+                n_elems = 0;
+            }
+
             for (i = 0; i < n_elems; i++) {
                 void *curr_elem = first_elem + size * i;
                 const VMStateField *inner_field;
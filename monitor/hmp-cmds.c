@@ -98,13 +98,20 @@ void hmp_sync_profile(Monitor *mon, const QDict *qdict)
     const char *op = qdict_get_try_str(qdict, "op");
 
     if (op == NULL) {
-        bool on = qsp_is_enabled();
+        const char *state = "off";
 
-        monitor_printf(mon, "sync-profile is %s\n", on ? "on" : "off");
+        if (qsp_is_contended_only()) {
+            state = "contended";
+        } else if (qsp_is_enabled()) {
+            state = "on";
+        }
+        monitor_printf(mon, "sync-profile is %s\n", state);
         return;
     }
     if (!strcmp(op, "on")) {
         qsp_enable();
+    } else if (!strcmp(op, "contended")) {
+        qsp_enable_contended();
     } else if (!strcmp(op, "off")) {
         qsp_disable();
     } else if (!strcmp(op, "reset")) {
@@ -113,7 +120,7 @@ void hmp_sync_profile(Monitor *mon, const QDict *qdict)
         Error *err = NULL;
 
         error_setg(&err, "invalid parameter '%s',"
-                   " expecting 'on', 'off', or 'reset'", op);
+                   " expecting 'on', 'contended', 'off', or 'reset'", op);
         hmp_handle_error(mon, err);
     }
 }
@@ -202,6 +209,22 @@ void hmp_info_iothreads(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "  poll-shrink=%" PRId64 "\n", value->poll_shrink);
         monitor_printf(mon, "  aio-max-batch=%" PRId64 "\n",
                        value->aio_max_batch);
+        if (value->has_cpu_time_ns) {
+            monitor_printf(mon, "  cpu-time-ns=%" PRIu64 "\n",
+                           value->cpu_time_ns);
+        }
+        if (value->has_poll_time_ns) {
+            monitor_printf(mon, "  poll-time-ns=%" PRIu64 "\n",
+                           value->poll_time_ns);
+            monitor_printf(mon, "  wait-time-ns=%" PRIu64 "\n",
+                           value->wait_time_ns);
+            monitor_printf(mon, "  bh-time-ns=%" PRIu64 "\n",
+                           value->bh_time_ns);
+            monitor_printf(mon, "  handler-time-ns=%" PRIu64 "\n",
+                           value->handler_time_ns);
+            monitor_printf(mon, "  timer-time-ns=%" PRIu64 "\n",
+                           value->timer_time_ns);
+        }
     }
 
     qapi_free_IOThreadInfoList(info_list);
@@ -42,6 +42,15 @@
  */
 #define NBD_MAX_BLOCK_STATUS_EXTENTS (1 * MiB / 8)
 
+/*
+ * Read payloads smaller than NBD_ZERO_COPY_MIN_SIZE are cheaper to copy
+ * than to pin.  At most NBD_ZERO_COPY_MAX_PENDING bytes of buffers are
+ * held per client waiting for the kernel to release them; beyond that
+ * replies fall back to the copy path rather than waiting.
+ */
+#define NBD_ZERO_COPY_MIN_SIZE (16 * KiB)
+#define NBD_ZERO_COPY_MAX_PENDING (16 * MiB)
+
 static int system_errno_to_nbd_errno(int err)
 {
     switch (err) {
@@ -83,6 +92,11 @@ struct NBDRequestData {
     NBDClient *client;
     uint8_t *data;
     bool complete;
+
+    /* Zero-copy sends of @data, see nbd_request_put() */
+    ssize_t zero_copy_seq;
+    size_t zero_copy_len;
+    QSIMPLEQ_ENTRY(NBDRequestData) zero_copy_next;
 };
 
 struct NBDExport {
@@ -99,6 +113,7 @@ struct NBDExport {
     Notifier eject_notifier;
 
     bool allocation_depth;
+    bool zero_copy;
     BdrvDirtyBitmap **export_bitmaps;
     size_t nr_export_bitmaps;
 };
@@ -149,6 +164,11 @@ struct NBDClient {
 
     uint32_t check_align; /* If non-zero, check for aligned client requests */
 
+    bool zero_copy; /* Send read payloads with MSG_ZEROCOPY */
+    /* Requests whose data the kernel may still reference */
+    QSIMPLEQ_HEAD(, NBDRequestData) zero_copy_reqs; /* protected by lock */
+    size_t zero_copy_pending; /* atomic, written under lock */
+
     NBDMode mode;
     NBDMetaContexts contexts; /* Negotiated meta contexts */
 
@@ -1560,6 +1580,54 @@ void nbd_client_get(NBDClient *client)
     qatomic_inc(&client->refcount);
 }
 
+/*
+ * Release the buffers of requests whose zero-copy sends the kernel has
+ * completed.  Runs in export AioContext with client->lock held.
+ */
+static void nbd_zero_copy_reap(NBDClient *client)
+{
+    NBDRequestData *req;
+    Error *local_err = NULL;
+
+    if (QSIMPLEQ_EMPTY(&client->zero_copy_reqs)) {
+        return;
+    }
+
+    if (qio_channel_socket_zero_copy_poll(client->sioc, &local_err) < 0) {
+        /* Keep the buffers until the client goes away */
+        trace_nbd_zero_copy_poll_fail(error_get_pretty(local_err));
+        error_free(local_err);
+        client->zero_copy = false;
+        return;
+    }
+
+    while ((req = QSIMPLEQ_FIRST(&client->zero_copy_reqs)) &&
+           req->zero_copy_seq <= client->sioc->zero_copy_sent) {
+        QSIMPLEQ_REMOVE_HEAD(&client->zero_copy_reqs, zero_copy_next);
+        qatomic_set(&client->zero_copy_pending,
+                    client->zero_copy_pending - req->zero_copy_len);
+        qemu_vfree(req->data);
+        g_free(req);
+    }
+}
+
+/*
+ * Called when the last reference to @client is gone.  The kernel holds its
+ * own references to pages still being transmitted, so freeing them early is
+ * safe once nobody can look at the socket any more.
+ */
+static void nbd_zero_copy_free_all(NBDClient *client)
+{
+    NBDRequestData *req;
+
+    while ((req = QSIMPLEQ_FIRST(&client->zero_copy_reqs))) {
+        QSIMPLEQ_REMOVE_HEAD(&client->zero_copy_reqs, zero_copy_next);
+        qemu_vfree(req->data);
+        g_free(req);
+    }
+    client->zero_copy_pending = 0;
+}
+
 void nbd_client_put(NBDClient *client)
 {
     assert(qemu_in_main_thread());
@@ -1581,6 +1649,7 @@ void nbd_client_put(NBDClient *client)
             blk_exp_unref(&client->exp->common);
         }
         g_free(client->contexts.bitmaps);
+        nbd_zero_copy_free_all(client);
         qemu_mutex_destroy(&client->lock);
         g_free(client);
     }
@@ -1653,10 +1722,17 @@ static void nbd_request_put(NBDRequestData *req)
 {
     NBDClient *client = req->client;
 
-    if (req->data) {
+    nbd_zero_copy_reap(client);
+
+    if (req->data && req->zero_copy_seq > client->sioc->zero_copy_sent) {
+        /* The kernel may still be reading from req->data */
+        QSIMPLEQ_INSERT_TAIL(&client->zero_copy_reqs, req, zero_copy_next);
+        qatomic_set(&client->zero_copy_pending,
+                    client->zero_copy_pending + req->zero_copy_len);
+    } else {
         qemu_vfree(req->data);
+        g_free(req);
     }
-    g_free(req);
 
     client->nb_requests--;
 
@@ -1931,6 +2007,7 @@ static int nbd_export_create(BlockExport *blk_exp, BlockExportOptions *exp_args,
     }
 
     exp->allocation_depth = arg->allocation_depth;
+    exp->zero_copy = arg->zero_copy;
 
     /*
      * We need to inhibit request queuing in the block layer to ensure we can
@@ -2049,6 +2126,43 @@ static int coroutine_fn nbd_co_send_iov(NBDClient *client, struct iovec *iov,
     return ret;
 }
 
+/*
+ * Like nbd_co_send_iov(), but the last element of @iov is a read payload
+ * that may be sent with QIO_CHANNEL_WRITE_FLAG_ZERO_COPY.  The headers
+ * usually live on the stack and are always copied.  A payload sent this
+ * way stays referenced by the kernel after returning; nbd_trip() notices
+ * and keeps the request buffer alive accordingly.
+ */
+static int coroutine_fn nbd_co_send_iov_payload(NBDClient *client,
+                                                struct iovec *iov,
+                                                unsigned niov, Error **errp)
+{
+    struct iovec *payload = &iov[niov - 1];
+    int ret;
+
+    if (!client->zero_copy || payload->iov_len < NBD_ZERO_COPY_MIN_SIZE ||
+        qatomic_read(&client->zero_copy_pending) >=
+        NBD_ZERO_COPY_MAX_PENDING) {
+        return nbd_co_send_iov(client, iov, niov, errp);
+    }
+
+    g_assert(qemu_in_coroutine());
+    qemu_co_mutex_lock(&client->send_lock);
+    client->send_coroutine = qemu_coroutine_self();
+
+    ret = qio_channel_writev_all(client->ioc, iov, niov - 1, errp);
+    if (ret == 0) {
+        ret = qio_channel_writev_full_all(client->ioc, payload, 1, NULL, 0,
+                                          QIO_CHANNEL_WRITE_FLAG_ZERO_COPY,
+                                          errp);
+    }
+
+    client->send_coroutine = NULL;
+    qemu_co_mutex_unlock(&client->send_lock);
+
+    return ret < 0 ? -EIO : 0;
+}
+
 static inline void set_be_simple_reply(NBDSimpleReply *reply, uint64_t error,
                                        uint64_t cookie)
 {
@@ -2080,7 +2194,7 @@ static int coroutine_fn nbd_co_send_simple_reply(NBDClient *client,
                                    nbd_err_lookup(nbd_err), len);
     set_be_simple_reply(&reply, nbd_err, request->cookie);
 
-    return nbd_co_send_iov(client, iov, 2, errp);
+    return nbd_co_send_iov_payload(client, iov, 2, errp);
 }
 
 /*
@@ -2161,7 +2275,7 @@ static int coroutine_fn nbd_co_send_chunk_read(NBDClient *client,
                  NBD_REPLY_TYPE_OFFSET_DATA, request);
     stq_be_p(&chunk.offset, offset);
 
-    return nbd_co_send_iov(client, iov, 3, errp);
+    return nbd_co_send_iov_payload(client, iov, 3, errp);
 }
 
 static int coroutine_fn nbd_co_send_chunk_error(NBDClient *client,
@@ -3145,7 +3259,19 @@ static coroutine_fn void nbd_trip(void *opaque)
                                      error_get_pretty(export_err), &local_err);
         error_free(export_err);
     } else {
+        ssize_t zero_copy_queued = client->sioc->zero_copy_queued;
+
         ret = nbd_handle_request(client, &request, req->data, &local_err);
+
+        if (request.type == NBD_CMD_READ &&
+            client->sioc->zero_copy_queued != zero_copy_queued) {
+            /*
+             * Some of the sends may have come from concurrent requests;
+             * waiting for all of them is conservative but correct.
+             */
+            req->zero_copy_seq = client->sioc->zero_copy_queued;
+            req->zero_copy_len = request.len;
+        }
     }
     if (request.contexts && request.contexts != &client->contexts) {
         assert(request.type == NBD_CMD_BLOCK_STATUS);
@@ -3253,6 +3379,14 @@ static coroutine_fn void nbd_co_client_start(void *opaque)
     }
 
     timer_free(handshake_timer);
+
+    /* Zero copy is not possible if TLS has to encrypt the data */
+    client->zero_copy = client->exp && client->exp->zero_copy &&
+        client->ioc == QIO_CHANNEL(client->sioc) &&
+        qio_channel_has_feature(client->ioc,
+                                QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
+    trace_nbd_co_client_start_zero_copy(client->zero_copy);
+
     WITH_QEMU_LOCK_GUARD(&client->lock) {
         nbd_client_receive_next_request(client);
     }
@@ -3276,6 +3410,7 @@ void nbd_client_new(QIOChannelSocket *sioc,
 
     client = g_new0(NBDClient, 1);
     qemu_mutex_init(&client->lock);
+    QSIMPLEQ_INIT(&client->zero_copy_reqs);
     client->refcount = 1;
     client->tlscreds = tlscreds;
     if (tlscreds) {
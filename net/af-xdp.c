@@ -51,6 +51,7 @@ typedef struct AFXDPState {
 
     uint32_t             xdp_flags;
     bool                 inhibit;
+    uint32_t             busy_poll_budget;
 
     char                 *map_path;
     int                  map_fd;
@@ -59,6 +60,16 @@ typedef struct AFXDPState {
 
 #define AF_XDP_BATCH_SIZE 64
 
+/* How long a single busy-poll syscall may spin, in microseconds. */
+#define AF_XDP_BUSY_POLL_USECS 20
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+
 static void af_xdp_send(void *opaque);
 static void af_xdp_writable(void *opaque);
 
@@ -224,6 +235,14 @@ static void af_xdp_send(void *opaque)
     uint32_t i, n_rx, idx = 0;
     AFXDPState *s = opaque;
 
+    if (s->busy_poll_budget) {
+        /*
+         * With preferred busy polling the device interrupts are deferred,
+         * so it is up to us to drive the NAPI context of the queue.
+         */
+        recvfrom(xsk_socket__fd(s->xsk), NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+
     n_rx = xsk_ring_cons__peek(&s->rx, AF_XDP_BATCH_SIZE, &idx);
     if (!n_rx) {
         return;
@@ -403,6 +422,40 @@ static int af_xdp_socket_create(AFXDPState *s,
     return 0;
 }
 
+static int af_xdp_busy_poll_setup(AFXDPState *s, Error **errp)
+{
+    int fd, val;
+
+    if (!s->busy_poll_budget) {
+        return 0;
+    }
+
+    fd = xsk_socket__fd(s->xsk);
+
+    val = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &val, sizeof(val))) {
+        goto err;
+    }
+
+    val = AF_XDP_BUSY_POLL_USECS;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val))) {
+        goto err;
+    }
+
+    val = s->busy_poll_budget;
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &val, sizeof(val))) {
+        goto err;
+    }
+
+    return 0;
+
+err:
+    error_setg_errno(errp, errno,
+                     "failed to enable busy polling for %s queue_index: %d",
+                     s->ifname, s->nc.queue_index);
+    return -1;
+}
+
 static int af_xdp_update_xsk_map(AFXDPState *s, Error **errp)
 {
     int xsk_fd, idx, error = 0;
@@ -481,6 +534,7 @@ int net_init_af_xdp(const Netdev *netdev,
     const NetdevAFXDPOptions *opts = &netdev->u.af_xdp;
     NetClientState *nc, *nc0 = NULL;
     int32_t map_start_index;
+    int64_t busy_poll_budget;
     unsigned int ifindex;
     uint32_t prog_id = 0;
     g_autofree int *sock_fds = NULL;
@@ -528,6 +582,13 @@ int net_init_af_xdp(const Netdev *netdev,
         return -1;
     }
 
+    busy_poll_budget = opts->has_busy_poll_budget ? opts->busy_poll_budget : 0;
+    if (busy_poll_budget < 0 || busy_poll_budget > UINT16_MAX) {
+        error_setg(errp, "invalid 'busy-poll-budget' (%" PRIi64 "),"
+                   " must be between 0 and %d", busy_poll_budget, UINT16_MAX);
+        return -1;
+    }
+
     if (opts->sock_fds) {
         sock_fds = parse_socket_fds(opts->sock_fds, queues, errp);
         if (!sock_fds) {
@@ -553,9 +614,11 @@ int net_init_af_xdp(const Netdev *netdev,
         s->map_path = g_strdup(opts->map_path);
         s->map_start_index = map_start_index;
         s->map_fd = -1;
+        s->busy_poll_budget = busy_poll_budget;
 
         if (af_xdp_umem_create(s, sock_fds ? sock_fds[i] : -1, &err) ||
             af_xdp_socket_create(s, opts, &err) ||
+            af_xdp_busy_poll_setup(s, &err) ||
             af_xdp_update_xsk_map(s, &err)) {
             goto err;
         }
@@ -21,22 +21,45 @@
 
 uint32_t net_checksum_add_cont(int len, uint8_t *buf, int seq)
 {
-    uint32_t sum1 = 0, sum2 = 0;
-    int i;
+    uint64_t sum = 0;
+    bool swap;
+    int i = 0;
 
-    for (i = 0; i < len - 1; i += 2) {
-        sum1 += (uint32_t)buf[i];
-        sum2 += (uint32_t)buf[i + 1];
+    /*
+     * The ones' complement sum is independent of byte order up to a final
+     * byte swap, so accumulate host-endian 32-bit words into a 64-bit sum
+     * (which cannot overflow for any int length) and fix the order up at
+     * the end.  Four independent loads per iteration let the compiler
+     * vectorize the loop.
+     */
+    for (; i + 16 <= len; i += 16) {
+        sum += (uint64_t)ldl_he_p(buf + i) + ldl_he_p(buf + i + 4) +
+               ldl_he_p(buf + i + 8) + ldl_he_p(buf + i + 12);
     }
-    if (i < len) {
-        sum1 += (uint32_t)buf[i];
+    for (; i + 4 <= len; i += 4) {
+        sum += ldl_he_p(buf + i);
     }
+    if (i < len) {
+        uint8_t tail[4] = { 0 };
 
-    if (seq & 1) {
-        return sum1 + (sum2 << 8);
-    } else {
-        return sum2 + (sum1 << 8);
+        memcpy(tail, buf + i, len - i);
+        sum += ldl_he_p(tail);
     }
+
+    /* Fold to 16 bits; a non-zero sum never folds to zero. */
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+
+    /*
+     * Data at an even offset of the checksummed chunk is summed as
+     * big-endian 16-bit words.
+     */
+    swap = (seq & 1) ? HOST_BIG_ENDIAN : !HOST_BIG_ENDIAN;
+
+    return swap ? bswap16(sum) : sum;
 }
 
 uint16_t net_checksum_finish(uint32_t sum)
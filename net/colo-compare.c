@@ -18,6 +18,7 @@
 #include "qapi/error.h"
 #include "net/net.h"
 #include "net/eth.h"
+#include "net/checksum.h"
 #include "qom/object_interfaces.h"
 #include "qemu/iov.h"
 #include "qom/object.h"
@@ -343,6 +344,40 @@ static int colo_compare_packet_payload(Packet *ppkt,
     return memcmp(ppkt->data + poffset, spkt->data + soffset, len);
 }
 
+/*
+ * Fingerprint of the data from @offset to the end of the packet, computed
+ * once per packet.  A packet is always compared from the same offset, which
+ * only depends on its own headers.
+ */
+static uint16_t colo_packet_payload_sum(Packet *pkt, uint16_t offset)
+{
+    if (!pkt->payload_sum_valid) {
+        pkt->payload_sum = net_checksum_add(pkt->size - offset,
+                                            (uint8_t *)pkt->data + offset);
+        pkt->payload_sum_valid = true;
+    }
+
+    return pkt->payload_sum;
+}
+
+/*
+ * Compare two packets of the same size from @poffset and @soffset to the
+ * end.  When a primary packet is searched for in a long secondary list,
+ * the fingerprints reject most candidates without touching their data.
+ */
+static int colo_compare_packet_tail(Packet *ppkt, Packet *spkt,
+                                    uint16_t poffset, uint16_t soffset)
+{
+    if (poffset == soffset &&
+        colo_packet_payload_sum(ppkt, poffset) !=
+        colo_packet_payload_sum(spkt, soffset)) {
+        return -1;
+    }
+
+    return colo_compare_packet_payload(ppkt, spkt, poffset, poffset,
+                                       ppkt->size - poffset);
+}
+
 /*
  * return true means that the payload is consist and
  * need to make the next comparison, false means do
@@ -500,14 +535,18 @@ sec:
 }
 
 
+static uint16_t colo_packet_ip_payload_offset(Packet *pkt)
+{
+    return (pkt->ip->ip_hl << 2) + ETH_HLEN + pkt->vnet_hdr_len;
+}
+
 /*
  * Called from the compare thread on the primary
  * for compare udp packet
  */
 static int colo_packet_compare_udp(Packet *spkt, Packet *ppkt)
 {
-    uint16_t network_header_length = ppkt->ip->ip_hl << 2;
-    uint16_t offset = network_header_length + ETH_HLEN + ppkt->vnet_hdr_len;
+    uint16_t offset = colo_packet_ip_payload_offset(ppkt);
 
     trace_colo_compare_main("compare udp");
 
@@ -525,8 +564,8 @@ static int colo_packet_compare_udp(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("UDP: payload size of packets are different");
         return -1;
     }
-    if (colo_compare_packet_payload(ppkt, spkt, offset, offset,
-                                    ppkt->size - offset)) {
+    if (colo_compare_packet_tail(ppkt, spkt, offset,
+                                 colo_packet_ip_payload_offset(spkt))) {
         trace_colo_compare_udp_miscompare("primary pkt size", ppkt->size);
         trace_colo_compare_udp_miscompare("Secondary pkt size", spkt->size);
 #ifdef DEBUG_COLO_PACKETS
@@ -545,8 +584,7 @@ static int colo_packet_compare_udp(Packet *spkt, Packet *ppkt)
  */
 static int colo_packet_compare_icmp(Packet *spkt, Packet *ppkt)
 {
-    uint16_t network_header_length = ppkt->ip->ip_hl << 2;
-    uint16_t offset = network_header_length + ETH_HLEN + ppkt->vnet_hdr_len;
+    uint16_t offset = colo_packet_ip_payload_offset(ppkt);
 
     trace_colo_compare_main("compare icmp");
 
@@ -564,8 +602,8 @@ static int colo_packet_compare_icmp(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("ICMP: payload size of packets are different");
         return -1;
     }
-    if (colo_compare_packet_payload(ppkt, spkt, offset, offset,
-                                    ppkt->size - offset)) {
+    if (colo_compare_packet_tail(ppkt, spkt, offset,
+                                 colo_packet_ip_payload_offset(spkt))) {
         trace_colo_compare_icmp_miscompare("primary pkt size",
                                            ppkt->size);
         trace_colo_compare_icmp_miscompare("Secondary pkt size",
@@ -593,8 +631,7 @@ static int colo_packet_compare_other(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("Other: payload size of packets are different");
         return -1;
     }
-    return colo_compare_packet_payload(ppkt, spkt, offset, offset,
-                                       ppkt->size - offset);
+    return colo_compare_packet_tail(ppkt, spkt, offset, spkt->vnet_hdr_len);
 }
 
 static int colo_old_packet_check_one(Packet *pkt, int64_t *check_time)
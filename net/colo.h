@@ -55,6 +55,9 @@ typedef struct Packet {
     /* record the payload offset(the length that has been compared) */
     uint16_t offset;
     uint8_t flags; /* Flags(aka Control bits) */
+    /* ones' complement sum of the compared payload, if payload_sum_valid */
+    bool payload_sum_valid;
+    uint16_t payload_sum;
 } Packet;
 
 typedef struct ConnectionKey {
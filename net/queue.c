@@ -40,11 +40,22 @@
  * unbounded queueing.
  */
 
+/*
+ * Packets that fit in NET_PACKET_POOL_BUFSIZE bytes are allocated with that
+ * fixed capacity and recycled through a small per-queue free list instead
+ * of going back to the allocator.  Queues that hold packets at all tend to
+ * do so for bursts (COLO, filter-buffer, a stalled peer), so this avoids a
+ * malloc/free pair per packet in the common case of MTU-sized frames.
+ */
+#define NET_PACKET_POOL_BUFSIZE 2048
+#define NET_PACKET_POOL_MAX     64
+
 struct NetPacket {
     QTAILQ_ENTRY(NetPacket) entry;
     NetClientState *sender;
     unsigned flags;
     int size;
+    bool pooled;
     NetPacketSent *sent_cb;
     uint8_t data[];
 };
@@ -57,9 +68,45 @@ struct NetQueue {
 
     QTAILQ_HEAD(, NetPacket) packets;
 
+    QTAILQ_HEAD(, NetPacket) free_packets;
+    uint32_t nq_free_count;
+
     unsigned delivering : 1;
 };
 
+static NetPacket *qemu_net_queue_packet_alloc(NetQueue *queue, size_t size)
+{
+    NetPacket *packet;
+
+    if (size > NET_PACKET_POOL_BUFSIZE) {
+        packet = g_malloc(sizeof(NetPacket) + size);
+        packet->pooled = false;
+        return packet;
+    }
+
+    packet = QTAILQ_FIRST(&queue->free_packets);
+    if (packet) {
+        QTAILQ_REMOVE(&queue->free_packets, packet, entry);
+        queue->nq_free_count--;
+        return packet;
+    }
+
+    packet = g_malloc(sizeof(NetPacket) + NET_PACKET_POOL_BUFSIZE);
+    packet->pooled = true;
+    return packet;
+}
+
+static void qemu_net_queue_packet_free(NetQueue *queue, NetPacket *packet)
+{
+    if (packet->pooled && queue->nq_free_count < NET_PACKET_POOL_MAX) {
+        QTAILQ_INSERT_HEAD(&queue->free_packets, packet, entry);
+        queue->nq_free_count++;
+        return;
+    }
+
+    g_free(packet);
+}
+
 NetQueue *qemu_new_net_queue(NetQueueDeliverFunc *deliver, void *opaque)
 {
     NetQueue *queue;
@@ -72,6 +119,7 @@ NetQueue *qemu_new_net_queue(NetQueueDeliverFunc *deliver, void *opaque)
     queue->deliver = deliver;
 
     QTAILQ_INIT(&queue->packets);
+    QTAILQ_INIT(&queue->free_packets);
 
     queue->delivering = 0;
 
@@ -87,6 +135,11 @@ void qemu_del_net_queue(NetQueue *queue)
         g_free(packet);
     }
 
+    QTAILQ_FOREACH_SAFE(packet, &queue->free_packets, entry, next) {
+        QTAILQ_REMOVE(&queue->free_packets, packet, entry);
+        g_free(packet);
+    }
+
     g_free(queue);
 }
 
@@ -102,7 +155,7 @@ static void qemu_net_queue_append(NetQueue *queue,
     if (queue->nq_count >= queue->nq_maxlen && !sent_cb) {
         return; /* drop if queue full and no callback */
     }
-    packet = g_malloc(sizeof(NetPacket) + size);
+    packet = qemu_net_queue_packet_alloc(queue, size);
     packet->sender = sender;
     packet->flags = flags;
     packet->size = size;
@@ -131,7 +184,7 @@ void qemu_net_queue_append_iov(NetQueue *queue,
         max_len += iov[i].iov_len;
     }
 
-    packet = g_malloc(sizeof(NetPacket) + max_len);
+    packet = qemu_net_queue_packet_alloc(queue, max_len);
     packet->sender = sender;
     packet->sent_cb = sent_cb;
     packet->flags = flags;
@@ -254,7 +307,7 @@ void qemu_net_queue_purge(NetQueue *queue, NetClientState *from)
             if (packet->sent_cb) {
                 packet->sent_cb(packet->sender, 0);
             }
-            g_free(packet);
+            qemu_net_queue_packet_free(queue, packet);
         }
     }
 }
@@ -287,7 +340,7 @@ bool qemu_net_queue_flush(NetQueue *queue)
             packet->sent_cb(packet->sender, ret);
         }
 
-        g_free(packet);
+        qemu_net_queue_packet_free(queue, packet);
     }
     return true;
 }
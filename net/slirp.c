@@ -42,6 +42,7 @@
 #include "chardev/char-fe.h"
 #include "system/system.h"
 #include "qemu/cutils.h"
+#include "qemu/defer-call.h"
 #include "qapi/error.h"
 #include "qobject/qdict.h"
 #include "util.h"
@@ -375,8 +376,14 @@ static void net_slirp_poll_notify(Notifier *notifier, void *data)
         break;
     case MAIN_LOOP_POLL_OK:
     case MAIN_LOOP_POLL_ERR:
+        /*
+         * A single poll can emit many packets to the guest, e.g. a TCP
+         * window worth of segments.  Let the peer batch its notifications.
+         */
+        defer_call_begin();
         slirp_pollfds_poll(s->slirp, poll->state == MAIN_LOOP_POLL_ERR,
                            net_slirp_get_revents, poll->pollfds);
+        defer_call_end();
         break;
     default:
         g_assert_not_reached();
@@ -39,6 +39,7 @@
 #include "system/system.h"
 #include "qapi/error.h"
 #include "qemu/cutils.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
 #include "qemu/sockets.h"
@@ -180,6 +181,9 @@ static void tap_send(void *opaque)
     int size;
     int packets = 0;
 
+    /* Let the peer batch its guest notifications over the whole burst */
+    defer_call_begin();
+
     while (true) {
         uint8_t *buf = s->buf;
         uint8_t min_pkt[ETH_ZLEN];
@@ -226,6 +230,8 @@ static void tap_send(void *opaque)
             break;
         }
     }
+
+    defer_call_end();
 }
 
 static bool tap_has_ufo(NetClientState *nc)
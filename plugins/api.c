@@ -179,6 +179,26 @@ void qemu_plugin_register_vcpu_mem_cb(struct qemu_plugin_insn *insn,
     plugin_register_vcpu_mem_cb(&insn->mem_cbs, cb, flags, rw, udata);
 }
 
+void qemu_plugin_register_vcpu_mem_cond_cb(struct qemu_plugin_insn *insn,
+                                           qemu_plugin_vcpu_mem_cb_t cb,
+                                           enum qemu_plugin_cb_flags flags,
+                                           enum qemu_plugin_mem_rw rw,
+                                           enum qemu_plugin_cond cond,
+                                           qemu_plugin_u64 entry,
+                                           uint64_t imm,
+                                           void *udata)
+{
+    if (cond == QEMU_PLUGIN_COND_NEVER) {
+        return;
+    }
+    if (cond == QEMU_PLUGIN_COND_ALWAYS) {
+        qemu_plugin_register_vcpu_mem_cb(insn, cb, flags, rw, udata);
+        return;
+    }
+    plugin_register_vcpu_mem_cond_cb(&insn->mem_cbs, cb, flags, rw,
+                                     cond, entry, imm, udata);
+}
+
 void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
     struct qemu_plugin_insn *insn,
     enum qemu_plugin_mem_rw rw,
@@ -424,11 +424,7 @@ void plugin_register_dyn_cond_cb__udata(GArray **arr,
     dyn_cb->cond = cond_cb;
 }
 
-void plugin_register_vcpu_mem_cb(GArray **arr,
-                                 void *cb,
-                                 enum qemu_plugin_cb_flags flags,
-                                 enum qemu_plugin_mem_rw rw,
-                                 void *udata)
+static TCGHelperInfo *plugin_mem_cb_info(enum qemu_plugin_cb_flags flags)
 {
     /*
      * Expect that the underlying type for enum qemu_plugin_meminfo_t
@@ -456,15 +452,47 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
     };
     assert((unsigned)flags < ARRAY_SIZE(info));
 
+    return &info[flags];
+}
+
+void plugin_register_vcpu_mem_cb(GArray **arr,
+                                 void *cb,
+                                 enum qemu_plugin_cb_flags flags,
+                                 enum qemu_plugin_mem_rw rw,
+                                 void *udata)
+{
+    TCGHelperInfo *info = plugin_mem_cb_info(flags);
     struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
     struct qemu_plugin_regular_cb regular_cb = { .userp = udata,
                                                  .rw = rw,
                                                  .f.vcpu_mem = cb,
-                                                 .info = &info[flags] };
+                                                 .info = info };
     dyn_cb->type = PLUGIN_CB_MEM_REGULAR;
     dyn_cb->regular = regular_cb;
 }
 
+void plugin_register_vcpu_mem_cond_cb(GArray **arr,
+                                      void *cb,
+                                      enum qemu_plugin_cb_flags flags,
+                                      enum qemu_plugin_mem_rw rw,
+                                      enum qemu_plugin_cond cond,
+                                      qemu_plugin_u64 entry,
+                                      uint64_t imm,
+                                      void *udata)
+{
+    TCGHelperInfo *info = plugin_mem_cb_info(flags);
+    struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
+    struct qemu_plugin_conditional_cb cond_cb = { .userp = udata,
+                                                  .rw = rw,
+                                                  .f.vcpu_mem = cb,
+                                                  .cond = cond,
+                                                  .entry = entry,
+                                                  .imm = imm,
+                                                  .info = info };
+    dyn_cb->type = PLUGIN_CB_MEM_COND;
+    dyn_cb->cond = cond_cb;
+}
+
 /*
  * Disable CFI checks.
  * The callback function has been loaded from an external library so we do not
@@ -611,6 +639,33 @@ void exec_inline_op(enum plugin_dyn_cb_type type,
     }
 }
 
+static bool plugin_cond_holds(struct qemu_plugin_conditional_cb *cb,
+                              int cpu_index)
+{
+    char *ptr = cb->entry.score->data->data;
+    size_t elem_size = g_array_get_element_size(cb->entry.score->data);
+    uint64_t val = *(uint64_t *)(ptr + cb->entry.offset +
+                                 cpu_index * elem_size);
+
+    switch (cb->cond) {
+    case QEMU_PLUGIN_COND_EQ:
+        return val == cb->imm;
+    case QEMU_PLUGIN_COND_NE:
+        return val != cb->imm;
+    case QEMU_PLUGIN_COND_LT:
+        return val < cb->imm;
+    case QEMU_PLUGIN_COND_LE:
+        return val <= cb->imm;
+    case QEMU_PLUGIN_COND_GT:
+        return val > cb->imm;
+    case QEMU_PLUGIN_COND_GE:
+        return val >= cb->imm;
+    default:
+        /* ALWAYS and NEVER conditions should never reach */
+        g_assert_not_reached();
+    }
+}
+
 void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                              uint64_t value_low,
                              uint64_t value_high,
@@ -642,6 +697,18 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                 qemu_plugin_set_cb_flags(cpu, QEMU_PLUGIN_CB_NO_REGS);
             }
             break;
+        case PLUGIN_CB_MEM_COND:
+            if ((rw & cb->cond.rw) &&
+                plugin_cond_holds(&cb->cond, cpu->cpu_index)) {
+                qemu_plugin_set_cb_flags(cpu,
+                    tcg_call_to_qemu_plugin_cb_flags(cb->cond.info->flags));
+
+                cb->cond.f.vcpu_mem(cpu->cpu_index,
+                                    make_plugin_meminfo(oi, rw),
+                                    vaddr, cb->cond.userp);
+                qemu_plugin_set_cb_flags(cpu, QEMU_PLUGIN_CB_NO_REGS);
+            }
+            break;
         case PLUGIN_CB_INLINE_ADD_U64:
         case PLUGIN_CB_INLINE_STORE_U64:
             if (rw & cb->inline_insn.rw) {
@@ -122,10 +122,17 @@ typedef struct QmpDispatchBH {
 static void do_qmp_dispatch_bh(void *opaque)
 {
     QmpDispatchBH *data = opaque;
+    bool drop_bql = (data->cmd->options & QCO_ALLOW_NO_BQL) && bql_locked();
 
     assert(monitor_cur() == NULL);
     monitor_set_cur(qemu_coroutine_self(), data->cur_mon);
+    if (drop_bql) {
+        bql_unlock();
+    }
     data->cmd->fn(data->args, data->ret, data->errp);
+    if (drop_bql) {
+        bql_lock();
+    }
     monitor_set_cur(qemu_coroutine_self(), NULL);
     aio_co_wake(data->co);
 }
@@ -44,6 +44,8 @@
 #include "qemu/sockets.h"
 #include "qemu/units.h"
 #include "qemu/memalign.h"
+#include "qemu/hdr-histogram.h"
+#include "qemu/rcu.h"
 #include "qom/object_interfaces.h"
 #include "system/block-backend.h"
 #include "block/block_int.h"
@@ -86,6 +88,10 @@ enum {
     OPTION_BITMAPS = 275,
     OPTION_FORCE = 276,
     OPTION_SKIP_BROKEN = 277,
+    OPTION_THREADS = 278,
+    OPTION_WRITE_RATIO = 279,
+    OPTION_RANDOM = 280,
+    OPTION_SEED = 281,
 };
 
 typedef enum OutputFormat {
@@ -1268,6 +1274,12 @@ static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
 
     assert(bytes > 0);
 
+    /* Identical buffers are the common case, compare them in one go */
+    if (!memcmp(buf1, buf2, bytes)) {
+        *pnum = bytes;
+        return 0;
+    }
+
     if (!chsize) {
         chsize = BDRV_SECTOR_SIZE;
     }
@@ -1289,44 +1301,380 @@ static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
 
 #define IO_BUF_SIZE (2 * MiB)
 
+#define MAX_COROUTINES 16
+#define MAX_THREADS 64
+
+/* An event loop thread for running coroutines outside of the main loop */
+typedef struct ImgIOThread {
+    QemuThread thread;
+    AioContext *ctx;
+    bool stopping;
+} ImgIOThread;
+
+static void *img_iothread_run(void *opaque)
+{
+    ImgIOThread *t = opaque;
+
+    rcu_register_thread();
+    qemu_set_current_aio_context(t->ctx);
+
+    while (!qatomic_read(&t->stopping)) {
+        aio_poll(t->ctx, true);
+    }
+
+    rcu_unregister_thread();
+    return NULL;
+}
+
+static void img_iothread_stop_bh(void *opaque)
+{
+    ImgIOThread *t = opaque;
+
+    qatomic_set(&t->stopping, true);
+}
+
+static ImgIOThread *img_iothread_new(void)
+{
+    ImgIOThread *t = g_new0(ImgIOThread, 1);
+
+    t->ctx = aio_context_new(&error_abort);
+    qemu_thread_create(&t->thread, "qemu-img worker", img_iothread_run, t,
+                       QEMU_THREAD_JOINABLE);
+    return t;
+}
+
+/* The caller must make sure that no coroutines are left in the thread */
+static void img_iothread_join(ImgIOThread *t)
+{
+    aio_bh_schedule_oneshot(t->ctx, img_iothread_stop_bh, t);
+    qemu_thread_join(&t->thread);
+    aio_context_unref(t->ctx);
+    g_free(t);
+}
+
+typedef enum ImgCompareAction {
+    COMPARE_SKIP,   /* nothing to check in this range */
+    COMPARE_DATA,   /* both images are allocated, compare their contents */
+    COMPARE_EMPTY,  /* only one image is allocated, it must read as zeroes */
+} ImgCompareAction;
+
+typedef struct ImgCompareState {
+    BlockBackend *blk1, *blk2;
+    const char *filename1, *filename2;
+    int64_t total_size1, total_size2;
+    int64_t total_size;         /* range that exists in both images */
+    int64_t progress_base;      /* size of the larger image */
+    bool strict;
+    long num_coroutines;        /* per thread */
+    long num_threads;           /* 0 runs all coroutines in the main loop */
+
+    CoMutex lock;
+    /* Start of the range that no worker has claimed yet, protected by lock */
+    int64_t offset;
+    /*
+     * The difference or error with the lowest offset found so far, protected
+     * by lock: exit code (0 if none), offset and the message to print.
+     *
+     * Workers claim ranges in ascending order and stop claiming once a
+     * failure was found, so when all of them have finished, this is the
+     * same failure that a sequential walk would have reported.
+     */
+    int ret;
+    int64_t fail_offset;
+    char *fail_msg;
+    int running_coroutines;
+} ImgCompareState;
+
+/* Called with s->lock held, takes ownership of @msg */
+static void compare_set_failure(ImgCompareState *s, int64_t offset, int ret,
+                                char *msg)
+{
+    if (s->ret && s->fail_offset <= offset) {
+        g_free(msg);
+        return;
+    }
+    g_free(s->fail_msg);
+    s->ret = ret;
+    s->fail_offset = offset;
+    s->fail_msg = msg;
+}
+
+static void coroutine_fn compare_co_set_failure(ImgCompareState *s,
+                                                int64_t offset, int ret,
+                                                char *msg)
+{
+    qemu_co_mutex_lock(&s->lock);
+    compare_set_failure(s, offset, ret, msg);
+    qemu_co_mutex_unlock(&s->lock);
+}
+
+static int coroutine_fn compare_co_read(ImgCompareState *s, BlockBackend *blk,
+                                        const char *filename, int64_t offset,
+                                        int64_t bytes, uint8_t *buffer)
+{
+    int ret = blk_co_pread(blk, offset, bytes, buffer, 0);
+
+    if (ret < 0) {
+        compare_co_set_failure(s, offset, 4,
+                               g_strdup_printf("Error while reading offset %"
+                                               PRId64 " of %s: %s", offset,
+                                               filename, strerror(-ret)));
+        return ret;
+    }
+    return 0;
+}
+
 /*
  * Check if passed sectors are empty (not allocated or contain only 0 bytes)
  *
- * Intended for use by 'qemu-img compare': Returns 0 in case sectors are
- * filled with 0, 1 if sectors contain non-zero data (this is a comparison
- * failure), and 4 on error (the exit status for read errors), after emitting
- * an error message.
+ * Returns 0 in case sectors are filled with 0, and records a comparison
+ * failure (exit status 1) if sectors contain non-zero data or a read error
+ * (exit status 4) otherwise.
  *
  * @param blk:  BlockBackend for the image
+ * @param filename: Name of disk file we are checking (logging purpose)
  * @param offset: Starting offset to check
  * @param bytes: Number of bytes to check
- * @param filename: Name of disk file we are checking (logging purpose)
  * @param buffer: Allocated buffer for storing read data
- * @param quiet: Flag for quiet mode
  */
-static int check_empty_sectors(BlockBackend *blk, int64_t offset,
-                               int64_t bytes, const char *filename,
-                               uint8_t *buffer, bool quiet)
+static int coroutine_fn compare_co_check_empty(ImgCompareState *s,
+                                               BlockBackend *blk,
+                                               const char *filename,
+                                               int64_t offset, int64_t bytes,
+                                               uint8_t *buffer)
 {
-    int ret = 0;
     int64_t idx;
 
-    ret = blk_pread(blk, offset, bytes, buffer, 0);
-    if (ret < 0) {
-        error_report("Error while reading offset %" PRId64 " of %s: %s",
-                     offset, filename, strerror(-ret));
-        return 4;
+    if (compare_co_read(s, blk, filename, offset, bytes, buffer) < 0) {
+        return -EIO;
     }
     idx = find_nonzero(buffer, bytes);
     if (idx >= 0) {
-        qprintf(quiet, "Content mismatch at offset %" PRId64 "!\n",
-                offset + idx);
-        return 1;
+        compare_co_set_failure(s, offset + idx, 1,
+                               g_strdup_printf("Content mismatch at offset %"
+                                               PRId64 "!", offset + idx));
+        return -EIO;
+    }
+
+    return 0;
+}
+
+static int coroutine_fn compare_co_data(ImgCompareState *s, int64_t offset,
+                                        int64_t bytes, uint8_t *buf1,
+                                        uint8_t *buf2)
+{
+    int64_t pnum;
+    int ret;
+
+    if (compare_co_read(s, s->blk1, s->filename1, offset, bytes, buf1) < 0 ||
+        compare_co_read(s, s->blk2, s->filename2, offset, bytes, buf2) < 0) {
+        return -EIO;
     }
+    ret = compare_buffers(buf1, buf2, bytes, 0, &pnum);
+    if (ret || pnum != bytes) {
+        int64_t mismatch = offset + (ret ? 0 : pnum);
 
+        compare_co_set_failure(s, mismatch, 1,
+                               g_strdup_printf("Content mismatch at offset %"
+                                               PRId64 "!", mismatch));
+        return -EIO;
+    }
     return 0;
 }
 
+/*
+ * Determine how the range starting at @offset must be checked, and how long it
+ * is.  If the block status already shows a difference or cannot be queried,
+ * record the failure and return a negative value.
+ *
+ * Called with s->lock held.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+compare_co_next_range(ImgCompareState *s, int64_t offset, int64_t *chunk,
+                      ImgCompareAction *action, BlockBackend **blk_empty,
+                      const char **filename_empty)
+{
+    int status1, status2;
+    int64_t pnum1, pnum2;
+    bool allocated1, allocated2;
+
+    if (offset >= s->total_size) {
+        /* Only the larger image has data here, it must read as zeroes */
+        BlockBackend *blk_over;
+        const char *filename_over;
+        int ret;
+
+        if (s->total_size1 > s->total_size2) {
+            blk_over = s->blk1;
+            filename_over = s->filename1;
+        } else {
+            blk_over = s->blk2;
+            filename_over = s->filename2;
+        }
+
+        ret = bdrv_co_block_status_above(blk_bs(blk_over), NULL, offset,
+                                         s->progress_base - offset, chunk,
+                                         NULL, NULL);
+        if (ret < 0) {
+            compare_set_failure(s, offset, 3,
+                                g_strdup_printf("Sector allocation test "
+                                                "failed for %s",
+                                                filename_over));
+            return ret;
+        }
+        if (ret & BDRV_BLOCK_ALLOCATED && !(ret & BDRV_BLOCK_ZERO)) {
+            *chunk = MIN(*chunk, IO_BUF_SIZE);
+            *action = COMPARE_EMPTY;
+            *blk_empty = blk_over;
+            *filename_empty = filename_over;
+        } else {
+            *action = COMPARE_SKIP;
+        }
+        return 0;
+    }
+
+    status1 = bdrv_co_block_status_above(blk_bs(s->blk1), NULL, offset,
+                                         s->total_size1 - offset, &pnum1,
+                                         NULL, NULL);
+    if (status1 < 0) {
+        compare_set_failure(s, offset, 3,
+                            g_strdup_printf("Sector allocation test failed "
+                                            "for %s", s->filename1));
+        return status1;
+    }
+    allocated1 = status1 & BDRV_BLOCK_ALLOCATED;
+
+    status2 = bdrv_co_block_status_above(blk_bs(s->blk2), NULL, offset,
+                                         s->total_size2 - offset, &pnum2,
+                                         NULL, NULL);
+    if (status2 < 0) {
+        compare_set_failure(s, offset, 3,
+                            g_strdup_printf("Sector allocation test failed "
+                                            "for %s", s->filename2));
+        return status2;
+    }
+    allocated2 = status2 & BDRV_BLOCK_ALLOCATED;
+
+    assert(pnum1 && pnum2);
+    *chunk = MIN(pnum1, pnum2);
+
+    if (s->strict && status1 != status2) {
+        compare_set_failure(s, offset, 1,
+                            g_strdup_printf("Strict mode: Offset %" PRId64
+                                            " block status mismatch!",
+                                            offset));
+        return -EINVAL;
+    }
+
+    if ((status1 & BDRV_BLOCK_ZERO) && (status2 & BDRV_BLOCK_ZERO)) {
+        *action = COMPARE_SKIP;
+    } else if (allocated1 == allocated2) {
+        *action = allocated1 ? COMPARE_DATA : COMPARE_SKIP;
+    } else {
+        *action = COMPARE_EMPTY;
+        *blk_empty = allocated1 ? s->blk1 : s->blk2;
+        *filename_empty = allocated1 ? s->filename1 : s->filename2;
+    }
+    if (*action != COMPARE_SKIP) {
+        *chunk = MIN(*chunk, IO_BUF_SIZE);
+    }
+    return 0;
+}
+
+static void coroutine_fn compare_co_worker(void *opaque)
+{
+    ImgCompareState *s = opaque;
+    uint8_t *buf1 = blk_blockalign(s->blk1, IO_BUF_SIZE);
+    uint8_t *buf2 = blk_blockalign(s->blk2, IO_BUF_SIZE);
+
+    for (;;) {
+        ImgCompareAction action;
+        BlockBackend *blk_empty = NULL;
+        const char *filename_empty = NULL;
+        int64_t offset, chunk;
+        int ret;
+
+        qemu_co_mutex_lock(&s->lock);
+        if (s->ret || s->offset >= s->progress_base) {
+            qemu_co_mutex_unlock(&s->lock);
+            break;
+        }
+        offset = s->offset;
+        WITH_GRAPH_RDLOCK_GUARD() {
+            ret = compare_co_next_range(s, offset, &chunk, &action,
+                                        &blk_empty, &filename_empty);
+        }
+        if (ret < 0) {
+            qemu_co_mutex_unlock(&s->lock);
+            break;
+        }
+        /* let other workers continue beyond this range while we read it */
+        s->offset += chunk;
+        qemu_progress_print(((float) chunk / s->progress_base) * 100, 100);
+        qemu_co_mutex_unlock(&s->lock);
+
+        switch (action) {
+        case COMPARE_SKIP:
+            ret = 0;
+            break;
+        case COMPARE_DATA:
+            ret = compare_co_data(s, offset, chunk, buf1, buf2);
+            break;
+        case COMPARE_EMPTY:
+            ret = compare_co_check_empty(s, blk_empty, filename_empty,
+                                         offset, chunk, buf1);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        if (ret < 0) {
+            break;
+        }
+    }
+
+    qemu_vfree(buf1);
+    qemu_vfree(buf2);
+
+    qatomic_dec(&s->running_coroutines);
+    /* compare_run() waits in the main loop */
+    aio_wait_kick();
+}
+
+/*
+ * Walk both images with num_coroutines workers (per thread with --threads),
+ * overlapping block status queries, reads and comparisons.  Returns the exit
+ * code of the first difference or error, or 0 if the images are identical.
+ */
+static int compare_run(ImgCompareState *s)
+{
+    ImgIOThread *threads[MAX_THREADS];
+    int num_workers = s->num_coroutines * MAX(s->num_threads, 1);
+    int i;
+
+    qemu_co_mutex_init(&s->lock);
+    for (i = 0; i < s->num_threads; i++) {
+        threads[i] = img_iothread_new();
+    }
+
+    s->running_coroutines = num_workers;
+    for (i = 0; i < num_workers; i++) {
+        AioContext *ctx = s->num_threads ?
+                          threads[i % s->num_threads]->ctx :
+                          qemu_get_aio_context();
+        aio_co_enter(ctx, qemu_coroutine_create(compare_co_worker, s));
+    }
+
+    while (qatomic_read(&s->running_coroutines)) {
+        main_loop_wait(false);
+    }
+
+    for (i = 0; i < s->num_threads; i++) {
+        img_iothread_join(threads[i]);
+    }
+
+    return s->ret;
+}
+
 /*
  * Compares two images. Exit codes:
  *
@@ -1338,22 +1686,17 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
 {
     const char *fmt1 = NULL, *fmt2 = NULL, *cache, *filename1, *filename2;
     BlockBackend *blk1, *blk2;
-    BlockDriverState *bs1, *bs2;
     int64_t total_size1, total_size2;
-    uint8_t *buf1 = NULL, *buf2 = NULL;
-    int64_t pnum1, pnum2;
-    int allocated1, allocated2;
     int ret = 0; /* return value - 0 Ident, 1 Different, >1 Error */
     bool progress = false, quiet = false, strict = false;
     int flags;
     bool writethrough;
-    int64_t total_size;
-    int64_t offset = 0;
-    int64_t chunk;
     int c;
-    uint64_t progress_base;
     bool image_opts = false;
     bool force_share = false;
+    ImgCompareState s = {
+        .num_coroutines = 8,
+    };
 
     cache = BDRV_DEFAULT_CACHE;
     for (;;) {
@@ -1367,10 +1710,12 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
             {"force-share", no_argument, 0, 'U'},
             {"progress", no_argument, 0, 'p'},
             {"quiet", no_argument, 0, 'q'},
+            {"parallel", required_argument, 0, 'm'},
+            {"threads", required_argument, 0, OPTION_THREADS},
             {"object", required_argument, 0, OPTION_OBJECT},
             {0, 0, 0, 0}
         };
-        c = getopt_long(argc, argv, "hf:F:sT:Upq",
+        c = getopt_long(argc, argv, "hf:F:sT:Upqm:",
                         long_options, NULL);
         if (c == -1) {
             break;
@@ -1379,7 +1724,8 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         case 'h':
             cmd_help(ccmd,
 "[[-f FMT] [-F FMT] | --image-opts] [-s] [-T CACHE]\n"
-"        [-U] [-p] [-q] [--object OBJDEF] FILE1 FILE2\n"
+"        [-U] [-p] [-q] [-m NUM_PARALLEL] [--threads NUM_THREADS]\n"
+"        [--object OBJDEF] FILE1 FILE2\n"
 ,
 "  -f, --a-format FMT\n"
 "     specify FILE1 image format explicitly (default: probing is used)\n"
@@ -1398,6 +1744,10 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
 "     display progress information\n"
 "  -q, --quiet\n"
 "     quiet mode (produce only error messages if any)\n"
+"  -m, --parallel NUM_PARALLEL\n"
+"     specify parallelism (default: 8), per thread with --threads\n"
+"  --threads NUM_THREADS\n"
+"     run the comparison in NUM_THREADS threads (default: main loop only)\n"
 "  --object OBJDEF\n"
 "     defines QEMU user-creatable object\n"
 "  FILE1, FILE2\n"
@@ -1429,6 +1779,20 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         case 'q':
             quiet = true;
             break;
+        case 'm':
+            s.num_coroutines = cvtnum_full("number of coroutines", optarg,
+                                           false, 1, MAX_COROUTINES);
+            if (s.num_coroutines < 0) {
+                return 1;
+            }
+            break;
+        case OPTION_THREADS:
+            s.num_threads = cvtnum_full("number of threads", optarg,
+                                        false, 1, MAX_THREADS);
+            if (s.num_threads < 0) {
+                return 1;
+            }
+            break;
         case OPTION_OBJECT:
             user_creatable_process_cmdline(optarg);
             break;
@@ -1473,11 +1837,7 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         ret = 2;
         goto out2;
     }
-    bs1 = blk_bs(blk1);
-    bs2 = blk_bs(blk2);
 
-    buf1 = blk_blockalign(blk1, IO_BUF_SIZE);
-    buf2 = blk_blockalign(blk2, IO_BUF_SIZE);
     total_size1 = blk_getlength(blk1);
     if (total_size1 < 0) {
         error_report("Can't get size of %s: %s",
@@ -1492,9 +1852,6 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         ret = 4;
         goto out;
     }
-    total_size = MIN(total_size1, total_size2);
-    progress_base = MAX(total_size1, total_size2);
-
     qemu_progress_print(0, 100);
 
     if (strict && total_size1 != total_size2) {
@@ -1503,131 +1860,34 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         goto out;
     }
 
-    while (offset < total_size) {
-        int status1, status2;
+    s.blk1 = blk1;
+    s.blk2 = blk2;
+    s.filename1 = filename1;
+    s.filename2 = filename2;
+    s.total_size1 = total_size1;
+    s.total_size2 = total_size2;
+    s.total_size = MIN(total_size1, total_size2);
+    s.progress_base = MAX(total_size1, total_size2);
+    s.strict = strict;
 
-        status1 = bdrv_block_status_above(bs1, NULL, offset,
-                                          total_size1 - offset, &pnum1, NULL,
-                                          NULL);
-        if (status1 < 0) {
-            ret = 3;
-            error_report("Sector allocation test failed for %s", filename1);
-            goto out;
-        }
-        allocated1 = status1 & BDRV_BLOCK_ALLOCATED;
-
-        status2 = bdrv_block_status_above(bs2, NULL, offset,
-                                          total_size2 - offset, &pnum2, NULL,
-                                          NULL);
-        if (status2 < 0) {
-            ret = 3;
-            error_report("Sector allocation test failed for %s", filename2);
-            goto out;
-        }
-        allocated2 = status2 & BDRV_BLOCK_ALLOCATED;
-
-        assert(pnum1 && pnum2);
-        chunk = MIN(pnum1, pnum2);
-
-        if (strict) {
-            if (status1 != status2) {
-                ret = 1;
-                qprintf(quiet, "Strict mode: Offset %" PRId64
-                        " block status mismatch!\n", offset);
-                goto out;
-            }
-        }
-        if ((status1 & BDRV_BLOCK_ZERO) && (status2 & BDRV_BLOCK_ZERO)) {
-            /* nothing to do */
-        } else if (allocated1 == allocated2) {
-            if (allocated1) {
-                int64_t pnum;
-
-                chunk = MIN(chunk, IO_BUF_SIZE);
-                ret = blk_pread(blk1, offset, chunk, buf1, 0);
-                if (ret < 0) {
-                    error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename1, strerror(-ret));
-                    ret = 4;
-                    goto out;
-                }
-                ret = blk_pread(blk2, offset, chunk, buf2, 0);
-                if (ret < 0) {
-                    error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename2, strerror(-ret));
-                    ret = 4;
-                    goto out;
-                }
-                ret = compare_buffers(buf1, buf2, chunk, 0, &pnum);
-                if (ret || pnum != chunk) {
-                    qprintf(quiet, "Content mismatch at offset %" PRId64 "!\n",
-                            offset + (ret ? 0 : pnum));
-                    ret = 1;
-                    goto out;
-                }
-            }
-        } else {
-            chunk = MIN(chunk, IO_BUF_SIZE);
-            if (allocated1) {
-                ret = check_empty_sectors(blk1, offset, chunk,
-                                          filename1, buf1, quiet);
-            } else {
-                ret = check_empty_sectors(blk2, offset, chunk,
-                                          filename2, buf1, quiet);
-            }
-            if (ret) {
-                goto out;
-            }
-        }
-        offset += chunk;
-        qemu_progress_print(((float) chunk / progress_base) * 100, 100);
-    }
-
-    if (total_size1 != total_size2) {
-        BlockBackend *blk_over;
-        const char *filename_over;
+    ret = compare_run(&s);
 
+    if (total_size1 != total_size2 && (!ret || s.fail_offset >= s.total_size)) {
         qprintf(quiet, "Warning: Image size mismatch!\n");
-        if (total_size1 > total_size2) {
-            blk_over = blk1;
-            filename_over = filename1;
-        } else {
-            blk_over = blk2;
-            filename_over = filename2;
-        }
-
-        while (offset < progress_base) {
-            ret = bdrv_block_status_above(blk_bs(blk_over), NULL, offset,
-                                          progress_base - offset, &chunk,
-                                          NULL, NULL);
-            if (ret < 0) {
-                ret = 3;
-                error_report("Sector allocation test failed for %s",
-                             filename_over);
-                goto out;
-
-            }
-            if (ret & BDRV_BLOCK_ALLOCATED && !(ret & BDRV_BLOCK_ZERO)) {
-                chunk = MIN(chunk, IO_BUF_SIZE);
-                ret = check_empty_sectors(blk_over, offset, chunk,
-                                          filename_over, buf1, quiet);
-                if (ret) {
-                    goto out;
-                }
-            }
-            offset += chunk;
-            qemu_progress_print(((float) chunk / progress_base) * 100, 100);
-        }
+    }
+    if (ret == 1) {
+        qprintf(quiet, "%s\n", s.fail_msg);
+        goto out;
+    } else if (ret) {
+        error_report("%s", s.fail_msg);
+        goto out;
     }
 
     qprintf(quiet, "Images are identical.\n");
     ret = 0;
 
 out:
-    qemu_vfree(buf1);
-    qemu_vfree(buf2);
+    g_free(s.fail_msg);
     blk_unref(blk2);
 out2:
     blk_unref(blk1);
@@ -1659,7 +1919,6 @@ enum ImgConvertBlockStatus {
     BLK_BACKING_FILE,
 };
 
-#define MAX_COROUTINES 16
 #define CONVERT_THROTTLE_GROUP "img_convert"
 
 typedef struct ImgConvertState {
@@ -1688,10 +1947,14 @@ typedef struct ImgConvertState {
     int alignment;
     size_t cluster_sectors;
     size_t buf_sectors;
-    long num_coroutines;
+    long num_coroutines;        /* per thread */
+    long num_threads;           /* 0 runs all coroutines in the main loop */
+    ImgIOThread *threads[MAX_THREADS];
+    int num_workers;
     int running_coroutines;
-    Coroutine *co[MAX_COROUTINES];
-    int64_t wait_sector_num[MAX_COROUTINES];
+    Coroutine **co;
+    int64_t *wait_sector_num;
+    CoQueue *wait_queue;
     CoMutex lock;
     int ret;
 } ImgConvertState;
@@ -1869,9 +2132,53 @@ static int coroutine_fn convert_co_read(ImgConvertState *s, int64_t sector_num,
 }
 
 
+/*
+ * Split a buffer read from the source into runs of sectors that have to be
+ * written (positive length in @runs) and runs that can be treated as zero
+ * sectors (negative length).  This runs before waiting for in-order writes
+ * so that zero detection is spread over all coroutines and threads.
+ *
+ * Returns the number of runs.
+ */
+static int convert_detect_zeroes(ImgConvertState *s, int64_t sector_num,
+                                 int nb_sectors, const uint8_t *buf,
+                                 int *runs)
+{
+    int nb_runs = 0;
+
+    while (nb_sectors > 0) {
+        int n = nb_sectors;
+        bool data;
+
+        /* If we're told to keep the target fully allocated (-S 0) or there
+         * is real non-zero data, we must write it. Otherwise we can treat
+         * it as zero sectors.
+         * Compressed clusters need to be written as a whole, so in that
+         * case we can only save the write if the buffer is completely
+         * zeroed. */
+        if (!s->min_sparse) {
+            data = true;
+        } else if (s->compressed) {
+            data = !buffer_is_zero(buf, n * BDRV_SECTOR_SIZE);
+        } else {
+            data = is_allocated_sectors_min(buf, n, &n, s->min_sparse,
+                                            sector_num, s->alignment);
+        }
+        runs[nb_runs++] = data ? n : -n;
+
+        sector_num += n;
+        nb_sectors -= n;
+        buf += n * BDRV_SECTOR_SIZE;
+    }
+
+    return nb_runs;
+}
+
+/* @runs is the result of convert_detect_zeroes() for BLK_DATA */
 static int coroutine_fn convert_co_write(ImgConvertState *s, int64_t sector_num,
                                          int nb_sectors, uint8_t *buf,
-                                         enum ImgConvertBlockStatus status)
+                                         enum ImgConvertBlockStatus status,
+                                         const int *runs)
 {
     int ret;
 
@@ -1888,19 +2195,8 @@ static int coroutine_fn convert_co_write(ImgConvertState *s, int64_t sector_num,
             break;
 
         case BLK_DATA:
-            /* If we're told to keep the target fully allocated (-S 0) or there
-             * is real non-zero data, we must write it. Otherwise we can treat
-             * it as zero sectors.
-             * Compressed clusters need to be written as a whole, so in that
-             * case we can only save the write if the buffer is completely
-             * zeroed. */
-            if (!s->min_sparse ||
-                (!s->compressed &&
-                 is_allocated_sectors_min(buf, n, &n, s->min_sparse,
-                                          sector_num, s->alignment)) ||
-                (s->compressed &&
-                 !buffer_is_zero(buf, n * BDRV_SECTOR_SIZE)))
-            {
+            n = abs(*runs);
+            if (*runs++ > 0) {
                 ret = blk_co_pwrite(s->target, sector_num << BDRV_SECTOR_BITS,
                                     n << BDRV_SECTOR_BITS, buf, flags);
                 if (ret < 0) {
@@ -1964,14 +2260,21 @@ static int coroutine_fn convert_co_copy_range(ImgConvertState *s, int64_t sector
     return 0;
 }
 
+/* Keeps the first error, workers can run in several threads */
+static void convert_set_error(ImgConvertState *s, int ret)
+{
+    qatomic_cmpxchg(&s->ret, -EINPROGRESS, ret);
+}
+
 static void coroutine_fn convert_co_do_copy(void *opaque)
 {
     ImgConvertState *s = opaque;
     uint8_t *buf = NULL;
+    int *runs = NULL;
     int ret, i;
     int index = -1;
 
-    for (i = 0; i < s->num_coroutines; i++) {
+    for (i = 0; i < s->num_workers; i++) {
         if (s->co[i] == qemu_coroutine_self()) {
             index = i;
             break;
@@ -1979,8 +2282,8 @@ static void coroutine_fn convert_co_do_copy(void *opaque)
     }
     assert(index >= 0);
 
-    s->running_coroutines++;
     buf = blk_blockalign(s->target, s->buf_sectors * BDRV_SECTOR_SIZE);
+    runs = g_new(int, s->buf_sectors);
 
     while (1) {
         int n;
@@ -1989,7 +2292,8 @@ static void coroutine_fn convert_co_do_copy(void *opaque)
         bool copy_range;
 
         qemu_co_mutex_lock(&s->lock);
-        if (s->ret != -EINPROGRESS || s->sector_num >= s->total_sectors) {
+        if (qatomic_read(&s->ret) != -EINPROGRESS ||
+            s->sector_num >= s->total_sectors) {
             qemu_co_mutex_unlock(&s->lock);
             break;
         }
@@ -1998,7 +2302,7 @@ static void coroutine_fn convert_co_do_copy(void *opaque)
         }
         if (n < 0) {
             qemu_co_mutex_unlock(&s->lock);
-            s->ret = n;
+            convert_set_error(s, n);
             break;
         }
         /* save current sector and allocation status to local variables */
@@ -2010,81 +2314,91 @@ static void coroutine_fn convert_co_do_copy(void *opaque)
         /* increment global sector counter so that other coroutines can
          * already continue reading beyond this request */
         s->sector_num += n;
-        qemu_co_mutex_unlock(&s->lock);
 
         if (status == BLK_DATA || (!s->min_sparse && status == BLK_ZERO)) {
             s->allocated_done += n;
             qemu_progress_print(100.0 * s->allocated_done /
                                         s->allocated_sectors, 0);
         }
+        qemu_co_mutex_unlock(&s->lock);
 
 retry:
-        copy_range = s->copy_range && s->status == BLK_DATA;
+        copy_range = qatomic_read(&s->copy_range) && status == BLK_DATA;
         if (status == BLK_DATA && !copy_range) {
             ret = convert_co_read(s, sector_num, n, buf);
             if (ret < 0) {
                 error_report("error while reading at byte %lld: %s",
                              sector_num * BDRV_SECTOR_SIZE, strerror(-ret));
-                s->ret = ret;
+                convert_set_error(s, ret);
+            } else {
+                convert_detect_zeroes(s, sector_num, n, buf, runs);
             }
         } else if (!s->min_sparse && status == BLK_ZERO) {
             status = BLK_DATA;
             memset(buf, 0x00, n * BDRV_SECTOR_SIZE);
+            runs[0] = n;
         }
 
         if (s->wr_in_order) {
             /* keep writes in order */
-            while (s->wr_offs != sector_num && s->ret == -EINPROGRESS) {
+            qemu_co_mutex_lock(&s->lock);
+            while (s->wr_offs != sector_num &&
+                   qatomic_read(&s->ret) == -EINPROGRESS) {
                 s->wait_sector_num[index] = sector_num;
-                qemu_coroutine_yield();
+                qemu_co_queue_wait(&s->wait_queue[index], &s->lock);
             }
             s->wait_sector_num[index] = -1;
+            qemu_co_mutex_unlock(&s->lock);
         }
 
-        if (s->ret == -EINPROGRESS) {
+        if (qatomic_read(&s->ret) == -EINPROGRESS) {
             if (copy_range) {
                 WITH_GRAPH_RDLOCK_GUARD() {
                     ret = convert_co_copy_range(s, sector_num, n);
                 }
                 if (ret) {
-                    s->copy_range = false;
+                    qatomic_set(&s->copy_range, false);
                     goto retry;
                 }
             } else {
-                ret = convert_co_write(s, sector_num, n, buf, status);
+                ret = convert_co_write(s, sector_num, n, buf, status, runs);
             }
             if (ret < 0) {
                 error_report("error while writing at byte %lld: %s",
                              sector_num * BDRV_SECTOR_SIZE, strerror(-ret));
-                s->ret = ret;
+                convert_set_error(s, ret);
             }
         }
 
         if (s->wr_in_order) {
-            /* reenter the coroutine that might have waited
-             * for this write to complete */
+            /* wake up the coroutine that might have waited for this write to
+             * complete */
+            qemu_co_mutex_lock(&s->lock);
             s->wr_offs = sector_num + n;
-            for (i = 0; i < s->num_coroutines; i++) {
+            for (i = 0; i < s->num_workers; i++) {
                 if (s->co[i] && s->wait_sector_num[i] == s->wr_offs) {
-                    /*
-                     * A -> B -> A cannot occur because A has
-                     * s->wait_sector_num[i] == -1 during A -> B.  Therefore
-                     * B will never enter A during this time window.
-                     */
-                    qemu_coroutine_enter(s->co[i]);
+                    qemu_co_queue_next(&s->wait_queue[i]);
                     break;
                 }
             }
+            qemu_co_mutex_unlock(&s->lock);
         }
     }
 
     qemu_vfree(buf);
+    g_free(runs);
+
+    qemu_co_mutex_lock(&s->lock);
     s->co[index] = NULL;
-    s->running_coroutines--;
-    if (!s->running_coroutines && s->ret == -EINPROGRESS) {
-        /* the convert job finished successfully */
-        s->ret = 0;
+    if (s->running_coroutines == 1) {
+        /* the convert job finished successfully unless an error was set */
+        convert_set_error(s, 0);
     }
+    qatomic_dec(&s->running_coroutines);
+    qemu_co_mutex_unlock(&s->lock);
+
+    /* convert_do_copy() may be waiting in another thread */
+    aio_wait_kick();
 }
 
 static int convert_do_copy(ImgConvertState *s)
@@ -2128,17 +2442,45 @@ static int convert_do_copy(ImgConvertState *s)
     s->sector_next_status = 0;
     s->ret = -EINPROGRESS;
 
+    /*
+     * With --threads, each thread runs num_coroutines workers that read,
+     * detect zeroes and write their own buffer.  The block layer takes
+     * requests from any thread, only the block status walk and write ordering
+     * are serialized by s->lock.
+     */
+    s->num_workers = s->num_coroutines * MAX(s->num_threads, 1);
+    s->co = g_new0(Coroutine *, s->num_workers);
+    s->wait_sector_num = g_new(int64_t, s->num_workers);
+    s->wait_queue = g_new(CoQueue, s->num_workers);
+    for (i = 0; i < s->num_threads; i++) {
+        s->threads[i] = img_iothread_new();
+    }
+
     qemu_co_mutex_init(&s->lock);
-    for (i = 0; i < s->num_coroutines; i++) {
+    for (i = 0; i < s->num_workers; i++) {
         s->co[i] = qemu_coroutine_create(convert_co_do_copy, s);
         s->wait_sector_num[i] = -1;
-        qemu_coroutine_enter(s->co[i]);
+        qemu_co_queue_init(&s->wait_queue[i]);
+    }
+    s->running_coroutines = s->num_workers;
+    for (i = 0; i < s->num_workers; i++) {
+        AioContext *ctx = s->num_threads ?
+                          s->threads[i % s->num_threads]->ctx :
+                          qemu_get_aio_context();
+        aio_co_enter(ctx, s->co[i]);
     }
 
-    while (s->running_coroutines) {
+    while (qatomic_read(&s->running_coroutines)) {
         main_loop_wait(false);
     }
 
+    for (i = 0; i < s->num_threads; i++) {
+        img_iothread_join(s->threads[i]);
+    }
+    g_free(s->co);
+    g_free(s->wait_sector_num);
+    g_free(s->wait_queue);
+
     if (s->compressed && !s->ret) {
         /* signal EOF to align */
         ret = blk_pwrite_compressed(s->target, 0, 0, NULL);
@@ -2195,7 +2537,7 @@ static int convert_copy_bitmaps(BlockDriverState *src, BlockDriverState *dst,
                                    true, bdrv_dirty_bitmap_granularity(bm),
                                    true, true,
                                    true, !bdrv_dirty_bitmap_enabled(bm),
-                                   &err);
+                                   false, false, &err);
         if (err) {
             error_reportf_err(err, "Failed to create bitmap %s: ", name);
             return -1;
@@ -2287,6 +2629,7 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
             {"force-share", no_argument, 0, 'U'},
             {"rate-limit", required_argument, 0, 'r'},
             {"parallel", required_argument, 0, 'm'},
+            {"threads", required_argument, 0, OPTION_THREADS},
             {"oob-writes", no_argument, 0, 'W'},
             {"copy-range-offloading", no_argument, 0, 'C'},
             {"progress", no_argument, 0, 'p'},
@@ -2306,7 +2649,8 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
 "        [-O TGT_FMT | --target-image-opts] [-o TGT_FMT_OPTS] [-t TGT_CACHE]\n"
 "        [-b BACKING_FILE [-F BACKING_FMT]] [-S SPARSE_SIZE]\n"
 "        [-n] [--target-is-zero] [-c]\n"
-"        [-U] [-r RATE] [-m NUM_PARALLEL] [-W] [-C] [-p] [-q] [--object OBJDEF]\n"
+"        [-U] [-r RATE] [-m NUM_PARALLEL] [--threads NUM_THREADS] [-W] [-C]\n"
+"        [-p] [-q] [--object OBJDEF]\n"
 "        SRC_FILE [SRC_FILE2...] TGT_FILE\n"
 ,
 "  -f, --source-format SRC_FMT\n"
@@ -2351,7 +2695,9 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
 "  -r, --rate-limit RATE\n"
 "     I/O rate limit, in bytes per second\n"
 "  -m, --parallel NUM_PARALLEL\n"
-"     specify parallelism (default: 8)\n"
+"     specify parallelism (default: 8), per thread with --threads\n"
+"  --threads NUM_THREADS\n"
+"     run the conversion in NUM_THREADS threads (default: main loop only)\n"
 "  -C, --copy-range-offloading\n"
 "     try to use copy offloading\n"
 "  -W, --oob-writes\n"
@@ -2472,6 +2818,13 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
                 goto fail_getopt;
             }
             break;
+        case OPTION_THREADS:
+            s.num_threads = cvtnum_full("number of threads", optarg,
+                                        false, 1, MAX_THREADS);
+            if (s.num_threads < 0) {
+                goto fail_getopt;
+            }
+            break;
         case 'W':
             s.wr_in_order = false;
             break;
@@ -4612,10 +4965,21 @@ out_no_progress:
     return 0;
 }
 
-typedef struct BenchData {
+typedef struct BenchData BenchData;
+
+typedef struct BenchRequest {
+    BenchData *b;
+    QEMUIOVector qiov;
+    int64_t start_ns;
+    bool write;
+} BenchRequest;
+
+/* One request queue, all queues submit to the same BlockBackend */
+struct BenchData {
     BlockBackend *blk;
     uint64_t image_size;
-    bool write;
+    int write_ratio;        /* percentage of write requests */
+    bool random;
     int bufsize;
     int step;
     int nrreq;
@@ -4623,12 +4987,20 @@ typedef struct BenchData {
     int flush_interval;
     bool drain_on_flush;
     uint8_t *buf;
-    QEMUIOVector *qiov;
+    BenchRequest *reqs;
+    int *free_reqs;
+    int nr_free_reqs;
+    GRand *rand;
+    int *running_queues;
+    bool done;
+
+    HdrHistogram read_latency;
+    HdrHistogram write_latency;
 
     int in_flight;
     bool in_flush;
     uint64_t offset;
-} BenchData;
+};
 
 static void bench_undrained_flush_cb(void *opaque, int ret)
 {
@@ -4638,6 +5010,32 @@ static void bench_undrained_flush_cb(void *opaque, int ret)
     }
 }
 
+static uint64_t bench_next_offset(BenchData *b)
+{
+    uint64_t offset = b->offset;
+
+    if (b->random) {
+        uint64_t nr_steps;
+
+        if (b->image_size <= b->bufsize) {
+            return 0;
+        }
+        nr_steps = (b->image_size - b->bufsize) / b->step + 1;
+        offset = ((uint64_t)g_rand_int(b->rand) << 32) | g_rand_int(b->rand);
+        return (offset % nr_steps) * b->step;
+    }
+
+    b->offset += b->step;
+    if (b->image_size <= b->bufsize) {
+        b->offset = 0;
+    } else {
+        b->offset %= b->image_size - b->bufsize;
+    }
+    return offset;
+}
+
+static void bench_request_cb(void *opaque, int ret);
+
 static void bench_cb(void *opaque, int ret)
 {
     BenchData *b = opaque;
@@ -4683,28 +5081,75 @@ static void bench_cb(void *opaque, int ret)
     }
 
     while (b->n > b->in_flight && b->in_flight < b->nrreq) {
-        int64_t offset = b->offset;
+        BenchRequest *req = &b->reqs[b->free_reqs[--b->nr_free_reqs]];
+        int64_t offset = bench_next_offset(b);
+
         /* blk_aio_* might look for completed I/Os and kick bench_cb
          * again, so make sure this operation is counted by in_flight
          * and b->offset is ready for the next submission.
          */
         b->in_flight++;
-        b->offset += b->step;
-        if (b->image_size <= b->bufsize) {
-            b->offset = 0;
+        req->write = b->write_ratio == 100 ||
+                     (b->write_ratio &&
+                      g_rand_int_range(b->rand, 0, 100) < b->write_ratio);
+        req->start_ns = get_clock();
+        if (req->write) {
+            acb = blk_aio_pwritev(b->blk, offset, &req->qiov, 0,
+                                  bench_request_cb, req);
         } else {
-            b->offset %= b->image_size - b->bufsize;
-        }
-        if (b->write) {
-            acb = blk_aio_pwritev(b->blk, offset, b->qiov, 0, bench_cb, b);
-        } else {
-            acb = blk_aio_preadv(b->blk, offset, b->qiov, 0, bench_cb, b);
+            acb = blk_aio_preadv(b->blk, offset, &req->qiov, 0,
+                                 bench_request_cb, req);
         }
         if (!acb) {
             error_report("Failed to issue request");
             exit(EXIT_FAILURE);
         }
     }
+
+    if (!b->n && !b->done) {
+        /* img_bench() may be waiting in another thread */
+        b->done = true;
+        qatomic_dec(b->running_queues);
+        aio_wait_kick();
+    }
+}
+
+static void bench_request_cb(void *opaque, int ret)
+{
+    BenchRequest *req = opaque;
+    BenchData *b = req->b;
+
+    if (ret >= 0) {
+        hdr_histogram_record(req->write ? &b->write_latency :
+                                          &b->read_latency,
+                             get_clock() - req->start_ns);
+    }
+    b->free_reqs[b->nr_free_reqs++] = req - b->reqs;
+
+    bench_cb(b, ret);
+}
+
+static void bench_start_bh(void *opaque)
+{
+    bench_cb(opaque, 0);
+}
+
+static void bench_print_latency(const char *name, const HdrHistogram *h,
+                                double secs)
+{
+    if (!h->count) {
+        return;
+    }
+
+    printf("%s: %" PRIu64 " requests, %.0f IOPS\n", name, h->count,
+           h->count / secs);
+    printf("  latency (us): min %.1f, avg %.1f, p50 %.1f, p99 %.1f, "
+           "p99.9 %.1f, max %.1f\n",
+           h->min / 1000.0, (double)h->sum / h->count / 1000.0,
+           hdr_histogram_quantile(h, 0.5) / 1000.0,
+           hdr_histogram_quantile(h, 0.99) / 1000.0,
+           hdr_histogram_quantile(h, 0.999) / 1000.0,
+           h->max / 1000.0);
 }
 
 static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
@@ -4722,13 +5167,23 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
     ssize_t step = 0;
     int flush_interval = 0;
     bool drain_on_flush = true;
+    int write_ratio = -1;
+    bool random_offsets = false;
+    int64_t seed = 0;
+    int nr_threads = 0;
     int64_t image_size;
     BlockBackend *blk = NULL;
-    BenchData data = {};
+    BenchData *queues = NULL;
+    ImgIOThread *threads[MAX_THREADS] = {};
+    int nr_queues = 0;
+    int running_queues;
+    HdrHistogram read_latency, write_latency;
+    const char *type;
     int flags = 0;
     bool writethrough = false;
     struct timeval t1, t2;
-    int i;
+    double secs;
+    int i, j;
     bool force_share = false;
     size_t buf_size = 0;
 
@@ -4744,6 +5199,10 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
             {"buffer-size", required_argument, 0, 's'},
             {"step-size", required_argument, 0, 'S'},
             {"write", no_argument, 0, 'w'},
+            {"write-ratio", required_argument, 0, OPTION_WRITE_RATIO},
+            {"random", no_argument, 0, OPTION_RANDOM},
+            {"seed", required_argument, 0, OPTION_SEED},
+            {"threads", required_argument, 0, OPTION_THREADS},
             {"pattern", required_argument, 0, OPTION_PATTERN},
             {"flush-interval", required_argument, 0, OPTION_FLUSH_INTERVAL},
             {"no-drain", no_argument, 0, OPTION_NO_DRAIN},
@@ -4765,7 +5224,8 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
             cmd_help(ccmd, "[-f FMT | --image-opts] [-t CACHE]\n"
 "        [-c COUNT] [-d DEPTH] [-o OFFSET] [-s BUFFER_SIZE] [-S STEP_SIZE]\n"
 "        [-w [--pattern PATTERN] [--flush-interval INTERVAL [--no-drain]]]\n"
-"        [-i AIO] [-n] [-U] [-q] FILE\n"
+"        [--write-ratio PERCENT] [--random [--seed SEED]]\n"
+"        [--threads NUM_THREADS] [-i AIO] [-n] [-U] [-q] FILE\n"
 ,
 "  -f, --format FMT\n"
 "     specify FILE format explicitly\n"
@@ -4777,7 +5237,7 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
 "  -c, --count COUNT\n"
 "     number of I/O requests to perform\n"
 "  -d, --depth DEPTH\n"
-"     number of requests to perform in parallel\n"
+"     number of requests to perform in parallel, per thread with --threads\n"
 "  -o, --offset OFFSET\n"
 "     start first request at this OFFSET\n"
 "  -s, --buffer-size BUFFER_SIZE[bkKMGTPE]\n"
@@ -4794,6 +5254,14 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
 "     issue flush after this number of requests\n"
 "  --no-drain\n"
 "     do not wait when flushing pending requests\n"
+"  --write-ratio PERCENT\n"
+"     percentage of write requests (default: 0, or 100 with -w)\n"
+"  --random\n"
+"     use random offsets, aligned to STEP_SIZE, instead of sequential ones\n"
+"  --seed SEED\n"
+"     seed for random offsets and request types (default: 0)\n"
+"  --threads NUM_THREADS\n"
+"     run one request queue in each of NUM_THREADS threads\n"
 "  -i, --aio AIO\n"
 "     async-io backend (threads, native, io_uring)\n"
 "  -n, --native\n"
@@ -4884,6 +5352,28 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         case OPTION_NO_DRAIN:
             drain_on_flush = false;
             break;
+        case OPTION_WRITE_RATIO:
+            write_ratio = cvtnum_full("write ratio", optarg, false, 0, 100);
+            if (write_ratio < 0) {
+                return 1;
+            }
+            break;
+        case OPTION_RANDOM:
+            random_offsets = true;
+            break;
+        case OPTION_SEED:
+            seed = cvtnum_full("seed", optarg, false, 0, UINT32_MAX);
+            if (seed < 0) {
+                return 1;
+            }
+            break;
+        case OPTION_THREADS:
+            nr_threads = cvtnum_full("number of threads", optarg, false, 1,
+                                     MAX_THREADS);
+            if (nr_threads < 0) {
+                return 1;
+            }
+            break;
         case 'U':
             force_share = true;
             break;
@@ -4903,7 +5393,14 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
     }
     filename = argv[argc - 1];
 
-    if (!is_write && flush_interval) {
+    if (write_ratio < 0) {
+        write_ratio = is_write ? 100 : 0;
+    }
+    if (write_ratio) {
+        flags |= BDRV_O_RDWR;
+    }
+
+    if (!write_ratio && flush_interval) {
         error_report("--flush-interval is only available in write tests");
         ret = -1;
         goto out;
@@ -4927,56 +5424,127 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         goto out;
     }
 
-    data = (BenchData) {
-        .blk            = blk,
-        .image_size     = image_size,
-        .bufsize        = bufsize,
-        .step           = step ?: bufsize,
-        .nrreq          = depth,
-        .n              = count,
-        .offset         = offset,
-        .write          = is_write,
-        .flush_interval = flush_interval,
-        .drain_on_flush = drain_on_flush,
-    };
+    step = step ?: bufsize;
+    type = write_ratio == 100 ? "write" : write_ratio ? "mixed" : "read";
     printf("Sending %d %s requests, %d bytes each, %d in parallel "
            "(starting at offset %" PRId64 ", step size %d)\n",
-           data.n, data.write ? "write" : "read", data.bufsize, data.nrreq,
-           data.offset, data.step);
+           count, type, (int)bufsize, depth, offset, (int)step);
     if (flush_interval) {
         printf("Sending flush every %d requests\n", flush_interval);
     }
+    if (write_ratio && write_ratio != 100) {
+        printf("Using %d%% write requests\n", write_ratio);
+    }
+    if (random_offsets) {
+        printf("Using random offsets (seed %" PRId64 ")\n", seed);
+    }
+    if (nr_threads) {
+        printf("Using %d threads with one request queue each\n", nr_threads);
+    }
+
+    /*
+     * Without --threads, a single queue runs in the main loop.  Otherwise
+     * each thread gets a queue with its own buffers and depth, and the
+     * requests are split between them.  Sequential queues interleave their
+     * offsets so that together they still walk the image in order.
+     */
+    nr_queues = MAX(nr_threads, 1);
+    queues = g_new0(BenchData, nr_queues);
+    running_queues = nr_queues;
+    buf_size = depth * bufsize;
+    for (i = 0; i < nr_queues; i++) {
+        BenchData *b = &queues[i];
+
+        *b = (BenchData) {
+            .blk            = blk,
+            .image_size     = image_size,
+            .bufsize        = bufsize,
+            .step           = step * nr_queues,
+            .nrreq          = depth,
+            .n              = count / nr_queues + (i < count % nr_queues),
+            .offset         = offset + i * step,
+            .write_ratio    = write_ratio,
+            .random         = random_offsets,
+            .flush_interval = flush_interval,
+            .drain_on_flush = drain_on_flush,
+            .rand           = g_rand_new_with_seed(seed + i),
+            .running_queues = &running_queues,
+        };
+        if (random_offsets) {
+            b->step = step;
+        }
+        hdr_histogram_init(&b->read_latency);
+        hdr_histogram_init(&b->write_latency);
 
-    buf_size = data.nrreq * data.bufsize;
-    data.buf = blk_blockalign(blk, buf_size);
-    memset(data.buf, pattern, data.nrreq * data.bufsize);
+        b->buf = blk_blockalign(blk, buf_size);
+        memset(b->buf, pattern, buf_size);
+        blk_register_buf(blk, b->buf, buf_size, &error_fatal);
 
-    blk_register_buf(blk, data.buf, buf_size, &error_fatal);
+        b->reqs = g_new0(BenchRequest, depth);
+        b->free_reqs = g_new(int, depth);
+        for (j = 0; j < depth; j++) {
+            b->reqs[j].b = b;
+            qemu_iovec_init(&b->reqs[j].qiov, 1);
+            qemu_iovec_add(&b->reqs[j].qiov, b->buf + j * bufsize, bufsize);
+            b->free_reqs[j] = depth - 1 - j;
+        }
+        b->nr_free_reqs = depth;
+    }
 
-    data.qiov = g_new(QEMUIOVector, data.nrreq);
-    for (i = 0; i < data.nrreq; i++) {
-        qemu_iovec_init(&data.qiov[i], 1);
-        qemu_iovec_add(&data.qiov[i],
-                       data.buf + i * data.bufsize, data.bufsize);
+    for (i = 0; i < nr_threads; i++) {
+        threads[i] = img_iothread_new();
     }
 
     gettimeofday(&t1, NULL);
-    bench_cb(&data, 0);
+    if (nr_threads) {
+        for (i = 0; i < nr_threads; i++) {
+            aio_bh_schedule_oneshot(threads[i]->ctx, bench_start_bh,
+                                    &queues[i]);
+        }
+    } else {
+        bench_cb(&queues[0], 0);
+    }
 
-    while (data.n > 0) {
+    while (qatomic_read(&running_queues) > 0) {
         main_loop_wait(false);
     }
     gettimeofday(&t2, NULL);
 
-    printf("Run completed in %3.3f seconds.\n",
-           (t2.tv_sec - t1.tv_sec)
-           + ((double)(t2.tv_usec - t1.tv_usec) / 1000000));
+    /* Wait for flushes that were sent with --no-drain */
+    blk_drain(blk);
+
+    secs = (t2.tv_sec - t1.tv_sec)
+           + ((double)(t2.tv_usec - t1.tv_usec) / 1000000);
+    printf("Run completed in %3.3f seconds.\n", secs);
+
+    hdr_histogram_init(&read_latency);
+    hdr_histogram_init(&write_latency);
+    for (i = 0; i < nr_queues; i++) {
+        hdr_histogram_merge(&read_latency, &queues[i].read_latency);
+        hdr_histogram_merge(&write_latency, &queues[i].write_latency);
+    }
+    bench_print_latency("Reads", &read_latency, secs);
+    bench_print_latency("Writes", &write_latency, secs);
 
 out:
-    if (data.buf) {
-        blk_unregister_buf(blk, data.buf, buf_size);
+    for (i = 0; i < nr_threads; i++) {
+        if (threads[i]) {
+            img_iothread_join(threads[i]);
+        }
+    }
+    for (i = 0; i < nr_queues; i++) {
+        BenchData *b = &queues[i];
+
+        for (j = 0; j < depth; j++) {
+            qemu_iovec_destroy(&b->reqs[j].qiov);
+        }
+        g_free(b->reqs);
+        g_free(b->free_reqs);
+        g_rand_free(b->rand);
+        blk_unregister_buf(blk, b->buf, buf_size);
+        qemu_vfree(b->buf);
     }
-    qemu_vfree(data.buf);
+    g_free(queues);
     blk_unref(blk);
 
     if (ret) {
@@ -5192,7 +5760,7 @@ static int img_bitmap(const img_cmd_t *ccmd, int argc, char **argv)
         case BITMAP_ADD:
             qmp_block_dirty_bitmap_add(bs->node_name, bitmap,
                                        !!granularity, granularity, true, true,
-                                       false, false, &err);
+                                       false, false, false, false, &err);
             op = "add";
             break;
         case BITMAP_REMOVE:
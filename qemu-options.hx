@@ -233,7 +233,9 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                one-insn-per-tb=on|off (one guest instruction per TCG translation block)\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                jmp-cache-bits=n (log2 of the TCG per-vCPU jump cache entries, default 12)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
+    "                dirty-ring-reapers=n (threads reaping KVM dirty rings, default 0, automatic)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n"
@@ -276,6 +278,14 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``jmp-cache-bits=n``
+        Sets the per-vCPU TCG jump cache, which maps guest PCs to
+        translation blocks, to 2^n entries.  Guests that run a lot of
+        code, such as big kernels, can see fewer lookups fall back to
+        the translation block hash table with a bigger cache.  The
+        value must be between 8 and 20 (default=12).  The hit rate is
+        reported by ``info jit``.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -294,6 +304,12 @@ SRST
         is disabled (dirty-ring-size=0).  When enabled, KVM will instead
         record dirty pages in a bitmap.
 
+    ``dirty-ring-reapers=n``
+        When the KVM dirty ring is enabled, collecting the dirty pages of
+        all vCPUs is split across this many threads, each handling a
+        subset of the vCPUs.  The maximum is 64.  By default
+        (dirty-ring-reapers=0) one thread is used per 32 vCPUs, up to 8.
+
     ``eager-split-size=n``
         KVM implements dirty page logging at the PAGE_SIZE granularity and
         enabling dirty-logging on a huge-page requires breaking it into
@@ -2947,7 +2963,7 @@ DEF("netdev", HAS_ARG, QEMU_OPTION_netdev,
 #ifdef CONFIG_AF_XDP
     "-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off]\n"
     "         [,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z]\n"
-    "         [,map-path=/path/to/socket/map][,map-start-index=i]\n"
+    "         [,map-path=/path/to/socket/map][,map-start-index=i][,busy-poll-budget=b]\n"
     "                attach to the existing network interface 'name' with AF_XDP socket\n"
     "                use 'mode=MODE' to specify an XDP program attach mode\n"
     "                use 'force-copy=on|off' to force XDP copy mode even if device supports zero-copy (default: off)\n"
@@ -2959,6 +2975,7 @@ DEF("netdev", HAS_ARG, QEMU_OPTION_netdev,
     "                  and use 'map-start-index' to specify the starting index for the map (default: 0) (Since 10.1)\n"
     "                use 'queues=n' to specify how many queues of a multiqueue interface should be used\n"
     "                use 'start-queue=m' to specify the first queue that should be used\n"
+    "                use 'busy-poll-budget=b' to enable preferred busy polling with a budget of b packets (default: 0, disabled)\n"
 #endif
 #ifdef CONFIG_POSIX
     "-netdev vhost-user,id=str,chardev=dev[,vhostforce=on|off]\n"
@@ -3780,7 +3797,7 @@ SRST
         # launch QEMU instance
         |qemu_system| linux.img -nic vde,sock=/tmp/myswitch
 
-``-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off][,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z][,map-path=/path/to/socket/map][,map-start-index=i]``
+``-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off][,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z][,map-path=/path/to/socket/map][,map-start-index=i][,busy-poll-budget=b]``
     Configure AF_XDP backend to connect to a network interface 'name'
     using AF_XDP socket.  A specific program attach mode for a default
     XDP program can be forced with 'mode', defaults to best-effort,
@@ -3845,6 +3862,17 @@ SRST
     for insertion into the socket map.  The combination of 'map-path' and
     'sock-fds' together is not supported.
 
+    'busy-poll-budget' enables preferred busy polling on the AF_XDP sockets
+    with the given NAPI budget.  The device interrupts should be deferred
+    on the host interface for this to pay off, for example:
+
+    .. parsed-literal::
+
+        echo 2 > /sys/class/net/eth0/napi_defer_hard_irqs
+        echo 200000 > /sys/class/net/eth0/gro_flush_timeout
+        |qemu_system| linux.img -device virtio-net-pci,netdev=n1 \\
+            -netdev af-xdp,id=n1,ifname=eth0,queues=4,busy-poll-budget=64
+
 ``-netdev vhost-user,chardev=id[,vhostforce=on|off][,queues=n]``
     Establish a vhost-user netdev, backed by a chardev id. The chardev
     should be a unix domain socket backed one. The vhost-user uses a
@@ -3922,7 +3950,7 @@ DEF("chardev", HAS_ARG, QEMU_OPTION_chardev,
     "-chardev vc,id=id[[,width=width][,height=height]][[,cols=cols][,rows=rows]]\n"
     "         [,mux=on|off][,logfile=PATH][,logappend=on|off]\n"
     "-chardev ringbuf,id=id[,size=size][,logfile=PATH][,logappend=on|off]\n"
-    "-chardev file,id=id,path=path[,input-path=input-file][,mux=on|off][,logfile=PATH][,logappend=on|off]\n"
+    "-chardev file,id=id,path=path[,input-path=input-file][,buffered=on|off][,mux=on|off][,logfile=PATH][,logappend=on|off]\n"
     "-chardev pipe,id=id,path=path[,mux=on|off][,logfile=PATH][,logappend=on|off]\n"
 #ifdef _WIN32
     "-chardev console,id=id[,mux=on|off][,logfile=PATH][,logappend=on|off]\n"
@@ -4166,7 +4194,7 @@ The available backends are:
     Create a ring buffer with fixed size ``size``. size must be a power
     of two and defaults to ``64K``.
 
-``-chardev file,id=id,path=path[,input-path=input-path]``
+``-chardev file,id=id,path=path[,input-path=input-path][,buffered=on|off]``
     Log all traffic received from the guest to a file.
 
     ``path`` specifies the path of the file to be opened. This file will
@@ -4179,6 +4207,11 @@ The available backends are:
 
     Note that ``input-path`` is not supported on Windows hosts.
 
+    ``buffered=on`` collects the output in memory and writes it from
+    the main loop, which is cheaper for guests that log heavily to a
+    serial port. Output that has not been written yet is lost if QEMU
+    crashes. This is not supported on Windows hosts.
+
 ``-chardev pipe,id=id,path=path``
     Create a two-way connection to the guest. The behaviour differs
     slightly between Windows hosts and other hosts:
@@ -6311,7 +6344,7 @@ SRST
 
             CN=laptop.example.com,O=Example Home,L=London,ST=London,C=GB
 
-    ``-object iothread,id=id,poll-max-ns=poll-max-ns,poll-grow=poll-grow,poll-shrink=poll-shrink,aio-max-batch=aio-max-batch``
+    ``-object iothread,id=id,poll-max-ns=poll-max-ns,poll-grow=poll-grow,poll-shrink=poll-shrink,aio-max-batch=aio-max-batch,io-uring-queue-depth=depth,io-uring-sqpoll=on|off,io-uring-sqpoll-cpu=cpu,io-uring-sqpoll-idle=ms,io-uring-iopoll=on|off``
         Creates a dedicated event loop thread that devices can be
         assigned to. This is known as an IOThread. By default device
         emulation happens in vCPU threads or the main event loop thread.
@@ -6351,9 +6384,25 @@ SRST
         in a batch for the AIO engine, 0 means that the engine will use
         its default.
 
-        The IOThread parameters can be modified at run-time using the
-        ``qom-set`` command (where ``iothread1`` is the IOThread's
-        ``id``):
+        The ``io-uring-queue-depth`` parameter is the number of entries
+        in the io_uring used for ``aio=io_uring`` block I/O, 0 means
+        that a default size is used.
+
+        The ``io-uring-sqpoll`` parameter makes a kernel thread poll the
+        io_uring submission queues of the IOThread, which saves system
+        calls at the cost of a busy host CPU. ``io-uring-sqpoll-cpu``
+        binds this thread to a host CPU and ``io-uring-sqpoll-idle`` is
+        the number of milliseconds without submissions after which it
+        goes to sleep.
+
+        The ``io-uring-iopoll`` parameter makes the IOThread busy-poll
+        for ``aio=io_uring`` block I/O completions instead of waiting
+        for interrupts. Only ``cache.direct=on`` reads and writes use
+        io_uring in this mode.
+
+        The IOThread parameters except for the io_uring ones can be
+        modified at run-time using the ``qom-set`` command (where
+        ``iothread1`` is the IOThread's ``id``):
 
         ::
 
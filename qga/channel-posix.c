@@ -3,6 +3,7 @@
 #include <termios.h>
 #include "qapi/error.h"
 #include "qemu/sockets.h"
+#include "guest-agent-core.h"
 #include "channel.h"
 #include "cutils.h"
 
@@ -114,6 +115,8 @@ static int ga_channel_client_add(GAChannel *c, int fd)
         g_error_free(err);
         return -1;
     }
+    /* the default buffer of 1 KiB means a syscall per KiB of transfer */
+    g_io_channel_set_buffer_size(client_channel, QGA_CHANNEL_READ_SIZE);
     g_io_add_watch(client_channel, G_IO_IN | G_IO_HUP,
                    ga_channel_client_event, c);
     c->client_channel = client_channel;
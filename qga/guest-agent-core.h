@@ -21,6 +21,12 @@
 #include "qga-qapi-types.h"
 
 #define QGA_READ_COUNT_DEFAULT 4096
+/*
+ * Channel reads are sized for bulk guest-file-write requests, whose
+ * base64 payloads can be megabytes, rather than for the small control
+ * commands.
+ */
+#define QGA_CHANNEL_READ_SIZE (64 * 1024)
 
 typedef struct GAState GAState;
 typedef struct GACommandState GACommandState;
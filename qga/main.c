@@ -95,6 +95,7 @@ struct GAConfig {
 
 struct GAState {
     JSONMessageParser parser;
+    gchar *read_buf;
     GMainLoop *main_loop;
     GAChannel *channel;
     bool virtio; /* fastpath to check for virtio to deal with poll() quirks */
@@ -712,9 +713,10 @@ end:
 static gboolean channel_event_cb(GIOCondition condition, gpointer data)
 {
     GAState *s = data;
-    gchar buf[QGA_READ_COUNT_DEFAULT + 1];
+    gchar *buf = s->read_buf;
     gsize count;
-    GIOStatus status = ga_channel_read(s->channel, buf, QGA_READ_COUNT_DEFAULT, &count);
+    GIOStatus status = ga_channel_read(s->channel, buf, QGA_CHANNEL_READ_SIZE,
+                                       &count);
     switch (status) {
     case G_IO_STATUS_ERROR:
         g_warning("error reading channel");
@@ -1487,6 +1489,7 @@ static GAState *initialize_agent(GAConfig *config, int socket_activation)
     ga_command_state_init(s, s->command_state);
     ga_command_state_init_all(s->command_state);
     json_message_parser_init(&s->parser, process_event, s, NULL);
+    s->read_buf = g_malloc(QGA_CHANNEL_READ_SIZE + 1);
 
 #ifndef _WIN32
     if (!register_signal_handlers()) {
@@ -1555,6 +1558,7 @@ static void cleanup_agent(GAState *s)
         ga_command_state_free(s->command_state);
         json_message_parser_destroy(&s->parser);
     }
+    g_free(s->read_buf);
     g_free(s->pstate_filepath);
     g_free(s->state_filepath_isfrozen);
     if (s->main_loop) {
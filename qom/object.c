@@ -333,6 +333,32 @@ static void object_property_free(gpointer data)
     g_free(prop);
 }
 
+/*
+ * Bumped whenever a property is added to a class whose flattened table was
+ * already built.  Tables from an older generation may then miss properties
+ * of an ancestor and are no longer used.
+ */
+static unsigned class_property_gen;
+
+static void type_build_flat_properties(ObjectClass *klass)
+{
+    GHashTable *flat = g_hash_table_new(g_str_hash, g_str_equal);
+    ObjectClass *c;
+
+    for (c = klass; c; c = object_class_get_parent(c)) {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init(&iter, c->properties);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            g_hash_table_insert(flat, key, value);
+        }
+    }
+
+    klass->flat_properties_gen = qatomic_read(&class_property_gen);
+    klass->flat_properties = flat;
+}
+
 static void type_initialize(TypeImpl *ti)
 {
     TypeImpl *parent;
@@ -403,6 +429,7 @@ static void type_initialize(TypeImpl *ti)
 
     ti->class->properties = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
                                                   object_property_free);
+    ti->class->flat_properties = NULL;
 
     ti->class->type = ti;
 
@@ -416,6 +443,8 @@ static void type_initialize(TypeImpl *ti)
     if (ti->class_init) {
         ti->class_init(ti->class, ti->class_data);
     }
+
+    type_build_flat_properties(ti->class);
 }
 
 static void object_init_with_type(Object *obj, TypeImpl *ti)
@@ -1308,6 +1337,11 @@ object_class_property_add(ObjectClass *klass,
 
     assert(!object_class_property_find(klass, name));
 
+    if (klass->flat_properties) {
+        /* Added after class_init, subclasses' flat tables are stale now */
+        qatomic_inc(&class_property_gen);
+    }
+
     prop = g_malloc0(sizeof(*prop));
 
     prop->name = g_strdup(name);
@@ -1378,6 +1412,11 @@ ObjectProperty *object_class_property_find(ObjectClass *klass, const char *name)
 {
     ObjectClass *parent_klass;
 
+    if (klass->flat_properties &&
+        klass->flat_properties_gen == qatomic_read(&class_property_gen)) {
+        return g_hash_table_lookup(klass->flat_properties, name);
+    }
+
     parent_klass = object_class_get_parent(klass);
     if (parent_klass) {
         ObjectProperty *prop =
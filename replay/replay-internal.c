@@ -15,6 +15,7 @@
 #include "replay-internal.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
+#include "qemu/bswap.h"
 
 /* Mutex to protect reading and writing events to the log.
    data_kind and has_unread_data are also protected
@@ -60,31 +61,44 @@ void replay_put_event(uint8_t event)
 }
 
 
+static void replay_put_bytes(const uint8_t *buf, size_t size)
+{
+    if (replay_file) {
+        if (fwrite(buf, 1, size, replay_file) != size) {
+            replay_write_error();
+        }
+    }
+}
+
 void replay_put_word(uint16_t word)
 {
-    replay_put_byte(word >> 8);
-    replay_put_byte(word);
+    uint8_t buf[2];
+
+    stw_be_p(buf, word);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_dword(uint32_t dword)
 {
-    replay_put_word(dword >> 16);
-    replay_put_word(dword);
+    uint8_t buf[4];
+
+    stl_be_p(buf, dword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_qword(int64_t qword)
 {
-    replay_put_dword(qword >> 32);
-    replay_put_dword(qword);
+    uint8_t buf[8];
+
+    stq_be_p(buf, qword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_array(const uint8_t *buf, size_t size)
 {
     if (replay_file) {
         replay_put_dword(size);
-        if (fwrite(buf, 1, size, replay_file) != size) {
-            replay_write_error();
-        }
+        replay_put_bytes(buf, size);
     }
 }
 
@@ -101,12 +115,21 @@ uint8_t replay_get_byte(void)
     return byte;
 }
 
+static void replay_get_bytes(uint8_t *buf, size_t size)
+{
+    if (fread(buf, 1, size, replay_file) != size) {
+        replay_read_error();
+    }
+}
+
 uint16_t replay_get_word(void)
 {
     uint16_t word = 0;
     if (replay_file) {
-        word = replay_get_byte();
-        word = (word << 8) + replay_get_byte();
+        uint8_t buf[2];
+
+        replay_get_bytes(buf, sizeof(buf));
+        word = lduw_be_p(buf);
     }
 
     return word;
@@ -116,8 +139,10 @@ uint32_t replay_get_dword(void)
 {
     uint32_t dword = 0;
     if (replay_file) {
-        dword = replay_get_word();
-        dword = (dword << 16) + replay_get_word();
+        uint8_t buf[4];
+
+        replay_get_bytes(buf, sizeof(buf));
+        dword = ldl_be_p(buf);
     }
 
     return dword;
@@ -127,8 +152,10 @@ int64_t replay_get_qword(void)
 {
     int64_t qword = 0;
     if (replay_file) {
-        qword = replay_get_dword();
-        qword = (qword << 32) + replay_get_dword();
+        uint8_t buf[8];
+
+        replay_get_bytes(buf, sizeof(buf));
+        qword = ldq_be_p(buf);
     }
 
     return qword;
@@ -138,9 +165,7 @@ void replay_get_array(uint8_t *buf, size_t *size)
 {
     if (replay_file) {
         *size = replay_get_dword();
-        if (fread(buf, 1, *size, replay_file) != *size) {
-            replay_read_error();
-        }
+        replay_get_bytes(buf, *size);
     }
 }
 
@@ -149,9 +174,7 @@ void replay_get_array_alloc(uint8_t **buf, size_t *size)
     if (replay_file) {
         *size = replay_get_dword();
         *buf = g_malloc(*size);
-        if (fread(*buf, 1, *size, replay_file) != *size) {
-            replay_read_error();
-        }
+        replay_get_bytes(*buf, *size);
     }
 }
 
@@ -25,6 +25,8 @@
 #define REPLAY_VERSION              0xe0200c
 /* Size of replay log header */
 #define HEADER_SIZE                 (sizeof(uint32_t) + sizeof(uint64_t))
+/* stdio buffer for the log, the default one is a single page */
+#define REPLAY_FILE_BUFFER_SIZE     (1 << 20)
 
 ReplayMode replay_mode = REPLAY_MODE_NONE;
 char *replay_snapshot;
@@ -360,6 +362,11 @@ static void replay_enable(const char *fname, int mode)
         fprintf(stderr, "Replay: open %s: %s\n", fname, strerror(errno));
         exit(1);
     }
+    /*
+     * Events are small and frequent, a large buffer keeps most of them
+     * from reaching the kernel one page at a time.
+     */
+    setvbuf(replay_file, NULL, _IOFBF, REPLAY_FILE_BUFFER_SIZE);
 
     replay_filename = g_strdup(fname);
     replay_mode = mode;
@@ -182,6 +182,21 @@ pub fn init_io<T: IsA<Object>>(
             );
         }
     }
+
+    /// Let the `MemoryRegionOps` callbacks run without the Big QEMU Lock.
+    ///
+    /// # Safety
+    ///
+    /// The callbacks may then run concurrently on several vCPU threads.
+    /// The device must not touch [`BqlCell`](crate::cell::BqlCell) or
+    /// [`BqlRefCell`](crate::cell::BqlRefCell) fields from them, and must
+    /// protect its state with its own synchronization (atomics or a
+    /// mutex) instead.
+    pub unsafe fn enable_lockless_io(&self) {
+        unsafe {
+            bindings::memory_region_enable_lockless_io(self.0.as_mut_ptr());
+        }
+    }
 }
 
 unsafe impl ObjectType for MemoryRegion {
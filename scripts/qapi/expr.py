@@ -234,7 +234,8 @@ def check_flags(expr: QAPIExpression) -> None:
         if key in expr and expr[key] is not False:
             raise QAPISemError(
                 expr.info, "flag '%s' may only use false value" % key)
-    for key in ('boxed', 'allow-oob', 'allow-preconfig', 'coroutine'):
+    for key in ('boxed', 'allow-oob', 'allow-preconfig', 'coroutine',
+                'allow-no-bql'):
         if key in expr and expr[key] is not True:
             raise QAPISemError(
                 expr.info, "flag '%s' may only use true value" % key)
@@ -245,6 +246,13 @@ def check_flags(expr: QAPIExpression) -> None:
         # a use case for it.
         raise QAPISemError(
             expr.info, "flags 'allow-oob' and 'coroutine' are incompatible")
+    for key in ('allow-oob', 'coroutine'):
+        # Out-of-band commands never hold the BQL anyway, and coroutine
+        # commands may yield to code that expects the BQL held.
+        if key in expr and 'allow-no-bql' in expr:
+            raise QAPISemError(
+                expr.info,
+                "flags '%s' and 'allow-no-bql' are incompatible" % key)
 
 
 def check_if(expr: Dict[str, object],
@@ -661,7 +669,7 @@ def check_exprs(exprs: List[QAPIExpression]) -> List[QAPIExpression]:
                        ['command'],
                        ['data', 'returns', 'boxed', 'if', 'features',
                         'gen', 'success-response', 'allow-oob',
-                        'allow-preconfig', 'coroutine'])
+                        'allow-preconfig', 'coroutine', 'allow-no-bql'])
             normalize_members(expr.get('data'))
             check_command(expr)
         elif meta == 'event':
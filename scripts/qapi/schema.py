@@ -254,6 +254,7 @@ def visit_command(
         allow_oob: bool,
         allow_preconfig: bool,
         coroutine: bool,
+        allow_no_bql: bool,
     ) -> None:
         pass
 
@@ -1007,6 +1008,7 @@ def __init__(
         allow_oob: bool,
         allow_preconfig: bool,
         coroutine: bool,
+        allow_no_bql: bool,
     ):
         super().__init__(name, info, doc, ifcond, features)
         self._arg_type_name = arg_type
@@ -1019,6 +1021,7 @@ def __init__(
         self.allow_oob = allow_oob
         self.allow_preconfig = allow_preconfig
         self.coroutine = coroutine
+        self.allow_no_bql = allow_no_bql
 
     def check(self, schema: QAPISchema) -> None:
         assert self.info is not None
@@ -1071,7 +1074,7 @@ def visit(self, visitor: QAPISchemaVisitor) -> None:
             self.name, self.info, self.ifcond, self.features,
             self.arg_type, self.ret_type, self.gen, self.success_response,
             self.boxed, self.allow_oob, self.allow_preconfig,
-            self.coroutine)
+            self.coroutine, self.allow_no_bql)
 
 
 class QAPISchemaEvent(QAPISchemaDefinition):
@@ -1453,6 +1456,7 @@ def _def_command(self, expr: QAPIExpression) -> None:
         allow_oob = expr.get('allow-oob', False)
         allow_preconfig = expr.get('allow-preconfig', False)
         coroutine = expr.get('coroutine', False)
+        allow_no_bql = expr.get('allow-no-bql', False)
         ifcond = QAPISchemaIfCond(expr.get('if'))
         info = expr.info
         features = self._make_features(expr.get('features'), info)
@@ -1466,7 +1470,7 @@ def _def_command(self, expr: QAPIExpression) -> None:
         self._def_definition(
             QAPISchemaCommand(name, info, expr.doc, ifcond, features, data,
                               rets, gen, success_response, boxed, allow_oob,
-                              allow_preconfig, coroutine))
+                              allow_preconfig, coroutine, allow_no_bql))
 
     def _def_event(self, expr: QAPIExpression) -> None:
         name = expr['event']
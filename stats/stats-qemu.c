@@ -0,0 +1,99 @@
+/*
+ * "qemu" statistics provider
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "system/stats.h"
+
+static QTAILQ_HEAD(, QemuStat) qemu_stats =
+    QTAILQ_HEAD_INITIALIZER(qemu_stats);
+
+static void query_qemu_stats_cb(StatsResultList **result, StatsTarget target,
+                                strList *names, strList *targets,
+                                Error **errp)
+{
+    StatsList *stats_list = NULL;
+    QemuStat *stat;
+    int i;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    QTAILQ_FOREACH_REVERSE(stat, &qemu_stats, next) {
+        Stats *stats;
+
+        if (!apply_str_list_filter(stat->name, names)) {
+            continue;
+        }
+
+        stats = g_new0(Stats, 1);
+        stats->name = g_strdup(stat->name);
+        stats->value = g_new0(StatsValue, 1);
+        if (stat->n_values == 1) {
+            stats->value->type = QTYPE_QNUM;
+            stats->value->u.scalar = stat64_get(stat->values);
+        } else {
+            uint64List *val_list = NULL;
+
+            for (i = stat->n_values - 1; i >= 0; i--) {
+                QAPI_LIST_PREPEND(val_list, stat64_get(&stat->values[i]));
+            }
+            stats->value->type = QTYPE_QLIST;
+            stats->value->u.list = val_list;
+        }
+        QAPI_LIST_PREPEND(stats_list, stats);
+    }
+
+    if (stats_list) {
+        add_stats_entry(result, STATS_PROVIDER_QEMU, NULL, stats_list);
+    }
+}
+
+static void query_qemu_stats_schemas_cb(StatsSchemaList **result,
+                                        Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+    QemuStat *stat;
+
+    QTAILQ_FOREACH_REVERSE(stat, &qemu_stats, next) {
+        StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+        value->name = g_strdup(stat->name);
+        value->type = stat->type;
+        if (stat->has_unit) {
+            value->has_unit = true;
+            value->unit = stat->unit;
+        }
+        if (stat->exponent) {
+            value->has_base = true;
+            value->base = 10;
+            value->exponent = stat->exponent;
+        }
+        QAPI_LIST_PREPEND(stats_list, value);
+    }
+    add_stats_schema(result, STATS_PROVIDER_QEMU, STATS_TARGET_VM,
+                     stats_list);
+}
+
+void qemu_stats_register(QemuStat *stat)
+{
+    static bool registered;
+
+    if (!registered) {
+        add_stats_callbacks(STATS_PROVIDER_QEMU, query_qemu_stats_cb,
+                            query_qemu_stats_schemas_cb);
+        registered = true;
+    }
+
+    assert(stat->n_values >= 1);
+    QTAILQ_INSERT_TAIL(&qemu_stats, stat, next);
+}
+
+void qemu_stats_unregister(QemuStat *stat)
+{
+    QTAILQ_REMOVE(&qemu_stats, stat, next);
+}
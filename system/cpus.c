@@ -142,20 +142,24 @@ void cpu_synchronize_all_states(void)
 
 void cpu_synchronize_all_post_reset(void)
 {
+    int64_t start_us = g_get_monotonic_time();
     CPUState *cpu;
 
     CPU_FOREACH(cpu) {
         cpu_synchronize_post_reset(cpu);
     }
+    trace_cpu_synchronize_all_post_reset(g_get_monotonic_time() - start_us);
 }
 
 void cpu_synchronize_all_post_init(void)
 {
+    int64_t start_us = g_get_monotonic_time();
     CPUState *cpu;
 
     CPU_FOREACH(cpu) {
         cpu_synchronize_post_init(cpu);
     }
+    trace_cpu_synchronize_all_post_init(g_get_monotonic_time() - start_us);
 }
 
 void cpu_synchronize_all_pre_loadvm(void)
@@ -698,6 +702,7 @@ const AccelOpsClass *cpus_get_accel(void)
 void qemu_init_vcpu(CPUState *cpu)
 {
     MachineState *ms = MACHINE(qdev_get_machine());
+    int64_t start_us = g_get_monotonic_time();
 
     cpu->nr_threads =  ms->smp.threads;
     cpu->stopped = true;
@@ -718,6 +723,7 @@ void qemu_init_vcpu(CPUState *cpu)
     while (!cpu->created) {
         qemu_cond_wait(&qemu_cpu_cond, &bql);
     }
+    trace_qemu_init_vcpu(cpu->cpu_index, g_get_monotonic_time() - start_us);
 }
 
 void cpu_stop_current(void)
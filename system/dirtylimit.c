@@ -12,6 +12,8 @@
 
 #include "qemu/osdep.h"
 #include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
 #include "qapi/qapi-commands-migration.h"
 #include "qobject/qdict.h"
 #include "qapi/error.h"
@@ -43,6 +45,11 @@
  * composed of dirty ring full and sleep time.
  */
 #define DIRTYLIMIT_THROTTLE_PCT_MAX 99
+/*
+ * Min share of a cycle, in permille, that a vcpu dirtying faster
+ * than its share of the budget is allowed to run.
+ */
+#define DIRTYLIMIT_BUDGET_PERMILLE_MIN  10
 
 struct {
     VcpuStat stat;
@@ -58,6 +65,8 @@ typedef struct VcpuDirtyLimitState {
      * zero if not enabled.
      */
     uint64_t quota;
+    /* Time the vcpu resumed after its last throttle, in us */
+    int64_t resume_us;
 } VcpuDirtyLimitState;
 
 struct {
@@ -66,6 +75,13 @@ struct {
     int max_cpus;
     /* Number of vcpu under dirtylimit */
     int limited_nvcpu;
+    /*
+     * Total dirty page rate budget of the limited vcpus, unit is MB/s,
+     * zero if every vcpu is limited to its own quota instead.
+     */
+    uint64_t budget;
+    /* Share of a cycle the vcpus over budget run, in permille */
+    uint64_t allowed_permille;
 } *dirtylimit_state;
 
 /* protect dirtylimit_state */
@@ -211,6 +227,7 @@ void dirtylimit_state_initialize(void)
     }
 
     dirtylimit_state->max_cpus = max_cpus;
+    dirtylimit_state->allowed_permille = 1000;
     trace_dirtylimit_state_initialize(max_cpus);
 }
 
@@ -339,6 +356,88 @@ static void dirtylimit_adjust_throttle(CPUState *cpu)
     }
 }
 
+/*
+ * Closed loop on the total dirty page rate: scale the share of time the
+ * vcpus over their share of the budget may run by how far the guest is
+ * from the budget.
+ */
+static void dirtylimit_adjust_budget(void)
+{
+    uint64_t budget = dirtylimit_state->budget;
+    uint64_t allowed = dirtylimit_state->allowed_permille;
+    uint64_t current = 0;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (dirtylimit_vcpu_get_state(cpu->cpu_index)->enabled) {
+            current += vcpu_dirty_rate_get(cpu->cpu_index);
+        }
+    }
+
+    if (current == 0) {
+        allowed = 1000;
+    } else if (!dirtylimit_done(budget, current)) {
+        allowed = allowed * budget / current;
+    }
+
+    allowed = MIN(MAX(allowed, DIRTYLIMIT_BUDGET_PERMILLE_MIN), 1000);
+    dirtylimit_state->allowed_permille = allowed;
+
+    trace_dirtylimit_adjust_budget(budget, current, allowed);
+}
+
+/*
+ * Called at each dirty ring full exit of a vcpu in budget mode: the time
+ * since it last resumed tells how fast it dirties memory, and only the
+ * vcpus dirtying faster than their share of the budget get throttled.
+ */
+static void dirtylimit_budget_throttle(CPUState *cpu,
+                                       VcpuDirtyLimitState *state)
+{
+    uint64_t ring_bytes = kvm_dirty_ring_size() * qemu_target_page_size();
+    uint64_t allowed = dirtylimit_state->allowed_permille;
+    uint64_t share = dirtylimit_state->budget /
+                     MAX(dirtylimit_state->limited_nvcpu, 1);
+    int64_t now = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+    int64_t run_us = now - state->resume_us;
+    uint64_t current;
+    int64_t throttle_us = 0;
+
+    if (!state->resume_us || run_us <= 0) {
+        cpu->throttle_us_per_full = 0;
+        state->resume_us = now;
+        return;
+    }
+
+    /* In MiB/s, like the dirty page rates measured by dirtyrate-stat */
+    current = ring_bytes * 1000000 / MiB / run_us;
+    if (current > share) {
+        throttle_us = run_us * (1000 - allowed) / allowed;
+        throttle_us = MIN(throttle_us, run_us * DIRTYLIMIT_THROTTLE_PCT_MAX);
+    }
+
+    cpu->throttle_us_per_full = throttle_us;
+    state->resume_us = now + throttle_us;
+
+    trace_dirtylimit_budget_throttle(cpu->cpu_index, current, share,
+                                     throttle_us);
+}
+
+void dirtylimit_set_budget(uint64_t budget)
+{
+    dirtylimit_state_lock();
+
+    if (dirtylimit_in_service() && dirtylimit_state->budget != budget) {
+        if (!dirtylimit_state->budget || !budget) {
+            dirtylimit_state->allowed_permille = 1000;
+        }
+        dirtylimit_state->budget = budget;
+        trace_dirtylimit_set_budget(budget);
+    }
+
+    dirtylimit_state_unlock();
+}
+
 void dirtylimit_process(void)
 {
     CPUState *cpu;
@@ -351,6 +450,12 @@ void dirtylimit_process(void)
             return;
         }
 
+        if (dirtylimit_state->budget) {
+            dirtylimit_adjust_budget();
+            dirtylimit_state_unlock();
+            return;
+        }
+
         CPU_FOREACH(cpu) {
             if (!dirtylimit_vcpu_get_state(cpu->cpu_index)->enabled) {
                 continue;
@@ -405,21 +510,35 @@ void dirtylimit_set_all(uint64_t quota,
 
 void dirtylimit_vcpu_execute(CPUState *cpu)
 {
-    if (cpu->throttle_us_per_full) {
-        dirtylimit_state_lock();
+    VcpuDirtyLimitState *state;
 
-        if (dirtylimit_in_service() &&
-            dirtylimit_vcpu_get_state(cpu->cpu_index)->enabled) {
-            dirtylimit_state_unlock();
-            trace_dirtylimit_vcpu_execute(cpu->cpu_index,
-                    cpu->throttle_us_per_full);
+    /* Cheap check for the common case, re-checked under the lock */
+    if (!dirtylimit_in_service()) {
+        return;
+    }
 
-            g_usleep(cpu->throttle_us_per_full);
-            return;
-        }
+    dirtylimit_state_lock();
 
+    if (!dirtylimit_in_service()) {
         dirtylimit_state_unlock();
+        return;
+    }
+
+    state = dirtylimit_vcpu_get_state(cpu->cpu_index);
+    if (state->enabled && dirtylimit_state->budget) {
+        dirtylimit_budget_throttle(cpu, state);
     }
+
+    if (cpu->throttle_us_per_full && state->enabled) {
+        dirtylimit_state_unlock();
+        trace_dirtylimit_vcpu_execute(cpu->cpu_index,
+                cpu->throttle_us_per_full);
+
+        g_usleep(cpu->throttle_us_per_full);
+        return;
+    }
+
+    dirtylimit_state_unlock();
 }
 
 static void dirtylimit_init(void)
@@ -742,11 +742,35 @@ static MemoryRegion *memory_region_get_flatview_root(MemoryRegion *mr)
     return NULL;
 }
 
-/* Render a memory topology into a list of disjoint absolute ranges. */
-static FlatView *generate_memory_topology(MemoryRegion *mr)
+/* Whether @a and @b hold the same ranges, with the same dirty logging */
+static bool flatview_ranges_equal(FlatView *a, FlatView *b)
+{
+    unsigned i;
+
+    if (a->nr != b->nr) {
+        return false;
+    }
+    for (i = 0; i < a->nr; i++) {
+        if (!flatrange_equal(&a->ranges[i], &b->ranges[i]) ||
+            a->ranges[i].dirty_log_mask != b->ranges[i].dirty_log_mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Render a memory topology into a list of disjoint absolute ranges.
+ *
+ * If @old_views holds a FlatView for the same root with exactly the same
+ * ranges, that one is reused, so that neither its dispatch tables nor the
+ * address spaces using it need to be rebuilt.
+ */
+static FlatView *generate_memory_topology(MemoryRegion *mr,
+                                          GHashTable *old_views)
 {
     int i;
-    FlatView *view;
+    FlatView *view, *old_view;
 
     view = flatview_new(mr);
 
@@ -757,6 +781,15 @@ static FlatView *generate_memory_topology(MemoryRegion *mr)
     }
     flatview_simplify(view);
 
+    old_view = old_views ? g_hash_table_lookup(old_views, mr) : NULL;
+    if (old_view && flatview_ranges_equal(view, old_view)) {
+        trace_flatview_reuse(old_view, mr);
+        flatview_unref(view);
+        flatview_ref(old_view);
+        g_hash_table_replace(flat_views, mr, old_view);
+        return old_view;
+    }
+
     view->dispatch = address_space_dispatch_new(view);
     for (i = 0; i < view->nr; i++) {
         MemoryRegionSection mrs =
@@ -1046,7 +1079,7 @@ static void flatviews_init(void)
     flat_views = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
                                        (GDestroyNotify) flatview_unref);
     if (!empty_view) {
-        empty_view = generate_memory_topology(NULL);
+        empty_view = generate_memory_topology(NULL, NULL);
         /* We keep it alive forever in the global variable.  */
         flatview_ref(empty_view);
     } else {
@@ -1057,12 +1090,11 @@ static void flatviews_init(void)
 
 static void flatviews_reset(void)
 {
+    GHashTable *old_views = flat_views;
     AddressSpace *as;
 
-    if (flat_views) {
-        g_hash_table_unref(flat_views);
-        flat_views = NULL;
-    }
+    /* Keep the old FVs around until the new ones are rendered */
+    flat_views = NULL;
     flatviews_init();
 
     /* Render unique FVs */
@@ -1073,7 +1105,11 @@ static void flatviews_reset(void)
             continue;
         }
 
-        generate_memory_topology(physmr);
+        generate_memory_topology(physmr, old_views);
+    }
+
+    if (old_views) {
+        g_hash_table_unref(old_views);
     }
 }
 
@@ -1086,6 +1122,14 @@ static void address_space_set_flatview(AddressSpace *as)
     assert(new_view);
 
     if (old_view == new_view) {
+        /*
+         * The FlatView was reused because nothing changed in it.  Listeners
+         * still get their region_nop calls, which some of them use to
+         * rebuild their state in each begin/commit cycle.
+         */
+        if (!QTAILQ_EMPTY(&as->listeners)) {
+            address_space_update_topology_pass(as, old_view, new_view, true);
+        }
         return;
     }
 
@@ -1128,7 +1172,7 @@ static void address_space_update_topology(AddressSpace *as)
 
     flatviews_init();
     if (!g_hash_table_lookup(flat_views, physmr)) {
-        generate_memory_topology(physmr);
+        generate_memory_topology(physmr, NULL);
     }
     address_space_set_flatview(as);
 }
@@ -1569,6 +1613,9 @@ void memory_region_init_io(MemoryRegion *mr,
     mr->ops = ops ? ops : &unassigned_mem_ops;
     mr->opaque = opaque;
     mr->terminates = true;
+    if (mr->ops->coalesce_writes && size) {
+        memory_region_set_coalescing(mr);
+    }
 }
 
 bool memory_region_init_ram_nomigrate(MemoryRegion *mr,
@@ -63,6 +63,7 @@
 #endif
 
 #include "qemu/rcu_queue.h"
+#include "qemu/coroutine-tls.h"
 #include "qemu/main-loop.h"
 #include "system/replay.h"
 
@@ -137,7 +138,8 @@ typedef struct PhysPageMap {
 } PhysPageMap;
 
 struct AddressSpaceDispatch {
-    MemoryRegionSection *mru_section;
+    /* Unique and never reused, identifies the dispatch in lookup caches */
+    uint64_t id;
     /* This is a multi-level map on the physical address space.
      * The bottom level has pointers to MemoryRegionSections.
      */
@@ -340,18 +342,43 @@ static MemoryRegionSection *phys_page_find(AddressSpaceDispatch *d, hwaddr addr)
     }
 }
 
+/*
+ * Per-thread cache of the most recently used section of a few dispatches.
+ * Keeping it per thread avoids bouncing a shared cache line between vCPUs
+ * that access different regions.  Entries are matched against the unique
+ * dispatch id, so a stale entry for a freed dispatch can never be hit.
+ */
+#define PHYS_LOOKUP_CACHE_SIZE 4
+
+typedef struct PhysLookupCache {
+    struct {
+        uint64_t id;
+        MemoryRegionSection *section;
+    } entries[PHYS_LOOKUP_CACHE_SIZE];
+} PhysLookupCache;
+
+QEMU_DEFINE_STATIC_CO_TLS(PhysLookupCache, phys_lookup_cache)
+
+static uint64_t address_space_dispatch_next_id = 1;
+
 /* Called from RCU critical section */
 static MemoryRegionSection *address_space_lookup_region(AddressSpaceDispatch *d,
                                                         hwaddr addr,
                                                         bool resolve_subpage)
 {
-    MemoryRegionSection *section = qatomic_read(&d->mru_section);
+    PhysLookupCache *cache = get_ptr_phys_lookup_cache();
+    unsigned int idx = d->id % PHYS_LOOKUP_CACHE_SIZE;
+    MemoryRegionSection *section = NULL;
     subpage_t *subpage;
 
+    if (cache->entries[idx].id == d->id) {
+        section = cache->entries[idx].section;
+    }
     if (!section || section == &d->map.sections[PHYS_SECTION_UNASSIGNED] ||
         !section_covers_addr(section, addr)) {
         section = phys_page_find(d, addr);
-        qatomic_set(&d->mru_section, section);
+        cache->entries[idx].id = d->id;
+        cache->entries[idx].section = section;
     }
     if (resolve_subpage && section->mr->subpage) {
         subpage = container_of(section->mr, subpage_t, iomem);
@@ -2728,6 +2755,8 @@ AddressSpaceDispatch *address_space_dispatch_new(FlatView *fv)
     assert(n == PHYS_SECTION_UNASSIGNED);
 
     d->phys_map  = (PhysPageEntry) { .ptr = PHYS_MAP_NODE_NIL, .skip = 1 };
+    /* Dispatches are only created with the BQL held */
+    d->id = address_space_dispatch_next_id++;
 
     return d;
 }
@@ -2901,7 +2930,15 @@ bool prepare_mmio_access(MemoryRegion *mr)
     bool release_lock = false;
 
     if (!bql_locked() && !mr->lockless_io) {
-        bql_lock();
+        if (trace_event_get_state_backends(TRACE_PREPARE_MMIO_ACCESS_BQL)) {
+            int64_t t0 = get_clock();
+
+            bql_lock();
+            trace_prepare_mmio_access_bql(mr, memory_region_name(mr),
+                                          get_clock() - t0);
+        } else {
+            bql_lock();
+        }
         release_lock = true;
     }
     if (mr->flush_coalesced_mmio) {
@@ -3301,6 +3338,8 @@ void address_space_register_map_client(AddressSpace *as, QEMUBH *bh)
 {
     AddressSpaceMapClient *client = g_malloc(sizeof(*client));
 
+    trace_address_space_register_map_client(as, bh);
+
     QEMU_LOCK_GUARD(&as->map_client_list_lock);
     client->bh = bh;
     QLIST_INSERT_HEAD(&as->map_client_list, client, link);
@@ -3341,6 +3380,15 @@ void address_space_unregister_map_client(AddressSpace *as, QEMUBH *bh)
 
 static void address_space_notify_map_clients(AddressSpace *as)
 {
+    /*
+     * Pairs with the barrier in address_space_register_map_client(): a client
+     * that is not on the list yet will see the freed bounce buffer space and
+     * notify itself, so don't take the lock on every unmap for nothing.
+     */
+    if (!qatomic_read(&as->map_client_list.lh_first)) {
+        return;
+    }
+
     QEMU_LOCK_GUARD(&as->map_client_list_lock);
     address_space_notify_map_clients_locked(as);
 }
@@ -3449,6 +3497,8 @@ void *address_space_map(AddressSpace *as,
         }
 
         if (l == 0) {
+            trace_address_space_map_bounce_exhausted(as, addr, len,
+                                                     as->max_bounce_buffer_size);
             *plen = 0;
             return NULL;
         }
@@ -3987,14 +4037,13 @@ void mtree_print_dispatch(AddressSpaceDispatch *d, MemoryRegion *root)
                                 " [ROM]", " [watch]" };
 
         qemu_printf("      #%d @" HWADDR_FMT_plx ".." HWADDR_FMT_plx
-                    " %s%s%s%s%s",
+                    " %s%s%s%s",
             i,
             s->offset_within_address_space,
             s->offset_within_address_space + MR_SIZE(s->size),
             s->mr->name ? s->mr->name : "(noname)",
             i < ARRAY_SIZE(names) ? names[i] : "",
             s->mr == root ? " [ROOT]" : "",
-            s == d->mru_section ? " [MRU]" : "",
             s->mr->is_iommu ? " [iommu]" : "");
 
         if (s->mr->alias) {
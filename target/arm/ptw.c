@@ -2163,6 +2163,8 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
 
     result->f.phys_addr = descaddr;
     result->f.lg_page_size = ctz64(page_size);
+    /* A single block descriptor maps a contiguous output range */
+    result->f.lg_page_contiguous = true;
     return false;
 
  do_translation_fault:
@@ -3344,6 +3346,8 @@ static bool get_phys_addr_twostage(CPUARMState *env, S1Translate *ptw,
     } else if (result->f.lg_page_size < s1_lgpgsz) {
         result->f.lg_page_size = s1_lgpgsz;
     }
+    /* The combined page may span several stage 2 pages, or vice versa */
+    result->f.lg_page_contiguous = false;
 
     /* Combine the S1 and S2 cache attributes. */
     hcr = arm_hcr_el2_eff_secstate(env, in_space);
@@ -3534,6 +3538,10 @@ static bool get_phys_addr_gpc(CPUARMState *env, S1Translate *ptw,
         fi->type = ARMFault_GPCFOnOutput;
         return true;
     }
+    if (cpu_isar_feature(aa64_rme, env_archcpu(env))) {
+        /* The GPC granule may be smaller than the page */
+        result->f.lg_page_contiguous = false;
+    }
     return false;
 }
 
@@ -6210,6 +6210,116 @@ void sve_cont_ldst_mte_check(SVEContLdSt *info, CPUARMState *env,
     }
 }
 
+/*
+ * Return true if every element of the @reg_max byte vector is active.
+ */
+static bool sve_pred_all_active(uint64_t *vg, intptr_t reg_max, int esz)
+{
+    uint64_t mask = pred_esz_masks[esz];
+    intptr_t i;
+
+    for (i = 0; i < reg_max / 64; i++) {
+        if ((vg[i] & mask) != mask) {
+            return false;
+        }
+    }
+    if (reg_max & 63) {
+        mask &= MAKE_64BIT_MASK(0, reg_max & 63);
+        if ((vg[i] & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * The host functions that move elements unchanged, so that a run of them
+ * is a plain copy between guest memory and the vector register.  This
+ * holds for little-endian data on little-endian hosts only, as the
+ * register layout is swizzled with H1_* on big-endian hosts.
+ */
+#define SVE_HOST_FN_IS_COPY(FN)                                         \
+    (!HOST_BIG_ENDIAN &&                                                \
+     ((FN) == sve_ld1bb_host || (FN) == sve_ld1hh_le_host ||            \
+      (FN) == sve_ld1ss_le_host || (FN) == sve_ld1dd_le_host ||         \
+      (FN) == sve_st1bb_host || (FN) == sve_st1hh_le_host ||            \
+      (FN) == sve_st1ss_le_host || (FN) == sve_st1dd_le_host))
+
+/*
+ * Fast path for single register contiguous accesses with all elements
+ * active and no element crossing a page boundary: copy the part on each
+ * page at once.  The pages must have been probed as RAM.
+ *
+ * Each element must still be single-copy atomic.  Bytes are copied with
+ * memcpy; wider elements with aligned 8-byte atomic accesses, each of
+ * which covers whole elements.  Anything else takes the element loop.
+ */
+static bool sve_cont_ldst_copy(SVEContLdSt *info, void *vd, uint64_t *vg,
+                               intptr_t reg_max, int esz, bool is_load,
+                               uintptr_t retaddr)
+{
+    int16_t first, last;
+    intptr_t len;
+
+    if (info->mem_off_split >= 0 || !sve_pred_all_active(vg, reg_max, esz)) {
+        return false;
+    }
+
+    if (esz != MO_8) {
+#ifdef CONFIG_ATOMIC64
+        for (int i = 0; i < 2; i++) {
+            first = info->reg_off_first[i];
+            last = info->reg_off_last[i];
+            if (first < 0 || last < 0) {
+                continue;
+            }
+            len = last - first + (1 << esz);
+            if (((uintptr_t)(info->page[i].host + first) | len) & 7) {
+                return false;
+            }
+        }
+#else
+        return false;
+#endif
+    }
+
+    set_helper_retaddr(retaddr);
+    for (int i = 0; i < 2; i++) {
+        void *host;
+
+        first = info->reg_off_first[i];
+        last = info->reg_off_last[i];
+        if (first < 0 || last < 0) {
+            continue;
+        }
+        /* Without extension, reg_off and mem_off are equal. */
+        host = info->page[i].host + first;
+        len = last - first + (1 << esz);
+
+        if (esz == MO_8) {
+            if (is_load) {
+                memcpy(vd + first, host, len);
+            } else {
+                memcpy(host, vd + first, len);
+            }
+            continue;
+        }
+#ifdef CONFIG_ATOMIC64
+        for (intptr_t j = 0; j < len; j += 8) {
+            uint64_t *p = host + j;
+
+            if (is_load) {
+                stq_he_p(vd + first + j, qatomic_read__nocheck(p));
+            } else {
+                qatomic_set__nocheck(p, ldq_he_p(vd + first + j));
+            }
+        }
+#endif
+    }
+    clear_helper_retaddr();
+    return true;
+}
+
 /*
  * Common helper for all contiguous 1,2,3,4-register predicated stores.
  */
@@ -6294,6 +6404,12 @@ void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
 
     /* The entire operation is in RAM, on valid pages. */
 
+    if (N == 1 && esz == msz && SVE_HOST_FN_IS_COPY(host_fn) &&
+        sve_cont_ldst_copy(&info, &env->vfp.zregs[rd], vg, reg_max, esz,
+                           true, retaddr)) {
+        return;
+    }
+
     for (i = 0; i < N; ++i) {
         memset(&env->vfp.zregs[(rd + i) & 31], 0, reg_max);
     }
@@ -6915,6 +7031,12 @@ void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
         return;
     }
 
+    if (N == 1 && esz == msz && SVE_HOST_FN_IS_COPY(host_fn) &&
+        sve_cont_ldst_copy(&info, &env->vfp.zregs[rd], vg, reg_max, esz,
+                           false, retaddr)) {
+        return;
+    }
+
     mem_off = info.mem_off_first[0];
     reg_off = info.reg_off_first[0];
     reg_last = info.reg_off_last[0];
@@ -67,6 +67,7 @@
 #include "emulate/x86_emu.h"
 #include "x86_task.h"
 #include "x86hvf.h"
+#include "trace.h"
 
 #include <Hypervisor/hv.h>
 #include <Hypervisor/hv_vmx.h>
@@ -763,6 +764,7 @@ int hvf_vcpu_exec(CPUState *cpu)
         hvf_store_events(cpu, ins_len, idtvec_info);
         rip = rreg(cpu->accel->fd, HV_X86_RIP);
         env->eflags = rreg(cpu->accel->fd, HV_X86_RFLAGS);
+        trace_hvf_x86_exit(exit_reason, exit_qual, rip, ins_len);
 
         bql_lock();
 
@@ -804,6 +806,7 @@ int hvf_vcpu_exec(CPUState *cpu)
             if (ept_emulation_fault(slot, gpa, exit_qual)) {
                 struct x86_decode decode;
 
+                trace_hvf_x86_mmio(gpa, rip);
                 hvf_load_regs(cpu);
                 decode_instruction(env, &decode);
                 exec_instruction(env, &decode);
@@ -822,7 +825,10 @@ int hvf_vcpu_exec(CPUState *cpu)
 
             if (!string && in) {
                 uint64_t val = 0;
-                hvf_load_regs(cpu);
+
+                /* Only RAX and RIP change, don't sync all GPRs */
+                RAX(env) = rreg(cpu->accel->fd, HV_X86_RAX);
+                env->eip = rip;
                 hvf_handle_io(env_cpu(env), port, &val, 0, size, 1);
                 if (size == 1) {
                     AL(env) = val;
@@ -833,8 +839,14 @@ int hvf_vcpu_exec(CPUState *cpu)
                 } else {
                     RAX(env) = (uint64_t)val;
                 }
-                env->eip += ins_len;
-                hvf_store_regs(cpu);
+                if (cpu->vcpu_dirty) {
+                    /* The device synchronized the whole state */
+                    env->eip = rip + ins_len;
+                    hvf_store_regs(cpu);
+                } else {
+                    wreg(cpu->accel->fd, HV_X86_RAX, RAX(env));
+                    macvm_set_rip(cpu, rip + ins_len);
+                }
                 break;
             } else if (!string && !in) {
                 RAX(env) = rreg(cpu->accel->fd, HV_X86_RAX);
@@ -901,14 +913,25 @@ int hvf_vcpu_exec(CPUState *cpu)
         case EXIT_REASON_RDMSR:
         case EXIT_REASON_WRMSR:
         {
-            hvf_load_regs(cpu);
+            /* MSR accesses only use RCX, RAX and RDX */
+            RCX(env) = rreg(cpu->accel->fd, HV_X86_RCX);
+            RAX(env) = rreg(cpu->accel->fd, HV_X86_RAX);
+            RDX(env) = rreg(cpu->accel->fd, HV_X86_RDX);
+            env->eip = rip;
             if (exit_reason == EXIT_REASON_RDMSR) {
                 hvf_simulate_rdmsr(cpu);
             } else {
                 hvf_simulate_wrmsr(cpu);
             }
-            env->eip += ins_len;
-            hvf_store_regs(cpu);
+            if (cpu->vcpu_dirty) {
+                /* Something synchronized the whole state, write it back */
+                env->eip = rip + ins_len;
+                hvf_store_regs(cpu);
+            } else {
+                wreg(cpu->accel->fd, HV_X86_RAX, RAX(env));
+                wreg(cpu->accel->fd, HV_X86_RDX, RDX(env));
+                macvm_set_rip(cpu, rip + ins_len);
+            }
             break;
         }
         case EXIT_REASON_CR_ACCESS: {
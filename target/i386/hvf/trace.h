@@ -0,0 +1 @@
+#include "trace/trace-target_i386_hvf.h"
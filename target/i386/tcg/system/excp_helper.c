@@ -623,11 +623,21 @@ bool x86_cpu_tlb_fill(CPUState *cs, vaddr addr, int size,
          * Even if 4MB pages, we map only one 4KB page in the cache to
          * avoid filling it too fast.
          */
+        CPUTLBEntryFull full = {
+            .phys_addr = out.paddr & TARGET_PAGE_MASK,
+            .attrs = cpu_get_mem_attrs(env),
+            .prot = out.prot,
+            .lg_page_size = ctz32(out.page_size),
+            /*
+             * With NPT the page size may come from either stage, and
+             * with A20 masking bit 20 of the address is dropped.
+             */
+            .lg_page_contiguous = !(env->hflags2 & HF2_NPT_MASK) &&
+                                  x86_get_a20_mask(env) == -1,
+        };
+
         assert(out.prot & (1 << access_type));
-        tlb_set_page_with_attrs(cs, addr & TARGET_PAGE_MASK,
-                                out.paddr & TARGET_PAGE_MASK,
-                                cpu_get_mem_attrs(env),
-                                out.prot, mmu_idx, out.page_size);
+        tlb_set_page_full(cs, mmu_idx, addr & TARGET_PAGE_MASK, &full);
         return true;
     }
 
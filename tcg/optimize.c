@@ -3334,6 +3334,18 @@ void tcg_optimize(TCGContext *s)
             done = fold_xor(&ctx, op);
             break;
         case INDEX_op_set_label:
+            /*
+             * Once every branch to a label has been folded away, the
+             * label is only reached by falling through into it, so
+             * what is known about the temps still holds after it.
+             */
+            if (QSIMPLEQ_EMPTY(&arg_label(op->args[0])->branches)) {
+                done = true;
+                break;
+            }
+            finish_ebb(&ctx);
+            done = true;
+            break;
         case INDEX_op_br:
         case INDEX_op_exit_tb:
         case INDEX_op_goto_tb:
@@ -99,13 +99,15 @@ static const char *pretty_symbol(const struct debuginfo_query *q, size_t *len)
     return buf;
 }
 
-static void write_perfmap_entry(const void *start, size_t insn,
+/* Write one perfmap entry covering guest instructions #INSN to #LAST. */
+static void write_perfmap_entry(const void *start, size_t insn, size_t last,
                                 const struct debuginfo_query *q)
 {
     uint16_t host_size;
     uintptr_t host_pc;
 
-    get_host_pc_size(&host_pc, &host_size, start, insn);
+    get_host_pc_size(&host_pc, NULL, start, insn);
+    host_size = (uintptr_t)start + tcg_ctx->gen_insn_end_off[last] - host_pc;
     fprintf(perfmap, "%"PRIxPTR" %"PRIx16" %s\n",
             host_pc, host_size, pretty_symbol(q, NULL));
 }
@@ -313,7 +315,7 @@ void perf_report_code(uint64_t guest_pc, TranslationBlock *tb,
                       const void *start)
 {
     struct debuginfo_query *q;
-    size_t insn;
+    size_t insn, last;
     uint64_t *gen_insn_data;
 
     if (!perfmap && !jitdump) {
@@ -343,8 +345,20 @@ void perf_report_code(uint64_t guest_pc, TranslationBlock *tb,
     /* Emit perfmap entries if needed. */
     if (perfmap) {
         flockfile(perfmap);
-        for (insn = 0; insn < tb->icount; insn++) {
-            write_perfmap_entry(start, insn, &q[insn]);
+        for (insn = 0; insn < tb->icount; insn = last + 1) {
+            /*
+             * Merge runs of instructions within the same guest symbol,
+             * so that perf attributes them to one function and the map
+             * does not grow by a line per guest instruction.
+             */
+            last = insn;
+            if (q[insn].symbol) {
+                while (last + 1 < tb->icount &&
+                       g_strcmp0(q[last + 1].symbol, q[insn].symbol) == 0) {
+                    last++;
+                }
+            }
+            write_perfmap_entry(start, insn, last, &q[insn]);
         }
         funlockfile(perfmap);
     }
@@ -140,6 +140,13 @@ static void tci_args_rrbb(uint32_t insn, TCGReg *r0, TCGReg *r1,
     *i3 = extract32(insn, 22, 6);
 }
 
+static void tci_args_rrc(uint32_t insn, TCGReg *r0, TCGReg *r1, TCGCond *c2)
+{
+    *r0 = extract32(insn, 8, 4);
+    *r1 = extract32(insn, 12, 4);
+    *c2 = extract32(insn, 16, 4);
+}
+
 static void tci_args_rrrc(uint32_t insn,
                           TCGReg *r0, TCGReg *r1, TCGReg *r2, TCGCond *c3)
 {
@@ -430,6 +437,13 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare64(regs[r1], regs[r2], condition);
             break;
+        case INDEX_op_tci_brcond:
+            tci_args_rrc(insn, &r0, &r1, &condition);
+            ofs = *tb_ptr++;
+            if (tci_compare64(regs[r0], regs[r1], condition)) {
+                tb_ptr = (const void *)tb_ptr + ofs;
+            }
+            break;
         case INDEX_op_movcond:
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare64(regs[r1], regs[r2], condition);
@@ -644,6 +658,13 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare32(regs[r1], regs[r2], condition);
             break;
+        case INDEX_op_tci_brcond32:
+            tci_args_rrc(insn, &r0, &r1, &condition);
+            ofs = *tb_ptr++;
+            if (tci_compare32(regs[r0], regs[r1], condition)) {
+                tb_ptr = (const void *)tb_ptr + ofs;
+            }
+            break;
         case INDEX_op_tci_movcond32:
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare32(regs[r1], regs[r2], condition);
@@ -920,6 +941,15 @@ int print_insn_tci(bfd_vma addr, disassemble_info *info)
                            op_name, str_r(r0), ptr);
         break;
 
+    case INDEX_op_tci_brcond:
+    case INDEX_op_tci_brcond32:
+        tci_args_rrc(insn, &r0, &r1, &c);
+        s2 = *tb_ptr++;
+        ptr = (void *)tb_ptr + s2;
+        info->fprintf_func(info->stream, "%-12s  %s, %s, %s, %p",
+                           op_name, str_r(r0), str_r(r1), str_c(c), ptr);
+        return sizeof(insn) * 2;
+
     case INDEX_op_setcond:
     case INDEX_op_tci_setcond32:
         tci_args_rrrc(insn, &r0, &r1, &r2, &c);
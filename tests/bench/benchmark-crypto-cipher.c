@@ -12,8 +12,11 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/units.h"
+#include "qemu/bswap.h"
 #include "crypto/init.h"
 #include "crypto/cipher.h"
+#include "crypto/aes.h"
+#include "crypto/aes-round.h"
 
 static void test_cipher_speed(size_t chunk_size,
                               QCryptoCipherMode mode,
@@ -99,6 +102,165 @@ static void test_cipher_speed(size_t chunk_size,
     g_free(key);
 }
 
+/*
+ * Sector-by-sector processing of @chunk_size bytes as done for disk
+ * encryption, once with a qcrypto_cipher_setiv() + qcrypto_cipher_encrypt()
+ * pair per sector and once with qcrypto_cipher_encrypt_sectors().
+ */
+static void test_cipher_sectors_speed(size_t chunk_size,
+                                      QCryptoCipherMode mode,
+                                      QCryptoCipherAlgo alg)
+{
+    QCryptoCipher *cipher;
+    Error *err = NULL;
+    uint8_t *key = NULL, *ivs = NULL;
+    uint8_t *buf = NULL;
+    size_t nkey;
+    size_t niv;
+    const size_t sector_size = 512;
+    const size_t nsectors = chunk_size / sector_size;
+    const size_t total = 2 * GiB;
+    size_t remain;
+
+    if (!qcrypto_cipher_supports(alg, mode)) {
+        return;
+    }
+
+    nkey = qcrypto_cipher_get_key_len(alg);
+    niv = qcrypto_cipher_get_iv_len(alg, mode);
+    if (mode == QCRYPTO_CIPHER_MODE_XTS) {
+        nkey *= 2;
+    }
+
+    key = g_new0(uint8_t, nkey);
+    memset(key, g_test_rand_int(), nkey);
+
+    /* plain64 style IVs: the little endian sector number */
+    ivs = g_new0(uint8_t, niv * nsectors);
+    for (size_t i = 0; i < nsectors; i++) {
+        stq_le_p(ivs + i * niv, i);
+    }
+
+    buf = g_new0(uint8_t, chunk_size);
+    memset(buf, g_test_rand_int(), chunk_size);
+
+    cipher = qcrypto_cipher_new(alg, mode,
+                                key, nkey, &err);
+    g_assert(cipher != NULL);
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        for (size_t i = 0; i < nsectors; i++) {
+            g_assert(qcrypto_cipher_setiv(cipher,
+                                          ivs + i * niv, niv,
+                                          &err) == 0);
+            g_assert(qcrypto_cipher_encrypt(cipher,
+                                            buf + i * sector_size,
+                                            buf + i * sector_size,
+                                            sector_size,
+                                            &err) == 0);
+        }
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("enc(%s-%s) sectors-loop chunk %zu bytes %.2f MB/sec ",
+                   QCryptoCipherAlgo_str(alg),
+                   QCryptoCipherMode_str(mode),
+                   chunk_size, (double)total / MiB / g_test_timer_last());
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        g_assert(qcrypto_cipher_encrypt_sectors(cipher,
+                                                ivs, niv, sector_size,
+                                                buf, chunk_size,
+                                                &err) == 0);
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("enc(%s-%s) sectors-batch chunk %zu bytes %.2f MB/sec ",
+                   QCryptoCipherAlgo_str(alg),
+                   QCryptoCipherMode_str(mode),
+                   chunk_size, (double)total / MiB / g_test_timer_last());
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        g_assert(qcrypto_cipher_decrypt_sectors(cipher,
+                                                ivs, niv, sector_size,
+                                                buf, chunk_size,
+                                                &err) == 0);
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("dec(%s-%s) sectors-batch chunk %zu bytes %.2f MB/sec ",
+                   QCryptoCipherAlgo_str(alg),
+                   QCryptoCipherMode_str(mode),
+                   chunk_size, (double)total / MiB / g_test_timer_last());
+
+    qcrypto_cipher_free(cipher);
+    g_free(buf);
+    g_free(ivs);
+    g_free(key);
+}
+
+/*
+ * Single block speed of the built-in AES implementation, which is used
+ * when no crypto library provides the cipher, to compare against the
+ * library backed numbers above.
+ */
+static void test_builtin_aes_speed(const void *opaque)
+{
+    int bits = GPOINTER_TO_INT(opaque);
+    const size_t chunk_size = 4096;
+    const size_t total = 512 * MiB;
+    AES_KEY enc, dec;
+    uint8_t key[32];
+    uint8_t *buf;
+    size_t remain;
+
+    memset(key, g_test_rand_int(), sizeof(key));
+    g_assert(AES_set_encrypt_key(key, bits, &enc) == 0);
+    g_assert(AES_set_decrypt_key(key, bits, &dec) == 0);
+
+    buf = g_new0(uint8_t, chunk_size);
+    memset(buf, g_test_rand_int(), chunk_size);
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        for (size_t i = 0; i < chunk_size; i += AES_BLOCK_SIZE) {
+            AES_encrypt(buf + i, buf + i, &enc);
+        }
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("enc(builtin-aes-%d, %s) %.2f MB/sec ", bits,
+                   HAVE_AES_ACCEL ? "accel" : "generic",
+                   (double)total / MiB / g_test_timer_last());
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        for (size_t i = 0; i < chunk_size; i += AES_BLOCK_SIZE) {
+            AES_decrypt(buf + i, buf + i, &dec);
+        }
+        remain -= chunk_size;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("dec(builtin-aes-%d, %s) %.2f MB/sec ", bits,
+                   HAVE_AES_ACCEL ? "accel" : "generic",
+                   (double)total / MiB / g_test_timer_last());
+
+    g_free(buf);
+}
+
 
 static void test_cipher_speed_ecb_aes_128(const void *opaque)
 {
@@ -164,6 +326,22 @@ static void test_cipher_speed_xts_aes_256(const void *opaque)
                       QCRYPTO_CIPHER_ALGO_AES_256);
 }
 
+static void test_cipher_sectors_speed_xts_aes_128(const void *opaque)
+{
+    size_t chunk_size = (size_t)opaque;
+    test_cipher_sectors_speed(chunk_size,
+                              QCRYPTO_CIPHER_MODE_XTS,
+                              QCRYPTO_CIPHER_ALGO_AES_128);
+}
+
+static void test_cipher_sectors_speed_xts_aes_256(const void *opaque)
+{
+    size_t chunk_size = (size_t)opaque;
+    test_cipher_sectors_speed(chunk_size,
+                              QCRYPTO_CIPHER_MODE_XTS,
+                              QCRYPTO_CIPHER_ALGO_AES_256);
+}
+
 
 int main(int argc, char **argv)
 {
@@ -204,5 +382,25 @@ int main(int argc, char **argv)
     ADD_TESTS(16384);
     ADD_TESTS(65536);
 
+#define ADD_SECTORS_TEST(mode, cipher, keysize, chunk)                  \
+    if ((!alg || g_str_equal(alg, #mode)) &&                            \
+        (!size || g_str_equal(size, #chunk)))                           \
+        g_test_add_data_func(                                           \
+        "/crypto/cipher/" #mode "-" #cipher "-" #keysize "/sectors-" #chunk, \
+        (void *)chunk,                                                  \
+        test_cipher_sectors_speed_ ## mode ## _ ## cipher ## _ ## keysize)
+
+    ADD_SECTORS_TEST(xts, aes, 128, 65536);
+    ADD_SECTORS_TEST(xts, aes, 256, 65536);
+    ADD_SECTORS_TEST(xts, aes, 128, 1048576);
+    ADD_SECTORS_TEST(xts, aes, 256, 1048576);
+
+    if (!alg || g_str_equal(alg, "builtin")) {
+        g_test_add_data_func("/crypto/cipher/builtin-aes-128",
+                             GINT_TO_POINTER(128), test_builtin_aes_speed);
+        g_test_add_data_func("/crypto/cipher/builtin-aes-256",
+                             GINT_TO_POINTER(256), test_builtin_aes_speed);
+    }
+
     return g_test_run();
 }
@@ -11,7 +11,7 @@
 
 static void test(const void *opaque)
 {
-    size_t max = 64 * KiB;
+    size_t max = 4 * MiB;
     void *buf = g_malloc0(max);
     int accel_index = 0;
 
@@ -28,8 +28,8 @@ static void test(const void *opaque)
                 total += len;
             } while (g_test_timer_elapsed() < 0.5);
 
-            total /= MiB;
-            g_test_message("buffer_is_zero #%d: %2zuKB %8.0f MB/sec",
+            total /= GiB;
+            g_test_message("buffer_is_zero #%d: %4zuKB %8.2f GB/sec",
                            accel_index, len / (size_t)KiB,
                            total / g_test_timer_last());
         }
@@ -39,9 +39,63 @@ static void test(const void *opaque)
     g_free(buf);
 }
 
+#define BATCH_PAGE_SIZE   (4 * KiB)
+#define BATCH_PAGES       64
+#define BATCH_AREA_PAGES  (16 * KiB)
+
+/*
+ * Check pages picked from a 64 MiB area in batches, the way multifd zero
+ * page detection does, either one page at a time or with
+ * buffer_is_zero_batch().  Every @opaque-th page is not zero.
+ */
+static void test_batch(const void *opaque)
+{
+    unsigned nonzero_every = GPOINTER_TO_UINT(opaque);
+    char *area = g_malloc0((size_t)BATCH_AREA_PAGES * BATCH_PAGE_SIZE);
+    const void *bufs[BATCH_PAGES];
+    unsigned long next = 0;
+
+    for (unsigned i = 0; i < BATCH_AREA_PAGES; i += nonzero_every) {
+        area[(size_t)i * BATCH_PAGE_SIZE + BATCH_PAGE_SIZE - 1] = 1;
+    }
+
+    for (int batch = 0; batch < 2; batch++) {
+        double total = 0.0;
+
+        g_test_timer_start();
+        do {
+            for (unsigned i = 0; i < BATCH_PAGES; i++) {
+                /* Stride through the area so that pages are not cached */
+                next = (next + 4099) % BATCH_AREA_PAGES;
+                bufs[i] = area + next * BATCH_PAGE_SIZE;
+            }
+            if (batch) {
+                buffer_is_zero_batch(bufs, BATCH_PAGES, BATCH_PAGE_SIZE);
+            } else {
+                for (unsigned i = 0; i < BATCH_PAGES; i++) {
+                    buffer_is_zero(bufs[i], BATCH_PAGE_SIZE);
+                }
+            }
+            total += BATCH_PAGES;
+        } while (g_test_timer_elapsed() < 0.5);
+
+        g_test_message("%s: 1/%u non-zero %10.0f pages/sec",
+                       batch ? "buffer_is_zero_batch" : "buffer_is_zero",
+                       nonzero_every, total / g_test_timer_last());
+    }
+
+    g_free(area);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
     g_test_add_data_func("/cutils/bufferiszero/speed", NULL, test);
+    g_test_add_data_func("/cutils/bufferiszero/batch/zero",
+                         GUINT_TO_POINTER(BATCH_AREA_PAGES), test_batch);
+    g_test_add_data_func("/cutils/bufferiszero/batch/mixed",
+                         GUINT_TO_POINTER(2), test_batch);
+    g_test_add_data_func("/cutils/bufferiszero/batch/nonzero",
+                         GUINT_TO_POINTER(1), test_batch);
     return g_test_run();
 }
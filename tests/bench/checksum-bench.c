@@ -0,0 +1,81 @@
+/*
+ * QEMU net_checksum_add speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "net/checksum.h"
+
+/* Straightforward byte-wise implementation to check the results against */
+static uint32_t ref_checksum_add_cont(int len, uint8_t *buf, int seq)
+{
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        sum += (i + seq) & 1 ? buf[i] : buf[i] << 8;
+    }
+    return sum;
+}
+
+static void test_correctness(void)
+{
+    uint8_t *buf = g_malloc(4 * KiB + 1);
+
+    for (int i = 0; i < 4 * KiB + 1; i++) {
+        buf[i] = g_test_rand_int();
+    }
+
+    for (int off = 0; off < 4; off++) {
+        for (int len = 0; len <= 4 * KiB - off; len += len < 64 ? 1 : 61) {
+            for (int seq = 0; seq < 2; seq++) {
+                g_assert_cmphex(
+                    net_checksum_finish(
+                        net_checksum_add_cont(len, buf + off, seq)), ==,
+                    net_checksum_finish(
+                        ref_checksum_add_cont(len, buf + off, seq)));
+            }
+        }
+    }
+
+    g_free(buf);
+}
+
+static void test_speed(void)
+{
+    size_t max = 64 * KiB;
+    uint8_t *buf = g_malloc(max);
+
+    for (size_t i = 0; i < max; i++) {
+        buf[i] = i * 7;
+    }
+
+    for (size_t len = 64; len <= max; len *= 4) {
+        double total = 0.0;
+        uint32_t sum = 0;
+
+        g_test_timer_start();
+        do {
+            sum += net_checksum_add(len, buf);
+            total += len;
+        } while (g_test_timer_elapsed() < 0.5);
+
+        total /= MiB;
+        g_test_message("net_checksum_add: %6zu bytes %8.0f MB/sec (%04x)",
+                       len, total / g_test_timer_last(),
+                       net_checksum_finish(sum));
+    }
+
+    g_free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/net/checksum/correctness", test_correctness);
+    g_test_add_func("/net/checksum/speed", test_speed);
+    return g_test_run();
+}
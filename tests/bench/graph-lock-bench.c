@@ -0,0 +1,95 @@
+/*
+ * Block graph reader lock speed benchmark
+ *
+ * Measures the cost of a bdrv_graph_co_rdlock()/bdrv_graph_co_rdunlock() pair
+ * when an increasing number of threads, each with its own AioContext, take
+ * the reader lock concurrently.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/coroutine.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "block/aio.h"
+#include "block/graph-lock.h"
+
+#define MAX_THREADS 16
+#define ITERATIONS (10 * 1000 * 1000)
+
+typedef struct {
+    QemuThread thread;
+    int64_t ns;
+} BenchThread;
+
+static QemuEvent start_event;
+static unsigned int nready;
+
+static void coroutine_fn rdlock_loop_co(void *opaque)
+{
+    for (unsigned long i = 0; i < ITERATIONS; i++) {
+        bdrv_graph_co_rdlock();
+        bdrv_graph_co_rdunlock();
+    }
+}
+
+static void *bench_thread(void *opaque)
+{
+    BenchThread *t = opaque;
+    AioContext *ctx = aio_context_new(&error_abort);
+    Coroutine *co;
+    int64_t start;
+
+    qemu_set_current_aio_context(ctx);
+    co = qemu_coroutine_create(rdlock_loop_co, NULL);
+
+    qatomic_inc(&nready);
+    qemu_event_wait(&start_event);
+
+    start = get_clock();
+    qemu_coroutine_enter(co);
+    t->ns = get_clock() - start;
+
+    aio_context_unref(ctx);
+    return NULL;
+}
+
+static void test(const void *opaque)
+{
+    for (int n = 1; n <= MAX_THREADS; n *= 2) {
+        BenchThread threads[MAX_THREADS];
+        int64_t total_ns = 0;
+
+        qemu_event_init(&start_event, false);
+        qatomic_set(&nready, 0);
+
+        for (int i = 0; i < n; i++) {
+            qemu_thread_create(&threads[i].thread, "graph-lock-bench",
+                               bench_thread, &threads[i],
+                               QEMU_THREAD_JOINABLE);
+        }
+        while (qatomic_read(&nready) < n) {
+            g_usleep(1000);
+        }
+        qemu_event_set(&start_event);
+
+        for (int i = 0; i < n; i++) {
+            qemu_thread_join(&threads[i].thread);
+            total_ns += threads[i].ns;
+        }
+        qemu_event_destroy(&start_event);
+
+        g_test_message("rdlock/rdunlock: %2d threads %8.2f ns/op",
+                       n, (double)total_ns / n / ITERATIONS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_data_func("/block/graph-lock/rdlock/speed", NULL, test);
+    return g_test_run();
+}
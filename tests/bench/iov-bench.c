@@ -0,0 +1,120 @@
+/*
+ * QEMU I/O vector speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/iov.h"
+
+#define NIOV 4
+#define ELEM_SIZE 4096
+
+static char data[NIOV][ELEM_SIZE];
+static char header[64];
+
+/* A few page-sized data buffers, as for a typical guest request */
+static void build(QEMUIOVector *qiov)
+{
+    for (int i = 0; i < NIOV; i++) {
+        qemu_iovec_add(qiov, data[i], ELEM_SIZE);
+    }
+}
+
+static void test_build_heap(void)
+{
+    double total = 0.0;
+
+    g_test_timer_start();
+    do {
+        for (int n = 0; n < 1000; n++) {
+            QEMUIOVector qiov;
+
+            qemu_iovec_init(&qiov, 1);
+            build(&qiov);
+            qemu_iovec_destroy(&qiov);
+        }
+        total += 1000;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("heap vector, %d entries: %8.1f ns", NIOV,
+                   g_test_timer_last() * 1e9 / total);
+}
+
+static void test_build_inline(void)
+{
+    double total = 0.0;
+
+    g_test_timer_start();
+    do {
+        for (int n = 0; n < 1000; n++) {
+            QEMUIOVectorInline qiov;
+
+            qemu_iovec_init_inline(&qiov);
+            build(&qiov.qiov);
+            qemu_iovec_destroy(&qiov.qiov);
+        }
+        total += 1000;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("inline vector, %d entries: %8.1f ns", NIOV,
+                   g_test_timer_last() * 1e9 / total);
+}
+
+static void test_slice(void)
+{
+    QEMUIOVectorInline qiov;
+    double total = 0.0;
+
+    qemu_iovec_init_inline(&qiov);
+    build(&qiov.qiov);
+    g_test_timer_start();
+    do {
+        for (int n = 0; n < 1000; n++) {
+            QEMUIOVectorInline slice;
+
+            qemu_iovec_init_slice_inline(&slice, &qiov.qiov, 512,
+                                         qiov.qiov.size - 1024);
+            qemu_iovec_destroy(&slice.qiov);
+        }
+        total += 1000;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("inline slice, %d entries: %8.1f ns", NIOV,
+                   g_test_timer_last() * 1e9 / total);
+    qemu_iovec_destroy(&qiov.qiov);
+}
+
+static void test_to_buf(const void *opaque)
+{
+    size_t bytes = GPOINTER_TO_SIZE(opaque);
+    QEMUIOVectorInline qiov;
+    double total = 0.0;
+
+    qemu_iovec_init_inline(&qiov);
+    build(&qiov.qiov);
+    g_test_timer_start();
+    do {
+        for (int n = 0; n < 1000; n++) {
+            /* The length is not a compile-time constant */
+            qemu_iovec_to_buf(&qiov.qiov, n & 15, header, bytes);
+        }
+        total += 1000;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("to_buf, %zu bytes from first entry: %8.1f ns", bytes,
+                   g_test_timer_last() * 1e9 / total);
+    qemu_iovec_destroy(&qiov.qiov);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/iov/build/heap", test_build_heap);
+    g_test_add_func("/iov/build/inline", test_build_inline);
+    g_test_add_func("/iov/slice/inline", test_slice);
+    g_test_add_data_func("/iov/to-buf/16", GSIZE_TO_POINTER(16), test_to_buf);
+    g_test_add_data_func("/iov/to-buf/48", GSIZE_TO_POINTER(48), test_to_buf);
+    return g_test_run();
+}
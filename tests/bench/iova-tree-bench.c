@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * IOVA tree allocation benchmark: fill the tree with many small
+ * mappings, then repeatedly free and reallocate random ones.
+ */
+#include "qemu/osdep.h"
+#include "qemu/iova-tree.h"
+#include "qemu/timer.h"
+
+#define PAGE 0x1000
+
+static unsigned int n_maps = 100000;
+static unsigned int n_ops = 100000;
+
+static void usage(const char *progname)
+{
+    printf("Usage: %s [-n mappings] [-o operations]\n", progname);
+}
+
+static void parse_args(int argc, char *argv[])
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "hn:o:")) != -1) {
+        switch (c) {
+        case 'n':
+            n_maps = atoi(optarg);
+            break;
+        case 'o':
+            n_ops = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv[0]);
+            exit(0);
+        default:
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    IOVATree *tree = iova_tree_new();
+    g_autofree hwaddr *iovas = NULL;
+    int64_t t0, t1, t2;
+    unsigned int i;
+
+    parse_args(argc, argv);
+    if (!n_maps) {
+        return 0;
+    }
+    iovas = g_new(hwaddr, n_maps);
+
+    t0 = get_clock();
+    for (i = 0; i < n_maps; i++) {
+        DMAMap map = { .size = PAGE - 1, .perm = IOMMU_RW };
+
+        if (iova_tree_alloc_map(tree, &map, 0, HWADDR_MAX) != IOVA_OK) {
+            fprintf(stderr, "allocation %u failed\n", i);
+            return 1;
+        }
+        iovas[i] = map.iova;
+    }
+    t1 = get_clock();
+
+    for (i = 0; i < n_ops; i++) {
+        unsigned int n = g_random_int_range(0, n_maps);
+        DMAMap map = { .iova = iovas[n], .size = PAGE - 1 };
+
+        iova_tree_remove(tree, map);
+        map.perm = IOMMU_RW;
+        if (iova_tree_alloc_map(tree, &map, 0, HWADDR_MAX) != IOVA_OK) {
+            fprintf(stderr, "reallocation %u failed\n", i);
+            return 1;
+        }
+        iovas[n] = map.iova;
+    }
+    t2 = get_clock();
+
+    printf("fill:    %u mappings in %.3f ms (%.1f ns/alloc)\n",
+           n_maps, (t1 - t0) / 1e6, (double)(t1 - t0) / n_maps);
+    printf("churn:   %u free+alloc in %.3f ms (%.1f ns/op)\n",
+           n_ops, (t2 - t1) / 1e6, n_ops ? (double)(t2 - t1) / n_ops : 0.0);
+
+    iova_tree_destroy(tree);
+    return 0;
+}
@@ -11,6 +11,11 @@
 #include "qemu/rcu.h"
 #include "qemu/xxhash.h"
 #include "qemu/memalign.h"
+#include "qemu/timer.h"
+#include "qemu/host-utils.h"
+
+/* update latencies are kept in power-of-two buckets, in nanoseconds */
+#define LAT_BUCKETS 64
 
 struct thread_stats {
     size_t rd;
@@ -21,6 +26,7 @@ struct thread_stats {
     size_t not_rm;
     size_t rz;
     size_t not_rz;
+    size_t lat[LAT_BUCKETS];
 };
 
 struct thread_info {
@@ -61,6 +67,7 @@ static double resize_rate; /* 0.0 to 1.0 */
 static unsigned int n_rz_threads = 1;
 static QemuThread *rz_threads;
 static bool precompute_hash;
+static bool measure_latency;
 
 static double update_rate; /* 0.0 to 1.0 */
 static uint64_t update_threshold;
@@ -93,7 +100,8 @@ static const char commands_string[] =
     " -R = enable auto-resize\n"
     " -S = resize rate (0.0 to 100.0)\n"
     " -D = delay (in us) between potential resizes\n"
-    " -N = number of resize threads";
+    " -N = number of resize threads\n"
+    " -L = measure the latency of updates, e.g. while resizing";
 
 static void usage_complete(int argc, char *argv[])
 {
@@ -175,6 +183,8 @@ static void do_rw(struct thread_info *info)
             stats->not_rd++;
         }
     } else {
+        int64_t start = measure_latency ? get_clock() : 0;
+
         p = &keys[r & (update_range - 1)];
         hash = hfunc(*p);
         if (info->write_op) {
@@ -201,6 +211,12 @@ static void do_rw(struct thread_info *info)
             }
         }
         info->write_op = !info->write_op;
+
+        if (measure_latency) {
+            uint64_t ns = get_clock() - start;
+
+            stats->lat[ns ? 64 - clz64(ns) : 0]++;
+        }
     }
 }
 
@@ -384,7 +400,47 @@ static void add_stats(struct thread_stats *s, struct thread_info *info, int n)
 
         s->rz += stats->rz;
         s->not_rz += stats->not_rz;
+
+        for (int j = 0; j < LAT_BUCKETS; j++) {
+            s->lat[j] += stats->lat[j];
+        }
+    }
+}
+
+/* Upper bound, in ns, of the latency bucket that covers quantile @q */
+static uint64_t lat_quantile(const struct thread_stats *s, size_t n, double q)
+{
+    size_t target = n * q;
+    size_t sum = 0;
+    int i;
+
+    for (i = 0; i < LAT_BUCKETS - 1; i++) {
+        sum += s->lat[i];
+        if (sum > target) {
+            break;
+        }
+    }
+    return i ? 1ULL << i : 0;
+}
+
+static void pr_latency(const struct thread_stats *s)
+{
+    size_t n = 0;
+    int max = 0;
+
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        n += s->lat[i];
+        if (s->lat[i]) {
+            max = i;
+        }
     }
+    if (!n) {
+        return;
+    }
+    printf(" Update latency:    p50 <%" PRIu64 "ns p99 <%" PRIu64
+           "ns p99.9 <%" PRIu64 "ns max <%" PRIu64 "ns\n",
+           lat_quantile(s, n, 0.5), lat_quantile(s, n, 0.99),
+           lat_quantile(s, n, 0.999), max ? 1ULL << max : 0);
 }
 
 static void pr_stats(void)
@@ -418,6 +474,9 @@ static void pr_stats(void)
     tx = (s.rd + s.not_rd + s.in + s.not_in + s.rm + s.not_rm) / 1e6 / duration;
     printf(" Throughput:        %.2f MT/s\n", tx);
     printf(" Throughput/thread: %.2f MT/s/thread\n", tx / n_rw_threads);
+    if (measure_latency) {
+        pr_latency(&s);
+    }
 }
 
 static void run_test(void)
@@ -445,7 +504,7 @@ static void parse_args(int argc, char *argv[])
     int c;
 
     for (;;) {
-        c = getopt(argc, argv, "d:D:g:k:K:l:hn:N:o:pr:Rs:S:u:");
+        c = getopt(argc, argv, "d:D:g:k:K:l:Lhn:N:o:pr:Rs:S:u:");
         if (c < 0) {
             break;
         }
@@ -475,6 +534,9 @@ static void parse_args(int argc, char *argv[])
         case 'l':
             lookup_range = pow2ceil(atol(optarg));
             break;
+        case 'L':
+            measure_latency = true;
+            break;
         case 'n':
             n_rw_threads = atoi(optarg);
             break;
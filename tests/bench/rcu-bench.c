@@ -0,0 +1,91 @@
+/*
+ * QEMU RCU grace period latency benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
+
+#define MAX_READERS 8
+
+static QemuThread readers[MAX_READERS];
+static bool stop;
+
+static void *reader_thread(void *opaque)
+{
+    rcu_register_thread();
+    while (!qatomic_read(&stop)) {
+        rcu_read_lock();
+        rcu_read_unlock();
+    }
+    rcu_unregister_thread();
+    return NULL;
+}
+
+static void start_readers(int n)
+{
+    qatomic_set(&stop, false);
+    for (int i = 0; i < n; i++) {
+        qemu_thread_create(&readers[i], "reader", reader_thread, NULL,
+                           QEMU_THREAD_JOINABLE);
+    }
+}
+
+static void stop_readers(int n)
+{
+    qatomic_set(&stop, true);
+    for (int i = 0; i < n; i++) {
+        qemu_thread_join(&readers[i]);
+    }
+}
+
+static void test_synchronize_rcu(const void *opaque)
+{
+    int n = GPOINTER_TO_INT(opaque);
+    double total = 0.0;
+
+    start_readers(n);
+    g_test_timer_start();
+    do {
+        synchronize_rcu();
+        total++;
+    } while (g_test_timer_elapsed() < 0.5);
+    stop_readers(n);
+
+    g_test_message("synchronize_rcu, %d readers: %8.1f us", n,
+                   g_test_timer_last() * 1e6 / total);
+}
+
+static void test_drain_call_rcu(const void *opaque)
+{
+    int n = GPOINTER_TO_INT(opaque);
+    double total = 0.0;
+
+    start_readers(n);
+    g_test_timer_start();
+    do {
+        drain_call_rcu();
+        total++;
+    } while (g_test_timer_elapsed() < 0.5);
+    stop_readers(n);
+
+    g_test_message("drain_call_rcu, %d readers: %8.1f us", n,
+                   g_test_timer_last() * 1e6 / total);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    for (int n = 0; n <= MAX_READERS; n = n ? n * 2 : 1) {
+        g_autofree char *sync = g_strdup_printf("/rcu/synchronize/%d", n);
+        g_autofree char *drain = g_strdup_printf("/rcu/drain/%d", n);
+
+        g_test_add_data_func(sync, GINT_TO_POINTER(n), test_synchronize_rcu);
+        g_test_add_data_func(drain, GINT_TO_POINTER(n), test_drain_call_rcu);
+    }
+    return g_test_run();
+}
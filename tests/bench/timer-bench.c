@@ -0,0 +1,142 @@
+/*
+ * QEMU timer list speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/timer.h"
+
+#define TIMER_COUNT 10000
+
+static QEMUTimerListGroup tlg;
+static QEMUTimer timers[TIMER_COUNT];
+static int64_t offsets[TIMER_COUNT];
+static int fired[TIMER_COUNT];
+static unsigned nfired;
+
+static void notify_cb(void *opaque, QEMUClockType type)
+{
+}
+
+static void timer_cb(void *opaque)
+{
+    fired[nfired++] = (int)(intptr_t)opaque;
+}
+
+static void timers_init(void)
+{
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        timer_init_full(&timers[i], &tlg, QEMU_CLOCK_REALTIME, SCALE_NS, 0,
+                        timer_cb, (void *)(intptr_t)i);
+        offsets[i] = g_test_rand_int_range(0, INT32_MAX);
+    }
+}
+
+static void timers_deinit(void)
+{
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        timer_del(&timers[i]);
+        timer_deinit(&timers[i]);
+    }
+}
+
+/* Expired timers must fire by expiry time, and in arming order for ties */
+static void test_order(void)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+
+    timers_init();
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        /* Plenty of timers share an expiry time */
+        offsets[i] %= TIMER_COUNT / 8;
+        timer_mod_ns(&timers[i], now - offsets[i]);
+    }
+    /* Re-arming moves a timer behind the others with the same expiry time */
+    for (int i = 0; i < TIMER_COUNT; i += 3) {
+        timer_mod_ns(&timers[i], now - offsets[i]);
+    }
+    for (int i = 1; i < TIMER_COUNT; i += 3) {
+        timer_del(&timers[i]);
+    }
+
+    nfired = 0;
+    timerlist_run_timers(tlg.tl[QEMU_CLOCK_REALTIME]);
+    g_assert_cmpuint(nfired, ==, TIMER_COUNT - (TIMER_COUNT + 1) / 3);
+
+    for (unsigned i = 1; i < nfired; i++) {
+        int a = fired[i - 1], b = fired[i];
+
+        g_assert_cmpint(offsets[a], >=, offsets[b]);
+        if (offsets[a] != offsets[b]) {
+            continue;
+        }
+        if (a % 3 == b % 3) {
+            g_assert_cmpint(a, <, b);
+        } else {
+            /* Re-armed timers (i % 3 == 0) come after the others */
+            g_assert_cmpint(a % 3, ==, 2);
+            g_assert_cmpint(b % 3, ==, 0);
+        }
+    }
+    g_assert_false(timerlist_has_timers(tlg.tl[QEMU_CLOCK_REALTIME]));
+    timers_deinit();
+}
+
+static void test_mod_del(void)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    double total = 0.0;
+
+    timers_init();
+    g_test_timer_start();
+    do {
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            timer_mod_ns(&timers[i], now + NANOSECONDS_PER_SECOND * 3600 +
+                                     offsets[i]);
+        }
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            timer_del(&timers[i]);
+        }
+        total += TIMER_COUNT;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("%d timers: %10.0f timer_mod_ns+timer_del/sec",
+                   TIMER_COUNT, total / g_test_timer_last());
+    timers_deinit();
+}
+
+static void test_expire(void)
+{
+    double total = 0.0;
+
+    timers_init();
+    g_test_timer_start();
+    do {
+        int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            timer_mod_ns(&timers[i], MAX(now - offsets[i], 0));
+        }
+        nfired = 0;
+        timerlist_run_timers(tlg.tl[QEMU_CLOCK_REALTIME]);
+        g_assert_cmpuint(nfired, ==, TIMER_COUNT);
+        total += TIMER_COUNT;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("%d timers: %10.0f timer_mod_ns+expiry/sec",
+                   TIMER_COUNT, total / g_test_timer_last());
+    timers_deinit();
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    init_clocks(notify_cb);
+    timerlistgroup_init(&tlg, notify_cb, NULL);
+    g_test_add_func("/timer/order", test_order);
+    g_test_add_func("/timer/speed/mod-del", test_mod_del);
+    g_test_add_func("/timer/speed/expire", test_expire);
+    return g_test_run();
+}
@@ -0,0 +1,151 @@
+/*
+ * QEMU VMState save/load speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "migration/vmstate.h"
+#include "migration/qemu-file-types.h"
+#include "../migration/qemu-file.h"
+#include "io/channel-buffer.h"
+#include "io/channel-null.h"
+#include "qemu/module.h"
+
+#define NREGS 4096
+#define NQUEUES 1024
+
+/* Roughly shaped like a device with a large register file and ring state */
+typedef struct BenchDevice {
+    uint32_t ctrl;
+    uint32_t status;
+    uint64_t features;
+    uint32_t regs[NREGS];
+    uint64_t queue_desc[NQUEUES];
+    uint16_t queue_idx[NQUEUES];
+    uint8_t config[NREGS];
+    bool     enabled[64];
+} BenchDevice;
+
+static const VMStateDescription vmstate_bench_device = {
+    .name = "bench-device",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (const VMStateField[]) {
+        VMSTATE_UINT32(ctrl, BenchDevice),
+        VMSTATE_UINT32(status, BenchDevice),
+        VMSTATE_UINT64(features, BenchDevice),
+        VMSTATE_UINT32_ARRAY(regs, BenchDevice, NREGS),
+        VMSTATE_UINT64_ARRAY(queue_desc, BenchDevice, NQUEUES),
+        VMSTATE_UINT16_ARRAY(queue_idx, BenchDevice, NQUEUES),
+        VMSTATE_UINT8_ARRAY(config, BenchDevice, NREGS),
+        VMSTATE_BOOL_ARRAY(enabled, BenchDevice, 64),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static BenchDevice dev, dev_loaded;
+static uint8_t *wire;
+static size_t wire_len;
+
+static void bench_init(void)
+{
+    QIOChannelBuffer *bioc = qio_channel_buffer_new(sizeof(dev));
+    QEMUFile *f = qemu_file_new_output(QIO_CHANNEL(bioc));
+
+    dev.ctrl = 0x80000001;
+    dev.status = 0xf;
+    dev.features = 0x1234567890abcdefULL;
+    for (int i = 0; i < NREGS; i++) {
+        dev.regs[i] = g_test_rand_int();
+        dev.config[i] = i;
+    }
+    for (int i = 0; i < NQUEUES; i++) {
+        dev.queue_desc[i] = ((uint64_t)g_test_rand_int() << 32) | i;
+        dev.queue_idx[i] = i * 3;
+    }
+    for (int i = 0; i < ARRAY_SIZE(dev.enabled); i++) {
+        dev.enabled[i] = i & 1;
+    }
+
+    g_assert_cmpint(vmstate_save_state(f, &vmstate_bench_device, &dev,
+                                       NULL), ==, 0);
+    g_assert_cmpint(qemu_fflush(f), ==, 0);
+
+    /* Steal the buffer before the channel is closed */
+    wire = bioc->data;
+    wire_len = bioc->usage;
+    bioc->data = NULL;
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+}
+
+static int load_once(void)
+{
+    QIOChannelBuffer *bioc = qio_channel_buffer_new(0);
+    QEMUFile *f;
+    int ret;
+
+    bioc->data = wire;
+    bioc->capacity = bioc->usage = wire_len;
+    f = qemu_file_new_input(QIO_CHANNEL(bioc));
+    ret = vmstate_load_state(f, &vmstate_bench_device, &dev_loaded, 1);
+
+    /* The wire buffer is shared by all iterations */
+    bioc->data = NULL;
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+    return ret;
+}
+
+static void test_load_check(void)
+{
+    memset(&dev_loaded, 0, sizeof(dev_loaded));
+    g_assert_cmpint(load_once(), ==, 0);
+    g_assert(memcmp(&dev, &dev_loaded, sizeof(dev)) == 0);
+}
+
+static void test_save(void)
+{
+    QIOChannel *ioc = QIO_CHANNEL(qio_channel_null_new());
+    QEMUFile *f = qemu_file_new_output(ioc);
+    double total = 0.0;
+
+    g_test_timer_start();
+    do {
+        g_assert_cmpint(vmstate_save_state(f, &vmstate_bench_device, &dev,
+                                           NULL), ==, 0);
+        total++;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("save %zu bytes: %8.2f us/device", wire_len,
+                   g_test_timer_last() * 1e6 / total);
+    qemu_fclose(f);
+    object_unref(OBJECT(ioc));
+}
+
+static void test_load(void)
+{
+    double total = 0.0;
+
+    g_test_timer_start();
+    do {
+        g_assert_cmpint(load_once(), ==, 0);
+        total++;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("load %zu bytes: %8.2f us/device", wire_len,
+                   g_test_timer_last() * 1e6 / total);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    module_call_init(MODULE_INIT_QOM);
+    bench_init();
+    g_test_add_func("/vmstate/load/check", test_load_check);
+    g_test_add_func("/vmstate/speed/save", test_save);
+    g_test_add_func("/vmstate/speed/load", test_load);
+    return g_test_run();
+}
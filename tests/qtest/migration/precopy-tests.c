@@ -162,7 +162,18 @@ static int new_rdma_link(char *buffer, bool ipv6)
     return -1;
 }
 
-static void __test_precopy_rdma_plain(bool ipv6)
+/* For migrate_hook_start_precopy_rdma_multifd() */
+static const char *rdma_listen_uri;
+
+static void *
+migrate_hook_start_precopy_rdma_multifd(QTestState *from, QTestState *to)
+{
+    /* The multifd capability must be set before the listener starts */
+    migrate_incoming_qmp(to, rdma_listen_uri, NULL, "{}");
+    return NULL;
+}
+
+static void __test_precopy_rdma(bool ipv6, bool multifd)
 {
     char buffer[128] = {};
 
@@ -192,17 +203,31 @@ static void __test_precopy_rdma_plain(bool ipv6)
         .connect_uri = uri,
     };
 
+    if (multifd) {
+        rdma_listen_uri = uri;
+        args.listen_uri = "defer";
+        args.start_hook = migrate_hook_start_precopy_rdma_multifd;
+        args.start.caps[MIGRATION_CAPABILITY_MULTIFD] = true;
+        /* As with TCP, pages may change while multifd sends them */
+        args.live = true;
+    }
+
     test_precopy_common(&args);
 }
 
 static void test_precopy_rdma_plain(void)
 {
-    __test_precopy_rdma_plain(false);
+    __test_precopy_rdma(false, false);
 }
 
 static void test_precopy_rdma_plain_ipv6(void)
 {
-    __test_precopy_rdma_plain(true);
+    __test_precopy_rdma(true, false);
+}
+
+static void test_multifd_rdma_plain(void)
+{
+    __test_precopy_rdma(false, true);
 }
 #endif
 
@@ -1263,6 +1288,8 @@ static void migration_test_add_precopy_smoke(MigrationTestEnv *env)
                        test_precopy_rdma_plain);
     migration_test_add("/migration/precopy/rdma/plain/ipv6",
                        test_precopy_rdma_plain_ipv6);
+    migration_test_add("/migration/multifd/rdma/plain",
+                       test_multifd_rdma_plain);
 #endif
 }
 
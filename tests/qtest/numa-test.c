@@ -13,6 +13,7 @@
 #include "libqtest.h"
 #include "qobject/qdict.h"
 #include "qobject/qlist.h"
+#include "qobject/qnum.h"
 
 static char *make_cli(const GString *generic_cli, const char *test_cli)
 {
@@ -595,6 +596,68 @@ static void pc_hmat_erange_cfg(const void *data)
     qtest_quit(qs);
 }
 
+#ifdef CONFIG_NUMA
+static QDict *qom_set_policy(QTestState *qts, const char *policy)
+{
+    return qtest_qmp(qts, "{ 'execute': 'qom-set', 'arguments':"
+                     " { 'path': '/objects/ram', 'property': 'policy',"
+                     " 'value': %s } }", policy);
+}
+
+static void test_hostmem_rebind(const void *data)
+{
+    g_autofree char *cli = NULL;
+    QTestState *qts;
+    QDict *resp;
+    QList *nodes;
+
+    cli = make_cli(data, "-numa node,nodeid=0,memdev=ram");
+    qts = qtest_init(cli);
+
+    /* A policy other than default needs host nodes */
+    resp = qom_set_policy(qts, "bind");
+    g_assert(qdict_haskey(resp, "error"));
+    qobject_unref(resp);
+
+    /* With the default policy, host nodes are only recorded */
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-set', 'arguments':"
+                     " { 'path': '/objects/ram', 'property': 'host-nodes',"
+                     " 'value': [0] } }");
+    g_assert(qdict_haskey(resp, "return"));
+    qobject_unref(resp);
+
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-get', 'arguments':"
+                     " { 'path': '/objects/ram', 'property': 'host-nodes' } }");
+    nodes = qdict_get_qlist(resp, "return");
+    g_assert_cmpint(qlist_size(nodes), ==, 1);
+    g_assert_cmpint(qnum_get_int(qobject_to(QNum, qlist_peek(nodes))), ==, 0);
+    qobject_unref(resp);
+
+    resp = qom_set_policy(qts, "preferred");
+    if (qdict_haskey(resp, "error")) {
+        /* mbind() may not be permitted, e.g. in containers */
+        g_test_message("Skipping rebind: %s",
+                       qdict_get_str(qdict_get_qdict(resp, "error"), "desc"));
+        qobject_unref(resp);
+        qtest_quit(qts);
+        return;
+    }
+    qobject_unref(resp);
+
+    /* Going back to the default policy drops the node binding */
+    resp = qom_set_policy(qts, "default");
+    g_assert(qdict_haskey(resp, "return"));
+    qobject_unref(resp);
+
+    resp = qtest_qmp(qts, "{ 'execute': 'qom-get', 'arguments':"
+                     " { 'path': '/objects/ram', 'property': 'host-nodes' } }");
+    g_assert(qlist_empty(qdict_get_qlist(resp, "return")));
+    qobject_unref(resp);
+
+    qtest_quit(qts);
+}
+#endif
+
 int main(int argc, char **argv)
 {
     g_autoptr(GString) args = g_string_new(NULL);
@@ -619,6 +682,9 @@ int main(int argc, char **argv)
     qtest_add_data_func("/numa/mon/cpus/explicit", args, test_mon_explicit);
     qtest_add_data_func("/numa/mon/cpus/partial", args, test_mon_partial);
     qtest_add_data_func("/numa/qmp/cpus/query-cpus", args, test_query_cpus);
+#ifdef CONFIG_NUMA
+    qtest_add_data_func("/numa/qmp/hostmem/rebind", args, test_hostmem_rebind);
+#endif
 
     if (!strcmp(arch, "x86_64")) {
         qtest_add_data_func("/numa/pc/cpu/explicit", args, pc_numa_cpu);
@@ -771,6 +771,71 @@ static void resize(void *obj, void *data, QGuestAllocator *t_alloc)
 
 }
 
+/*
+ * Measure the cost of a 4 KiB read round trip, from the kick to the used
+ * ring update, against a null-co backend.  Only run with -m perf.
+ */
+static void read_perf(void *obj, void *data, QGuestAllocator *t_alloc)
+{
+    QVirtioBlk *blk_if = obj;
+    QVirtioDevice *dev = blk_if->vdev;
+    QTestState *qts = global_qtest;
+    QVirtioBlkReq req;
+    QVirtQueue *vq;
+    uint64_t req_addr;
+    uint64_t features;
+    uint32_t free_head;
+    double total = 0.0;
+    double elapsed;
+
+    features = qvirtio_get_features(dev);
+    features = features & ~(QVIRTIO_F_BAD_FEATURE |
+                    (1u << VIRTIO_RING_F_INDIRECT_DESC) |
+                    (1u << VIRTIO_RING_F_EVENT_IDX) |
+                    (1u << VIRTIO_BLK_F_SCSI));
+    qvirtio_set_features(dev, features);
+
+    vq = qvirtqueue_setup(dev, t_alloc, 0);
+
+    qvirtio_set_driver_ok(dev);
+
+    req.type = VIRTIO_BLK_T_IN;
+    req.ioprio = 1;
+    req.sector = 0;
+    req.data = g_malloc0(4096);
+
+    req_addr = virtio_blk_request(t_alloc, dev, &req, 4096);
+
+    g_free(req.data);
+
+    g_test_timer_start();
+    do {
+        /* The previous request has completed, reuse its descriptors */
+        vq->free_head = 0;
+        vq->num_free = vq->size;
+
+        free_head = qvirtqueue_add(qts, vq, req_addr, 16, false, true);
+        qvirtqueue_add(qts, vq, req_addr + 16, 4096, true, true);
+        qvirtqueue_add(qts, vq, req_addr + 16 + 4096, 1, true, false);
+
+        qvirtqueue_kick(qts, dev, vq, free_head);
+
+        qvirtio_wait_used_elem(qts, dev, vq, free_head, NULL,
+                               QVIRTIO_BLK_TIMEOUT_US);
+        total++;
+    } while (g_test_timer_elapsed() < 1.0);
+    elapsed = g_test_timer_last();
+
+    g_assert_cmpint(readb(req_addr + 16 + 4096), ==, 0);
+    g_test_maximized_result(total / elapsed, "%.0f reads/sec",
+                            total / elapsed);
+    g_test_minimized_result(elapsed * 1e6 / total, "%.1f us/read",
+                            elapsed * 1e6 / total);
+
+    guest_free(t_alloc, req_addr);
+    qvirtqueue_cleanup(dev->bus, vq, t_alloc);
+}
+
 static void *virtio_blk_test_setup(GString *cmd_line, void *arg)
 {
     char *tmp_path = drive_create();
@@ -785,6 +850,14 @@ static void *virtio_blk_test_setup(GString *cmd_line, void *arg)
     return arg;
 }
 
+static void *virtio_blk_perf_setup(GString *cmd_line, void *arg)
+{
+    g_string_append(cmd_line,
+                    " -drive if=none,id=drive0,file=null-co://,"
+                    "file.read-zeroes=on,format=raw ");
+    return arg;
+}
+
 static void register_virtio_blk_test(void)
 {
     QOSGraphTestOptions opts = {
@@ -802,6 +875,11 @@ static void register_virtio_blk_test(void)
     qos_add_test("nxvirtq", "virtio-blk-pci",
                       test_nonexistent_virtqueue, &opts);
     qos_add_test("hotplug", "virtio-blk-pci", pci_hotplug, &opts);
+
+    if (g_test_perf()) {
+        opts.before = virtio_blk_perf_setup;
+        qos_add_test("read-perf", "virtio-blk", read_perf, &opts);
+    }
 }
 
 libqos_init(register_virtio_blk_test);
@@ -0,0 +1,88 @@
+/*
+ * Check fully predicated contiguous SVE LD1/ST1, including accesses that
+ * are misaligned or cross a page boundary.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#define COPY(NAME, INSN, T)                                         \
+static void copy_##NAME(void *dst, const void *src)                 \
+{                                                                   \
+    asm volatile("ptrue p0." #T "\n\t"                              \
+                 "ld1" #INSN " {z0." #T "}, p0/z, [%1]\n\t"         \
+                 "st1" #INSN " {z0." #T "}, p0, [%0]"               \
+                 : : "r" (dst), "r" (src) : "z0", "p0", "memory");  \
+}
+
+COPY(b, b, b)
+COPY(h, h, h)
+COPY(w, w, s)
+COPY(d, d, d)
+
+static void (* const copy_fns[])(void *, const void *) = {
+    copy_b, copy_h, copy_w, copy_d,
+};
+
+static int test(unsigned char *src, unsigned char *dst, long page, int vl)
+{
+    const long offsets[] = {
+        0, 1, 2, 4, 8, page - vl / 2, page - vl / 2 + 1, page - 8,
+    };
+    int err = 0;
+
+    for (int f = 0; f < 4; f++) {
+        for (int o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            long off = offsets[o];
+
+            memset(dst, 0xaa, 2 * page);
+            copy_fns[f](dst + off, src + off);
+
+            for (long i = 0; i < 2 * page; i++) {
+                unsigned char expect =
+                    i >= off && i < off + vl ? src[i] : 0xaa;
+
+                if (dst[i] != expect) {
+                    fprintf(stderr, "vl %d, esz %d, offset %ld, byte %ld: "
+                            "expected %d, got %d\n",
+                            vl, 1 << f, off, i, expect, dst[i]);
+                    err = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    return err;
+}
+
+int main(void)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned char *src, *dst;
+    int err = 0;
+
+    src = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    dst = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (src == MAP_FAILED || dst == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    for (long i = 0; i < 2 * page; i++) {
+        src[i] = i * 7 + (i >> 8);
+    }
+
+    for (int vl = 16; vl <= 256; vl += 16) {
+        if (prctl(PR_SVE_SET_VL, vl, 0, 0, 0, 0) == vl) {
+            err |= test(src, dst, page, vl);
+        }
+    }
+    return err;
+}
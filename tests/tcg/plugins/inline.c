@@ -24,6 +24,8 @@ typedef struct {
     uint64_t tb_cond_track_count;
     uint64_t insn_cond_num_trigger;
     uint64_t insn_cond_track_count;
+    uint64_t mem_cond_num_trigger;
+    uint64_t mem_cond_track_count;
 } CPUCount;
 
 static const uint64_t cond_trigger_limit = 100;
@@ -45,6 +47,8 @@ static qemu_plugin_u64 tb_cond_num_trigger;
 static qemu_plugin_u64 tb_cond_track_count;
 static qemu_plugin_u64 insn_cond_num_trigger;
 static qemu_plugin_u64 insn_cond_track_count;
+static qemu_plugin_u64 mem_cond_num_trigger;
+static qemu_plugin_u64 mem_cond_track_count;
 static struct qemu_plugin_scoreboard *data;
 static qemu_plugin_u64 data_insn;
 static qemu_plugin_u64 data_tb;
@@ -111,14 +115,21 @@ static void stats_mem(void)
     const uint64_t per_vcpu = qemu_plugin_u64_sum(count_mem);
     const uint64_t inl_per_vcpu =
         qemu_plugin_u64_sum(count_mem_inline);
+    const uint64_t cond_num_trigger =
+        qemu_plugin_u64_sum(mem_cond_num_trigger);
+    const uint64_t cond_track_left = qemu_plugin_u64_sum(mem_cond_track_count);
+    const uint64_t conditional =
+        cond_num_trigger * cond_trigger_limit + cond_track_left;
     g_autoptr(GString) stats = g_string_new("");
     g_string_append_printf(stats, "mem: %" PRIu64 "\n", expected);
     g_string_append_printf(stats, "mem: %" PRIu64 " (per vcpu)\n", per_vcpu);
     g_string_append_printf(stats, "mem: %" PRIu64 " (per vcpu inline)\n", inl_per_vcpu);
+    g_string_append_printf(stats, "mem: %" PRIu64 " (cond cb)\n", conditional);
     qemu_plugin_outs(stats->str);
     g_assert(expected > 0);
     g_assert(per_vcpu == expected);
     g_assert(inl_per_vcpu == expected);
+    g_assert(conditional == expected);
 }
 
 static void plugin_exit(qemu_plugin_id_t id, void *udata)
@@ -142,20 +153,27 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
             qemu_plugin_u64_get(insn_cond_num_trigger, i);
         const uint64_t insn_cond_left =
             qemu_plugin_u64_get(insn_cond_track_count, i);
+        const uint64_t mem_cond_trigger =
+            qemu_plugin_u64_get(mem_cond_num_trigger, i);
+        const uint64_t mem_cond_left =
+            qemu_plugin_u64_get(mem_cond_track_count, i);
         g_string_printf(stats, "cpu %d: tb (%" PRIu64 ", %" PRIu64
                         ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
                         ") | "
                         "insn (%" PRIu64 ", %" PRIu64
                         ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
                         ") | "
-                        "mem (%" PRIu64 ", %" PRIu64 ")"
+                        "mem (%" PRIu64 ", %" PRIu64
+                        ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
+                        ")"
                         "\n",
                         i,
                         tb, tb_inline,
                         tb_cond_trigger, cond_trigger_limit, tb_cond_left,
                         insn, insn_inline,
                         insn_cond_trigger, cond_trigger_limit, insn_cond_left,
-                        mem, mem_inline);
+                        mem, mem_inline,
+                        mem_cond_trigger, cond_trigger_limit, mem_cond_left);
         qemu_plugin_outs(stats->str);
         g_assert(tb == tb_inline);
         g_assert(insn == insn_inline);
@@ -164,6 +182,8 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
         g_assert(tb_cond_left == tb % cond_trigger_limit);
         g_assert(insn_cond_trigger == insn / cond_trigger_limit);
         g_assert(insn_cond_left == insn % cond_trigger_limit);
+        g_assert(mem_cond_trigger == mem / cond_trigger_limit);
+        g_assert(mem_cond_left == mem % cond_trigger_limit);
     }
 
     stats_tb();
@@ -223,6 +243,18 @@ static void vcpu_mem_access(unsigned int cpu_index,
     g_mutex_unlock(&mem_lock);
 }
 
+static void vcpu_mem_cond_access(unsigned int cpu_index,
+                                 qemu_plugin_meminfo_t info,
+                                 uint64_t vaddr,
+                                 void *udata)
+{
+    g_assert(qemu_plugin_u64_get(mem_cond_track_count, cpu_index) ==
+             cond_trigger_limit);
+    g_assert(qemu_plugin_u64_get(data_mem, cpu_index) == (uintptr_t) udata);
+    qemu_plugin_u64_set(mem_cond_track_count, cpu_index, 0);
+    qemu_plugin_u64_add(mem_cond_num_trigger, cpu_index, 1);
+}
+
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     void *tb_store = tb;
@@ -270,6 +302,15 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
             insn, QEMU_PLUGIN_MEM_RW,
             QEMU_PLUGIN_INLINE_ADD_U64,
             count_mem_inline, 1);
+
+        qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+            insn, QEMU_PLUGIN_MEM_RW,
+            QEMU_PLUGIN_INLINE_ADD_U64,
+            mem_cond_track_count, 1);
+        qemu_plugin_register_vcpu_mem_cond_cb(
+            insn, &vcpu_mem_cond_access, QEMU_PLUGIN_CB_NO_REGS,
+            QEMU_PLUGIN_MEM_RW, QEMU_PLUGIN_COND_EQ,
+            mem_cond_track_count, cond_trigger_limit, mem_store);
     }
 }
 
@@ -298,6 +339,10 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         counts, CPUCount, insn_cond_num_trigger);
     insn_cond_track_count = qemu_plugin_scoreboard_u64_in_struct(
         counts, CPUCount, insn_cond_track_count);
+    mem_cond_num_trigger = qemu_plugin_scoreboard_u64_in_struct(
+        counts, CPUCount, mem_cond_num_trigger);
+    mem_cond_track_count = qemu_plugin_scoreboard_u64_in_struct(
+        counts, CPUCount, mem_cond_track_count);
     data = qemu_plugin_scoreboard_new(sizeof(CPUData));
     data_insn = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_insn);
     data_tb = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_tb);
@@ -27,19 +27,23 @@ static void ptimer_test_expire_qemu_timers(int64_t expire_time,
                                            QEMUClockType type)
 {
     QEMUTimerList *timer_list = main_loop_tlg.tl[type];
-    QEMUTimer *t = timer_list->active_timers.next;
+    GList *timers = g_list_copy(timer_list->active_timers);
+    GList *l;
 
-    while (t != NULL) {
-        if (t->expire_time == expire_time) {
+    /* Callbacks can modify the list, walk a copy */
+    for (l = timers; l; l = l->next) {
+        QEMUTimer *t = l->data;
+
+        if (g_list_find(timer_list->active_timers, t) &&
+            t->expire_time == expire_time) {
             timer_del(t);
 
             if (t->cb != NULL) {
                 t->cb(t->opaque);
             }
         }
-
-        t = t->next;
     }
+    g_list_free(timers);
 }
 
 static void ptimer_test_set_qemu_time_ns(int64_t ns)
@@ -424,6 +424,79 @@ static void test_timer_schedule(void)
     timer_del(&data.timer);
 }
 
+#ifndef _WIN32
+typedef struct {
+    int fds[2];
+    int n;
+} PipeTestData;
+
+/* Only consume one byte, handlers are not required to drain their fd */
+static void pipe_read_one_cb(void *opaque)
+{
+    PipeTestData *data = opaque;
+    char c;
+
+    g_assert_cmpint(read(data->fds[0], &c, 1), ==, 1);
+    data->n++;
+}
+
+static void pipe_test_init(PipeTestData *data, int pending)
+{
+    data->n = 0;
+    g_assert(g_unix_open_pipe(data->fds, FD_CLOEXEC, NULL));
+    g_assert(g_unix_set_fd_nonblocking(data->fds[0], true, NULL));
+    for (int i = 0; i < pending; i++) {
+        g_assert_cmpint(write(data->fds[1], "x", 1), ==, 1);
+    }
+}
+
+static void pipe_test_cleanup(PipeTestData *data)
+{
+    aio_set_fd_handler(ctx, data->fds[0], NULL, NULL, NULL, NULL, NULL);
+    g_assert(!aio_poll(ctx, false));
+    close(data->fds[0]);
+    close(data->fds[1]);
+}
+
+static void test_fd_handler_no_drain(void)
+{
+    PipeTestData data;
+
+    pipe_test_init(&data, 0);
+    aio_set_fd_handler(ctx, data.fds[0], pipe_read_one_cb, NULL, NULL, NULL,
+                       &data);
+    g_assert(!aio_poll(ctx, false));
+
+    /* Data left in the fd must keep the handler running */
+    g_assert_cmpint(write(data.fds[1], "xyz", 3), ==, 3);
+    for (int i = 1; i <= 3; i++) {
+        g_assert(aio_poll(ctx, true));
+        g_assert_cmpint(data.n, ==, i);
+    }
+    g_assert(!aio_poll(ctx, false));
+    g_assert_cmpint(data.n, ==, 3);
+
+    pipe_test_cleanup(&data);
+}
+
+static void test_fd_handler_already_ready(void)
+{
+    PipeTestData data;
+
+    /* The fd is readable before the handler is added */
+    pipe_test_init(&data, 2);
+    aio_set_fd_handler(ctx, data.fds[0], pipe_read_one_cb, NULL, NULL, NULL,
+                       &data);
+    g_assert(aio_poll(ctx, true));
+    g_assert_cmpint(data.n, ==, 1);
+    g_assert(aio_poll(ctx, true));
+    g_assert_cmpint(data.n, ==, 2);
+    g_assert(!aio_poll(ctx, false));
+
+    pipe_test_cleanup(&data);
+}
+#endif
+
 /* Now the same tests, using the context as a GSource.  They are
  * very similar to the ones above, with g_main_context_iteration
  * replacing aio_poll.  However:
@@ -847,6 +920,10 @@ int main(int argc, char **argv)
     g_test_add_func("/aio/event/wait/no-flush-cb",  test_wait_event_notifier_noflush);
     g_test_add_func("/aio/event/flush",             test_flush_event_notifier);
     g_test_add_func("/aio/timer/schedule",          test_timer_schedule);
+#ifndef _WIN32
+    g_test_add_func("/aio/fd/no-drain",             test_fd_handler_no_drain);
+    g_test_add_func("/aio/fd/already-ready",        test_fd_handler_already_ready);
+#endif
 
     g_test_add_func("/aio/coroutine/queue-chaining", test_queue_chaining);
     g_test_add_func("/aio/coroutine/worker-thread-co-enter", test_worker_thread_co_enter);
@@ -20,6 +20,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/bitops.h"
 
 static char buffer[8 * 1024 * 1024];
 
@@ -58,13 +59,45 @@ static void test_1(void)
     }
 }
 
+static void test_batch_1(void)
+{
+    const size_t len = 4096;
+    const void *bufs[BITS_PER_LONG];
+    unsigned i, n;
+
+    for (i = 0; i < BITS_PER_LONG; i++) {
+        bufs[i] = buffer + i * len;
+    }
+
+    g_assert_cmphex(buffer_is_zero_batch(bufs, 0, len), ==, 0);
+    g_assert_cmphex(buffer_is_zero_batch(bufs, BITS_PER_LONG, len), ==,
+                    ~0UL);
+
+    /* Non-zero byte at the start, middle and end of every other buffer */
+    for (n = 1; n <= BITS_PER_LONG; n++) {
+        unsigned long expected = 0;
+
+        for (i = 0; i < n; i++) {
+            if (i % 2) {
+                buffer[i * len + (i % 3) * (len / 2 - 1)] = 1;
+            } else {
+                expected |= 1UL << i;
+            }
+        }
+        g_assert_cmphex(buffer_is_zero_batch(bufs, n, len), ==, expected);
+        memset(buffer, 0, n * len);
+    }
+}
+
 static void test_2(void)
 {
     if (g_test_perf()) {
         test_1();
+        test_batch_1();
     } else {
         do {
             test_1();
+            test_batch_1();
         } while (test_buffer_is_zero_next_accel());
     }
 }
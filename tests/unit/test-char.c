@@ -1748,6 +1748,45 @@ static void char_file_test(void)
     char_file_test_internal(NULL, NULL);
 }
 
+#ifndef _WIN32
+static void char_file_buffered_test(void)
+{
+    char *tmp_path = g_dir_make_tmp("qemu-test-char.XXXXXX", NULL);
+    char *out = g_build_filename(tmp_path, "out", NULL);
+    ChardevFile file = { .out = out,
+                         .has_buffered = true,
+                         .buffered = true };
+    ChardevBackend backend = { .type = CHARDEV_BACKEND_KIND_FILE,
+                               .u.file.data = &file };
+    CharBackend be;
+    Chardev *chr;
+    char *contents = NULL;
+    gsize length;
+    int ret;
+
+    chr = qemu_chardev_new("label-file", TYPE_CHARDEV_FILE, &backend,
+                           NULL, &error_abort);
+    qemu_chr_fe_init(&be, chr, &error_abort);
+
+    ret = qemu_chr_fe_write(&be, (uint8_t *)"hello!", 6);
+    g_assert_cmpint(ret, ==, 6);
+
+    /* Removing the chardev must write out what is still held back */
+    qemu_chr_fe_deinit(&be, true);
+
+    ret = g_file_get_contents(out, &contents, &length, NULL);
+    g_assert(ret == TRUE);
+    g_assert_cmpint(length, ==, 6);
+    g_assert(strncmp(contents, "hello!", 6) == 0);
+
+    g_free(contents);
+    g_unlink(out);
+    g_free(out);
+    g_rmdir(tmp_path);
+    g_free(tmp_path);
+}
+#endif
+
 static void char_null_test(void)
 {
     Error *err = NULL;
@@ -1914,6 +1953,9 @@ int main(int argc, char **argv)
     g_test_add_func("/char/pipe", char_pipe_test);
 #endif
     g_test_add_func("/char/file", char_file_test);
+#ifndef _WIN32
+    g_test_add_func("/char/file-buffered", char_file_buffered_test);
+#endif
 #ifndef _WIN32
     g_test_add_func("/char/file-fifo", char_file_fifo_test);
 #endif
@@ -132,6 +132,9 @@ static void test_nesting(void)
     /* Must enter and return from max nesting level */
     g_assert_cmpint(nd.n_enter, ==, nd.max);
     g_assert_cmpint(nd.n_return, ==, nd.max);
+
+    /* All nesting levels were alive at the same time */
+    g_assert_cmpuint(qemu_coroutine_get_peak_count(), >=, nd.max);
 }
 
 /*
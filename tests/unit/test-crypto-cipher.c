@@ -810,6 +810,64 @@ static void test_cipher_short_plaintext(void)
     qcrypto_cipher_free(cipher);
 }
 
+/*
+ * qcrypto_cipher_encrypt_sectors() must produce the same result as
+ * setting the IV and encrypting every sector on its own.
+ */
+static void test_cipher_sectors(const void *opaque)
+{
+    QCryptoCipherMode mode = GPOINTER_TO_INT(opaque);
+    QCryptoCipher *cipher;
+    uint8_t key[64];
+    uint8_t ivs[8 * 16] = { 0 };
+    uint8_t plaintext[8 * 512];
+    uint8_t expected[8 * 512];
+    uint8_t buf[8 * 512];
+    size_t nkey = qcrypto_cipher_get_key_len(QCRYPTO_CIPHER_ALGO_AES_256);
+    size_t i;
+
+    if (mode == QCRYPTO_CIPHER_MODE_XTS) {
+        nkey *= 2;
+    }
+
+    for (i = 0; i < sizeof(key); i++) {
+        key[i] = i;
+    }
+    for (i = 0; i < sizeof(plaintext); i++) {
+        plaintext[i] = i * 7;
+    }
+    for (i = 0; i < 8; i++) {
+        ivs[i * 16] = i + 1;
+    }
+
+    cipher = qcrypto_cipher_new(
+        QCRYPTO_CIPHER_ALGO_AES_256,
+        mode,
+        key, nkey,
+        &error_abort);
+    g_assert(cipher != NULL);
+
+    for (i = 0; i < 8; i++) {
+        qcrypto_cipher_setiv(cipher, ivs + i * 16, 16, &error_abort);
+        qcrypto_cipher_encrypt(cipher,
+                               plaintext + i * 512,
+                               expected + i * 512,
+                               512,
+                               &error_abort);
+    }
+
+    memcpy(buf, plaintext, sizeof(buf));
+    qcrypto_cipher_encrypt_sectors(cipher, ivs, 16, 512,
+                                   buf, sizeof(buf), &error_abort);
+    g_assert(memcmp(buf, expected, sizeof(buf)) == 0);
+
+    qcrypto_cipher_decrypt_sectors(cipher, ivs, 16, 512,
+                                   buf, sizeof(buf), &error_abort);
+    g_assert(memcmp(buf, plaintext, sizeof(buf)) == 0);
+
+    qcrypto_cipher_free(cipher);
+}
+
 int main(int argc, char **argv)
 {
     size_t i;
@@ -839,5 +897,18 @@ int main(int argc, char **argv)
         g_printerr("# skip unsupported aes-256:cbc\n");
     }
 
+    if (qcrypto_cipher_supports(QCRYPTO_CIPHER_ALGO_AES_256,
+                                QCRYPTO_CIPHER_MODE_XTS)) {
+        g_test_add_data_func("/crypto/cipher/sectors/aes-256-xts",
+                             GINT_TO_POINTER(QCRYPTO_CIPHER_MODE_XTS),
+                             test_cipher_sectors);
+    }
+    if (qcrypto_cipher_supports(QCRYPTO_CIPHER_ALGO_AES_256,
+                                QCRYPTO_CIPHER_MODE_CBC)) {
+        g_test_add_data_func("/crypto/cipher/sectors/aes-256-cbc",
+                             GINT_TO_POINTER(QCRYPTO_CIPHER_MODE_CBC),
+                             test_cipher_sectors);
+    }
+
     return g_test_run();
 }
@@ -26,6 +26,7 @@ typedef struct TestHBitmapData {
     size_t         size;
     size_t         old_size;
     int            granularity;
+    bool           compressed;
 } TestHBitmapData;
 
 
@@ -79,7 +80,8 @@ static void hbitmap_test_init(TestHBitmapData *data,
                               uint64_t size, int granularity)
 {
     size_t n;
-    data->hb = hbitmap_alloc(size, granularity);
+    data->hb = data->compressed ? hbitmap_alloc_compressed(size, granularity)
+                                : hbitmap_alloc(size, granularity);
 
     n = DIV_ROUND_UP(size, BITS_PER_LONG);
     if (n == 0) {
@@ -398,6 +400,28 @@ static void test_hbitmap_reset_all(TestHBitmapData *data,
     hbitmap_test_reset_all(data);
 }
 
+static void test_hbitmap_set_compressed(TestHBitmapData *data,
+                                        const void *unused)
+{
+    hbitmap_test_init(data, L3 * 2, 0);
+    hbitmap_test_set(data, 17, L3 - 17);
+    hbitmap_test_set(data, L3 + L2, L2 * 3 + 5);
+    hbitmap_test_reset(data, L2, L1 * 7);
+    hbitmap_test_check(data, 0);
+
+    hbitmap_set_compressed(data->hb, !data->compressed);
+    g_assert_cmpint(hbitmap_is_compressed(data->hb), ==, !data->compressed);
+    hbitmap_test_check(data, 0);
+    hbitmap_test_reset(data, L1, L3);
+    hbitmap_test_check(data, 0);
+
+    hbitmap_set_compressed(data->hb, data->compressed);
+    g_assert_cmpint(hbitmap_is_compressed(data->hb), ==, data->compressed);
+    hbitmap_test_check(data, 0);
+    hbitmap_test_set(data, 0, L3 * 2);
+    hbitmap_test_check(data, 0);
+}
+
 static void test_hbitmap_granularity(TestHBitmapData *data,
                                      const void *unused)
 {
@@ -793,11 +817,25 @@ static void test_hbitmap_serialize_zeroes(TestHBitmapData *data,
     }
 }
 
+static void hbitmap_test_setup_compressed(TestHBitmapData *data,
+                                          const void *unused)
+{
+    data->compressed = true;
+}
+
+/* Each test is run for both the flat and the compressed representation */
 static void hbitmap_test_add(const char *testpath,
                                    void (*test_func)(TestHBitmapData *data, const void *user_data))
 {
+    g_autofree char *compressed_path =
+        g_strconcat("/hbitmap/compressed", testpath + strlen("/hbitmap"), NULL);
+
+    g_assert(g_str_has_prefix(testpath, "/hbitmap/"));
     g_test_add(testpath, TestHBitmapData, NULL, NULL, test_func,
                hbitmap_test_teardown);
+    g_test_add(compressed_path, TestHBitmapData, NULL,
+               hbitmap_test_setup_compressed, test_func,
+               hbitmap_test_teardown);
 }
 
 static void test_hbitmap_iter_and_reset(TestHBitmapData *data,
@@ -1062,6 +1100,7 @@ int main(int argc, char **argv)
     hbitmap_test_add("/hbitmap/reset/general", test_hbitmap_reset);
     hbitmap_test_add("/hbitmap/reset/all", test_hbitmap_reset_all);
     hbitmap_test_add("/hbitmap/granularity", test_hbitmap_granularity);
+    hbitmap_test_add("/hbitmap/set-compressed", test_hbitmap_set_compressed);
 
     hbitmap_test_add("/hbitmap/truncate/nop", test_hbitmap_truncate_nop);
     hbitmap_test_add("/hbitmap/truncate/grow/negligible",
@@ -0,0 +1,121 @@
+/*
+ * Tests for log-linear histograms
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/hdr-histogram.h"
+
+static void test_empty(void)
+{
+    HdrHistogram h;
+
+    hdr_histogram_init(&h);
+    g_assert_cmpuint(h.count, ==, 0);
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 0.5), ==, 0);
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 1.0), ==, 0);
+}
+
+static void test_exact(void)
+{
+    HdrHistogram h;
+    uint64_t i;
+
+    /* Small values are counted exactly */
+    hdr_histogram_init(&h);
+    for (i = 1; i <= HDR_HISTOGRAM_SUB_BUCKETS; i++) {
+        hdr_histogram_record(&h, i);
+    }
+    g_assert_cmpuint(h.count, ==, HDR_HISTOGRAM_SUB_BUCKETS);
+    g_assert_cmpuint(h.min, ==, 1);
+    g_assert_cmpuint(h.max, ==, HDR_HISTOGRAM_SUB_BUCKETS);
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 0.0), ==, 1);
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 0.5), ==,
+                     HDR_HISTOGRAM_SUB_BUCKETS / 2);
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 1.0), ==,
+                     HDR_HISTOGRAM_SUB_BUCKETS);
+}
+
+static void test_relative_error(void)
+{
+    HdrHistogram h;
+    uint64_t values[] = {
+        100, 1000, 12345, 999999, 1ULL << 40, (1ULL << 40) + 12345,
+        UINT64_MAX / 3, UINT64_MAX,
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(values); i++) {
+        uint64_t q;
+
+        hdr_histogram_init(&h);
+        hdr_histogram_record(&h, 0);
+        hdr_histogram_record(&h, values[i]);
+        hdr_histogram_record(&h, UINT64_MAX);
+
+        /* The median is reported as the largest value of its bucket */
+        q = hdr_histogram_quantile(&h, 0.5);
+        g_assert_cmpuint(q, >=, values[i]);
+        g_assert_cmpuint(q - values[i], <=,
+                         values[i] / HDR_HISTOGRAM_SUB_BUCKETS);
+    }
+}
+
+static void test_percentiles(void)
+{
+    HdrHistogram h;
+    uint64_t i, q;
+
+    hdr_histogram_init(&h);
+    for (i = 1; i <= 100000; i++) {
+        hdr_histogram_record(&h, i * 10);
+    }
+
+    q = hdr_histogram_quantile(&h, 0.5);
+    g_assert_cmpuint(q, >=, 500000);
+    g_assert_cmpuint(q, <=, 500000 + 500000 / HDR_HISTOGRAM_SUB_BUCKETS);
+
+    q = hdr_histogram_quantile(&h, 0.99);
+    g_assert_cmpuint(q, >=, 990000);
+    g_assert_cmpuint(q, <=, 990000 + 990000 / HDR_HISTOGRAM_SUB_BUCKETS);
+
+    /* Never larger than the maximum */
+    g_assert_cmpuint(hdr_histogram_quantile(&h, 1.0), ==, 1000000);
+    g_assert_cmpuint(h.sum, ==, 10 * 100000 * 100001ULL / 2);
+}
+
+static void test_merge(void)
+{
+    HdrHistogram a, b;
+    uint64_t i;
+
+    hdr_histogram_init(&a);
+    hdr_histogram_init(&b);
+    for (i = 0; i < 1000; i++) {
+        hdr_histogram_record(i % 2 ? &a : &b, 1000 + i);
+    }
+
+    hdr_histogram_merge(&a, &b);
+    g_assert_cmpuint(a.count, ==, 1000);
+    g_assert_cmpuint(a.min, ==, 1000);
+    g_assert_cmpuint(a.max, ==, 1999);
+    g_assert_cmpuint(hdr_histogram_quantile(&a, 1.0), ==, 1999);
+
+    /* Merging an empty histogram changes nothing */
+    hdr_histogram_init(&b);
+    hdr_histogram_merge(&a, &b);
+    g_assert_cmpuint(a.count, ==, 1000);
+    g_assert_cmpuint(a.min, ==, 1000);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/hdr-histogram/empty", test_empty);
+    g_test_add_func("/hdr-histogram/exact", test_exact);
+    g_test_add_func("/hdr-histogram/relative-error", test_relative_error);
+    g_test_add_func("/hdr-histogram/percentiles", test_percentiles);
+    g_test_add_func("/hdr-histogram/merge", test_merge);
+    return g_test_run();
+}
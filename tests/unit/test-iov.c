@@ -565,6 +565,49 @@ static void test_discard_back_undo(void)
     iov_free(iov, iov_cnt);
 }
 
+static void test_inline(void)
+{
+    QEMUIOVectorInline qiov, slice;
+    char buf[QEMU_IOVEC_INLINE_NIOV * 4];
+    unsigned i;
+
+    qemu_iovec_init_inline(&qiov);
+    for (i = 0; i < QEMU_IOVEC_INLINE_NIOV; i++) {
+        qemu_iovec_add(&qiov.qiov, buf + i * 2, 2);
+    }
+    g_assert(qiov.qiov.iov == qiov.inline_iov);
+    g_assert_cmpint(qiov.qiov.niov, ==, QEMU_IOVEC_INLINE_NIOV);
+    g_assert_cmpuint(qiov.qiov.size, ==, QEMU_IOVEC_INLINE_NIOV * 2);
+
+    /* Slices that fit do not leave the inline storage */
+    qemu_iovec_init_slice_inline(&slice, &qiov.qiov, 1,
+                                 qiov.qiov.size - 2);
+    g_assert(slice.qiov.iov == slice.inline_iov);
+    g_assert_cmpint(slice.qiov.niov, ==, QEMU_IOVEC_INLINE_NIOV);
+    g_assert(slice.qiov.iov[0].iov_base == buf + 1);
+    g_assert_cmpuint(slice.qiov.size, ==, qiov.qiov.size - 2);
+    qemu_iovec_destroy(&slice.qiov);
+
+    /* One more entry moves the vector to the heap */
+    for (; i < QEMU_IOVEC_INLINE_NIOV * 2; i++) {
+        qemu_iovec_add(&qiov.qiov, buf + i * 2, 2);
+    }
+    g_assert(qiov.qiov.iov != qiov.inline_iov);
+    g_assert_cmpint(qiov.qiov.niov, ==, QEMU_IOVEC_INLINE_NIOV * 2);
+    for (i = 0; i < qiov.qiov.niov; i++) {
+        g_assert(qiov.qiov.iov[i].iov_base == buf + i * 2);
+    }
+
+    memset(buf, 0, sizeof(buf));
+    g_assert_cmpuint(qemu_iovec_memset(&qiov.qiov, 0, 0xaa, sizeof(buf)),
+                     ==, sizeof(buf));
+    g_assert(buf[0] == (char)0xaa && buf[sizeof(buf) - 1] == (char)0xaa);
+
+    qemu_iovec_reset(&qiov.qiov);
+    g_assert_cmpint(qiov.qiov.niov, ==, 0);
+    qemu_iovec_destroy(&qiov.qiov);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -575,5 +618,6 @@ int main(int argc, char **argv)
     g_test_add_func("/basic/iov/discard-back", test_discard_back);
     g_test_add_func("/basic/iov/discard-front-undo", test_discard_front_undo);
     g_test_add_func("/basic/iov/discard-back-undo", test_discard_back_undo);
+    g_test_add_func("/basic/iov/inline", test_inline);
     return g_test_run();
 }
@@ -0,0 +1,147 @@
+/*
+ * Test IOVA tree allocation
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2 or later.
+ * See the COPYING.LIB file in the top-level directory.
+ *
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/iova-tree.h"
+
+#define PAGE 0x1000
+
+static int alloc(IOVATree *tree, hwaddr size, hwaddr begin, hwaddr last,
+                 hwaddr *iova)
+{
+    DMAMap map = {
+        .size = size - 1,
+        .perm = IOMMU_RW,
+    };
+    int r = iova_tree_alloc_map(tree, &map, begin, last);
+
+    *iova = map.iova;
+    return r;
+}
+
+static void unmap(IOVATree *tree, hwaddr iova, hwaddr size)
+{
+    DMAMap map = {
+        .iova = iova,
+        .size = size - 1,
+    };
+
+    iova_tree_remove(tree, map);
+}
+
+static void test_alloc_first_fit(void)
+{
+    IOVATree *tree = iova_tree_new();
+    hwaddr iova;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmpint(alloc(tree, PAGE, PAGE, UINT32_MAX, &iova), ==,
+                        IOVA_OK);
+        g_assert_cmphex(iova, ==, PAGE * (i + 1));
+    }
+
+    /* Free the second page: a small allocation reuses it */
+    unmap(tree, 2 * PAGE, PAGE);
+    g_assert_cmpint(alloc(tree, PAGE, PAGE, UINT32_MAX, &iova), ==, IOVA_OK);
+    g_assert_cmphex(iova, ==, 2 * PAGE);
+
+    /* Free it again: a larger allocation doesn't fit and goes to the end */
+    unmap(tree, 2 * PAGE, PAGE);
+    g_assert_cmpint(alloc(tree, 2 * PAGE, PAGE, UINT32_MAX, &iova), ==,
+                    IOVA_OK);
+    g_assert_cmphex(iova, ==, 5 * PAGE);
+
+    /* Freeing the neighbours merges the holes */
+    unmap(tree, PAGE, PAGE);
+    unmap(tree, 3 * PAGE, PAGE);
+    g_assert_cmpint(alloc(tree, 3 * PAGE, PAGE, UINT32_MAX, &iova), ==,
+                    IOVA_OK);
+    g_assert_cmphex(iova, ==, PAGE);
+
+    iova_tree_destroy(tree);
+}
+
+static void test_alloc_begin_in_hole(void)
+{
+    IOVATree *tree = iova_tree_new();
+    DMAMap map = {
+        .iova = 16 * PAGE,
+        .size = PAGE - 1,
+        .perm = IOMMU_RW,
+    };
+    hwaddr iova;
+
+    g_assert_cmpint(iova_tree_insert(tree, &map), ==, IOVA_OK);
+
+    /* The hole below the mapping starts before iova_begin */
+    g_assert_cmpint(alloc(tree, 4 * PAGE, 8 * PAGE, UINT32_MAX, &iova), ==,
+                    IOVA_OK);
+    g_assert_cmphex(iova, ==, 8 * PAGE);
+
+    /* What is left below the mapping is too small */
+    g_assert_cmpint(alloc(tree, 8 * PAGE, 8 * PAGE, UINT32_MAX, &iova), ==,
+                    IOVA_OK);
+    g_assert_cmphex(iova, ==, 17 * PAGE);
+
+    iova_tree_destroy(tree);
+}
+
+static void test_alloc_nomem(void)
+{
+    IOVATree *tree = iova_tree_new();
+    hwaddr iova;
+
+    g_assert_cmpint(alloc(tree, 2 * PAGE, 0, 2 * PAGE - 1, &iova), ==,
+                    IOVA_OK);
+    g_assert_cmpint(alloc(tree, PAGE, 0, 2 * PAGE - 1, &iova), ==,
+                    IOVA_ERR_NOMEM);
+    g_assert_cmpint(alloc(tree, PAGE, PAGE, 0, &iova), ==, IOVA_ERR_INVALID);
+
+    unmap(tree, 0, 2 * PAGE);
+    g_assert_cmpint(alloc(tree, PAGE, 0, 2 * PAGE - 1, &iova), ==, IOVA_OK);
+    g_assert_cmphex(iova, ==, 0);
+
+    iova_tree_destroy(tree);
+}
+
+static void test_alloc_many(void)
+{
+    IOVATree *tree = iova_tree_new();
+    hwaddr iova;
+    int i;
+
+    for (i = 0; i < 1024; i++) {
+        g_assert_cmpint(alloc(tree, PAGE, 0, UINT32_MAX, &iova), ==, IOVA_OK);
+        g_assert_cmphex(iova, ==, (hwaddr)i * PAGE);
+    }
+    /* Punch out every other page, then refill the holes in order */
+    for (i = 0; i < 1024; i += 2) {
+        unmap(tree, (hwaddr)i * PAGE, PAGE);
+    }
+    for (i = 0; i < 1024; i += 2) {
+        g_assert_cmpint(alloc(tree, PAGE, 0, UINT32_MAX, &iova), ==, IOVA_OK);
+        g_assert_cmphex(iova, ==, (hwaddr)i * PAGE);
+    }
+    g_assert_cmpint(alloc(tree, PAGE, 0, UINT32_MAX, &iova), ==, IOVA_OK);
+    g_assert_cmphex(iova, ==, 1024 * PAGE);
+
+    iova_tree_destroy(tree);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/iova-tree/alloc-first-fit", test_alloc_first_fit);
+    g_test_add_func("/iova-tree/alloc-begin-in-hole", test_alloc_begin_in_hole);
+    g_test_add_func("/iova-tree/alloc-nomem", test_alloc_nomem);
+    g_test_add_func("/iova-tree/alloc-many", test_alloc_many);
+
+    return g_test_run();
+}
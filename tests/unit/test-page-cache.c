@@ -0,0 +1,90 @@
+/*
+ * XBZRLE page cache unit tests.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ */
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "../migration/page_cache.h"
+
+#define PAGE_SIZE 4096
+#define NUM_PAGES 16
+/* with 4 ways, addresses this far apart land in the same set */
+#define SET_STRIDE (NUM_PAGES / 4 * PAGE_SIZE)
+
+static void test_colliding_pages(void)
+{
+    PageCache *cache = cache_init(NUM_PAGES * PAGE_SIZE, PAGE_SIZE,
+                                  &error_abort);
+    uint8_t page[PAGE_SIZE];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        memset(page, i, sizeof(page));
+        g_assert_cmpint(cache_insert(cache, i * SET_STRIDE, page, 0), ==, 0);
+    }
+
+    for (i = 0; i < 4; i++) {
+        g_assert(cache_is_cached(cache, i * SET_STRIDE, 0));
+        g_assert_cmpint(get_cached_data(cache, i * SET_STRIDE)[0], ==, i);
+    }
+    g_assert(!get_cached_data(cache, 4 * SET_STRIDE));
+
+    cache_fini(cache);
+}
+
+static void test_fresh_pages_kept(void)
+{
+    PageCache *cache = cache_init(NUM_PAGES * PAGE_SIZE, PAGE_SIZE,
+                                  &error_abort);
+    uint8_t page[PAGE_SIZE] = {};
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmpint(cache_insert(cache, i * SET_STRIDE, page, 0), ==, 0);
+    }
+
+    /* the set is full of pages inserted in this cycle */
+    g_assert_cmpint(cache_insert(cache, 4 * SET_STRIDE, page, 1), ==, -1);
+    g_assert(!cache_is_cached(cache, 4 * SET_STRIDE, 1));
+
+    cache_fini(cache);
+}
+
+static void test_hot_page_kept(void)
+{
+    PageCache *cache = cache_init(NUM_PAGES * PAGE_SIZE, PAGE_SIZE,
+                                  &error_abort);
+    uint8_t page[PAGE_SIZE] = {};
+    uint64_t age = 0;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmpint(cache_insert(cache, i * SET_STRIDE, page, age), ==, 0);
+    }
+
+    /* page 0 is dirtied every cycle while new pages keep colliding */
+    for (i = 4; i < 12; i++) {
+        age += 2;
+        g_assert(cache_is_cached(cache, 0, age));
+        age += 2;
+        g_assert_cmpint(cache_insert(cache, i * SET_STRIDE, page, age), ==, 0);
+        g_assert(cache_is_cached(cache, i * SET_STRIDE, age));
+    }
+
+    g_assert(cache_is_cached(cache, 0, age));
+
+    cache_fini(cache);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/page-cache/colliding_pages", test_colliding_pages);
+    g_test_add_func("/page-cache/fresh_pages_kept", test_fresh_pages_kept);
+    g_test_add_func("/page-cache/hot_page_kept", test_hot_page_kept);
+
+    return g_test_run();
+}
@@ -734,6 +734,66 @@ static void test_accounting(void)
                                 (64.0 / 13)));
 }
 
+static void test_budget(void)
+{
+    uint64_t size, units;
+
+    /* Leak at 1 unit per second so that the test is not timing sensitive */
+    throttle_config_init(&cfg);
+    cfg.buckets[THROTTLE_BPS_TOTAL].avg = 1;
+    cfg.buckets[THROTTLE_BPS_TOTAL].max = 1000;
+    cfg.buckets[THROTTLE_OPS_READ].avg = 1;
+    cfg.buckets[THROTTLE_OPS_READ].max = 10;
+
+    throttle_init(&ts);
+    throttle_config(&ts, QEMU_CLOCK_VIRTUAL, &cfg);
+
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_READ,
+                                     &size, &units));
+    g_assert_cmpuint(size, ==, 1000);
+    g_assert_cmpuint(units, ==, 10);
+
+    /* writes have no operation limit */
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_WRITE,
+                                     &size, &units));
+    g_assert_cmpuint(size, ==, 1000);
+    g_assert_cmpuint(units, ==, UINT64_MAX);
+
+    /* a reserved budget counts as done I/O */
+    throttle_reserve_budget(&ts, THROTTLE_READ, 600, 4);
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_READ,
+                                     &size, &units));
+    g_assert_cmpuint(size, ==, 400);
+    g_assert_cmpuint(units, ==, 6);
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_WRITE,
+                                     &size, NULL));
+    g_assert_cmpuint(size, ==, 400);
+
+    /* using up the budget exactly doesn't throttle the next request */
+    throttle_account(&ts, THROTTLE_WRITE, 400);
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_READ,
+                                     &size, NULL));
+    g_assert_cmpuint(size, ==, 0);
+
+    /* going beyond it does */
+    throttle_account(&ts, THROTTLE_WRITE, 10);
+    g_assert(!throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_READ,
+                                      &size, NULL));
+    g_assert_cmpuint(size, ==, 0);
+
+    /* giving back the unused budget makes room again */
+    throttle_release_budget(&ts, THROTTLE_READ, 600, 4);
+    g_assert(throttle_compute_budget(&ts, QEMU_CLOCK_VIRTUAL, THROTTLE_READ,
+                                     &size, &units));
+    g_assert_cmpuint(size, ==, 590);
+    g_assert_cmpuint(units, ==, 10);
+
+    /* bucket levels never go below zero */
+    throttle_release_budget(&ts, THROTTLE_READ, 10000, 100);
+    g_assert(double_cmp(ts.cfg.buckets[THROTTLE_BPS_TOTAL].level, 0));
+    g_assert(double_cmp(ts.cfg.buckets[THROTTLE_OPS_READ].level, 0));
+}
+
 static void test_groups(void)
 {
     ThrottleConfig cfg1, cfg2;
@@ -829,6 +889,7 @@ int main(int argc, char **argv)
                     test_iops_size_is_missing_limit);
     g_test_add_func("/throttle/config_functions",   test_config_functions);
     g_test_add_func("/throttle/accounting",         test_accounting);
+    g_test_add_func("/throttle/budget",             test_budget);
     g_test_add_func("/throttle/groups",             test_groups);
     return g_test_run();
 }
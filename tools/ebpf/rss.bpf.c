@@ -35,6 +35,7 @@
 
 #define INDIRECTION_TABLE_SIZE 128
 #define HASH_CALCULATION_BUFFER_SIZE 36
+#define RSS_MAX_QUEUES 1024 /* MAX_QUEUE_NUM in QEMU */
 
 struct rss_config_t {
     __u8 redirect;
@@ -44,6 +45,12 @@ struct rss_config_t {
     __u16 default_queue;
 } __attribute__((packed));
 
+/* Must match struct EBPFRSSQueueCounters in ebpf/ebpf_rss.h */
+struct rss_queue_counters_t {
+    __u64 packets;
+    __u64 bytes;
+};
+
 struct toeplitz_key_data_t {
     __u32 leftmost_32_bits;
     __u8 next_byte[HASH_CALCULATION_BUFFER_SIZE];
@@ -100,6 +107,27 @@ struct {
     __uint(map_flags, BPF_F_MMAPABLE);
 } tap_rss_map_indirection_table SEC(".maps");
 
+/* Packets steered to each queue, read by QEMU for query-stats */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(key_size, sizeof(__u32));
+    __uint(value_size, sizeof(struct rss_queue_counters_t));
+    __uint(max_entries, RSS_MAX_QUEUES);
+} tap_rss_map_counters SEC(".maps");
+
+static inline __u16 count_queue(struct __sk_buff *skb, __u16 queue)
+{
+    __u32 key = queue;
+    struct rss_queue_counters_t *counters;
+
+    counters = bpf_map_lookup_elem(&tap_rss_map_counters, &key);
+    if (counters) {
+        counters->packets++;
+        counters->bytes += skb->len;
+    }
+    return queue;
+}
+
 static inline void net_rx_rss_add_chunk(__u8 *rss_input, size_t *bytes_written,
                                         const void *ptr, size_t size) {
     __builtin_memcpy(&rss_input[*bytes_written], ptr, size);
@@ -559,11 +587,11 @@ int tun_rss_steering_prog(struct __sk_buff *skb)
                                     &table_idx);
 
         if (queue) {
-            return *queue;
+            return count_queue(skb, *queue);
         }
     }
 
-    return config->default_queue;
+    return count_queue(skb, config->default_queue);
 }
 
 char _license[] SEC("license") = "GPL v2";
@@ -81,14 +81,13 @@ static unsigned int write_to_buffer(unsigned int idx, void *dataptr, size_t size
 
 static void clear_buffer_range(unsigned int idx, size_t len)
 {
-    uint32_t num = 0;
-    while (num < len) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
-        }
-        trace_buf[idx++] = 0;
-        num++;
-    }
+    /* Record lengths never exceed the buffer, so it wraps at most once */
+    size_t head;
+
+    idx %= TRACE_BUF_LEN;
+    head = MIN(len, TRACE_BUF_LEN - idx);
+    memset(&trace_buf[idx], 0, head);
+    memset(trace_buf, 0, len - head);
 }
 /**
  * Read a trace record from the trace buffer
@@ -244,26 +243,25 @@ int trace_record_start(TraceBufferRecord *rec, uint32_t event, size_t datasize)
 static void read_from_buffer(unsigned int idx, void *dataptr, size_t size)
 {
     uint8_t *data_ptr = dataptr;
-    uint32_t x = 0;
-    while (x < size) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
-        }
-        data_ptr[x++] = trace_buf[idx++];
-    }
+    size_t head;
+
+    idx %= TRACE_BUF_LEN;
+    head = MIN(size, TRACE_BUF_LEN - idx);
+    memcpy(data_ptr, &trace_buf[idx], head);
+    memcpy(data_ptr + head, trace_buf, size - head);
 }
 
 static unsigned int write_to_buffer(unsigned int idx, void *dataptr, size_t size)
 {
     uint8_t *data_ptr = dataptr;
-    uint32_t x = 0;
-    while (x < size) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
-        }
-        trace_buf[idx++] = data_ptr[x++];
-    }
-    return idx; /* most callers wants to know where to write next */
+    size_t head;
+
+    idx %= TRACE_BUF_LEN;
+    head = MIN(size, TRACE_BUF_LEN - idx);
+    memcpy(&trace_buf[idx], data_ptr, head);
+    memcpy(trace_buf, data_ptr + head, size - head);
+    /* most callers wants to know where to write next */
+    return head < size ? size - head : idx + size;
 }
 
 void trace_record_finish(TraceBufferRecord *rec)
@@ -32,6 +32,11 @@ struct QemuConsole {
     void *hw;
     CoQueue dump_queue;
 
+    /* Last reported content of each tile, see GraphicHwOps.filter_updates */
+    uint64_t *tile_hash;
+    unsigned long *tile_hash_valid;
+    int tile_cols;
+
     QTAILQ_ENTRY(QemuConsole) next;
 };
 
@@ -38,6 +38,8 @@
 #include "system/memory.h"
 #include "qom/object.h"
 #include "qemu/memfd.h"
+#include "qemu/bswap.h"
+#include "qemu/xxhash.h"
 
 #include "console-priv.h"
 
@@ -207,8 +209,19 @@ void qemu_console_set_window_id(QemuConsole *con, int window_id)
     con->window_id = window_id;
 }
 
+static void qemu_console_reset_tile_hash(QemuConsole *con)
+{
+    g_clear_pointer(&con->tile_hash, g_free);
+    g_clear_pointer(&con->tile_hash_valid, g_free);
+    con->tile_cols = 0;
+}
+
 void graphic_hw_invalidate(QemuConsole *con)
 {
+    if (con) {
+        /* the whole screen is redrawn, do not filter any of it */
+        qemu_console_reset_tile_hash(con);
+    }
     if (con && con->hw_ops->invalidate) {
         con->hw_ops->invalidate(con->hw);
     }
@@ -396,6 +409,7 @@ qemu_console_finalize(Object *obj)
 
     /* TODO: check this code path, and unregister from consoles */
     g_clear_pointer(&c->surface, qemu_free_displaysurface);
+    qemu_console_reset_tile_hash(c);
     g_clear_pointer(&c->gl_unblock_timer, timer_free);
     g_clear_pointer(&c->ui_timer, timer_free);
 }
@@ -772,10 +786,112 @@ int dpy_set_ui_info(QemuConsole *con, QemuUIInfo *info, bool delay)
     return 0;
 }
 
-void dpy_gfx_update(QemuConsole *con, int x, int y, int w, int h)
+#define CONSOLE_TILE_SIZE 64
+
+static uint64_t qemu_console_tile_hash(const uint8_t *p, int stride,
+                                       int row_bytes, int rows)
+{
+    uint64_t v1 = QEMU_XXHASH_SEED + XXH_PRIME64_1 + XXH_PRIME64_2;
+    uint64_t v2 = QEMU_XXHASH_SEED + XXH_PRIME64_2;
+    uint64_t v3 = QEMU_XXHASH_SEED + 0;
+    uint64_t v4 = QEMU_XXHASH_SEED - XXH_PRIME64_1;
+    int i;
+
+    for (; rows > 0; rows--, p += stride) {
+        for (i = 0; i + 32 <= row_bytes; i += 32) {
+            v1 = XXH64_round(v1, ldq_he_p(p + i));
+            v2 = XXH64_round(v2, ldq_he_p(p + i + 8));
+            v3 = XXH64_round(v3, ldq_he_p(p + i + 16));
+            v4 = XXH64_round(v4, ldq_he_p(p + i + 24));
+        }
+        for (; i < row_bytes; i++) {
+            v1 = XXH64_round(v1, p[i]);
+        }
+    }
+
+    return XXH64_avalanche(XXH64_mergerounds(v1, v2, v3, v4));
+}
+
+static void dpy_gfx_update_listeners(QemuConsole *con,
+                                     int x, int y, int w, int h)
 {
     DisplayState *s = con->ds;
     DisplayChangeListener *dcl;
+
+    dpy_gfx_update_texture(con, con->surface, x, y, w, h);
+    QLIST_FOREACH(dcl, &s->listeners, next) {
+        if (con != dcl->con) {
+            continue;
+        }
+        if (dcl->ops->dpy_gfx_update) {
+            dcl->ops->dpy_gfx_update(dcl, x, y, w, h);
+        }
+    }
+}
+
+/*
+ * Hash the 64x64 tiles touched by the update, and only pass on runs of
+ * tiles whose content changed since they were last reported.  Changed
+ * tiles are passed on whole, so that the stored hash always matches what
+ * the listeners were told about.
+ */
+static void dpy_gfx_update_changed(QemuConsole *con,
+                                   int x, int y, int w, int h)
+{
+    DisplaySurface *surface = con->surface;
+    int width = surface_width(surface);
+    int height = surface_height(surface);
+    int bpp = surface_bytes_per_pixel(surface);
+    int stride = surface_stride(surface);
+    uint8_t *data = surface_data(surface);
+    int tx, ty, tw, th, run, idx;
+    uint64_t hash;
+
+    if (!con->tile_hash) {
+        int rows = DIV_ROUND_UP(height, CONSOLE_TILE_SIZE);
+
+        con->tile_cols = DIV_ROUND_UP(width, CONSOLE_TILE_SIZE);
+        con->tile_hash = g_new(uint64_t, con->tile_cols * rows);
+        con->tile_hash_valid = bitmap_new(con->tile_cols * rows);
+    }
+
+    for (ty = y / CONSOLE_TILE_SIZE; ty * CONSOLE_TILE_SIZE < y + h; ty++) {
+        th = MIN(CONSOLE_TILE_SIZE, height - ty * CONSOLE_TILE_SIZE);
+        run = -1;
+        for (tx = x / CONSOLE_TILE_SIZE; tx * CONSOLE_TILE_SIZE < x + w; tx++) {
+            tw = MIN(CONSOLE_TILE_SIZE, width - tx * CONSOLE_TILE_SIZE);
+            idx = ty * con->tile_cols + tx;
+            hash = qemu_console_tile_hash(data +
+                                          ty * CONSOLE_TILE_SIZE * stride +
+                                          tx * CONSOLE_TILE_SIZE * bpp,
+                                          stride, tw * bpp, th);
+            if (!test_bit(idx, con->tile_hash_valid) ||
+                con->tile_hash[idx] != hash) {
+                con->tile_hash[idx] = hash;
+                set_bit(idx, con->tile_hash_valid);
+                if (run < 0) {
+                    run = tx;
+                }
+                continue;
+            }
+            if (run >= 0) {
+                dpy_gfx_update_listeners(con, run * CONSOLE_TILE_SIZE,
+                                         ty * CONSOLE_TILE_SIZE,
+                                         (tx - run) * CONSOLE_TILE_SIZE, th);
+                run = -1;
+            }
+        }
+        if (run >= 0) {
+            dpy_gfx_update_listeners(con, run * CONSOLE_TILE_SIZE,
+                                     ty * CONSOLE_TILE_SIZE,
+                                     MIN(tx * CONSOLE_TILE_SIZE, width) -
+                                     run * CONSOLE_TILE_SIZE, th);
+        }
+    }
+}
+
+void dpy_gfx_update(QemuConsole *con, int x, int y, int w, int h)
+{
     int width = qemu_console_get_width(con, x + w);
     int height = qemu_console_get_height(con, y + h);
 
@@ -789,15 +905,12 @@ void dpy_gfx_update(QemuConsole *con, int x, int y, int w, int h)
     if (!qemu_console_is_visible(con)) {
         return;
     }
-    dpy_gfx_update_texture(con, con->surface, x, y, w, h);
-    QLIST_FOREACH(dcl, &s->listeners, next) {
-        if (con != dcl->con) {
-            continue;
-        }
-        if (dcl->ops->dpy_gfx_update) {
-            dcl->ops->dpy_gfx_update(dcl, x, y, w, h);
-        }
+    if (con->hw_ops->filter_updates && con->surface &&
+        surface_data(con->surface) && w > 0 && h > 0) {
+        dpy_gfx_update_changed(con, x, y, w, h);
+        return;
     }
+    dpy_gfx_update_listeners(con, x, y, w, h);
 }
 
 void dpy_gfx_update_full(QemuConsole *con)
@@ -835,6 +948,7 @@ void dpy_gfx_replace_surface(QemuConsole *con,
 
     con->scanout.kind = SCANOUT_SURFACE;
     con->surface = new_surface;
+    qemu_console_reset_tile_hash(con);
     dpy_gfx_create_texture(con, new_surface);
     QLIST_FOREACH(dcl, &s->listeners, next) {
         if (con != dcl->con) {
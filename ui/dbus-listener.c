@@ -75,6 +75,15 @@ struct _DBusDisplayListener {
     bool ds_mapped;
     bool can_share_map;
 
+    /*
+     * With a shared map, at most one UpdateMap call is in flight.  Damage
+     * reported meanwhile is merged and sent once the client replied, so a
+     * slow client does not make QEMU queue up messages.
+     */
+    bool update_map_pending;
+    bool update_map_damaged;
+    int update_map_x1, update_map_y1, update_map_x2, update_map_y2;
+
 #ifdef WIN32
     QemuDBusDisplay1ListenerWin32Map *map_proxy;
     QemuDBusDisplay1ListenerWin32D3d11 *d3d11_proxy;
@@ -811,6 +820,78 @@ static void ddl_scanout(DBusDisplayListener *ddl)
         g_object_ref(ddl));
 }
 
+static void ddl_update_map(DBusDisplayListener *ddl,
+                           int x, int y, int w, int h);
+
+static void dbus_update_map_cb(GObject *source_object,
+                               GAsyncResult *res,
+                               gpointer user_data)
+{
+    g_autoptr(GError) err = NULL;
+    DBusDisplayListener *ddl = user_data;
+    int x, y, w, h;
+
+#ifdef WIN32
+    if (!qemu_dbus_display1_listener_win32_map_call_update_map_finish(
+            ddl->map_proxy, res, &err)) {
+#else
+    if (!qemu_dbus_display1_listener_unix_map_call_update_map_finish(
+            ddl->map_proxy, res, &err)) {
+#endif
+        g_debug("Failed to call UpdateMap: %s", err->message);
+    }
+
+    ddl->update_map_pending = false;
+    if (ddl->update_map_damaged && ddl->ds &&
+        ddl->ds_share == SHARE_KIND_MAPPED) {
+        x = ddl->update_map_x1;
+        y = ddl->update_map_y1;
+        w = MIN(ddl->update_map_x2, surface_width(ddl->ds)) - x;
+        h = MIN(ddl->update_map_y2, surface_height(ddl->ds)) - y;
+        ddl->update_map_damaged = false;
+        if (w > 0 && h > 0) {
+            ddl_update_map(ddl, x, y, w, h);
+        }
+    }
+    g_object_unref(ddl);
+}
+
+static void ddl_update_map(DBusDisplayListener *ddl,
+                           int x, int y, int w, int h)
+{
+    if (ddl->update_map_pending) {
+        trace_dbus_update_map_merge(x, y, w, h);
+        if (!ddl->update_map_damaged) {
+            ddl->update_map_x1 = x;
+            ddl->update_map_y1 = y;
+            ddl->update_map_x2 = x + w;
+            ddl->update_map_y2 = y + h;
+            ddl->update_map_damaged = true;
+        } else {
+            ddl->update_map_x1 = MIN(ddl->update_map_x1, x);
+            ddl->update_map_y1 = MIN(ddl->update_map_y1, y);
+            ddl->update_map_x2 = MAX(ddl->update_map_x2, x + w);
+            ddl->update_map_y2 = MAX(ddl->update_map_y2, y + h);
+        }
+        return;
+    }
+
+    ddl->update_map_pending = true;
+#ifdef WIN32
+    qemu_dbus_display1_listener_win32_map_call_update_map(
+        ddl->map_proxy,
+        x, y, w, h,
+        G_DBUS_CALL_FLAGS_NONE,
+        DBUS_DEFAULT_TIMEOUT, NULL, dbus_update_map_cb, g_object_ref(ddl));
+#else
+    qemu_dbus_display1_listener_unix_map_call_update_map(
+        ddl->map_proxy,
+        x, y, w, h,
+        G_DBUS_CALL_FLAGS_NONE,
+        DBUS_DEFAULT_TIMEOUT, NULL, dbus_update_map_cb, g_object_ref(ddl));
+#endif
+}
+
 static void dbus_gfx_update(DisplayChangeListener *dcl,
                             int x, int y, int w, int h)
 {
@@ -821,19 +902,7 @@ static void dbus_gfx_update(DisplayChangeListener *dcl,
     trace_dbus_update(x, y, w, h);
 
     if (dbus_scanout_map(ddl)) {
-#ifdef WIN32
-        qemu_dbus_display1_listener_win32_map_call_update_map(
-            ddl->map_proxy,
-            x, y, w, h,
-            G_DBUS_CALL_FLAGS_NONE,
-            DBUS_DEFAULT_TIMEOUT, NULL, NULL, NULL);
-#else
-        qemu_dbus_display1_listener_unix_map_call_update_map(
-            ddl->map_proxy,
-            x, y, w, h,
-            G_DBUS_CALL_FLAGS_NONE,
-            DBUS_DEFAULT_TIMEOUT, NULL, NULL, NULL);
-#endif
+        ddl_update_map(ddl, x, y, w, h);
         return;
     }
 
@@ -872,6 +941,8 @@ static void dbus_gfx_switch(DisplayChangeListener *dcl,
 
     ddl->ds = new_surface;
     ddl->ds_share = SHARE_KIND_NONE;
+    /* The new surface is sent in full, drop damage of the old one */
+    ddl->update_map_damaged = false;
 }
 
 static void dbus_mouse_set(DisplayChangeListener *dcl,
@@ -3158,7 +3158,9 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
     pixman_image_t *tmpbuf = NULL;
     unsigned long offset;
     int x;
+    int bits = DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
     uint8_t *guest_ptr, *server_ptr;
+    DECLARE_BITMAP(changed, VNC_MAX_WIDTH / VNC_DIRTY_PIXELS_PER_BIT);
 
     struct timeval tv = { 0, 0 };
 
@@ -3198,10 +3200,12 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
     line_bytes = MIN(server_stride, guest_ll);
 
     for (;;) {
+        bool row_changed = false;
+
         y = offset / VNC_DIRTY_BPL(&vd->guest);
         x = offset % VNC_DIRTY_BPL(&vd->guest);
 
-        server_ptr = server_row0 + y * server_stride + x * cmp_bytes;
+        server_ptr = server_row0 + y * server_stride;
 
         if (vd->guest.format != VNC_SERVER_FB_FORMAT) {
             qemu_pixman_linebuf_fill(tmpbuf, vd->guest.fb, width, 0, y);
@@ -3209,31 +3213,40 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
         } else {
             guest_ptr = guest_row0 + y * guest_stride;
         }
-        guest_ptr += x * cmp_bytes;
 
-        for (; x < DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
-             x++, guest_ptr += cmp_bytes, server_ptr += cmp_bytes) {
+        /* Only visit the dirty tiles, and then clear the row in one go */
+        for (x = find_next_bit(vd->guest.dirty[y], bits, x); x < bits;
+             x = find_next_bit(vd->guest.dirty[y], bits, x + 1)) {
             int _cmp_bytes = cmp_bytes;
-            if (!test_and_clear_bit(x, vd->guest.dirty[y])) {
-                continue;
-            }
+
             if ((x + 1) * cmp_bytes > line_bytes) {
                 _cmp_bytes = line_bytes - x * cmp_bytes;
             }
             assert(_cmp_bytes >= 0);
-            if (memcmp(server_ptr, guest_ptr, _cmp_bytes) == 0) {
+            if (memcmp(server_ptr + x * cmp_bytes, guest_ptr + x * cmp_bytes,
+                       _cmp_bytes) == 0) {
                 continue;
             }
-            memcpy(server_ptr, guest_ptr, _cmp_bytes);
+            memcpy(server_ptr + x * cmp_bytes, guest_ptr + x * cmp_bytes,
+                   _cmp_bytes);
             if (!vd->non_adaptive) {
                 vnc_rect_updated(vd, x * VNC_DIRTY_PIXELS_PER_BIT,
                                  y, &tv);
             }
-            QTAILQ_FOREACH(vs, &vd->clients, next) {
-                set_bit(x, vs->dirty[y]);
+            if (!row_changed) {
+                bitmap_zero(changed, bits);
+                row_changed = true;
             }
+            set_bit(x, changed);
             has_dirty++;
         }
+        bitmap_clear(vd->guest.dirty[y], 0, bits);
+
+        if (row_changed) {
+            QTAILQ_FOREACH(vs, &vd->clients, next) {
+                bitmap_or(vs->dirty[y], vs->dirty[y], changed, bits);
+            }
+        }
 
         y++;
         offset = find_next_bit((unsigned long *) &vd->guest.dirty,
@@ -22,12 +22,21 @@
 #include "qemu/rcu_queue.h"
 #include "qemu/sockets.h"
 #include "qemu/cutils.h"
+#include "qapi/error.h"
 #include "trace.h"
 #include "aio-posix.h"
 
 /* Stop userspace polling on a handler if it isn't active for some time */
 #define POLL_IDLE_INTERVAL_NS (7 * NANOSECONDS_PER_SECOND)
 
+/*
+ * Handlers with a known event rate are considered idle sooner, once they
+ * have missed about POLL_IDLE_EVENTS of their usual events, but never in
+ * less than POLL_IDLE_MIN_INTERVAL_NS.
+ */
+#define POLL_IDLE_EVENTS 64
+#define POLL_IDLE_MIN_INTERVAL_NS (100 * SCALE_MS)
+
 static void adjust_polling_time(AioContext *ctx, AioPolledEvent *poll,
                                 int64_t block_ns);
 
@@ -441,6 +450,33 @@ void aio_dispatch(AioContext *ctx)
     timerlistgroup_run_timers(&ctx->tlg);
 }
 
+static int64_t poll_idle_interval(AioHandler *node)
+{
+    if (!node->poll_interval_ns) {
+        return POLL_IDLE_INTERVAL_NS;
+    }
+    return MIN(MAX(node->poll_interval_ns * POLL_IDLE_EVENTS,
+                   POLL_IDLE_MIN_INTERVAL_NS),
+               POLL_IDLE_INTERVAL_NS);
+}
+
+/* Update the handler's event interval average after successful polling */
+static void poll_handler_event(AioHandler *node, int64_t now)
+{
+    if (node->poll_last_event_ns) {
+        int64_t interval = now - node->poll_last_event_ns;
+
+        if (node->poll_interval_ns) {
+            node->poll_interval_ns =
+                (node->poll_interval_ns * 7 + interval) / 8;
+        } else {
+            node->poll_interval_ns = interval;
+        }
+    }
+    node->poll_last_event_ns = now;
+    node->poll_idle_timeout = now + poll_idle_interval(node);
+}
+
 static bool run_poll_handlers_once(AioContext *ctx,
                                    AioHandlerList *ready_list,
                                    int64_t now,
@@ -454,7 +490,7 @@ static bool run_poll_handlers_once(AioContext *ctx,
         if (node->io_poll(node->opaque)) {
             aio_add_poll_ready_handler(ready_list, node);
 
-            node->poll_idle_timeout = now + POLL_IDLE_INTERVAL_NS;
+            poll_handler_event(node, now);
 
             /*
              * Polling was successful, exit try_poll_mode immediately
@@ -497,10 +533,12 @@ static bool remove_idle_poll_handlers(AioContext *ctx,
 
     QLIST_FOREACH_SAFE(node, &ctx->poll_aio_handlers, node_poll, tmp) {
         if (node->poll_idle_timeout == 0LL) {
-            node->poll_idle_timeout = now + POLL_IDLE_INTERVAL_NS;
+            node->poll_idle_timeout = now + poll_idle_interval(node);
         } else if (now >= node->poll_idle_timeout) {
             trace_poll_remove(ctx, node, node->pfd.fd);
             node->poll_idle_timeout = 0LL;
+            /* Don't count the idle period towards the event interval */
+            node->poll_last_event_ns = 0LL;
             QLIST_SAFE_REMOVE(node, node_poll);
             if (ctx->poll_started && node->io_poll_end) {
                 node->io_poll_end(node->opaque);
@@ -658,6 +696,14 @@ static void adjust_polling_time(AioContext *ctx, AioPolledEvent *poll,
     }
 }
 
+static void aio_stats_account(Stat64 *stat, int64_t *last)
+{
+    int64_t now = get_clock();
+
+    stat64_add(stat, now - *last);
+    *last = now;
+}
+
 bool aio_poll(AioContext *ctx, bool blocking)
 {
     AioHandlerList ready_list = QLIST_HEAD_INITIALIZER(ready_list);
@@ -666,6 +712,8 @@ bool aio_poll(AioContext *ctx, bool blocking)
     int64_t timeout;
     int64_t start = 0;
     int64_t block_ns = 0;
+    bool stats = qatomic_read(&ctx->stats_enabled);
+    int64_t stats_last = 0;
 
     /*
      * There cannot be two concurrent aio_poll calls for the same AioContext (or
@@ -684,11 +732,18 @@ bool aio_poll(AioContext *ctx, bool blocking)
     if (ctx->poll_max_ns) {
         start = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     }
+    if (stats) {
+        stats_last = get_clock();
+    }
 
     timeout = blocking ? aio_compute_timeout(ctx) : 0;
     progress = try_poll_mode(ctx, &ready_list, &timeout);
     assert(!(timeout && progress));
 
+    if (stats) {
+        aio_stats_account(&ctx->stats.poll_ns, &stats_last);
+    }
+
     /*
      * aio_notify can avoid the expensive event_notifier_set if
      * everything (file descriptors, bottom halves, timers) will
@@ -743,15 +798,31 @@ bool aio_poll(AioContext *ctx, bool blocking)
         block_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
     }
 
+    if (stats) {
+        aio_stats_account(&ctx->stats.wait_ns, &stats_last);
+    }
+
     progress |= aio_bh_poll(ctx);
+    if (stats) {
+        aio_stats_account(&ctx->stats.bh_ns, &stats_last);
+    }
+
     progress |= aio_dispatch_ready_handlers(ctx, &ready_list, block_ns);
 
     aio_free_deleted_handlers(ctx);
 
     qemu_lockcnt_dec(&ctx->list_lock);
 
+    if (stats) {
+        aio_stats_account(&ctx->stats.handler_ns, &stats_last);
+    }
+
     progress |= timerlistgroup_run_timers(&ctx->tlg);
 
+    if (stats) {
+        aio_stats_account(&ctx->stats.timer_ns, &stats_last);
+    }
+
     return progress;
 }
 
@@ -818,3 +889,40 @@ void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch)
 
     aio_notify(ctx);
 }
+
+static bool aio_io_uring_params_equal(const AioIoUringParams *a,
+                                      const AioIoUringParams *b)
+{
+    return a->queue_depth == b->queue_depth &&
+           a->sqpoll == b->sqpoll &&
+           a->sqpoll_cpu == b->sqpoll_cpu &&
+           a->sqpoll_idle == b->sqpoll_idle &&
+           a->iopoll == b->iopoll;
+}
+
+void aio_context_set_io_uring_params(AioContext *ctx,
+                                     const AioIoUringParams *params,
+                                     Error **errp)
+{
+    if (aio_io_uring_params_equal(&ctx->io_uring_params, params)) {
+        return;
+    }
+
+#ifdef CONFIG_LINUX_IO_URING
+    if (ctx->linux_io_uring || ctx->linux_io_uring_cmd) {
+        error_setg(errp, "io_uring parameters cannot be changed while "
+                   "io_uring is in use");
+        return;
+    }
+
+    ctx->io_uring_params = *params;
+    fdmon_io_uring_reconfigure(ctx);
+#else
+    if (params->sqpoll || params->iopoll) {
+        error_setg(errp, "io_uring is not available on this host");
+        return;
+    }
+
+    ctx->io_uring_params = *params;
+#endif
+}
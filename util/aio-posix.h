@@ -37,6 +37,8 @@ struct AioHandler {
     unsigned flags; /* see fdmon-io_uring.c */
 #endif
     int64_t poll_idle_timeout; /* when to stop userspace polling */
+    int64_t poll_last_event_ns; /* time of the last successful poll */
+    int64_t poll_interval_ns; /* moving average of the time between events */
     bool poll_ready; /* has polling detected an event? */
     AioPolledEvent poll;
 };
@@ -69,6 +71,7 @@ static inline void fdmon_epoll_disable(AioContext *ctx)
 #ifdef CONFIG_LINUX_IO_URING
 bool fdmon_io_uring_setup(AioContext *ctx);
 void fdmon_io_uring_destroy(AioContext *ctx);
+void fdmon_io_uring_reconfigure(AioContext *ctx);
 #else
 static inline bool fdmon_io_uring_setup(AioContext *ctx)
 {
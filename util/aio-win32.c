@@ -442,3 +442,12 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
 void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch)
 {
 }
+
+void aio_context_set_io_uring_params(AioContext *ctx,
+                                     const AioIoUringParams *params,
+                                     Error **errp)
+{
+    if (params->sqpoll || params->iopoll) {
+        error_setg(errp, "io_uring is not available on Windows");
+    }
+}
@@ -23,14 +23,100 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/coroutine-tls.h"
+#include "qemu/notify.h"
+#include "qemu/thread.h"
 #include "block/aio.h"
+#include "trace.h"
+
+/*
+ * Freed AIOCBs are kept in a small per-thread cache so that the I/O hot path
+ * does not need to go through the allocator for every request.  There are
+ * only a handful of different AIOCBInfo sizes in practice, so the cache is
+ * organized as a few free lists, one for each exact size.
+ */
+#define AIOCB_CACHE_CLASSES 4
+#define AIOCB_CACHE_MAX_FREE 64
+
+typedef struct AIOCBFreeEntry {
+    struct AIOCBFreeEntry *next;
+} AIOCBFreeEntry;
+
+typedef struct {
+    size_t size;            /* 0 if this class is not in use yet */
+    unsigned int nfree;
+    AIOCBFreeEntry *free_list;
+} AIOCBCacheClass;
+
+typedef struct {
+    AIOCBCacheClass classes[AIOCB_CACHE_CLASSES];
+} AIOCBCache;
+
+/* Use get_ptr_aiocb_cache() to fetch this thread-local value */
+QEMU_DEFINE_STATIC_CO_TLS(AIOCBCache, aiocb_cache);
+
+/* This won't involve coroutines, so use __thread */
+static __thread Notifier aiocb_cache_atexit_notifier;
+
+/* Called at thread cleanup time */
+static void aiocb_cache_atexit(Notifier *n, void *value)
+{
+    AIOCBCache *cache = get_ptr_aiocb_cache();
+
+    for (int i = 0; i < AIOCB_CACHE_CLASSES; i++) {
+        AIOCBCacheClass *class = &cache->classes[i];
+
+        while (class->free_list) {
+            AIOCBFreeEntry *entry = class->free_list;
+            class->free_list = entry->next;
+            g_free(entry);
+        }
+        class->nfree = 0;
+    }
+}
+
+/*
+ * Return the cache class for objects of @size bytes, claiming an unused class
+ * if necessary, or NULL if all classes are taken by other sizes.
+ */
+static AIOCBCacheClass *aiocb_cache_class(size_t size)
+{
+    AIOCBCache *cache = get_ptr_aiocb_cache();
+
+    for (int i = 0; i < AIOCB_CACHE_CLASSES; i++) {
+        AIOCBCacheClass *class = &cache->classes[i];
+
+        if (class->size == size) {
+            return class;
+        }
+        if (class->size == 0) {
+            if (i == 0) {
+                aiocb_cache_atexit_notifier.notify = aiocb_cache_atexit;
+                qemu_thread_atexit_add(&aiocb_cache_atexit_notifier);
+            }
+            class->size = size;
+            return class;
+        }
+    }
+    return NULL;
+}
 
 void *qemu_aio_get(const AIOCBInfo *aiocb_info, BlockDriverState *bs,
                    BlockCompletionFunc *cb, void *opaque)
 {
+    AIOCBCacheClass *class = aiocb_cache_class(aiocb_info->aiocb_size);
     BlockAIOCB *acb;
 
-    acb = g_malloc(aiocb_info->aiocb_size);
+    if (class && class->free_list) {
+        AIOCBFreeEntry *entry = class->free_list;
+
+        class->free_list = entry->next;
+        class->nfree--;
+        acb = (BlockAIOCB *)entry;
+    } else {
+        trace_qemu_aio_get_alloc(aiocb_info, aiocb_info->aiocb_size);
+        acb = g_malloc(aiocb_info->aiocb_size);
+    }
     acb->aiocb_info = aiocb_info;
     acb->bs = bs;
     acb->cb = cb;
@@ -50,6 +136,17 @@ void qemu_aio_unref(void *p)
     BlockAIOCB *acb = p;
     assert(acb->refcnt > 0);
     if (--acb->refcnt == 0) {
-        g_free(acb);
+        AIOCBCacheClass *class =
+            aiocb_cache_class(acb->aiocb_info->aiocb_size);
+
+        if (class && class->nfree < AIOCB_CACHE_MAX_FREE) {
+            AIOCBFreeEntry *entry = (AIOCBFreeEntry *)acb;
+
+            entry->next = class->free_list;
+            class->free_list = entry;
+            class->nfree++;
+        } else {
+            g_free(acb);
+        }
     }
 }
@@ -385,6 +385,11 @@ aio_ctx_finalize(GSource     *source)
         luring_cleanup(ctx->linux_io_uring);
         ctx->linux_io_uring = NULL;
     }
+    if (ctx->linux_io_uring_cmd) {
+        luring_detach_aio_context(ctx->linux_io_uring_cmd, ctx);
+        luring_cleanup(ctx->linux_io_uring_cmd);
+        ctx->linux_io_uring_cmd = NULL;
+    }
 #endif
 
     assert(QSLIST_EMPTY(&ctx->scheduled_coroutines));
@@ -469,7 +474,7 @@ LuringState *aio_setup_linux_io_uring(AioContext *ctx, Error **errp)
         return ctx->linux_io_uring;
     }
 
-    ctx->linux_io_uring = luring_init(errp);
+    ctx->linux_io_uring = luring_init(&ctx->io_uring_params, false, errp);
     if (!ctx->linux_io_uring) {
         return NULL;
     }
@@ -483,6 +488,27 @@ LuringState *aio_get_linux_io_uring(AioContext *ctx)
     assert(ctx->linux_io_uring);
     return ctx->linux_io_uring;
 }
+
+LuringState *aio_setup_linux_io_uring_cmd(AioContext *ctx, Error **errp)
+{
+    if (ctx->linux_io_uring_cmd) {
+        return ctx->linux_io_uring_cmd;
+    }
+
+    ctx->linux_io_uring_cmd = luring_init(&ctx->io_uring_params, true, errp);
+    if (!ctx->linux_io_uring_cmd) {
+        return NULL;
+    }
+
+    luring_attach_aio_context(ctx->linux_io_uring_cmd, ctx);
+    return ctx->linux_io_uring_cmd;
+}
+
+LuringState *aio_get_linux_io_uring_cmd(AioContext *ctx)
+{
+    assert(ctx->linux_io_uring_cmd);
+    return ctx->linux_io_uring_cmd;
+}
 #endif
 
 void aio_notify(AioContext *ctx)
@@ -580,6 +606,7 @@ AioContext *aio_context_new(Error **errp)
     ctx = (AioContext *) g_source_new(&aio_source_funcs, sizeof(AioContext));
     QSLIST_INIT(&ctx->bh_list);
     QSIMPLEQ_INIT(&ctx->bh_slice_list);
+    ctx->io_uring_params = (AioIoUringParams) { .sqpoll_cpu = -1 };
     aio_context_setup(ctx);
 
     ret = event_notifier_init(&ctx->notifier, false);
@@ -603,6 +630,7 @@ AioContext *aio_context_new(Error **errp)
 
 #ifdef CONFIG_LINUX_IO_URING
     ctx->linux_io_uring = NULL;
+    ctx->linux_io_uring_cmd = NULL;
 #endif
 
     ctx->thread_pool = NULL;
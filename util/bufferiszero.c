@@ -23,6 +23,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/bitops.h"
 #include "qemu/bswap.h"
 #include "host/cpuinfo.h"
 
@@ -110,6 +111,39 @@ bool buffer_is_zero_ge256(const void *buf, size_t len)
     return buffer_is_zero_accel(buf, len);
 }
 
+/*
+ * Check @n buffers of @len bytes each, @len >= 256 and @n <= BITS_PER_LONG.
+ * Returns a mask with bit i set if bufs[i] is all zeroes.
+ *
+ * The cachelines that buffer_is_zero_sample3() looks at are prefetched one
+ * buffer ahead, so that rejecting non-zero buffers doesn't stall on memory.
+ */
+unsigned long buffer_is_zero_batch(const void *const *bufs, unsigned n,
+                                   size_t len)
+{
+    unsigned long zero = 0;
+
+    assert(n <= BITS_PER_LONG && len >= 256);
+
+    for (unsigned i = 0; i < n; i++) {
+        const char *buf = bufs[i];
+
+        if (i + 1 < n) {
+            const char *next = bufs[i + 1];
+
+            __builtin_prefetch(next);
+            __builtin_prefetch(next + len / 2);
+            __builtin_prefetch(next + len - 1);
+        }
+
+        if (buffer_is_zero_sample3(buf, len) &&
+            buffer_is_zero_accel(buf, len)) {
+            zero |= 1UL << i;
+        }
+    }
+    return zero;
+}
+
 bool test_buffer_is_zero_next_accel(void)
 {
     if (accel_index != 0) {
@@ -323,9 +323,30 @@ static const FDMonOps fdmon_io_uring_ops = {
 
 bool fdmon_io_uring_setup(AioContext *ctx)
 {
+    const AioIoUringParams *params = &ctx->io_uring_params;
+    struct io_uring_params p = {};
     int ret;
 
-    ret = io_uring_queue_init(FDMON_IO_URING_ENTRIES, &ctx->fdmon_io_uring, 0);
+    /*
+     * IORING_SETUP_IOPOLL only applies to block I/O, IORING_OP_POLL_ADD is
+     * not supported on such rings.
+     */
+    if (params->sqpoll) {
+        p.flags |= IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = params->sqpoll_idle;
+        if (params->sqpoll_cpu >= 0) {
+            p.flags |= IORING_SETUP_SQ_AFF;
+            p.sq_thread_cpu = params->sqpoll_cpu;
+        }
+    }
+
+    ret = io_uring_queue_init_params(FDMON_IO_URING_ENTRIES,
+                                     &ctx->fdmon_io_uring, &p);
+    if (ret != 0 && params->sqpoll) {
+        /* The kernel thread is an optimization, fall back to a plain ring */
+        ret = io_uring_queue_init(FDMON_IO_URING_ENTRIES,
+                                  &ctx->fdmon_io_uring, 0);
+    }
     if (ret != 0) {
         return false;
     }
@@ -359,3 +380,31 @@ void fdmon_io_uring_destroy(AioContext *ctx)
         ctx->fdmon_ops = &fdmon_poll_ops;
     }
 }
+
+/*
+ * Recreate the ring after ctx->io_uring_params has changed.  The AioContext
+ * must not be in use by its home thread.
+ */
+void fdmon_io_uring_reconfigure(AioContext *ctx)
+{
+    AioHandler *node;
+
+    if (ctx->fdmon_ops != &fdmon_io_uring_ops) {
+        return;
+    }
+
+    fdmon_io_uring_destroy(ctx);
+    if (!fdmon_io_uring_setup(ctx)) {
+        /* fdmon_poll_ops walks the handler list itself */
+        return;
+    }
+
+    /* The new ring does not know about the handlers yet */
+    qemu_lockcnt_inc(&ctx->list_lock);
+    QLIST_FOREACH_RCU(node, &ctx->aio_handlers, node) {
+        if (!QLIST_IS_INSERTED(node, node_deleted)) {
+            enqueue(&ctx->submit_list, node, FDMON_IO_URING_ADD);
+        }
+    }
+    qemu_lockcnt_dec(&ctx->list_lock);
+}
@@ -12,6 +12,7 @@
 #include "qemu/osdep.h"
 #include "qemu/hbitmap.h"
 #include "qemu/host-utils.h"
+#include "qemu/cutils.h"
 #include "trace.h"
 #include "crypto/hash.h"
 
@@ -50,8 +51,27 @@
  * extremely sparse, this is also O(m + m/W + m/W^2 + ...), so the amortized
  * cost of advancing from one bit to the next is usually constant (worst case
  * O(logB n) as in the non-amortized complexity).
+ *
+ * Bitmaps created with hbitmap_alloc_compressed() do not store the last
+ * level as a flat array.  Instead, it is split in chunks of HB_CHUNK_WORDS
+ * unsigned longs, and each chunk is either absent (all bits clear), a
+ * pointer to a shared chunk with all bits set, or a regular dense chunk.
+ * This makes very sparse or very dense bitmaps for large images cheap in
+ * memory, and it lets merges and hashing skip uniform chunks.  The upper
+ * levels are always stored in full, so that iteration is not affected.
  */
 
+#define HB_CHUNK_SHIFT  9
+#define HB_CHUNK_WORDS  (1UL << HB_CHUNK_SHIFT)
+#define HB_CHUNK_MASK   (HB_CHUNK_WORDS - 1)
+#define HB_CHUNK_BYTES  (HB_CHUNK_WORDS * sizeof(unsigned long))
+
+static const unsigned long hb_zero_chunk[HB_CHUNK_WORDS];
+static const unsigned long hb_ones_chunk[HB_CHUNK_WORDS] = {
+    [0 ... HB_CHUNK_WORDS - 1] = ~0UL
+};
+#define HB_CHUNK_ONES   ((unsigned long *)hb_ones_chunk)
+
 struct HBitmap {
     /*
      * Size of the bitmap, as requested in hbitmap_alloc or in hbitmap_truncate.
@@ -99,8 +119,174 @@ struct HBitmap {
 
     /* The length of each levels[] array. */
     uint64_t sizes[HBITMAP_LEVELS];
+
+    /* For compressed bitmaps, the last level is stored here instead of
+     * in levels[HBITMAP_LEVELS - 1], which is NULL.  Each element is
+     * NULL, HB_CHUNK_ONES or a dense chunk of HB_CHUNK_WORDS elements.
+     */
+    unsigned long **chunks;
+    uint64_t nr_chunks;
 };
 
+/* Read an element of the bitmap, for any level.  */
+static inline unsigned long hb_word(const HBitmap *hb, int level, size_t pos)
+{
+    const unsigned long *chunk;
+
+    if (level < HBITMAP_LEVELS - 1 || !hb->chunks) {
+        return hb->levels[level][pos];
+    }
+    chunk = hb->chunks[pos >> HB_CHUNK_SHIFT];
+    return chunk ? chunk[pos & HB_CHUNK_MASK] : 0;
+}
+
+/* Return @hb's chunk @c for reading; NULL means all-zero.  For
+ * uncompressed bitmaps, the last chunk may be shorter than HB_CHUNK_WORDS.
+ */
+static const unsigned long *hb_chunk_ro(const HBitmap *hb, size_t c)
+{
+    if (hb->chunks) {
+        return hb->chunks[c];
+    }
+    return &hb->levels[HBITMAP_LEVELS - 1][c << HB_CHUNK_SHIFT];
+}
+
+/* Number of valid elements in chunk @c of the last level.  */
+static size_t hb_chunk_len(const HBitmap *hb, size_t c)
+{
+    return MIN(HB_CHUNK_WORDS,
+               hb->sizes[HBITMAP_LEVELS - 1] - ((uint64_t)c << HB_CHUNK_SHIFT));
+}
+
+/* Whether chunk @c may be represented by HB_CHUNK_ONES, i.e. it does not
+ * extend beyond the end of the bitmap.
+ */
+static bool hb_chunk_can_be_full(const HBitmap *hb, size_t c)
+{
+    return ((uint64_t)(c + 1) << (HB_CHUNK_SHIFT + BITS_PER_LEVEL)) <= hb->size;
+}
+
+static void hb_chunk_free(unsigned long *chunk)
+{
+    if (chunk != HB_CHUNK_ONES) {
+        g_free(chunk);
+    }
+}
+
+/* Make chunk @c a dense chunk and return it.  */
+static unsigned long *hb_chunk_get_writable(HBitmap *hb, size_t c)
+{
+    unsigned long *chunk = hb->chunks[c];
+
+    if (!chunk) {
+        chunk = g_new0(unsigned long, HB_CHUNK_WORDS);
+    } else if (chunk == HB_CHUNK_ONES) {
+        chunk = g_memdup2(hb_ones_chunk, HB_CHUNK_BYTES);
+    } else {
+        return chunk;
+    }
+    hb->chunks[c] = chunk;
+    return chunk;
+}
+
+/* Go back to the shared representation if chunk @c is uniform.  */
+static void hb_chunk_compact(HBitmap *hb, size_t c)
+{
+    unsigned long *chunk = hb->chunks[c];
+
+    if (!chunk || chunk == HB_CHUNK_ONES) {
+        return;
+    }
+    if (buffer_is_zero(chunk, HB_CHUNK_BYTES)) {
+        g_free(chunk);
+        hb->chunks[c] = NULL;
+    } else if (hb_chunk_can_be_full(hb, c) &&
+               !memcmp(chunk, hb_ones_chunk, HB_CHUNK_BYTES)) {
+        g_free(chunk);
+        hb->chunks[c] = HB_CHUNK_ONES;
+    }
+}
+
+/* Like hb_chunk_compact, but cheaply skip the check if the element at @pos,
+ * which was just modified, shows that the chunk cannot be uniform.
+ */
+static void hb_chunk_compact_at(HBitmap *hb, size_t pos)
+{
+    unsigned long *chunk = hb->chunks[pos >> HB_CHUNK_SHIFT];
+    unsigned long word;
+
+    if (!chunk || chunk == HB_CHUNK_ONES) {
+        return;
+    }
+    word = chunk[pos & HB_CHUNK_MASK];
+    if (word == 0 || word == ~0UL) {
+        hb_chunk_compact(hb, pos >> HB_CHUNK_SHIFT);
+    }
+}
+
+/* Return a pointer to an element of the bitmap, for any level.  For
+ * compressed bitmaps this may have to allocate a dense chunk.
+ */
+static unsigned long *hb_elem(HBitmap *hb, int level, size_t pos)
+{
+    unsigned long *chunk;
+
+    if (level < HBITMAP_LEVELS - 1 || !hb->chunks) {
+        return &hb->levels[level][pos];
+    }
+    chunk = hb_chunk_get_writable(hb, pos >> HB_CHUNK_SHIFT);
+    return &chunk[pos & HB_CHUNK_MASK];
+}
+
+/* Set elements [@first, @end) of the last level of a compressed bitmap to
+ * all ones or all zeroes.  Returns true if some element was zero (when
+ * setting) or nonzero (when clearing).
+ */
+static bool hb_fill_words(HBitmap *hb, size_t first, size_t end, bool ones)
+{
+    unsigned long *fill = ones ? HB_CHUNK_ONES : NULL;
+    bool changed = false;
+    size_t pos = first;
+
+    while (pos < end) {
+        size_t c = pos >> HB_CHUNK_SHIFT;
+        size_t chunk_start = (size_t)c << HB_CHUNK_SHIFT;
+        size_t chunk_end = MIN(end, chunk_start + HB_CHUNK_WORDS);
+        unsigned long *chunk = hb->chunks[c];
+        size_t j;
+
+        if (chunk == fill) {
+            pos = chunk_end;
+            continue;
+        }
+
+        if (pos == chunk_start && chunk_end == chunk_start + HB_CHUNK_WORDS &&
+            (!ones || hb_chunk_can_be_full(hb, c))) {
+            /* The whole chunk is covered, just drop it.  */
+            if (!chunk || chunk == HB_CHUNK_ONES) {
+                changed = true;
+            } else {
+                for (j = 0; j < HB_CHUNK_WORDS && !changed; j++) {
+                    changed = ones ? chunk[j] == 0 : chunk[j] != 0;
+                }
+                g_free(chunk);
+            }
+            hb->chunks[c] = fill;
+            pos = chunk_end;
+            continue;
+        }
+
+        chunk = hb_chunk_get_writable(hb, c);
+        for (; pos < chunk_end; pos++) {
+            unsigned long *elem = &chunk[pos - chunk_start];
+            changed |= ones ? *elem == 0 : *elem != 0;
+            *elem = ones ? ~0UL : 0;
+        }
+        hb_chunk_compact(hb, c);
+    }
+    return changed;
+}
+
 /* Advance hbi to the next nonzero word and return it.  hbi->pos
  * is updated.  Returns zero if we reach the end of the bitmap.
  */
@@ -114,7 +300,7 @@ static unsigned long hbitmap_iter_skip_words(HBitmapIter *hbi)
     do {
         i--;
         pos >>= BITS_PER_LEVEL;
-        cur = hbi->cur[i] & hb->levels[i][pos];
+        cur = hbi->cur[i] & hb_word(hb, i, pos);
     } while (cur == 0);
 
     /* Check for end of iteration.  We always use fewer than BITS_PER_LONG
@@ -136,7 +322,7 @@ static unsigned long hbitmap_iter_skip_words(HBitmapIter *hbi)
         hbi->cur[i] = cur & (cur - 1);
 
         /* Set up next level for iteration.  */
-        cur = hb->levels[i + 1][pos];
+        cur = hb_word(hb, i + 1, pos);
     }
 
     hbi->pos = pos;
@@ -149,7 +335,7 @@ static unsigned long hbitmap_iter_skip_words(HBitmapIter *hbi)
 int64_t hbitmap_iter_next(HBitmapIter *hbi)
 {
     unsigned long cur = hbi->cur[HBITMAP_LEVELS - 1] &
-            hbi->hb->levels[HBITMAP_LEVELS - 1][hbi->pos];
+            hb_word(hbi->hb, HBITMAP_LEVELS - 1, hbi->pos);
     int64_t item;
 
     if (cur == 0) {
@@ -182,7 +368,7 @@ void hbitmap_iter_init(HBitmapIter *hbi, const HBitmap *hb, uint64_t first)
         pos >>= BITS_PER_LEVEL;
 
         /* Drop bits representing items before first.  */
-        hbi->cur[i] = hb->levels[i][pos] & ~((1UL << bit) - 1);
+        hbi->cur[i] = hb_word(hb, i, pos) & ~((1UL << bit) - 1);
 
         /* We have already added level i+1, so the lowest set bit has
          * been processed.  Clear it.
@@ -220,8 +406,7 @@ int64_t hbitmap_next_dirty(const HBitmap *hb, int64_t start, int64_t count)
 int64_t hbitmap_next_zero(const HBitmap *hb, int64_t start, int64_t count)
 {
     size_t pos = (start >> hb->granularity) >> BITS_PER_LEVEL;
-    unsigned long *last_lev = hb->levels[HBITMAP_LEVELS - 1];
-    unsigned long cur = last_lev[pos];
+    unsigned long cur = hb_word(hb, HBITMAP_LEVELS - 1, pos);
     unsigned start_bit_offset;
     uint64_t end_bit, sz;
     int64_t res;
@@ -247,13 +432,14 @@ int64_t hbitmap_next_zero(const HBitmap *hb, int64_t start, int64_t count)
     if (cur == (unsigned long)-1) {
         do {
             pos++;
-        } while (pos < sz && last_lev[pos] == (unsigned long)-1);
+        } while (pos < sz &&
+                 hb_word(hb, HBITMAP_LEVELS - 1, pos) == (unsigned long)-1);
 
         if (pos >= sz) {
             return -1;
         }
 
-        cur = last_lev[pos];
+        cur = hb_word(hb, HBITMAP_LEVELS - 1, pos);
     }
 
     res = (pos << BITS_PER_LEVEL) + ctol(cur);
@@ -426,6 +612,25 @@ static inline bool hb_set_elem(unsigned long *elem, uint64_t start, uint64_t las
     return old != *elem;
 }
 
+/* hb_set_elem for any level; avoids unsharing full chunks of compressed
+ * bitmaps.
+ */
+static bool hb_set_word(HBitmap *hb, int level, size_t pos,
+                        uint64_t start, uint64_t last)
+{
+    bool changed;
+
+    if (level < HBITMAP_LEVELS - 1 || !hb->chunks) {
+        return hb_set_elem(&hb->levels[level][pos], start, last);
+    }
+    if (hb->chunks[pos >> HB_CHUNK_SHIFT] == HB_CHUNK_ONES) {
+        return false;
+    }
+    changed = hb_set_elem(hb_elem(hb, level, pos), start, last);
+    hb_chunk_compact_at(hb, pos);
+    return changed;
+}
+
 /* The recursive workhorse (the depth is limited to HBITMAP_LEVELS)...
  * Returns true if at least one bit is changed. */
 static bool hb_set_between(HBitmap *hb, int level, uint64_t start,
@@ -439,18 +644,24 @@ static bool hb_set_between(HBitmap *hb, int level, uint64_t start,
     i = pos;
     if (i < lastpos) {
         uint64_t next = (start | (BITS_PER_LONG - 1)) + 1;
-        changed |= hb_set_elem(&hb->levels[level][i], start, next - 1);
-        for (;;) {
-            start = next;
-            next += BITS_PER_LONG;
-            if (++i == lastpos) {
-                break;
+        changed |= hb_set_word(hb, level, i, start, next - 1);
+        if (level == HBITMAP_LEVELS - 1 && hb->chunks) {
+            changed |= hb_fill_words(hb, i + 1, lastpos, true);
+            i = lastpos;
+            start = (uint64_t)lastpos << BITS_PER_LEVEL;
+        } else {
+            for (;;) {
+                start = next;
+                next += BITS_PER_LONG;
+                if (++i == lastpos) {
+                    break;
+                }
+                changed |= (hb->levels[level][i] == 0);
+                hb->levels[level][i] = ~0UL;
             }
-            changed |= (hb->levels[level][i] == 0);
-            hb->levels[level][i] = ~0UL;
         }
     }
-    changed |= hb_set_elem(&hb->levels[level][i], start, last);
+    changed |= hb_set_word(hb, level, i, start, last);
 
     /* If there was any change in this layer, we may have to update
      * the one above.
@@ -504,6 +715,25 @@ static inline bool hb_reset_elem(unsigned long *elem, uint64_t start, uint64_t l
     return blanked;
 }
 
+/* hb_reset_elem for any level; avoids allocating empty chunks of compressed
+ * bitmaps.
+ */
+static bool hb_reset_word(HBitmap *hb, int level, size_t pos,
+                          uint64_t start, uint64_t last)
+{
+    bool blanked;
+
+    if (level < HBITMAP_LEVELS - 1 || !hb->chunks) {
+        return hb_reset_elem(&hb->levels[level][pos], start, last);
+    }
+    if (!hb->chunks[pos >> HB_CHUNK_SHIFT]) {
+        return false;
+    }
+    blanked = hb_reset_elem(hb_elem(hb, level, pos), start, last);
+    hb_chunk_compact_at(hb, pos);
+    return blanked;
+}
+
 /* The recursive workhorse (the depth is limited to HBITMAP_LEVELS)...
  * Returns true if at least one bit is changed. */
 static bool hb_reset_between(HBitmap *hb, int level, uint64_t start,
@@ -523,25 +753,31 @@ static bool hb_reset_between(HBitmap *hb, int level, uint64_t start,
          * unless the lower-level word became entirely zero.  So, remove pos
          * from the upper-level range if bits remain set.
          */
-        if (hb_reset_elem(&hb->levels[level][i], start, next - 1)) {
+        if (hb_reset_word(hb, level, i, start, next - 1)) {
             changed = true;
         } else {
             pos++;
         }
 
-        for (;;) {
-            start = next;
-            next += BITS_PER_LONG;
-            if (++i == lastpos) {
-                break;
+        if (level == HBITMAP_LEVELS - 1 && hb->chunks) {
+            changed |= hb_fill_words(hb, i + 1, lastpos, false);
+            i = lastpos;
+            start = (uint64_t)lastpos << BITS_PER_LEVEL;
+        } else {
+            for (;;) {
+                start = next;
+                next += BITS_PER_LONG;
+                if (++i == lastpos) {
+                    break;
+                }
+                changed |= (hb->levels[level][i] != 0);
+                hb->levels[level][i] = 0UL;
             }
-            changed |= (hb->levels[level][i] != 0);
-            hb->levels[level][i] = 0UL;
         }
     }
 
     /* Same as above, this time for lastpos.  */
-    if (hb_reset_elem(&hb->levels[level][i], start, last)) {
+    if (hb_reset_word(hb, level, i, start, last)) {
         changed = true;
     } else {
         lastpos--;
@@ -589,10 +825,17 @@ void hbitmap_reset_all(HBitmap *hb)
 
     /* Same as hbitmap_alloc() except for memset() instead of malloc() */
     for (i = HBITMAP_LEVELS; --i >= 1; ) {
+        if (i == HBITMAP_LEVELS - 1 && hb->chunks) {
+            hb_fill_words(hb, 0, hb->sizes[i], false);
+            continue;
+        }
         memset(hb->levels[i], 0, hb->sizes[i] * sizeof(unsigned long));
     }
 
     hb->levels[0][0] = 1UL << (BITS_PER_LONG - 1);
+    if (hb->meta && hb->count) {
+        hbitmap_set(hb->meta, 0, hb->orig_size);
+    }
     hb->count = 0;
 }
 
@@ -621,7 +864,7 @@ bool hbitmap_get(const HBitmap *hb, uint64_t item)
     unsigned long bit = 1UL << (pos & (BITS_PER_LONG - 1));
     assert(pos < hb->size);
 
-    return (hb->levels[HBITMAP_LEVELS - 1][pos >> BITS_PER_LEVEL] & bit) != 0;
+    return (hb_word(hb, HBITMAP_LEVELS - 1, pos >> BITS_PER_LEVEL) & bit) != 0;
 }
 
 uint64_t hbitmap_serialization_align(const HBitmap *hb)
@@ -638,7 +881,7 @@ uint64_t hbitmap_serialization_align(const HBitmap *hb)
  */
 static void serialization_chunk(const HBitmap *hb,
                                 uint64_t start, uint64_t count,
-                                unsigned long **first_el, uint64_t *el_count)
+                                uint64_t *first_el, uint64_t *el_count)
 {
     uint64_t last = start + count - 1;
     uint64_t gran = hbitmap_serialization_align(hb);
@@ -652,7 +895,7 @@ static void serialization_chunk(const HBitmap *hb,
     start = (start >> hb->granularity) >> BITS_PER_LEVEL;
     last = (last >> hb->granularity) >> BITS_PER_LEVEL;
 
-    *first_el = &hb->levels[HBITMAP_LEVELS - 1][start];
+    *first_el = start;
     *el_count = last - start + 1;
 }
 
@@ -660,7 +903,7 @@ uint64_t hbitmap_serialization_size(const HBitmap *hb,
                                     uint64_t start, uint64_t count)
 {
     uint64_t el_count;
-    unsigned long *cur;
+    uint64_t cur;
 
     if (!count) {
         return 0;
@@ -674,7 +917,7 @@ void hbitmap_serialize_part(const HBitmap *hb, uint8_t *buf,
                             uint64_t start, uint64_t count)
 {
     uint64_t el_count;
-    unsigned long *cur, *end;
+    uint64_t cur, end;
 
     if (!count) {
         return;
@@ -683,8 +926,9 @@ void hbitmap_serialize_part(const HBitmap *hb, uint8_t *buf,
     end = cur + el_count;
 
     while (cur != end) {
-        unsigned long el =
-            (BITS_PER_LONG == 32 ? cpu_to_le32(*cur) : cpu_to_le64(*cur));
+        unsigned long el = hb_word(hb, HBITMAP_LEVELS - 1, cur);
+
+        el = (BITS_PER_LONG == 32 ? cpu_to_le32(el) : cpu_to_le64(el));
 
         memcpy(buf, &el, sizeof(el));
         buf += sizeof(el);
@@ -697,7 +941,7 @@ void hbitmap_deserialize_part(HBitmap *hb, uint8_t *buf,
                               bool finish)
 {
     uint64_t el_count;
-    unsigned long *cur, *end;
+    uint64_t cur, end;
 
     if (!count) {
         return;
@@ -706,12 +950,19 @@ void hbitmap_deserialize_part(HBitmap *hb, uint8_t *buf,
     end = cur + el_count;
 
     while (cur != end) {
-        memcpy(cur, buf, sizeof(*cur));
+        unsigned long el;
+
+        memcpy(&el, buf, sizeof(el));
 
         if (BITS_PER_LONG == 32) {
-            le32_to_cpus((uint32_t *)cur);
+            le32_to_cpus((uint32_t *)&el);
         } else {
-            le64_to_cpus((uint64_t *)cur);
+            le64_to_cpus((uint64_t *)&el);
+        }
+
+        /* Compressed bitmaps are compacted in hbitmap_deserialize_finish */
+        if (el || hb_word(hb, HBITMAP_LEVELS - 1, cur)) {
+            *hb_elem(hb, HBITMAP_LEVELS - 1, cur) = el;
         }
 
         buf += sizeof(unsigned long);
@@ -726,14 +977,19 @@ void hbitmap_deserialize_zeroes(HBitmap *hb, uint64_t start, uint64_t count,
                                 bool finish)
 {
     uint64_t el_count;
-    unsigned long *first;
+    uint64_t first;
 
     if (!count) {
         return;
     }
     serialization_chunk(hb, start, count, &first, &el_count);
 
-    memset(first, 0, el_count * sizeof(unsigned long));
+    if (hb->chunks) {
+        hb_fill_words(hb, first, first + el_count, false);
+    } else {
+        memset(&hb->levels[HBITMAP_LEVELS - 1][first], 0,
+               el_count * sizeof(unsigned long));
+    }
     if (finish) {
         hbitmap_deserialize_finish(hb);
     }
@@ -743,14 +999,19 @@ void hbitmap_deserialize_ones(HBitmap *hb, uint64_t start, uint64_t count,
                               bool finish)
 {
     uint64_t el_count;
-    unsigned long *first;
+    uint64_t first;
 
     if (!count) {
         return;
     }
     serialization_chunk(hb, start, count, &first, &el_count);
 
-    memset(first, 0xff, el_count * sizeof(unsigned long));
+    if (hb->chunks) {
+        hb_fill_words(hb, first, first + el_count, true);
+    } else {
+        memset(&hb->levels[HBITMAP_LEVELS - 1][first], 0xff,
+               el_count * sizeof(unsigned long));
+    }
     if (finish) {
         hbitmap_deserialize_finish(hb);
     }
@@ -761,6 +1022,10 @@ void hbitmap_deserialize_finish(HBitmap *bitmap)
     int64_t i, size, prev_size;
     int lev;
 
+    for (i = 0; i < bitmap->nr_chunks; i++) {
+        hb_chunk_compact(bitmap, i);
+    }
+
     /* restore levels starting from penultimate to zero level, assuming
      * that the last level is ok */
     size = MAX((bitmap->size + BITS_PER_LONG - 1) >> BITS_PER_LEVEL, 1);
@@ -770,7 +1035,7 @@ void hbitmap_deserialize_finish(HBitmap *bitmap)
         memset(bitmap->levels[lev], 0, size * sizeof(unsigned long));
 
         for (i = 0; i < prev_size; ++i) {
-            if (bitmap->levels[lev + 1][i]) {
+            if (hb_word(bitmap, lev + 1, i)) {
                 bitmap->levels[lev][i >> BITS_PER_LEVEL] |=
                     1UL << (i & (BITS_PER_LONG - 1));
             }
@@ -779,19 +1044,29 @@ void hbitmap_deserialize_finish(HBitmap *bitmap)
 
     bitmap->levels[0][0] |= 1UL << (BITS_PER_LONG - 1);
     bitmap->count = hb_count_between(bitmap, 0, bitmap->size - 1);
+
+    /* The deserialized data was not tracked, so mark it all as changed */
+    if (bitmap->meta) {
+        hbitmap_set(bitmap->meta, 0, bitmap->orig_size);
+    }
 }
 
 void hbitmap_free(HBitmap *hb)
 {
     unsigned i;
+    uint64_t c;
     assert(!hb->meta);
     for (i = HBITMAP_LEVELS; i-- > 0; ) {
         g_free(hb->levels[i]);
     }
+    for (c = 0; c < hb->nr_chunks; c++) {
+        hb_chunk_free(hb->chunks[c]);
+    }
+    g_free(hb->chunks);
     g_free(hb);
 }
 
-HBitmap *hbitmap_alloc(uint64_t size, int granularity)
+static HBitmap *hb_alloc(uint64_t size, int granularity, bool compressed)
 {
     HBitmap *hb = g_new0(struct HBitmap, 1);
     unsigned i;
@@ -808,6 +1083,11 @@ HBitmap *hbitmap_alloc(uint64_t size, int granularity)
     for (i = HBITMAP_LEVELS; i-- > 0; ) {
         size = MAX((size + BITS_PER_LONG - 1) >> BITS_PER_LEVEL, 1);
         hb->sizes[i] = size;
+        if (i == HBITMAP_LEVELS - 1 && compressed) {
+            hb->nr_chunks = DIV_ROUND_UP(size, HB_CHUNK_WORDS);
+            hb->chunks = g_new0(unsigned long *, hb->nr_chunks);
+            continue;
+        }
         hb->levels[i] = g_new0(unsigned long, size);
     }
 
@@ -820,6 +1100,94 @@ HBitmap *hbitmap_alloc(uint64_t size, int granularity)
     return hb;
 }
 
+HBitmap *hbitmap_alloc(uint64_t size, int granularity)
+{
+    return hb_alloc(size, granularity, false);
+}
+
+HBitmap *hbitmap_alloc_compressed(uint64_t size, int granularity)
+{
+    return hb_alloc(size, granularity, true);
+}
+
+bool hbitmap_is_compressed(const HBitmap *hb)
+{
+    return hb->chunks != NULL;
+}
+
+void hbitmap_set_compressed(HBitmap *hb, bool compressed)
+{
+    uint64_t n = hb->sizes[HBITMAP_LEVELS - 1];
+    unsigned long *last;
+    uint64_t c;
+
+    if (compressed == hbitmap_is_compressed(hb)) {
+        return;
+    }
+
+    if (compressed) {
+        last = hb->levels[HBITMAP_LEVELS - 1];
+        hb->nr_chunks = DIV_ROUND_UP(n, HB_CHUNK_WORDS);
+        hb->chunks = g_new0(unsigned long *, hb->nr_chunks);
+        for (c = 0; c < hb->nr_chunks; c++) {
+            size_t len = hb_chunk_len(hb, c) * sizeof(unsigned long);
+            const unsigned long *src = &last[c << HB_CHUNK_SHIFT];
+
+            if (!buffer_is_zero(src, len)) {
+                hb->chunks[c] = g_new0(unsigned long, HB_CHUNK_WORDS);
+                memcpy(hb->chunks[c], src, len);
+                hb_chunk_compact(hb, c);
+            }
+        }
+        g_free(last);
+        hb->levels[HBITMAP_LEVELS - 1] = NULL;
+    } else {
+        last = g_new(unsigned long, n);
+        for (c = 0; c < hb->nr_chunks; c++) {
+            size_t len = hb_chunk_len(hb, c) * sizeof(unsigned long);
+            const unsigned long *src = hb->chunks[c];
+
+            memcpy(&last[c << HB_CHUNK_SHIFT], src ?: hb_zero_chunk, len);
+            hb_chunk_free(hb->chunks[c]);
+        }
+        g_free(hb->chunks);
+        hb->chunks = NULL;
+        hb->nr_chunks = 0;
+        hb->levels[HBITMAP_LEVELS - 1] = last;
+    }
+}
+
+HBitmap *hbitmap_create_meta(HBitmap *hb, int chunk_size)
+{
+    assert(chunk_size > 0 && is_power_of_2(chunk_size));
+    assert(!hb->meta);
+    hb->meta = hbitmap_alloc(hb->size << hb->granularity,
+                             hb->granularity + ctz32(chunk_size));
+    return hb->meta;
+}
+
+void hbitmap_free_meta(HBitmap *hb)
+{
+    assert(hb->meta);
+    hbitmap_free(hb->meta);
+    hb->meta = NULL;
+}
+
+static void hb_truncate_chunks(HBitmap *hb, uint64_t words)
+{
+    uint64_t nr_chunks = DIV_ROUND_UP(words, HB_CHUNK_WORDS);
+    uint64_t c;
+
+    for (c = nr_chunks; c < hb->nr_chunks; c++) {
+        hb_chunk_free(hb->chunks[c]);
+    }
+    hb->chunks = g_renew(unsigned long *, hb->chunks, nr_chunks);
+    for (c = hb->nr_chunks; c < nr_chunks; c++) {
+        hb->chunks[c] = NULL;
+    }
+    hb->nr_chunks = nr_chunks;
+}
+
 void hbitmap_truncate(HBitmap *hb, uint64_t size)
 {
     bool shrink;
@@ -862,6 +1230,10 @@ void hbitmap_truncate(HBitmap *hb, uint64_t size)
         }
         old = hb->sizes[i];
         hb->sizes[i] = size;
+        if (i == HBITMAP_LEVELS - 1 && hb->chunks) {
+            hb_truncate_chunks(hb, size);
+            continue;
+        }
         hb->levels[i] = g_renew(unsigned long, hb->levels[i], size);
         if (!shrink) {
             memset(&hb->levels[i][old], 0x00,
@@ -892,6 +1264,52 @@ static void hbitmap_sparse_merge(HBitmap *dst, const HBitmap *src)
     }
 }
 
+/* Merge the last level, for bitmaps of the same size and granularity.
+ * Uniform chunks of compressed bitmaps are handled without looking at
+ * their contents.
+ */
+static void hb_merge_last_level(const HBitmap *a, const HBitmap *b,
+                                HBitmap *result)
+{
+    uint64_t nr_chunks = DIV_ROUND_UP(a->sizes[HBITMAP_LEVELS - 1],
+                                      HB_CHUNK_WORDS);
+    uint64_t c;
+    size_t j;
+
+    for (c = 0; c < nr_chunks; c++) {
+        const unsigned long *ca = hb_chunk_ro(a, c);
+        const unsigned long *cb = hb_chunk_ro(b, c);
+        size_t len = hb_chunk_len(result, c);
+        unsigned long *r;
+
+        if (result->chunks) {
+            if (ca == HB_CHUNK_ONES || cb == HB_CHUNK_ONES) {
+                hb_fill_words(result, c << HB_CHUNK_SHIFT,
+                              (c << HB_CHUNK_SHIFT) + len, true);
+                continue;
+            }
+            if (!ca && !cb) {
+                hb_fill_words(result, c << HB_CHUNK_SHIFT,
+                              (c << HB_CHUNK_SHIFT) + len, false);
+                continue;
+            }
+            r = hb_chunk_get_writable(result, c);
+        } else {
+            r = &result->levels[HBITMAP_LEVELS - 1][c << HB_CHUNK_SHIFT];
+        }
+
+        ca = ca ?: hb_zero_chunk;
+        cb = cb ?: hb_zero_chunk;
+        for (j = 0; j < len; j++) {
+            r[j] = ca[j] | cb[j];
+        }
+
+        if (result->chunks) {
+            hb_chunk_compact(result, c);
+        }
+    }
+}
+
 /**
  * Given HBitmaps A and B, let R := A (BITOR) B.
  * Bitmaps A and B will not be modified,
@@ -934,7 +1352,16 @@ void hbitmap_merge(const HBitmap *a, const HBitmap *b, HBitmap *result)
      * by using hbitmap_iter_next, but this is suboptimal for dense maps.
      */
     assert(a->size == b->size);
-    for (i = HBITMAP_LEVELS - 1; i >= 0; i--) {
+    if (a->chunks || b->chunks || result->chunks) {
+        hb_merge_last_level(a, b, result);
+    } else {
+        for (j = 0; j < a->sizes[HBITMAP_LEVELS - 1]; j++) {
+            result->levels[HBITMAP_LEVELS - 1][j] =
+                a->levels[HBITMAP_LEVELS - 1][j] |
+                b->levels[HBITMAP_LEVELS - 1][j];
+        }
+    }
+    for (i = HBITMAP_LEVELS - 2; i >= 0; i--) {
         for (j = 0; j < a->sizes[i]; j++) {
             result->levels[i][j] = a->levels[i][j] | b->levels[i][j];
         }
@@ -942,6 +1369,10 @@ void hbitmap_merge(const HBitmap *a, const HBitmap *b, HBitmap *result)
 
     /* Recompute the dirty count */
     result->count = hb_count_between(result, 0, result->size - 1);
+
+    if (result->meta) {
+        hbitmap_set(result->meta, 0, result->orig_size);
+    }
 }
 
 char *hbitmap_sha256(const HBitmap *bitmap, Error **errp)
@@ -949,7 +1380,23 @@ char *hbitmap_sha256(const HBitmap *bitmap, Error **errp)
     size_t size = bitmap->sizes[HBITMAP_LEVELS - 1] * sizeof(unsigned long);
     char *data = (char *)bitmap->levels[HBITMAP_LEVELS - 1];
     char *hash = NULL;
-    qcrypto_hash_digest(QCRYPTO_HASH_ALGO_SHA256, data, size, &hash, errp);
+    struct iovec *iov;
+    uint64_t c;
+
+    if (!bitmap->chunks) {
+        qcrypto_hash_digest(QCRYPTO_HASH_ALGO_SHA256, data, size, &hash, errp);
+        return hash;
+    }
+
+    /* Hash the same bytes as the flat representation would */
+    iov = g_new(struct iovec, bitmap->nr_chunks);
+    for (c = 0; c < bitmap->nr_chunks; c++) {
+        iov[c].iov_base = (void *)(bitmap->chunks[c] ?: hb_zero_chunk);
+        iov[c].iov_len = hb_chunk_len(bitmap, c) * sizeof(unsigned long);
+    }
+    qcrypto_hash_digestv(QCRYPTO_HASH_ALGO_SHA256, iov, bitmap->nr_chunks,
+                         &hash, errp);
+    g_free(iov);
 
     return hash;
 }
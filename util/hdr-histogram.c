@@ -0,0 +1,92 @@
+/*
+ * Log-linear histograms for latency percentiles
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "qemu/hdr-histogram.h"
+
+#include <math.h>
+
+static unsigned int hdr_histogram_index(uint64_t value)
+{
+    unsigned int shift;
+
+    if (value < HDR_HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+
+    /* value >> shift is in [SUB_BUCKETS, 2 * SUB_BUCKETS) */
+    shift = 63 - clz64(value) - HDR_HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HDR_HISTOGRAM_SUB_BUCKETS +
+           (value >> shift) - HDR_HISTOGRAM_SUB_BUCKETS;
+}
+
+/* Largest value that is counted in bucket @index */
+static uint64_t hdr_histogram_bucket_max(unsigned int index)
+{
+    unsigned int shift;
+    uint64_t low;
+
+    if (index < HDR_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    shift = index / HDR_HISTOGRAM_SUB_BUCKETS - 1;
+    low = (uint64_t)(HDR_HISTOGRAM_SUB_BUCKETS +
+                     index % HDR_HISTOGRAM_SUB_BUCKETS) << shift;
+    return low + ((1ULL << shift) - 1);
+}
+
+void hdr_histogram_init(HdrHistogram *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void hdr_histogram_record(HdrHistogram *h, uint64_t value)
+{
+    h->buckets[hdr_histogram_index(value)]++;
+    h->count++;
+    h->sum += value;
+    h->min = MIN(h->min, value);
+    h->max = MAX(h->max, value);
+}
+
+void hdr_histogram_merge(HdrHistogram *dst, const HdrHistogram *src)
+{
+    unsigned int i;
+
+    for (i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    dst->min = MIN(dst->min, src->min);
+    dst->max = MAX(dst->max, src->max);
+}
+
+uint64_t hdr_histogram_quantile(const HdrHistogram *h, double q)
+{
+    uint64_t rank, seen = 0;
+    unsigned int i;
+
+    if (!h->count) {
+        return 0;
+    }
+
+    q = MAX(0.0, MIN(q, 1.0));
+    rank = MAX((uint64_t)ceil(q * h->count), 1);
+
+    for (i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            return MAX(MIN(hdr_histogram_bucket_max(i), h->max), h->min);
+        }
+    }
+
+    return h->max;
+}
@@ -27,6 +27,14 @@ size_t iov_from_buf_full(const struct iovec *iov, unsigned int iov_cnt,
 {
     size_t done;
     unsigned int i;
+
+    /* Most copies are headers that sit in the first element */
+    if (iov_cnt && offset <= iov[0].iov_len &&
+        bytes <= iov[0].iov_len - offset) {
+        memcpy(iov[0].iov_base + offset, buf, bytes);
+        return bytes;
+    }
+
     for (i = 0, done = 0; (offset || done < bytes) && i < iov_cnt; i++) {
         if (offset < iov[i].iov_len) {
             size_t len = MIN(iov[i].iov_len - offset, bytes - done);
@@ -45,6 +53,14 @@ size_t iov_to_buf_full(const struct iovec *iov, const unsigned int iov_cnt,
 {
     size_t done;
     unsigned int i;
+
+    /* Most copies are headers that sit in the first element */
+    if (iov_cnt && offset <= iov[0].iov_len &&
+        bytes <= iov[0].iov_len - offset) {
+        memcpy(buf, iov[0].iov_base + offset, bytes);
+        return bytes;
+    }
+
     for (i = 0, done = 0; (offset || done < bytes) && i < iov_cnt; i++) {
         if (offset < iov[i].iov_len) {
             size_t len = MIN(iov[i].iov_len - offset, bytes - done);
@@ -287,6 +303,14 @@ void qemu_iovec_init(QEMUIOVector *qiov, int alloc_hint)
     qiov->size = 0;
 }
 
+void qemu_iovec_init_inline(QEMUIOVectorInline *qiov)
+{
+    qiov->qiov.iov = qiov->inline_iov;
+    qiov->qiov.niov = 0;
+    qiov->qiov.nalloc = QEMU_IOVEC_NALLOC_INLINE;
+    qiov->qiov.size = 0;
+}
+
 void qemu_iovec_init_external(QEMUIOVector *qiov, struct iovec *iov, int niov)
 {
     int i;
@@ -303,7 +327,16 @@ void qemu_iovec_add(QEMUIOVector *qiov, void *base, size_t len)
 {
     assert(qiov->nalloc != -1);
 
-    if (qiov->niov == qiov->nalloc) {
+    if (qiov->nalloc == QEMU_IOVEC_NALLOC_INLINE) {
+        if (qiov->niov == QEMU_IOVEC_INLINE_NIOV) {
+            /* Inline storage is full, move the entries to the heap */
+            struct iovec *inline_iov = qiov->iov;
+
+            qiov->nalloc = 2 * QEMU_IOVEC_INLINE_NIOV + 1;
+            qiov->iov = g_new(struct iovec, qiov->nalloc);
+            memcpy(qiov->iov, inline_iov, qiov->niov * sizeof(struct iovec));
+        }
+    } else if (qiov->niov == qiov->nalloc) {
         qiov->nalloc = 2 * qiov->nalloc + 1;
         qiov->iov = g_renew(struct iovec, qiov->iov, qiov->nalloc);
     }
@@ -470,9 +503,40 @@ void qemu_iovec_init_slice(QEMUIOVector *qiov, QEMUIOVector *source,
     }
 }
 
+/*
+ * Like qemu_iovec_init_slice(), but slices of up to QEMU_IOVEC_INLINE_NIOV
+ * elements do not allocate.
+ */
+void qemu_iovec_init_slice_inline(QEMUIOVectorInline *qiov,
+                                  QEMUIOVector *source,
+                                  size_t offset, size_t len)
+{
+    struct iovec *slice_iov;
+    int slice_niov;
+    size_t slice_head, slice_tail;
+
+    assert(source->size >= len);
+    assert(source->size - len >= offset);
+
+    slice_iov = qemu_iovec_slice(source, offset, len,
+                                 &slice_head, &slice_tail, &slice_niov);
+    if (slice_niov == 1) {
+        qemu_iovec_init_buf(&qiov->qiov, slice_iov[0].iov_base + slice_head,
+                            len);
+        return;
+    }
+
+    if (slice_niov <= QEMU_IOVEC_INLINE_NIOV) {
+        qemu_iovec_init_inline(qiov);
+    } else {
+        qemu_iovec_init(&qiov->qiov, slice_niov);
+    }
+    qemu_iovec_concat_iov(&qiov->qiov, slice_iov, slice_niov, slice_head, len);
+}
+
 void qemu_iovec_destroy(QEMUIOVector *qiov)
 {
-    if (qiov->nalloc != -1) {
+    if (qiov->nalloc >= 0) {
         g_free(qiov->iov);
     }
 
@@ -11,50 +11,35 @@
 
 #include "qemu/osdep.h"
 #include "qemu/iova-tree.h"
+#include "qemu/interval-tree.h"
 
 struct IOVATree {
     GTree *tree;
-};
-
-/* Args to pass to iova_tree_alloc foreach function. */
-struct IOVATreeAllocArgs {
-    /* Size of the desired allocation */
-    size_t new_size;
-
-    /* The minimum address allowed in the allocation */
-    hwaddr iova_begin;
 
-    /* Map at the left of the hole, can be NULL if "this" is first one */
-    const DMAMap *prev;
-
-    /* Map at the right of the hole, can be NULL if "prev" is the last one */
-    const DMAMap *this;
+    /*
+     * Free IOVA ranges of an IOVA tree, kept as the complement of the
+     * mappings so that allocation doesn't walk every mapping.  Ordered by
+     * hole start; since only insert/remove and the descents below are used
+     * on it, a hole's interval "last" stores its inclusive size, which makes
+     * subtree_last the largest hole in each subtree.
+     */
+    bool has_holes;
+    IntervalTreeRoot holes;
+};
 
-    /* If found, we fill in the IOVA here */
-    hwaddr iova_result;
+typedef struct IOVAHole {
+    IntervalTreeNode node;
+    /* Last free iova of the hole */
+    hwaddr last;
+} IOVAHole;
 
-    /* Whether have we found a valid IOVA */
-    bool iova_found;
-};
+#define rb_to_hole(N)  container_of(N, IOVAHole, node.rb)
 
 typedef struct IOVATreeFindIOVAArgs {
     const DMAMap *needle;
     const DMAMap *result;
 } IOVATreeFindIOVAArgs;
 
-/**
- * Iterate args to the next hole
- *
- * @args: The alloc arguments
- * @next: The next mapping in the tree. Can be NULL to signal the last one
- */
-static void iova_tree_alloc_args_iterate(struct IOVATreeAllocArgs *args,
-                                         const DMAMap *next)
-{
-    args->prev = args->this;
-    args->this = next;
-}
-
 static int iova_tree_compare(gconstpointer a, gconstpointer b, gpointer data)
 {
     const DMAMap *m1 = a, *m2 = b;
@@ -71,12 +56,139 @@ static int iova_tree_compare(gconstpointer a, gconstpointer b, gpointer data)
     return 0;
 }
 
+static void iova_hole_add(IOVATree *tree, hwaddr start, hwaddr last)
+{
+    IOVAHole *hole = g_new0(IOVAHole, 1);
+
+    hole->node.start = start;
+    hole->node.last = last - start;
+    hole->last = last;
+    interval_tree_insert(&hole->node, &tree->holes);
+}
+
+static void iova_hole_del(IOVATree *tree, IOVAHole *hole)
+{
+    interval_tree_remove(&hole->node, &tree->holes);
+    g_free(hole);
+}
+
+/* Return the hole with the highest start not above @addr, if any */
+static IOVAHole *iova_hole_find_le(IOVATree *tree, hwaddr addr)
+{
+    RBNode *rb = tree->holes.rb_root.rb_node;
+    IOVAHole *best = NULL;
+
+    while (rb) {
+        IOVAHole *hole = rb_to_hole(rb);
+
+        if (hole->node.start <= addr) {
+            best = hole;
+            rb = rb->rb_right;
+        } else {
+            rb = rb->rb_left;
+        }
+    }
+    return best;
+}
+
+/* Remove [start, last], which must be free, from the holes */
+static void iova_hole_take(IOVATree *tree, hwaddr start, hwaddr last)
+{
+    IOVAHole *hole = iova_hole_find_le(tree, start);
+    hwaddr hole_start, hole_last;
+
+    assert(hole && hole->last >= last);
+    hole_start = hole->node.start;
+    hole_last = hole->last;
+    iova_hole_del(tree, hole);
+
+    if (hole_start < start) {
+        iova_hole_add(tree, hole_start, start - 1);
+    }
+    if (last < hole_last) {
+        iova_hole_add(tree, last + 1, hole_last);
+    }
+}
+
+/* Give [start, last] back to the holes, merging with its neighbours */
+static void iova_hole_free(IOVATree *tree, hwaddr start, hwaddr last)
+{
+    IOVAHole *hole;
+
+    if (start > 0) {
+        hole = iova_hole_find_le(tree, start - 1);
+        if (hole && hole->last == start - 1) {
+            start = hole->node.start;
+            iova_hole_del(tree, hole);
+        }
+    }
+    if (last < HWADDR_MAX) {
+        hole = iova_hole_find_le(tree, last + 1);
+        if (hole && hole->node.start == last + 1) {
+            last = hole->last;
+            iova_hole_del(tree, hole);
+        }
+    }
+    iova_hole_add(tree, start, last);
+}
+
+/* Lowest hole in the subtree at @rb whose size is at least @size */
+static IOVAHole *iova_hole_first_fit(RBNode *rb, hwaddr size)
+{
+    while (rb) {
+        IOVAHole *hole = rb_to_hole(rb);
+
+        if (hole->node.subtree_last < size) {
+            return NULL;
+        }
+        if (rb->rb_left && rb_to_hole(rb->rb_left)->node.subtree_last >= size) {
+            rb = rb->rb_left;
+        } else if (hole->node.last >= size) {
+            return hole;
+        } else {
+            rb = rb->rb_right;
+        }
+    }
+    return NULL;
+}
+
+/* Like iova_hole_first_fit(), but only for holes starting at @begin or above */
+static IOVAHole *iova_hole_first_fit_from(RBNode *rb, hwaddr begin,
+                                          hwaddr size)
+{
+    while (rb) {
+        IOVAHole *hole = rb_to_hole(rb);
+        IOVAHole *found;
+
+        if (hole->node.subtree_last < size) {
+            return NULL;
+        }
+        if (hole->node.start < begin) {
+            rb = rb->rb_right;
+            continue;
+        }
+
+        /* This hole and its whole right subtree start at @begin or above */
+        found = iova_hole_first_fit_from(rb->rb_left, begin, size);
+        if (found) {
+            return found;
+        }
+        if (hole->node.last >= size) {
+            return hole;
+        }
+        return iova_hole_first_fit(rb->rb_right, size);
+    }
+    return NULL;
+}
+
 IOVATree *iova_tree_new(void)
 {
     IOVATree *iova_tree = g_new0(IOVATree, 1);
 
     /* We don't have values actually, no need to free */
     iova_tree->tree = g_tree_new_full(iova_tree_compare, NULL, g_free, NULL);
+    iova_tree->has_holes = true;
+    iova_hole_add(iova_tree, 0, HWADDR_MAX);
 
     return iova_tree;
 }
@@ -137,6 +249,9 @@ int iova_tree_insert(IOVATree *tree, const DMAMap *map)
     new = g_new0(DMAMap, 1);
     memcpy(new, map, sizeof(*new));
     iova_tree_insert_internal(tree->tree, new);
+    if (tree->has_holes) {
+        iova_hole_take(tree, new->iova, new->iova + new->size);
+    }
 
     return IOVA_OK;
 }
@@ -146,114 +261,52 @@ void iova_tree_remove(IOVATree *tree, DMAMap map)
     const DMAMap *overlap;
 
     while ((overlap = iova_tree_find(tree, &map))) {
+        if (tree->has_holes) {
+            iova_hole_free(tree, overlap->iova, overlap->iova + overlap->size);
+        }
         g_tree_remove(tree->tree, overlap);
     }
 }
 
-/**
- * Try to find an unallocated IOVA range between prev and this elements.
- *
- * @args: Arguments to allocation
- *
- * Cases:
- *
- * (1) !prev, !this: No entries allocated, always succeed
- *
- * (2) !prev, this: We're iterating at the 1st element.
- *
- * (3) prev, !this: We're iterating at the last element.
- *
- * (4) prev, this: this is the most common case, we'll try to find a hole
- * between "prev" and "this" mapping.
- *
- * Note that this function assumes the last valid iova is HWADDR_MAX, but it
- * searches linearly so it's easy to discard the result if it's not the case.
- */
-static void iova_tree_alloc_map_in_hole(struct IOVATreeAllocArgs *args)
-{
-    const DMAMap *prev = args->prev, *this = args->this;
-    uint64_t hole_start, hole_last;
-
-    if (this && this->iova + this->size < args->iova_begin) {
-        return;
-    }
-
-    hole_start = MAX(prev ? prev->iova + prev->size + 1 : 0, args->iova_begin);
-    hole_last = this ? this->iova : HWADDR_MAX;
-
-    if (hole_last - hole_start > args->new_size) {
-        args->iova_result = hole_start;
-        args->iova_found = true;
-    }
-}
-
-/**
- * Foreach dma node in the tree, compare if there is a hole with its previous
- * node (or minimum iova address allowed) and the node.
- *
- * @key: Node iterating
- * @value: Node iterating
- * @pargs: Struct to communicate with the outside world
- *
- * Return: false to keep iterating, true if needs break.
- */
-static gboolean iova_tree_alloc_traverse(gpointer key, gpointer value,
-                                         gpointer pargs)
-{
-    struct IOVATreeAllocArgs *args = pargs;
-    DMAMap *node = value;
-
-    assert(key == value);
-
-    iova_tree_alloc_args_iterate(args, node);
-    iova_tree_alloc_map_in_hole(args);
-    return args->iova_found;
-}
-
 int iova_tree_alloc_map(IOVATree *tree, DMAMap *map, hwaddr iova_begin,
                         hwaddr iova_last)
 {
-    struct IOVATreeAllocArgs args = {
-        .new_size = map->size,
-        .iova_begin = iova_begin,
-    };
+    IOVAHole *hole;
+    hwaddr iova;
+
+    assert(tree->has_holes);
 
     if (unlikely(iova_last < iova_begin)) {
         return IOVA_ERR_INVALID;
     }
 
-    /*
-     * Find a valid hole for the mapping
-     *
-     * Assuming low iova_begin, so no need to do a binary search to
-     * locate the first node.
-     *
-     * TODO: Replace all this with g_tree_node_first/next/last when available
-     * (from glib since 2.68). To do it with g_tree_foreach complicates the
-     * code a lot.
-     *
-     */
-    g_tree_foreach(tree->tree, iova_tree_alloc_traverse, &args);
-    if (!args.iova_found) {
-        /*
-         * Either tree is empty or the last hole is still not checked.
-         * g_tree_foreach does not compare (last, iova_last] range, so we check
-         * it here.
-         */
-        iova_tree_alloc_args_iterate(&args, NULL);
-        iova_tree_alloc_map_in_hole(&args);
+    /* First fit: the hole containing iova_begin, then the lowest one above */
+    hole = iova_hole_find_le(tree, iova_begin);
+    if (hole && hole->last >= iova_begin &&
+        hole->last - iova_begin >= map->size) {
+        iova = iova_begin;
+    } else {
+        hole = iova_hole_first_fit_from(tree->holes.rb_root.rb_node,
+                                        iova_begin, map->size);
+        if (!hole) {
+            return IOVA_ERR_NOMEM;
+        }
+        iova = hole->node.start;
     }
 
-    if (!args.iova_found || args.iova_result + map->size > iova_last) {
+    if (iova + map->size > iova_last) {
         return IOVA_ERR_NOMEM;
     }
 
-    map->iova = args.iova_result;
+    map->iova = iova;
     return iova_tree_insert(tree, map);
 }
 
 void iova_tree_destroy(IOVATree *tree)
 {
+    while (tree->holes.rb_root.rb_node) {
+        iova_hole_del(tree, rb_to_hole(tree->holes.rb_root.rb_node));
+    }
     g_tree_destroy(tree->tree);
     g_free(tree);
 }
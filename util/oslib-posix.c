@@ -63,6 +63,12 @@
 
 #define MAX_MEM_PREALLOC_THREAD_COUNT 16
 
+/*
+ * Amount of memory a MADV_POPULATE_WRITE thread claims at a time; threads
+ * keep claiming chunks in ascending address order until the area is done.
+ */
+#define MEM_PREALLOC_CHUNK_SIZE (256 * MiB)
+
 struct MemsetThread;
 
 static QLIST_HEAD(, MemsetContext) memset_contexts =
@@ -73,6 +79,12 @@ typedef struct MemsetContext {
     bool any_thread_failed;
     struct MemsetThread *threads;
     int num_threads;
+    /* Work queue of the MADV_POPULATE_WRITE threads */
+    char *area;
+    size_t hpagesize;
+    size_t numpages;
+    size_t chunk_pages;
+    size_t next_page;
     QLIST_ENTRY(MemsetContext) next;
 } MemsetContext;
 
@@ -416,8 +428,7 @@ static void *do_touch_pages(void *arg)
 static void *do_madv_populate_write_pages(void *arg)
 {
     MemsetThread *memset_args = (MemsetThread *)arg;
-    const size_t size = memset_args->numpages * memset_args->hpagesize;
-    char * const addr = memset_args->addr;
+    MemsetContext *context = memset_args->context;
     int ret = 0;
 
     /* See do_touch_pages(). */
@@ -427,8 +438,28 @@ static void *do_madv_populate_write_pages(void *arg)
     }
     qemu_mutex_unlock(&page_mutex);
 
-    if (size && qemu_madvise(addr, size, QEMU_MADV_POPULATE_WRITE)) {
-        ret = -errno;
+    /*
+     * Rather than populating a fixed slice, claim chunks from a shared
+     * cursor: threads that get through their memory quickly (e.g. because
+     * it was already populated) keep helping instead of idling, and the
+     * area gets populated roughly in ascending address order.
+     */
+    while (!qatomic_read(&context->any_thread_failed)) {
+        size_t page = qatomic_fetch_add(&context->next_page,
+                                        context->chunk_pages);
+        size_t numpages;
+
+        if (page >= context->numpages) {
+            break;
+        }
+        numpages = MIN(context->chunk_pages, context->numpages - page);
+        if (qemu_madvise(context->area + page * context->hpagesize,
+                         numpages * context->hpagesize,
+                         QEMU_MADV_POPULATE_WRITE)) {
+            ret = -errno;
+            qatomic_set(&context->any_thread_failed, true);
+            break;
+        }
     }
     return (void *)(uintptr_t)ret;
 }
@@ -511,6 +542,10 @@ static int touch_all_pages(char *area, size_t hpagesize, size_t numpages,
             return ret;
         }
         touch_fn = do_madv_populate_write_pages;
+        context->area = area;
+        context->hpagesize = hpagesize;
+        context->numpages = numpages;
+        context->chunk_pages = MAX(1, MEM_PREALLOC_CHUNK_SIZE / hpagesize);
     } else {
         touch_fn = do_touch_pages;
     }
@@ -64,9 +64,46 @@ static CoroutinePool global_pool = QSLIST_HEAD_INITIALIZER(global_pool);
 static unsigned int global_pool_size;
 static unsigned int global_pool_max_size = COROUTINE_POOL_BATCH_MAX_SIZE;
 
+/*
+ * Number of coroutines currently allocated, whether running or pooled, and
+ * the highest value seen so far.  Each one owns a COROUTINE_STACK_SIZE stack
+ * and its VMAs, so these track the coroutine memory footprint.
+ */
+static unsigned int coroutine_count;
+static unsigned int coroutine_peak_count;
+
 QEMU_DEFINE_STATIC_CO_TLS(CoroutinePool, local_pool);
 QEMU_DEFINE_STATIC_CO_TLS(Notifier, local_pool_cleanup_notifier);
 
+static Coroutine *coroutine_alloc(void)
+{
+    unsigned int count = qatomic_fetch_inc(&coroutine_count) + 1;
+    unsigned int peak = qatomic_read(&coroutine_peak_count);
+
+    while (count > peak) {
+        unsigned int old = qatomic_cmpxchg(&coroutine_peak_count, peak, count);
+
+        if (old == peak) {
+            trace_qemu_coroutine_peak(count,
+                                      (uint64_t)count * COROUTINE_STACK_SIZE);
+            break;
+        }
+        peak = old;
+    }
+    return qemu_coroutine_new();
+}
+
+static void coroutine_free(Coroutine *co)
+{
+    qemu_coroutine_delete(co);
+    qatomic_dec(&coroutine_count);
+}
+
+unsigned int qemu_coroutine_get_peak_count(void)
+{
+    return qatomic_read(&coroutine_peak_count);
+}
+
 static CoroutinePoolBatch *coroutine_pool_batch_new(void)
 {
     CoroutinePoolBatch *batch = g_new(CoroutinePoolBatch, 1);
@@ -83,7 +120,7 @@ static void coroutine_pool_batch_delete(CoroutinePoolBatch *batch)
 
     QSLIST_FOREACH_SAFE(co, &batch->list, pool_next, tmp) {
         QSLIST_REMOVE_HEAD(&batch->list, pool_next);
-        qemu_coroutine_delete(co);
+        coroutine_free(co);
     }
     g_free(batch);
 }
@@ -223,7 +260,7 @@ Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
     }
 
     if (!co) {
-        co = qemu_coroutine_new();
+        co = coroutine_alloc();
     }
 
     co->entry = entry;
@@ -239,7 +276,7 @@ static void coroutine_delete(Coroutine *co)
     if (IS_ENABLED(CONFIG_COROUTINE_POOL)) {
         coroutine_pool_put(co);
     } else {
-        qemu_coroutine_delete(co);
+        coroutine_free(co);
     }
 }
 
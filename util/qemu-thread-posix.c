@@ -510,6 +510,27 @@ int qemu_thread_get_affinity(QemuThread *thread, unsigned long **host_cpus,
 #endif
 }
 
+int qemu_thread_get_cpu_time(QemuThread *thread, uint64_t *ns)
+{
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    clockid_t clock;
+    struct timespec ts;
+    int err;
+
+    err = pthread_getcpuclockid(thread->thread, &clock);
+    if (err) {
+        return -err;
+    }
+    if (clock_gettime(clock, &ts)) {
+        return -errno;
+    }
+    *ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    return 0;
+#else
+    return -ENOSYS;
+#endif
+}
+
 void qemu_thread_get_self(QemuThread *thread)
 {
     thread->thread = pthread_self();
@@ -390,6 +390,11 @@ int qemu_thread_get_affinity(QemuThread *thread, unsigned long **host_cpus,
     return -ENOSYS;
 }
 
+int qemu_thread_get_cpu_time(QemuThread *thread, uint64_t *ns)
+{
+    return -ENOSYS;
+}
+
 void qemu_thread_get_self(QemuThread *thread)
 {
     thread->data = qemu_thread_data;
@@ -64,10 +64,23 @@ static QEMUClock qemu_clocks[QEMU_CLOCK_MAX];
  * reenabling the clock can call all the notifiers.
  */
 
+/*
+ * Pending timers are kept in a 4-ary min-heap ordered by expiry time, so
+ * that arming and deleting a timer is O(log n) rather than a walk of a
+ * sorted list.  Timers that expire at the same time keep firing in the
+ * order they were armed.
+ */
+#define TIMER_HEAP_ARITY 4
+
 struct QEMUTimerList {
     QEMUClock *clock;
     QemuMutex active_timers_lock;
+    /* The timer that expires first, can be read without the lock */
     QEMUTimer *active_timers;
+    QEMUTimer **active_heap;
+    size_t active_heap_len;
+    size_t active_heap_size;
+    uint64_t active_seq;
     QLIST_ENTRY(QEMUTimerList) list;
     QEMUTimerListNotifyCB *notify_cb;
     void *notify_opaque;
@@ -118,6 +131,7 @@ void timerlist_free(QEMUTimerList *timer_list)
         QLIST_REMOVE(timer_list, list);
     }
     qemu_mutex_destroy(&timer_list->active_timers_lock);
+    g_free(timer_list->active_heap);
     g_free(timer_list);
 }
 
@@ -243,6 +257,10 @@ int64_t timerlist_deadline_ns(QEMUTimerList *timer_list)
     return delta;
 }
 
+/* Find the first timer to expire that has no attributes outside attr_mask */
+static QEMUTimer *timerlist_first_locked(QEMUTimerList *timer_list,
+                                         int attr_mask);
+
 /* Calculate the soonest deadline across all timerlists attached
  * to the clock. This is used for the icount timeout so we
  * ignore whether or not the clock should be used in deadline
@@ -266,11 +284,7 @@ int64_t qemu_clock_deadline_ns_all(QEMUClockType type, int attr_mask)
             continue;
         }
         qemu_mutex_lock(&timer_list->active_timers_lock);
-        ts = timer_list->active_timers;
-        /* Skip all external timers */
-        while (ts && (ts->attributes & ~attr_mask)) {
-            ts = ts->next;
-        }
+        ts = timerlist_first_locked(timer_list, attr_mask);
         if (!ts) {
             qemu_mutex_unlock(&timer_list->active_timers_lock);
             continue;
@@ -369,43 +383,137 @@ void timer_deinit(QEMUTimer *ts)
     ts->timer_list = NULL;
 }
 
-static void timer_del_locked(QEMUTimerList *timer_list, QEMUTimer *ts)
+static bool timer_before(const QEMUTimer *a, const QEMUTimer *b)
+{
+    return a->expire_time < b->expire_time ||
+           (a->expire_time == b->expire_time && a->seq < b->seq);
+}
+
+static void timer_heap_set(QEMUTimerList *timer_list, size_t i, QEMUTimer *ts)
 {
-    QEMUTimer **pt, *t;
+    timer_list->active_heap[i] = ts;
+    ts->heap_index = i;
+}
 
-    ts->expire_time = -1;
-    pt = &timer_list->active_timers;
-    for(;;) {
-        t = *pt;
-        if (!t)
-            break;
-        if (t == ts) {
-            qatomic_set(pt, t->next);
+static void timer_heap_sift_up(QEMUTimerList *timer_list, size_t i)
+{
+    QEMUTimer *ts = timer_list->active_heap[i];
+
+    while (i > 0) {
+        size_t parent = (i - 1) / TIMER_HEAP_ARITY;
+
+        if (!timer_before(ts, timer_list->active_heap[parent])) {
             break;
         }
-        pt = &t->next;
+        timer_heap_set(timer_list, i, timer_list->active_heap[parent]);
+        i = parent;
     }
+    timer_heap_set(timer_list, i, ts);
 }
 
-static bool timer_mod_ns_locked(QEMUTimerList *timer_list,
-                                QEMUTimer *ts, int64_t expire_time)
+static void timer_heap_sift_down(QEMUTimerList *timer_list, size_t i)
 {
-    QEMUTimer **pt, *t;
+    QEMUTimer *ts = timer_list->active_heap[i];
+    size_t len = timer_list->active_heap_len;
 
-    /* add the timer in the sorted list */
-    pt = &timer_list->active_timers;
     for (;;) {
-        t = *pt;
-        if (!timer_expired_ns(t, expire_time)) {
+        size_t child = i * TIMER_HEAP_ARITY + 1;
+        size_t end = MIN(child + TIMER_HEAP_ARITY, len);
+        size_t best = child;
+        size_t j;
+
+        if (child >= len) {
+            break;
+        }
+        for (j = child + 1; j < end; j++) {
+            if (timer_before(timer_list->active_heap[j],
+                             timer_list->active_heap[best])) {
+                best = j;
+            }
+        }
+        if (!timer_before(timer_list->active_heap[best], ts)) {
             break;
         }
-        pt = &t->next;
+        timer_heap_set(timer_list, i, timer_list->active_heap[best]);
+        i = best;
     }
+    timer_heap_set(timer_list, i, ts);
+}
+
+static void timer_heap_update_head(QEMUTimerList *timer_list)
+{
+    QEMUTimer *head = NULL;
+
+    if (timer_list->active_heap_len) {
+        head = timer_list->active_heap[0];
+    }
+    qatomic_set(&timer_list->active_timers, head);
+}
+
+static QEMUTimer *timerlist_first_locked(QEMUTimerList *timer_list,
+                                         int attr_mask)
+{
+    QEMUTimer *first = timer_list->active_timers;
+    size_t i;
+
+    if (!first || !(first->attributes & ~attr_mask)) {
+        return first;
+    }
+
+    /* Skip all external timers */
+    first = NULL;
+    for (i = 1; i < timer_list->active_heap_len; i++) {
+        QEMUTimer *ts = timer_list->active_heap[i];
+
+        if (!(ts->attributes & ~attr_mask) &&
+            (!first || timer_before(ts, first))) {
+            first = ts;
+        }
+    }
+    return first;
+}
+
+static void timer_del_locked(QEMUTimerList *timer_list, QEMUTimer *ts)
+{
+    size_t i = ts->heap_index;
+    QEMUTimer *last;
+
+    if (ts->expire_time == -1) {
+        return;
+    }
+    ts->expire_time = -1;
+
+    last = timer_list->active_heap[--timer_list->active_heap_len];
+    if (last != ts) {
+        timer_heap_set(timer_list, i, last);
+        if (i > 0 &&
+            timer_before(last,
+                         timer_list->active_heap[(i - 1) / TIMER_HEAP_ARITY])) {
+            timer_heap_sift_up(timer_list, i);
+        } else {
+            timer_heap_sift_down(timer_list, i);
+        }
+    }
+    timer_heap_update_head(timer_list);
+}
+
+static bool timer_mod_ns_locked(QEMUTimerList *timer_list,
+                                QEMUTimer *ts, int64_t expire_time)
+{
+    if (timer_list->active_heap_len == timer_list->active_heap_size) {
+        timer_list->active_heap_size =
+            MAX(16, timer_list->active_heap_size * 2);
+        timer_list->active_heap = g_renew(QEMUTimer *, timer_list->active_heap,
+                                          timer_list->active_heap_size);
+    }
+
     ts->expire_time = MAX(expire_time, 0);
-    ts->next = *pt;
-    qatomic_set(pt, ts);
+    ts->seq = timer_list->active_seq++;
+    timer_heap_set(timer_list, timer_list->active_heap_len++, ts);
+    timer_heap_sift_up(timer_list, ts->heap_index);
+    timer_heap_update_head(timer_list);
 
-    return pt == &timer_list->active_timers;
+    return timer_list->active_timers == ts;
 }
 
 static void timerlist_rearm(QEMUTimerList *timer_list)
@@ -552,9 +660,7 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
         }
 
         /* remove timer from the list before calling the callback */
-        timer_list->active_timers = ts->next;
-        ts->next = NULL;
-        ts->expire_time = -1;
+        timer_del_locked(timer_list, ts);
         cb = ts->cb;
         opaque = ts->opaque;
 
@@ -396,6 +396,35 @@ QSP_GEN_VOID(QemuRecMutex, QSP_REC_MUTEX, qsp_rec_mutex_lock,
 QSP_GEN_RET1(QemuRecMutex, QSP_REC_MUTEX, qsp_rec_mutex_trylock,
              qemu_rec_mutex_trylock_impl)
 
+/*
+ * Contended-only profiling: an uncontended acquisition costs just one
+ * trylock, and only the acquisitions that have to wait are timed and recorded.
+ */
+#define QSP_GEN_CONTENDED(type_, qsp_t_, func_, impl_, tryimpl_)        \
+    static void func_(type_ *obj, const char *file, int line)           \
+    {                                                                   \
+        QSPEntry *e;                                                    \
+        int64_t t0, t1;                                                 \
+                                                                        \
+        if (likely(!tryimpl_(obj, file, line))) {                       \
+            return;                                                     \
+        }                                                               \
+        t0 = get_clock();                                               \
+        impl_(obj, file, line);                                         \
+        t1 = get_clock();                                               \
+                                                                        \
+        e = qsp_entry_get(obj, file, line, qsp_t_);                     \
+        qsp_entry_record(e, t1 - t0);                                   \
+    }
+
+QSP_GEN_CONTENDED(QemuMutex, QSP_BQL_MUTEX, qsp_bql_mutex_lock_contended,
+                  qemu_mutex_lock_impl, qemu_mutex_trylock_impl)
+QSP_GEN_CONTENDED(QemuMutex, QSP_MUTEX, qsp_mutex_lock_contended,
+                  qemu_mutex_lock_impl, qemu_mutex_trylock_impl)
+QSP_GEN_CONTENDED(QemuRecMutex, QSP_REC_MUTEX, qsp_rec_mutex_lock_contended,
+                  qemu_rec_mutex_lock_impl, qemu_rec_mutex_trylock_impl)
+
+#undef QSP_GEN_CONTENDED
 #undef QSP_GEN_RET1
 #undef QSP_GEN_VOID
 
@@ -432,7 +461,14 @@ qsp_cond_timedwait(QemuCond *cond, QemuMutex *mutex, int ms,
 
 bool qsp_is_enabled(void)
 {
-    return qatomic_read(&qemu_mutex_lock_func) == qsp_mutex_lock;
+    QemuMutexLockFunc func = qatomic_read(&qemu_mutex_lock_func);
+
+    return func == qsp_mutex_lock || func == qsp_mutex_lock_contended;
+}
+
+bool qsp_is_contended_only(void)
+{
+    return qatomic_read(&qemu_mutex_lock_func) == qsp_mutex_lock_contended;
 }
 
 void qsp_enable(void)
@@ -446,6 +482,17 @@ void qsp_enable(void)
     qatomic_set(&qemu_cond_timedwait_func, qsp_cond_timedwait);
 }
 
+void qsp_enable_contended(void)
+{
+    qatomic_set(&qemu_mutex_lock_func, qsp_mutex_lock_contended);
+    qatomic_set(&qemu_mutex_trylock_func, qemu_mutex_trylock_impl);
+    qatomic_set(&bql_mutex_lock_func, qsp_bql_mutex_lock_contended);
+    qatomic_set(&qemu_rec_mutex_lock_func, qsp_rec_mutex_lock_contended);
+    qatomic_set(&qemu_rec_mutex_trylock_func, qemu_rec_mutex_trylock_impl);
+    qatomic_set(&qemu_cond_wait_func, qemu_cond_wait_impl);
+    qatomic_set(&qemu_cond_timedwait_func, qemu_cond_timedwait_impl);
+}
+
 void qsp_disable(void)
 {
     qatomic_set(&qemu_mutex_lock_func, qemu_mutex_lock_impl);
@@ -265,9 +265,17 @@ static void *call_rcu_thread(void *opaque)
         /* Heuristically wait for a decent number of callbacks to pile up.
          * Fetch rcu_call_count now, we only must process elements that were
          * added before synchronize_rcu() starts.
+         *
+         * Don't wait if drain_call_rcu() is waiting for the callbacks; it
+         * is used on paths such as device unplug where latency matters
+         * more than batching.
          */
-        while (n == 0 || (n < RCU_CALL_MIN_SIZE && ++tries <= 5)) {
-            g_usleep(10000);
+        while (n == 0 ||
+               (n < RCU_CALL_MIN_SIZE && ++tries <= 5 &&
+                !qatomic_read(&in_drain_call_rcu))) {
+            if (!qatomic_read(&in_drain_call_rcu)) {
+                g_usleep(10000);
+            }
             if (n == 0) {
                 qemu_event_reset(&rcu_call_ready_event);
                 n = qatomic_read(&rcu_call_count);
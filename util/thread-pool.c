@@ -49,8 +49,12 @@ struct ThreadPoolElementAio {
     /* Access to this list is protected by lock.  */
     QTAILQ_ENTRY(ThreadPoolElementAio) reqs;
 
-    /* This list is only written by the thread pool's mother thread.  */
+    /* Pushed atomically by the thread that completes the request.  */
+    QSLIST_ENTRY(ThreadPoolElementAio) done;
+
+    /* These lists are only written by the thread pool's mother thread.  */
     QLIST_ENTRY(ThreadPoolElementAio) all;
+    QSIMPLEQ_ENTRY(ThreadPoolElementAio) completed;
 };
 
 struct ThreadPoolAio {
@@ -63,6 +67,14 @@ struct ThreadPoolAio {
 
     /* The following variables are only accessed from one AioContext. */
     QLIST_HEAD(, ThreadPoolElementAio) head;
+    /* Requests taken from done_list whose callback has not run yet */
+    QSIMPLEQ_HEAD(, ThreadPoolElementAio) completed;
+
+    /*
+     * Finished requests, in reverse order of completion.  Workers push to it
+     * without taking lock and completion_bh takes all of it at once.
+     */
+    QSLIST_HEAD(, ThreadPoolElementAio) done_list;
 
     /* The following variables are protected by lock.  */
     QTAILQ_HEAD(, ThreadPoolElementAio) request_list;
@@ -111,10 +123,10 @@ static void *worker_thread(void *opaque)
         ret = req->func(req->arg);
 
         req->ret = ret;
-        /* Write ret before state.  */
-        smp_wmb();
         req->state = THREAD_DONE;
 
+        /* The cmpxchg orders the writes above before publishing req.  */
+        QSLIST_INSERT_HEAD_ATOMIC(&pool->done_list, req, done);
         qemu_bh_schedule(pool->completion_bh);
         qemu_mutex_lock(&pool->lock);
     }
@@ -174,42 +186,45 @@ static void spawn_thread(ThreadPoolAio *pool)
 static void thread_pool_completion_bh(void *opaque)
 {
     ThreadPoolAio *pool = opaque;
-    ThreadPoolElementAio *elem, *next;
+    QSLIST_HEAD(, ThreadPoolElementAio) done;
+    QSIMPLEQ_HEAD(, ThreadPoolElementAio) batch;
+    ThreadPoolElementAio *elem;
+
+    /*
+     * Take everything that finished since the last run in one go, instead
+     * of rescanning the list of all requests after each callback.  The list
+     * is in LIFO order, reverse it so that callbacks run in completion order.
+     */
+    QSLIST_MOVE_ATOMIC(&done, &pool->done_list);
+    QSIMPLEQ_INIT(&batch);
+    while ((elem = QSLIST_FIRST(&done))) {
+        QSLIST_REMOVE_HEAD(&done, done);
+        QSIMPLEQ_INSERT_HEAD(&batch, elem, completed);
+    }
+    QSIMPLEQ_CONCAT(&pool->completed, &batch);
 
     defer_call_begin(); /* cb() may use defer_call() to coalesce work */
 
-restart:
-    QLIST_FOREACH_SAFE(elem, &pool->head, all, next) {
-        if (elem->state != THREAD_DONE) {
-            continue;
-        }
+    while ((elem = QSIMPLEQ_FIRST(&pool->completed))) {
+        QSIMPLEQ_REMOVE_HEAD(&pool->completed, completed);
 
         trace_thread_pool_complete_aio(pool, elem, elem->common.opaque,
                                        elem->ret);
         QLIST_REMOVE(elem, all);
 
         if (elem->common.cb) {
-            /* Read state before ret.  */
-            smp_rmb();
-
-            /* Schedule ourselves in case elem->common.cb() calls aio_poll() to
-             * wait for another request that completed at the same time.
+            /*
+             * Schedule ourselves in case elem->common.cb() calls aio_poll() to
+             * wait for another request of this batch.  The nested run picks
+             * up the rest of pool->completed.
              */
-            qemu_bh_schedule(pool->completion_bh);
+            if (!QSIMPLEQ_EMPTY(&pool->completed)) {
+                qemu_bh_schedule(pool->completion_bh);
+            }
 
             elem->common.cb(elem->common.opaque, elem->ret);
-
-            /* We can safely cancel the completion_bh here regardless of someone
-             * else having scheduled it meanwhile because we reenter the
-             * completion function anyway (goto restart).
-             */
-            qemu_bh_cancel(pool->completion_bh);
-
-            qemu_aio_unref(elem);
-            goto restart;
-        } else {
-            qemu_aio_unref(elem);
         }
+        qemu_aio_unref(elem);
     }
 
     defer_call_end();
@@ -225,10 +240,12 @@ static void thread_pool_cancel(BlockAIOCB *acb)
     QEMU_LOCK_GUARD(&pool->lock);
     if (elem->state == THREAD_QUEUED) {
         QTAILQ_REMOVE(&pool->request_list, elem, reqs);
-        qemu_bh_schedule(pool->completion_bh);
 
         elem->state = THREAD_DONE;
         elem->ret = -ECANCELED;
+
+        QSLIST_INSERT_HEAD_ATOMIC(&pool->done_list, elem, done);
+        qemu_bh_schedule(pool->completion_bh);
     }
 
 }
@@ -332,6 +349,8 @@ static void thread_pool_init_one(ThreadPoolAio *pool, AioContext *ctx)
     pool->new_thread_bh = aio_bh_new(ctx, spawn_thread_bh_fn, pool);
 
     QLIST_INIT(&pool->head);
+    QSIMPLEQ_INIT(&pool->completed);
+    QSLIST_INIT(&pool->done_list);
     QTAILQ_INIT(&pool->request_list);
 
     thread_pool_update_params(pool, ctx);
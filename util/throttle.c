@@ -23,6 +23,7 @@
  */
 
 #include "qemu/osdep.h"
+#include <math.h>
 #include "qapi/error.h"
 #include "qemu/throttle.h"
 #include "qemu/timer.h"
@@ -87,6 +88,29 @@ static int64_t throttle_do_compute_wait(double limit, double extra)
     return wait;
 }
 
+/* Compute the size of a leaky bucket and of its burst bucket
+ *
+ * @bkt:               the leaky bucket we operate on
+ * @bucket_size:       I/O before throttling to bkt->avg
+ * @burst_bucket_size: I/O before throttling to bkt->max
+ */
+static void throttle_bucket_sizes(LeakyBucket *bkt, double *bucket_size,
+                                  double *burst_bucket_size)
+{
+    if (!bkt->max) {
+        /* If bkt->max is 0 we still want to allow short bursts of I/O
+         * from the guest, otherwise every other request will be throttled
+         * and performance will suffer considerably. */
+        *bucket_size = (double) bkt->avg / 10;
+        *burst_bucket_size = 0;
+    } else {
+        /* If we have a burst limit then we have to wait until all I/O
+         * at burst rate has finished before throttling to bkt->avg */
+        *bucket_size = bkt->max * bkt->burst_length;
+        *burst_bucket_size = (double) bkt->max / 10;
+    }
+}
+
 /* This function compute the wait time in ns that a leaky bucket should trigger
  *
  * @bkt: the leaky bucket we operate on
@@ -102,18 +126,7 @@ int64_t throttle_compute_wait(LeakyBucket *bkt)
         return 0;
     }
 
-    if (!bkt->max) {
-        /* If bkt->max is 0 we still want to allow short bursts of I/O
-         * from the guest, otherwise every other request will be throttled
-         * and performance will suffer considerably. */
-        bucket_size = (double) bkt->avg / 10;
-        burst_bucket_size = 0;
-    } else {
-        /* If we have a burst limit then we have to wait until all I/O
-         * at burst rate has finished before throttling to bkt->avg */
-        bucket_size = bkt->max * bkt->burst_length;
-        burst_bucket_size = (double) bkt->max / 10;
-    }
+    throttle_bucket_sizes(bkt, &bucket_size, &burst_bucket_size);
 
     /* If the main bucket is full then we have to wait */
     extra = bkt->level - bucket_size;
@@ -134,6 +147,43 @@ int64_t throttle_compute_wait(LeakyBucket *bkt)
     return 0;
 }
 
+/* This function computes how many units can be added to a leaky bucket
+ * before an I/O would have to wait
+ *
+ * @bkt: the leaky bucket we operate on
+ * @ret: the number of units, or INFINITY if the bucket has no limit
+ */
+static double throttle_compute_headroom(LeakyBucket *bkt)
+{
+    double bucket_size;
+    double burst_bucket_size;
+    double headroom;
+
+    if (!bkt->avg) {
+        return INFINITY;
+    }
+
+    throttle_bucket_sizes(bkt, &bucket_size, &burst_bucket_size);
+
+    headroom = bucket_size - bkt->level;
+    if (bkt->burst_length > 1) {
+        headroom = MIN(headroom, burst_bucket_size - bkt->burst_level);
+    }
+
+    return MAX(headroom, 0);
+}
+
+/* The buckets that limit each throttle direction */
+static const BucketType to_check[THROTTLE_MAX][4] = {
+                              {THROTTLE_BPS_TOTAL,
+                               THROTTLE_OPS_TOTAL,
+                               THROTTLE_BPS_READ,
+                               THROTTLE_OPS_READ},
+                              {THROTTLE_BPS_TOTAL,
+                               THROTTLE_OPS_TOTAL,
+                               THROTTLE_BPS_WRITE,
+                               THROTTLE_OPS_WRITE}, };
+
 /* This function compute the time that must be waited while this IO
  *
  * @direction:  throttle direction
@@ -142,15 +192,6 @@ int64_t throttle_compute_wait(LeakyBucket *bkt)
 static int64_t throttle_compute_wait_for(ThrottleState *ts,
                                          ThrottleDirection direction)
 {
-    static const BucketType to_check[THROTTLE_MAX][4] = {
-                                  {THROTTLE_BPS_TOTAL,
-                                   THROTTLE_OPS_TOTAL,
-                                   THROTTLE_BPS_READ,
-                                   THROTTLE_OPS_READ},
-                                  {THROTTLE_BPS_TOTAL,
-                                   THROTTLE_OPS_TOTAL,
-                                   THROTTLE_BPS_WRITE,
-                                   THROTTLE_OPS_WRITE}, };
     int64_t wait, max_wait = 0;
     int i;
 
@@ -462,13 +503,17 @@ bool throttle_schedule_timer(ThrottleState *ts,
     return true;
 }
 
-/* do the accounting for this operation
+/* add bytes and operations to the buckets of a throttle direction
+ *
+ * Negative values remove them again, without letting the bucket levels
+ * drop below zero.
  *
  * @direction: throttle direction
- * @size:     the size of the operation
+ * @size:      the number of bytes
+ * @units:     the number of operations
  */
-void throttle_account(ThrottleState *ts, ThrottleDirection direction,
-                      uint64_t size)
+static void throttle_do_account(ThrottleState *ts, ThrottleDirection direction,
+                                double size, double units)
 {
     static const BucketType bucket_types_size[THROTTLE_MAX][2] = {
         { THROTTLE_BPS_TOTAL, THROTTLE_BPS_READ },
@@ -478,32 +523,112 @@ void throttle_account(ThrottleState *ts, ThrottleDirection direction,
         { THROTTLE_OPS_TOTAL, THROTTLE_OPS_READ },
         { THROTTLE_OPS_TOTAL, THROTTLE_OPS_WRITE }
     };
-    double units = 1.0;
     unsigned i;
 
     assert(direction < THROTTLE_MAX);
-    /* if cfg.op_size is defined and smaller than size we compute unit count */
-    if (ts->cfg.op_size && size > ts->cfg.op_size) {
-        units = (double) size / ts->cfg.op_size;
-    }
 
     for (i = 0; i < ARRAY_SIZE(bucket_types_size[THROTTLE_READ]); i++) {
         LeakyBucket *bkt;
 
         bkt = &ts->cfg.buckets[bucket_types_size[direction][i]];
-        bkt->level += size;
+        bkt->level = MAX(bkt->level + size, 0);
         if (bkt->burst_length > 1) {
-            bkt->burst_level += size;
+            bkt->burst_level = MAX(bkt->burst_level + size, 0);
         }
 
         bkt = &ts->cfg.buckets[bucket_types_units[direction][i]];
-        bkt->level += units;
+        bkt->level = MAX(bkt->level + units, 0);
         if (bkt->burst_length > 1) {
-            bkt->burst_level += units;
+            bkt->burst_level = MAX(bkt->burst_level + units, 0);
         }
     }
 }
 
+/* do the accounting for this operation
+ *
+ * @direction: throttle direction
+ * @size:     the size of the operation
+ */
+void throttle_account(ThrottleState *ts, ThrottleDirection direction,
+                      uint64_t size)
+{
+    double units = 1.0;
+
+    /* if cfg.op_size is defined and smaller than size we compute unit count */
+    if (ts->cfg.op_size && size > ts->cfg.op_size) {
+        units = (double) size / ts->cfg.op_size;
+    }
+
+    throttle_do_account(ts, direction, size, units);
+}
+
+/* compute how much I/O can be done before a request has to wait
+ *
+ * Requests that together stay within the returned budget would all have
+ * gone through without waiting, so they can be admitted without checking
+ * each of them against the buckets.
+ *
+ * @clock_type: the clock used to leak the buckets
+ * @direction:  throttle direction
+ * @size:       the number of bytes (may be NULL)
+ * @units:      the number of operations (may be NULL)
+ * @ret:        false if the next request has to wait, true otherwise
+ */
+bool throttle_compute_budget(ThrottleState *ts, QEMUClockType clock_type,
+                             ThrottleDirection direction,
+                             uint64_t *size, uint64_t *units)
+{
+    double headroom[2] = { INFINITY, INFINITY }; /* bytes, operations */
+    int i;
+
+    assert(direction < THROTTLE_MAX);
+
+    /* leak proportionally to the time elapsed */
+    throttle_do_leak(ts, qemu_clock_get_ns(clock_type));
+
+    for (i = 0; i < ARRAY_SIZE(to_check[THROTTLE_READ]); i++) {
+        BucketType index = to_check[direction][i];
+        bool is_ops = index >= THROTTLE_OPS_TOTAL;
+        double h = throttle_compute_headroom(&ts->cfg.buckets[index]);
+
+        headroom[is_ops] = MIN(headroom[is_ops], h);
+    }
+
+    if (size) {
+        *size = headroom[0] >= (double) UINT64_MAX ? UINT64_MAX : headroom[0];
+    }
+    if (units) {
+        *units = headroom[1] >= (double) UINT64_MAX ? UINT64_MAX : headroom[1];
+    }
+
+    return throttle_compute_wait_for(ts, direction) == 0;
+}
+
+/* account a budget returned by throttle_compute_budget() in advance
+ *
+ * @direction: throttle direction
+ * @size:      the number of bytes
+ * @units:     the number of operations
+ */
+void throttle_reserve_budget(ThrottleState *ts, ThrottleDirection direction,
+                             uint64_t size, uint64_t units)
+{
+    throttle_do_account(ts, direction, size, units);
+}
+
+/* give back the unused part of a budget reserved with
+ * throttle_reserve_budget()
+ *
+ * @direction: throttle direction
+ * @size:      the number of bytes
+ * @units:     the number of operations
+ */
+void throttle_release_budget(ThrottleState *ts, ThrottleDirection direction,
+                             uint64_t size, uint64_t units)
+{
+    throttle_do_account(ts, direction, -(double) size, -(double) units);
+}
+
 /* return a ThrottleConfig based on the options in a ThrottleLimits
  *
  * @arg:    the ThrottleLimits object to read from
@@ -191,14 +191,10 @@ void qemu_vfio_pci_unmap_bar(QEMUVFIOState *s, int index, void *bar,
 }
 
 /**
- * Initialize device IRQ with @irq_type and register an event notifier.
+ * Return the number of interrupt vectors the device supports for @irq_type.
  */
-int qemu_vfio_pci_init_irq(QEMUVFIOState *s, EventNotifier *e,
-                           int irq_type, Error **errp)
+int qemu_vfio_pci_get_irq_count(QEMUVFIOState *s, int irq_type, Error **errp)
 {
-    int r;
-    struct vfio_irq_set *irq_set;
-    size_t irq_set_size;
     struct vfio_irq_info irq_info = { .argsz = sizeof(irq_info) };
 
     irq_info.index = irq_type;
@@ -210,20 +206,47 @@ int qemu_vfio_pci_init_irq(QEMUVFIOState *s, EventNotifier *e,
         error_setg(errp, "Device interrupt doesn't support eventfd");
         return -EINVAL;
     }
+    return irq_info.count;
+}
+
+/**
+ * Initialize @count device IRQ vectors with @irq_type and register one event
+ * notifier for each of them.  Vector i is signalled through @e[i].
+ */
+int qemu_vfio_pci_init_irqs(QEMUVFIOState *s, EventNotifier **e,
+                            unsigned count, int irq_type, Error **errp)
+{
+    int r;
+    struct vfio_irq_set *irq_set;
+    size_t irq_set_size;
+    int *fds;
 
-    irq_set_size = sizeof(*irq_set) + sizeof(int);
+    r = qemu_vfio_pci_get_irq_count(s, irq_type, errp);
+    if (r < 0) {
+        return r;
+    }
+    if (count == 0 || count > (unsigned)r) {
+        error_setg(errp, "Device supports %d interrupt vectors, %u requested",
+                   r, count);
+        return -EINVAL;
+    }
+
+    irq_set_size = sizeof(*irq_set) + count * sizeof(int);
     irq_set = g_malloc0(irq_set_size);
 
     /* Get to a known IRQ state */
     *irq_set = (struct vfio_irq_set) {
         .argsz = irq_set_size,
         .flags = VFIO_IRQ_SET_DATA_EVENTFD | VFIO_IRQ_SET_ACTION_TRIGGER,
-        .index = irq_info.index,
+        .index = irq_type,
         .start = 0,
-        .count = 1,
+        .count = count,
     };
 
-    *(int *)&irq_set->data = event_notifier_get_fd(e);
+    fds = (int *)&irq_set->data;
+    for (unsigned i = 0; i < count; i++) {
+        fds[i] = event_notifier_get_fd(e[i]);
+    }
     r = ioctl(s->device, VFIO_DEVICE_SET_IRQS, irq_set);
     g_free(irq_set);
     if (r) {
@@ -233,6 +256,15 @@ int qemu_vfio_pci_init_irq(QEMUVFIOState *s, EventNotifier *e,
     return 0;
 }
 
+/**
+ * Initialize device IRQ with @irq_type and register an event notifier.
+ */
+int qemu_vfio_pci_init_irq(QEMUVFIOState *s, EventNotifier *e,
+                           int irq_type, Error **errp)
+{
+    return qemu_vfio_pci_init_irqs(s, &e, 1, irq_type, errp);
+}
+
 static int qemu_vfio_pci_read_config(QEMUVFIOState *s, void *buf,
                                      int size, int ofs)
 {
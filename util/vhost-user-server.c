@@ -27,7 +27,12 @@
  * protocol messages over the UNIX domain socket.
  *
  * When virtqueues are set up libvhost-user calls set_watch() to monitor kick
- * fds. These fds are also handled in the VuServer->ctx AioContext.
+ * fds. These fds are also handled in the VuServer->ctx AioContext, unless the
+ * virtqueue has its own AioContext in VuServer->vq_ctx. In that case kicks and
+ * request completion for the virtqueue run in that AioContext. Before a kick fd
+ * handler in another thread is removed, vu_client_trip() moves over to the
+ * virtqueue's AioContext so that the handler is known not to be running
+ * anymore once remove_watch() returns.
  *
  * Both vu_client_trip() and kick fd monitoring can be stopped by shutting down
  * the socket connection. Shutting down the socket connection causes
@@ -89,14 +94,18 @@ static void panic_cb(VuDev *vu_dev, const char *buf)
 
 void vhost_user_server_inc_in_flight(VuServer *server)
 {
-    assert(!server->wait_idle);
+    assert(!qatomic_read(&server->wait_idle));
     qatomic_inc(&server->in_flight);
 }
 
 void vhost_user_server_dec_in_flight(VuServer *server)
 {
     if (qatomic_fetch_dec(&server->in_flight) == 1) {
-        if (server->wait_idle) {
+        /*
+         * Requests can complete in virtqueue AioContexts, so claim the wakeup
+         * in case vu_client_trip() is deciding whether to wait right now.
+         */
+        if (qatomic_cmpxchg(&server->wait_idle, true, false)) {
             aio_co_wake(server->co_trip);
         }
     }
@@ -207,10 +216,45 @@ fail:
     return false;
 }
 
+static AioContext *vu_fd_watch_ctx(VuServer *server, VuFdWatch *vu_fd_watch)
+{
+    if (server->vq_ctx && vu_fd_watch->vq_index >= 0 &&
+        server->vq_ctx[vu_fd_watch->vq_index]) {
+        return server->vq_ctx[vu_fd_watch->vq_index];
+    }
+    return server->ctx;
+}
+
+/*
+ * Stop monitoring a kick fd. When called from a coroutine, this returns only
+ * after the fd handler has stopped running, even if it runs in another thread.
+ */
+static void coroutine_mixed_fn
+vu_fd_watch_disable(VuServer *server, VuFdWatch *vu_fd_watch)
+{
+    AioContext *ctx = vu_fd_watch_ctx(server, vu_fd_watch);
+    AioContext *cur_ctx = qemu_get_current_aio_context();
+
+    if (!ctx) {
+        return;
+    }
+
+    if (ctx == cur_ctx || !qemu_in_coroutine()) {
+        aio_set_fd_handler(ctx, vu_fd_watch->fd,
+                           NULL, NULL, NULL, NULL, NULL);
+        return;
+    }
+
+    aio_co_reschedule_self(ctx);
+    aio_set_fd_handler(ctx, vu_fd_watch->fd, NULL, NULL, NULL, NULL, NULL);
+    aio_co_reschedule_self(cur_ctx);
+}
+
 static coroutine_fn void vu_client_trip(void *opaque)
 {
     VuServer *server = opaque;
     VuDev *vu_dev = &server->vu_dev;
+    VuFdWatch *vu_fd_watch;
 
     while (!vu_dev->broken) {
         if (server->quiescing) {
@@ -224,12 +268,23 @@ static coroutine_fn void vu_client_trip(void *opaque)
         }
     }
 
-    if (vhost_user_server_has_in_flight(server)) {
-        /* Wait for requests to complete before we can unmap the memory */
-        server->wait_idle = true;
+    /* No new requests may be started while waiting for in-flight ones */
+    QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
+        vu_fd_watch_disable(server, vu_fd_watch);
+    }
+
+    /*
+     * Wait for requests to complete before we can unmap the memory. If the
+     * last request completes concurrently, whoever manages to clear wait_idle
+     * first decides whether a wakeup takes place.
+     */
+    qatomic_set(&server->wait_idle, true);
+    smp_mb();
+    if (vhost_user_server_has_in_flight(server) ||
+        !qatomic_cmpxchg(&server->wait_idle, true, false)) {
         qemu_coroutine_yield();
-        server->wait_idle = false;
     }
+    assert(!qatomic_read(&server->wait_idle));
     assert(!vhost_user_server_has_in_flight(server));
 
     vu_deinit(vu_dev);
@@ -284,6 +339,16 @@ static VuFdWatch *find_vu_fd_watch(VuServer *server, int fd)
     return NULL;
 }
 
+static int vu_kick_fd_vq_index(VuDev *vu_dev, int fd)
+{
+    for (int i = 0; i < vu_dev->max_queues; i++) {
+        if (vu_dev->vq[i].kick_fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 static void
 set_watch(VuDev *vu_dev, int fd, int vu_evt,
           vu_watch_cb cb, void *pvt)
@@ -302,17 +367,18 @@ set_watch(VuDev *vu_dev, int fd, int vu_evt,
         QTAILQ_INSERT_TAIL(&server->vu_fd_watches, vu_fd_watch, next);
 
         vu_fd_watch->fd = fd;
+        vu_fd_watch->vq_index = vu_kick_fd_vq_index(vu_dev, fd);
         vu_fd_watch->cb = cb;
-        qemu_socket_set_nonblock(fd);
-        aio_set_fd_handler(server->ctx, fd, kick_handler,
-                           NULL, NULL, NULL, vu_fd_watch);
         vu_fd_watch->vu_dev = vu_dev;
         vu_fd_watch->pvt = pvt;
+        qemu_socket_set_nonblock(fd);
+        aio_set_fd_handler(vu_fd_watch_ctx(server, vu_fd_watch), fd,
+                           kick_handler, NULL, NULL, NULL, vu_fd_watch);
     }
 }
 
 
-static void remove_watch(VuDev *vu_dev, int fd)
+static void coroutine_mixed_fn remove_watch(VuDev *vu_dev, int fd)
 {
     VuServer *server;
     g_assert(vu_dev);
@@ -325,7 +391,7 @@ static void remove_watch(VuDev *vu_dev, int fd)
     if (!vu_fd_watch) {
         return;
     }
-    aio_set_fd_handler(server->ctx, fd, NULL, NULL, NULL, NULL, NULL);
+    vu_fd_watch_disable(server, vu_fd_watch);
 
     QTAILQ_REMOVE(&server->vu_fd_watches, vu_fd_watch, next);
     g_free(vu_fd_watch);
@@ -385,7 +451,8 @@ void vhost_user_server_stop(VuServer *server)
         VuFdWatch *vu_fd_watch;
 
         QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-            aio_set_fd_handler(server->ctx, vu_fd_watch->fd,
+            aio_set_fd_handler(vu_fd_watch_ctx(server, vu_fd_watch),
+                               vu_fd_watch->fd,
                                NULL, NULL, NULL, NULL, vu_fd_watch);
         }
 
@@ -424,7 +491,8 @@ void vhost_user_server_attach_aio_context(VuServer *server, AioContext *ctx)
     }
 
     QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-        aio_set_fd_handler(ctx, vu_fd_watch->fd, kick_handler, NULL,
+        aio_set_fd_handler(vu_fd_watch_ctx(server, vu_fd_watch),
+                           vu_fd_watch->fd, kick_handler, NULL,
                            NULL, NULL, vu_fd_watch);
     }
 
@@ -456,7 +524,8 @@ void vhost_user_server_detach_aio_context(VuServer *server)
         VuFdWatch *vu_fd_watch;
 
         QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-            aio_set_fd_handler(server->ctx, vu_fd_watch->fd,
+            aio_set_fd_handler(vu_fd_watch_ctx(server, vu_fd_watch),
+                               vu_fd_watch->fd,
                                NULL, NULL, NULL, NULL, vu_fd_watch);
         }
     }
@@ -474,6 +543,7 @@ void vhost_user_server_detach_aio_context(VuServer *server)
 bool vhost_user_server_start(VuServer *server,
                              SocketAddress *socket_addr,
                              AioContext *ctx,
+                             AioContext **vq_ctx,
                              uint16_t max_queues,
                              const VuDevIface *vu_iface,
                              Error **errp)
@@ -503,6 +573,7 @@ bool vhost_user_server_start(VuServer *server,
         .vu_iface              = vu_iface,
         .max_queues            = max_queues,
         .ctx                   = ctx,
+        .vq_ctx                = vq_ctx,
     };
 
     qio_net_listener_set_name(server->listener, "vhost-user-backend-listener");